@@ -91,6 +91,24 @@ CK_RV xProvisionDevice( CK_SESSION_HANDLE xSession,
  */
 void vAlternateKeyProvisioning( ProvisioningParams_t * xParams );
 
+/** \brief Replaces the device certificate, leaving the keys untouched.
+ *
+ * Used when a certificate is rotated for the existing device key: the
+ * certificate is stored with a single C_CreateObject and no other
+ * object is destroyed or rewritten.
+ *
+ * \note The PEM certificate is passed to the PKCS #11 module as is, so the
+ * module must accept PEM certificate values, as the mbedTLS-based module does.
+ *
+ * \param[in] pucCertificate       Pointer to the device certificate in PEM format.
+ * \param[in] xCertificateLength   Length of pucCertificate, in bytes.
+ *
+ * \return CKR_OK if the certificate was stored.
+ * Otherwise, a positive PKCS #11 error code.
+ */
+CK_RV xProvisionClientCertificate( uint8_t * pucCertificate,
+                                   size_t xCertificateLength );
+
 
 /** \brief Provisions a private key using PKCS #11 library.
  *
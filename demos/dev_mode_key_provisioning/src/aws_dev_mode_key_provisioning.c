@@ -879,6 +879,81 @@ void vAlternateKeyProvisioning( ProvisioningParams_t * xParams )
 }
 /*-----------------------------------------------------------*/
 
+CK_RV xProvisionClientCertificate( uint8_t * pucCertificate,
+                                   size_t xCertificateLength )
+{
+    CK_RV xResult = CKR_OK;
+    CK_FUNCTION_LIST_PTR pxFunctionList = NULL;
+    CK_SESSION_HANDLE xSession = 0;
+    CK_OBJECT_HANDLE xObject = CK_INVALID_HANDLE;
+    PKCS11_CertificateTemplate_t xCertificateTemplate;
+    CK_OBJECT_CLASS xCertificateClass = CKO_CERTIFICATE;
+    CK_CERTIFICATE_TYPE xCertificateType = CKC_X_509;
+    CK_BBOOL xTokenStorage = CK_TRUE;
+    CK_BYTE xSubject[] = "TestSubject";
+    CK_BYTE xLabel[] = pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS;
+
+    /* Litmus test for valid certificiate.  0x2d is '-' as in ----- BEGIN CERTIFICATE ----- */
+    if( ( pucCertificate == NULL ) || ( pucCertificate[ 0 ] != 0x2d ) )
+    {
+        xResult = CKR_ATTRIBUTE_VALUE_INVALID;
+    }
+
+    /* The template matches xProvisionCertificate, but the PEM is handed to
+     * the module directly, which decodes it once into the stored DER. */
+    xCertificateTemplate.xObjectClass.type = CKA_CLASS;
+    xCertificateTemplate.xObjectClass.pValue = &xCertificateClass;
+    xCertificateTemplate.xObjectClass.ulValueLen = sizeof( xCertificateClass );
+    xCertificateTemplate.xSubject.type = CKA_SUBJECT;
+    xCertificateTemplate.xSubject.pValue = xSubject;
+    xCertificateTemplate.xSubject.ulValueLen = strlen( ( const char * ) xSubject );
+    xCertificateTemplate.xValue.type = CKA_VALUE;
+    xCertificateTemplate.xValue.pValue = ( CK_VOID_PTR ) pucCertificate;
+    xCertificateTemplate.xValue.ulValueLen = ( CK_ULONG ) xCertificateLength;
+    xCertificateTemplate.xLabel.type = CKA_LABEL;
+    xCertificateTemplate.xLabel.pValue = ( CK_VOID_PTR ) xLabel;
+    xCertificateTemplate.xLabel.ulValueLen = strlen( ( const char * ) xLabel );
+    xCertificateTemplate.xCertificateType.type = CKA_CERTIFICATE_TYPE;
+    xCertificateTemplate.xCertificateType.pValue = &xCertificateType;
+    xCertificateTemplate.xCertificateType.ulValueLen = sizeof( CK_CERTIFICATE_TYPE );
+    xCertificateTemplate.xTokenObject.type = CKA_TOKEN;
+    xCertificateTemplate.xTokenObject.pValue = &xTokenStorage;
+    xCertificateTemplate.xTokenObject.ulValueLen = sizeof( xTokenStorage );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = C_GetFunctionList( &pxFunctionList );
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xInitializePkcs11Token();
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xInitializePkcs11Session( &xSession );
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = pxFunctionList->C_CreateObject( xSession,
+                                                  ( CK_ATTRIBUTE_PTR ) &xCertificateTemplate,
+                                                  sizeof( xCertificateTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                  &xObject );
+
+        pxFunctionList->C_CloseSession( xSession );
+    }
+
+    if( xResult != CKR_OK )
+    {
+        DEV_MODE_KEY_PROVISIONING_PRINT( ( "ERROR: Failed to store device certificate. %d \r\n", xResult ) );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
 void vDevModeKeyProvisioning( void )
 {
     ProvisioningParams_t xParams;
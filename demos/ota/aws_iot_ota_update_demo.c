@@ -594,9 +594,12 @@ int vRunOTAUpdateDemo( cdf_Api_t *cdfApi,
                     if ( (cdfApi->xReadCDFStateNVM)() == CDF_STATE_WAIT_FOR_CERT_ROTATE ) 
                     {
 
+                        /* The CDF agent acknowledges the new certificate on the same
+                         * connection as soon as it has been received. */
                         while ( (( eOTAState = OTA_GetAgentState() ) != eOTA_AgentState_NotReady ) &&  
                                ((( eCDFState = CDF_GetAgentState() ) == eCDF_AgentState_Ready ) || 
-                                (( eCDFState = CDF_GetAgentState() ) == eCDF_AgentState_GetCert ) ) && 
+                                (( eCDFState = CDF_GetAgentState() ) == eCDF_AgentState_GetCert ) ||
+                                (( eCDFState = CDF_GetAgentState() ) == eCDF_AgentState_AckCert ) ) && 
                                 (xNetworkConnected == pdTRUE) )
                         {
                             /* Wait forever for OTA traffic but allow other tasks to run and output statistics only once per second. */
@@ -607,9 +610,9 @@ int vRunOTAUpdateDemo( cdf_Api_t *cdfApi,
                             vTaskDelay( 2 * myappONE_SECOND_DELAY_IN_TICKS );
                         }
 
-                        if (CDF_GetAgentState() != eCDF_AgentState_AckCert ) 
+                        if (CDF_GetAgentState() != eCDF_AgentState_DeactivateCert ) 
                         {
-                            /* Cert Rotation did not move to AckCert state */
+                            /* Cert Rotation did not move to DeactivateCert state */
                             /* Manish Verify states when OTA Agent is Not Ready. Is it a failure also? */
                             status = EXIT_FAILURE;
                         }
@@ -47,13 +47,21 @@
 #include "iot_cdf_agent.h"
 
 
+/* PKCS#11 includes. */
+#include "iot_pkcs11.h"
+#include "iot_pkcs11_config.h"
+#include "iot_pki_utils.h"
+#include "aws_dev_mode_key_provisioning.h"
+
 #include "mbedtls/config.h"
 #include "mbedtls/platform.h"
 #include "mbedtls/x509_csr.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
 #include "mbedtls/error.h"
 #include "mbedtls/pk.h"
+#include "mbedtls/pk_internal.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/platform_util.h"
 
 #define PRINT_DELAY_SMALL 5
 #define PRINT_DELAY_BIG 5
@@ -139,126 +147,522 @@ void print_PEM(char * pemStr)
     IotClock_SleepMs( 500 );
 }
 
-extern int convert_pem_to_der( const unsigned char * pucInput,
-                        size_t xLen,
-                        unsigned char * pucOutput,
-                        size_t * pxOlen );
+/* Length of the CKA_EC_POINT of a P-256 public key: a DER OCTET STRING
+ * header followed by the uncompressed point. */
+#define CSR_EC_POINT_LENGTH       ( 67 )
+#define CSR_EC_POINT_DER_HEADER   ( 2 )
+
+/*
+ * Signing context for a CSR whose key lives in the PKCS#11 token.
+ *
+ * mbedTLS reads the public key of an ECKEY context as an mbedtls_ecp_keypair,
+ * so the key pair must be the first member; the sign callback gets the same
+ * pointer back and finds the token handles after it.
+ */
+typedef struct CsrSigningContext
+{
+    mbedtls_ecp_keypair xKeyPair;
+    CK_FUNCTION_LIST_PTR pxFunctionList;
+    CK_SESSION_HANDLE xSession;
+    CK_OBJECT_HANDLE xPrivateKey;
+} CsrSigningContext_t;
+
+/**
+ * @brief Random numbers for mbedTLS from the PKCS#11 module.
+ *
+ * The module seeds its DRBG once when it is initialized, so no DRBG is seeded
+ * per CSR.
+ */
+static int prvCsrRandom( void * pvContext,
+                         unsigned char * pucRandom,
+                         size_t xRandomLength )
+{
+    CsrSigningContext_t * pxContext = ( CsrSigningContext_t * ) pvContext;
+
+    if( pxContext->pxFunctionList->C_GenerateRandom( pxContext->xSession,
+                                                     pucRandom,
+                                                     ( CK_ULONG ) xRandomLength ) != CKR_OK )
+    {
+        return MBEDTLS_ERR_ECP_RANDOM_FAILED;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief mbedTLS sign callback that signs the CSR hash with the token key.
+ */
+static int prvCsrSign( void * pvContext,
+                       mbedtls_md_type_t xMdAlg,
+                       const unsigned char * pucHash,
+                       size_t xHashLen,
+                       unsigned char * pucSig,
+                       size_t * pxSigLen,
+                       int ( * piRng )( void *,
+                                        unsigned char *,
+                                        size_t ),
+                       void * pvRng )
+{
+    CsrSigningContext_t * pxContext = ( CsrSigningContext_t * ) pvContext;
+    CK_MECHANISM xMech = { CKM_ECDSA, NULL, 0 };
+    CK_ULONG xSigLen = pkcs11ECDSA_P256_SIGNATURE_LENGTH;
+    CK_RV xResult;
+
+    ( void ) xMdAlg;
+    ( void ) piRng;
+    ( void ) pvRng;
+
+    xResult = pxContext->pxFunctionList->C_SignInit( pxContext->xSession,
+                                                     &xMech,
+                                                     pxContext->xPrivateKey );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = pxContext->pxFunctionList->C_Sign( pxContext->xSession,
+                                                     ( CK_BYTE_PTR ) pucHash,
+                                                     ( CK_ULONG ) xHashLen,
+                                                     pucSig,
+                                                     &xSigLen );
+    }
+
+    if( ( xResult != CKR_OK ) || ( xSigLen != pkcs11ECDSA_P256_SIGNATURE_LENGTH ) )
+    {
+        IotLogError( "pkcs11_getCSR: signing failed %d.", ( int ) xResult );
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+
+    /* PKCS#11 returns R and S; mbedTLS expects an ASN.1 encoded signature. */
+    *pxSigLen = xSigLen;
+
+    return PKI_pkcs11SignatureTombedTLSSignature( pucSig, pxSigLen );
+}
+
+/**
+ * @brief Find a key pair in the token by its labels.
+ *
+ * A handle is CK_INVALID_HANDLE if the token has no key with its label.
+ */
+static CK_RV prvFindKeyPair( CK_SESSION_HANDLE xSession,
+                             const char * pcPrivateKeyLabel,
+                             const char * pcPublicKeyLabel,
+                             CK_OBJECT_HANDLE_PTR pxPrivateKey,
+                             CK_OBJECT_HANDLE_PTR pxPublicKey )
+{
+    CK_RV xResult;
+
+    xResult = xFindObjectWithLabelAndClass( xSession,
+                                            pcPrivateKeyLabel,
+                                            CKO_PRIVATE_KEY,
+                                            pxPrivateKey );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xFindObjectWithLabelAndClass( xSession,
+                                                pcPublicKeyLabel,
+                                                CKO_PUBLIC_KEY,
+                                                pxPublicKey );
+    }
+
+    return xResult;
+}
+
+/**
+ * @brief Read a P-256 public key of the token into an mbedTLS key pair.
+ *
+ * @return 0 if successful.
+ */
+static int prvLoadPublicKey( CK_FUNCTION_LIST_PTR pxFunctionList,
+                             CK_SESSION_HANDLE xSession,
+                             CK_OBJECT_HANDLE xPublicKey,
+                             mbedtls_ecp_keypair * pxKeyPair )
+{
+    CK_BYTE xEcPoint[ CSR_EC_POINT_LENGTH ];
+    CK_ATTRIBUTE xTemplate = { CKA_EC_POINT, xEcPoint, sizeof( xEcPoint ) };
+    int ret;
+
+    if( pxFunctionList->C_GetAttributeValue( xSession, xPublicKey, &xTemplate, 1 ) != CKR_OK )
+    {
+        return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    }
+
+    if( ( ret = mbedtls_ecp_group_load( &pxKeyPair->grp, MBEDTLS_ECP_DP_SECP256R1 ) ) == 0 )
+    {
+        ret = mbedtls_ecp_point_read_binary( &pxKeyPair->grp,
+                                             &pxKeyPair->Q,
+                                             xEcPoint + CSR_EC_POINT_DER_HEADER,
+                                             xTemplate.ulValueLen - CSR_EC_POINT_DER_HEADER );
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Check that the device certificate was issued for the device key.
+ *
+ * @return true if the public key of the certificate in the token is the
+ * device public key.
+ */
+static int prvDeviceKeyMatchesCertificate( CK_FUNCTION_LIST_PTR pxFunctionList,
+                                           CK_SESSION_HANDLE xSession )
+{
+    CK_OBJECT_HANDLE xPrivateKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xPublicKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xCertificate = CK_INVALID_HANDLE;
+    CK_ATTRIBUTE xTemplate = { CKA_VALUE, NULL, 0 };
+    mbedtls_ecp_keypair xDeviceKey;
+    mbedtls_x509_crt xCertificateContext;
+    CK_RV xResult;
+    int xMatch = false;
+
+    mbedtls_ecp_keypair_init( &xDeviceKey );
+    mbedtls_x509_crt_init( &xCertificateContext );
+
+    xResult = prvFindKeyPair( xSession,
+                              pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+                              pkcs11configLABEL_DEVICE_PUBLIC_KEY_FOR_TLS,
+                              &xPrivateKey,
+                              &xPublicKey );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xFindObjectWithLabelAndClass( xSession,
+                                                pkcs11configLABEL_DEVICE_CERTIFICATE_FOR_TLS,
+                                                CKO_CERTIFICATE,
+                                                &xCertificate );
+    }
+
+    if( ( xResult == CKR_OK ) &&
+        ( ( xPrivateKey == CK_INVALID_HANDLE ) ||
+          ( xPublicKey == CK_INVALID_HANDLE ) ||
+          ( xCertificate == CK_INVALID_HANDLE ) ) )
+    {
+        xResult = CKR_OBJECT_HANDLE_INVALID;
+    }
+
+    /* Get the length of the certificate, then the certificate. */
+    if( xResult == CKR_OK )
+    {
+        xResult = pxFunctionList->C_GetAttributeValue( xSession, xCertificate, &xTemplate, 1 );
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xTemplate.pValue = pvPortMalloc( xTemplate.ulValueLen );
+
+        if( xTemplate.pValue == NULL )
+        {
+            xResult = CKR_HOST_MEMORY;
+        }
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = pxFunctionList->C_GetAttributeValue( xSession, xCertificate, &xTemplate, 1 );
+    }
+
+    if( xResult != CKR_OK )
+    {
+        IotLogError( "pkcs11_promotePendingKey: device credentials not available %d.", ( int ) xResult );
+    }
+    else if( ( prvLoadPublicKey( pxFunctionList, xSession, xPublicKey, &xDeviceKey ) == 0 ) &&
+             ( mbedtls_x509_crt_parse_der( &xCertificateContext, xTemplate.pValue, xTemplate.ulValueLen ) == 0 ) &&
+             ( mbedtls_pk_get_type( &xCertificateContext.pk ) == MBEDTLS_PK_ECKEY ) &&
+             ( mbedtls_pk_ec( xCertificateContext.pk )->grp.id == xDeviceKey.grp.id ) &&
+             ( mbedtls_ecp_point_cmp( &mbedtls_pk_ec( xCertificateContext.pk )->Q, &xDeviceKey.Q ) == 0 ) )
+    {
+        xMatch = true;
+    }
+
+    if( xTemplate.pValue != NULL )
+    {
+        vPortFree( xTemplate.pValue );
+    }
+
+    mbedtls_x509_crt_free( &xCertificateContext );
+    mbedtls_ecp_keypair_free( &xDeviceKey );
+
+    return xMatch;
+}
 
-char private_key_der_str[ _CR_PRIVATE_KEY_SIZE ];
 /**
- * @brief Use Mbedtls library to generate a CSR.
+ * @brief Destroy the pending key pair of a rotation that did not complete.
+ *
+ * A CSR generated for it must not be sent again.
  */
-int mbed_getCSR( char *csr_str, char *private_key_pem_str, char *certificate_str )
+void pkcs11_discardPendingKey( void )
 {
-    mbedtls_pk_context key;
+    CK_FUNCTION_LIST_PTR pxFunctionList;
+    CK_SESSION_HANDLE xSession = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xPrivateKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xPublicKey = CK_INVALID_HANDLE;
+    CK_RV xResult;
+
+    xResult = C_GetFunctionList( &pxFunctionList );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xInitializePkcs11Session( &xSession );
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xFindObjectWithLabelAndClass( xSession,
+                                                pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS,
+                                                CKO_PRIVATE_KEY,
+                                                &xPrivateKey );
+    }
+
+    if( ( xResult == CKR_OK ) && ( xPrivateKey != CK_INVALID_HANDLE ) )
+    {
+        xResult = pxFunctionList->C_DestroyObject( xSession, xPrivateKey );
+    }
+
+    /* Ports that keep both keys in one slot have destroyed the public key
+     * with the private key. */
+    if( xResult == CKR_OK )
+    {
+        xResult = xFindObjectWithLabelAndClass( xSession,
+                                                pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS,
+                                                CKO_PUBLIC_KEY,
+                                                &xPublicKey );
+    }
+
+    if( ( xResult == CKR_OK ) && ( xPublicKey != CK_INVALID_HANDLE ) )
+    {
+        xResult = pxFunctionList->C_DestroyObject( xSession, xPublicKey );
+    }
+
+    if( xResult != CKR_OK )
+    {
+        IotLogWarn( "pkcs11_discardPendingKey: pending key pair not destroyed %d.", ( int ) xResult );
+    }
+
+    if( xSession != CK_INVALID_HANDLE )
+    {
+        pxFunctionList->C_CloseSession( xSession );
+    }
+}
+
+/**
+ * @brief Make the pending key pair the device key pair.
+ *
+ * Called once the certificate issued for the pending key is installed. The
+ * pending private key is copied to the device key label inside the token, so
+ * it never leaves the token, and the pending key pair is destroyed.
+ *
+ * The token keeps the pending key pair across resets, so the promotion can be
+ * run again after one. If no key pair is pending, the device key pair is only
+ * kept if it is the one the installed certificate was issued for; that is the
+ * case when the promotion was done before the reset.
+ *
+ * @return true if the device key pair is the one the device certificate was
+ * issued for.
+ */
+int pkcs11_promotePendingKey( void )
+{
+    CK_FUNCTION_LIST_PTR pxFunctionList;
+    CK_SESSION_HANDLE xSession = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xPendingKey = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xDeviceKey = CK_INVALID_HANDLE;
+    CK_ATTRIBUTE xTemplate =
+    {
+        CKA_LABEL,
+        pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+        sizeof( pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS ) - 1
+    };
+    CK_RV xResult;
+    int xReturn = false;
+
+    xResult = C_GetFunctionList( &pxFunctionList );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xInitializePkcs11Session( &xSession );
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xFindObjectWithLabelAndClass( xSession,
+                                                pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS,
+                                                CKO_PRIVATE_KEY,
+                                                &xPendingKey );
+    }
+
+    if( ( xResult == CKR_OK ) && ( xPendingKey == CK_INVALID_HANDLE ) )
+    {
+        IotLogWarn( "pkcs11_promotePendingKey: no pending key pair" );
+    }
+    else if( xResult == CKR_OK )
+    {
+        /* The public key object is derived from the stored private key. */
+        xResult = pxFunctionList->C_CopyObject( xSession, xPendingKey, &xTemplate, 1, &xDeviceKey );
+    }
+
+    if( xResult != CKR_OK )
+    {
+        IotLogError( "pkcs11_promotePendingKey: device key pair not stored %d.", ( int ) xResult );
+    }
+    else
+    {
+        xReturn = prvDeviceKeyMatchesCertificate( pxFunctionList, xSession );
+
+        if( !xReturn )
+        {
+            IotLogError( "pkcs11_promotePendingKey: device certificate not issued for the device key pair" );
+        }
+    }
+
+    if( xSession != CK_INVALID_HANDLE )
+    {
+        pxFunctionList->C_CloseSession( xSession );
+    }
+
+    /* The pending key pair is the device key pair now. */
+    if( xReturn && ( xPendingKey != CK_INVALID_HANDLE ) )
+    {
+        pkcs11_discardPendingKey();
+    }
+
+    return xReturn;
+}
+
+/**
+ * @brief Generate a CSR for the device key, or for a new pending key.
+ *
+ * With generate_key set, a new P-256 key pair is generated in the token under
+ * the pending key labels, replacing the previous pending key pair, and the
+ * CSR is for it. The device key pair is left alone until
+ * pkcs11_promotePendingKey(). Otherwise the CSR is for the device key pair.
+ * Either private key never leaves the token; the CSR is signed by it through
+ * a PKCS#11 backed mbedTLS context.
+ *
+ * @return true if csr_str holds the PEM CSR.
+ */
+int pkcs11_getCSR( char *csr_str, int generate_key )
+{
+    CsrSigningContext_t xContext;
+    mbedtls_pk_info_t xPkInfo;
+    mbedtls_pk_context xKey;
     mbedtls_x509write_csr req;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
+    CK_OBJECT_HANDLE xPublicKey = CK_INVALID_HANDLE;
+    CK_RV xResult;
     int xReturn = true;
     int ret;
-    const char *pers = "csr example";
-    int private_key_pem_str_len;
-    size_t private_key_der_str_len = _CR_PRIVATE_KEY_SIZE;
- 
-    IotLogInfo("mbed_getCSR: Initialization"); 
-
-    /* 
-     * WARNING: set both entropy and key to all zeros.
-i    *
-     * Note that other _init() funcs clear the memory inside the function,
-     * but mbedtls_pk_init() and mbedtls_entropy_init() don't clear all 
-     * the memory. A critical thing to set to zero is a semaphore member
-     * of the struct, otherwise a low level routine thinks a semaphore 
-     * has already been initialized, which causes the CSR gen to fail.
-     */
-    memset( &entropy, 0, sizeof( mbedtls_entropy_context ) );
-    memset( &key, 0, sizeof( mbedtls_pk_context ) );
-
-    mbedtls_pk_init( &key );
+
+    memset( &xContext, 0, sizeof( xContext ) );
+    mbedtls_ecp_keypair_init( &xContext.xKeyPair );
     mbedtls_x509write_csr_init( &req );
-    mbedtls_ctr_drbg_init( &ctr_drbg );
-    mbedtls_entropy_init( &entropy );
-
-    mbedtls_x509write_csr_set_md_alg( &req, MBEDTLS_MD_SHA256 );
-    mbedtls_x509write_csr_set_key_usage( &req, MBEDTLS_X509_KU_DIGITAL_SIGNATURE );
-    mbedtls_x509write_csr_set_ns_cert_type( &req, MBEDTLS_X509_NS_CERT_TYPE_SSL_CLIENT );
-
-    /*
-     * Seed the PRNG
-     */
-    private_key_pem_str_len = strlen(private_key_pem_str);
-    if( ( ret = mbedtls_ctr_drbg_seed( &ctr_drbg, mbedtls_entropy_func, &entropy,
-                               (const unsigned char *) pers,
-                               strlen( pers ) ) ) != 0 )
-    {
-        IotLogError( "mbed_getCSR: Failed mbedtls_ctr_drbg_seed() returned %d.", ret );
+
+    xResult = C_GetFunctionList( &xContext.pxFunctionList );
+
+    if( xResult == CKR_OK )
+    {
+        xResult = xInitializePkcs11Session( &xContext.xSession );
+    }
+
+    if( xResult != CKR_OK )
+    {
+        IotLogError( "pkcs11_getCSR: no PKCS#11 session %d.", ( int ) xResult );
         xReturn = false;
     }
 
-    if (xReturn)
+    if( xReturn && generate_key )
     {
-        /*
-         * Check the subject name for validity. Subject string cannot have spaces in the wrong places.
-         * e.g. "C = CH, O = Brev Demo, CN = www.brevDemo.org" is an invalid subject.
-         */
-        if( ( ret = mbedtls_x509write_csr_set_subject_name( &req, "C=CH,O=Brev Demo,CN=www.brevDemo.org" ) ) != 0 )
+        IotLogInfo( "pkcs11_getCSR: generating pending device key pair" );
+
+        xResult = xProvisionGenerateKeyPairEC( xContext.xSession,
+                                               ( uint8_t * ) pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS,
+                                               ( uint8_t * ) pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS,
+                                               &xContext.xPrivateKey,
+                                               &xPublicKey );
+    }
+    else if( xReturn )
+    {
+        xResult = prvFindKeyPair( xContext.xSession,
+                                  pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+                                  pkcs11configLABEL_DEVICE_PUBLIC_KEY_FOR_TLS,
+                                  &xContext.xPrivateKey,
+                                  &xPublicKey );
+    }
+
+    if( xReturn )
+    {
+        if( ( xResult == CKR_OK ) &&
+            ( ( xContext.xPrivateKey == CK_INVALID_HANDLE ) || ( xPublicKey == CK_INVALID_HANDLE ) ) )
+        {
+            xResult = CKR_OBJECT_HANDLE_INVALID;
+        }
+
+        if( xResult != CKR_OK )
         {
-            IotLogError( "mbed_getCSR: Failed mbedtls_x509write_csr_set_subject_name() returned %d.", ret );
+            IotLogError( "pkcs11_getCSR: %s key pair not available %d.",
+                         generate_key ? "pending" : "device", ( int ) xResult );
             xReturn = false;
         }
     }
 
-    if (xReturn)
+    /* Load the public key for the CSR. */
+    if( xReturn )
     {
-        /*
-         * Convert the PEM to DER format. This requires format passed into the function is PEM.
-         */
-        if ( (ret = convert_pem_to_der( 
-                    (const unsigned char * ) private_key_pem_str,
-                    private_key_pem_str_len,
-                    (unsigned char *) private_key_der_str,
-                    &private_key_der_str_len ) )  != 0 )
+        if( ( ret = prvLoadPublicKey( xContext.pxFunctionList,
+                                      xContext.xSession,
+                                      xPublicKey,
+                                      &xContext.xKeyPair ) ) != 0 )
         {
-            IotLogError( "mbed_getCSR: Failed convert_pem_to_der() returned %d.", ret );
+            IotLogError( "pkcs11_getCSR: Failed to load public key %d.", ret );
             xReturn = false;
         }
     }
 
-    if (xReturn)
+    if( xReturn )
     {
+        /* An ECKEY context whose signing goes to the token. */
+        memcpy( &xPkInfo, mbedtls_pk_info_from_type( MBEDTLS_PK_ECKEY ), sizeof( mbedtls_pk_info_t ) );
+        xPkInfo.sign_func = prvCsrSign;
+        xKey.pk_info = &xPkInfo;
+        xKey.pk_ctx = &xContext;
+
+        mbedtls_x509write_csr_set_md_alg( &req, MBEDTLS_MD_SHA256 );
+        mbedtls_x509write_csr_set_key_usage( &req, MBEDTLS_X509_KU_DIGITAL_SIGNATURE );
+        mbedtls_x509write_csr_set_ns_cert_type( &req, MBEDTLS_X509_NS_CERT_TYPE_SSL_CLIENT );
+        mbedtls_x509write_csr_set_key( &req, &xKey );
+
         /*
-         * Load the private key
+         * Check the subject name for validity. Subject string cannot have spaces in the wrong places.
+         * e.g. "C = CH, O = Brev Demo, CN = www.brevDemo.org" is an invalid subject.
          */
-        ret = mbedtls_pk_parse_key( &key, (const unsigned char *) private_key_der_str, private_key_der_str_len, NULL, 0);
-
-        if( ret != 0 )
+        if( ( ret = mbedtls_x509write_csr_set_subject_name( &req, "C=CH,O=Brev Demo,CN=www.brevDemo.org" ) ) != 0 )
         {
-            IotLogError( "mbed_getCSR: Failed mbedtls_pk_parse_key returned %d.", ret );
+            IotLogError( "pkcs11_getCSR: Failed mbedtls_x509write_csr_set_subject_name() returned %d.", ret );
             xReturn = false;
         }
     }
 
-    mbedtls_x509write_csr_set_key( &req, &key );
-
-    if (xReturn)
+    if( xReturn )
     {
-        /*
-         * Write the request
-         */
         memset( csr_str, 0, _CR_CSR_SIZE );
 
-        if( ( ret = mbedtls_x509write_csr_pem( &req, (unsigned char *) csr_str, _CR_CSR_SIZE, mbedtls_ctr_drbg_random, &ctr_drbg ) ) < 0 )
+        if( ( ret = mbedtls_x509write_csr_pem( &req, ( unsigned char * ) csr_str, _CR_CSR_SIZE, prvCsrRandom, &xContext ) ) < 0 )
         {
-            IotLogError( "mbed_getCSR: Failed mbedtls_x509write_csr_pem returned %d.", ret );
+            IotLogError( "pkcs11_getCSR: Failed mbedtls_x509write_csr_pem returned %d.", ret );
             xReturn = false;
         }
     }
 
+    /* xKey is not freed with mbedtls_pk_free; its context is on this stack. */
     mbedtls_x509write_csr_free( &req );
-    mbedtls_pk_free( &key );
-    mbedtls_ctr_drbg_free( &ctr_drbg );
-    mbedtls_entropy_free( &entropy );
+    mbedtls_ecp_keypair_free( &xContext.xKeyPair );
+
+    if( xContext.xSession != CK_INVALID_HANDLE )
+    {
+        xContext.pxFunctionList->C_CloseSession( xContext.xSession );
+    }
+
+    /* A pending key without a CSR can never be promoted. */
+    if( generate_key && !xReturn )
+    {
+        pkcs11_discardPendingKey();
+    }
 
     return xReturn;
 }
-
@@ -55,6 +55,7 @@ static char _cdf_temp_certificate[ _CR_CERTIFICATE_SIZE ];
 static char _cdf_certificate[ _CR_CERTIFICATE_SIZE ];
 static char _cdf_private_key[ _CR_PRIVATE_KEY_SIZE ];
 static char _cdf_csr[ _CR_CSR_SIZE ];
+static bool _cdf_csr_valid = false;
 static char _cdf_new_certificate_id[_CERTIFICATE_ID_LENGTH];
 static char _cdf_old_certificate_id[_CERTIFICATE_ID_LENGTH];
 
@@ -86,6 +87,12 @@ extern void print_PEM(char * pemStr);
 static uint8_t prvCDF_CustomerWriteState (CDF_STATE val)
 {
     _cdf_state = val;
+
+    /* The next rotation gets a fresh key pair and CSR. */
+    if (val == CDF_STATE_FINISHED)
+    {
+        _cdf_csr_valid = false;
+    }
     return EXIT_SUCCESS;
 }
 
@@ -94,54 +101,20 @@ static CDF_STATE prvCDF_CustomerReadState ()
     return _cdf_state;
 }
 
+/* The CDF agent hands over the PEM already unescaped, so it is stored as is. */
 static uint8_t _CustomerPutCert (char *cert_str, char *dst)
 {
     int status = EXIT_FAILURE;
-    char *cpTo, *cpFrom; 
-    int foundSlash = false;
+    size_t len = strlen(cert_str);
 
-    if (strlen(cert_str) < _CR_CERTIFICATE_SIZE)
+    if (len < _CR_CERTIFICATE_SIZE)
     {
         status = EXIT_SUCCESS;
-        cpTo = dst;
-        cpFrom = cert_str;
-        while (*cpFrom)
-        {
-            if (foundSlash)
-            {
-                if  (*cpFrom == 'n')
-                {
-                    *cpTo++ = '\n' ;
-                    cpFrom++;
-                }
-                else if (*cpFrom == 'r')
-                {
-                    *cpTo++ = '\r' ;
-                    cpFrom++;
-                }
-                else 
-                {
-                    *cpTo++ = '\\' ;
-                }
-            }
-
-            if (*cpFrom == '\\')
-            {
-                foundSlash = true;
-                cpFrom++;
-            }
-            else
-            {
-                *cpTo++ = *cpFrom++;
-                foundSlash = false;
-            }
-        }
-        /* Null terminate */
-        *cpTo = *cpFrom;
+        memcpy(dst, cert_str, len + 1);
     }
     else
     {
-        IotLogError( "prvCDF_CustomerPutDeviceCert: cert_str size = %d, _CR_CERTIFICATE_SIZE= %d.", strlen(cert_str), _CR_CERTIFICATE_SIZE); 
+        IotLogError( "prvCDF_CustomerPutDeviceCert: cert_str size = %d, _CR_CERTIFICATE_SIZE= %d.", len, _CR_CERTIFICATE_SIZE); 
     }
     
     return status;
@@ -198,12 +171,23 @@ static uint8_t prvCDF_CustomerPutCSR (char *csr_str)
     return status;
 }
 
+/*
+ * A pending key pair is generated on the first request of a rotation. Retries
+ * of the same rotation send the cached CSR, so the key the new certificate is
+ * issued for is the pending key, which replaces the device key only once the
+ * new certificate is installed.
+ */
 static char * prvCDF_CustomerGetCSR ( void )
 {
     char * ret_csr_str;
        
     IotLogInfo( "prvCDF_CustomerGetCSR: start");
-    if (mbed_getCSR( &_cdf_csr[0], &_cdf_private_key[0], &_cdf_certificate[0] ))
+    if (!_cdf_csr_valid)
+    {
+        _cdf_csr_valid = pkcs11_getCSR( &_cdf_csr[0], true );
+    }
+
+    if (_cdf_csr_valid)
     {
         ret_csr_str = &_cdf_csr[0];
 #ifdef DEBUG_CSR_AND_CERT
@@ -218,6 +202,13 @@ static char * prvCDF_CustomerGetCSR ( void )
     return (ret_csr_str);
 }
 
+/* Forget the pending key pair, and the CSR made for it, of a failed rotation. */
+static void _discardRotationKey ( void )
+{
+    pkcs11_discardPendingKey();
+    _cdf_csr_valid = false;
+}
+
 static int prvCDF_CustomerRegisterDevice ( void )
 {
     return EXIT_SUCCESS;
@@ -300,7 +291,36 @@ void _provisionCert( char *certStr,
 
     credentials = (IotNetworkCredentials_t *) pNetworkCredentialInfo; 
     credentials->pClientCert = (const char *) certStr;
-    credentials->clientCertSize = strlen( credentials->pClientCert + 1);
+    credentials->clientCertSize = strlen( credentials->pClientCert ) + 1;
+}
+
+/*
+ * Store a new certificate for the private key that is already provisioned.
+ * Only the certificate object is replaced; the key is not re-imported.
+ * Returns EXIT_FAILURE, and leaves the network credentials alone, if the
+ * certificate could not be stored.
+ */
+int _provisionCertOnly( char *certStr, 
+        IotNetworkCredentials_t * pNetworkCredentialInfo )
+{
+    IotNetworkCredentials_t * credentials; 
+    CK_RV xResult;
+
+    IotLogInfo("_provisionCertOnly");
+
+    xResult = xProvisionClientCertificate( ( uint8_t * ) certStr, strlen( certStr ) + 1 );
+
+    if( xResult != CKR_OK )
+    {
+        IotLogError( "_provisionCertOnly: failed to store the certificate, error 0x%lx", ( unsigned long ) xResult );
+        return EXIT_FAILURE;
+    }
+
+    credentials = (IotNetworkCredentials_t *) pNetworkCredentialInfo; 
+    credentials->pClientCert = (const char *) certStr;
+    credentials->clientCertSize = strlen( credentials->pClientCert ) + 1;
+
+    return EXIT_SUCCESS;
 }
         
         
@@ -388,12 +408,16 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
              */
             IotLogInfo( "vRunCDF_OTADemo CDF_STATE_APP_REG ");
             IotClock_SleepMs( 1000 );
-            _provisionCert((*cdfApi.xGetDeviceCert)(), &cdfApi, pNetworkCredentialInfo);
-            status = vCdfAppReg(awsIotMqttMode,
-                    clientcredentialIOT_THING_NAME,
-                    pNetworkServerInfo,
-                    pNetworkCredentialInfo,
-                    pNetworkInterface );
+            status = _provisionCertOnly((*cdfApi.xGetDeviceCert)(), pNetworkCredentialInfo);
+
+            if (status == EXIT_SUCCESS)
+            {
+                status = vCdfAppReg(awsIotMqttMode,
+                        clientcredentialIOT_THING_NAME,
+                        pNetworkServerInfo,
+                        pNetworkCredentialInfo,
+                        pNetworkInterface );
+            }
 
             if (status == EXIT_SUCCESS)
             {
@@ -407,7 +431,12 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
             
             IotLogInfo( "vRunCDF_OTADemo CDF_STATE_WAIT_FOR_CERT_ROTATE ");
             IotClock_SleepMs( 1000 );
-            _provisionCert((*cdfApi.xGetDeviceCert)(), &cdfApi, pNetworkCredentialInfo);
+            if (_provisionCertOnly((*cdfApi.xGetDeviceCert)(), pNetworkCredentialInfo) != EXIT_SUCCESS)
+            {
+                /* Without its certificate the device can not connect. */
+                status = EXIT_FAILURE;
+                break;
+            }
             status = vRunOTAUpdateDemo(&cdfApi,
                     awsIotMqttMode,
                     clientcredentialIOT_THING_NAME,
@@ -415,10 +444,7 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
                     pNetworkCredentialInfo,
                     pNetworkInterface );
 
-            if (status == EXIT_SUCCESS)
-            {
-                ( * cdfApi.xWriteCDFStateNVM ) ( CDF_STATE_ACK_CERT_ROTATE );
-            }
+            /* The CDF agent persists the rotation progress itself. */
 #ifdef DEBUG_CSR_AND_CERT
             IotLogInfo("CDF_STATE_WAIT_FOR_CERT_ROTATE TEMP CERT"); 
             print_PEM((*cdfApi.xGetTempDeviceCert)());
@@ -440,11 +466,7 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
                     pNetworkCredentialInfo,
                     pNetworkInterface );
 
-            if (status == EXIT_SUCCESS)
-            {
-                /* You have successfully receieved the new certificate, write to the new state */
-                ( * cdfApi.xWriteCDFStateNVM) ( CDF_STATE_DEACTIVATE_CERT );
-            }
+            /* The CDF agent persists the rotation progress itself. */
 #ifdef DEBUG_CSR_AND_CERT
             IotLogInfo("CDF_STATE_ACK_CERT_ROTATE TEMP CERT"); 
             print_PEM((*cdfApi.xGetTempDeviceCert)());
@@ -457,7 +479,28 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
         {
             IotLogInfo( "vRunCDF_OTADemo CDF_STATE_ACK_CERT_ROTATE ");
             IotClock_SleepMs( 1000 );
-            _provisionCert((*cdfApi.xGetTempDeviceCert)(), &cdfApi, pNetworkCredentialInfo);
+            if (_provisionCertOnly((*cdfApi.xGetTempDeviceCert)(), pNetworkCredentialInfo) != EXIT_SUCCESS)
+            {
+                /* The new certificate is not installed, so the rotation
+                 * failed. The old certificate has not been deactivated yet;
+                 * go back to it and wait for the next rotation. */
+                IotLogError( "vRunCDF_OTADemo: rotated certificate not installed, rotation failed");
+                _discardRotationKey();
+                ( * cdfApi.xWriteCDFStateNVM ) ( CDF_STATE_WAIT_FOR_CERT_ROTATE );
+                status = EXIT_SUCCESS;
+                continue;
+            }
+            if (!pkcs11_promotePendingKey())
+            {
+                /* The new certificate is useless without its key. The old
+                 * key pair is still in the token, and the old certificate is
+                 * stored again on the way back. */
+                IotLogError( "vRunCDF_OTADemo: rotated key pair not installed, rotation failed");
+                _discardRotationKey();
+                ( * cdfApi.xWriteCDFStateNVM ) ( CDF_STATE_WAIT_FOR_CERT_ROTATE );
+                status = EXIT_SUCCESS;
+                continue;
+            }
             status = vRunOTAUpdateDemo(&cdfApi,
                     awsIotMqttMode,
                     clientcredentialIOT_THING_NAME,
@@ -467,9 +510,8 @@ int vRunCDF_OTADemo ( bool awsIotMqttMode,
 
             if (status == EXIT_SUCCESS)
             {
-                /* Successful cert rotation, verify the old cert no longer works */
+                /* Successful cert rotation, the agent has recorded CDF_STATE_FINISHED */
                 ( * cdfApi.xPutDeviceCert) ( ( * cdfApi.xGetTempDeviceCert)() );
-                ( * cdfApi.xWriteCDFStateNVM ) ( CDF_STATE_FINISHED );
             }
             status = EXIT_SUCCESS;
 #ifdef DEBUG_CSR_AND_CERT
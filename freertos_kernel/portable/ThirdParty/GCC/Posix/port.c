@@ -0,0 +1,466 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the Posix port.
+ *
+ * Each task runs in its own pthread.  Only the thread of the task that the
+ * kernel selected runs, all the others wait on their own condition variable,
+ * so the kernel data is never accessed by two threads at once.  The tick
+ * interrupt is simulated by SIGALRM from an interval timer.  The signal is
+ * blocked in every thread except the running one, and the running thread
+ * blocks it to disable interrupts, so the tick handler always runs in the
+ * thread of the task it interrupts and can switch context from there.
+ *
+ * A task that is switched out by the tick may be in the middle of a host
+ * library call.  If that call holds a lock, for example the stdio lock, then
+ * another task calling the same function waits until the first task runs
+ * again.  Tasks should therefore keep host calls short, and must not wait in
+ * the host for something another task does.
+ *----------------------------------------------------------*/
+
+/* Standard includes. */
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* The signal used to simulate the tick interrupt. */
+#define portTICK_SIGNAL					SIGALRM
+
+#define portNO_CRITICAL_NESTING			( ( UBaseType_t ) 0 )
+
+/* The host thread of a task.  The context switching is managed by the threads,
+so the task stack is only used to hold this structure, in the same way as in
+the Windows port. */
+typedef struct THREAD
+{
+	/* The thread that executes the task. */
+	pthread_t xThread;
+
+	/* Task entry point and its parameter. */
+	TaskFunction_t pxCode;
+	void *pvParameters;
+
+	/* The thread runs when xRunning is set.  It is set by the thread that
+	switches to this one and cleared by this thread when it resumes. */
+	pthread_mutex_t xRunMutex;
+	pthread_cond_t xRunCondition;
+	BaseType_t xRunning;
+
+	/* Set when the task deleted itself, the thread then exits instead of
+	waiting to run again. */
+	BaseType_t xDying;
+} Thread_t;
+
+/*
+ * Entry point of every task thread.  Waits until the task first runs, then
+ * calls the task function.
+ */
+static void *prvWaitForStart( void *pvParameters );
+
+/*
+ * Let pxThreadToResume run and wait until pxThreadToSuspend runs again.  Both
+ * can be the same thread, in which case nothing happens.  Must be called from
+ * the running thread with the tick signal blocked.
+ */
+static void prvSwitchThread( Thread_t *pxThreadToResume, Thread_t *pxThreadToSuspend );
+
+static void prvResumeThread( Thread_t *pxThread );
+static void prvSuspendSelf( Thread_t *pxThread );
+
+/*
+ * The simulated tick interrupt.
+ */
+static void prvTickSignalHandler( int iSignal );
+
+/*
+ * Start the interval timer that generates the tick signal.
+ */
+static void prvSetupTimerInterrupt( void );
+
+/*-----------------------------------------------------------*/
+
+/* The critical nesting count of the running task.  Each thread saves it while
+it is switched out, see prvSwitchThread().  It is non-zero until the first task
+runs so interrupts stay disabled during initialisation. */
+static UBaseType_t uxCriticalNesting = 9999UL;
+
+/* The set that contains only the tick signal. */
+static sigset_t xTickSignalSet;
+
+/* Used by vPortEndScheduler() to wake the thread that started the scheduler. */
+static pthread_mutex_t xSchedulerEndMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xSchedulerEndCondition = PTHREAD_COND_INITIALIZER;
+static BaseType_t xSchedulerEnd = pdFALSE;
+
+/* Initialises xTickSignalSet the first time a task is created. */
+static pthread_once_t xSignalSetOnce = PTHREAD_ONCE_INIT;
+
+/*-----------------------------------------------------------*/
+
+static Thread_t *prvGetThreadFromTask( TaskHandle_t xTask )
+{
+	/* The first member of the TCB is the top of stack, which points to the
+	thread structure. */
+	return ( Thread_t * ) *( ( StackType_t ** ) xTask );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInitialiseSignalSet( void )
+{
+	sigemptyset( &xTickSignalSet );
+	sigaddset( &xTickSignalSet, portTICK_SIGNAL );
+}
+/*-----------------------------------------------------------*/
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+Thread_t *pxThread;
+sigset_t xSavedMask;
+int iResult;
+
+	( void ) pthread_once( &xSignalSetOnce, prvInitialiseSignalSet );
+
+	/* In this simulated case a stack is not initialised, but instead a thread
+	is created that will execute the task being created.  The Thread_t object is
+	placed at the top of the stack that was created for the task. */
+	pxThread = ( Thread_t * ) ( ( ( portPOINTER_SIZE_TYPE ) ( pxTopOfStack + 1 ) - sizeof( Thread_t ) ) &
+								~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK ) );
+	memset( pxThread, 0, sizeof( Thread_t ) );
+
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+	pxThread->xRunning = pdFALSE;
+	pxThread->xDying = pdFALSE;
+	( void ) pthread_mutex_init( &( pxThread->xRunMutex ), NULL );
+	( void ) pthread_cond_init( &( pxThread->xRunCondition ), NULL );
+
+	/* The new thread inherits the signal mask of this one.  Block the tick
+	signal while creating it so the thread cannot take a tick before it runs. */
+	( void ) pthread_sigmask( SIG_BLOCK, &xTickSignalSet, &xSavedMask );
+	iResult = pthread_create( &( pxThread->xThread ), NULL, prvWaitForStart, pxThread );
+	( void ) pthread_sigmask( SIG_SETMASK, &xSavedMask, NULL );
+
+	configASSERT( iResult == 0 );
+	( void ) iResult;
+
+	return ( StackType_t * ) pxThread;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortStartScheduler( void )
+{
+struct sigaction xTickAction;
+Thread_t *pxFirstThread;
+int iResult;
+
+	( void ) pthread_once( &xSignalSetOnce, prvInitialiseSignalSet );
+
+	/* This thread does not run a task, so it never takes the tick signal. */
+	( void ) pthread_sigmask( SIG_BLOCK, &xTickSignalSet, NULL );
+
+	/* Install the tick handler.  System calls interrupted by the tick are
+	restarted when the task runs again, where the host allows it. */
+	memset( &xTickAction, 0, sizeof( xTickAction ) );
+	xTickAction.sa_handler = prvTickSignalHandler;
+	xTickAction.sa_flags = SA_RESTART;
+	sigfillset( &xTickAction.sa_mask );
+	iResult = sigaction( portTICK_SIGNAL, &xTickAction, NULL );
+	configASSERT( iResult == 0 );
+	( void ) iResult;
+
+	prvSetupTimerInterrupt();
+
+	/* Start the first task. */
+	pxFirstThread = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+	prvResumeThread( pxFirstThread );
+
+	/* Wait until vPortEndScheduler() is called. */
+	( void ) pthread_mutex_lock( &xSchedulerEndMutex );
+
+	while( xSchedulerEnd == pdFALSE )
+	{
+		( void ) pthread_cond_wait( &xSchedulerEndCondition, &xSchedulerEndMutex );
+	}
+
+	( void ) pthread_mutex_unlock( &xSchedulerEndMutex );
+
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+struct itimerval xTimer;
+
+	/* Stop the tick. */
+	memset( &xTimer, 0, sizeof( xTimer ) );
+	( void ) setitimer( ITIMER_REAL, &xTimer, NULL );
+
+	/* Let xPortStartScheduler() return in the thread that called it. */
+	( void ) pthread_mutex_lock( &xSchedulerEndMutex );
+	xSchedulerEnd = pdTRUE;
+	( void ) pthread_cond_signal( &xSchedulerEndCondition );
+	( void ) pthread_mutex_unlock( &xSchedulerEndMutex );
+
+	/* No task runs any more, including the one that called this function. */
+	vPortDisableInterrupts();
+	prvSuspendSelf( prvGetThreadFromTask( xTaskGetCurrentTaskHandle() ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+Thread_t *pxThreadToSuspend;
+Thread_t *pxThreadToResume;
+
+	pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+	vTaskSwitchContext();
+	pxThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+	prvSwitchThread( pxThreadToResume, pxThreadToSuspend );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	vPortEnterCritical();
+	vPortYieldFromISR();
+	vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	( void ) pthread_sigmask( SIG_BLOCK, &xTickSignalSet, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	( void ) pthread_sigmask( SIG_UNBLOCK, &xTickSignalSet, NULL );
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t xPortSetInterruptMask( void )
+{
+sigset_t xSavedMask;
+
+	/* Return whether the tick was already blocked, so nested calls restore
+	the state correctly. */
+	( void ) pthread_sigmask( SIG_BLOCK, &xTickSignalSet, &xSavedMask );
+
+	return ( UBaseType_t ) sigismember( &xSavedMask, portTICK_SIGNAL );
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( UBaseType_t uxMask )
+{
+	if( uxMask == 0 )
+	{
+		vPortEnableInterrupts();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	if( uxCriticalNesting == portNO_CRITICAL_NESTING )
+	{
+		vPortDisableInterrupts();
+	}
+
+	uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	uxCriticalNesting--;
+
+	if( uxCriticalNesting == portNO_CRITICAL_NESTING )
+	{
+		vPortEnableInterrupts();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortCloseRunningThread( void *pvTaskToDelete, volatile BaseType_t *pxPendYield )
+{
+Thread_t *pxThread = prvGetThreadFromTask( ( TaskHandle_t ) pvTaskToDelete );
+
+	/* The task is deleting itself.  vTaskDelete() yields after this returns,
+	and the thread exits in prvSwitchThread() instead of waiting to run
+	again.  vPortDeleteThread() then reclaims it from the idle task. */
+	pxThread->xDying = pdTRUE;
+	*pxPendYield = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortDeleteThread( void *pvTaskToDelete )
+{
+Thread_t *pxThread = prvGetThreadFromTask( ( TaskHandle_t ) pvTaskToDelete );
+
+	/* A task deleted by another task is waiting in prvSuspendSelf(), which is
+	a cancellation point.  A task that deleted itself has already exited, and
+	only needs to be joined. */
+	if( pxThread->xDying == pdFALSE )
+	{
+		( void ) pthread_cancel( pxThread->xThread );
+	}
+
+	( void ) pthread_join( pxThread->xThread, NULL );
+
+	( void ) pthread_cond_destroy( &( pxThread->xRunCondition ) );
+	( void ) pthread_mutex_destroy( &( pxThread->xRunMutex ) );
+}
+/*-----------------------------------------------------------*/
+
+static void *prvWaitForStart( void *pvParameters )
+{
+Thread_t *pxThread = ( Thread_t * ) pvParameters;
+
+	prvSuspendSelf( pxThread );
+
+	/* The task runs for the first time, outside of any critical section. */
+	uxCriticalNesting = portNO_CRITICAL_NESTING;
+	vPortEnableInterrupts();
+
+	pxThread->pxCode( pxThread->pvParameters );
+
+	/* Tasks must not return from their implementing function, but a host
+	thread can end cleanly. */
+	vTaskDelete( NULL );
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSwitchThread( Thread_t *pxThreadToResume, Thread_t *pxThreadToSuspend )
+{
+UBaseType_t uxSavedCriticalNesting;
+
+	if( pxThreadToSuspend != pxThreadToResume )
+	{
+		/* The critical nesting count belongs to the task, so keep it on the
+		stack of this thread until the task runs again. */
+		uxSavedCriticalNesting = uxCriticalNesting;
+
+		prvResumeThread( pxThreadToResume );
+
+		if( pxThreadToSuspend->xDying != pdFALSE )
+		{
+			pthread_exit( NULL );
+		}
+
+		prvSuspendSelf( pxThreadToSuspend );
+
+		uxCriticalNesting = uxSavedCriticalNesting;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvResumeThread( Thread_t *pxThread )
+{
+	( void ) pthread_mutex_lock( &( pxThread->xRunMutex ) );
+	pxThread->xRunning = pdTRUE;
+	( void ) pthread_cond_signal( &( pxThread->xRunCondition ) );
+	( void ) pthread_mutex_unlock( &( pxThread->xRunMutex ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUnlockRunMutex( void *pvMutex )
+{
+	( void ) pthread_mutex_unlock( ( pthread_mutex_t * ) pvMutex );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSuspendSelf( Thread_t *pxThread )
+{
+	( void ) pthread_mutex_lock( &( pxThread->xRunMutex ) );
+
+	/* The thread can be cancelled while it waits, see vPortDeleteThread(). */
+	pthread_cleanup_push( prvUnlockRunMutex, &( pxThread->xRunMutex ) );
+
+	while( pxThread->xRunning == pdFALSE )
+	{
+		( void ) pthread_cond_wait( &( pxThread->xRunCondition ), &( pxThread->xRunMutex ) );
+	}
+
+	pxThread->xRunning = pdFALSE;
+
+	pthread_cleanup_pop( 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTickSignalHandler( int iSignal )
+{
+Thread_t *pxThreadToSuspend;
+Thread_t *pxThreadToResume;
+int iSavedErrno = errno;
+
+	( void ) iSignal;
+
+	/* The tick signal is blocked while its handler runs. */
+	uxCriticalNesting++;
+
+	pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+	if( xTaskIncrementTick() != pdFALSE )
+	{
+		vTaskSwitchContext();
+		pxThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+		prvSwitchThread( pxThreadToResume, pxThreadToSuspend );
+	}
+
+	uxCriticalNesting--;
+
+	errno = iSavedErrno;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTimerInterrupt( void )
+{
+struct itimerval xTimer;
+int iResult;
+
+	xTimer.it_interval.tv_sec = 0;
+	xTimer.it_interval.tv_usec = 1000000L / configTICK_RATE_HZ;
+	xTimer.it_value = xTimer.it_interval;
+
+	iResult = setitimer( ITIMER_REAL, &xTimer, NULL );
+	configASSERT( iResult == 0 );
+	( void ) iResult;
+}
+/*-----------------------------------------------------------*/
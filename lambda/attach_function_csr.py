@@ -12,6 +12,12 @@ def create_and_attach(event, context):
     This function creates and attaches a new certificate created
     from a CSR to existing policies and things
 
+    The certificate is always created inactive, even if the request sets
+    'autoActivate'. It only becomes active through the activate request, which
+    the device sends once it has stored the certificate, so a certificate that
+    is never acknowledged is never a live credential. The response reports
+    'activated' as false, and the device falls back to the activate step
+
     :param event: A dictionary sent to the Lambda function
     from the rules engine, taken from the message published by the client
     i.e. {'principal': 'oldCertificateId', 'response': {csr': 'CSR sent'},
@@ -72,6 +78,7 @@ def create_and_attach(event, context):
         message = {'newCertificateArn': new_certificate_arn, 'newCertificateId': new_certificate_id,
                    'newCertificatePem': new_certificate_pem,
                    'oldCertificateId': old_certificate_id,
+                   'activated': certificate_response['activated'],
                    }
 
         logger.info("new certificate information: ARN:{}, ID:{}, and PEM:{}".format(
@@ -93,7 +100,7 @@ def create_and_attach(event, context):
 
 def create_certificate(iot_client, event):
     """
-    Creates a certificate from a CSR
+    Creates an inactive certificate from a CSR
     :param iot_client: the boto client to connect and execute
     :param event: the dictionary sent to Lambda by the Rules
     Engine
@@ -101,11 +108,14 @@ def create_certificate(iot_client, event):
     """
 
     csr_string = event['response']['csr']
+    if event['response'].get('autoActivate') is True:
+        logger.info('autoActivate ignored, the certificate is activated by the activate request')
     response = iot_client.create_certificate_from_csr(
         certificateSigningRequest=csr_string,
         setAsActive=False
     )
-    logger.info('created certificate')
+    response['activated'] = False
+    logger.info('created inactive certificate')
 
     return response
 
@@ -109,6 +109,26 @@ typedef struct P11ObjectList_t
     P11Object_t xObjects[ pkcs11configMAX_NUM_OBJECTS ];
 } P11ObjectList_t;
 
+#if ( pkcs11configMAX_CACHED_KEYS > 0 )
+
+/* A private key that has been read from storage and parsed. */
+    typedef struct P11CachedKey_t
+    {
+        CK_OBJECT_HANDLE xHandle; /* The "PAL Handle" of the key. CK_INVALID_HANDLE if the entry is unused. */
+        uint32_t ulLastUsed;      /* Value of the cache use counter when the key was last used. */
+        mbedtls_pk_context xKey;  /* The parsed key. */
+    } P11CachedKey_t;
+
+/* Parsed private keys shared by all sessions, so that each signature does not
+ * have to read and parse its key again. */
+    typedef struct P11KeyCache_t
+    {
+        SemaphoreHandle_t xMutex; /* Protects the entries. Held while a cached key is used, because mbedTLS keys are not thread safe. */
+        uint32_t ulUseCounter;    /* Incremented on every use, to find the least recently used entry. */
+        P11CachedKey_t xKeys[ pkcs11configMAX_CACHED_KEYS ];
+    } P11KeyCache_t;
+#endif /* if ( pkcs11configMAX_CACHED_KEYS > 0 ) */
+
 /* PKCS #11 Module Object */
 typedef struct P11Struct_t
 {
@@ -117,6 +137,9 @@ typedef struct P11Struct_t
     mbedtls_entropy_context xMbedEntropyContext; /* Entropy context for PKCS #11 module - used to collect entropy for RNG. */
     P11ObjectList_t xObjectList;                 /* List of PKCS #11 objects that have been found/created since module initialization.
                                                   * The array position indicates the "App Handle"  */
+    #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+        P11KeyCache_t xKeyCache;                 /* Parsed signing keys. */
+    #endif
 } P11Struct_t, * P11Context_t;
 
 /* The global PKCS #11 module object.
@@ -140,7 +163,8 @@ typedef struct P11Session
     mbedtls_pk_context xVerifyKey;         /* Verification key.  Set during C_VerifyInit. */
     CK_MECHANISM_TYPE xSignMechanism;      /* Mechanism of the sign operation in progress. Set during C_SignInit. */
     SemaphoreHandle_t xSignMutex;          /* Protects the signing key from being modified while in use. */
-    mbedtls_pk_context xSignKey;           /* Signing key.  Set during C_SignInit. */
+    mbedtls_pk_context xSignKey;           /* Signing key.  Set during C_SignInit when keys are not cached. */
+    CK_OBJECT_HANDLE xSignKeyHandle;       /* "PAL Handle" of the signing key.  Set during C_SignInit. */
     mbedtls_sha256_context xSHA256Context; /* Context for in progress digest operation. */
 } P11Session_t, * P11SessionPtr_t;
 
@@ -198,7 +222,7 @@ static CK_FUNCTION_LIST prvP11FunctionList =
     C_Login, /*C_Login*/
     NULL,    /*C_Logout*/
     C_CreateObject,
-    NULL,    /*C_CopyObject*/
+    C_CopyObject,
     C_DestroyObject,
     NULL,    /*C_GetObjectSize*/
     C_GetAttributeValue,
@@ -265,6 +289,18 @@ CK_RV prvMbedTLS_Initialize( void )
         memset( &xP11Context, 0, sizeof( xP11Context ) );
         xP11Context.xObjectList.xMutex = xSemaphoreCreateMutex();
 
+        #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+            xP11Context.xKeyCache.xMutex = xSemaphoreCreateMutex();
+
+            if( xP11Context.xKeyCache.xMutex == NULL )
+            {
+                xResult = CKR_HOST_MEMORY;
+            }
+        #endif
+    }
+
+    if( xResult == CKR_OK )
+    {
         CRYPTO_Init();
         /* Initialize the entropy source and DRBG for the PKCS#11 module */
         mbedtls_entropy_init( &xP11Context.xMbedEntropyContext );
@@ -462,7 +498,12 @@ CK_RV prvAddObjectToList( CK_OBJECT_HANDLE xPalHandle,
             }
         }
 
-        if( xObjectFound == CK_FALSE )
+        if( xObjectFound == CK_TRUE )
+        {
+            /* The object was replaced in place; its handle is unchanged. */
+            *pxAppHandle = lSearchIndex + 1;
+        }
+        else
         {
             if( lInsertIndex != -1 )
             {
@@ -489,6 +530,172 @@ CK_RV prvAddObjectToList( CK_OBJECT_HANDLE xPalHandle,
     return xResult;
 }
 
+/**
+ * @brief Drops parsed copies of keys from the key cache.
+ *
+ * @param[in] xPalHandle    The PAL handle of the key to drop, or
+ *                          CK_INVALID_HANDLE to drop every cached key.
+ */
+static void prvKeyCacheInvalidate( CK_OBJECT_HANDLE xPalHandle )
+{
+    #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+        P11CachedKey_t * pxEntry = NULL;
+        uint32_t ulIndex = 0;
+
+        if( pdTRUE == xSemaphoreTake( xP11Context.xKeyCache.xMutex, portMAX_DELAY ) )
+        {
+            for( ulIndex = 0; ulIndex < pkcs11configMAX_CACHED_KEYS; ulIndex++ )
+            {
+                pxEntry = &xP11Context.xKeyCache.xKeys[ ulIndex ];
+
+                if( ( pxEntry->xHandle != CK_INVALID_HANDLE ) &&
+                    ( ( xPalHandle == CK_INVALID_HANDLE ) || ( pxEntry->xHandle == xPalHandle ) ) )
+                {
+                    mbedtls_pk_free( &pxEntry->xKey );
+                    pxEntry->xHandle = CK_INVALID_HANDLE;
+                }
+            }
+
+            xSemaphoreGive( xP11Context.xKeyCache.xMutex );
+        }
+    #else
+        ( void ) xPalHandle;
+    #endif /* if ( pkcs11configMAX_CACHED_KEYS > 0 ) */
+}
+
+#if ( pkcs11configMAX_CACHED_KEYS > 0 )
+
+/**
+ * @brief Gets the parsed private key for a PAL handle from the key cache.
+ *
+ * If the key is not cached, it is read from storage and parsed into an unused
+ * or the least recently used entry.
+ *
+ * \warn The key cache mutex must be held while calling this function and while
+ * using the returned key.
+ *
+ * @param[in] xPalHandle    The PAL handle of the private key.
+ * @param[out] ppxKey       Set to the parsed key.
+ *
+ * @return CKR_OK if successful, CKR_KEY_TYPE_INCONSISTENT if the object is not
+ * a private key, CKR_KEY_HANDLE_INVALID if the key cannot be parsed, or the
+ * error returned by PKCS11_PAL_GetObjectValue.
+ */
+    static CK_RV prvKeyCacheGetKey( CK_OBJECT_HANDLE xPalHandle,
+                                    mbedtls_pk_context ** ppxKey )
+    {
+        CK_RV xResult = CKR_OK;
+        P11KeyCache_t * pxCache = &xP11Context.xKeyCache;
+        P11CachedKey_t * pxEntry = NULL;
+        P11CachedKey_t * pxCandidate = NULL;
+        P11CachedKey_t * pxVictim = NULL;
+        uint32_t ulIndex = 0;
+        CK_BBOOL xIsPrivate = CK_TRUE;
+        uint8_t * pucKeyData = NULL;
+        uint32_t ulKeyDataLength = 0;
+
+        pxCache->ulUseCounter++;
+
+        /* Look for the key. Remember the entry to replace if it is not found. */
+        for( ulIndex = 0; ulIndex < pkcs11configMAX_CACHED_KEYS; ulIndex++ )
+        {
+            pxCandidate = &pxCache->xKeys[ ulIndex ];
+
+            if( ( pxCandidate->xHandle != CK_INVALID_HANDLE ) && ( pxCandidate->xHandle == xPalHandle ) )
+            {
+                pxEntry = pxCandidate;
+                break;
+            }
+            else if( ( pxVictim == NULL ) ||
+                     ( ( pxVictim->xHandle != CK_INVALID_HANDLE ) &&
+                       ( ( pxCandidate->xHandle == CK_INVALID_HANDLE ) ||
+                         ( ( pxCache->ulUseCounter - pxCandidate->ulLastUsed ) >
+                           ( pxCache->ulUseCounter - pxVictim->ulLastUsed ) ) ) ) )
+            {
+                pxVictim = pxCandidate;
+            }
+        }
+
+        if( pxEntry == NULL )
+        {
+            xResult = PKCS11_PAL_GetObjectValue( xPalHandle, &pucKeyData, &ulKeyDataLength, &xIsPrivate );
+
+            if( xResult == CKR_OK )
+            {
+                if( xIsPrivate != CK_TRUE )
+                {
+                    PKCS11_PRINT( ( "ERROR: Sign operation attempted with public key. \r\n" ) );
+                    xResult = CKR_KEY_TYPE_INCONSISTENT;
+                }
+                else
+                {
+                    if( pxVictim->xHandle != CK_INVALID_HANDLE )
+                    {
+                        mbedtls_pk_free( &pxVictim->xKey );
+                        pxVictim->xHandle = CK_INVALID_HANDLE;
+                    }
+
+                    mbedtls_pk_init( &pxVictim->xKey );
+
+                    if( 0 != mbedtls_pk_parse_key( &pxVictim->xKey, pucKeyData, ulKeyDataLength, NULL, 0 ) )
+                    {
+                        PKCS11_PRINT( ( "ERROR: Unable to parse private key for signing. \r\n" ) );
+                        mbedtls_pk_free( &pxVictim->xKey );
+                        xResult = CKR_KEY_HANDLE_INVALID;
+                    }
+                    else
+                    {
+                        pxVictim->xHandle = xPalHandle;
+                        pxEntry = pxVictim;
+                    }
+                }
+
+                /* The key has been parsed into the cache.
+                 * Free the memory allocated to copy the key out of flash. */
+                PKCS11_PAL_GetObjectValueCleanup( pucKeyData, ulKeyDataLength );
+            }
+            else
+            {
+                PKCS11_PRINT( ( "ERROR: Unable to retrieve value of private key for signing %d. \r\n", xResult ) );
+            }
+        }
+
+        if( pxEntry != NULL )
+        {
+            pxEntry->ulLastUsed = pxCache->ulUseCounter;
+            *ppxKey = &pxEntry->xKey;
+        }
+
+        return xResult;
+    }
+
+#endif /* if ( pkcs11configMAX_CACHED_KEYS > 0 ) */
+
+/**
+ * @brief Saves an object to NVM and drops any cached copy of the key it replaces.
+ *
+ * Objects are saved through this function so that a cached key never outlives
+ * the object it was parsed from.
+ *
+ * @param[in] pxLabel       Label of the object.
+ * @param[in] pucData       Data of the object.
+ * @param[in] ulDataSize    Size of pucData.
+ *
+ * @return The PAL handle of the object, or CK_INVALID_HANDLE on failure.
+ */
+static CK_OBJECT_HANDLE prvSaveObject( CK_ATTRIBUTE_PTR pxLabel,
+                                       uint8_t * pucData,
+                                       uint32_t ulDataSize )
+{
+    CK_OBJECT_HANDLE xPalHandle = PKCS11_PAL_SaveObject( pxLabel, pucData, ulDataSize );
+
+    /* A failed save may have overwritten part of an existing object, so every
+     * cached key is dropped in that case. */
+    prvKeyCacheInvalidate( xPalHandle );
+
+    return xPalHandle;
+}
+
 #if ( pkcs11configPAL_DESTROY_SUPPORTED != 1 )
 
     CK_RV PKCS11_PAL_DestroyObject( CK_OBJECT_HANDLE xAppHandle )
@@ -709,6 +916,11 @@ CK_DEFINE_FUNCTION( CK_RV, C_Finalize )( CK_VOID_PTR pvReserved )
 
         vSemaphoreDelete( xP11Context.xObjectList.xMutex );
 
+        #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+            prvKeyCacheInvalidate( CK_INVALID_HANDLE );
+            vSemaphoreDelete( xP11Context.xKeyCache.xMutex );
+        #endif
+
         xP11Context.xIsInitialized = CK_FALSE;
     }
 
@@ -1084,8 +1296,100 @@ CK_DEFINE_FUNCTION( CK_RV, C_Login )( CK_SESSION_HANDLE hSession,
     return CKR_OK;
 }
 
+/* Returns the offset of pcNeedle in the first xLength bytes of pucBuffer,
+ * or xLength if it is not there.  The buffer need not be zero terminated. */
+static size_t prvFindInBuffer( const CK_BYTE * pucBuffer,
+                               size_t xLength,
+                               const char * pcNeedle )
+{
+    size_t xNeedleLength = strlen( pcNeedle );
+    size_t xOffset = 0;
+
+    for( xOffset = 0; xOffset + xNeedleLength <= xLength; xOffset++ )
+    {
+        if( memcmp( pucBuffer + xOffset, pcNeedle, xNeedleLength ) == 0 )
+        {
+            return xOffset;
+        }
+    }
+
+    return xLength;
+}
+
+/* Helper to convert a PEM certificate to DER for storage.  The Base64 body
+ * is decoded straight into a buffer of the exact DER size, which the caller
+ * frees with vPortFree. */
+CK_RV prvCertificatePemToDer( const CK_BYTE * pucPem,
+                              size_t xPemLength,
+                              CK_BYTE_PTR * ppucDer,
+                              size_t * pxDerLength )
+{
+    CK_RV xResult = CKR_OK;
+    size_t xBegin = 0;
+    size_t xEnd = 0;
+
+    *ppucDer = NULL;
+    *pxDerLength = 0;
+
+    /* Skip past the "-----BEGIN CERTIFICATE-----" line to the Base64 body. */
+    xBegin = prvFindInBuffer( pucPem, xPemLength, "-----BEGIN" ) + 10;
+
+    while( ( xBegin < xPemLength ) && ( pucPem[ xBegin ] != '-' ) )
+    {
+        xBegin++;
+    }
+
+    while( ( xBegin < xPemLength ) && ( pucPem[ xBegin ] == '-' ) )
+    {
+        xBegin++;
+    }
+
+    if( xBegin < xPemLength )
+    {
+        xEnd = xBegin + prvFindInBuffer( pucPem + xBegin, xPemLength - xBegin, "-----END" );
+    }
+
+    if( ( xBegin >= xPemLength ) || ( xEnd >= xPemLength ) )
+    {
+        xResult = CKR_ATTRIBUTE_VALUE_INVALID;
+    }
+
+    /* The first pass only sizes the output. */
+    if( ( xResult == CKR_OK ) &&
+        ( mbedtls_base64_decode( NULL, 0, pxDerLength, pucPem + xBegin, xEnd - xBegin ) ==
+          MBEDTLS_ERR_BASE64_INVALID_CHARACTER ) )
+    {
+        xResult = CKR_ATTRIBUTE_VALUE_INVALID;
+    }
+
+    if( xResult == CKR_OK )
+    {
+        *ppucDer = pvPortMalloc( *pxDerLength );
+
+        if( *ppucDer == NULL )
+        {
+            xResult = CKR_HOST_MEMORY;
+        }
+    }
+
+    if( ( xResult == CKR_OK ) &&
+        ( mbedtls_base64_decode( *ppucDer, *pxDerLength, pxDerLength, pucPem + xBegin, xEnd - xBegin ) != 0 ) )
+    {
+        xResult = CKR_ATTRIBUTE_VALUE_INVALID;
+    }
+
+    if( ( xResult != CKR_OK ) && ( *ppucDer != NULL ) )
+    {
+        vPortFree( *ppucDer );
+        *ppucDer = NULL;
+    }
+
+    return xResult;
+}
+
 /* Helper function for parsing the templates of device certificates for
- * C_CreateObject. */
+ * C_CreateObject.  The certificate value may be DER, or PEM which is
+ * converted to DER before it is stored. */
 CK_RV prvCreateCertificate( CK_ATTRIBUTE_PTR pxTemplate,
                             CK_ULONG ulCount,
                             CK_OBJECT_HANDLE_PTR pxObject )
@@ -1099,6 +1403,8 @@ CK_RV prvCreateCertificate( CK_ATTRIBUTE_PTR pxTemplate,
     uint32_t ulIndex = 0;
     CK_BBOOL xBool = CK_FALSE;
     CK_ATTRIBUTE xAttribute;
+    CK_BYTE_PTR pucDerCertificate = NULL;
+    size_t xDerLength = 0;
 
     /* Search for the pointer to the certificate VALUE. */
     for( ulIndex = 0; ulIndex < ulCount; ulIndex++ )
@@ -1163,9 +1469,24 @@ CK_RV prvCreateCertificate( CK_ATTRIBUTE_PTR pxTemplate,
         xResult = CKR_TEMPLATE_INCOMPLETE;
     }
 
+    /* 0x2d is '-' as in -----BEGIN CERTIFICATE-----; DER starts with a SEQUENCE tag. */
+    if( ( xResult == CKR_OK ) && ( xCertificateLength > 0 ) && ( pxCertificateValue[ 0 ] == 0x2d ) )
+    {
+        xResult = prvCertificatePemToDer( pxCertificateValue,
+                                          xCertificateLength,
+                                          &pucDerCertificate,
+                                          &xDerLength );
+
+        if( xResult == CKR_OK )
+        {
+            pxCertificateValue = pucDerCertificate;
+            xCertificateLength = ( CK_ULONG ) xDerLength;
+        }
+    }
+
     if( xResult == CKR_OK )
     {
-        xPalHandle = PKCS11_PAL_SaveObject( pxLabel, pxCertificateValue, xCertificateLength );
+        xPalHandle = prvSaveObject( pxLabel, pxCertificateValue, xCertificateLength );
 
         if( xPalHandle == 0 ) /*Invalid handle. */
         {
@@ -1179,6 +1500,11 @@ CK_RV prvCreateCertificate( CK_ATTRIBUTE_PTR pxTemplate,
         /* TODO: If this fails, should the object be wiped back out of flash?  But what if that fails?!?!? */
     }
 
+    if( pucDerCertificate != NULL )
+    {
+        vPortFree( pucDerCertificate );
+    }
+
     return xResult;
 }
 
@@ -1675,9 +2001,9 @@ CK_RV prvCreatePrivateKey( CK_ATTRIBUTE_PTR pxTemplate,
     /* Save the object to device NVM. */
     if( xResult == CKR_OK )
     {
-        xPalHandle = PKCS11_PAL_SaveObject( pxLabel,
-                                            pxDerKey + ( MAX_LENGTH_KEY - lDerKeyLength ),
-                                            lActualKeyLength );
+        xPalHandle = prvSaveObject( pxLabel,
+                                    pxDerKey + ( MAX_LENGTH_KEY - lDerKeyLength ),
+                                    lActualKeyLength );
 
         if( xPalHandle == 0 )
         {
@@ -1894,9 +2220,9 @@ CK_RV prvCreatePublicKey( CK_ATTRIBUTE_PTR pxTemplate,
 
     if( xResult == CKR_OK )
     {
-        xPalHandle = PKCS11_PAL_SaveObject( pxLabel,
-                                            pxDerKey + ( MAX_LENGTH_KEY - lDerKeyLength ),
-                                            lDerKeyLength );
+        xPalHandle = prvSaveObject( pxLabel,
+                                    pxDerKey + ( MAX_LENGTH_KEY - lDerKeyLength ),
+                                    lDerKeyLength );
 
         if( xPalHandle == CK_INVALID_HANDLE )
         {
@@ -1936,7 +2262,7 @@ CK_RV prvCreatePublicKey( CK_ATTRIBUTE_PTR pxTemplate,
  * <tr>                              <td>CKA_TOKEN
  * <tr>                              <td>CKA_LABEL
  * <tr>                              <td>CKA_CERTIFICATE_TYPE
- * <tr>                              <td>CKA_VALUE
+ * <tr>                              <td>CKA_VALUE (DER, or PEM which is stored as DER)
  * <tr><td rowspan="7">EC Private Key<td>CKA_CLASS
  * <tr>                              <td>CKA_KEY_TYPE
  * <tr>                              <td>CKA_TOKEN
@@ -2038,6 +2364,109 @@ CK_DEFINE_FUNCTION( CK_RV, C_DestroyObject )( CK_SESSION_HANDLE xSession,
     if( xResult == CKR_OK )
     {
         xResult = PKCS11_PAL_DestroyObject( xObject );
+
+        /* Some ports destroy both TLS keys at once, so drop every cached key
+         * rather than only the one that was destroyed. */
+        prvKeyCacheInvalidate( CK_INVALID_HANDLE );
+    }
+
+    return xResult;
+}
+
+/**
+ * @brief Copy an object to another label.
+ *
+ * The copy has the value of the object, and is stored by the PAL under the
+ * label in the template, replacing an object that had that label. The value
+ * is copied inside the module, so a private key can be moved to another
+ * label without leaving the token.
+ *
+ * @param[in] xSession                   Handle of a valid PKCS #11 session.
+ * @param[in] xObject                    Handle of the object to be copied.
+ * @param[in] pxTemplate                 Attributes of the copy. It must hold
+ *                                       exactly one attribute, CKA_LABEL, and
+ *                                       the label must be supported by the
+ *                                       port's PKCS #11 PAL.
+ * @param[in] ulCount                    The number of attributes in the template.
+ * @param[out] pxNewObject               Set to the handle of the copy.
+ *
+ * \warn Ports that store the device public and private key in the same slot
+ * copy the whole key pair, whichever of the two keys is copied.
+ *
+ * @return CKR_OK if successful.
+ * Else, see <a href="https://tiny.amazon.com/wtscrttv">PKCS #11 specification</a>
+ * for more information.
+ */
+CK_DEFINE_FUNCTION( CK_RV, C_CopyObject )( CK_SESSION_HANDLE xSession,
+                                           CK_OBJECT_HANDLE xObject,
+                                           CK_ATTRIBUTE_PTR pxTemplate,
+                                           CK_ULONG ulCount,
+                                           CK_OBJECT_HANDLE_PTR pxNewObject )
+{
+    CK_RV xResult = PKCS11_SESSION_VALID_AND_MODULE_INITIALIZED( xSession );
+    CK_OBJECT_HANDLE xPalHandle = CK_INVALID_HANDLE;
+    CK_OBJECT_HANDLE xNewPalHandle = CK_INVALID_HANDLE;
+    uint8_t * pcLabel = NULL;
+    size_t xLabelLength = 0;
+    uint8_t * pucData = NULL;
+    uint32_t ulDataLength = 0;
+    CK_BBOOL xIsPrivate = CK_TRUE;
+    CK_BBOOL xFreeMemory = CK_FALSE;
+
+    if( ( xResult == CKR_OK ) &&
+        ( ( pxTemplate == NULL ) || ( pxNewObject == NULL ) ) )
+    {
+        xResult = CKR_ARGUMENTS_BAD;
+    }
+
+    if( ( xResult == CKR_OK ) &&
+        ( ( ulCount != 1 ) ||
+          ( pxTemplate[ 0 ].type != CKA_LABEL ) ||
+          ( pxTemplate[ 0 ].pValue == NULL ) ||
+          ( pxTemplate[ 0 ].ulValueLen == 0 ) ) )
+    {
+        PKCS11_PRINT( ( "ERROR: Only the label of a copy can be set. \r\n" ) );
+        xResult = CKR_TEMPLATE_INCONSISTENT;
+    }
+
+    if( xResult == CKR_OK )
+    {
+        prvFindObjectInListByHandle( xObject, &xPalHandle, &pcLabel, &xLabelLength );
+
+        if( pcLabel == NULL )
+        {
+            xResult = CKR_OBJECT_HANDLE_INVALID;
+        }
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = PKCS11_PAL_GetObjectValue( xPalHandle, &pucData, &ulDataLength, &xIsPrivate );
+
+        if( xResult == CKR_OK )
+        {
+            xFreeMemory = CK_TRUE;
+        }
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xNewPalHandle = prvSaveObject( pxTemplate, pucData, ulDataLength );
+
+        if( xNewPalHandle == CK_INVALID_HANDLE )
+        {
+            xResult = CKR_DEVICE_MEMORY;
+        }
+    }
+
+    if( xResult == CKR_OK )
+    {
+        xResult = prvAddObjectToList( xNewPalHandle, pxNewObject, pxTemplate[ 0 ].pValue, pxTemplate[ 0 ].ulValueLen );
+    }
+
+    if( xFreeMemory == CK_TRUE )
+    {
+        PKCS11_PAL_GetObjectValueCleanup( pucData, ulDataLength );
     }
 
     return xResult;
@@ -2821,17 +3250,22 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
                                          CK_OBJECT_HANDLE xKey )
 {
     CK_RV xResult = PKCS11_SESSION_VALID_AND_MODULE_INITIALIZED( xSession );
-    CK_BBOOL xIsPrivate = CK_TRUE;
-    CK_BBOOL xCleanupNeeded = CK_FALSE;
-    CK_OBJECT_HANDLE xPalHandle;
+    CK_OBJECT_HANDLE xPalHandle = CK_INVALID_HANDLE;
     uint8_t * pxLabel = NULL;
     size_t xLabelLength = 0;
     mbedtls_pk_type_t xKeyType;
 
     /*lint !e9072 It's OK to have different parameter name. */
     P11SessionPtr_t pxSession = prvSessionPointerFromHandle( xSession );
-    uint8_t * keyData = NULL;
-    uint32_t ulKeyDataLength = 0;
+
+    #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+        mbedtls_pk_context * pxKey = NULL;
+    #else
+        CK_BBOOL xIsPrivate = CK_TRUE;
+        CK_BBOOL xCleanupNeeded = CK_FALSE;
+        uint8_t * keyData = NULL;
+        uint32_t ulKeyDataLength = 0;
+    #endif
 
     if( NULL == pxMechanism )
     {
@@ -2839,7 +3273,6 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
         xResult = CKR_ARGUMENTS_BAD;
     }
 
-    /* Retrieve key value from storage. */
     if( xResult == CKR_OK )
     {
         prvFindObjectInListByHandle( xKey,
@@ -2847,7 +3280,36 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
                                      &pxLabel,
                                      &xLabelLength );
 
-        if( xPalHandle != CK_INVALID_HANDLE )
+        if( xPalHandle == CK_INVALID_HANDLE )
+        {
+            xResult = CKR_KEY_HANDLE_INVALID;
+        }
+    }
+
+    #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+        /* Parse the key into the key cache, unless an earlier sign operation
+         * already did. */
+        if( xResult == CKR_OK )
+        {
+            if( pdTRUE == xSemaphoreTake( xP11Context.xKeyCache.xMutex, portMAX_DELAY ) )
+            {
+                xResult = prvKeyCacheGetKey( xPalHandle, &pxKey );
+
+                if( xResult == CKR_OK )
+                {
+                    xKeyType = mbedtls_pk_get_type( pxKey );
+                }
+
+                xSemaphoreGive( xP11Context.xKeyCache.xMutex );
+            }
+            else
+            {
+                xResult = CKR_CANT_LOCK;
+            }
+        }
+    #else /* if ( pkcs11configMAX_CACHED_KEYS > 0 ) */
+        /* Retrieve key value from storage. */
+        if( xResult == CKR_OK )
         {
             xResult = PKCS11_PAL_GetObjectValue( xPalHandle, &keyData, &ulKeyDataLength, &xIsPrivate );
 
@@ -2860,64 +3322,61 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
                 PKCS11_PRINT( ( "ERROR: Unable to retrieve value of private key for signing %d. \r\n", xResult ) );
             }
         }
-        else
-        {
-            xResult = CKR_KEY_HANDLE_INVALID;
-        }
-    }
 
-    /* Check that a private key was retrieved. */
-    if( xResult == CKR_OK )
-    {
-        if( xIsPrivate != CK_TRUE )
+        /* Check that a private key was retrieved. */
+        if( xResult == CKR_OK )
         {
-            PKCS11_PRINT( ( "ERROR: Sign operation attempted with public key. \r\n" ) );
-            xResult = CKR_KEY_TYPE_INCONSISTENT;
+            if( xIsPrivate != CK_TRUE )
+            {
+                PKCS11_PRINT( ( "ERROR: Sign operation attempted with public key. \r\n" ) );
+                xResult = CKR_KEY_TYPE_INCONSISTENT;
+            }
         }
-    }
 
-    /* Convert the private key from storage format to mbedTLS usable format. */
-    if( xResult == CKR_OK )
-    {
-        /* Grab the sign mutex.  This ensures that no signing operation
-         * is underway on another thread where modification of key would lead to hard fault.*/
-        if( pdTRUE == xSemaphoreTake( pxSession->xSignMutex, portMAX_DELAY ) )
+        /* Convert the private key from storage format to mbedTLS usable format. */
+        if( xResult == CKR_OK )
         {
-            /* Free the private key context if it exists.
-             * TODO: Check if the key is the same as was used previously. */
-            if( NULL != pxSession->xSignKey.pk_ctx )
+            /* Grab the sign mutex.  This ensures that no signing operation
+             * is underway on another thread where modification of key would lead to hard fault.*/
+            if( pdTRUE == xSemaphoreTake( pxSession->xSignMutex, portMAX_DELAY ) )
             {
-                mbedtls_pk_free( &pxSession->xSignKey );
-            }
+                /* Free the private key context if it exists. */
+                if( NULL != pxSession->xSignKey.pk_ctx )
+                {
+                    mbedtls_pk_free( &pxSession->xSignKey );
+                }
 
-            mbedtls_pk_init( &pxSession->xSignKey );
+                mbedtls_pk_init( &pxSession->xSignKey );
 
-            if( 0 != mbedtls_pk_parse_key( &pxSession->xSignKey, keyData, ulKeyDataLength, NULL, 0 ) )
+                if( 0 != mbedtls_pk_parse_key( &pxSession->xSignKey, keyData, ulKeyDataLength, NULL, 0 ) )
+                {
+                    PKCS11_PRINT( ( "ERROR: Unable to parse private key for signing. \r\n" ) );
+                    xResult = CKR_KEY_HANDLE_INVALID;
+                }
+                else
+                {
+                    xKeyType = mbedtls_pk_get_type( &pxSession->xSignKey );
+                }
+
+                xSemaphoreGive( pxSession->xSignMutex );
+            }
+            else
             {
-                PKCS11_PRINT( ( "ERROR: Unable to parse private key for signing. \r\n" ) );
-                xResult = CKR_KEY_HANDLE_INVALID;
+                xResult = CKR_CANT_LOCK;
             }
-
-            xSemaphoreGive( pxSession->xSignMutex );
         }
-        else
+
+        /* Key has been parsed into mbedTLS pk structure.
+         * Free the memory allocated to copy the key out of flash. */
+        if( xCleanupNeeded == CK_TRUE )
         {
-            xResult = CKR_CANT_LOCK;
+            PKCS11_PAL_GetObjectValueCleanup( keyData, ulKeyDataLength );
         }
-    }
-
-    /* Key has been parsed into mbedTLS pk structure.
-     * Free the memory allocated to copy the key out of flash. */
-    if( xCleanupNeeded == CK_TRUE )
-    {
-        PKCS11_PAL_GetObjectValueCleanup( keyData, ulKeyDataLength );
-    }
+    #endif /* if ( pkcs11configMAX_CACHED_KEYS > 0 ) */
 
     /* Check that the mechanism and key type are compatible, supported. */
     if( xResult == CKR_OK )
     {
-        xKeyType = mbedtls_pk_get_type( &pxSession->xSignKey );
-
         if( pxMechanism->mechanism == CKM_RSA_PKCS )
         {
             if( xKeyType != MBEDTLS_PK_RSA )
@@ -2944,6 +3403,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_SignInit )( CK_SESSION_HANDLE xSession,
     if( xResult == CKR_OK )
     {
         pxSession->xSignMechanism = pxMechanism->mechanism;
+        pxSession->xSignKeyHandle = xPalHandle;
     }
 
     return xResult;
@@ -2994,6 +3454,8 @@ CK_DEFINE_FUNCTION( CK_RV, C_Sign )( CK_SESSION_HANDLE xSession,
     CK_BBOOL xSignatureGenerated = CK_FALSE;
     uint8_t ecSignature[ pkcs11ECDSA_P256_SIGNATURE_LENGTH + 15 ]; /*TODO: Figure out this length. */
     int lMbedTLSResult;
+    SemaphoreHandle_t xSignMutex = NULL;
+    mbedtls_pk_context * pxSignKey = NULL;
 
     if( ( NULL == pulSignatureLen ) || ( NULL == pucData ) )
     {
@@ -3044,25 +3506,44 @@ CK_DEFINE_FUNCTION( CK_RV, C_Sign )( CK_SESSION_HANDLE xSession,
             /* Sign the data.*/
             if( CKR_OK == xResult )
             {
-                if( pdTRUE == xSemaphoreTake( pxSessionObj->xSignMutex, portMAX_DELAY ) )
+                /* Cached keys are shared by all sessions, so signing with one
+                 * is serialized by the key cache mutex instead of the session's
+                 * sign mutex. */
+                #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+                    xSignMutex = xP11Context.xKeyCache.xMutex;
+                #else
+                    xSignMutex = pxSessionObj->xSignMutex;
+                    pxSignKey = &pxSessionObj->xSignKey;
+                #endif
+
+                if( pdTRUE == xSemaphoreTake( xSignMutex, portMAX_DELAY ) )
                 {
-                    lMbedTLSResult = mbedtls_pk_sign( &pxSessionObj->xSignKey,
-                                                      MBEDTLS_MD_NONE,
-                                                      pucData,
-                                                      ulDataLen,
-                                                      pxSignatureBuffer,
-                                                      ( size_t * ) &xExpectedInputLength,
-                                                      mbedtls_ctr_drbg_random,
-                                                      &xP11Context.xMbedDrbgCtx );
-
-                    if( lMbedTLSResult != CKR_OK )
+                    #if ( pkcs11configMAX_CACHED_KEYS > 0 )
+                        /* Reloads the key if it was evicted or replaced since C_SignInit. */
+                        xResult = prvKeyCacheGetKey( pxSessionObj->xSignKeyHandle, &pxSignKey );
+                    #endif
+
+                    if( xResult == CKR_OK )
                     {
-                        PKCS11_PRINT( ( "mbedTLS sign failed with error %d \r\n", lMbedTLSResult ) );
-                        xResult = CKR_FUNCTION_FAILED;
+                        lMbedTLSResult = mbedtls_pk_sign( pxSignKey,
+                                                          MBEDTLS_MD_NONE,
+                                                          pucData,
+                                                          ulDataLen,
+                                                          pxSignatureBuffer,
+                                                          ( size_t * ) &xExpectedInputLength,
+                                                          mbedtls_ctr_drbg_random,
+                                                          &xP11Context.xMbedDrbgCtx );
+
+                        if( lMbedTLSResult != CKR_OK )
+                        {
+                            PKCS11_PRINT( ( "mbedTLS sign failed with error %d \r\n", lMbedTLSResult ) );
+                            xResult = CKR_FUNCTION_FAILED;
+                        }
+
+                        xSignatureGenerated = CK_TRUE;
                     }
 
-                    xSemaphoreGive( pxSessionObj->xSignMutex );
-                    xSignatureGenerated = CK_TRUE;
+                    xSemaphoreGive( xSignMutex );
                 }
                 else
                 {
@@ -3221,7 +3702,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_VerifyInit )( CK_SESSION_HANDLE xSession,
     /* Check that the mechanism and key type are compatible, supported. */
     if( xResult == CKR_OK )
     {
-        xKeyType = mbedtls_pk_get_type( &pxSession->xSignKey );
+        xKeyType = mbedtls_pk_get_type( &pxSession->xVerifyKey );
 
         if( pxMechanism->mechanism == CKM_RSA_X_509 )
         {
@@ -3725,7 +4206,7 @@ CK_DEFINE_FUNCTION( CK_RV, C_GenerateKeyPair )( CK_SESSION_HANDLE xSession,
 
     if( lMbedResult > 0 )
     {
-        xPalPublic = PKCS11_PAL_SaveObject( pxPublicLabel, pucDerFile + pkcs11KEY_GEN_MAX_DER_SIZE - lMbedResult, lMbedResult );
+        xPalPublic = prvSaveObject( pxPublicLabel, pucDerFile + pkcs11KEY_GEN_MAX_DER_SIZE - lMbedResult, lMbedResult );
     }
     else
     {
@@ -3739,14 +4220,21 @@ CK_DEFINE_FUNCTION( CK_RV, C_GenerateKeyPair )( CK_SESSION_HANDLE xSession,
 
     if( lMbedResult > 0 )
     {
-        xPalPrivate = PKCS11_PAL_SaveObject( pxPrivateLabel, pucDerFile + pkcs11KEY_GEN_MAX_DER_SIZE - lMbedResult, lMbedResult ); /* TS-7249. */
+        xPalPrivate = prvSaveObject( pxPrivateLabel, pucDerFile + pkcs11KEY_GEN_MAX_DER_SIZE - lMbedResult, lMbedResult ); /* TS-7249. */
     }
     else
     {
         xResult = CKR_GENERAL_ERROR;
     }
 
-    if( ( xPalPublic != CK_INVALID_HANDLE ) && ( xPalPrivate != CK_INVALID_HANDLE ) )
+    /* The PAL does not store objects with a label it does not know. */
+    if( ( xResult == CKR_OK ) &&
+        ( ( xPalPublic == CK_INVALID_HANDLE ) || ( xPalPrivate == CK_INVALID_HANDLE ) ) )
+    {
+        xResult = CKR_DEVICE_MEMORY;
+    }
+
+    if( xResult == CKR_OK )
     {
         xResult = prvAddObjectToList( xPalPrivate, pxPrivateKey, pxPrivateLabel->pValue, pxPrivateLabel->ulValueLen );
 
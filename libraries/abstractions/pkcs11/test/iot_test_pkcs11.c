@@ -54,6 +54,16 @@
 
 #include "iot_pkcs11_config.h"
 
+/* Number of sign operations timed by AFQP_SignPerformance. */
+#ifndef pkcs11testSIGN_PERFORMANCE_LOOP_COUNT
+    #define pkcs11testSIGN_PERFORMANCE_LOOP_COUNT    ( 20 )
+#endif
+
+/* Set to 1 in iot_test_pkcs11_config.h if C_CreateObject stores a PEM certificate value as DER. */
+#ifndef pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT
+    #define pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT    ( 0 )
+#endif
+
 /* Test includes. */
 #include "unity_fixture.h"
 #include "unity.h"
@@ -279,10 +289,17 @@ TEST_GROUP_RUNNER( Full_PKCS11_EC )
             RUN_TEST_CASE( Full_PKCS11_EC, AFQP_FindObject );
             RUN_TEST_CASE( Full_PKCS11_EC, AFQP_GetAttributeValue );
             RUN_TEST_CASE( Full_PKCS11_EC, AFQP_Sign );
+            RUN_TEST_CASE( Full_PKCS11_EC, AFQP_SignPerformance );
+            RUN_TEST_CASE( Full_PKCS11_EC, AFQP_SignAfterKeyReplaced );
             RUN_TEST_CASE( Full_PKCS11_EC, AFQP_Verify );
         #endif
 
         RUN_TEST_CASE( Full_PKCS11_EC, AFQP_CreateObjectDestroyObjectCertificates );
+
+        #if ( pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT == 1 )
+            RUN_TEST_CASE( Full_PKCS11_EC, AFQP_CreateObjectPemCertificateTwice );
+        #endif
+
         RUN_TEST_CASE( Full_PKCS11_EC, AFQP_GenerateKeyPair );
         RUN_TEST_CASE( Full_PKCS11_EC, AFQP_GetAttributeValueMultiThread );
         RUN_TEST_CASE( Full_PKCS11_EC, AFQP_FindObjectMultiThread );
@@ -1303,6 +1320,11 @@ static const char cValidECDSACertificate[] =
 
 
 
+extern int convert_pem_to_der( const unsigned char * pucInput,
+                               size_t xLen,
+                               unsigned char * pucOutput,
+                               size_t * pxOlen );
+
 void prvProvisionCredentialsWithKeyImport( CK_OBJECT_HANDLE_PTR pxPrivateKeyHandle,
                                            CK_OBJECT_HANDLE_PTR pxCertificateHandle,
                                            CK_OBJECT_HANDLE_PTR pxPublicKeyHandle )
@@ -1513,6 +1535,86 @@ TEST( Full_PKCS11_EC, AFQP_CreateObjectDestroyObjectCertificates )
     #endif /* if ( pkcs11configJITP_CODEVERIFY_ROOT_CERT_SUPPORTED == 1 ) */
 }
 
+#if ( pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT == 1 )
+
+/* A rotated certificate is stored by handing the PEM to C_CreateObject under the label of the
+ * one it replaces. The object must keep its handle and hold the DER of the certificate. */
+    TEST( Full_PKCS11_EC, AFQP_CreateObjectPemCertificateTwice )
+    {
+        CK_RV xResult;
+        CK_OBJECT_HANDLE xFirstHandle = CK_INVALID_HANDLE;
+        CK_OBJECT_HANDLE xSecondHandle = CK_INVALID_HANDLE;
+        CK_OBJECT_HANDLE xFoundHandle = CK_INVALID_HANDLE;
+        PKCS11_CertificateTemplate_t xCertificateTemplate;
+        CK_OBJECT_CLASS xCertificateClass = CKO_CERTIFICATE;
+        CK_CERTIFICATE_TYPE xCertificateType = CKC_X_509;
+        CK_BBOOL xTokenStorage = CK_TRUE;
+        CK_BYTE xSubject[] = "TestSubject";
+        CK_ATTRIBUTE xTemplate;
+        CK_BYTE xCertificateValueExpected[ 626 ];
+        CK_BYTE xCertificateValue[ 626 ];
+        size_t xLength = sizeof( xCertificateValueExpected );
+        int lConversionReturn;
+
+        lConversionReturn = convert_pem_to_der( ( const unsigned char * ) cValidECDSACertificate,
+                                                sizeof( cValidECDSACertificate ),
+                                                xCertificateValueExpected,
+                                                &xLength );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lConversionReturn, "Failed to convert the EC certificate from PEM to DER." );
+
+        xCertificateTemplate.xObjectClass.type = CKA_CLASS;
+        xCertificateTemplate.xObjectClass.pValue = &xCertificateClass;
+        xCertificateTemplate.xObjectClass.ulValueLen = sizeof( xCertificateClass );
+        xCertificateTemplate.xSubject.type = CKA_SUBJECT;
+        xCertificateTemplate.xSubject.pValue = xSubject;
+        xCertificateTemplate.xSubject.ulValueLen = strlen( ( const char * ) xSubject );
+        xCertificateTemplate.xValue.type = CKA_VALUE;
+        xCertificateTemplate.xValue.pValue = ( CK_VOID_PTR ) cValidECDSACertificate;
+        xCertificateTemplate.xValue.ulValueLen = sizeof( cValidECDSACertificate );
+        xCertificateTemplate.xLabel.type = CKA_LABEL;
+        xCertificateTemplate.xLabel.pValue = ( CK_VOID_PTR ) pkcs11testLABEL_DEVICE_CERTIFICATE_FOR_TLS;
+        xCertificateTemplate.xLabel.ulValueLen = strlen( pkcs11testLABEL_DEVICE_CERTIFICATE_FOR_TLS );
+        xCertificateTemplate.xCertificateType.type = CKA_CERTIFICATE_TYPE;
+        xCertificateTemplate.xCertificateType.pValue = &xCertificateType;
+        xCertificateTemplate.xCertificateType.ulValueLen = sizeof( xCertificateType );
+        xCertificateTemplate.xTokenObject.type = CKA_TOKEN;
+        xCertificateTemplate.xTokenObject.pValue = &xTokenStorage;
+        xCertificateTemplate.xTokenObject.ulValueLen = sizeof( xTokenStorage );
+
+        xResult = pxGlobalFunctionList->C_CreateObject( xGlobalSession,
+                                                        ( CK_ATTRIBUTE_PTR ) &xCertificateTemplate,
+                                                        sizeof( xCertificateTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        &xFirstHandle );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to create EC certificate from PEM." );
+        TEST_ASSERT_NOT_EQUAL_MESSAGE( CK_INVALID_HANDLE, xFirstHandle, "Invalid object handle returned for EC certificate." );
+
+        /* Importing the same certificate under the same label replaces it in place. */
+        xResult = pxGlobalFunctionList->C_CreateObject( xGlobalSession,
+                                                        ( CK_ATTRIBUTE_PTR ) &xCertificateTemplate,
+                                                        sizeof( xCertificateTemplate ) / sizeof( CK_ATTRIBUTE ),
+                                                        &xSecondHandle );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to create EC certificate from PEM a second time." );
+        TEST_ASSERT_EQUAL_MESSAGE( xFirstHandle, xSecondHandle, "Handle of the EC certificate changed when it was imported again." );
+
+        xResult = xFindObjectWithLabelAndClass( xGlobalSession, pkcs11testLABEL_DEVICE_CERTIFICATE_FOR_TLS, CKO_CERTIFICATE, &xFoundHandle );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to find EC certificate." );
+        TEST_ASSERT_EQUAL_MESSAGE( xFirstHandle, xFoundHandle, "Found a different handle for the EC certificate." );
+
+        /* The stored value is the DER of the certificate, not the PEM. */
+        xTemplate.type = CKA_VALUE;
+        xTemplate.pValue = NULL;
+        xTemplate.ulValueLen = 0;
+        xResult = pxGlobalFunctionList->C_GetAttributeValue( xGlobalSession, xFirstHandle, &xTemplate, 1 );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "GetAttributeValue for length of EC certificate value failed." );
+        TEST_ASSERT_EQUAL_MESSAGE( xLength, xTemplate.ulValueLen, "Incorrect EC certificate value length." );
+
+        xTemplate.pValue = xCertificateValue;
+        xResult = pxGlobalFunctionList->C_GetAttributeValue( xGlobalSession, xFirstHandle, &xTemplate, 1 );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "GetAttributeValue for EC certificate value failed." );
+        TEST_ASSERT_EQUAL_INT8_ARRAY_MESSAGE( xCertificateValueExpected, xCertificateValue, xLength, "Incorrect EC certificate value stored." );
+    }
+#endif /* if ( pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT == 1 ) */
+
 TEST( Full_PKCS11_EC, AFQP_Sign )
 {
     CK_RV xResult;
@@ -1569,6 +1671,191 @@ TEST( Full_PKCS11_EC, AFQP_Sign )
     mbedtls_pk_free( &xEcdsaContext );
 }
 
+/*
+ * Times the PKCS #11 work of a TLS client handshake: a session is opened,
+ * the device key is used for one ECDSA signature, and the session is closed.
+ * Build with pkcs11configMAX_CACHED_KEYS set to 0 to compare against parsing
+ * the key on every handshake.
+ */
+TEST( Full_PKCS11_EC, AFQP_SignPerformance )
+{
+    CK_RV xResult;
+    CK_OBJECT_HANDLE xPrivateKeyHandle;
+    CK_OBJECT_HANDLE xPublicKeyHandle;
+    CK_OBJECT_HANDLE xCertificateHandle;
+    CK_SLOT_ID_PTR pxSlotId = NULL;
+    CK_SLOT_ID xSlotId = 0;
+    CK_ULONG xSlotCount = 0;
+    CK_SESSION_HANDLE xSession = 0;
+    /* Note that ECDSA operations on a signature of all 0's is not permitted. */
+    CK_BYTE xHashedMessage[ pkcs11SHA256_DIGEST_LENGTH ] = { 0xab };
+    CK_MECHANISM xMechanism;
+    CK_BYTE xSignature[ pkcs11RSA_2048_SIGNATURE_LENGTH ] = { 0 };
+    CK_ULONG xSignatureLength;
+    TickType_t xStartTime;
+    TickType_t xElapsedTime;
+    uint32_t ulIteration;
+
+    prvProvisionCredentialsWithKeyImport( &xPrivateKeyHandle, &xCertificateHandle, &xPublicKeyHandle );
+
+    xResult = xGetSlotList( &pxSlotId, &xSlotCount );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to get slot list" );
+    xSlotId = pxSlotId[ pkcs11testSLOT_NUMBER ];
+    vPortFree( pxSlotId ); /* xGetSlotList allocates memory. */
+
+    xMechanism.mechanism = CKM_ECDSA;
+    xMechanism.pParameter = NULL;
+    xMechanism.ulParameterLen = 0;
+
+    xStartTime = xTaskGetTickCount();
+
+    for( ulIteration = 0; ulIteration < pkcs11testSIGN_PERFORMANCE_LOOP_COUNT; ulIteration++ )
+    {
+        xResult = pxGlobalFunctionList->C_OpenSession( xSlotId,
+                                                       CKF_SERIAL_SESSION,
+                                                       NULL,
+                                                       NULL,
+                                                       &xSession );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to open session" );
+
+        xResult = pxGlobalFunctionList->C_SignInit( xSession, &xMechanism, xPrivateKeyHandle );
+
+        if( xResult == CKR_OK )
+        {
+            xSignatureLength = sizeof( xSignature );
+            xResult = pxGlobalFunctionList->C_Sign( xSession, xHashedMessage, pkcs11SHA256_DIGEST_LENGTH, xSignature, &xSignatureLength );
+        }
+
+        ( void ) pxGlobalFunctionList->C_CloseSession( xSession );
+        TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to ECDSA Sign." );
+    }
+
+    xElapsedTime = xTaskGetTickCount() - xStartTime;
+
+    if( xElapsedTime == 0 )
+    {
+        xElapsedTime = 1;
+    }
+
+    configPRINTF( ( "%d sign operations in %d ms (%d per second), pkcs11configMAX_CACHED_KEYS %d \r\n",
+                    pkcs11testSIGN_PERFORMANCE_LOOP_COUNT,
+                    xElapsedTime * portTICK_PERIOD_MS,
+                    ( pkcs11testSIGN_PERFORMANCE_LOOP_COUNT * configTICK_RATE_HZ ) / xElapsedTime,
+                    pkcs11configMAX_CACHED_KEYS ) );
+}
+
+/*
+ * 1. Signs with the imported device key, so that the key is cached
+ * 2. Replaces the device key pair with a generated one under the same labels
+ * 3. Signs again with the private key found by label, in a new session
+ * 4. Verifies the signature with the new public key, and checks that the old
+ *    key does not verify it, so a stale cached key would be detected
+ */
+TEST( Full_PKCS11_EC, AFQP_SignAfterKeyReplaced )
+{
+    CK_RV xResult;
+    CK_OBJECT_HANDLE xPrivateKeyHandle;
+    CK_OBJECT_HANDLE xPublicKeyHandle;
+    CK_OBJECT_HANDLE xCertificateHandle;
+    /* Note that ECDSA operations on a signature of all 0's is not permitted. */
+    CK_BYTE xHashedMessage[ pkcs11SHA256_DIGEST_LENGTH ] = { 0xab };
+    CK_MECHANISM xMechanism;
+    CK_BYTE xSignature[ pkcs11RSA_2048_SIGNATURE_LENGTH ] = { 0 };
+    CK_BYTE xEcPoint[ 256 ] = { 0 };
+    CK_ULONG xSignatureLength;
+    CK_ATTRIBUTE xTemplate;
+    /* mbedTLS structures for verification. */
+    int lMbedTLSResult;
+    mbedtls_ecdsa_context xEcdsaContext;
+    mbedtls_pk_context xOldKeyContext;
+    mbedtls_ecp_keypair * pxOldKey;
+    mbedtls_mpi xR;
+    mbedtls_mpi xS;
+
+    prvProvisionCredentialsWithKeyImport( &xPrivateKeyHandle, &xCertificateHandle, &xPublicKeyHandle );
+
+    xMechanism.mechanism = CKM_ECDSA;
+    xMechanism.pParameter = NULL;
+    xMechanism.ulParameterLen = 0;
+    xResult = pxGlobalFunctionList->C_SignInit( xGlobalSession, &xMechanism, xPrivateKeyHandle );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to SignInit ECDSA." );
+
+    xSignatureLength = sizeof( xSignature );
+    xResult = pxGlobalFunctionList->C_Sign( xGlobalSession, xHashedMessage, pkcs11SHA256_DIGEST_LENGTH, xSignature, &xSignatureLength );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to ECDSA Sign with the imported key." );
+
+    /* Replace the key pair under the same labels. */
+    xCurrentCredentials = eNone;
+    xResult = xProvisionGenerateKeyPairEC( xGlobalSession,
+                                           ( uint8_t * ) pkcs11testLABEL_DEVICE_PRIVATE_KEY_FOR_TLS,
+                                           ( uint8_t * ) pkcs11testLABEL_DEVICE_PUBLIC_KEY_FOR_TLS,
+                                           &xPrivateKeyHandle,
+                                           &xPublicKeyHandle );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Generating EC key pair failed." );
+
+    xTemplate.type = CKA_EC_POINT;
+    xTemplate.pValue = xEcPoint;
+    xTemplate.ulValueLen = sizeof( xEcPoint );
+    xResult = pxGlobalFunctionList->C_GetAttributeValue( xGlobalSession, xPublicKeyHandle, &xTemplate, 1 );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to retrieve EC Point." );
+
+    /* Sign in a new session, with the private key found by its label. */
+    xResult = pxGlobalFunctionList->C_CloseSession( xGlobalSession );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Error closing session after replacing the key pair." );
+    xResult = xInitializePkcs11Session( &xGlobalSession );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Error re-opening session after replacing the key pair." );
+
+    xResult = xFindObjectWithLabelAndClass( xGlobalSession, pkcs11testLABEL_DEVICE_PRIVATE_KEY_FOR_TLS, CKO_PRIVATE_KEY, &xPrivateKeyHandle );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Error finding replaced private key." );
+    TEST_ASSERT_NOT_EQUAL_MESSAGE( CK_INVALID_HANDLE, xPrivateKeyHandle, "Invalid private key handle found." );
+
+    xResult = pxGlobalFunctionList->C_SignInit( xGlobalSession, &xMechanism, xPrivateKeyHandle );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to SignInit ECDSA." );
+
+    xSignatureLength = sizeof( xSignature );
+    xResult = pxGlobalFunctionList->C_Sign( xGlobalSession, xHashedMessage, pkcs11SHA256_DIGEST_LENGTH, xSignature, &xSignatureLength );
+    TEST_ASSERT_EQUAL_MESSAGE( CKR_OK, xResult, "Failed to ECDSA Sign with the replaced key." );
+
+    mbedtls_ecdsa_init( &xEcdsaContext );
+    mbedtls_pk_init( &xOldKeyContext );
+    mbedtls_mpi_init( &xR );
+    mbedtls_mpi_init( &xS );
+
+    if( TEST_PROTECT() )
+    {
+        /* C_Sign returns the R & S components one after another. */
+        lMbedTLSResult = mbedtls_mpi_read_binary( &xR, &xSignature[ 0 ], 32 );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "mbedTLS failed in setup for signature verification." );
+        lMbedTLSResult = mbedtls_mpi_read_binary( &xS, &xSignature[ 32 ], 32 );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "mbedTLS failed in setup for signature verification." );
+
+        /* The first 2 bytes are for ASN1 type/length encoding. */
+        lMbedTLSResult = mbedtls_ecp_group_load( &xEcdsaContext.grp, MBEDTLS_ECP_DP_SECP256R1 );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "mbedTLS failed in setup for signature verification." );
+        lMbedTLSResult = mbedtls_ecp_point_read_binary( &xEcdsaContext.grp, &xEcdsaContext.Q, &xEcPoint[ 2 ], xTemplate.ulValueLen - 2 );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "mbedTLS failed in setup for signature verification." );
+
+        lMbedTLSResult = mbedtls_ecdsa_verify( &xEcdsaContext.grp, xHashedMessage, sizeof( xHashedMessage ), &xEcdsaContext.Q, &xR, &xS );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "The new public key did not verify the signature." );
+
+        lMbedTLSResult = mbedtls_pk_parse_key( &xOldKeyContext,
+                                               ( const unsigned char * ) cValidECDSAPrivateKey,
+                                               sizeof( cValidECDSAPrivateKey ),
+                                               NULL,
+                                               0 );
+        TEST_ASSERT_EQUAL_MESSAGE( 0, lMbedTLSResult, "mbedTLS failed to parse the imported ECDSA private key." );
+
+        pxOldKey = ( mbedtls_ecp_keypair * ) xOldKeyContext.pk_ctx;
+        lMbedTLSResult = mbedtls_ecdsa_verify( &pxOldKey->grp, xHashedMessage, sizeof( xHashedMessage ), &pxOldKey->Q, &xR, &xS );
+        TEST_ASSERT_NOT_EQUAL_MESSAGE( 0, lMbedTLSResult, "The signature was made with the replaced key." );
+    }
+
+    mbedtls_mpi_free( &xR );
+    mbedtls_mpi_free( &xS );
+    mbedtls_pk_free( &xOldKeyContext );
+    mbedtls_ecdsa_free( &xEcdsaContext );
+}
+
 /*
  * 1. Generates an Elliptic Curve P256 key pair
  * 2. Calls GetAttributeValue to check generated key attirbutes
@@ -1827,11 +2114,6 @@ TEST( Full_PKCS11_EC, AFQP_FindObject )
     prvFindObjectTest();
 }
 
-extern int convert_pem_to_der( const unsigned char * pucInput,
-                               size_t xLen,
-                               unsigned char * pucOutput,
-                               size_t * pxOlen );
-
 TEST( Full_PKCS11_EC, AFQP_GetAttributeValue )
 {
     CK_RV xResult;
@@ -107,7 +107,8 @@ const IotNetworkInterface_t IotNetworkAfr =
     .send               = IotNetworkAfr_Send,
     .receive            = IotNetworkAfr_Receive,
     .close              = IotNetworkAfr_Close,
-    .destroy            = IotNetworkAfr_Destroy
+    .destroy            = IotNetworkAfr_Destroy,
+    .receiveUpto        = IotNetworkAfr_ReceiveUpto
 };
 
 /*-----------------------------------------------------------*/
@@ -569,6 +570,61 @@ size_t IotNetworkAfr_Receive( void * pConnection,
 
 /*-----------------------------------------------------------*/
 
+size_t IotNetworkAfr_ReceiveUpto( void * pConnection,
+                                  uint8_t * pBuffer,
+                                  size_t bufferSize )
+{
+    int32_t socketStatus = 0;
+    size_t bytesReceived = 0;
+
+    /* Cast network connection to the correct type. */
+    _networkConnection_t * pNetworkConnection = ( _networkConnection_t * ) pConnection;
+
+    /* Return the buffered byte by itself. Secure Sockets cannot tell whether
+     * more data is available, so a receive now could wait for the socket
+     * timeout. THIS IS A TEMPORARY WORKAROUND AND ASSUMES THIS FUNCTION IS
+     * ALWAYS CALLED FROM THE RECEIVE CALLBACK. */
+    if( pNetworkConnection->bufferedByteValid == true )
+    {
+        *pBuffer = pNetworkConnection->bufferedByte;
+        bytesReceived = 1;
+        pNetworkConnection->bufferedByteValid = false;
+    }
+    else
+    {
+        /* Block until some data is available. Secure Sockets returns the data
+         * that is available, up to the buffer size. */
+        do
+        {
+            socketStatus = SOCKETS_Recv( pNetworkConnection->socket,
+                                         pBuffer,
+                                         bufferSize,
+                                         0 );
+
+            /* The return value EWOULDBLOCK means no data was received within
+             * the socket timeout. Ignore it and try again. */
+        } while( socketStatus == SOCKETS_EWOULDBLOCK );
+
+        if( socketStatus <= 0 )
+        {
+            IotLogError( "Error %ld while receiving data.", ( long int ) socketStatus );
+        }
+        else
+        {
+            bytesReceived = ( size_t ) socketStatus;
+
+            configASSERT( bytesReceived <= bufferSize );
+
+            IotLogDebug( "Successfully received %lu bytes.",
+                         ( unsigned long ) bytesReceived );
+        }
+    }
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
 IotNetworkError_t IotNetworkAfr_Close( void * pConnection )
 {
     int32_t socketStatus = SOCKETS_ERROR_NONE;
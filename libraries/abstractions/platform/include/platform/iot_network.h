@@ -73,6 +73,8 @@ typedef enum IotNetworkError
  * @function_brief{platform_network_function_close}
  * - @function_name{platform_network_function_destroy}
  * @function_brief{platform_network_function_destroy}
+ * - @function_name{platform_network_function_receiveupto}
+ * @function_brief{platform_network_function_receiveupto}
  * - @function_name{platform_network_function_receivecallback}
  * @function_brief{platform_network_function_receivecallback}
  */
@@ -96,6 +98,9 @@ typedef enum IotNetworkError
  * @function_page{IotNetworkInterface_t::destroy,platform_network,destroy}
  * @function_snippet{platform_network,destroy,this}
  * @copydoc IotNetworkInterface_t::destroy
+ * @function_page{IotNetworkInterface_t::receiveUpto,platform_network,receiveupto}
+ * @function_snippet{platform_network,receiveupto,this}
+ * @copydoc IotNetworkInterface_t::receiveUpto
  * @function_page{IotNetworkReceiveCallback_t,platform_network,receivecallback}
  * @function_snippet{platform_network,receivecallback,this}
  * @copydoc IotNetworkReceiveCallback_t
@@ -253,6 +258,32 @@ typedef struct IotNetworkInterface
     /* @[declare_platform_network_destroy] */
     IotNetworkError_t ( * destroy )( void * pConnection );
     /* @[declare_platform_network_destroy] */
+
+    /**
+     * @brief Receive the network data that is already available, up to a
+     * buffer size.
+     *
+     * Unlike @ref platform_network_function_receive, this function does not
+     * wait for a fixed number of bytes. It waits only until at least 1 byte
+     * is available, then places as much of the available data as fits into
+     * `pBuffer`. This lets a caller drain several small messages with one call.
+     *
+     * This function is optional and may be `NULL`. Callers must fall back to
+     * @ref platform_network_function_receive when it is not provided.
+     *
+     * @param[in] pConnection The connection to receive from, defined by the
+     * network stack.
+     * @param[out] pBuffer Where to place the incoming network data.
+     * @param[in] bufferSize The size of `pBuffer`.
+     *
+     * @return The number of bytes placed in `pBuffer`, between `1` and
+     * `bufferSize`. `0` indicates an error.
+     */
+    /* @[declare_platform_network_receiveupto] */
+    size_t ( * receiveUpto )( void * pConnection,
+                              uint8_t * pBuffer,
+                              size_t bufferSize );
+    /* @[declare_platform_network_receiveupto] */
 } IotNetworkInterface_t;
 
 /**
@@ -69,8 +69,12 @@
  * @function_brief{taskpool_function_schedule}
  * - @function_name{taskpool_function_scheduledeferred}
  * @function_brief{taskpool_function_scheduledeferred}
+ * - @function_name{taskpool_function_scheduledeferredwithflags}
+ * @function_brief{taskpool_function_scheduledeferredwithflags}
  * - @function_name{taskpool_function_getstatus}
  * @function_brief{taskpool_function_getstatus}
+ * - @function_name{taskpool_function_getstatistics}
+ * @function_brief{taskpool_function_getstatistics}
  * - @function_name{taskpool_function_trycancel}
  * @function_brief{taskpool_function_trycancel}
  * - @function_name{taskpool_function_getjobstoragefromhandle}
@@ -113,9 +117,15 @@
  * @function_page{IotTaskPool_ScheduleDeferred,taskpool,scheduledeferred}
  * @function_snippet{taskpool,scheduledeferred,this}
  * @copydoc IotTaskPool_ScheduleDeferred
+ * @function_page{IotTaskPool_ScheduleDeferredWithFlags,taskpool,scheduledeferredwithflags}
+ * @function_snippet{taskpool,scheduledeferredwithflags,this}
+ * @copydoc IotTaskPool_ScheduleDeferredWithFlags
  * @function_page{IotTaskPool_GetStatus,taskpool,getstatus}
  * @function_snippet{taskpool,getstatus,this}
  * @copydoc IotTaskPool_GetStatus
+ * @function_page{IotTaskPool_GetStatistics,taskpool,getstatistics}
+ * @function_snippet{taskpool,getstatistics,this}
+ * @copydoc IotTaskPool_GetStatistics
  * @function_page{IotTaskPool_TryCancel,taskpool,trycancel}
  * @function_snippet{taskpool,trycancel,this}
  * @copydoc IotTaskPool_TryCancel
@@ -377,7 +387,9 @@ IotTaskPoolError_t IotTaskPool_RecycleJob( IotTaskPool_t taskPool,
  * @param[in] taskPool A handle to the task pool that must have been previously initialized with.
  * a call to @ref IotTaskPool_Create.
  * @param[in] job A job to schedule for execution. This must be first initialized with a call to @ref IotTaskPool_CreateJob.
- * @param[in] flags Flags to be passed by the user, e.g. to identify the job as high priority by specifying #IOT_TASKPOOL_JOB_HIGH_PRIORITY.
+ * @param[in] flags Flags to be passed by the user, e.g. to identify the job as high priority by specifying #IOT_TASKPOOL_JOB_HIGH_PRIORITY,
+ * or to select the lane of the job with #IOT_TASKPOOL_JOB_LANE_HIGH or #IOT_TASKPOOL_JOB_LANE_LOW. Jobs scheduled without a lane
+ * flag are queued in the normal lane.
  *
  * @return One of the following:
  * - #IOT_TASKPOOL_SUCCESS
@@ -490,6 +502,36 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPool,
                                                  uint32_t timeMs );
 /* @[declare_taskpool_scheduledeferred] */
 
+/**
+ * @brief This function schedules a job created with @ref IotTaskPool_CreateJob against the task pool
+ * pointed to by `taskPool` to be executed after a user-defined time interval, in the lane selected by `flags`.
+ *
+ * This function behaves as @ref IotTaskPool_ScheduleDeferred, and passes `flags` to the task pool
+ * when the time interval expires, as @ref IotTaskPool_Schedule would.
+ *
+ * @param[in] taskPool A handle to the task pool that must have been previously initialized with.
+ * a call to @ref IotTaskPool_Create.
+ * @param[in] job A job to schedule for execution. This must be first initialized with a call to @ref IotTaskPool_CreateJob.
+ * @param[in] timeMs The time in milliseconds to wait before scheduling the job.
+ * @param[in] flags The same flags accepted by @ref IotTaskPool_Schedule.
+ *
+ * @return One of the following:
+ * - #IOT_TASKPOOL_SUCCESS
+ * - #IOT_TASKPOOL_BAD_PARAMETER
+ * - #IOT_TASKPOOL_ILLEGAL_OPERATION
+ * - #IOT_TASKPOOL_SHUTDOWN_IN_PROGRESS
+ *
+ * @warning The `taskPool` used in this function should be the same
+ * used to create the job pointed to by `job`, or the results will be undefined.
+ *
+ */
+/* @[declare_taskpool_scheduledeferredwithflags] */
+IotTaskPoolError_t IotTaskPool_ScheduleDeferredWithFlags( IotTaskPool_t taskPool,
+                                                          IotTaskPoolJob_t job,
+                                                          uint32_t timeMs,
+                                                          uint32_t flags );
+/* @[declare_taskpool_scheduledeferredwithflags] */
+
 /**
  * @brief This function retrieves the current status of a job.
  *
@@ -512,6 +554,25 @@ IotTaskPoolError_t IotTaskPool_GetStatus( IotTaskPool_t taskPool,
                                           IotTaskPoolJobStatus_t * const pStatus );
 /* @[declare_taskpool_getstatus] */
 
+/**
+ * @brief This function retrieves the queue depth and wait time statistics of each lane of a task pool.
+ *
+ * @param[in] taskPool A handle to the task pool that must have been previously initialized with
+ * a call to @ref IotTaskPool_Create or @ref IotTaskPool_CreateSystemTaskPool.
+ * @param[out] pStatistics The statistics of the task pool.
+ *
+ * @return One of the following:
+ * - #IOT_TASKPOOL_SUCCESS
+ * - #IOT_TASKPOOL_BAD_PARAMETER
+ * - #IOT_TASKPOOL_SHUTDOWN_IN_PROGRESS
+ *
+ * @note The statistics are accumulated from the creation of the task pool.
+ */
+/* @[declare_taskpool_getstatistics] */
+IotTaskPoolError_t IotTaskPool_GetStatistics( IotTaskPool_t taskPool,
+                                              IotTaskPoolStatistics_t * const pStatistics );
+/* @[declare_taskpool_getstatistics] */
+
 /**
  * @brief This function tries to cancel a job that was previously scheduled with @ref IotTaskPool_Schedule.
  *
@@ -601,4 +662,32 @@ const char * IotTaskPool_strerror( IotTaskPoolError_t status );
     #define IOT_TASKPOOL_JOB_WAIT_TIMEOUT_MS    ( 60 * 1000UL )
 #endif
 
+/**
+ * @brief Set to 1 to keep deferred jobs in a hierarchical timer wheel instead of a sorted list.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL
+    #define IOT_TASKPOOL_TIMER_WHEEL    ( 0 )
+#endif
+
+/**
+ * @brief The resolution of the timer wheel in milliseconds. Deferred jobs run at most one tick late.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL_TICK_MS
+    #define IOT_TASKPOOL_TIMER_WHEEL_TICK_MS    ( 10UL )
+#endif
+
+/**
+ * @brief The number of levels of the timer wheel.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL_LEVELS
+    #define IOT_TASKPOOL_TIMER_WHEEL_LEVELS    ( 4UL )
+#endif
+
+/**
+ * @brief The base 2 logarithm of the number of slots in each level of the timer wheel.
+ */
+#ifndef IOT_TASKPOOL_TIMER_WHEEL_SLOT_BITS
+    #define IOT_TASKPOOL_TIMER_WHEEL_SLOT_BITS    ( 4UL )
+#endif
+
 #endif /* ifndef IOT_TASKPOOL_H_ */
@@ -217,8 +217,37 @@
  * A macros to manage task pool memory allocation.
  */
 #define IOT_TASK_POOL_INTERNAL_STATIC    ( ( uint32_t ) 0x00000001 )      /* Flag to mark a job as user-allocated. */
+#define IOT_TASK_POOL_INTERNAL_LANE_SHIFT    ( 8 )                           /* Position of the lane of a queued job in the job flags. */
+#define IOT_TASK_POOL_INTERNAL_LANE_MASK     ( ( uint32_t ) 0x00000300 )     /* Mask of the lane of a queued job in the job flags. */
 /** @endcond */
 
+/**
+ * @brief The number of times in a row a non-empty lane may be passed over in favor of a
+ * higher lane before its oldest job is dispatched anyway.
+ *
+ * This bounds the starvation of the normal and low lanes when the high lane is busy.
+ */
+#ifndef IOT_TASKPOOL_LANE_BYPASS_LIMIT
+    #define IOT_TASKPOOL_LANE_BYPASS_LIMIT    ( 8 )
+#endif
+
+/**
+ * @brief One dispatch lane of a task pool, with its statistics.
+ *
+ * @warning This is a system-level data type that should not be modified or used directly in any application.
+ * @warning This is a system-level data type that can and will change across different versions of the platform, with no regards for backward compatibility.
+ *
+ */
+typedef struct _taskPoolLane
+{
+    IotDeQueue_t queue;   /**< @brief The queue for the jobs of this lane waiting to be executed. */
+    uint32_t depth;       /**< @brief The number of jobs in the queue. */
+    uint32_t maxDepth;    /**< @brief The largest value of depth. */
+    uint32_t dispatched;  /**< @brief The number of jobs taken from the queue by a worker. */
+    uint64_t totalWaitMs; /**< @brief The sum of the wait times of the dispatched jobs. */
+    uint32_t maxWaitMs;   /**< @brief The longest wait time of a dispatched job. */
+} _taskPoolLane_t;
+
 /**
  * @brief Task pool jobs cache.
  *
@@ -233,6 +262,34 @@ typedef struct _taskPoolCache
     uint32_t freeCount;       /**< @brief A counter to track the number of jobs in the cache. */
 } _taskPoolCache_t;
 
+#if IOT_TASKPOOL_TIMER_WHEEL == 1
+
+/**
+ * @brief The number of slots in each level of the timer wheel.
+ */
+    #define IOT_TASKPOOL_TIMER_WHEEL_SLOTS    ( 1UL << IOT_TASKPOOL_TIMER_WHEEL_SLOT_BITS )
+
+/**
+ * @brief Hierarchical timer wheel for deferred jobs.
+ *
+ * Level 0 has one slot per tick. Each slot of level `n` covers all the slots of level `n - 1`,
+ * and is moved down one level when the wheel reaches it. Timer events due beyond the
+ * last level are kept in the last slot they can reach and placed again when it is moved.
+ *
+ * @warning This is a system-level data type that should not be modified or used directly in any application.
+ * @warning This is a system-level data type that can and will change across different versions of the platform, with no regards for backward compatibility.
+ *
+ */
+    typedef struct _taskPoolTimerWheel
+    {
+        IotListDouble_t slots[ IOT_TASKPOOL_TIMER_WHEEL_LEVELS ][ IOT_TASKPOOL_TIMER_WHEEL_SLOTS ]; /**< @brief The timer events of each slot of each level. */
+        IotListDouble_t expired;                                                                  /**< @brief The timer events due, waiting to be dispatched. */
+        uint64_t nextTick;                                                                        /**< @brief The next tick to process. */
+        uint64_t armedTimeMs;                                                                     /**< @brief When the timer is armed to fire, or UINT64_MAX. */
+        uint32_t count;                                                                           /**< @brief The number of timer events in the slots. */
+    } _taskPoolTimerWheel_t;
+#endif /* if IOT_TASKPOOL_TIMER_WHEEL == 1 */
+
 /**
  * @brief The task pool data structure keeps track of the internal state and the signals for the dispatcher threads.
  * The task pool is a thread safe data structure.
@@ -243,8 +300,13 @@ typedef struct _taskPoolCache
  */
 typedef struct _taskPool
 {
-    IotDeQueue_t dispatchQueue;      /**< @brief The queue for the jobs waiting to be executed. */
-    IotListDouble_t timerEventsList; /**< @brief The timeouts queue for all deferred jobs waiting to be executed. */
+    _taskPoolLane_t lanes[ IOT_TASKPOOL_LANE_COUNT ]; /**< @brief The lanes for the jobs waiting to be executed. */
+    uint32_t bypassCount;                             /**< @brief The number of dispatches in a row that passed over a waiting lower lane. */
+    #if IOT_TASKPOOL_TIMER_WHEEL == 1
+        _taskPoolTimerWheel_t timerWheel; /**< @brief The timer wheel for all deferred jobs waiting to be executed. */
+    #else
+        IotListDouble_t timerEventsList;  /**< @brief The timeouts queue for all deferred jobs waiting to be executed. */
+    #endif
     _taskPoolCache_t jobsCache;      /**< @brief A cache to re-use jobs in order to limit memory allocations. */
     uint32_t minThreads;             /**< @brief The minimum number of threads for the task pool. */
     uint32_t maxThreads;             /**< @brief The maximum number of threads for the task pool. */
@@ -267,11 +329,13 @@ typedef struct _taskPool
  */
 typedef struct _taskPoolJob
 {
-    IotLink_t link;                    /**< @brief The link to insert the job in the dispatch queue. */
-    IotTaskPoolRoutine_t userCallback; /**< @brief The user provided callback. */
-    void * pUserContext;               /**< @brief The user provided context. */
-    uint32_t flags;                    /**< @brief Internal flags. */
-    IotTaskPoolJobStatus_t status;     /**< @brief The status for the job. */
+    IotLink_t link;                           /**< @brief The link to insert the job in the dispatch queue. */
+    IotTaskPoolRoutine_t userCallback;        /**< @brief The user provided callback. */
+    void * pUserContext;                      /**< @brief The user provided context. */
+    uint32_t flags;                           /**< @brief Internal flags. */
+    IotTaskPoolJobStatus_t status;            /**< @brief The status for the job. */
+    uint32_t queuedTimeMs;                    /**< @brief The time the job was queued in its lane. */
+    struct _taskPoolTimerEvent * pTimerEvent; /**< @brief The timer event of a deferred job. */
 } _taskPoolJob_t;
 
 /**
@@ -285,6 +349,7 @@ typedef struct _taskPoolTimerEvent
     IotLink_t link;          /**< @brief List link member. */
     uint64_t expirationTime; /**< @brief When this event should be processed. */
     _taskPoolJob_t * pJob;   /**< @brief The task pool job associated with this event. */
+    uint32_t flags;          /**< @brief The scheduling flags of the job. */
 } _taskPoolTimerEvent_t;
 
 #endif /* ifndef IOT_TASKPOOL_INTERNAL_H_ */
@@ -196,6 +196,38 @@ typedef enum IotTaskPoolJobStatus
     IOT_TASKPOOL_STATUS_UNDEFINED,
 } IotTaskPoolJobStatus_t;
 
+/**
+ * @ingroup taskpool_datatypes_enums
+ * @brief Dispatch lanes of a task pool.
+ *
+ * Worker threads take jobs from the high lane first, then the normal lane,
+ * then the low lane. A job is placed in a lane with the flags passed to
+ * @ref IotTaskPool_Schedule.
+ */
+typedef enum IotTaskPoolLane
+{
+    /**
+     * @brief Lane for jobs scheduled with #IOT_TASKPOOL_JOB_LANE_HIGH or
+     * #IOT_TASKPOOL_JOB_HIGH_PRIORITY.
+     */
+    IOT_TASKPOOL_LANE_HIGH = 0,
+
+    /**
+     * @brief Lane for jobs scheduled without a lane flag.
+     */
+    IOT_TASKPOOL_LANE_NORMAL,
+
+    /**
+     * @brief Lane for jobs scheduled with #IOT_TASKPOOL_JOB_LANE_LOW.
+     */
+    IOT_TASKPOOL_LANE_LOW,
+
+    /**
+     * @brief Number of lanes.
+     */
+    IOT_TASKPOOL_LANE_COUNT
+} IotTaskPoolLane_t;
+
 /*------------------------- Task pool types and handles --------------------------*/
 
 /**
@@ -231,6 +263,8 @@ typedef struct IotTaskPoolJobStorage
     void * dummy3;                 /**< @brief Placeholder. */
     uint32_t dummy4;               /**< @brief Placeholder. */
     IotTaskPoolJobStatus_t status; /**< @brief Placeholder. */
+    uint32_t dummy6;               /**< @brief Placeholder. */
+    void * dummy7;                 /**< @brief Placeholder. */
 } IotTaskPoolJobStorage_t;
 
 /**
@@ -291,6 +325,33 @@ typedef struct IotTaskPoolInfo
     int32_t priority;    /**< @brief priority for every task pool thread. The priority for each thread is fixed after the task pool is created and cannot be changed. */
 } IotTaskPoolInfo_t;
 
+/**
+ * @ingroup taskpool_datatypes_paramstructs
+ * @brief Statistics of one dispatch lane of a task pool.
+ *
+ * The wait time of a job is the time between the moment it is queued in the
+ * lane and the moment a worker thread takes it from the lane.
+ */
+typedef struct IotTaskPoolLaneStatistics
+{
+    uint32_t depth;       /**< @brief Number of jobs waiting in the lane. */
+    uint32_t maxDepth;    /**< @brief Largest number of jobs that waited in the lane at the same time. */
+    uint32_t dispatched;  /**< @brief Number of jobs taken from the lane by a worker thread. */
+    uint64_t totalWaitMs; /**< @brief Sum of the wait times of the dispatched jobs, in milliseconds. */
+    uint32_t maxWaitMs;   /**< @brief Longest wait time of a dispatched job, in milliseconds. */
+} IotTaskPoolLaneStatistics_t;
+
+/**
+ * @ingroup taskpool_datatypes_paramstructs
+ * @brief Statistics of a task pool, as returned by @ref taskpool_function_getstatistics.
+ */
+typedef struct IotTaskPoolStatistics
+{
+    IotTaskPoolLaneStatistics_t lanes[ IOT_TASKPOOL_LANE_COUNT ]; /**< @brief Statistics of each lane, indexed by #IotTaskPoolLane_t. */
+    uint32_t activeThreads;                                       /**< @brief Number of worker threads. */
+    uint32_t activeJobs;                                          /**< @brief Number of jobs waiting or executing. */
+} IotTaskPoolStatistics_t;
+
 /*------------------------- TASKPOOL defined constants --------------------------*/
 
 /**
@@ -339,7 +400,7 @@ typedef struct IotTaskPoolInfo
 /** @brief Initializer for a #IotTaskPool_t. */
 #define IOT_TASKPOOL_INITIALIZER                NULL
 /** @brief Initializer for a #IotTaskPoolJobStorage_t. */
-#define IOT_TASKPOOL_JOB_STORAGE_INITIALIZER    { { NULL, NULL }, NULL, NULL, 0, IOT_TASKPOOL_STATUS_UNDEFINED }
+#define IOT_TASKPOOL_JOB_STORAGE_INITIALIZER    { { NULL, NULL }, NULL, NULL, 0, IOT_TASKPOOL_STATUS_UNDEFINED, 0, NULL }
 /** @brief Initializer for a #IotTaskPoolJob_t. */
 #define IOT_TASKPOOL_JOB_INITIALIZER            NULL
 /* @[define_taskpool_initializers] */
@@ -353,6 +414,22 @@ typedef struct IotTaskPoolInfo
  */
 #define IOT_TASKPOOL_JOB_HIGH_PRIORITY    ( ( uint32_t ) 0x00000001 )
 
+/**
+ * @brief Flag for scheduling a job in the high lane of the task pool.
+ *
+ * Jobs in the high lane are dispatched before the jobs of the other lanes. Unlike
+ * #IOT_TASKPOOL_JOB_HIGH_PRIORITY, this flag never creates a worker.
+ */
+#define IOT_TASKPOOL_JOB_LANE_HIGH        ( ( uint32_t ) 0x00000002 )
+
+/**
+ * @brief Flag for scheduling a job in the low lane of the task pool.
+ *
+ * Jobs in the low lane are dispatched after the jobs of the other lanes. This flag
+ * cannot be combined with #IOT_TASKPOOL_JOB_HIGH_PRIORITY or #IOT_TASKPOOL_JOB_LANE_HIGH.
+ */
+#define IOT_TASKPOOL_JOB_LANE_LOW         ( ( uint32_t ) 0x00000004 )
+
 /**
  * @brief Allows the use of the handle to the system task pool.
  *
@@ -76,7 +76,15 @@
  * the system libraries as well. The system task pool needs to be initialized before any library is used or
  * before any code that posts jobs to the task pool runs.
  */
-_taskPool_t _IotSystemTaskPool = { .dispatchQueue = IOT_DEQUEUE_INITIALIZER };
+_taskPool_t _IotSystemTaskPool =
+{
+    .lanes =
+    {
+        { .queue = IOT_DEQUEUE_INITIALIZER },
+        { .queue = IOT_DEQUEUE_INITIALIZER },
+        { .queue = IOT_DEQUEUE_INITIALIZER }
+    }
+};
 
 /* -------------- Convenience functions to create/recycle/destroy jobs -------------- */
 
@@ -137,23 +145,120 @@ static void _taskPoolWorker( void * pUserContext );
 
 /* -------------- Convenience functions to handle timer events  -------------- */
 
+#if IOT_TASKPOOL_TIMER_WHEEL == 1
+
+/**
+ * Places a timer event in the slot of the timer wheel that covers its expiration time.
+ *
+ * param[in] pWheel The timer wheel.
+ * param[in] pTimerEvent The timer event to place.
+ */
+    static void _timerWheelPlace( _taskPoolTimerWheel_t * const pWheel,
+                                  _taskPoolTimerEvent_t * const pTimerEvent );
+
+/**
+ * Finds the first tick at which the timer wheel has a slot to move down or to expire.
+ *
+ * param[in] pWheel The timer wheel.
+ *
+ * @return The tick, or UINT64_MAX if the wheel is empty.
+ */
+    static uint64_t _timerWheelNextTick( const _taskPoolTimerWheel_t * const pWheel );
+
+/**
+ * Processes the ticks of the timer wheel up to a given tick, and moves the
+ * timer events due to the expired list.
+ *
+ * param[in] pWheel The timer wheel.
+ * param[in] nowTick The last tick to process.
+ */
+    static void _timerWheelAdvance( _taskPoolTimerWheel_t * const pWheel,
+                                    uint64_t nowTick );
+#else /* if IOT_TASKPOOL_TIMER_WHEEL == 1 */
+
 /**
  * Comparer for the time list.
  *
  * param[in] pTimerEventLink1 The link to the first timer event.
  * param[in] pTimerEventLink1 The link to the first timer event.
  */
-static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
-                                   const IotLink_t * const pTimerEventLink2 );
+    static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
+                                       const IotLink_t * const pTimerEventLink2 );
+#endif /* if IOT_TASKPOOL_TIMER_WHEEL == 1 */
+
+/**
+ * Initializes the timer queue of a task pool.
+ *
+ * param[in] pTaskPool The task pool.
+ */
+static void _timerQueueInit( _taskPool_t * const pTaskPool );
+
+/**
+ * Adds a timer event to the timer queue, and arms the timer if the event is the next one due.
+ *
+ * param[in] pTaskPool The task pool.
+ * param[in] pTimerEvent The timer event to add.
+ */
+static void _timerQueueInsert( _taskPool_t * const pTaskPool,
+                               _taskPoolTimerEvent_t * const pTimerEvent );
+
+/**
+ * Removes a timer event from the timer queue, e.g. when its job is canceled.
+ *
+ * param[in] pTaskPool The task pool.
+ * param[in] pTimerEvent The timer event to remove.
+ */
+static void _timerQueueRemove( _taskPool_t * const pTaskPool,
+                               _taskPoolTimerEvent_t * const pTimerEvent );
+
+/**
+ * Removes the next timer event that is due from the timer queue.
+ *
+ * param[in] pTaskPool The task pool.
+ * param[in] now The current time.
+ *
+ * @return A timer event that is due, or `NULL` if there is none.
+ */
+static _taskPoolTimerEvent_t * _timerQueueRemoveExpired( _taskPool_t * const pTaskPool,
+                                                         uint64_t now );
+
+/**
+ * Removes any timer event from the timer queue, e.g. to destroy the task pool.
+ *
+ * param[in] pTaskPool The task pool.
+ *
+ * @return A timer event, or `NULL` if the timer queue is empty.
+ */
+static _taskPoolTimerEvent_t * _timerQueueRemoveAny( _taskPool_t * const pTaskPool );
+
+/**
+ * Checks whether the timer of the timer queue may have fired already.
+ *
+ * param[in] pTaskPool The task pool.
+ * param[in] now The current time.
+ *
+ * @return `true` if the timer thread may be running; `false` otherwise.
+ */
+static bool _timerQueueFired( _taskPool_t * const pTaskPool,
+                              uint64_t now );
+
+/**
+ * Arms the timer for the next timer event due in the timer queue, if any.
+ *
+ * param[in] pTaskPool The task pool.
+ */
+static void _timerQueueArm( _taskPool_t * const pTaskPool );
 
 /**
  * Reschedules the timer for handling deferred jobs to the next timeout.
  *
  * param[in] pTimer The timer to reschedule.
- * param[in] pFirstTimerEvent The timer event that carries the timeout and job information.
+ * param[in] expirationTime The time at which the timer should fire.
+ *
+ * @return The time at which the timer will fire.
  */
-static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
-                                          _taskPoolTimerEvent_t * const pFirstTimerEvent );
+static uint64_t _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
+                                              uint64_t expirationTime );
 
 /**
  * The task pool timer procedure for scheduling deferred jobs.
@@ -231,14 +336,48 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
                                              uint32_t flags );
 
 /**
- * Matches a deferred job in the timer queue with its timer event wrapper.
+ * Checks the flags passed to @ref IotTaskPool_Schedule or @ref IotTaskPool_ScheduleDeferredWithFlags.
+ *
+ * @param[in] flags The job flags.
+ *
+ * @return `true` if the flags are a valid combination; `false` otherwise.
+ */
+static bool _validScheduleFlags( uint32_t flags );
+
+/**
+ * Appends a job to the lane selected by the scheduling flags.
+ *
+ * @param[in] pTaskPool The task pool to queue the job into.
+ * @param[in] pJob The job to queue.
+ * @param[in] flags The job flags.
+ *
+ */
+static void _enqueueJob( _taskPool_t * const pTaskPool,
+                         _taskPoolJob_t * const pJob,
+                         uint32_t flags );
+
+/**
+ * Removes the next job to execute from the lanes of a task pool.
+ *
+ * Lanes are served from high to low. When a lower lane has been passed over
+ * #IOT_TASKPOOL_LANE_BYPASS_LIMIT times in a row, the lane whose first job has waited
+ * the longest is served instead.
  *
- * @param[in] pLink A pointer to the timer event link in the timer queue.
- * @param[in] pMatch A pointer to the job to match.
+ * @param[in] pTaskPool The task pool to dequeue the job from.
  *
+ * @return The job to execute, or `NULL` if all lanes are empty.
  */
-static bool _matchJobByPointer( const IotLink_t * const pLink,
-                                void * pMatch );
+static _taskPoolJob_t * _dequeueJob( _taskPool_t * const pTaskPool );
+
+/**
+ * Removes a queued job from its lane, e.g. when the job is canceled.
+ *
+ * @param[in] pTaskPool The task pool the job is queued in.
+ * @param[in] pJob The job to remove.
+ *
+ */
+static void _removeQueuedJob( _taskPool_t * const pTaskPool,
+                              _taskPoolJob_t * const pJob );
 
 /**
  * Tries to cancel a job.
@@ -364,20 +503,25 @@ IotTaskPoolError_t IotTaskPool_Destroy( IotTaskPool_t taskPoolHandle )
          * all task pool data structures and release the associated memory.
          */
 
-        /* (1) Clear the job queue. */
-        do
+        /* (1) Clear the job queues of all lanes. */
+        for( count = 0; count < IOT_TASKPOOL_LANE_COUNT; ++count )
         {
-            pItemLink = NULL;
+            do
+            {
+                pItemLink = NULL;
 
-            pItemLink = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+                pItemLink = IotDeQueue_DequeueHead( &pTaskPool->lanes[ count ].queue );
 
-            if( pItemLink != NULL )
-            {
-                _taskPoolJob_t * pJob = IotLink_Container( _taskPoolJob_t, pItemLink, link );
+                if( pItemLink != NULL )
+                {
+                    _taskPoolJob_t * pJob = IotLink_Container( _taskPoolJob_t, pItemLink, link );
 
-                _destroyJob( pJob );
-            }
-        } while( pItemLink );
+                    _destroyJob( pJob );
+                }
+            } while( pItemLink );
+
+            pTaskPool->lanes[ count ].depth = 0;
+        }
 
         /* (2) Clear the timer queue. */
         {
@@ -387,39 +531,28 @@ IotTaskPoolError_t IotTaskPool_Destroy( IotTaskPool_t taskPoolHandle )
              * the shutdown sequence is holding at this stage, there is no risk for race conditions. Yet, we
              * need to let the deferred job to destroy the task pool. */
 
-            pItemLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-            if( pItemLink != NULL )
+            if( _timerQueueFired( pTaskPool, IotClock_GetTimeMs() ) == true )
             {
-                uint64_t now = IotClock_GetTimeMs();
+                IotLogDebug( "Shutdown will be deferred to the timer thread" );
 
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pItemLink, link );
-
-                if( pTimerEvent->expirationTime <= now )
-                {
-                    IotLogDebug( "Shutdown will be deferred to the timer thread" );
+                /* Timer may have fired already! Let the timer thread destroy
+                 * complete the taskpool destruction sequence. */
+                completeShutdown = false;
+            }
 
-                    /* Timer may have fired already! Let the timer thread destroy
-                     * complete the taskpool destruction sequence. */
-                    completeShutdown = false;
-                }
+            /* Remove all timers from the timeout queue. */
+            for( ; ; )
+            {
+                pTimerEvent = _timerQueueRemoveAny( pTaskPool );
 
-                /* Remove all timers from the timeout list. */
-                for( ; ; )
+                if( pTimerEvent == NULL )
                 {
-                    pItemLink = IotListDouble_RemoveHead( &pTaskPool->timerEventsList );
-
-                    if( pItemLink == NULL )
-                    {
-                        break;
-                    }
-
-                    pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pItemLink, link );
+                    break;
+                }
 
-                    _destroyJob( pTimerEvent->pJob );
+                _destroyJob( pTimerEvent->pJob );
 
-                    IotTaskPool_FreeTimerEvent( pTimerEvent );
-                }
+                IotTaskPool_FreeTimerEvent( pTimerEvent );
             }
         }
 
@@ -701,7 +834,7 @@ IotTaskPoolError_t IotTaskPool_Schedule( IotTaskPool_t taskPoolHandle,
     /* Parameter checking. */
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( taskPoolHandle );
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( pJob );
-    TASKPOOL_ON_ARG_ERROR_GOTO_CLEANUP( ( flags != 0UL ) && ( flags != IOT_TASKPOOL_JOB_HIGH_PRIORITY ) );
+    TASKPOOL_ON_ARG_ERROR_GOTO_CLEANUP( _validScheduleFlags( flags ) == false );
 
     pTaskPool = ( _taskPool_t * ) taskPoolHandle;
 
@@ -733,6 +866,16 @@ IotTaskPoolError_t IotTaskPool_Schedule( IotTaskPool_t taskPoolHandle,
 IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
                                                  IotTaskPoolJob_t pJob,
                                                  uint32_t timeMs )
+{
+    return IotTaskPool_ScheduleDeferredWithFlags( taskPoolHandle, pJob, timeMs, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+IotTaskPoolError_t IotTaskPool_ScheduleDeferredWithFlags( IotTaskPool_t taskPoolHandle,
+                                                          IotTaskPoolJob_t pJob,
+                                                          uint32_t timeMs,
+                                                          uint32_t flags )
 {
     TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
     _taskPool_t * pTaskPool = NULL;
@@ -740,12 +883,13 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
     /* Parameter checking. */
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( taskPoolHandle );
     TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( pJob );
+    TASKPOOL_ON_ARG_ERROR_GOTO_CLEANUP( _validScheduleFlags( flags ) == false );
 
     pTaskPool = ( _taskPool_t * ) taskPoolHandle;
 
     if( timeMs == 0UL )
     {
-        TASKPOOL_SET_AND_GOTO_CLEANUP( IotTaskPool_Schedule( pTaskPool, pJob, 0 ) );
+        TASKPOOL_SET_AND_GOTO_CLEANUP( IotTaskPool_Schedule( pTaskPool, pJob, flags ) );
     }
 
     TASKPOOL_ENTER_CRITICAL();
@@ -761,7 +905,6 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
         /* If all safety checks completed, proceed. */
         if( TASKPOOL_SUCCEEDED( _trySafeExtraction( pTaskPool, pJob, false ) ) )
         {
-            IotLink_t * pTimerEventLink;
             uint64_t now;
 
             _taskPoolTimerEvent_t * pTimerEvent = ( _taskPoolTimerEvent_t * ) IotTaskPool_MallocTimerEvent( sizeof( _taskPoolTimerEvent_t ) );
@@ -781,26 +924,14 @@ IotTaskPoolError_t IotTaskPool_ScheduleDeferred( IotTaskPool_t taskPoolHandle,
             pTimerEvent->link.pPrevious = NULL;
             pTimerEvent->expirationTime = now + timeMs;
             pTimerEvent->pJob = ( _taskPoolJob_t * ) pJob;
-
-            /* Append the timer event to the timer list. */
-            IotListDouble_InsertSorted( &pTaskPool->timerEventsList, &pTimerEvent->link, _timerEventCompare );
+            pTimerEvent->flags = flags;
+            pJob->pTimerEvent = pTimerEvent;
 
             /* Update the job status to 'scheduled'. */
             pJob->status = IOT_TASKPOOL_STATUS_DEFERRED;
 
-            /* Peek the first event in the timer event list. There must be at least one,
-             * since we just inserted it. */
-            pTimerEventLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-            IotTaskPool_Assert( pTimerEventLink != NULL );
-
-            /* If the event we inserted is at the front of the queue, then
-             * we need to reschedule the underlying timer. */
-            if( pTimerEventLink == &pTimerEvent->link )
-            {
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pTimerEventLink, link );
-
-                _rescheduleDeferredJobsTimer( &pTaskPool->timer, pTimerEvent );
-            }
+            /* Add the timer event to the timer queue, re-arming the timer if needed. */
+            _timerQueueInsert( pTaskPool, pTimerEvent );
         }
         else
         {
@@ -851,6 +982,52 @@ IotTaskPoolError_t IotTaskPool_GetStatus( IotTaskPool_t taskPoolHandle,
 
 /*-----------------------------------------------------------*/
 
+IotTaskPoolError_t IotTaskPool_GetStatistics( IotTaskPool_t taskPoolHandle,
+                                              IotTaskPoolStatistics_t * const pStatistics )
+{
+    TASKPOOL_FUNCTION_ENTRY( IOT_TASKPOOL_SUCCESS );
+    _taskPool_t * pTaskPool = NULL;
+    uint32_t lane;
+
+    /* Parameter checking. */
+    TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( taskPoolHandle );
+    TASKPOOL_ON_NULL_ARG_GOTO_CLEANUP( pStatistics );
+
+    pTaskPool = ( _taskPool_t * ) taskPoolHandle;
+
+    memset( pStatistics, 0x00, sizeof( IotTaskPoolStatistics_t ) );
+
+    TASKPOOL_ENTER_CRITICAL();
+    {
+        /* Bail out early if this task pool is shutting down. */
+        if( _IsShutdownStarted( pTaskPool ) )
+        {
+            TASKPOOL_EXIT_CRITICAL();
+
+            TASKPOOL_SET_AND_GOTO_CLEANUP( IOT_TASKPOOL_SHUTDOWN_IN_PROGRESS );
+        }
+
+        for( lane = 0; lane < IOT_TASKPOOL_LANE_COUNT; ++lane )
+        {
+            const _taskPoolLane_t * const pLane = &pTaskPool->lanes[ lane ];
+
+            pStatistics->lanes[ lane ].depth = pLane->depth;
+            pStatistics->lanes[ lane ].maxDepth = pLane->maxDepth;
+            pStatistics->lanes[ lane ].dispatched = pLane->dispatched;
+            pStatistics->lanes[ lane ].totalWaitMs = pLane->totalWaitMs;
+            pStatistics->lanes[ lane ].maxWaitMs = pLane->maxWaitMs;
+        }
+
+        pStatistics->activeThreads = pTaskPool->activeThreads;
+        pStatistics->activeJobs = pTaskPool->activeJobs;
+    }
+    TASKPOOL_EXIT_CRITICAL();
+
+    TASKPOOL_NO_FUNCTION_CLEANUP();
+}
+
+/*-----------------------------------------------------------*/
+
 IotTaskPoolError_t IotTaskPool_TryCancel( IotTaskPool_t taskPoolHandle,
                                           IotTaskPoolJob_t pJob,
                                           IotTaskPoolJobStatus_t * const pStatus )
@@ -955,6 +1132,7 @@ static IotTaskPoolError_t _initTaskPoolControlStructures( const IotTaskPoolInfo_
     bool lockInit = false;
     bool semDispatchInit = false;
     bool timerInit = false;
+    uint32_t lane;
 
     /* Zero out all data structures. */
     memset( ( void * ) pTaskPool, 0x00, sizeof( _taskPool_t ) );
@@ -962,8 +1140,12 @@ static IotTaskPoolError_t _initTaskPoolControlStructures( const IotTaskPoolInfo_
     /* Initialize a job data structures that require no de-initialization.
      * All other data structures carry a value of 'NULL' before initialization.
      */
-    IotDeQueue_Create( &pTaskPool->dispatchQueue );
-    IotListDouble_Create( &pTaskPool->timerEventsList );
+    for( lane = 0; lane < IOT_TASKPOOL_LANE_COUNT; ++lane )
+    {
+        IotDeQueue_Create( &pTaskPool->lanes[ lane ].queue );
+    }
+
+    _timerQueueInit( pTaskPool );
 
     pTaskPool->minThreads = pInfo->minThreads;
     pTaskPool->maxThreads = pInfo->maxThreads;
@@ -1143,7 +1325,6 @@ static void _taskPoolWorker( void * pUserContext )
     do
     {
         bool jobAvailable;
-        IotLink_t * pFirst;
         _taskPoolJob_t * pJob = NULL;
 
         /* Wait on incoming notifications. If waiting on the semaphore return with timeout, then
@@ -1209,15 +1390,12 @@ static void _taskPoolWorker( void * pUserContext )
             /* Only look for a job if waiting did not timed out. */
             if( jobAvailable == true )
             {
-                /* Dequeue the first job in FIFO order. */
-                pFirst = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+                /* Dequeue the next job, in lane order. */
+                pJob = _dequeueJob( pTaskPool );
 
                 /* If there is indeed a job, then update status under lock, and release the lock before processing the job. */
-                if( pFirst != NULL )
+                if( pJob != NULL )
                 {
-                    /* Extract the job from its link. */
-                    pJob = IotLink_Container( _taskPoolJob_t, pFirst, link );
-
                     /* Update status to 'executing'. */
                     pJob->status = IOT_TASKPOOL_STATUS_COMPLETED;
                     userCallback = pJob->userCallback;
@@ -1256,14 +1434,11 @@ static void _taskPoolWorker( void * pUserContext )
                 /* Update the number of busy threads, so new requests can be served by creating new threads, up to maxThreads. */
                 pTaskPool->activeJobs--;
 
-                /* Try and dequeue the next job in the dispatch queue. */
-                IotLink_t * pItem = NULL;
-
-                /* Dequeue the next job from the dispatch queue. */
-                pItem = IotDeQueue_DequeueHead( &pTaskPool->dispatchQueue );
+                /* Dequeue the next job, in lane order. */
+                pJob = _dequeueJob( pTaskPool );
 
-                /* If there is no job left in the dispatch queue, update the worker status and leave. */
-                if( pItem == NULL )
+                /* If there is no job left in any lane, update the worker status and leave. */
+                if( pJob == NULL )
                 {
                     TASKPOOL_EXIT_CRITICAL();
 
@@ -1272,8 +1447,6 @@ static void _taskPoolWorker( void * pUserContext )
                 }
                 else
                 {
-                    pJob = IotLink_Container( _taskPoolJob_t, pItem, link );
-
                     userCallback = pJob->userCallback;
                 }
 
@@ -1304,6 +1477,7 @@ static void _initializeJob( _taskPoolJob_t * const pJob,
     pJob->link.pPrevious = NULL;
     pJob->userCallback = userCallback;
     pJob->pUserContext = pUserContext;
+    pJob->pTimerEvent = NULL;
 
     if( isStatic )
     {
@@ -1498,18 +1672,8 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
 
     if( TASKPOOL_SUCCEEDED( status ) )
     {
-        /* Append the job to the dispatch queue.
-         * Put the job at the front, if it is a high priority job. */
-        if( mustGrow == true )
-        {
-            IotLogDebug( "High priority job: placing job at the head of the queue." );
-
-            IotDeQueue_EnqueueHead( &pTaskPool->dispatchQueue, &pJob->link );
-        }
-        else
-        {
-            IotDeQueue_EnqueueTail( &pTaskPool->dispatchQueue, &pJob->link );
-        }
+        /* Append the job to the lane selected by the flags. */
+        _enqueueJob( pTaskPool, pJob, flags );
 
         /* Signal a worker to pick up the job. */
         IotSemaphore_Post( &pTaskPool->dispatchSignal );
@@ -1529,19 +1693,181 @@ static IotTaskPoolError_t _scheduleInternal( _taskPool_t * const pTaskPool,
 
 /*-----------------------------------------------------------*/
 
-static bool _matchJobByPointer( const IotLink_t * const pLink,
-                                void * pMatch )
+static bool _validScheduleFlags( uint32_t flags )
+{
+    const uint32_t highFlags = IOT_TASKPOOL_JOB_HIGH_PRIORITY | IOT_TASKPOOL_JOB_LANE_HIGH;
+    bool valid = true;
+
+    /* Only the scheduling flags are allowed. */
+    if( ( flags & ~( highFlags | IOT_TASKPOOL_JOB_LANE_LOW ) ) != 0UL )
+    {
+        valid = false;
+    }
+    /* A job cannot be queued in the high and the low lane at the same time. */
+    else if( ( ( flags & highFlags ) != 0UL ) && ( ( flags & IOT_TASKPOOL_JOB_LANE_LOW ) != 0UL ) )
+    {
+        valid = false;
+    }
+    else
+    {
+        /* Nothing to do. */
+    }
+
+    return valid;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _enqueueJob( _taskPool_t * const pTaskPool,
+                         _taskPoolJob_t * const pJob,
+                         uint32_t flags )
+{
+    uint32_t lane = ( uint32_t ) IOT_TASKPOOL_LANE_NORMAL;
+    _taskPoolLane_t * pLane = NULL;
+
+    if( ( flags & ( IOT_TASKPOOL_JOB_HIGH_PRIORITY | IOT_TASKPOOL_JOB_LANE_HIGH ) ) != 0UL )
+    {
+        lane = ( uint32_t ) IOT_TASKPOOL_LANE_HIGH;
+    }
+    else if( ( flags & IOT_TASKPOOL_JOB_LANE_LOW ) != 0UL )
+    {
+        lane = ( uint32_t ) IOT_TASKPOOL_LANE_LOW;
+    }
+    else
+    {
+        /* Nothing to do. */
+    }
+
+    pLane = &pTaskPool->lanes[ lane ];
+
+    /* Remember the lane and the queueing time of the job, for cancellation and statistics. */
+    pJob->flags = ( pJob->flags & ~IOT_TASK_POOL_INTERNAL_LANE_MASK ) | ( lane << IOT_TASK_POOL_INTERNAL_LANE_SHIFT );
+    pJob->queuedTimeMs = ( uint32_t ) IotClock_GetTimeMs();
+
+    /* Put the job at the front of the high lane, if it is a high priority job. */
+    if( ( flags & IOT_TASKPOOL_JOB_HIGH_PRIORITY ) == IOT_TASKPOOL_JOB_HIGH_PRIORITY )
+    {
+        IotLogDebug( "High priority job: placing job at the head of the queue." );
+
+        IotDeQueue_EnqueueHead( &pLane->queue, &pJob->link );
+    }
+    else
+    {
+        IotDeQueue_EnqueueTail( &pLane->queue, &pJob->link );
+    }
+
+    pLane->depth++;
+
+    if( pLane->depth > pLane->maxDepth )
+    {
+        pLane->maxDepth = pLane->depth;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static _taskPoolJob_t * _dequeueJob( _taskPool_t * const pTaskPool )
 {
-    const _taskPoolJob_t * const pJob = ( _taskPoolJob_t * ) pMatch;
+    _taskPoolJob_t * pJob = NULL;
+    _taskPoolLane_t * pLane = NULL;
+    IotLink_t * pLink = NULL;
+    uint32_t now = ( uint32_t ) IotClock_GetTimeMs();
+    uint32_t lane = 0;
+    uint32_t selected = IOT_TASKPOOL_LANE_COUNT;
+    uint32_t wait = 0;
+    uint32_t longestWait = 0;
+    bool bypassing = false;
+
+    /* Find the highest lane with a waiting job. */
+    for( lane = 0; lane < IOT_TASKPOOL_LANE_COUNT; ++lane )
+    {
+        if( pTaskPool->lanes[ lane ].depth > 0UL )
+        {
+            selected = lane;
+            break;
+        }
+    }
 
-    const _taskPoolTimerEvent_t * const pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+    if( selected == IOT_TASKPOOL_LANE_COUNT )
+    {
+        return NULL;
+    }
 
-    if( pJob == pTimerEvent->pJob )
+    /* Check whether serving this lane passes over a job in a lower lane. */
+    for( lane = selected + 1UL; lane < IOT_TASKPOOL_LANE_COUNT; ++lane )
     {
-        return true;
+        if( pTaskPool->lanes[ lane ].depth > 0UL )
+        {
+            bypassing = true;
+        }
     }
 
-    return false;
+    if( bypassing == false )
+    {
+        pTaskPool->bypassCount = 0;
+    }
+    else if( pTaskPool->bypassCount < IOT_TASKPOOL_LANE_BYPASS_LIMIT )
+    {
+        pTaskPool->bypassCount++;
+    }
+    else
+    {
+        /* Lower lanes were passed over too many times in a row: serve the lane
+         * whose first job has waited the longest. */
+        for( lane = selected; lane < IOT_TASKPOOL_LANE_COUNT; ++lane )
+        {
+            pLink = IotDeQueue_PeekHead( &pTaskPool->lanes[ lane ].queue );
+
+            if( pLink != NULL )
+            {
+                wait = now - IotLink_Container( _taskPoolJob_t, pLink, link )->queuedTimeMs;
+
+                if( wait > longestWait )
+                {
+                    longestWait = wait;
+                    selected = lane;
+                }
+            }
+        }
+
+        pTaskPool->bypassCount = 0;
+    }
+
+    pLane = &pTaskPool->lanes[ selected ];
+
+    pLink = IotDeQueue_DequeueHead( &pLane->queue );
+    IotTaskPool_Assert( pLink != NULL );
+
+    pJob = IotLink_Container( _taskPoolJob_t, pLink, link );
+
+    /* Update the lane statistics. */
+    wait = now - pJob->queuedTimeMs;
+
+    pLane->depth--;
+    pLane->dispatched++;
+    pLane->totalWaitMs += wait;
+
+    if( wait > pLane->maxWaitMs )
+    {
+        pLane->maxWaitMs = wait;
+    }
+
+    return pJob;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _removeQueuedJob( _taskPool_t * const pTaskPool,
+                              _taskPoolJob_t * const pJob )
+{
+    uint32_t lane = ( pJob->flags & IOT_TASK_POOL_INTERNAL_LANE_MASK ) >> IOT_TASK_POOL_INTERNAL_LANE_SHIFT;
+
+    IotTaskPool_Assert( lane < IOT_TASKPOOL_LANE_COUNT );
+    IotTaskPool_Assert( pTaskPool->lanes[ lane ].depth > 0UL );
+
+    IotDeQueue_Remove( &pJob->link );
+
+    pTaskPool->lanes[ lane ].depth--;
 }
 
 /*-----------------------------------------------------------*/
@@ -1600,43 +1926,24 @@ static IotTaskPoolError_t _tryCancelInternal( _taskPool_t * const pTaskPool,
             /* A scheduled work items must be in the dispatch queue. */
             IotTaskPool_Assert( IotLink_IsLinked( &pJob->link ) );
 
-            IotDeQueue_Remove( &pJob->link );
+            _removeQueuedJob( pTaskPool, pJob );
         }
 
         /* If the job current status is 'deferred' then the job has to be pending
          * in the timeouts queue. */
         else if( currentStatus == IOT_TASKPOOL_STATUS_DEFERRED )
         {
-            /* Find the timer event associated with the current job. There MUST be one, hence assert if not. */
-            IotLink_t * pTimerEventLink = IotListDouble_FindFirstMatch( &pTaskPool->timerEventsList, NULL, _matchJobByPointer, pJob );
-            IotTaskPool_Assert( pTimerEventLink != NULL );
+            /* The timer event associated with the current job. There MUST be one, hence assert if not. */
+            _taskPoolTimerEvent_t * pTimerEvent = pJob->pTimerEvent;
+            IotTaskPool_Assert( pTimerEvent != NULL );
 
-            if( pTimerEventLink != NULL )
+            if( pTimerEvent != NULL )
             {
-                bool shouldReschedule = false;
-
-                /* If the job being cancelled was at the head of the timeouts queue, then we need to reschedule the timer
-                 * with the next job timeout */
-                IotLink_t * pHeadLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-                if( pHeadLink == pTimerEventLink )
-                {
-                    shouldReschedule = true;
-                }
-
                 /* Remove the timer event associated with the canceled job and free the associated memory. */
-                IotListDouble_Remove( pTimerEventLink );
-                IotTaskPool_FreeTimerEvent( IotLink_Container( _taskPoolTimerEvent_t, pTimerEventLink, link ) );
+                _timerQueueRemove( pTaskPool, pTimerEvent );
+                IotTaskPool_FreeTimerEvent( pTimerEvent );
 
-                if( shouldReschedule )
-                {
-                    IotLink_t * pNextTimerEventLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-                    if( pNextTimerEventLink != NULL )
-                    {
-                        _rescheduleDeferredJobsTimer( &pTaskPool->timer, IotLink_Container( _taskPoolTimerEvent_t, pNextTimerEventLink, link ) );
-                    }
-                }
+                pJob->pTimerEvent = NULL;
             }
         }
         else
@@ -1706,40 +2013,463 @@ static IotTaskPoolError_t _trySafeExtraction( _taskPool_t * const pTaskPool,
 
 /*-----------------------------------------------------------*/
 
-static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
-                                   const IotLink_t * const pTimerEventLink2 )
-{
-    const _taskPoolTimerEvent_t * const pTimerEvent1 = IotLink_Container( _taskPoolTimerEvent_t,
-                                                                          pTimerEventLink1,
-                                                                          link );
-    const _taskPoolTimerEvent_t * const pTimerEvent2 = IotLink_Container( _taskPoolTimerEvent_t,
-                                                                          pTimerEventLink2,
-                                                                          link );
+#if IOT_TASKPOOL_TIMER_WHEEL == 1
 
-    if( pTimerEvent1->expirationTime < pTimerEvent2->expirationTime )
+/**
+ * @brief The number of ticks covered by the timer wheel.
+ */
+    #define TASKPOOL_TIMER_WHEEL_RANGE          ( ( uint64_t ) 1 << ( IOT_TASKPOOL_TIMER_WHEEL_SLOT_BITS * IOT_TASKPOOL_TIMER_WHEEL_LEVELS ) )
+
+/**
+ * @brief The mask of a slot index in a level of the timer wheel.
+ */
+    #define TASKPOOL_TIMER_WHEEL_SLOT_MASK      ( ( uint64_t ) IOT_TASKPOOL_TIMER_WHEEL_SLOTS - 1U )
+
+/**
+ * @brief The number of ticks covered by one slot of a level of the timer wheel.
+ */
+    #define TASKPOOL_TIMER_WHEEL_SPAN( level )    ( ( uint64_t ) 1 << ( IOT_TASKPOOL_TIMER_WHEEL_SLOT_BITS * ( level ) ) )
+
+/**
+ * @brief The tick at which a time in milliseconds is due, rounded up so that jobs never run early.
+ */
+    #define TASKPOOL_TIMER_WHEEL_TICK( timeMs )    ( ( ( timeMs ) + IOT_TASKPOOL_TIMER_WHEEL_TICK_MS - 1U ) / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS )
+
+/*-----------------------------------------------------------*/
+
+    static void _timerWheelPlace( _taskPoolTimerWheel_t * const pWheel,
+                                  _taskPoolTimerEvent_t * const pTimerEvent )
     {
-        return -1;
+        uint64_t tick = TASKPOOL_TIMER_WHEEL_TICK( pTimerEvent->expirationTime );
+        uint64_t delta = 0;
+        uint32_t level = 0;
+        uint32_t slot = 0;
+
+        /* Events already due go to the slot of the next tick. */
+        if( tick < pWheel->nextTick )
+        {
+            tick = pWheel->nextTick;
+        }
+
+        delta = tick - pWheel->nextTick;
+
+        /* Events due beyond the range of the wheel wait in the last slot they can reach. */
+        if( delta >= TASKPOOL_TIMER_WHEEL_RANGE )
+        {
+            delta = TASKPOOL_TIMER_WHEEL_RANGE - 1U;
+            tick = pWheel->nextTick + delta;
+        }
+
+        /* Level n holds the events due in less than SLOTS^(n + 1) ticks. */
+        while( delta >= TASKPOOL_TIMER_WHEEL_SPAN( level + 1U ) )
+        {
+            level++;
+        }
+
+        slot = ( uint32_t ) ( ( tick / TASKPOOL_TIMER_WHEEL_SPAN( level ) ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+
+        IotListDouble_InsertTail( &pWheel->slots[ level ][ slot ], &pTimerEvent->link );
     }
 
-    if( pTimerEvent1->expirationTime > pTimerEvent2->expirationTime )
+/*-----------------------------------------------------------*/
+
+    static uint64_t _timerWheelNextTick( const _taskPoolTimerWheel_t * const pWheel )
     {
-        return 1;
+        uint64_t nextTick = UINT64_MAX;
+        uint64_t span = 0;
+        uint64_t tick = 0;
+        uint32_t level = 0;
+        uint32_t count = 0;
+        uint32_t slot = 0;
+
+        if( pWheel->count > 0U )
+        {
+            for( level = 0; level < IOT_TASKPOOL_TIMER_WHEEL_LEVELS; ++level )
+            {
+                span = TASKPOOL_TIMER_WHEEL_SPAN( level );
+
+                /* The slots of a level are reached at the multiples of their span, starting
+                 * with the first one at or after the next tick. */
+                tick = ( ( pWheel->nextTick + span - 1U ) / span ) * span;
+
+                for( count = 0; ( count < IOT_TASKPOOL_TIMER_WHEEL_SLOTS ) && ( tick < nextTick ); ++count )
+                {
+                    slot = ( uint32_t ) ( ( tick / span ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+
+                    if( IotListDouble_IsEmpty( &pWheel->slots[ level ][ slot ] ) == false )
+                    {
+                        nextTick = tick;
+                    }
+
+                    tick += span;
+                }
+            }
+        }
+
+        return nextTick;
     }
 
-    return 0;
-}
+/*-----------------------------------------------------------*/
+
+    static void _timerWheelAdvance( _taskPoolTimerWheel_t * const pWheel,
+                                    uint64_t nowTick )
+    {
+        uint64_t tick = _timerWheelNextTick( pWheel );
+        uint32_t level = 0;
+        uint32_t slot = 0;
+        IotLink_t * pLink = NULL;
+        _taskPoolTimerEvent_t * pTimerEvent = NULL;
+
+        /* Jump from one tick with work to the next, skipping the empty ones. */
+        while( tick <= nowTick )
+        {
+            pWheel->nextTick = tick;
+
+            /* Move down the slots of the upper levels that are reached at this tick. */
+            for( level = 1; level < IOT_TASKPOOL_TIMER_WHEEL_LEVELS; ++level )
+            {
+                if( ( tick % TASKPOOL_TIMER_WHEEL_SPAN( level ) ) != 0U )
+                {
+                    break;
+                }
+
+                slot = ( uint32_t ) ( ( tick / TASKPOOL_TIMER_WHEEL_SPAN( level ) ) & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+
+                for( pLink = IotListDouble_RemoveHead( &pWheel->slots[ level ][ slot ] );
+                     pLink != NULL;
+                     pLink = IotListDouble_RemoveHead( &pWheel->slots[ level ][ slot ] ) )
+                {
+                    _timerWheelPlace( pWheel, IotLink_Container( _taskPoolTimerEvent_t, pLink, link ) );
+                }
+            }
+
+            /* Expire all the events of this tick at once. Events due beyond the range
+             * of the wheel are placed again. */
+            slot = ( uint32_t ) ( tick & TASKPOOL_TIMER_WHEEL_SLOT_MASK );
+
+            for( pLink = IotListDouble_RemoveHead( &pWheel->slots[ 0 ][ slot ] );
+                 pLink != NULL;
+                 pLink = IotListDouble_RemoveHead( &pWheel->slots[ 0 ][ slot ] ) )
+            {
+                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+
+                if( TASKPOOL_TIMER_WHEEL_TICK( pTimerEvent->expirationTime ) <= tick )
+                {
+                    IotListDouble_InsertTail( &pWheel->expired, pLink );
+                    pWheel->count--;
+                }
+                else
+                {
+                    _timerWheelPlace( pWheel, pTimerEvent );
+                }
+            }
+
+            pWheel->nextTick = tick + 1U;
+            tick = _timerWheelNextTick( pWheel );
+        }
+
+        /* Nothing else is due up to now. */
+        if( pWheel->nextTick <= nowTick )
+        {
+            pWheel->nextTick = nowTick + 1U;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueInit( _taskPool_t * const pTaskPool )
+    {
+        _taskPoolTimerWheel_t * const pWheel = &pTaskPool->timerWheel;
+        uint32_t level = 0;
+        uint32_t slot = 0;
+
+        for( level = 0; level < IOT_TASKPOOL_TIMER_WHEEL_LEVELS; ++level )
+        {
+            for( slot = 0; slot < IOT_TASKPOOL_TIMER_WHEEL_SLOTS; ++slot )
+            {
+                IotListDouble_Create( &pWheel->slots[ level ][ slot ] );
+            }
+        }
+
+        IotListDouble_Create( &pWheel->expired );
+
+        pWheel->nextTick = IotClock_GetTimeMs() / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
+        pWheel->armedTimeMs = UINT64_MAX;
+        pWheel->count = 0;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueInsert( _taskPool_t * const pTaskPool,
+                                   _taskPoolTimerEvent_t * const pTimerEvent )
+    {
+        _taskPoolTimerWheel_t * const pWheel = &pTaskPool->timerWheel;
+        uint64_t nowTick = 0;
+        uint64_t dueTimeMs = 0;
+
+        /* An empty wheel is not advanced, so it may be far behind the clock. */
+        if( pWheel->count == 0U )
+        {
+            nowTick = IotClock_GetTimeMs() / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
+
+            if( nowTick > pWheel->nextTick )
+            {
+                pWheel->nextTick = nowTick;
+            }
+        }
+
+        _timerWheelPlace( pWheel, pTimerEvent );
+        pWheel->count++;
+
+        /* Re-arm the timer only if this event is due before the timer fires. */
+        dueTimeMs = TASKPOOL_TIMER_WHEEL_TICK( pTimerEvent->expirationTime ) * IOT_TASKPOOL_TIMER_WHEEL_TICK_MS;
+
+        if( dueTimeMs < pWheel->armedTimeMs )
+        {
+            pWheel->armedTimeMs = _rescheduleDeferredJobsTimer( &pTaskPool->timer, dueTimeMs );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueRemove( _taskPool_t * const pTaskPool,
+                                   _taskPoolTimerEvent_t * const pTimerEvent )
+    {
+        /* The timer stays armed. When it fires, the timer thread arms it for the next event. */
+        IotListDouble_Remove( &pTimerEvent->link );
+        pTaskPool->timerWheel.count--;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static _taskPoolTimerEvent_t * _timerQueueRemoveExpired( _taskPool_t * const pTaskPool,
+                                                             uint64_t now )
+    {
+        _taskPoolTimerWheel_t * const pWheel = &pTaskPool->timerWheel;
+        _taskPoolTimerEvent_t * pTimerEvent = NULL;
+        IotLink_t * pLink = NULL;
+
+        if( IotListDouble_IsEmpty( &pWheel->expired ) == true )
+        {
+            _timerWheelAdvance( pWheel, now / IOT_TASKPOOL_TIMER_WHEEL_TICK_MS );
+        }
+
+        pLink = IotListDouble_RemoveHead( &pWheel->expired );
+
+        if( pLink != NULL )
+        {
+            pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+        }
+
+        return pTimerEvent;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static _taskPoolTimerEvent_t * _timerQueueRemoveAny( _taskPool_t * const pTaskPool )
+    {
+        _taskPoolTimerWheel_t * const pWheel = &pTaskPool->timerWheel;
+        _taskPoolTimerEvent_t * pTimerEvent = NULL;
+        IotLink_t * pLink = NULL;
+        uint32_t level = 0;
+        uint32_t slot = 0;
+
+        pLink = IotListDouble_RemoveHead( &pWheel->expired );
+
+        for( level = 0; ( pLink == NULL ) && ( level < IOT_TASKPOOL_TIMER_WHEEL_LEVELS ); ++level )
+        {
+            for( slot = 0; ( pLink == NULL ) && ( slot < IOT_TASKPOOL_TIMER_WHEEL_SLOTS ); ++slot )
+            {
+                pLink = IotListDouble_RemoveHead( &pWheel->slots[ level ][ slot ] );
+
+                if( pLink != NULL )
+                {
+                    pWheel->count--;
+                }
+            }
+        }
+
+        if( pLink != NULL )
+        {
+            pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+        }
+
+        return pTimerEvent;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _timerQueueFired( _taskPool_t * const pTaskPool,
+                                  uint64_t now )
+    {
+        return pTaskPool->timerWheel.armedTimeMs <= now;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueArm( _taskPool_t * const pTaskPool )
+    {
+        _taskPoolTimerWheel_t * const pWheel = &pTaskPool->timerWheel;
+        uint64_t tick = _timerWheelNextTick( pWheel );
+
+        if( tick == UINT64_MAX )
+        {
+            pWheel->armedTimeMs = UINT64_MAX;
+        }
+        else
+        {
+            pWheel->armedTimeMs = _rescheduleDeferredJobsTimer( &pTaskPool->timer, tick * IOT_TASKPOOL_TIMER_WHEEL_TICK_MS );
+        }
+    }
+
+#else /* if IOT_TASKPOOL_TIMER_WHEEL == 1 */
+
+    static int32_t _timerEventCompare( const IotLink_t * const pTimerEventLink1,
+                                       const IotLink_t * const pTimerEventLink2 )
+    {
+        const _taskPoolTimerEvent_t * const pTimerEvent1 = IotLink_Container( _taskPoolTimerEvent_t,
+                                                                              pTimerEventLink1,
+                                                                              link );
+        const _taskPoolTimerEvent_t * const pTimerEvent2 = IotLink_Container( _taskPoolTimerEvent_t,
+                                                                              pTimerEventLink2,
+                                                                              link );
+
+        if( pTimerEvent1->expirationTime < pTimerEvent2->expirationTime )
+        {
+            return -1;
+        }
+
+        if( pTimerEvent1->expirationTime > pTimerEvent2->expirationTime )
+        {
+            return 1;
+        }
+
+        return 0;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueInit( _taskPool_t * const pTaskPool )
+    {
+        IotListDouble_Create( &pTaskPool->timerEventsList );
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueInsert( _taskPool_t * const pTaskPool,
+                                   _taskPoolTimerEvent_t * const pTimerEvent )
+    {
+        /* Append the timer event to the timer list. */
+        IotListDouble_InsertSorted( &pTaskPool->timerEventsList, &pTimerEvent->link, _timerEventCompare );
+
+        /* If the event we inserted is at the front of the queue, then
+         * we need to reschedule the underlying timer. */
+        if( IotListDouble_PeekHead( &pTaskPool->timerEventsList ) == &pTimerEvent->link )
+        {
+            ( void ) _rescheduleDeferredJobsTimer( &pTaskPool->timer, pTimerEvent->expirationTime );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueRemove( _taskPool_t * const pTaskPool,
+                                   _taskPoolTimerEvent_t * const pTimerEvent )
+    {
+        /* If the event being removed was at the head of the timeouts queue, then we need to reschedule the timer
+         * with the next timeout. */
+        bool shouldReschedule = ( IotListDouble_PeekHead( &pTaskPool->timerEventsList ) == &pTimerEvent->link );
+
+        IotListDouble_Remove( &pTimerEvent->link );
+
+        if( shouldReschedule == true )
+        {
+            _timerQueueArm( pTaskPool );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static _taskPoolTimerEvent_t * _timerQueueRemoveExpired( _taskPool_t * const pTaskPool,
+                                                             uint64_t now )
+    {
+        _taskPoolTimerEvent_t * pTimerEvent = NULL;
+        IotLink_t * pLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
+
+        if( pLink != NULL )
+        {
+            pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+
+            /* Check if the first event should be processed now. */
+            if( pTimerEvent->expirationTime <= now )
+            {
+                IotListDouble_Remove( pLink );
+            }
+            else
+            {
+                pTimerEvent = NULL;
+            }
+        }
+
+        return pTimerEvent;
+    }
 
 /*-----------------------------------------------------------*/
 
-static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
-                                          _taskPoolTimerEvent_t * const pFirstTimerEvent )
+    static _taskPoolTimerEvent_t * _timerQueueRemoveAny( _taskPool_t * const pTaskPool )
+    {
+        _taskPoolTimerEvent_t * pTimerEvent = NULL;
+        IotLink_t * pLink = IotListDouble_RemoveHead( &pTaskPool->timerEventsList );
+
+        if( pLink != NULL )
+        {
+            pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
+        }
+
+        return pTimerEvent;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _timerQueueFired( _taskPool_t * const pTaskPool,
+                                  uint64_t now )
+    {
+        bool fired = false;
+        IotLink_t * pLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
+
+        if( pLink != NULL )
+        {
+            fired = ( IotLink_Container( _taskPoolTimerEvent_t, pLink, link )->expirationTime <= now );
+        }
+
+        return fired;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _timerQueueArm( _taskPool_t * const pTaskPool )
+    {
+        IotLink_t * pLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
+
+        if( pLink != NULL )
+        {
+            ( void ) _rescheduleDeferredJobsTimer( &pTaskPool->timer,
+                                                   IotLink_Container( _taskPoolTimerEvent_t, pLink, link )->expirationTime );
+        }
+    }
+
+#endif /* if IOT_TASKPOOL_TIMER_WHEEL == 1 */
+
+/*-----------------------------------------------------------*/
+
+static uint64_t _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
+                                              uint64_t expirationTime )
 {
     uint64_t delta = 0;
     uint64_t now = IotClock_GetTimeMs();
 
-    if( pFirstTimerEvent->expirationTime > now )
+    if( expirationTime > now )
     {
-        delta = pFirstTimerEvent->expirationTime - now;
+        delta = expirationTime - now;
     }
 
     if( delta < TASKPOOL_JOB_RESCHEDULE_DELAY_MS )
@@ -1753,6 +2483,8 @@ static void _rescheduleDeferredJobsTimer( IotTimer_t * const pTimer,
     {
         IotLogWarn( "Failed to re-arm timer for task pool" );
     }
+
+    return now + delta;
 }
 
 /*-----------------------------------------------------------*/
@@ -1783,39 +2515,14 @@ static void _timerThread( void * pArgument )
             return;
         }
 
-        /* Dispatch all deferred job whose timer expired, then reset the timer for the next
-         * job down the line. */
+        /* Dispatch all deferred job whose timer expired in this single wake-up, then reset
+         * the timer for the next job down the line. */
         for( ; ; )
         {
-            /* Peek the first event in the timer event list. */
-            IotLink_t * pLink = IotListDouble_PeekHead( &pTaskPool->timerEventsList );
-
-            /* Check if the timer misfired for any reason.  */
-            if( pLink != NULL )
-            {
-                /* Record the current time. */
-                uint64_t now = IotClock_GetTimeMs();
-
-                /* Extract the job from its envelope. */
-                pTimerEvent = IotLink_Container( _taskPoolTimerEvent_t, pLink, link );
-
-                /* Check if the first event should be processed now. */
-                if( pTimerEvent->expirationTime <= now )
-                {
-                    /*  Remove the timer event for immediate processing. */
-                    IotListDouble_Remove( &( pTimerEvent->link ) );
-                }
-                else
-                {
-                    /* The first element in the timer queue shouldn't be processed yet.
-                     * Arm the timer for when it should be processed and leave altogether. */
-                    _rescheduleDeferredJobsTimer( &pTaskPool->timer, pTimerEvent );
+            pTimerEvent = _timerQueueRemoveExpired( pTaskPool, IotClock_GetTimeMs() );
 
-                    break;
-                }
-            }
             /* If there are no timer events to process, terminate this thread. */
-            else
+            if( pTimerEvent == NULL )
             {
                 IotLogDebug( "No further timer events to process. Exiting timer thread." );
 
@@ -1824,12 +2531,17 @@ static void _timerThread( void * pArgument )
 
             IotLogDebug( "Scheduling job from timer event." );
 
+            pTimerEvent->pJob->pTimerEvent = NULL;
+
             /* Queue the job associated with the received timer event. */
-            ( void ) _scheduleInternal( pTaskPool, pTimerEvent->pJob, 0 );
+            ( void ) _scheduleInternal( pTaskPool, pTimerEvent->pJob, pTimerEvent->flags );
 
             /* Free the timer event. */
             IotTaskPool_FreeTimerEvent( pTimerEvent );
         }
+
+        /* Arm the timer for the next timer event, if any. */
+        _timerQueueArm( pTaskPool );
     }
     TASKPOOL_EXIT_CRITICAL();
 }
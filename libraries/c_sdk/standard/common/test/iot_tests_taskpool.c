@@ -73,6 +73,25 @@ typedef struct JobBlockingUserContext
     IotSemaphore_t block;  /**< @brief A synch object to wait on. */
 } JobBlockingUserContext_t;
 
+/**
+ * @brief A user context to record the order in which the lanes are served.
+ */
+typedef struct JobOrderUserContext
+{
+    IotSemaphore_t done;                                /**< @brief A synch object to signal after each job. */
+    uint32_t executed;                                  /**< @brief The number of jobs executed. */
+    IotTaskPoolLane_t order[ IOT_TASKPOOL_LANE_COUNT ]; /**< @brief The lane of each job, in execution order. */
+} JobOrderUserContext_t;
+
+/**
+ * @brief A per-job user context for #JobOrderUserContext_t.
+ */
+typedef struct JobLaneUserContext
+{
+    JobOrderUserContext_t * pOrder; /**< @brief The shared execution order. */
+    IotTaskPoolLane_t lane;         /**< @brief The lane the job is scheduled in. */
+} JobLaneUserContext_t;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -116,6 +135,7 @@ TEST_GROUP_RUNNER( Common_Unit_Task_Pool )
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_LongRunningAndCachedJobsAndDestroy );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_Grow );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_GrowHighPri );
+    RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_Lanes );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_ScheduleOneThenWait );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_ScheduleOneDeferredThenWait );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_ScheduleAllThenWait );
@@ -124,6 +144,7 @@ TEST_GROUP_RUNNER( Common_Unit_Task_Pool )
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_ReSchedule );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_ReScheduleDeferred );
     RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_CancelTasks );
+    RUN_TEST_CASE( Common_Unit_Task_Pool, ScheduleTasks_DeferredBenchmark );
 }
 
 /*-----------------------------------------------------------*/
@@ -198,6 +219,20 @@ TEST_GROUP_RUNNER( Common_Unit_Task_Pool )
     #define TEST_TASKPOOL_MAX_THREADS    7
 #endif
 
+/**
+ * @brief The largest number of outstanding deferred jobs in the deferred jobs benchmark.
+ */
+#ifndef TEST_TASKPOOL_BENCHMARK_MAX_JOBS
+    #define TEST_TASKPOOL_BENCHMARK_MAX_JOBS    ( 1000 )
+#endif
+
+/**
+ * @brief The number of times each series of the deferred jobs benchmark is repeated.
+ */
+#ifndef TEST_TASKPOOL_BENCHMARK_ROUNDS
+    #define TEST_TASKPOOL_BENCHMARK_ROUNDS    ( 10 )
+#endif
+
 /**
  * @brief One hour in milliseconds.
  */
@@ -328,6 +363,30 @@ static void ExecutionLongWithoutDestroyCb( IotTaskPool_t pTaskPool,
     IotMutex_Unlock( &pUserContext->lock );
 }
 
+/**
+ * @brief A callback that records the lane of its job.
+ */
+static void ExecutionRecordLaneCb( IotTaskPool_t pTaskPool,
+                                   IotTaskPoolJob_t pJob,
+                                   void * pContext )
+{
+    JobLaneUserContext_t * pUserContext = ( JobLaneUserContext_t * ) pContext;
+    JobOrderUserContext_t * pOrder = pUserContext->pOrder;
+
+    ( void ) pTaskPool;
+    ( void ) pJob;
+
+    /* The task pool of this test has a single thread, so jobs never run concurrently. */
+    if( pOrder->executed < IOT_TASKPOOL_LANE_COUNT )
+    {
+        pOrder->order[ pOrder->executed ] = pUserContext->lane;
+    }
+
+    pOrder->executed++;
+
+    IotSemaphore_Post( &pOrder->done );
+}
+
 /**
  * @brief A callback that does not recycle its job.
  */
@@ -692,6 +751,15 @@ TEST( Common_Unit_Task_Pool, ScheduleTasksError )
         TEST_ASSERT( IotTaskPool_Schedule( NULL, job, 0 ) == IOT_TASKPOOL_BAD_PARAMETER );
         /* NULL Work item Handle. */
         TEST_ASSERT( IotTaskPool_Schedule( taskPool, NULL, 0 ) == IOT_TASKPOOL_BAD_PARAMETER );
+        /* Unknown flags. */
+        TEST_ASSERT( IotTaskPool_Schedule( taskPool, job, 0x80 ) == IOT_TASKPOOL_BAD_PARAMETER );
+        /* High and low lane at the same time. */
+        TEST_ASSERT( IotTaskPool_Schedule( taskPool, job, IOT_TASKPOOL_JOB_LANE_HIGH | IOT_TASKPOOL_JOB_LANE_LOW ) == IOT_TASKPOOL_BAD_PARAMETER );
+        TEST_ASSERT( IotTaskPool_Schedule( taskPool, job, IOT_TASKPOOL_JOB_HIGH_PRIORITY | IOT_TASKPOOL_JOB_LANE_LOW ) == IOT_TASKPOOL_BAD_PARAMETER );
+        TEST_ASSERT( IotTaskPool_ScheduleDeferredWithFlags( taskPool, job, ONE_HOUR_FROM_NOW_MS, IOT_TASKPOOL_JOB_LANE_HIGH | IOT_TASKPOOL_JOB_LANE_LOW ) == IOT_TASKPOOL_BAD_PARAMETER );
+        /* NULL statistics. */
+        TEST_ASSERT( IotTaskPool_GetStatistics( taskPool, NULL ) == IOT_TASKPOOL_BAD_PARAMETER );
+        TEST_ASSERT( IotTaskPool_GetStatistics( NULL, NULL ) == IOT_TASKPOOL_BAD_PARAMETER );
     }
 
     TEST_ASSERT( IotTaskPool_Destroy( taskPool ) == IOT_TASKPOOL_SUCCESS );
@@ -963,6 +1031,102 @@ TEST( Common_Unit_Task_Pool, ScheduleTasks_GrowHighPri )
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Test that queued jobs are served from the high lane to the low lane, and that
+ * the lane statistics follow.
+ */
+TEST( Common_Unit_Task_Pool, ScheduleTasks_Lanes )
+{
+    IotTaskPool_t taskPool = IOT_TASKPOOL_INITIALIZER;
+
+    /* A single thread, so that jobs queue up behind the blocking job. */
+    const IotTaskPoolInfo_t tpInfo = { .minThreads = 1, .maxThreads = 1, .stackSize = IOT_THREAD_DEFAULT_STACK_SIZE, .priority = IOT_THREAD_DEFAULT_PRIORITY };
+
+    JobBlockingUserContext_t blockingContext;
+    JobOrderUserContext_t orderContext = { 0 };
+
+    /* Initialize user contexts. */
+    TEST_ASSERT( IotSemaphore_Create( &blockingContext.signal, 0, 1 ) );
+    TEST_ASSERT( IotSemaphore_Create( &blockingContext.block, 0, 1 ) );
+    TEST_ASSERT( IotSemaphore_Create( &orderContext.done, 0, IOT_TASKPOOL_LANE_COUNT ) );
+
+    TEST_ASSERT( IotTaskPool_Create( &tpInfo, &taskPool ) == IOT_TASKPOOL_SUCCESS );
+
+    if( TEST_PROTECT() )
+    {
+        uint32_t count;
+        IotTaskPoolStatistics_t statistics;
+        IotTaskPoolJobStorage_t blockingJobStorage;
+        IotTaskPoolJob_t blockingJob;
+        IotTaskPoolJobStorage_t jobsStorage[ IOT_TASKPOOL_LANE_COUNT ];
+        IotTaskPoolJob_t jobs[ IOT_TASKPOOL_LANE_COUNT ];
+        JobLaneUserContext_t laneContexts[ IOT_TASKPOOL_LANE_COUNT ];
+
+        /* Schedule from the lowest to the highest lane. */
+        const IotTaskPoolLane_t lanes[ IOT_TASKPOOL_LANE_COUNT ] = { IOT_TASKPOOL_LANE_LOW, IOT_TASKPOOL_LANE_NORMAL, IOT_TASKPOOL_LANE_HIGH };
+        const uint32_t flags[ IOT_TASKPOOL_LANE_COUNT ] = { IOT_TASKPOOL_JOB_LANE_LOW, 0, IOT_TASKPOOL_JOB_LANE_HIGH };
+
+        /* Steal the only task pool thread. */
+        TEST_ASSERT( IotTaskPool_CreateJob( &ExecutionBlockingWithoutDestroyCb, &blockingContext, &blockingJobStorage, &blockingJob ) == IOT_TASKPOOL_SUCCESS );
+        TEST_ASSERT( IotTaskPool_Schedule( taskPool, blockingJob, 0 ) == IOT_TASKPOOL_SUCCESS );
+        IotSemaphore_Wait( &blockingContext.signal );
+
+        for( count = 0; count < IOT_TASKPOOL_LANE_COUNT; ++count )
+        {
+            laneContexts[ count ].pOrder = &orderContext;
+            laneContexts[ count ].lane = lanes[ count ];
+
+            TEST_ASSERT( IotTaskPool_CreateJob( &ExecutionRecordLaneCb, &laneContexts[ count ], &jobsStorage[ count ], &jobs[ count ] ) == IOT_TASKPOOL_SUCCESS );
+            TEST_ASSERT( IotTaskPool_Schedule( taskPool, jobs[ count ], flags[ count ] ) == IOT_TASKPOOL_SUCCESS );
+        }
+
+        /* One job is waiting in each lane. */
+        TEST_ASSERT( IotTaskPool_GetStatistics( taskPool, &statistics ) == IOT_TASKPOOL_SUCCESS );
+        TEST_ASSERT_EQUAL_UINT32( 1, statistics.activeThreads );
+
+        for( count = 0; count < IOT_TASKPOOL_LANE_COUNT; ++count )
+        {
+            TEST_ASSERT_EQUAL_UINT32( 1, statistics.lanes[ count ].depth );
+        }
+
+        /* Release the thread and wait for the queued jobs. */
+        IotSemaphore_Post( &blockingContext.block );
+
+        for( count = 0; count < IOT_TASKPOOL_LANE_COUNT; ++count )
+        {
+            IotSemaphore_Wait( &orderContext.done );
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( IOT_TASKPOOL_LANE_COUNT, orderContext.executed );
+        TEST_ASSERT_EQUAL_INT( IOT_TASKPOOL_LANE_HIGH, orderContext.order[ 0 ] );
+        TEST_ASSERT_EQUAL_INT( IOT_TASKPOOL_LANE_NORMAL, orderContext.order[ 1 ] );
+        TEST_ASSERT_EQUAL_INT( IOT_TASKPOOL_LANE_LOW, orderContext.order[ 2 ] );
+
+        /* All lanes are empty. The blocking job was dispatched from the normal lane. */
+        TEST_ASSERT( IotTaskPool_GetStatistics( taskPool, &statistics ) == IOT_TASKPOOL_SUCCESS );
+
+        for( count = 0; count < IOT_TASKPOOL_LANE_COUNT; ++count )
+        {
+            TEST_ASSERT_EQUAL_UINT32( 0, statistics.lanes[ count ].depth );
+            TEST_ASSERT_EQUAL_UINT32( 1, statistics.lanes[ count ].maxDepth );
+            TEST_ASSERT( statistics.lanes[ count ].totalWaitMs >= statistics.lanes[ count ].maxWaitMs );
+        }
+
+        TEST_ASSERT_EQUAL_UINT32( 1, statistics.lanes[ IOT_TASKPOOL_LANE_HIGH ].dispatched );
+        TEST_ASSERT_EQUAL_UINT32( 2, statistics.lanes[ IOT_TASKPOOL_LANE_NORMAL ].dispatched );
+        TEST_ASSERT_EQUAL_UINT32( 1, statistics.lanes[ IOT_TASKPOOL_LANE_LOW ].dispatched );
+    }
+
+    TEST_ASSERT( IotTaskPool_Destroy( taskPool ) == IOT_TASKPOOL_SUCCESS );
+
+    /* Destroy user contexts. */
+    IotSemaphore_Destroy( &blockingContext.signal );
+    IotSemaphore_Destroy( &blockingContext.block );
+    IotSemaphore_Destroy( &orderContext.done );
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Test scheduling a set of non-recyclable jobs: static allocation, sequential execution.
  */
@@ -1853,3 +2017,83 @@ TEST( Common_Unit_Task_Pool, ScheduleTasks_CancelTasks )
 }
 
 /*-----------------------------------------------------------*/
+
+/**
+ * @brief Job handles of the deferred jobs benchmark.
+ */
+static IotTaskPoolJob_t _benchmarkJobs[ TEST_TASKPOOL_BENCHMARK_MAX_JOBS ];
+
+/**
+ * @brief Measure the cost of scheduling and canceling deferred jobs with 10, 100 and 1000 of them
+ * outstanding. Build once with #IOT_TASKPOOL_TIMER_WHEEL set to 0 and once with 1 to compare the
+ * sorted list and the timer wheel. Results are logged at the info level.
+ */
+TEST( Common_Unit_Task_Pool, ScheduleTasks_DeferredBenchmark )
+{
+    IotTaskPool_t taskPool = IOT_TASKPOOL_INITIALIZER;
+    const IotTaskPoolInfo_t tpInfo = { .minThreads = 1, .maxThreads = 1, .stackSize = IOT_THREAD_DEFAULT_STACK_SIZE, .priority = IOT_THREAD_DEFAULT_PRIORITY };
+    const uint32_t series[] = { 10, 100, 1000 };
+    uint32_t created = 0;
+
+    TEST_ASSERT( IotTaskPool_Create( &tpInfo, &taskPool ) == IOT_TASKPOOL_SUCCESS );
+
+    if( TEST_PROTECT() )
+    {
+        uint32_t index, round, count, jobs;
+        uint64_t start, scheduleMs, cancelMs;
+
+        for( created = 0; created < TEST_TASKPOOL_BENCHMARK_MAX_JOBS; ++created )
+        {
+            TEST_ASSERT( IotTaskPool_CreateRecyclableJob( taskPool, &BlankExecution, NULL, &_benchmarkJobs[ created ] ) == IOT_TASKPOOL_SUCCESS );
+        }
+
+        for( index = 0; index < ( sizeof( series ) / sizeof( series[ 0 ] ) ); ++index )
+        {
+            jobs = series[ index ];
+            scheduleMs = 0;
+            cancelMs = 0;
+
+            if( jobs > TEST_TASKPOOL_BENCHMARK_MAX_JOBS )
+            {
+                break;
+            }
+
+            for( round = 0; round < TEST_TASKPOOL_BENCHMARK_ROUNDS; ++round )
+            {
+                /* Later jobs time out later, as MQTT and Shadow timeouts do. */
+                start = IotClock_GetTimeMs();
+
+                for( count = 0; count < jobs; ++count )
+                {
+                    TEST_ASSERT( IotTaskPool_ScheduleDeferred( taskPool, _benchmarkJobs[ count ], ONE_HOUR_FROM_NOW_MS + count ) == IOT_TASKPOOL_SUCCESS );
+                }
+
+                scheduleMs += IotClock_GetTimeMs() - start;
+                start = IotClock_GetTimeMs();
+
+                for( count = 0; count < jobs; ++count )
+                {
+                    TEST_ASSERT( IotTaskPool_TryCancel( taskPool, _benchmarkJobs[ count ], NULL ) == IOT_TASKPOOL_SUCCESS );
+                }
+
+                cancelMs += IotClock_GetTimeMs() - start;
+            }
+
+            IotLogInfo( "Deferred jobs (%s): %lu outstanding, %lu us per schedule, %lu us per cancel.",
+                        ( IOT_TASKPOOL_TIMER_WHEEL == 1 ) ? "timer wheel" : "sorted list",
+                        ( unsigned long ) jobs,
+                        ( unsigned long ) ( ( scheduleMs * 1000U ) / ( jobs * TEST_TASKPOOL_BENCHMARK_ROUNDS ) ),
+                        ( unsigned long ) ( ( cancelMs * 1000U ) / ( jobs * TEST_TASKPOOL_BENCHMARK_ROUNDS ) ) );
+        }
+    }
+
+    while( created > 0 )
+    {
+        created--;
+        TEST_ASSERT( IotTaskPool_DestroyRecyclableJob( taskPool, _benchmarkJobs[ created ] ) == IOT_TASKPOOL_SUCCESS );
+    }
+
+    TEST_ASSERT( IotTaskPool_Destroy( taskPool ) == IOT_TASKPOOL_SUCCESS );
+}
+
+/*-----------------------------------------------------------*/
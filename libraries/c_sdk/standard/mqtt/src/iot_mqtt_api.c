@@ -505,6 +505,10 @@ static void _destroyMqttConnection( _mqttConnection_t * pMqttConnection )
                                     NULL,
                                     _mqttSubscription_tryDestroy,
                                     offsetof( _mqttSubscription_t, link ) );
+
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        _IotMqtt_DestroySubscriptionIndex( pMqttConnection );
+    #endif
     IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
 
     /* Destroy an owned network connection. */
@@ -1154,9 +1158,11 @@ IotMqttError_t IotMqtt_Connect( const IotMqttNetworkInfo_t * pNetworkInfo,
         {
             IotLogDebug( "Scheduling first MQTT keep-alive job." );
 
-            taskPoolStatus = IotTaskPool_ScheduleDeferred( IOT_SYSTEM_TASKPOOL,
-                                                           pNewMqttConnection->keepAliveJob,
-                                                           pNewMqttConnection->nextKeepAliveMs );
+            /* Keep-alive jobs use the high lane so a busy task pool does not delay PINGREQ. */
+            taskPoolStatus = IotTaskPool_ScheduleDeferredWithFlags( IOT_SYSTEM_TASKPOOL,
+                                                                    pNewMqttConnection->keepAliveJob,
+                                                                    pNewMqttConnection->nextKeepAliveMs,
+                                                                    IOT_TASKPOOL_JOB_LANE_HIGH );
 
             if( taskPoolStatus != IOT_TASKPOOL_SUCCESS )
             {
@@ -105,6 +105,101 @@ static void _flushPacket( void * pNetworkConnection,
                           const _mqttConnection_t * pMqttConnection,
                           size_t length );
 
+/**
+ * @brief Get an incoming MQTT packet, through the receive buffer if possible.
+ *
+ * @param[in] pNetworkConnection Network connection to use for receive, which
+ * may be different from the network connection associated with the MQTT connection.
+ * @param[in] pMqttConnection The associated MQTT connection.
+ * @param[out] pIncomingPacket Output parameter for the incoming packet.
+ * @param[out] pFreeRemainingData Set to `true` if the remaining data of the
+ * packet was allocated and must be freed; `false` if it points into the
+ * receive buffer.
+ *
+ * @return #IOT_MQTT_SUCCESS, #IOT_MQTT_NO_MEMORY or #IOT_MQTT_BAD_RESPONSE.
+ */
+static IotMqttError_t _receiveIncomingPacket( void * pNetworkConnection,
+                                              _mqttConnection_t * pMqttConnection,
+                                              _mqttPacket_t * pIncomingPacket,
+                                              bool * pFreeRemainingData );
+
+/**
+ * @brief Check if the receive buffer of an MQTT connection holds data that
+ * has not been processed.
+ *
+ * @param[in] pMqttConnection The MQTT connection to check.
+ *
+ * @return `true` if unprocessed data is buffered; `false` otherwise.
+ */
+static bool _receiveBufferPending( const _mqttConnection_t * pMqttConnection );
+
+#if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+
+/**
+ * @brief Check if incoming packets of an MQTT connection may be read through
+ * its receive buffer.
+ *
+ * Serializer overrides for the packet type and remaining length read from
+ * the network themselves, so the receive buffer is not used with them.
+ *
+ * @param[in] pMqttConnection The MQTT connection to check.
+ *
+ * @return `true` if the receive buffer may be used; `false` otherwise.
+ */
+    static bool _receiveBufferEnabled( const _mqttConnection_t * pMqttConnection );
+
+/**
+ * @brief Wait until a number of bytes is available in the receive buffer.
+ *
+ * If the network interface provides @ref platform_network_function_receiveupto,
+ * it is used to receive as much data as fits in the buffer. Otherwise, only the
+ * missing bytes are received, so that this function never waits for data that
+ * belongs to the next packet.
+ *
+ * @param[in] pNetworkConnection Network connection to use for receive.
+ * @param[in] pMqttConnection The MQTT connection that owns the receive buffer.
+ * @param[in] bytesRequired How many unprocessed bytes the buffer must hold.
+ * Must not be larger than @ref IOT_MQTT_RECEIVE_BUFFER_SIZE.
+ *
+ * @return `true` if the bytes are available; `false` if the network failed.
+ */
+    static bool _fillReceiveBuffer( void * pNetworkConnection,
+                                    _mqttConnection_t * pMqttConnection,
+                                    size_t bytesRequired );
+
+/**
+ * @brief Get an incoming MQTT packet through the receive buffer.
+ *
+ * The fixed header is decoded in the receive buffer. The remaining data of a
+ * packet other than PUBLISH that fits in the buffer is left there, so that it
+ * can be deserialized without an allocation. PUBLISH packets keep their data
+ * after the receive callback returns, so their data is always allocated.
+ *
+ * @param[in] pNetworkConnection Network connection to use for receive.
+ * @param[in] pMqttConnection The associated MQTT connection.
+ * @param[out] pIncomingPacket Output parameter for the incoming packet.
+ * @param[out] pFreeRemainingData Whether the remaining data was allocated.
+ *
+ * @return #IOT_MQTT_SUCCESS, #IOT_MQTT_NO_MEMORY or #IOT_MQTT_BAD_RESPONSE.
+ */
+    static IotMqttError_t _getBufferedPacket( void * pNetworkConnection,
+                                              _mqttConnection_t * pMqttConnection,
+                                              _mqttPacket_t * pIncomingPacket,
+                                              bool * pFreeRemainingData );
+
+/**
+ * @brief Flush a packet from the stream of incoming data, starting with the
+ * data in the receive buffer.
+ *
+ * @param[in] pNetworkConnection Network connection to use for receive.
+ * @param[in] pMqttConnection The MQTT connection that owns the receive buffer.
+ * @param[in] length The length of the packet data to flush.
+ */
+    static void _flushBufferedPacket( void * pNetworkConnection,
+                                      _mqttConnection_t * pMqttConnection,
+                                      size_t length );
+#endif /* if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 */
+
 /*-----------------------------------------------------------*/
 
 static bool _incomingPacketValid( uint8_t packetType )
@@ -766,6 +861,420 @@ static void _flushPacket( void * pNetworkConnection,
 
 /*-----------------------------------------------------------*/
 
+static IotMqttError_t _receiveIncomingPacket( void * pNetworkConnection,
+                                              _mqttConnection_t * pMqttConnection,
+                                              _mqttPacket_t * pIncomingPacket,
+                                              bool * pFreeRemainingData )
+{
+    IotMqttError_t status = IOT_MQTT_SUCCESS;
+
+    /* Packets read directly from the network always have allocated data. */
+    *pFreeRemainingData = true;
+
+    #if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+        if( _receiveBufferEnabled( pMqttConnection ) == true )
+        {
+            status = _getBufferedPacket( pNetworkConnection,
+                                         pMqttConnection,
+                                         pIncomingPacket,
+                                         pFreeRemainingData );
+        }
+        else
+        {
+            status = _getIncomingPacket( pNetworkConnection,
+                                         pMqttConnection,
+                                         pIncomingPacket );
+        }
+    #else
+        status = _getIncomingPacket( pNetworkConnection,
+                                     pMqttConnection,
+                                     pIncomingPacket );
+    #endif /* if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 */
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool _receiveBufferPending( const _mqttConnection_t * pMqttConnection )
+{
+    bool status = false;
+
+    #if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+        status = ( pMqttConnection->receiveStart != pMqttConnection->receiveEnd );
+    #else
+        /* Silence warnings about unused parameters. */
+        ( void ) pMqttConnection;
+    #endif
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+#if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+
+    static bool _receiveBufferEnabled( const _mqttConnection_t * pMqttConnection )
+    {
+        bool status = true;
+
+        #if IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES == 1
+            if( pMqttConnection->pSerializer != NULL )
+            {
+                if( ( pMqttConnection->pSerializer->getPacketType != NULL ) ||
+                    ( pMqttConnection->pSerializer->getRemainingLength != NULL ) )
+                {
+                    status = false;
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        #else
+            /* Silence warnings about unused parameters. */
+            ( void ) pMqttConnection;
+        #endif /* if IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES == 1 */
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _fillReceiveBuffer( void * pNetworkConnection,
+                                    _mqttConnection_t * pMqttConnection,
+                                    size_t bytesRequired )
+    {
+        bool status = true;
+        size_t bytesBuffered = pMqttConnection->receiveEnd - pMqttConnection->receiveStart;
+        size_t bytesReceived = 0;
+        const IotNetworkInterface_t * pNetworkInterface = pMqttConnection->pNetworkInterface;
+
+        IotMqtt_Assert( bytesRequired <= IOT_MQTT_RECEIVE_BUFFER_SIZE );
+
+        /* Move unprocessed data to the start of the buffer if the required
+         * bytes would not fit after it. */
+        if( bytesBuffered == 0 )
+        {
+            pMqttConnection->receiveStart = 0;
+            pMqttConnection->receiveEnd = 0;
+        }
+        else if( pMqttConnection->receiveStart + bytesRequired > IOT_MQTT_RECEIVE_BUFFER_SIZE )
+        {
+            ( void ) memmove( pMqttConnection->pReceiveBuffer,
+                              pMqttConnection->pReceiveBuffer + pMqttConnection->receiveStart,
+                              bytesBuffered );
+
+            pMqttConnection->receiveStart = 0;
+            pMqttConnection->receiveEnd = bytesBuffered;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        while( bytesBuffered < bytesRequired )
+        {
+            if( pNetworkInterface->receiveUpto != NULL )
+            {
+                bytesReceived = pNetworkInterface->receiveUpto( pNetworkConnection,
+                                                                pMqttConnection->pReceiveBuffer + pMqttConnection->receiveEnd,
+                                                                IOT_MQTT_RECEIVE_BUFFER_SIZE - pMqttConnection->receiveEnd );
+            }
+            else
+            {
+                bytesReceived = pNetworkInterface->receive( pNetworkConnection,
+                                                            pMqttConnection->pReceiveBuffer + pMqttConnection->receiveEnd,
+                                                            bytesRequired - bytesBuffered );
+            }
+
+            /* Network receive must return 0 on failure. */
+            if( bytesReceived == 0 )
+            {
+                status = false;
+
+                break;
+            }
+            else
+            {
+                IotMqtt_Assert( bytesReceived <= IOT_MQTT_RECEIVE_BUFFER_SIZE - pMqttConnection->receiveEnd );
+            }
+
+            pMqttConnection->receiveEnd += bytesReceived;
+            bytesBuffered += bytesReceived;
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static IotMqttError_t _getBufferedPacket( void * pNetworkConnection,
+                                              _mqttConnection_t * pMqttConnection,
+                                              _mqttPacket_t * pIncomingPacket,
+                                              bool * pFreeRemainingData )
+    {
+        IOT_FUNCTION_ENTRY( IotMqttError_t, IOT_MQTT_SUCCESS );
+        uint8_t encodedByte = 0;
+        size_t headerSize = 1, multiplier = 1, packetSize = 0;
+        size_t bytesCopied = 0, dataBytesRead = 0;
+
+        /* No buffer for remaining data should be allocated. */
+        IotMqtt_Assert( pIncomingPacket->pRemainingData == NULL );
+        IotMqtt_Assert( pIncomingPacket->remainingLength == 0 );
+
+        *pFreeRemainingData = false;
+
+        /* Read the packet type by itself. Without receiveUpto, the fixed
+         * header is then received 1 byte at a time, as _getIncomingPacket
+         * does, because a network receive function only has to support the
+         * requests that the unbuffered path makes. */
+        if( _fillReceiveBuffer( pNetworkConnection, pMqttConnection, 1 ) == false )
+        {
+            IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        /* Check that the incoming packet type is valid. */
+        pIncomingPacket->type = pMqttConnection->pReceiveBuffer[ pMqttConnection->receiveStart ];
+
+        if( _incomingPacketValid( pIncomingPacket->type ) == false )
+        {
+            IotLogError( "(MQTT connection %p) Unknown packet type %02x received.",
+                         pMqttConnection,
+                         pIncomingPacket->type );
+
+            IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        /* Decode the remaining length, which is at most 4 bytes. This algorithm
+         * is copied from the MQTT v3.1.1 spec. */
+        do
+        {
+            if( headerSize == 5 )
+            {
+                IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            if( _fillReceiveBuffer( pNetworkConnection, pMqttConnection, headerSize + 1 ) == false )
+            {
+                IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            encodedByte = pMqttConnection->pReceiveBuffer[ pMqttConnection->receiveStart + headerSize ];
+            pIncomingPacket->remainingLength += ( encodedByte & 0x7F ) * multiplier;
+            multiplier *= 128;
+            headerSize++;
+        } while( ( encodedByte & 0x80 ) != 0 );
+
+        /* The remaining length must use as few bytes as possible, so only a
+         * 1-byte encoding may end with 0. */
+        if( ( headerSize > 2 ) && ( encodedByte == 0 ) )
+        {
+            IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        packetSize = headerSize + pIncomingPacket->remainingLength;
+
+        if( pIncomingPacket->remainingLength == 0 )
+        {
+            pMqttConnection->receiveStart += headerSize;
+        }
+        else if( ( ( pIncomingPacket->type & 0xf0 ) != MQTT_PACKET_TYPE_PUBLISH ) &&
+                 ( packetSize <= IOT_MQTT_RECEIVE_BUFFER_SIZE ) )
+        {
+            /* Leave the remaining data in the receive buffer. It is not
+             * overwritten until the next packet is read. */
+            if( _fillReceiveBuffer( pNetworkConnection, pMqttConnection, packetSize ) == false )
+            {
+                IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            pIncomingPacket->pRemainingData = pMqttConnection->pReceiveBuffer +
+                                              pMqttConnection->receiveStart + headerSize;
+            pMqttConnection->receiveStart += packetSize;
+        }
+        else
+        {
+            pMqttConnection->receiveStart += headerSize;
+
+            /* Allocate a buffer for the remaining data. */
+            pIncomingPacket->pRemainingData = IotMqtt_MallocMessage( pIncomingPacket->remainingLength );
+
+            if( pIncomingPacket->pRemainingData == NULL )
+            {
+                IotLogError( "(MQTT connection %p) Failed to allocate buffer of length "
+                             "%lu for incoming packet type %lu.",
+                             pMqttConnection,
+                             ( unsigned long ) pIncomingPacket->remainingLength,
+                             ( unsigned long ) pIncomingPacket->type );
+
+                _flushBufferedPacket( pNetworkConnection, pMqttConnection, pIncomingPacket->remainingLength );
+
+                IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_NO_MEMORY );
+            }
+            else
+            {
+                *pFreeRemainingData = true;
+            }
+
+            /* Copy the data that is already buffered, then receive the rest
+             * directly into the allocated buffer. */
+            bytesCopied = pMqttConnection->receiveEnd - pMqttConnection->receiveStart;
+
+            if( bytesCopied > pIncomingPacket->remainingLength )
+            {
+                bytesCopied = pIncomingPacket->remainingLength;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            ( void ) memcpy( pIncomingPacket->pRemainingData,
+                             pMqttConnection->pReceiveBuffer + pMqttConnection->receiveStart,
+                             bytesCopied );
+            pMqttConnection->receiveStart += bytesCopied;
+
+            if( bytesCopied < pIncomingPacket->remainingLength )
+            {
+                dataBytesRead = pMqttConnection->pNetworkInterface->receive( pNetworkConnection,
+                                                                             pIncomingPacket->pRemainingData + bytesCopied,
+                                                                             pIncomingPacket->remainingLength - bytesCopied );
+
+                if( dataBytesRead != pIncomingPacket->remainingLength - bytesCopied )
+                {
+                    IOT_SET_AND_GOTO_CLEANUP( IOT_MQTT_BAD_RESPONSE );
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+
+        /* Clean up on error. */
+        IOT_FUNCTION_CLEANUP_BEGIN();
+
+        if( status != IOT_MQTT_SUCCESS )
+        {
+            if( *pFreeRemainingData == true )
+            {
+                IotMqtt_FreeMessage( pIncomingPacket->pRemainingData );
+                *pFreeRemainingData = false;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            pIncomingPacket->pRemainingData = NULL;
+
+            /* The rest of the stream cannot be parsed after a bad packet. */
+            if( status == IOT_MQTT_BAD_RESPONSE )
+            {
+                pMqttConnection->receiveStart = pMqttConnection->receiveEnd;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        IOT_FUNCTION_CLEANUP_END();
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _flushBufferedPacket( void * pNetworkConnection,
+                                      _mqttConnection_t * pMqttConnection,
+                                      size_t length )
+    {
+        size_t bytesFlushed = pMqttConnection->receiveEnd - pMqttConnection->receiveStart;
+        size_t bytesRequested = 0;
+
+        /* Discard the part of the packet that is already buffered. */
+        if( bytesFlushed > length )
+        {
+            bytesFlushed = length;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        pMqttConnection->receiveStart += bytesFlushed;
+
+        /* If more of the packet remains, the buffer is now empty and may be
+         * used to receive and discard the rest. */
+        while( bytesFlushed < length )
+        {
+            pMqttConnection->receiveStart = 0;
+            pMqttConnection->receiveEnd = 0;
+
+            bytesRequested = length - bytesFlushed;
+
+            if( bytesRequested > IOT_MQTT_RECEIVE_BUFFER_SIZE )
+            {
+                bytesRequested = IOT_MQTT_RECEIVE_BUFFER_SIZE;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            if( pMqttConnection->pNetworkInterface->receive( pNetworkConnection,
+                                                             pMqttConnection->pReceiveBuffer,
+                                                             bytesRequested ) != bytesRequested )
+            {
+                break;
+            }
+            else
+            {
+                bytesFlushed += bytesRequested;
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+#endif /* if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 */
+
 bool _IotMqtt_GetNextByte( void * pNetworkConnection,
                            const IotNetworkInterface_t * pNetworkInterface,
                            uint8_t * pIncomingByte )
@@ -905,35 +1414,45 @@ void IotMqtt_ReceiveCallback( void * pNetworkConnection,
 {
     IotMqttError_t status = IOT_MQTT_SUCCESS;
     _mqttPacket_t incomingPacket = { .u.pMqttConnection = NULL };
+    bool freeRemainingData = true;
 
     /* Cast context to correct type. */
     _mqttConnection_t * pMqttConnection = ( _mqttConnection_t * ) pReceiveContext;
 
-    /* Read an MQTT packet from the network. */
-    status = _getIncomingPacket( pNetworkConnection,
-                                 pMqttConnection,
-                                 &incomingPacket );
-
-    if( status == IOT_MQTT_SUCCESS )
+    /* Process packets until the receive buffer is empty. Without a receive
+     * buffer, one packet is processed. */
+    do
     {
-        /* Deserialize the received packet. */
-        status = _deserializeIncomingPacket( pMqttConnection,
-                                             &incomingPacket );
+        ( void ) memset( &incomingPacket, 0x00, sizeof( _mqttPacket_t ) );
+
+        /* Read an MQTT packet from the network. */
+        status = _receiveIncomingPacket( pNetworkConnection,
+                                         pMqttConnection,
+                                         &incomingPacket,
+                                         &freeRemainingData );
 
-        /* Free any buffers allocated for the MQTT packet. */
-        if( incomingPacket.pRemainingData != NULL )
+        if( status == IOT_MQTT_SUCCESS )
         {
-            IotMqtt_FreeMessage( incomingPacket.pRemainingData );
+            /* Deserialize the received packet. */
+            status = _deserializeIncomingPacket( pMqttConnection,
+                                                 &incomingPacket );
+
+            /* Free any buffers allocated for the MQTT packet. */
+            if( ( incomingPacket.pRemainingData != NULL ) && ( freeRemainingData == true ) )
+            {
+                IotMqtt_FreeMessage( incomingPacket.pRemainingData );
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
         }
         else
         {
             EMPTY_ELSE_MARKER;
         }
-    }
-    else
-    {
-        EMPTY_ELSE_MARKER;
-    }
+    } while( ( status != IOT_MQTT_BAD_RESPONSE ) &&
+             ( _receiveBufferPending( pMqttConnection ) == true ) );
 
     /* Close the network connection on a bad response. */
     if( status == IOT_MQTT_BAD_RESPONSE )
@@ -735,9 +735,10 @@ void _IotMqtt_ProcessKeepAlive( IotTaskPool_t pTaskPool,
      * response shortly. */
     if( status == true )
     {
-        taskPoolStatus = IotTaskPool_ScheduleDeferred( pTaskPool,
-                                                       pKeepAliveJob,
-                                                       pMqttConnection->nextKeepAliveMs );
+        taskPoolStatus = IotTaskPool_ScheduleDeferredWithFlags( pTaskPool,
+                                                                pKeepAliveJob,
+                                                                pMqttConnection->nextKeepAliveMs,
+                                                                IOT_TASKPOOL_JOB_LANE_HIGH );
 
         if( taskPoolStatus == IOT_TASKPOOL_SUCCESS )
         {
@@ -1055,6 +1056,7 @@ IotMqttError_t _IotMqtt_ScheduleOperation( _mqttOperation_t * pOperation,
 {
     IotMqttError_t status = IOT_MQTT_SUCCESS;
     IotTaskPoolError_t taskPoolStatus = IOT_TASKPOOL_SUCCESS;
+    uint32_t flags = 0;
 
     /* Check that job routine is valid. */
     IotMqtt_Assert( ( jobRoutine == _IotMqtt_ProcessSend ) ||
@@ -1068,10 +1070,22 @@ IotMqttError_t _IotMqtt_ScheduleOperation( _mqttOperation_t * pOperation,
                                             &( pOperation->job ) );
     IotMqtt_Assert( taskPoolStatus == IOT_TASKPOOL_SUCCESS );
 
+    /* Completed operations (e.g. a PUBLISH acknowledged by PUBACK) release their
+     * waiters and resources, so they use the high lane. */
+    if( jobRoutine == _IotMqtt_ProcessCompletedOperation )
+    {
+        flags = IOT_TASKPOOL_JOB_LANE_HIGH;
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
     /* Schedule the new job with a delay. */
-    taskPoolStatus = IotTaskPool_ScheduleDeferred( IOT_SYSTEM_TASKPOOL,
-                                                   pOperation->job,
-                                                   delay );
+    taskPoolStatus = IotTaskPool_ScheduleDeferredWithFlags( IOT_SYSTEM_TASKPOOL,
+                                                            pOperation->job,
+                                                            delay,
+                                                            flags );
 
     if( taskPoolStatus != IOT_TASKPOOL_SUCCESS )
     {
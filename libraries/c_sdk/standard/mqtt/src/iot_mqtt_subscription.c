@@ -65,6 +65,33 @@ typedef struct _packetMatchParams
     int32_t order;             /**< Order to match. Set to `-1` to ignore. */
 } _packetMatchParams_t;
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Number of hash buckets allocated for the first node of a topic filter
+ * index. Must be a power of 2.
+ */
+    #define INDEX_INITIAL_BUCKET_COUNT    ( 16 )
+
+/**
+ * @brief First parameter to #_packetMatchUnindex.
+ */
+    typedef struct _indexPacketMatchParams
+    {
+        _packetMatchParams_t packetMatchParams; /**< @brief Parameters passed to #_packetMatch. */
+        _mqttSubscriptionIndex_t * pIndex;      /**< @brief The index to remove matching subscriptions from. */
+    } _indexPacketMatchParams_t;
+
+/**
+ * @brief A node still to be visited by #_indexMatch.
+ */
+    typedef struct _indexCursor
+    {
+        const _mqttIndexNode_t * pNode; /**< @brief The node to visit. */
+        uint32_t levelStart;            /**< @brief Offset of the next topic name level; one past the end if all levels were consumed. */
+    } _indexCursor_t;
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -92,6 +119,154 @@ static bool _topicMatch( const IotLink_t * pSubscriptionLink,
 static bool _packetMatch( const IotLink_t * pSubscriptionLink,
                           void * pMatch );
 
+/**
+ * @brief Invoke the callback of a subscription that matched a PUBLISH.
+ *
+ * The subscription mutex is released while the callback runs. It must be locked
+ * when this function is called, and it is locked again when this function returns.
+ *
+ * @param[in] pMqttConnection The MQTT connection associated with the subscription.
+ * @param[in] pSubscription The subscription. The caller must hold a reference to it.
+ * @param[in] pCallbackParam The parameter to pass to the callback.
+ */
+static void _invokeSubscription( _mqttConnection_t * pMqttConnection,
+                                 _mqttSubscription_t * pSubscription,
+                                 IotMqttCallbackParam_t * pCallbackParam );
+
+/**
+ * @brief Release a reference to a subscription, freeing it if it was unsubscribed
+ * and this was the last reference.
+ *
+ * @param[in] pSubscription The subscription.
+ */
+static void _releaseSubscription( _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Invoke the callbacks of all subscriptions matching a PUBLISH by
+ * searching the subscription list.
+ *
+ * @param[in] pMqttConnection The MQTT connection associated with the PUBLISH.
+ * @param[in] pCallbackParam The parameter to pass to the callbacks.
+ */
+static void _invokeListMatches( _mqttConnection_t * pMqttConnection,
+                                IotMqttCallbackParam_t * pCallbackParam );
+
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Calculate the hash bucket key of a topic filter index node.
+ *
+ * @param[in] pParent The parent of the node.
+ * @param[in] pLevel The topic filter level of the node.
+ * @param[in] levelLength Length of `pLevel`.
+ *
+ * @return The hash of the arguments.
+ */
+    static uint32_t _indexHash( const _mqttIndexNode_t * pParent,
+                                const char * pLevel,
+                                uint16_t levelLength );
+
+/**
+ * @brief Find the child of a topic filter index node.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pParent The parent of the child.
+ * @param[in] pLevel The topic filter level of the child. This does not need to
+ * be NUL-terminated, so it may point into a topic name.
+ * @param[in] levelLength Length of `pLevel`.
+ *
+ * @return The child; `NULL` if there is none.
+ */
+    static _mqttIndexNode_t * _indexFindChild( const _mqttSubscriptionIndex_t * pIndex,
+                                               const _mqttIndexNode_t * pParent,
+                                               const char * pLevel,
+                                               uint16_t levelLength );
+
+/**
+ * @brief Find or create the child of a topic filter index node.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pParent The parent of the child.
+ * @param[in] pLevel The topic filter level of the child.
+ * @param[in] levelLength Length of `pLevel`.
+ *
+ * @return The child; `NULL` if memory allocation failed.
+ */
+    static _mqttIndexNode_t * _indexAddChild( _mqttSubscriptionIndex_t * pIndex,
+                                              _mqttIndexNode_t * pParent,
+                                              const char * pLevel,
+                                              uint16_t levelLength );
+
+/**
+ * @brief Free a topic filter index node and its ancestors while they hold no
+ * subscriptions and have no children. The root is never freed.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pNode The deepest node to check.
+ */
+    static void _indexPrune( _mqttSubscriptionIndex_t * pIndex,
+                             _mqttIndexNode_t * pNode );
+
+/**
+ * @brief Add a subscription to a topic filter index.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pSubscription The subscription, which must not already be in the index.
+ *
+ * @return `true` if the subscription was added; `false` if memory allocation failed.
+ */
+    static bool _indexInsert( _mqttSubscriptionIndex_t * pIndex,
+                              _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Remove a subscription from a topic filter index.
+ *
+ * Does nothing if the subscription is not in the index.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pSubscription The subscription to remove.
+ */
+    static void _indexRemove( _mqttSubscriptionIndex_t * pIndex,
+                              const _mqttSubscription_t * pSubscription );
+
+/**
+ * @brief Find all subscriptions in a topic filter index that match a topic name.
+ *
+ * The topic name is matched level by level in place, so the cost depends on
+ * the number of topic levels and matching wildcards, not on the number of
+ * subscriptions.
+ *
+ * @param[in] pIndex The topic filter index.
+ * @param[in] pTopicName The topic name to match.
+ * @param[in] topicNameLength Length of `pTopicName`.
+ * @param[out] pMatches Receives the matching subscriptions. Must have space for
+ * @ref IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES entries.
+ * @param[out] pMatchCount Receives the number of matching subscriptions.
+ *
+ * @return `true` if all matches were found; `false` if there were more than
+ * @ref IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES matches or more than
+ * @ref IOT_MQTT_SUBSCRIPTION_INDEX_MAX_DEPTH nodes to visit at once. The
+ * subscription list must be searched instead when this returns `false`.
+ */
+    static bool _indexMatch( const _mqttSubscriptionIndex_t * pIndex,
+                             const char * pTopicName,
+                             uint16_t topicNameLength,
+                             _mqttSubscription_t ** pMatches,
+                             size_t * pMatchCount );
+
+/**
+ * @brief Match a packet identifier and order with #_packetMatch, and remove
+ * each subscription to be removed from the topic filter index.
+ *
+ * @param[in] pSubscriptionLink Pointer to the link member of an #_mqttSubscription_t.
+ * @param[in] pMatch Pointer to a #_indexPacketMatchParams_t.
+ *
+ * @return The result of #_packetMatch.
+ */
+    static bool _packetMatchUnindex( const IotLink_t * pSubscriptionLink,
+                                     void * pMatch );
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
 /*-----------------------------------------------------------*/
 
 static bool _topicMatch( const IotLink_t * pSubscriptionLink,
@@ -120,7 +295,16 @@ static bool _topicMatch( const IotLink_t * pSubscriptionLink,
     {
         status = ( strncmp( pTopicName, pTopicFilter, topicNameLength ) == 0 );
 
-        IOT_GOTO_CLEANUP();
+        /* A filter with wildcards may still match a topic name of the same
+         * length, e.g. "a/+/c" and "a/b/c". */
+        if( ( status == true ) || ( pParam->exactMatchOnly == true ) )
+        {
+            IOT_GOTO_CLEANUP();
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
     }
     else
     {
@@ -310,102 +494,76 @@ static bool _packetMatch( const IotLink_t * pSubscriptionLink,
 
 /*-----------------------------------------------------------*/
 
-IotMqttError_t _IotMqtt_AddSubscriptions( _mqttConnection_t * pMqttConnection,
-                                          uint16_t subscribePacketIdentifier,
-                                          const IotMqttSubscription_t * pSubscriptionList,
-                                          size_t subscriptionCount )
+static void _invokeSubscription( _mqttConnection_t * pMqttConnection,
+                                 _mqttSubscription_t * pSubscription,
+                                 IotMqttCallbackParam_t * pCallbackParam )
 {
-    IotMqttError_t status = IOT_MQTT_SUCCESS;
-    size_t i = 0;
-    _mqttSubscription_t * pNewSubscription = NULL;
-    IotLink_t * pSubscriptionLink = NULL;
-    _topicMatchParams_t topicMatchParams = { .exactMatchOnly = true };
+    void * pCallbackContext = NULL;
 
-    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+    void ( * callbackFunction )( void *,
+                                 IotMqttCallbackParam_t * ) = NULL;
 
-    for( i = 0; i < subscriptionCount; i++ )
-    {
-        /* Check if this topic filter is already registered. */
-        topicMatchParams.pTopicName = pSubscriptionList[ i ].pTopicFilter;
-        topicMatchParams.topicNameLength = pSubscriptionList[ i ].topicFilterLength;
-        pSubscriptionLink = IotListDouble_FindFirstMatch( &( pMqttConnection->subscriptionList ),
-                                                          NULL,
-                                                          _topicMatch,
-                                                          &topicMatchParams );
+    /* Subscription validation should not have allowed a NULL callback function. */
+    IotMqtt_Assert( pSubscription->callback.function != NULL );
 
-        if( pSubscriptionLink != NULL )
-        {
-            pNewSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
+    /* Copy the necessary members of the subscription before releasing the
+     * subscription list mutex. */
+    pCallbackContext = pSubscription->callback.pCallbackContext;
+    callbackFunction = pSubscription->callback.function;
 
-            /* The lengths of exactly matching topic filters must match. */
-            IotMqtt_Assert( pNewSubscription->topicFilterLength == pSubscriptionList[ i ].topicFilterLength );
+    /* Unlock the subscription list mutex. */
+    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
 
-            /* Replace the callback and packet info with the new parameters. */
-            pNewSubscription->callback = pSubscriptionList[ i ].callback;
-            pNewSubscription->packetInfo.identifier = subscribePacketIdentifier;
-            pNewSubscription->packetInfo.order = i;
-        }
-        else
-        {
-            /* Allocate memory for a new subscription. */
-            pNewSubscription = IotMqtt_MallocSubscription( sizeof( _mqttSubscription_t ) +
-                                                           pSubscriptionList[ i ].topicFilterLength );
+    /* Set the members of the callback parameter. */
+    pCallbackParam->mqttConnection = pMqttConnection;
+    pCallbackParam->u.message.pTopicFilter = pSubscription->pTopicFilter;
+    pCallbackParam->u.message.topicFilterLength = pSubscription->topicFilterLength;
 
-            if( pNewSubscription == NULL )
-            {
-                status = IOT_MQTT_NO_MEMORY;
-                break;
-            }
-            else
-            {
-                /* Clear the new subscription. */
-                ( void ) memset( pNewSubscription,
-                                 0x00,
-                                 sizeof( _mqttSubscription_t ) + pSubscriptionList[ i ].topicFilterLength );
+    /* Invoke the subscription callback. */
+    callbackFunction( pCallbackContext, pCallbackParam );
 
-                /* Set the members of the new subscription and add it to the list. */
-                pNewSubscription->packetInfo.identifier = subscribePacketIdentifier;
-                pNewSubscription->packetInfo.order = i;
-                pNewSubscription->callback = pSubscriptionList[ i ].callback;
-                pNewSubscription->topicFilterLength = pSubscriptionList[ i ].topicFilterLength;
-                ( void ) memcpy( pNewSubscription->pTopicFilter,
-                                 pSubscriptionList[ i ].pTopicFilter,
-                                 ( size_t ) ( pSubscriptionList[ i ].topicFilterLength ) );
+    /* Lock the subscription list mutex to decrement the reference count. */
+    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+}
 
-                IotListDouble_InsertHead( &( pMqttConnection->subscriptionList ),
-                                          &( pNewSubscription->link ) );
-            }
-        }
-    }
+/*-----------------------------------------------------------*/
 
-    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+static void _releaseSubscription( _mqttSubscription_t * pSubscription )
+{
+    /* Decrement the reference count. It must still be positive. */
+    ( pSubscription->references )--;
+    IotMqtt_Assert( pSubscription->references >= 0 );
 
-    /* If memory allocation failed, remove all previously added subscriptions. */
-    if( status != IOT_MQTT_SUCCESS )
+    /* Remove this subscription if it has no references and the unsubscribed
+     * flag is set. */
+    if( pSubscription->unsubscribed == true )
     {
-        _IotMqtt_RemoveSubscriptionByTopicFilter( pMqttConnection,
-                                                  pSubscriptionList,
-                                                  i );
+        /* An unsubscribed subscription should have been removed from the list. */
+        IotMqtt_Assert( IotLink_IsLinked( &( pSubscription->link ) ) == false );
+
+        /* Free subscriptions with no references. */
+        if( pSubscription->references == 0 )
+        {
+            IotMqtt_FreeSubscription( pSubscription );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
     }
     else
     {
         EMPTY_ELSE_MARKER;
     }
-
-    return status;
 }
 
 /*-----------------------------------------------------------*/
 
-void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
-                                          IotMqttCallbackParam_t * pCallbackParam )
+static void _invokeListMatches( _mqttConnection_t * pMqttConnection,
+                                IotMqttCallbackParam_t * pCallbackParam )
 {
     _mqttSubscription_t * pSubscription = NULL;
     IotLink_t * pCurrentLink = NULL, * pNextLink = NULL;
-    void * pCallbackContext = NULL;
-
-    void ( * callbackFunction )( void *,
-                                 IotMqttCallbackParam_t * ) = NULL;
     _topicMatchParams_t topicMatchParams =
     {
         .pTopicName      = pCallbackParam->u.message.info.pTopicName,
@@ -413,10 +571,6 @@ void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
         .exactMatchOnly  = false
     };
 
-    /* Prevent any other thread from modifying the subscription list while this
-     * function is searching. */
-    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
-
     /* Search the subscription list for all matching subscriptions starting at
      * the list head. */
     while( true )
@@ -439,152 +593,834 @@ void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
         /* Subscription found. Calculate pointer to subscription object. */
         pSubscription = IotLink_Container( _mqttSubscription_t, pCurrentLink, link );
 
-        /* Subscription validation should not have allowed a NULL callback function. */
-        IotMqtt_Assert( pSubscription->callback.function != NULL );
-
         /* Increment the subscription's reference count. */
         ( pSubscription->references )++;
 
-        /* Copy the necessary members of the subscription before releasing the
-         * subscription list mutex. */
-        pCallbackContext = pSubscription->callback.pCallbackContext;
-        callbackFunction = pSubscription->callback.function;
-
-        /* Unlock the subscription list mutex. */
-        IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
-
-        /* Set the members of the callback parameter. */
-        pCallbackParam->mqttConnection = pMqttConnection;
-        pCallbackParam->u.message.pTopicFilter = pSubscription->pTopicFilter;
-        pCallbackParam->u.message.topicFilterLength = pSubscription->topicFilterLength;
-
-        /* Invoke the subscription callback. */
-        callbackFunction( pCallbackContext, pCallbackParam );
-
-        /* Lock the subscription list mutex to decrement the reference count. */
-        IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
-
-        /* Decrement the reference count. It must still be positive. */
-        ( pSubscription->references )--;
-        IotMqtt_Assert( pSubscription->references >= 0 );
+        _invokeSubscription( pMqttConnection, pSubscription, pCallbackParam );
 
         /* Save the pointer to the next link in case this subscription is freed. */
         pNextLink = pCurrentLink->pNext;
 
-        /* Remove this subscription if it has no references and the unsubscribed
-         * flag is set. */
-        if( pSubscription->unsubscribed == true )
-        {
-            /* An unsubscribed subscription should have been removed from the list. */
-            IotMqtt_Assert( IotLink_IsLinked( &( pSubscription->link ) ) == false );
-
-            /* Free subscriptions with no references. */
-            if( pSubscription->references == 0 )
-            {
-                IotMqtt_FreeSubscription( pSubscription );
-            }
-            else
-            {
-                EMPTY_ELSE_MARKER;
-            }
-        }
-        else
-        {
-            EMPTY_ELSE_MARKER;
-        }
+        _releaseSubscription( pSubscription );
 
         /* Move current link pointer. */
         pCurrentLink = pNextLink;
     }
-
-    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
-
-    _IotMqtt_DecrementConnectionReferences( pMqttConnection );
 }
 
 /*-----------------------------------------------------------*/
 
-void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
-                                          uint16_t packetIdentifier,
-                                          int32_t order )
-{
-    const _packetMatchParams_t packetMatchParams =
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+    static uint32_t _indexHash( const _mqttIndexNode_t * pParent,
+                                const char * pLevel,
+                                uint16_t levelLength )
     {
-        .packetIdentifier = packetIdentifier,
-        .order            = order
-    };
+        uint16_t i = 0;
 
-    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
-    IotListDouble_RemoveAllMatches( &( pMqttConnection->subscriptionList ),
-                                    _packetMatch,
-                                    ( void * ) ( &packetMatchParams ),
-                                    IotMqtt_FreeSubscription,
-                                    offsetof( _mqttSubscription_t, link ) );
-    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
-}
+        /* Seed the hash with the parent address, then mix in the level with FNV-1a. */
+        uint32_t hash = ( ( uint32_t ) ( ( uintptr_t ) pParent >> 3 ) ) * 2654435761UL;
 
-/*-----------------------------------------------------------*/
+        for( i = 0; i < levelLength; i++ )
+        {
+            hash ^= ( uint32_t ) ( uint8_t ) pLevel[ i ];
+            hash *= 16777619UL;
+        }
 
-void _IotMqtt_RemoveSubscriptionByTopicFilter( _mqttConnection_t * pMqttConnection,
-                                               const IotMqttSubscription_t * pSubscriptionList,
-                                               size_t subscriptionCount )
-{
-    size_t i = 0;
-    _mqttSubscription_t * pSubscription = NULL;
-    IotLink_t * pSubscriptionLink = NULL;
-    _topicMatchParams_t topicMatchParams = { 0 };
+        return hash;
+    }
 
-    /* Prevent any other thread from modifying the subscription list while this
-     * function is running. */
-    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+/*-----------------------------------------------------------*/
 
-    /* Find and remove each topic filter from the list. */
-    for( i = 0; i < subscriptionCount; i++ )
+    static _mqttIndexNode_t * _indexFindChild( const _mqttSubscriptionIndex_t * pIndex,
+                                               const _mqttIndexNode_t * pParent,
+                                               const char * pLevel,
+                                               uint16_t levelLength )
     {
-        topicMatchParams.pTopicName = pSubscriptionList[ i ].pTopicFilter;
-        topicMatchParams.topicNameLength = pSubscriptionList[ i ].topicFilterLength;
-        topicMatchParams.exactMatchOnly = true;
-
-        pSubscriptionLink = IotListDouble_FindFirstMatch( &( pMqttConnection->subscriptionList ),
-                                                          NULL,
-                                                          _topicMatch,
-                                                          &topicMatchParams );
+        _mqttIndexNode_t * pNode = NULL;
+        uint32_t hash = 0;
 
-        if( pSubscriptionLink != NULL )
+        /* A node without children never needs its level hashed. */
+        if( ( pParent->childCount > 0 ) && ( pIndex->pBuckets != NULL ) )
         {
-            pSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
-
-            /* Reference count must not be negative. */
-            IotMqtt_Assert( pSubscription->references >= 0 );
-
-            /* Remove subscription from list. */
-            IotListDouble_Remove( pSubscriptionLink );
+            hash = _indexHash( pParent, pLevel, levelLength );
+            pNode = pIndex->pBuckets[ hash & ( pIndex->bucketCount - 1 ) ];
 
-            /* Check the reference count. This subscription cannot be removed if
-             * there are subscription callbacks using it. */
-            if( pSubscription->references > 0 )
-            {
-                /* Set the unsubscribed flag. The last active subscription callback
-                 * will remove and clean up this subscription. */
-                pSubscription->unsubscribed = true;
-            }
-            else
+            while( pNode != NULL )
             {
-                /* Free a subscription with no references. */
-                IotMqtt_FreeSubscription( pSubscription );
+                if( ( pNode->hash == hash ) &&
+                    ( pNode->pParent == pParent ) &&
+                    ( pNode->levelLength == levelLength ) &&
+                    ( memcmp( pNode->pLevel, pLevel, levelLength ) == 0 ) )
+                {
+                    break;
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                pNode = pNode->pNextInBucket;
             }
         }
         else
         {
             EMPTY_ELSE_MARKER;
         }
+
+        return pNode;
     }
 
-    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+/*-----------------------------------------------------------*/
+
+    static _mqttIndexNode_t * _indexAddChild( _mqttSubscriptionIndex_t * pIndex,
+                                              _mqttIndexNode_t * pParent,
+                                              const char * pLevel,
+                                              uint16_t levelLength )
+    {
+        size_t i = 0, bucketCount = 0;
+        _mqttIndexNode_t ** pBuckets = NULL;
+        _mqttIndexNode_t * pNode = NULL, * pNextNode = NULL;
+
+        pNode = _indexFindChild( pIndex, pParent, pLevel, levelLength );
+
+        if( pNode != NULL )
+        {
+            return pNode;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        /* Keep at most one node per bucket on average. If a larger table cannot
+         * be allocated, the current table is kept with longer chains. */
+        if( pIndex->nodeCount >= pIndex->bucketCount )
+        {
+            bucketCount = ( pIndex->bucketCount == 0 ) ? INDEX_INITIAL_BUCKET_COUNT :
+                          ( pIndex->bucketCount * 2 );
+            pBuckets = IotMqtt_MallocSubscriptionIndex( bucketCount * sizeof( _mqttIndexNode_t * ) );
+
+            if( pBuckets != NULL )
+            {
+                ( void ) memset( pBuckets, 0x00, bucketCount * sizeof( _mqttIndexNode_t * ) );
+
+                /* Move every node into the new table. */
+                for( i = 0; i < pIndex->bucketCount; i++ )
+                {
+                    pNode = pIndex->pBuckets[ i ];
+
+                    while( pNode != NULL )
+                    {
+                        pNextNode = pNode->pNextInBucket;
+                        pNode->pNextInBucket = pBuckets[ pNode->hash & ( bucketCount - 1 ) ];
+                        pBuckets[ pNode->hash & ( bucketCount - 1 ) ] = pNode;
+                        pNode = pNextNode;
+                    }
+                }
+
+                if( pIndex->pBuckets != NULL )
+                {
+                    IotMqtt_FreeSubscriptionIndex( pIndex->pBuckets );
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                pIndex->pBuckets = pBuckets;
+                pIndex->bucketCount = bucketCount;
+            }
+            else if( pIndex->pBuckets == NULL )
+            {
+                return NULL;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        pNode = IotMqtt_MallocSubscriptionIndex( sizeof( _mqttIndexNode_t ) + levelLength );
+
+        if( pNode != NULL )
+        {
+            ( void ) memset( pNode, 0x00, sizeof( _mqttIndexNode_t ) );
+            pNode->pParent = pParent;
+            pNode->hash = _indexHash( pParent, pLevel, levelLength );
+            pNode->levelLength = levelLength;
+            ( void ) memcpy( pNode->pLevel, pLevel, levelLength );
+
+            pNode->pNextInBucket = pIndex->pBuckets[ pNode->hash & ( pIndex->bucketCount - 1 ) ];
+            pIndex->pBuckets[ pNode->hash & ( pIndex->bucketCount - 1 ) ] = pNode;
+            ( pIndex->nodeCount )++;
+            ( pParent->childCount )++;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        return pNode;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _indexPrune( _mqttSubscriptionIndex_t * pIndex,
+                             _mqttIndexNode_t * pNode )
+    {
+        _mqttIndexNode_t * pParent = NULL;
+        _mqttIndexNode_t ** pPrevious = NULL;
+
+        while( ( pNode != pIndex->pRoot ) &&
+               ( pNode->childCount == 0 ) &&
+               ( pNode->pSubscription == NULL ) &&
+               ( pNode->pMultiLevel == NULL ) )
+        {
+            /* Unlink this node from its bucket. */
+            pPrevious = &( pIndex->pBuckets[ pNode->hash & ( pIndex->bucketCount - 1 ) ] );
+
+            while( *pPrevious != pNode )
+            {
+                pPrevious = &( ( *pPrevious )->pNextInBucket );
+            }
+
+            *pPrevious = pNode->pNextInBucket;
+
+            pParent = pNode->pParent;
+            ( pParent->childCount )--;
+            ( pIndex->nodeCount )--;
+            IotMqtt_FreeSubscriptionIndex( pNode );
+
+            pNode = pParent;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _indexInsert( _mqttSubscriptionIndex_t * pIndex,
+                              _mqttSubscription_t * pSubscription )
+    {
+        bool status = true;
+        uint16_t levelStart = 0, levelEnd = 0;
+        _mqttIndexNode_t * pNode = NULL, * pChild = NULL;
+        const char * pTopicFilter = pSubscription->pTopicFilter;
+        const uint16_t topicFilterLength = pSubscription->topicFilterLength;
+
+        /* The root is allocated with the first subscription. */
+        if( pIndex->pRoot == NULL )
+        {
+            pIndex->pRoot = IotMqtt_MallocSubscriptionIndex( sizeof( _mqttIndexNode_t ) );
+
+            if( pIndex->pRoot == NULL )
+            {
+                return false;
+            }
+            else
+            {
+                ( void ) memset( pIndex->pRoot, 0x00, sizeof( _mqttIndexNode_t ) );
+            }
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        pNode = pIndex->pRoot;
+
+        while( true )
+        {
+            levelEnd = levelStart;
+
+            while( ( levelEnd < topicFilterLength ) && ( pTopicFilter[ levelEnd ] != '/' ) )
+            {
+                levelEnd++;
+            }
+
+            /* A multi-level wildcard, which is always the last level, is kept in
+             * the node of the previous level. */
+            if( ( levelEnd == topicFilterLength ) &&
+                ( levelEnd - levelStart == 1 ) &&
+                ( pTopicFilter[ levelStart ] == '#' ) )
+            {
+                pNode->pMultiLevel = pSubscription;
+                break;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            pChild = _indexAddChild( pIndex,
+                                     pNode,
+                                     pTopicFilter + levelStart,
+                                     ( uint16_t ) ( levelEnd - levelStart ) );
+
+            if( pChild == NULL )
+            {
+                /* Free any nodes created for this subscription. */
+                _indexPrune( pIndex, pNode );
+                status = false;
+                break;
+            }
+            else
+            {
+                pNode = pChild;
+            }
+
+            if( levelEnd == topicFilterLength )
+            {
+                pNode->pSubscription = pSubscription;
+                break;
+            }
+            else
+            {
+                levelStart = ( uint16_t ) ( levelEnd + 1 );
+            }
+        }
+
+        return status;
+    }
+
+/*-----------------------------------------------------------*/
+
+    static void _indexRemove( _mqttSubscriptionIndex_t * pIndex,
+                              const _mqttSubscription_t * pSubscription )
+    {
+        uint16_t levelStart = 0, levelEnd = 0;
+        _mqttIndexNode_t * pNode = pIndex->pRoot;
+        const char * pTopicFilter = pSubscription->pTopicFilter;
+        const uint16_t topicFilterLength = pSubscription->topicFilterLength;
+
+        while( pNode != NULL )
+        {
+            levelEnd = levelStart;
+
+            while( ( levelEnd < topicFilterLength ) && ( pTopicFilter[ levelEnd ] != '/' ) )
+            {
+                levelEnd++;
+            }
+
+            if( ( levelEnd == topicFilterLength ) &&
+                ( levelEnd - levelStart == 1 ) &&
+                ( pTopicFilter[ levelStart ] == '#' ) )
+            {
+                if( pNode->pMultiLevel == pSubscription )
+                {
+                    pNode->pMultiLevel = NULL;
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                break;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            pNode = _indexFindChild( pIndex,
+                                     pNode,
+                                     pTopicFilter + levelStart,
+                                     ( uint16_t ) ( levelEnd - levelStart ) );
+
+            if( ( pNode != NULL ) && ( levelEnd == topicFilterLength ) )
+            {
+                if( pNode->pSubscription == pSubscription )
+                {
+                    pNode->pSubscription = NULL;
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                break;
+            }
+            else
+            {
+                levelStart = ( uint16_t ) ( levelEnd + 1 );
+            }
+        }
+
+        if( pNode != NULL )
+        {
+            _indexPrune( pIndex, pNode );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _indexMatch( const _mqttSubscriptionIndex_t * pIndex,
+                             const char * pTopicName,
+                             uint16_t topicNameLength,
+                             _mqttSubscription_t ** pMatches,
+                             size_t * pMatchCount )
+    {
+        IOT_FUNCTION_ENTRY( bool, true );
+        size_t i = 0, matchCount = 0, cursorCount = 0;
+        uint32_t levelStart = 0, levelEnd = 0;
+        const _mqttIndexNode_t * pNode = NULL, * pChild[ 2 ] = { NULL };
+        _indexCursor_t cursors[ IOT_MQTT_SUBSCRIPTION_INDEX_MAX_DEPTH ];
+
+        if( pIndex->pRoot != NULL )
+        {
+            cursors[ 0 ].pNode = pIndex->pRoot;
+            cursors[ 0 ].levelStart = 0;
+            cursorCount = 1;
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        /* Visit every node whose topic filter levels match the topic name so far.
+         * Each node is reached by at most one path, so no subscription is
+         * matched twice. */
+        while( cursorCount > 0 )
+        {
+            cursorCount--;
+            pNode = cursors[ cursorCount ].pNode;
+            levelStart = cursors[ cursorCount ].levelStart;
+
+            /* "level/#" matches every topic name that reaches "level", including
+             * "level" itself. */
+            if( pNode->pMultiLevel != NULL )
+            {
+                if( matchCount == IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES )
+                {
+                    IOT_SET_AND_GOTO_CLEANUP( false );
+                }
+                else
+                {
+                    pMatches[ matchCount ] = pNode->pMultiLevel;
+                    matchCount++;
+                }
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            /* All topic name levels were consumed; the topic filter must end here. */
+            if( levelStart > topicNameLength )
+            {
+                if( pNode->pSubscription != NULL )
+                {
+                    if( matchCount == IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES )
+                    {
+                        IOT_SET_AND_GOTO_CLEANUP( false );
+                    }
+                    else
+                    {
+                        pMatches[ matchCount ] = pNode->pSubscription;
+                        matchCount++;
+                    }
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                continue;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            levelEnd = levelStart;
+
+            while( ( levelEnd < topicNameLength ) && ( pTopicName[ levelEnd ] != '/' ) )
+            {
+                levelEnd++;
+            }
+
+            /* Follow both the child with this exact level and the single-level
+             * wildcard child. */
+            pChild[ 0 ] = _indexFindChild( pIndex,
+                                           pNode,
+                                           pTopicName + levelStart,
+                                           ( uint16_t ) ( levelEnd - levelStart ) );
+            pChild[ 1 ] = _indexFindChild( pIndex, pNode, "+", 1 );
+
+            /* A topic name level of "+" is not valid; don't visit the wildcard twice. */
+            if( pChild[ 0 ] == pChild[ 1 ] )
+            {
+                pChild[ 0 ] = NULL;
+            }
+            else
+            {
+                EMPTY_ELSE_MARKER;
+            }
+
+            for( i = 0; i < 2; i++ )
+            {
+                if( pChild[ i ] != NULL )
+                {
+                    if( cursorCount == IOT_MQTT_SUBSCRIPTION_INDEX_MAX_DEPTH )
+                    {
+                        IOT_SET_AND_GOTO_CLEANUP( false );
+                    }
+                    else
+                    {
+                        cursors[ cursorCount ].pNode = pChild[ i ];
+                        cursors[ cursorCount ].levelStart = levelEnd + 1;
+                        cursorCount++;
+                    }
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+            }
+        }
+
+        IOT_FUNCTION_CLEANUP_BEGIN();
+
+        *pMatchCount = matchCount;
+
+        IOT_FUNCTION_CLEANUP_END();
+    }
+
+/*-----------------------------------------------------------*/
+
+    static bool _packetMatchUnindex( const IotLink_t * pSubscriptionLink,
+                                     void * pMatch )
+    {
+        _indexPacketMatchParams_t * pParam = ( _indexPacketMatchParams_t * ) pMatch;
+        bool match = _packetMatch( pSubscriptionLink, &( pParam->packetMatchParams ) );
+
+        /* A matching subscription is removed from the list after this returns. */
+        if( match == true )
+        {
+            _indexRemove( pParam->pIndex,
+                          IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link ) );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        return match;
+    }
+
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
+/*-----------------------------------------------------------*/
+
+IotMqttError_t _IotMqtt_AddSubscriptions( _mqttConnection_t * pMqttConnection,
+                                          uint16_t subscribePacketIdentifier,
+                                          const IotMqttSubscription_t * pSubscriptionList,
+                                          size_t subscriptionCount )
+{
+    IotMqttError_t status = IOT_MQTT_SUCCESS;
+    size_t i = 0;
+    _mqttSubscription_t * pNewSubscription = NULL;
+    IotLink_t * pSubscriptionLink = NULL;
+    _topicMatchParams_t topicMatchParams = { .exactMatchOnly = true };
+
+    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+
+    for( i = 0; i < subscriptionCount; i++ )
+    {
+        /* Check if this topic filter is already registered. */
+        topicMatchParams.pTopicName = pSubscriptionList[ i ].pTopicFilter;
+        topicMatchParams.topicNameLength = pSubscriptionList[ i ].topicFilterLength;
+        pSubscriptionLink = IotListDouble_FindFirstMatch( &( pMqttConnection->subscriptionList ),
+                                                          NULL,
+                                                          _topicMatch,
+                                                          &topicMatchParams );
+
+        if( pSubscriptionLink != NULL )
+        {
+            pNewSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
+
+            /* The lengths of exactly matching topic filters must match. */
+            IotMqtt_Assert( pNewSubscription->topicFilterLength == pSubscriptionList[ i ].topicFilterLength );
+
+            /* Replace the callback and packet info with the new parameters. */
+            pNewSubscription->callback = pSubscriptionList[ i ].callback;
+            pNewSubscription->packetInfo.identifier = subscribePacketIdentifier;
+            pNewSubscription->packetInfo.order = i;
+        }
+        else
+        {
+            /* Allocate memory for a new subscription. */
+            pNewSubscription = IotMqtt_MallocSubscription( sizeof( _mqttSubscription_t ) +
+                                                           pSubscriptionList[ i ].topicFilterLength );
+
+            if( pNewSubscription == NULL )
+            {
+                status = IOT_MQTT_NO_MEMORY;
+                break;
+            }
+            else
+            {
+                /* Clear the new subscription. */
+                ( void ) memset( pNewSubscription,
+                                 0x00,
+                                 sizeof( _mqttSubscription_t ) + pSubscriptionList[ i ].topicFilterLength );
+
+                /* Set the members of the new subscription and add it to the list. */
+                pNewSubscription->packetInfo.identifier = subscribePacketIdentifier;
+                pNewSubscription->packetInfo.order = i;
+                pNewSubscription->callback = pSubscriptionList[ i ].callback;
+                pNewSubscription->topicFilterLength = pSubscriptionList[ i ].topicFilterLength;
+                ( void ) memcpy( pNewSubscription->pTopicFilter,
+                                 pSubscriptionList[ i ].pTopicFilter,
+                                 ( size_t ) ( pSubscriptionList[ i ].topicFilterLength ) );
+
+                #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+                    if( _indexInsert( &( pMqttConnection->subscriptionIndex ),
+                                      pNewSubscription ) == false )
+                    {
+                        IotMqtt_FreeSubscription( pNewSubscription );
+                        status = IOT_MQTT_NO_MEMORY;
+                        break;
+                    }
+                    else
+                    {
+                        EMPTY_ELSE_MARKER;
+                    }
+                #endif
+
+                IotListDouble_InsertHead( &( pMqttConnection->subscriptionList ),
+                                          &( pNewSubscription->link ) );
+            }
+        }
+    }
+
+    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+
+    /* If memory allocation failed, remove all previously added subscriptions. */
+    if( status != IOT_MQTT_SUCCESS )
+    {
+        _IotMqtt_RemoveSubscriptionByTopicFilter( pMqttConnection,
+                                                  pSubscriptionList,
+                                                  i );
+    }
+    else
+    {
+        EMPTY_ELSE_MARKER;
+    }
+
+    return status;
 }
 
 /*-----------------------------------------------------------*/
 
+void _IotMqtt_InvokeSubscriptionCallback( _mqttConnection_t * pMqttConnection,
+                                          IotMqttCallbackParam_t * pCallbackParam )
+{
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        size_t i = 0, matchCount = 0;
+        _mqttSubscription_t * pMatches[ IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES ] = { NULL };
+    #endif
+
+    /* Prevent any other thread from modifying the subscription list while this
+     * function is searching. */
+    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        if( _indexMatch( &( pMqttConnection->subscriptionIndex ),
+                         pCallbackParam->u.message.info.pTopicName,
+                         pCallbackParam->u.message.info.topicNameLength,
+                         pMatches,
+                         &matchCount ) == true )
+        {
+            /* Reference all matches first so that none are freed while the
+             * callbacks of the others run. */
+            for( i = 0; i < matchCount; i++ )
+            {
+                ( pMatches[ i ]->references )++;
+            }
+
+            for( i = 0; i < matchCount; i++ )
+            {
+                /* Skip subscriptions removed by an earlier callback. */
+                if( IotLink_IsLinked( &( pMatches[ i ]->link ) ) == true )
+                {
+                    _invokeSubscription( pMqttConnection, pMatches[ i ], pCallbackParam );
+                }
+                else
+                {
+                    EMPTY_ELSE_MARKER;
+                }
+
+                _releaseSubscription( pMatches[ i ] );
+            }
+        }
+        else
+        {
+            /* Too many matches for the index lookup; search the list instead. */
+            _invokeListMatches( pMqttConnection, pCallbackParam );
+        }
+    #else /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+        _invokeListMatches( pMqttConnection, pCallbackParam );
+    #endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
+    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+
+    _IotMqtt_DecrementConnectionReferences( pMqttConnection );
+}
+
+/*-----------------------------------------------------------*/
+
+void _IotMqtt_RemoveSubscriptionByPacket( _mqttConnection_t * pMqttConnection,
+                                          uint16_t packetIdentifier,
+                                          int32_t order )
+{
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        const _indexPacketMatchParams_t packetMatchParams =
+        {
+            .packetMatchParams =
+            {
+                .packetIdentifier = packetIdentifier,
+                .order            = order
+            },
+            .pIndex = &( pMqttConnection->subscriptionIndex )
+        };
+        bool ( * packetMatch )( const IotLink_t *,
+                                void * ) = _packetMatchUnindex;
+    #else
+        const _packetMatchParams_t packetMatchParams =
+        {
+            .packetIdentifier = packetIdentifier,
+            .order            = order
+        };
+        bool ( * packetMatch )( const IotLink_t *,
+                                void * ) = _packetMatch;
+    #endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
+    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+    IotListDouble_RemoveAllMatches( &( pMqttConnection->subscriptionList ),
+                                    packetMatch,
+                                    ( void * ) ( &packetMatchParams ),
+                                    IotMqtt_FreeSubscription,
+                                    offsetof( _mqttSubscription_t, link ) );
+    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void _IotMqtt_RemoveSubscriptionByTopicFilter( _mqttConnection_t * pMqttConnection,
+                                               const IotMqttSubscription_t * pSubscriptionList,
+                                               size_t subscriptionCount )
+{
+    size_t i = 0;
+    _mqttSubscription_t * pSubscription = NULL;
+    IotLink_t * pSubscriptionLink = NULL;
+    _topicMatchParams_t topicMatchParams = { 0 };
+
+    /* Prevent any other thread from modifying the subscription list while this
+     * function is running. */
+    IotMutex_Lock( &( pMqttConnection->subscriptionMutex ) );
+
+    /* Find and remove each topic filter from the list. */
+    for( i = 0; i < subscriptionCount; i++ )
+    {
+        topicMatchParams.pTopicName = pSubscriptionList[ i ].pTopicFilter;
+        topicMatchParams.topicNameLength = pSubscriptionList[ i ].topicFilterLength;
+        topicMatchParams.exactMatchOnly = true;
+
+        pSubscriptionLink = IotListDouble_FindFirstMatch( &( pMqttConnection->subscriptionList ),
+                                                          NULL,
+                                                          _topicMatch,
+                                                          &topicMatchParams );
+
+        if( pSubscriptionLink != NULL )
+        {
+            pSubscription = IotLink_Container( _mqttSubscription_t, pSubscriptionLink, link );
+
+            /* Reference count must not be negative. */
+            IotMqtt_Assert( pSubscription->references >= 0 );
+
+            /* Remove subscription from list. */
+            IotListDouble_Remove( pSubscriptionLink );
+
+            #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+                _indexRemove( &( pMqttConnection->subscriptionIndex ), pSubscription );
+            #endif
+
+            /* Check the reference count. This subscription cannot be removed if
+             * there are subscription callbacks using it. */
+            if( pSubscription->references > 0 )
+            {
+                /* Set the unsubscribed flag. The last active subscription callback
+                 * will remove and clean up this subscription. */
+                pSubscription->unsubscribed = true;
+            }
+            else
+            {
+                /* Free a subscription with no references. */
+                IotMqtt_FreeSubscription( pSubscription );
+            }
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+    }
+
+    IotMutex_Unlock( &( pMqttConnection->subscriptionMutex ) );
+}
+
+/*-----------------------------------------------------------*/
+
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+    void _IotMqtt_DestroySubscriptionIndex( _mqttConnection_t * pMqttConnection )
+    {
+        size_t i = 0;
+        _mqttIndexNode_t * pNode = NULL, * pNextNode = NULL;
+        _mqttSubscriptionIndex_t * pIndex = &( pMqttConnection->subscriptionIndex );
+
+        for( i = 0; i < pIndex->bucketCount; i++ )
+        {
+            pNode = pIndex->pBuckets[ i ];
+
+            while( pNode != NULL )
+            {
+                pNextNode = pNode->pNextInBucket;
+                IotMqtt_FreeSubscriptionIndex( pNode );
+                pNode = pNextNode;
+            }
+        }
+
+        if( pIndex->pBuckets != NULL )
+        {
+            IotMqtt_FreeSubscriptionIndex( pIndex->pBuckets );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        if( pIndex->pRoot != NULL )
+        {
+            IotMqtt_FreeSubscriptionIndex( pIndex->pRoot );
+        }
+        else
+        {
+            EMPTY_ELSE_MARKER;
+        }
+
+        ( void ) memset( pIndex, 0x00, sizeof( _mqttSubscriptionIndex_t ) );
+    }
+
+/*-----------------------------------------------------------*/
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
 bool IotMqtt_IsSubscribed( IotMqttConnection_t mqttConnection,
                            const char * pTopicFilter,
                            uint16_t topicFilterLength,
@@ -138,6 +138,10 @@
  * (http://pubs.opengroup.org/onlinepubs/9699919799/functions/free.html).
  */
     void IotMqtt_FreeSubscription( void * ptr );
+
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        #error "IOT_MQTT_SUBSCRIPTION_INDEX is not supported when IOT_STATIC_MEMORY_ONLY is 1."
+    #endif
 #else /* if IOT_STATIC_MEMORY_ONLY == 1 */
     #include <stdlib.h>
 
@@ -172,6 +176,24 @@
     #ifndef IotMqtt_FreeSubscription
         #define IotMqtt_FreeSubscription    free
     #endif
+
+/**
+ * @brief Allocate a node or the hash table of a subscription index. This
+ * function should have the same signature as [malloc]
+ * (http://pubs.opengroup.org/onlinepubs/9699919799/functions/malloc.html).
+ */
+    #ifndef IotMqtt_MallocSubscriptionIndex
+        #define IotMqtt_MallocSubscriptionIndex    malloc
+    #endif
+
+/**
+ * @brief Free a node or the hash table of a subscription index. This function
+ * should have the same signature as [free]
+ * (http://pubs.opengroup.org/onlinepubs/9699919799/functions/free.html).
+ */
+    #ifndef IotMqtt_FreeSubscriptionIndex
+        #define IotMqtt_FreeSubscriptionIndex    free
+    #endif
 #endif /* if IOT_STATIC_MEMORY_ONLY == 1 */
 
 /**
@@ -181,19 +203,35 @@
  * Provide default values for undefined configuration constants.
  */
 #ifndef AWS_IOT_MQTT_ENABLE_METRICS
-    #define AWS_IOT_MQTT_ENABLE_METRICS             ( 1 )
+    #define AWS_IOT_MQTT_ENABLE_METRICS                ( 1 )
 #endif
 #ifndef IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES
-    #define IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES    ( 0 )
+    #define IOT_MQTT_ENABLE_SERIALIZER_OVERRIDES       ( 0 )
 #endif
 #ifndef IOT_MQTT_RESPONSE_WAIT_MS
-    #define IOT_MQTT_RESPONSE_WAIT_MS               ( 1000 )
+    #define IOT_MQTT_RESPONSE_WAIT_MS                  ( 1000 )
+#endif
+#ifndef IOT_MQTT_RECEIVE_BUFFER_SIZE
+    #define IOT_MQTT_RECEIVE_BUFFER_SIZE               ( 0 )
 #endif
 #ifndef IOT_MQTT_RETRY_MS_CEILING
-    #define IOT_MQTT_RETRY_MS_CEILING               ( 60000 )
+    #define IOT_MQTT_RETRY_MS_CEILING                  ( 60000 )
+#endif
+#ifndef IOT_MQTT_SUBSCRIPTION_INDEX
+    #define IOT_MQTT_SUBSCRIPTION_INDEX                ( 0 )
+#endif
+#ifndef IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES
+    #define IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES    ( 8 )
+#endif
+#ifndef IOT_MQTT_SUBSCRIPTION_INDEX_MAX_DEPTH
+    #define IOT_MQTT_SUBSCRIPTION_INDEX_MAX_DEPTH      ( 16 )
 #endif
 /** @endcond */
 
+#if ( IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 ) && ( IOT_MQTT_RECEIVE_BUFFER_SIZE < 5 )
+    #error "IOT_MQTT_RECEIVE_BUFFER_SIZE must be 0 or at least 5."
+#endif
+
 /**
  * @brief Marks the empty statement of an `else` branch.
  *
@@ -247,6 +285,41 @@
 
 /*---------------------- MQTT internal data structures ----------------------*/
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief A node of the topic filter index, representing one topic filter level.
+ *
+ * Nodes are not linked to their children. Instead, a child is found by looking
+ * up its parent and level in #_mqttSubscriptionIndex_t.pBuckets.
+ */
+    typedef struct _mqttIndexNode
+    {
+        struct _mqttIndexNode * pParent;           /**< @brief The node of the previous level; `NULL` for the root. */
+        struct _mqttIndexNode * pNextInBucket;     /**< @brief The next node with the same hash bucket. */
+        struct _mqttSubscription * pSubscription;  /**< @brief The subscription whose topic filter ends at this level. */
+        struct _mqttSubscription * pMultiLevel;    /**< @brief The subscription whose topic filter is this level followed by `/#`. */
+        size_t childCount;                         /**< @brief Number of nodes whose parent is this node. */
+        uint32_t hash;                             /**< @brief Hash of #_mqttIndexNode_t.pParent and #_mqttIndexNode_t.pLevel. */
+        uint16_t levelLength;                      /**< @brief Length of #_mqttIndexNode_t.pLevel. */
+        char pLevel[];                             /**< @brief The topic filter level, which may be `+`. */
+    } _mqttIndexNode_t;
+
+/**
+ * @brief A topic filter index over the subscriptions of an MQTT connection.
+ *
+ * The index mirrors #_mqttConnection_t.subscriptionList, which remains the
+ * owner of all subscriptions. It is guarded by #_mqttConnection_t.subscriptionMutex.
+ */
+    typedef struct _mqttSubscriptionIndex
+    {
+        _mqttIndexNode_t * pRoot;      /**< @brief The node before the first topic filter level; allocated with the first subscription. */
+        _mqttIndexNode_t ** pBuckets;  /**< @brief Hash table of all nodes except the root. */
+        size_t bucketCount;            /**< @brief Number of entries in #_mqttSubscriptionIndex_t.pBuckets; always a power of 2. */
+        size_t nodeCount;              /**< @brief Number of nodes in #_mqttSubscriptionIndex_t.pBuckets. */
+    } _mqttSubscriptionIndex_t;
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
 /**
  * @brief Represents an MQTT connection.
  */
@@ -271,6 +344,16 @@ typedef struct _mqttConnection
     IotListDouble_t subscriptionList;            /**< @brief Holds subscriptions associated with this connection. */
     IotMutex_t subscriptionMutex;                /**< @brief Grants exclusive access to the subscription list. */
 
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        _mqttSubscriptionIndex_t subscriptionIndex; /**< @brief Topic filter index of the subscription list. */
+    #endif
+
+    #if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+        size_t receiveStart;                                    /**< @brief Offset of the first unprocessed byte in the receive buffer. */
+        size_t receiveEnd;                                      /**< @brief Offset one past the last received byte in the receive buffer. */
+        uint8_t pReceiveBuffer[ IOT_MQTT_RECEIVE_BUFFER_SIZE ]; /**< @brief Incoming data that has not been processed yet. */
+    #endif
+
     bool keepAliveFailure;                       /**< @brief Failure flag for keep-alive operation. */
     uint32_t keepAliveMs;                        /**< @brief Keep-alive interval in milliseconds. Its max value (per spec) is 65,535,000. */
     uint32_t nextKeepAliveMs;                    /**< @brief Relative delay for next keep-alive job. */
@@ -862,6 +945,19 @@ void _IotMqtt_RemoveSubscriptionByTopicFilter( _mqttConnection_t * pMqttConnecti
                                                const IotMqttSubscription_t * pSubscriptionList,
                                                size_t subscriptionCount );
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Free the topic filter index of an MQTT connection.
+ *
+ * The subscriptions themselves are not freed; they must already have been
+ * removed from the subscription list.
+ *
+ * @param[in] pMqttConnection The MQTT connection that owns the index.
+ */
+    void _IotMqtt_DestroySubscriptionIndex( _mqttConnection_t * pMqttConnection );
+#endif
+
 /*------------------ MQTT connection management functions -------------------*/
 
 /**
@@ -91,4 +91,18 @@ bool IotTestMqtt_topicMatch( const IotLink_t * pSubscriptionLink,
 bool IotTestMqtt_packetMatch( const IotLink_t * pSubscriptionLink,
                               void * pMatch );
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Test access function for #_indexMatch.
+ *
+ * @see #_indexMatch.
+ */
+    bool IotTestMqtt_indexMatch( const _mqttSubscriptionIndex_t * pIndex,
+                                 const char * pTopicName,
+                                 uint16_t topicNameLength,
+                                 _mqttSubscription_t ** pMatches,
+                                 size_t * pMatchCount );
+#endif
+
 #endif /* ifndef IOT_TEST_ACCESS_MQTT_H_ */
@@ -38,6 +38,14 @@ bool IotTestMqtt_topicMatch( const IotLink_t * pSubscriptionLink,
 bool IotTestMqtt_packetMatch( const IotLink_t * pSubscriptionLink,
                               void * pMatch );
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+    bool IotTestMqtt_indexMatch( const _mqttSubscriptionIndex_t * pIndex,
+                                 const char * pTopicName,
+                                 uint16_t topicNameLength,
+                                 _mqttSubscription_t ** pMatches,
+                                 size_t * pMatchCount );
+#endif
+
 /*-----------------------------------------------------------*/
 
 bool IotTestMqtt_topicMatch( const IotLink_t * pSubscriptionLink,
@@ -55,3 +63,16 @@ bool IotTestMqtt_packetMatch( const IotLink_t * pSubscriptionLink,
 }
 
 /*-----------------------------------------------------------*/
+
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+    bool IotTestMqtt_indexMatch( const _mqttSubscriptionIndex_t * pIndex,
+                                 const char * pTopicName,
+                                 uint16_t topicNameLength,
+                                 _mqttSubscription_t ** pMatches,
+                                 size_t * pMatchCount )
+    {
+        return _indexMatch( pIndex, pTopicName, topicNameLength, pMatches, pMatchCount );
+    }
+
+/*-----------------------------------------------------------*/
+#endif
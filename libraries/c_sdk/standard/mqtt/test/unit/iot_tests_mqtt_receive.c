@@ -477,6 +477,37 @@ static size_t _receive( void * pConnection,
 
 /*-----------------------------------------------------------*/
 
+#if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+
+/**
+ * @brief Simulates a network function that receives all available data.
+ */
+    static size_t _receiveUpto( void * pConnection,
+                                uint8_t * pBuffer,
+                                size_t bufferSize )
+    {
+        _receiveContext_t * pReceiveContext = pConnection;
+        size_t bytesReceived = pReceiveContext->dataLength - pReceiveContext->dataIndex;
+
+        TEST_ASSERT_NOT_EQUAL( 0, bufferSize );
+
+        if( bytesReceived > bufferSize )
+        {
+            bytesReceived = bufferSize;
+        }
+
+        ( void ) memcpy( pBuffer,
+                         pReceiveContext->pData + pReceiveContext->dataIndex,
+                         bytesReceived );
+
+        pReceiveContext->dataIndex += bytesReceived;
+
+        return bytesReceived;
+    }
+#endif /* if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 */
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief A network close function that reports if it was invoked.
  */
@@ -614,6 +645,7 @@ TEST_GROUP_RUNNER( MQTT_Unit_Receive )
     RUN_TEST_CASE( MQTT_Unit_Receive, UnsubackValid );
     RUN_TEST_CASE( MQTT_Unit_Receive, UnsubackInvalid );
     RUN_TEST_CASE( MQTT_Unit_Receive, Pingresp );
+    RUN_TEST_CASE( MQTT_Unit_Receive, BufferedReceive );
 }
 
 /*-----------------------------------------------------------*/
@@ -1733,3 +1765,107 @@ TEST( MQTT_Unit_Receive, Pingresp )
 }
 
 /*-----------------------------------------------------------*/
+
+/**
+ * @brief Tests that @ref mqtt_function_receivecallback processes every packet
+ * in the receive buffer, and never waits for more data than the current packet.
+ */
+TEST( MQTT_Unit_Receive, BufferedReceive )
+{
+    #if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0
+        _mqttOperation_t publish1 = INITIALIZE_OPERATION( IOT_MQTT_PUBLISH_TO_SERVER );
+        _mqttOperation_t publish2 = INITIALIZE_OPERATION( IOT_MQTT_PUBLISH_TO_SERVER );
+        const IotMqttSerializer_t * pSerializer = _pMqttConnection->pSerializer;
+        IotMqttSerializer_t serializer = *pSerializer;
+        _receiveContext_t receiveContext = { 0 };
+        uint8_t pStream[ sizeof( _pPubackTemplate ) * 2 + sizeof( _pPingrespTemplate ) ] = { 0 };
+
+        /* Overrides for packet type and remaining length bypass the receive buffer. */
+        serializer.getPacketType = NULL;
+        serializer.getRemainingLength = NULL;
+        _pMqttConnection->pSerializer = &serializer;
+
+        /* Create the wait semaphores so notifications don't crash. */
+        publish2.u.operation.packetIdentifier = 2;
+        TEST_ASSERT_EQUAL_INT( true, IotSemaphore_Create( &( publish1.u.operation.notify.waitSemaphore ),
+                                                          0,
+                                                          10 ) );
+        TEST_ASSERT_EQUAL_INT( true, IotSemaphore_Create( &( publish2.u.operation.notify.waitSemaphore ),
+                                                          0,
+                                                          10 ) );
+
+        /* Place PUBACK 1, PINGRESP, and PUBACK 2 in one stream. */
+        ( void ) memcpy( pStream, _pPubackTemplate, sizeof( _pPubackTemplate ) );
+        ( void ) memcpy( pStream + sizeof( _pPubackTemplate ), _pPingrespTemplate, sizeof( _pPingrespTemplate ) );
+        ( void ) memcpy( pStream + sizeof( _pPubackTemplate ) + sizeof( _pPingrespTemplate ),
+                         _pPubackTemplate,
+                         sizeof( _pPubackTemplate ) );
+        pStream[ sizeof( pStream ) - 1 ] = 0x02;
+
+        /* When the network can receive all available data, one receive callback
+         * processes all packets. */
+        {
+            _operationResetAndPush( &publish1 );
+            _operationResetAndPush( &publish2 );
+            _pMqttConnection->keepAliveFailure = true;
+            _networkInterface.receiveUpto = _receiveUpto;
+
+            receiveContext.pData = pStream;
+            receiveContext.dataLength = sizeof( pStream );
+            receiveContext.dataIndex = 0;
+            IotMqtt_ReceiveCallback( &receiveContext, _pMqttConnection );
+
+            TEST_ASSERT_EQUAL( sizeof( pStream ), receiveContext.dataIndex );
+            TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, publish1.u.operation.status );
+            TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, publish2.u.operation.status );
+            TEST_ASSERT_EQUAL_INT( false, _pMqttConnection->keepAliveFailure );
+        }
+
+        /* Otherwise, each receive callback reads exactly one packet. */
+        {
+            _operationResetAndPush( &publish1 );
+            _operationResetAndPush( &publish2 );
+            _pMqttConnection->keepAliveFailure = true;
+            _networkInterface.receiveUpto = NULL;
+
+            receiveContext.dataIndex = 0;
+            IotMqtt_ReceiveCallback( &receiveContext, _pMqttConnection );
+
+            TEST_ASSERT_EQUAL( sizeof( _pPubackTemplate ), receiveContext.dataIndex );
+            TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, publish1.u.operation.status );
+            TEST_ASSERT_EQUAL( IOT_MQTT_STATUS_PENDING, publish2.u.operation.status );
+
+            IotMqtt_ReceiveCallback( &receiveContext, _pMqttConnection );
+            TEST_ASSERT_EQUAL_INT( false, _pMqttConnection->keepAliveFailure );
+
+            IotMqtt_ReceiveCallback( &receiveContext, _pMqttConnection );
+            TEST_ASSERT_EQUAL( sizeof( pStream ), receiveContext.dataIndex );
+            TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, publish2.u.operation.status );
+        }
+
+        /* A packet cut off by a network error closes the connection. */
+        {
+            _networkInterface.receiveUpto = _receiveUpto;
+
+            receiveContext.dataLength = sizeof( _pPubackTemplate ) - 1;
+            receiveContext.dataIndex = 0;
+            IotMqtt_ReceiveCallback( &receiveContext, _pMqttConnection );
+
+            TEST_ASSERT_EQUAL_INT( true, _networkCloseCalled );
+            TEST_ASSERT_EQUAL_INT( true, _disconnectCallbackCalled );
+            TEST_ASSERT_EQUAL( _pMqttConnection->receiveEnd, _pMqttConnection->receiveStart );
+        }
+
+        _networkInterface.receiveUpto = NULL;
+        _pMqttConnection->pSerializer = pSerializer;
+        IotSemaphore_Destroy( &( publish1.u.operation.notify.waitSemaphore ) );
+        IotSemaphore_Destroy( &( publish2.u.operation.notify.waitSemaphore ) );
+    #endif /* if IOT_MQTT_RECEIVE_BUFFER_SIZE > 0 */
+
+    /* This test does not use the overrides for packet type and remaining length. */
+    _deserializeOverrideCalled = true;
+    _getPacketTypeCalled = true;
+    _getRemainingLengthCalled = true;
+}
+
+/*-----------------------------------------------------------*/
@@ -244,6 +244,22 @@ static void _publishCallback( void * pArgument,
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief A subscription callback function that counts its invocations.
+ */
+static void _countingCallback( void * pArgument,
+                               IotMqttCallbackParam_t * pPublish )
+{
+    int32_t * pInvokeCount = ( int32_t * ) pArgument;
+
+    /* Silence warnings about unused parameters. */
+    ( void ) pPublish;
+
+    ( *pInvokeCount )++;
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief A subscription callback function that blocks on a semaphore until signaled.
  */
@@ -259,6 +275,63 @@ static void _blockingCallback( void * pArgument,
     IotSemaphore_Wait( pSemaphore );
 }
 
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Count the subscriptions matching a topic name by searching the
+ * subscription list of #_pMqttConnection.
+ */
+    static size_t _listMatchCount( const char * pTopicName )
+    {
+        size_t matchCount = 0;
+        IotLink_t * pSubscriptionLink = NULL;
+        _topicMatchParams_t topicMatchParams = { 0 };
+
+        topicMatchParams.pTopicName = pTopicName;
+        topicMatchParams.topicNameLength = ( uint16_t ) strlen( pTopicName );
+
+        while( true )
+        {
+            pSubscriptionLink = IotListDouble_FindFirstMatch( &( _pMqttConnection->subscriptionList ),
+                                                              pSubscriptionLink,
+                                                              IotTestMqtt_topicMatch,
+                                                              &topicMatchParams );
+
+            if( pSubscriptionLink == NULL )
+            {
+                break;
+            }
+
+            matchCount++;
+            pSubscriptionLink = pSubscriptionLink->pNext;
+        }
+
+        return matchCount;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Count the subscriptions matching a topic name with the topic filter
+ * index of #_pMqttConnection.
+ */
+    static size_t _indexMatchCount( const char * pTopicName )
+    {
+        size_t matchCount = 0;
+        _mqttSubscription_t * pMatches[ IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES ] = { NULL };
+
+        TEST_ASSERT_EQUAL_INT( true, IotTestMqtt_indexMatch( &( _pMqttConnection->subscriptionIndex ),
+                                                             pTopicName,
+                                                             ( uint16_t ) strlen( pTopicName ),
+                                                             pMatches,
+                                                             &matchCount ) );
+
+        return matchCount;
+    }
+
+/*-----------------------------------------------------------*/
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -331,6 +404,12 @@ TEST_GROUP_RUNNER( MQTT_Unit_Subscription )
     RUN_TEST_CASE( MQTT_Unit_Subscription, SubscriptionReferences );
     RUN_TEST_CASE( MQTT_Unit_Subscription, TopicFilterMatchTrue );
     RUN_TEST_CASE( MQTT_Unit_Subscription, TopicFilterMatchFalse );
+
+    #if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+        RUN_TEST_CASE( MQTT_Unit_Subscription, IndexMatch );
+        RUN_TEST_CASE( MQTT_Unit_Subscription, IndexFallback );
+        RUN_TEST_CASE( MQTT_Unit_Subscription, IndexBenchmark );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -910,6 +989,7 @@ TEST( MQTT_Unit_Subscription, TopicFilterMatchTrue )
         TEST_TOPIC_MATCH( "aws//iot", "aws/+/iot", false, true );
         TEST_TOPIC_MATCH( "aws//iot", "aws//+", false, true );
         TEST_TOPIC_MATCH( "aws///iot", "aws/+/+/iot", false, true );
+        TEST_TOPIC_MATCH( "a/b/c", "a/+/c", false, true );
 
         /* Multi level wildcard matching. */
         TEST_TOPIC_MATCH( "/aws/iot/shadow", "#", false, true );
@@ -918,6 +998,7 @@ TEST( MQTT_Unit_Subscription, TopicFilterMatchTrue )
         TEST_TOPIC_MATCH( "aws/iot/shadow", "aws/iot/#", false, true );
         TEST_TOPIC_MATCH( "aws/iot/shadow/thing", "aws/iot/#", false, true );
         TEST_TOPIC_MATCH( "aws", "aws/#", false, true );
+        TEST_TOPIC_MATCH( "a/b", "a/#", false, true );
 
         /* Both topic level and multi level wildcard. */
         TEST_TOPIC_MATCH( "aws/iot/shadow/thing/temp", "aws/+/shadow/#", false, true );
@@ -958,6 +1039,8 @@ TEST( MQTT_Unit_Subscription, TopicFilterMatchFalse )
         TEST_TOPIC_MATCH( "aws/iot/shadow", "aws/+", false, false );
         TEST_TOPIC_MATCH( "aws/iot/shadow", "aws/+/thing", false, false );
         TEST_TOPIC_MATCH( "/aws", "+", false, false );
+        TEST_TOPIC_MATCH( "a/b/c", "a/+/c", true, false );
+        TEST_TOPIC_MATCH( "a/b/c", "a/+/d", false, false );
 
         /* Multi level wildcard matching. */
         TEST_TOPIC_MATCH( "aws/iot/shadow", "iot/#", false, false );
@@ -971,3 +1054,225 @@ TEST( MQTT_Unit_Subscription, TopicFilterMatchFalse )
 }
 
 /*-----------------------------------------------------------*/
+
+#if IOT_MQTT_SUBSCRIPTION_INDEX == 1
+
+/**
+ * @brief Tests the subscriptions found by the topic filter index, and that the
+ * index is emptied when subscriptions are removed.
+ */
+    TEST( MQTT_Unit_Subscription, IndexMatch )
+    {
+        size_t i = 0;
+        IotMqttSubscription_t subscription[ 12 ] = { IOT_MQTT_SUBSCRIPTION_INITIALIZER };
+
+        const char * const pTopicFilters[ 12 ] =
+        {
+            "/aws",         "/+",             "aws/+",
+            "aws/iot/#",    "#",              "/#",
+            "aws//+",       "aws/+/shadow",   "+/+",
+            "aws/+/shadow/#", "aws/iot",      "aws/+/+/iot"
+        };
+
+        /* Topic names and the number of the above topic filters they match. */
+        const struct
+        {
+            const char * pTopicName;
+            size_t matchCount;
+        } expected[] =
+        {
+            { "/aws",                      5 },
+            { "/aws/iot",                  2 },
+            { "aws",                       1 },
+            { "aws/",                      3 },
+            { "aws/iot",                   5 },
+            { "aws/iot/shadow",            4 },
+            { "aws//iot",                  2 },
+            { "aws///iot",                 2 },
+            { "aws/iot/shadow/thing/temp", 3 },
+            { "iot/aws",                   2 }
+        };
+
+        for( i = 0; i < 12; i++ )
+        {
+            subscription[ i ].pTopicFilter = pTopicFilters[ i ];
+            subscription[ i ].topicFilterLength = ( uint16_t ) strlen( pTopicFilters[ i ] );
+            subscription[ i ].callback.function = SUBSCRIPTION_CALLBACK_FUNCTION;
+        }
+
+        /* Add the first half in one packet and the second half in another. */
+        TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( _pMqttConnection,
+                                                                        1,
+                                                                        subscription,
+                                                                        6 ) );
+        TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( _pMqttConnection,
+                                                                        2,
+                                                                        &( subscription[ 6 ] ),
+                                                                        6 ) );
+
+        for( i = 0; i < sizeof( expected ) / sizeof( expected[ 0 ] ); i++ )
+        {
+            TEST_ASSERT_EQUAL_UINT32( expected[ i ].matchCount,
+                                      _indexMatchCount( expected[ i ].pTopicName ) );
+        }
+
+        /* Remove the first packet by topic filter and the second by packet. */
+        _IotMqtt_RemoveSubscriptionByTopicFilter( _pMqttConnection, subscription, 6 );
+        TEST_ASSERT_EQUAL_UINT32( 1, _indexMatchCount( "/aws" ) );
+        TEST_ASSERT_EQUAL_UINT32( 2, _indexMatchCount( "aws/iot/shadow" ) );
+
+        _IotMqtt_RemoveSubscriptionByPacket( _pMqttConnection, 2, -1 );
+        TEST_ASSERT_EQUAL_UINT32( 0, _indexMatchCount( "aws/iot/shadow" ) );
+
+        /* All nodes except the root should be freed. */
+        TEST_ASSERT_EQUAL_INT( true, IotListDouble_IsEmpty( &( _pMqttConnection->subscriptionList ) ) );
+        TEST_ASSERT_EQUAL_UINT32( 0, _pMqttConnection->subscriptionIndex.nodeCount );
+        TEST_ASSERT_EQUAL_UINT32( 0, _pMqttConnection->subscriptionIndex.pRoot->childCount );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Tests that every subscription callback is invoked when a PUBLISH
+ * matches more subscriptions than the index lookup can return.
+ */
+    TEST( MQTT_Unit_Subscription, IndexFallback )
+    {
+        size_t i = 0;
+        int32_t invokeCount = 0;
+        size_t topicNameLength = 0;
+        char pTopicName[ 3 * ( IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES + 1 ) + 1 ] = { 0 };
+        char pTopicFilters[ IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES + 1 ][ sizeof( pTopicName ) + 2 ] = { { 0 } };
+        IotMqttSubscription_t subscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+        IotMqttCallbackParam_t callbackParam = { .u.message = { 0 } };
+        _mqttSubscription_t * pMatches[ IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES ] = { NULL };
+        size_t matchCount = 0;
+
+        subscription.callback.function = _countingCallback;
+        subscription.callback.pCallbackContext = &invokeCount;
+
+        /* Subscribe to "#", "a/#", "a/a/#", ... which all match "a/a/a/...". */
+        for( i = 0; i <= IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES; i++ )
+        {
+            subscription.pTopicFilter = pTopicFilters[ i ];
+            subscription.topicFilterLength = ( uint16_t ) snprintf( pTopicFilters[ i ],
+                                                                    sizeof( pTopicFilters[ i ] ),
+                                                                    "%s%s#",
+                                                                    pTopicName,
+                                                                    ( i == 0 ) ? "" : "/" );
+
+            TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( _pMqttConnection,
+                                                                            1,
+                                                                            &subscription,
+                                                                            1 ) );
+
+            topicNameLength += ( size_t ) snprintf( pTopicName + topicNameLength,
+                                                    sizeof( pTopicName ) - topicNameLength,
+                                                    "%sa",
+                                                    ( i == 0 ) ? "" : "/" );
+        }
+
+        /* The index lookup should report that it cannot hold all matches. */
+        TEST_ASSERT_EQUAL_INT( false, IotTestMqtt_indexMatch( &( _pMqttConnection->subscriptionIndex ),
+                                                              pTopicName,
+                                                              ( uint16_t ) topicNameLength,
+                                                              pMatches,
+                                                              &matchCount ) );
+
+        callbackParam.u.message.info.pTopicName = pTopicName;
+        callbackParam.u.message.info.topicNameLength = ( uint16_t ) topicNameLength;
+        callbackParam.u.message.info.pPayload = "";
+        callbackParam.u.message.info.payloadLength = 0;
+
+        TEST_ASSERT_EQUAL_INT( true, _IotMqtt_IncrementConnectionReferences( _pMqttConnection ) );
+        _IotMqtt_InvokeSubscriptionCallback( _pMqttConnection, &callbackParam );
+
+        TEST_ASSERT_EQUAL_INT32( IOT_MQTT_SUBSCRIPTION_INDEX_MAX_MATCHES + 1, invokeCount );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compares the time taken to find the subscriptions matching a topic
+ * name with the subscription list and with the topic filter index.
+ *
+ * Each subscription is a Shadow-style filter "things/<n>/shadow/+" for a
+ * different thing. The times are printed for 10, 100 and 1000 subscriptions.
+ */
+    TEST( MQTT_Unit_Subscription, IndexBenchmark )
+    {
+        size_t i = 0, round = 0, lookup = 0, matchCount = 0;
+        uint64_t startTime = 0, listTime = 0, indexTime = 0;
+        char pTopicFilter[ 40 ] = { 0 };
+        char pTopicNames[ 8 ][ 40 ] = { { 0 } };
+        IotMqttSubscription_t subscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+        const size_t subscriptionCounts[ 3 ] = { 10, 100, 1000 };
+        const size_t lookupCount = 1000;
+
+        subscription.pTopicFilter = pTopicFilter;
+        subscription.callback.function = SUBSCRIPTION_CALLBACK_FUNCTION;
+
+        for( round = 0; round < 3; round++ )
+        {
+            for( i = 0; i < subscriptionCounts[ round ]; i++ )
+            {
+                subscription.topicFilterLength = ( uint16_t ) snprintf( pTopicFilter,
+                                                                        sizeof( pTopicFilter ),
+                                                                        "things/%lu/shadow/+",
+                                                                        ( unsigned long ) i );
+                TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, _IotMqtt_AddSubscriptions( _pMqttConnection,
+                                                                                ( uint16_t ) ( round + 1 ),
+                                                                                &subscription,
+                                                                                1 ) );
+            }
+
+            /* Half of the topic names match one subscription; the rest match none. */
+            for( i = 0; i < 8; i++ )
+            {
+                ( void ) snprintf( pTopicNames[ i ],
+                                   sizeof( pTopicNames[ i ] ),
+                                   ( i % 2 == 0 ) ? "things/%lu/shadow/update" : "things/%lu/jobs/notify",
+                                   ( unsigned long ) ( ( i * subscriptionCounts[ round ] ) / 8 ) );
+
+                TEST_ASSERT_EQUAL_UINT32( ( i % 2 == 0 ) ? 1 : 0, _listMatchCount( pTopicNames[ i ] ) );
+                TEST_ASSERT_EQUAL_UINT32( ( i % 2 == 0 ) ? 1 : 0, _indexMatchCount( pTopicNames[ i ] ) );
+            }
+
+            startTime = IotClock_GetTimeMs();
+
+            for( lookup = 0; lookup < lookupCount; lookup++ )
+            {
+                matchCount += _listMatchCount( pTopicNames[ lookup % 8 ] );
+            }
+
+            listTime = IotClock_GetTimeMs() - startTime;
+            startTime = IotClock_GetTimeMs();
+
+            for( lookup = 0; lookup < lookupCount; lookup++ )
+            {
+                matchCount += _indexMatchCount( pTopicNames[ lookup % 8 ] );
+            }
+
+            indexTime = IotClock_GetTimeMs() - startTime;
+
+            TEST_ASSERT_EQUAL_UINT32( lookupCount, matchCount );
+            matchCount = 0;
+
+            UnityPrint( "IndexBenchmark " );
+            UnityPrintNumber( ( UNITY_INT ) subscriptionCounts[ round ] );
+            UnityPrint( " subscriptions, " );
+            UnityPrintNumber( ( UNITY_INT ) lookupCount );
+            UnityPrint( " lookups: list " );
+            UnityPrintNumber( ( UNITY_INT ) listTime );
+            UnityPrint( " ms, index " );
+            UnityPrintNumber( ( UNITY_INT ) indexTime );
+            UnityPrint( " ms." );
+            UNITY_PRINT_EOL();
+
+            _IotMqtt_RemoveSubscriptionByPacket( _pMqttConnection, ( uint16_t ) ( round + 1 ), -1 );
+            TEST_ASSERT_EQUAL_UINT32( 0, _pMqttConnection->subscriptionIndex.nodeCount );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+#endif /* if IOT_MQTT_SUBSCRIPTION_INDEX == 1 */
@@ -152,6 +152,11 @@
 
 #define IOT_SERIALIZER_DECODER_ITERATOR_INITIALIZER            NULL
 
+/* initializers for the token arena of _IotSerializerJsonArenaDecoder and a decoder object using it */
+#define IOT_SERIALIZER_JSON_ARENA_INITIALIZER( pTokenArray, arrayLength )    { .pTokens = ( pTokenArray ), .tokenCount = ( arrayLength ), .usedCount = 0 }
+
+#define IOT_SERIALIZER_JSON_ARENA_DECODER_OBJECT_INITIALIZER( pArena )       { .type = IOT_SERIALIZER_UNDEFINED, .u.pHandle = ( pArena ) }
+
 /* helper macro to create scalar data */
 #define IotSerializer_ScalarSignedInt( signedIntValue )                                                                        \
     ( IotSerializerScalarData_t ) { .value = { .u.signedInt = ( signedIntValue ) }, .type = IOT_SERIALIZER_SCALAR_SIGNED_INT } \
@@ -245,6 +250,39 @@ typedef struct IotSerializerDecoderObject
 
 typedef void * IotSerializerDecoderIterator_t;
 
+/**
+ * @brief A value of a JSON document tokenized by _IotSerializerJsonArenaDecoder.
+ *
+ * Tokens are stored in document order and a container is followed by all of
+ * its descendants, so the value after a token starts span tokens later. The
+ * children of a map are its keys and values in turn.
+ */
+typedef struct IotSerializerJsonToken
+{
+    IotSerializerDataType_t type;            /**< Type of the value. Keys are text strings. */
+    const char * pStart;                     /**< First character of the value. Strings exclude the quotes. */
+    size_t length;                           /**< Length of the value. Strings exclude the quotes. */
+    size_t span;                             /**< Number of tokens in the value, itself included. */
+    struct IotSerializerJsonToken * pCursor; /**< Child the iterator over this container is at. */
+} IotSerializerJsonToken_t;
+
+/**
+ * @brief Caller-provided token storage of _IotSerializerJsonArenaDecoder.
+ *
+ * The decoder object passed to init must hold a pointer to the arena, see
+ * IOT_SERIALIZER_JSON_ARENA_DECODER_OBJECT_INITIALIZER. The document is
+ * tokenized into the arena once by init. find, stepIn, get and next are then
+ * lookups in the arena and nothing is allocated. The arena and the document
+ * must outlive every object decoded from them. There is one iterator per
+ * container, so a container must not be iterated twice at the same time.
+ */
+typedef struct IotSerializerJsonArena
+{
+    IotSerializerJsonToken_t * pTokens; /**< Token storage. */
+    size_t tokenCount;                  /**< Number of tokens pTokens can hold. */
+    size_t usedCount;                   /**< Number of tokens used by the document, set by init. */
+} IotSerializerJsonArena_t;
+
 /**
  * @brief Table containing function pointers for encoder APIs.
  */
@@ -453,4 +491,6 @@ extern IotSerializerEncodeInterface_t _IotSerializerJsonEncoder;
 
 extern IotSerializerDecodeInterface_t _IotSerializerJsonDecoder;
 
+extern IotSerializerDecodeInterface_t _IotSerializerJsonArenaDecoder;
+
 #endif /* ifndef IOT_SERIALIZER_H_ */
@@ -31,6 +31,11 @@
  * A special type called binary string is also supported as a value type. By default
  * binary strings are base-64 decoded.
  * The file implements decoder interface in aws_iot_serialize.h.
+ *
+ * Two decoders are provided. _IotSerializerJsonDecoder scans the document
+ * text on every call and allocates a handle for each container it returns.
+ * _IotSerializerJsonArenaDecoder tokenizes the document once into a token
+ * arena provided by the caller and then only indexes the tokens.
  */
 
 #include <string.h>
@@ -85,6 +90,29 @@ static void parseTextString( const char * pBuffer,
                              const size_t bufLength,
                              size_t * pOffset );
 
+static IotSerializerError_t _arenaInit( IotSerializerDecoderObject_t * pDecoderObject,
+                                        const uint8_t * pDataBuffer,
+                                        size_t maxSize );
+
+static IotSerializerError_t _arenaFind( IotSerializerDecoderObject_t * pDecoderObject,
+                                        const char * pKey,
+                                        IotSerializerDecoderObject_t * pValueObject );
+
+static IotSerializerError_t _arenaGet( IotSerializerDecoderIterator_t iterator,
+                                       IotSerializerDecoderObject_t * pValueObject );
+
+static IotSerializerError_t _arenaStepIn( IotSerializerDecoderObject_t * pDecoderObject,
+                                          IotSerializerDecoderIterator_t * pIterator );
+
+static bool _arenaIsEndOfContainer( IotSerializerDecoderIterator_t iterator );
+
+static IotSerializerError_t _arenaNext( IotSerializerDecoderIterator_t iterator );
+
+static IotSerializerError_t _arenaStepOut( IotSerializerDecoderIterator_t iterator,
+                                           IotSerializerDecoderObject_t * pDecoderObject );
+
+static void _arenaDestroy( IotSerializerDecoderObject_t * pDecoderObject );
+
 IotSerializerDecodeInterface_t _IotSerializerJsonDecoder =
 {
     .init             = _init,
@@ -97,6 +125,18 @@ IotSerializerDecodeInterface_t _IotSerializerJsonDecoder =
     .destroy          = _destroy
 };
 
+IotSerializerDecodeInterface_t _IotSerializerJsonArenaDecoder =
+{
+    .init             = _arenaInit,
+    .find             = _arenaFind,
+    .stepIn           = _arenaStepIn,
+    .isEndOfContainer = _arenaIsEndOfContainer,
+    .get              = _arenaGet,
+    .next             = _arenaNext,
+    .stepOut          = _arenaStepOut,
+    .destroy          = _arenaDestroy
+};
+
 typedef struct _jsonContainer
 {
     const char * pStart;
@@ -278,6 +318,35 @@ static void parseTextString( const char * pBuffer,
 
 /*-----------------------------------------------------------*/
 
+static IotSerializerError_t _decodeByteString( const char * pString,
+                                               size_t length,
+                                               IotSerializerDecoderObject_t * pValue )
+{
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+    int decodeRet = mbedtls_base64_decode( ( unsigned char * ) ( pValue->u.value.u.string.pString ),
+                                           pValue->u.value.u.string.length,
+                                           &( pValue->u.value.u.string.length ),
+                                           ( const unsigned char * ) pString, length );
+
+    switch( decodeRet )
+    {
+        case MBEDTLS_ERR_BASE64_INVALID_CHARACTER:
+            error = IOT_SERIALIZER_INTERNAL_FAILURE;
+            break;
+
+        case MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL:
+            error = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+            break;
+
+        default:
+            break;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
 static IotSerializerError_t parseTokenValue( const char * pBuffer,
                                              const size_t bufLength,
                                              size_t * pOffset,
@@ -371,7 +440,6 @@ static IotSerializerError_t parseTokenValue( const char * pBuffer,
         case IOT_SERIALIZER_SCALAR_TEXT_STRING:
            {
                size_t start = ++( *pOffset ), length;
-               int decodeRet;
                parseTextString( pBuffer, bufLength, pOffset );
                length = ( *pOffset ) - start; /* Don't include the last quotes of a string */
 
@@ -379,24 +447,7 @@ static IotSerializerError_t parseTokenValue( const char * pBuffer,
                {
                    if( pValue->type == IOT_SERIALIZER_SCALAR_BYTE_STRING )
                    {
-                       decodeRet = mbedtls_base64_decode( ( unsigned char * ) ( pValue->u.value.u.string.pString ),
-                                                          pValue->u.value.u.string.length,
-                                                          &( pValue->u.value.u.string.length ),
-                                                          ( const unsigned char * ) ( pBuffer + start ), length );
-
-                       switch( decodeRet )
-                       {
-                           case MBEDTLS_ERR_BASE64_INVALID_CHARACTER:
-                               error = IOT_SERIALIZER_INTERNAL_FAILURE;
-                               break;
-
-                           case MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL:
-                               error = IOT_SERIALIZER_BUFFER_TOO_SMALL;
-                               break;
-
-                           default:
-                               break;
-                       }
+                       error = _decodeByteString( pBuffer + start, length, pValue );
                    }
                    else
                    {
@@ -821,3 +872,424 @@ static void _destroy( IotSerializerDecoderObject_t * pDecoderObject )
         }
     }
 }
+
+/*-----------------------------------------------------------*/
+
+static bool _matchLiteral( const char * pBuffer,
+                           size_t bufLength,
+                           size_t offset,
+                           const char * pLiteral,
+                           size_t literalLength )
+{
+    return( ( bufLength - offset >= literalLength ) &&
+            ( strncmp( pBuffer + offset, pLiteral, literalLength ) == 0 ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Tokenize a JSON document in a single pass. While a container is open, its
+ * length counts its children and its cursor links to the enclosing open
+ * container, so no stack is needed. Both are set to their final values when
+ * the container is closed.
+ */
+static IotSerializerError_t _tokenize( const char * pBuffer,
+                                       size_t bufLength,
+                                       IotSerializerJsonArena_t * pArena )
+{
+    IotSerializerJsonToken_t * pOpen = NULL, * pToken, * pParent;
+    IotSerializerDataType_t type;
+    size_t offset = 0, end;
+    bool isRootClosed = false;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    pArena->usedCount = 0;
+
+    while( ( error == IOT_SERIALIZER_SUCCESS ) && ( isRootClosed == false ) )
+    {
+        _skipWhiteSpacesAndDelimeters( pBuffer, bufLength, &offset );
+
+        if( ( offset >= bufLength ) || ( pBuffer[ offset ] == '\0' ) )
+        {
+            /* The document ended inside a container. */
+            error = IOT_SERIALIZER_INVALID_INPUT;
+            break;
+        }
+
+        if( ( pBuffer[ offset ] == _STOP_CHAR_MAP ) || ( pBuffer[ offset ] == _STOP_CHAR_ARRAY ) )
+        {
+            if( ( pOpen == NULL ) ||
+                ( ( pBuffer[ offset ] == _STOP_CHAR_MAP ) != ( pOpen->type == IOT_SERIALIZER_CONTAINER_MAP ) ) ||
+                ( ( pOpen->type == IOT_SERIALIZER_CONTAINER_MAP ) && ( ( pOpen->length % 2 ) != 0 ) ) )
+            {
+                /* Unbalanced brackets or a key without a value. */
+                error = IOT_SERIALIZER_INVALID_INPUT;
+                break;
+            }
+
+            offset++;
+            pParent = pOpen->pCursor;
+            pOpen->span = ( size_t ) ( &( pArena->pTokens[ pArena->usedCount ] ) - pOpen );
+            pOpen->length = ( size_t ) ( ( pBuffer + offset ) - pOpen->pStart );
+            pOpen->pCursor = NULL;
+            pOpen = pParent;
+            isRootClosed = ( pOpen == NULL );
+            continue;
+        }
+
+        type = _getTokenType( pBuffer, offset );
+
+        if( ( ( pOpen == NULL ) && ( type != IOT_SERIALIZER_CONTAINER_MAP ) && ( type != IOT_SERIALIZER_CONTAINER_ARRAY ) ) ||
+            ( ( pOpen != NULL ) && ( pOpen->type == IOT_SERIALIZER_CONTAINER_MAP ) &&
+              ( ( pOpen->length % 2 ) == 0 ) && ( type != IOT_SERIALIZER_SCALAR_TEXT_STRING ) ) )
+        {
+            /* The document is not a container, or a map key is not a string. */
+            error = IOT_SERIALIZER_INVALID_INPUT;
+            break;
+        }
+
+        if( pArena->usedCount >= pArena->tokenCount )
+        {
+            error = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        pToken = &( pArena->pTokens[ pArena->usedCount ] );
+        pArena->usedCount++;
+
+        if( pOpen != NULL )
+        {
+            pOpen->length++;
+        }
+
+        pToken->type = type;
+        pToken->pStart = pBuffer + offset;
+        pToken->length = 0;
+        pToken->span = 1;
+        pToken->pCursor = NULL;
+        end = offset + 1;
+
+        switch( type )
+        {
+            case IOT_SERIALIZER_CONTAINER_MAP:
+            case IOT_SERIALIZER_CONTAINER_ARRAY:
+                pToken->pCursor = pOpen;
+                pOpen = pToken;
+                break;
+
+            case IOT_SERIALIZER_SCALAR_TEXT_STRING:
+                parseTextString( pBuffer, bufLength, &end );
+
+                if( end >= bufLength )
+                {
+                    error = IOT_SERIALIZER_INVALID_INPUT;
+                }
+                else
+                {
+                    pToken->pStart = pBuffer + offset + 1;
+                    pToken->length = end - ( offset + 1 );
+                    end++; /* Skip the closing quote. */
+                }
+
+                break;
+
+            case IOT_SERIALIZER_SCALAR_SIGNED_INT:
+
+                while( ( end < bufLength ) &&
+                       ( ( ( pBuffer[ end ] >= '0' ) && ( pBuffer[ end ] <= '9' ) ) ||
+                         ( pBuffer[ end ] == '.' ) || ( pBuffer[ end ] == 'e' ) || ( pBuffer[ end ] == 'E' ) ||
+                         ( pBuffer[ end ] == '+' ) || ( pBuffer[ end ] == '-' ) ) )
+                {
+                    end++;
+                }
+
+                pToken->length = end - offset;
+                break;
+
+            case IOT_SERIALIZER_SCALAR_BOOL:
+
+                if( _matchLiteral( pBuffer, bufLength, offset, "true", 4 ) )
+                {
+                    end = offset + 4;
+                }
+                else if( _matchLiteral( pBuffer, bufLength, offset, "false", 5 ) )
+                {
+                    end = offset + 5;
+                }
+                else
+                {
+                    error = IOT_SERIALIZER_INVALID_INPUT;
+                }
+
+                pToken->length = end - offset;
+                break;
+
+            case IOT_SERIALIZER_SCALAR_NULL:
+
+                if( _matchLiteral( pBuffer, bufLength, offset, "null", 4 ) )
+                {
+                    end = offset + 4;
+                    pToken->length = 4;
+                }
+                else
+                {
+                    error = IOT_SERIALIZER_INVALID_INPUT;
+                }
+
+                break;
+
+            default:
+                error = IOT_SERIALIZER_INVALID_INPUT;
+                break;
+        }
+
+        offset = end;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaTokenValue( const IotSerializerJsonToken_t * pToken,
+                                              IotSerializerDecoderObject_t * pValue )
+{
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+    int64_t val = 0;
+    size_t i = 0;
+    bool isNegative = false;
+
+    switch( pToken->type )
+    {
+        case IOT_SERIALIZER_CONTAINER_MAP:
+        case IOT_SERIALIZER_CONTAINER_ARRAY:
+            pValue->type = pToken->type;
+            pValue->u.pHandle = ( void * ) pToken;
+            break;
+
+        case IOT_SERIALIZER_SCALAR_SIGNED_INT:
+
+            if( pToken->pStart[ 0 ] == '-' )
+            {
+                isNegative = true;
+                i++;
+            }
+
+            for( ; ( i < pToken->length ) && ( pToken->pStart[ i ] >= '0' ) && ( pToken->pStart[ i ] <= '9' ); i++ )
+            {
+                val = ( val * 10 ) + ( pToken->pStart[ i ] - '0' );
+            }
+
+            pValue->type = pToken->type;
+            pValue->u.value.u.signedInt = isNegative ? -val : val;
+            break;
+
+        case IOT_SERIALIZER_SCALAR_BOOL:
+            pValue->type = pToken->type;
+            pValue->u.value.u.booleanValue = ( pToken->pStart[ 0 ] == 't' );
+            break;
+
+        case IOT_SERIALIZER_SCALAR_NULL:
+            pValue->type = pToken->type;
+            break;
+
+        case IOT_SERIALIZER_SCALAR_TEXT_STRING:
+
+            if( pValue->type == IOT_SERIALIZER_SCALAR_BYTE_STRING )
+            {
+                error = _decodeByteString( pToken->pStart, pToken->length, pValue );
+            }
+            else
+            {
+                pValue->type = pToken->type;
+                pValue->u.value.u.string.pString = ( uint8_t * ) pToken->pStart;
+                pValue->u.value.u.string.length = pToken->length;
+            }
+
+            break;
+
+        default:
+            error = IOT_SERIALIZER_UNDEFINED_TYPE;
+            break;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaInit( IotSerializerDecoderObject_t * pDecoderObject,
+                                        const uint8_t * pDataBuffer,
+                                        size_t maxSize )
+{
+    IotSerializerJsonArena_t * pArena = ( IotSerializerJsonArena_t * ) pDecoderObject->u.pHandle;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    if( ( pArena == NULL ) || ( pArena->pTokens == NULL ) || ( pDataBuffer == NULL ) )
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+    else
+    {
+        error = _tokenize( ( const char * ) pDataBuffer, maxSize, pArena );
+    }
+
+    if( error == IOT_SERIALIZER_SUCCESS )
+    {
+        pDecoderObject->type = pArena->pTokens[ 0 ].type;
+        pDecoderObject->u.pHandle = &( pArena->pTokens[ 0 ] );
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaFind( IotSerializerDecoderObject_t * pDecoderObject,
+                                        const char * pKey,
+                                        IotSerializerDecoderObject_t * pValueObject )
+{
+    const IotSerializerJsonToken_t * pMap, * pEntry, * pEnd;
+    size_t keyLength;
+    IotSerializerError_t error = IOT_SERIALIZER_NOT_FOUND;
+
+    if( ( pDecoderObject->type != IOT_SERIALIZER_CONTAINER_MAP ) || ( pDecoderObject->u.pHandle == NULL ) )
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+    else
+    {
+        pMap = ( const IotSerializerJsonToken_t * ) pDecoderObject->u.pHandle;
+        pEnd = pMap + pMap->span;
+        keyLength = strlen( pKey );
+
+        /* Each entry is a key token followed by its value. */
+        for( pEntry = pMap + 1; pEntry < pEnd; pEntry = ( pEntry + 1 ) + pEntry[ 1 ].span )
+        {
+            if( ( pEntry->length == keyLength ) &&
+                ( strncmp( pEntry->pStart, pKey, keyLength ) == 0 ) )
+            {
+                error = _arenaTokenValue( pEntry + 1, pValueObject );
+                break;
+            }
+        }
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaStepIn( IotSerializerDecoderObject_t * pDecoderObject,
+                                          IotSerializerDecoderIterator_t * pIterator )
+{
+    IotSerializerJsonToken_t * pContainer;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    if( _isValidContainer( pDecoderObject ) && ( pDecoderObject->u.pHandle != NULL ) )
+    {
+        /* The container token is the iterator. Its cursor starts at the first child. */
+        pContainer = ( IotSerializerJsonToken_t * ) pDecoderObject->u.pHandle;
+        pContainer->pCursor = pContainer + 1;
+        *pIterator = ( IotSerializerDecoderIterator_t ) pContainer;
+    }
+    else
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static bool _arenaIsEndOfContainer( IotSerializerDecoderIterator_t iterator )
+{
+    const IotSerializerJsonToken_t * pContainer = ( const IotSerializerJsonToken_t * ) iterator;
+
+    return( ( pContainer != NULL ) &&
+            ( pContainer->pCursor >= pContainer + pContainer->span ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaGet( IotSerializerDecoderIterator_t iterator,
+                                       IotSerializerDecoderObject_t * pValueObject )
+{
+    const IotSerializerJsonToken_t * pContainer = ( const IotSerializerJsonToken_t * ) iterator;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    if( ( pContainer == NULL ) || ( pContainer->pCursor == NULL ) )
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+    else if( _arenaIsEndOfContainer( iterator ) )
+    {
+        error = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+    }
+    else
+    {
+        error = _arenaTokenValue( pContainer->pCursor, pValueObject );
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaNext( IotSerializerDecoderIterator_t iterator )
+{
+    IotSerializerJsonToken_t * pContainer = ( IotSerializerJsonToken_t * ) iterator;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    if( ( pContainer == NULL ) || ( pContainer->pCursor == NULL ) )
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+    else if( _arenaIsEndOfContainer( iterator ) )
+    {
+        error = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+    }
+    else
+    {
+        pContainer->pCursor += pContainer->pCursor->span;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static IotSerializerError_t _arenaStepOut( IotSerializerDecoderIterator_t iterator,
+                                           IotSerializerDecoderObject_t * pDecoderObject )
+{
+    IotSerializerJsonToken_t * pContainer = ( IotSerializerJsonToken_t * ) iterator;
+    IotSerializerError_t error = IOT_SERIALIZER_SUCCESS;
+
+    if( ( pContainer == NULL ) || !_isValidContainer( pDecoderObject ) ||
+        ( pDecoderObject->u.pHandle != ( void * ) pContainer ) )
+    {
+        error = IOT_SERIALIZER_INVALID_INPUT;
+    }
+    else if( _arenaIsEndOfContainer( iterator ) )
+    {
+        pContainer->pCursor = NULL;
+    }
+    else
+    {
+        error = IOT_SERIALIZER_INTERNAL_FAILURE;
+    }
+
+    return error;
+}
+
+/*-----------------------------------------------------------*/
+
+static void _arenaDestroy( IotSerializerDecoderObject_t * pDecoderObject )
+{
+    /* The tokens belong to the arena, so there is nothing to free. */
+    if( _isValidContainer( pDecoderObject ) )
+    {
+        pDecoderObject->u.pHandle = NULL;
+    }
+}
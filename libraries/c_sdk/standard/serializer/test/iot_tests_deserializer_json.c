@@ -96,3 +96,156 @@ TEST( Full_Serializer_JSON_deserialize, find_nested_key_array_of_objects_value )
 
     _decoder.destroy( &nestedObject );
 }
+
+/*-----------------------------------------------------------*/
+
+#define _ARENA_TOKEN_COUNT    ( 48 )
+
+static IotSerializerJsonToken_t arenaTokens[ _ARENA_TOKEN_COUNT ];
+static IotSerializerJsonArena_t arena = IOT_SERIALIZER_JSON_ARENA_INITIALIZER( arenaTokens, _ARENA_TOKEN_COUNT );
+static IotSerializerDecoderObject_t arenaRootObject = IOT_SERIALIZER_JSON_ARENA_DECODER_OBJECT_INITIALIZER( &arena );
+
+TEST_GROUP( Full_Serializer_JSON_arena_deserialize );
+
+TEST_SETUP( Full_Serializer_JSON_arena_deserialize )
+{
+    /* Tokenize the whole document into the arena. */
+    arenaRootObject.u.pHandle = &arena;
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.init( &arenaRootObject, test_data, test_data_length ) );
+}
+
+TEST_TEAR_DOWN( Full_Serializer_JSON_arena_deserialize )
+{
+    _IotSerializerJsonArenaDecoder.destroy( &arenaRootObject );
+    TEST_ASSERT_NULL( arenaRootObject.u.pHandle );
+}
+
+TEST_GROUP_RUNNER( Full_Serializer_JSON_arena_deserialize )
+{
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, find_key_scalar_values );
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, find_nested_key_array_of_objects_value );
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, iterate_array_of_objects );
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, find_missing_key );
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, arena_too_small );
+    RUN_TEST_CASE( Full_Serializer_JSON_arena_deserialize, malformed_document );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, find_key_scalar_values )
+{
+    const char name[] = "xQueueSend";
+    IotSerializerDecoderObject_t valueObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_CONTAINER_MAP, arenaRootObject.type );
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "name", &valueObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SCALAR_TEXT_STRING, valueObject.type );
+    TEST_ASSERT_EQUAL( strlen( name ), valueObject.u.value.u.string.length );
+    TEST_ASSERT_EQUAL( 0, strncmp( ( const char * ) valueObject.u.value.u.string.pString, name, strlen( name ) ) );
+
+    /* The string points into the document rather than into a copy. */
+    TEST_ASSERT_TRUE( ( valueObject.u.value.u.string.pString > test_data ) &&
+                      ( valueObject.u.value.u.string.pString < test_data + test_data_length ) );
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "number", &valueObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SCALAR_SIGNED_INT, valueObject.type );
+    TEST_ASSERT_EQUAL( 3, valueObject.u.value.u.signedInt );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, find_nested_key_array_of_objects_value )
+{
+    IotSerializerDecoderObject_t nestedObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+    IotSerializerDecoderObject_t valueObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "related", &nestedObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_CONTAINER_MAP, nestedObject.type );
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.find( &nestedObject, "types", &valueObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_CONTAINER_ARRAY, valueObject.type );
+
+    /* A key of the nested map is not a key of the root map. */
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_NOT_FOUND,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "id", &valueObject ) );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, iterate_array_of_objects )
+{
+    const char * const names[] = { "xQueue", "pvItemToQueue", "xTicksToWait" };
+    IotSerializerDecoderObject_t arrayObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+    IotSerializerDecoderObject_t elementObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+    IotSerializerDecoderObject_t valueObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+    IotSerializerDecoderIterator_t iterator = IOT_SERIALIZER_DECODER_ITERATOR_INITIALIZER;
+    size_t count = 0;
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "parameters", &arrayObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.stepIn( &arrayObject, &iterator ) );
+
+    while( !_IotSerializerJsonArenaDecoder.isEndOfContainer( iterator ) )
+    {
+        TEST_ASSERT_LESS_THAN( 3, count );
+        TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                           _IotSerializerJsonArenaDecoder.get( iterator, &elementObject ) );
+        TEST_ASSERT_EQUAL( IOT_SERIALIZER_CONTAINER_MAP, elementObject.type );
+
+        TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                           _IotSerializerJsonArenaDecoder.find( &elementObject, "name", &valueObject ) );
+        TEST_ASSERT_EQUAL( strlen( names[ count ] ), valueObject.u.value.u.string.length );
+        TEST_ASSERT_EQUAL( 0, strncmp( ( const char * ) valueObject.u.value.u.string.pString,
+                                       names[ count ], strlen( names[ count ] ) ) );
+
+        TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                           _IotSerializerJsonArenaDecoder.find( &elementObject, "index", &valueObject ) );
+        TEST_ASSERT_EQUAL( count + 1, valueObject.u.value.u.signedInt );
+
+        TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS, _IotSerializerJsonArenaDecoder.next( iterator ) );
+        count++;
+    }
+
+    TEST_ASSERT_EQUAL( 3, count );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_SUCCESS,
+                       _IotSerializerJsonArenaDecoder.stepOut( iterator, &arrayObject ) );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, find_missing_key )
+{
+    IotSerializerDecoderObject_t valueObject = IOT_SERIALIZER_DECODER_OBJECT_INITIALIZER;
+
+    /* "nam" is a prefix of an existing key. */
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_NOT_FOUND,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "nam", &valueObject ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_NOT_FOUND,
+                       _IotSerializerJsonArenaDecoder.find( &arenaRootObject, "missing", &valueObject ) );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, arena_too_small )
+{
+    IotSerializerJsonToken_t smallTokens[ 4 ];
+    IotSerializerJsonArena_t smallArena = IOT_SERIALIZER_JSON_ARENA_INITIALIZER( smallTokens, 4 );
+    IotSerializerDecoderObject_t decoderObject = IOT_SERIALIZER_JSON_ARENA_DECODER_OBJECT_INITIALIZER( &smallArena );
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_BUFFER_TOO_SMALL,
+                       _IotSerializerJsonArenaDecoder.init( &decoderObject, test_data, test_data_length ) );
+}
+
+TEST( Full_Serializer_JSON_arena_deserialize, malformed_document )
+{
+    static const uint8_t unclosed[] = "{ \"name\" : \"xQueueSend\", \"returns\" : { \"type\" : 1 }";
+    static const uint8_t missingValue[] = "{ \"name\" }";
+    static const uint8_t numericKey[] = "{ 1 : 2 }";
+    IotSerializerJsonToken_t tokens[ 8 ];
+    IotSerializerJsonArena_t localArena = IOT_SERIALIZER_JSON_ARENA_INITIALIZER( tokens, 8 );
+    IotSerializerDecoderObject_t decoderObject = IOT_SERIALIZER_JSON_ARENA_DECODER_OBJECT_INITIALIZER( &localArena );
+
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_INVALID_INPUT,
+                       _IotSerializerJsonArenaDecoder.init( &decoderObject, unclosed, sizeof( unclosed ) ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_INVALID_INPUT,
+                       _IotSerializerJsonArenaDecoder.init( &decoderObject, missingValue, sizeof( missingValue ) ) );
+    TEST_ASSERT_EQUAL( IOT_SERIALIZER_INVALID_INPUT,
+                       _IotSerializerJsonArenaDecoder.init( &decoderObject, numericKey, sizeof( numericKey ) ) );
+}
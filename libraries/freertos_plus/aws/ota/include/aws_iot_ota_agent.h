@@ -41,6 +41,11 @@
 /* Include for console serial output. */
 #include "iot_logging_task.h"
 
+/* The simulators keep the OTA file in a stdio FILE. */
+#if WIN32 || __linux__
+    #include <stdio.h>
+#endif
+
 /* Evaluates to the length of a constant string defined like 'static const char str[]= "xyz"; */
 #define CONST_STRLEN( s )    ( ( ( uint32_t ) sizeof( s ) ) - 1UL )
 
@@ -219,7 +224,7 @@ typedef struct
     {
         int32_t lFileHandle;     /*!< Device internal file pointer or handle.
                                   * File type is handle after file is open for write. */
-        #if WIN32
+        #if WIN32 || __linux__
             FILE * pxFile;       /*!< File type is stdio FILE structure after file is open for write. */
         #endif
         uint8_t * pucFile;       /*!< File type is RAM/Flash image pointer after file is open for write. */
@@ -237,6 +242,10 @@ typedef struct
     uint8_t * pucCertFilepath;   /*!< Pathname of the certificate file used to validate the receive file. */
     uint32_t ulUpdaterVersion;   /*!< Used by OTA self-test detection, the version of FW that did the update. */
     bool_t xIsInSelfTest;        /*!< True if the job is in self test mode. */
+    void * pvSigVerifyContext;   /*!< Signature verification context holding the hash of the whole file, or NULL.
+                                  * The PAL finishes the check with it instead of reading the file back. */
+    bool_t xIsResuming;          /*!< True if the download resumes from a checkpoint, so the file already
+                                  * holds received blocks that must be kept when it is opened. */
 } OTA_FileContext_t;
 
 
@@ -390,6 +399,35 @@ typedef int16_t (* pxOTAPALWriteBlockCallback_t)( OTA_FileContext_t * const C,
                                                   uint8_t * const pacData,
                                                   uint32_t iBlockSize );
 
+/**
+ * @brief OTA Save Checkpoint callback function typedef.
+ *
+ * The user may register a callback function when initializing the OTA Agent. This
+ * callback saves the download checkpoint of a file to non-volatile storage, replacing
+ * any previous checkpoint. A NULL checkpoint with a size of zero deletes it.
+ *
+ * @param[in] C File context of the download.
+ * @param[in] pucCheckpoint The checkpoint data, or NULL.
+ * @param[in] ulSize Size of the checkpoint data.
+ */
+typedef OTA_Err_t (* pxOTAPALSaveCheckpointCallback_t)( OTA_FileContext_t * const C,
+                                                        const uint8_t * pucCheckpoint,
+                                                        uint32_t ulSize );
+
+/**
+ * @brief OTA Load Checkpoint callback function typedef.
+ *
+ * The user may register a callback function when initializing the OTA Agent. This
+ * callback reads the last checkpoint saved by the save checkpoint callback.
+ *
+ * @param[in] C File context of the download.
+ * @param[out] pucCheckpoint Buffer for the checkpoint data.
+ * @param[in] ulSize Size of the buffer. The checkpoint is only valid if it has exactly this size.
+ */
+typedef OTA_Err_t (* pxOTAPALLoadCheckpointCallback_t)( OTA_FileContext_t * const C,
+                                                        uint8_t * pucCheckpoint,
+                                                        uint32_t ulSize );
+
 /**
  * @brief Custom Job callback function typedef.
  *
@@ -415,6 +453,8 @@ typedef struct
     pxOTAPALWriteBlockCallback_t xWriteBlock;                       /* OTA Write Block callback pointer */
     pxOTACompleteCallback_t xCompleteCallback;                      /* OTA Job Completed callback pointer */
     pxOTACustomJobCallback_t xCustomJobCallback;                    /* OTA Custom Job callback pointer */
+    pxOTAPALSaveCheckpointCallback_t xSaveCheckpoint;               /* OTA Save Checkpoint callback pointer */
+    pxOTAPALLoadCheckpointCallback_t xLoadCheckpoint;               /* OTA Load Checkpoint callback pointer */
 } OTA_PAL_Callbacks_t;
 
 
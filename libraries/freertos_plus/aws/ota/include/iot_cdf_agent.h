@@ -38,6 +38,9 @@
 /* Include for console serial output. */
 #include "iot_logging_task.h"
 
+/* The cdfconfig settings are overridden in the OTA agent configuration. */
+#include "aws_ota_agent_config.h"
+
 #define MAC_ADDR "CC50E388186C"
 
 #define _CERTIFICATE_ID_LENGTH ( 65 )
@@ -125,17 +128,13 @@ typedef struct _cdf_Api {
     pxCDF_Get         xGetOldCertificateId;
 } cdf_Api_t ;
 
-typedef struct _subCallbackParamsStruct {
-    IotSemaphore_t * pPublishesReceived;
-    cdf_Api_t * cdfApi;
-    CDF_CR_ACTION * cdfCrAction;
-} cdf_subCallbackParams_t;
-
 typedef struct _subAppRegCallbackParamsStruct {
     IotSemaphore_t * pPublishesReceived;
 } cdf_subAppRegCallbackParams_t;
 
-extern int mbed_getCSR( char *csr_str, char *private_key_str, char *certificate_str );
+extern int pkcs11_getCSR( char *csr_str, int generate_key );
+extern int pkcs11_promotePendingKey( void );
+extern void pkcs11_discardPendingKey( void );
 
 /*---------------------------------------------------------------------------*/
 /*								Public API									 */
@@ -150,8 +149,9 @@ extern int mbed_getCSR( char *csr_str, char *private_key_str, char *certificate_
  *
  * @param[in] pvClient The messaging protocol client context (e.g. an MQTT context).
  * @param[in] pucThingName A pointer to a C string holding the Thing name.
- * @param[in] xFunc Static callback function for when an OTA job is complete. This function will have
- * input of the state of the OTA image after download and during self-test.
+ * @param[in] otaCallbacks OTA PAL callbacks used to start the OTA agent alongside the CDF agent.
+ * May be NULL to run certificate rotation without OTA.
+ * @param[in] xApi CDF storage and state callbacks.
  * @param[in] xTicksToWait The number of ticks to wait until the OTA Task signals that it is ready.
  * If this is set to zero, then the function will return immediately after creating the OTA task but
  * the OTA task may not be ready to operate yet. The state may be queried with OTA_GetAgentState().
@@ -188,6 +188,18 @@ void CDF_AgentShutdown( void ) ;
  */
 CDF_State_t CDF_GetAgentState( void );
 
+/**
+ * @brief Get the time at which the CDF agent will start a rotation by itself.
+ *
+ * The time is taken from the notAfter of the device certificate when the
+ * agent is initialized, moved earlier by cdfconfigROTATE_BEFORE_EXPIRY_SECONDS
+ * and a per Thing offset inside cdfconfigROTATION_WINDOW_SECONDS.
+ *
+ * @return The rotation time in seconds since the epoch (UTC), or 0 if no
+ * rotation is scheduled.
+ */
+uint32_t CDF_GetRotationTime( void );
+
 
 /*---------------------------------------------------------------------------*/
 /*							Statistics API									 */
@@ -224,10 +236,6 @@ uint32_t CDF_GetPacketsQueued( void );
  */
 uint32_t CDF_GetPacketsProcessed( void );
 
-/**
- * @brief The OTA agent task priority. Normally it runs at a low priority.
- */
-#define cdfconfigAGENT_PRIORITY                 tskIDLE_PRIORITY 
 /**
  * @brief Get the number of CDF message packets dropped by the CDF agent.
  *
@@ -266,16 +274,55 @@ uint32_t CDF_GetPacketsDropped( void );
 "-----END CERTIFICATE REQUEST-----\n"
 
 #define cdfconfigMAX_THINGNAME_LEN              64U
-#define cdfconfigSTACK_SIZE                     6000U
-#define cdfSmallSTACK_SIZE                      700U
+
+/* Ask the attach lambda to create the new certificate already active. The
+ * rotation then skips the activate round trip and goes from attach straight
+ * to deactivating the old certificate after the reconnect. A lambda without
+ * autoActivate support is answered with the regular activate step. The attach
+ * lambda in lambda/ never creates an active certificate, so that a certificate
+ * the device never acknowledged is not a live credential; with it the
+ * activate step always runs. */
+#ifndef cdfconfigPIPELINED_ROTATION
+    #define cdfconfigPIPELINED_ROTATION         0
+#endif
+
+/* Expiry driven rotation. Each Thing starts its rotation at a fixed offset,
+ * derived from the Thing name, inside a window that ends
+ * cdfconfigROTATE_BEFORE_EXPIRY_SECONDS before the notAfter of the device
+ * certificate, so a fleet with one expiry date does not rotate at once. */
+#ifndef cdfconfigROTATE_BEFORE_EXPIRY_SECONDS
+    #define cdfconfigROTATE_BEFORE_EXPIRY_SECONDS    ( 30UL * 24UL * 3600UL )
+#endif
+#ifndef cdfconfigROTATION_WINDOW_SECONDS
+    #define cdfconfigROTATION_WINDOW_SECONDS         ( 7UL * 24UL * 3600UL )
+#endif
+
+/* Current UTC time in seconds since the epoch, as in
+ * #define cdfconfigGET_UTC_SECONDS() ( ( uint32_t ) time( NULL ) )
+ * mbedTLS is built without a clock, so the application maps this to its time
+ * source. It has no default: without it the rotation time is still computed,
+ * but expiry driven rotation is not started. While it returns 0 the time is
+ * unknown and the rotation waits for it. */
+
+/* Token bucket for re-sent rotation requests, shared by all steps: at most
+ * cdfconfigRETRY_BURST retries back to back, then one per
+ * cdfconfigRETRY_INTERVAL_MS. */
+#ifndef cdfconfigRETRY_BURST
+    #define cdfconfigRETRY_BURST                     ( 3UL )
+#endif
+#ifndef cdfconfigRETRY_INTERVAL_MS
+    #define cdfconfigRETRY_INTERVAL_MS               ( 60000UL )
+#endif
 
 #define _CR_CERTIFICATE_SIZE     ( sizeof( keyCLIENT_CERTIFICATE_PEM ) + 500U )
 #define _CR_CSR_SIZE             ( sizeof( keyCLIENT_CSR_PEM ) + 500U )
 #define _CR_PRIVATE_KEY_SIZE     ( sizeof( keyCLIENT_PRIVATE_KEY_PEM ) + 500U )
 
-#define DEBUG_CUSTOM_JOB_JSON
-#define DEBUG_CERT_ROTATE_JSON
-#define DEBUG_APPL_REG_JSON
+/* Verbose JSON logging. Each switch adds logging to an MQTT callback, so
+ * leave them off outside of bring-up. */
+// #define DEBUG_CUSTOM_JOB_JSON
+// #define DEBUG_CERT_ROTATE_JSON
+// #define DEBUG_APPL_REG_JSON
 // #define DEBUG_CSR_AND_CERT
 
 #endif /* ifndef _IOT_CDF_AGENT_H_ */
@@ -54,13 +54,33 @@
 #include "jsmn.h" /*lint !e537 All headers have multiple inclusion prevention. */
 #include "mbedtls/base64.h"
 
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+    #include "iot_crypto.h"
+#endif
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+    /* The PAL saves and loads the download checkpoints by default. */
+    #define OTA_PAL_SAVE_CHECKPOINT    prvPAL_SaveCheckpoint
+    #define OTA_PAL_LOAD_CHECKPOINT    prvPAL_LoadCheckpoint
+
+    /* Room for the hash state at the end of a checkpoint. */
+    #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+        #define OTA_CHECKPOINT_HASH_STATE_BYTES    ( ( uint32_t ) cryptoSIGNATURE_VERIFICATION_STATE_BYTES )
+    #else
+        #define OTA_CHECKPOINT_HASH_STATE_BYTES    0U
+    #endif
+#else
+    #define OTA_PAL_SAVE_CHECKPOINT    NULL
+    #define OTA_PAL_LOAD_CHECKPOINT    NULL
+#endif
+
 /* Returns the byte offset of the element 'e' in the typedef structure 't'.
  * Setting an arbitrarily large base of 0x10000 and masking off that base allows
  * us to do the same thing as a zero offset without the lint warnings of using a
  * null pointer. No structure is anywhere near 64K in size.
  * */
 /*lint -emacro((923,9078),OFFSET_OF) Intentionally cast pointer to uint32_t because we are using it as an offset. */
-#define OFFSET_OF( t, e )    ( ( uint32_t ) ( &( ( t * ) 0x10000UL )->e ) & 0xffffUL )
+#define OFFSET_OF( t, e )    ( ( uint32_t ) ( ( uintptr_t ) ( &( ( t * ) 0x10000UL )->e ) & 0xffffUL ) )
 
 /* General constants. */
 #define OTA_MAX_JSON_STR_LEN               256U             /* Limit our JSON string compares to something small to avoid going into the weeds. */
@@ -202,11 +222,6 @@ static const char * pcOTA_JobStatus_Strings[ eNumJobStatusMappings ] =
 };
 
 
-#define OTA_DOC_MODEL_MAX_PARAMS    32U                    /* The parameter list is backed by a 32 bit longword bitmap by design. */
-#define OTA_JOB_PARAM_REQUIRED      ( ( bool_t ) pdTRUE )  /* Used to denote a required document model parameter. */
-#define OTA_JOB_PARAM_OPTIONAL      ( ( bool_t ) pdFALSE ) /* Used to denote an optional document model parameter. */
-#define OTA_DONT_STORE_PARAM        0xffffffffUL           /* If ulDestOffset in the model is 0xffffffff, do not store the value. */
-
 /* This union allows us to access document model parameter addresses as their
  * actual type without casting every time we access a parameter. */
 
@@ -215,12 +230,23 @@ typedef union MultiParmPtr
     char ** ppcPtr;
     const char ** ppccPtr;
     uint32_t * pulPtr;
-    uint32_t ulVal;
+    uintptr_t ulVal;
     bool_t * pxBoolPtr;
     Sig256_t ** ppxSig256Ptr;
     void ** ppvPtr;
 } MultiParmPtr_t;
 
+/* A tokenized JSON document. */
+
+typedef struct
+{
+    const char * pcJSON;   /* The document. It is not copied. */
+    uint32_t ulMsgLen;     /* The length of the document. */
+    jsmntok_t * pxTokens;  /* Heap allocated tokens of the document, or NULL. */
+    uint32_t ulNumTokens;  /* The number of tokens in pxTokens. */
+    DocParseErr_t eErr;    /* The result of tokenizing the document. */
+} JSON_Document_t;
+
 
 
 /*lint -e830 -e9003 Keep these in one location for easy discovery should they change in the future. */
@@ -247,6 +273,19 @@ static OTA_PubMsg_t * xQueueData[ OTA_NUM_MSG_Q_ENTRIES ];
 /* The array to use to push data from QMTT callback. */
 static OTA_PubMsg_t xPublishBuffers[ OTA_NUM_MSG_Q_ENTRIES ];
 
+#if ( otaconfigWRITE_BLOCK_IN_PLACE == 0 )
+    /* Word aligned buffer that each received block is decoded into before it is written. */
+    static uint32_t ulBlockStagingBuffer[ OTA_FILE_BLOCK_SIZE / sizeof( uint32_t ) ];
+#endif
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+    /* The hash frontier and the held blocks of the file being received. */
+    static OTA_SigVerify_t xSigVerify;
+#endif
+
+/* The job document being offered to the job handlers. It is tokenized once for all of them. */
+static JSON_Document_t xDispatchedJobDoc;
+
 /* Flag for self-test mode. */
 static bool_t xInSelfTest = false;
 
@@ -322,15 +361,15 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
 static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
                                                 uint32_t ulMsgLen );
 
-/* Get an available OTA file context structure or NULL if none available. */
+/* Mark every block of the file as missing in its block bitmap. */
 
-static OTA_FileContext_t * prvGetFreeContext( void );
+static void prvResetRxBlockBitmap( OTA_FileContext_t * C,
+                                   uint32_t ulNumBlocks,
+                                   uint32_t ulBitmapLen );
 
-/* Parse a JSON document using the specified document model. */
+/* Get an available OTA file context structure or NULL if none available. */
 
-static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
-                                          uint32_t ulMsgLen,
-                                          JSON_DocModel_t * pxDocModel );
+static OTA_FileContext_t * prvGetFreeContext( void );
 
 /* Parse the OTA job document, validate and return the populated OTA context if valid. */
 
@@ -357,6 +396,93 @@ static void prvUpdateJobStatus( OTA_FileContext_t * C,
 
 static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C );
 
+/* Encode one "Get Stream" request for the blocks set in the given bitmap and publish it. */
+
+static OTA_Err_t prvPublishStreamRequest( OTA_FileContext_t * C,
+                                          uint32_t ulBlockOffset,
+                                          uint8_t * pucBlockBitmap,
+                                          uint32_t ulBitmapLen,
+                                          uint32_t ulNumBlocks );
+
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+
+/* Clear the ranges in flight and start a new windowed download with a window of one range. */
+
+    static void prvWindowReset( OTA_StreamWindow_t * pxWindow );
+
+/* Start a new sample of the block arrival rate. With xForget, also drop the previous sample
+ * and the window limit it set. */
+
+    static void prvWindowNewSample( OTA_StreamWindow_t * pxWindow,
+                                    bool_t xForget );
+
+/* Claim a free slot for the next range of missing blocks that is not already in flight.
+ * Returns pdFALSE if the window is full or there is nothing left to request. */
+
+    static bool_t prvWindowNextRange( OTA_StreamWindow_t * pxWindow,
+                                      const uint8_t * pucBlockBitmap,
+                                      uint32_t ulBitmapLen,
+                                      uint32_t * pulFirstByte,
+                                      uint32_t * pulNumBytes,
+                                      uint32_t * pulNumBlocks );
+
+/* Account for a received block and adapt the window when its range completes. */
+
+    static void prvWindowBlockReceived( OTA_StreamWindow_t * pxWindow,
+                                        uint32_t ulBlockIndex,
+                                        bool_t xDuplicate );
+
+/* Forget the ranges in flight after the request timer expired. */
+
+    static void prvWindowTimeout( OTA_StreamWindow_t * pxWindow );
+
+/* Publish requests for new ranges until the window is full. */
+
+    static OTA_Err_t prvPublishWindowRequests( OTA_FileContext_t * C );
+#endif /* if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 ) */
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+
+/* Start the hash of a new file for its signature check. */
+
+    static void prvSigVerifyStart( OTA_FileContext_t * C );
+
+/* Hash a received block if it is the next one in file order, followed by any held blocks that
+ * now follow it. A block received ahead of the next one is held until its turn. */
+
+    static void prvSigVerifyBlock( OTA_FileContext_t * C,
+                                   uint32_t ulBlockIndex,
+                                   const uint8_t * pucData,
+                                   uint32_t ulBlockSize );
+
+/* Drop the hash of the file, if any. */
+
+    static void prvSigVerifyStop( OTA_FileContext_t * C );
+#endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+/* Hash the stream name of a job to tell the checkpoints of different jobs apart. */
+
+    static uint32_t prvHashStreamName( const uint8_t * pucStreamName );
+
+/* The size of the checkpoint of the file. */
+
+    static uint32_t prvCheckpointSize( const OTA_FileContext_t * C );
+
+/* Save a checkpoint of the download of the file, replacing the previous one. */
+
+    static void prvSaveCheckpoint( OTA_FileContext_t * C );
+
+/* Resume the download of the file from the saved checkpoint if it belongs to the same job. */
+
+    static void prvLoadCheckpoint( OTA_FileContext_t * C );
+
+/* Delete the checkpoint once the download is over. */
+
+    static void prvDeleteCheckpoint( OTA_FileContext_t * C );
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
+
 /* Internal function to set the image state including an optional reason code. */
 
 static OTA_Err_t prvSetImageStateWithReason( OTA_ImageState_t eState,
@@ -390,21 +516,34 @@ static OTA_Err_t prvPAL_DefaultActivateNewImage( uint32_t ulServerFileID );
 
 static void prvAgentShutdownCleanup( void );
 
+/* Hash a JSON key for the document model lookup. */
+
+static uint32_t prvHashJSONKey( const char * pcKey,
+                                uint32_t ulLen );
+
 /* Search the document model for a key that matches the specified JSON key. */
 
 static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
-                                                const char * pcJSONString,
-                                                uint32_t ulStrLen,
+                                                const char * pcJSON,
+                                                const jsmntok_t * pxTokens,
+                                                uint32_t ulKeyIndex,
+                                                uint32_t ulNumTokens,
                                                 uint16_t * pulMatchingIndexResult );
 
-/* Prepare the document model for use by sanity checking the initialization parameters
- * and detecting all required parameters. */
+/* Tokenize a JSON document. */
+
+static DocParseErr_t prvTokenizeJSON( JSON_Document_t * pxDoc,
+                                      const char * pcJSON,
+                                      uint32_t ulMsgLen );
+
+/* Free the tokens of a JSON document. */
 
-static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
-                                      const JSON_DocParam_t * pxBodyDef,
-                                      uint32_t ulContextBaseAddr,
-                                      uint32_t ulContextSize,
-                                      uint16_t usNumJobParams );
+static void prvFreeJSONTokens( JSON_Document_t * pxDoc );
+
+/* Extract the parameters of a tokenized JSON document using the specified document model. */
+
+static DocParseErr_t prvParseTokensByModel( const JSON_Document_t * pxDoc,
+                                            JSON_DocModel_t * pxDocModel );
 
 /* Attempt to force reset the device. Normally called by the agent when a self test rejects the update. */
 
@@ -443,6 +582,9 @@ typedef struct ota_agent_context
     OTA_AgentStatistics_t xStatistics;                      /* The OTA agent statistics block. */
     OTA_PAL_Callbacks_t xPALCallbacks;                      /* Variable to store PAL callbacks */
     uint32_t ulServerFileID;                                /* Variable to store current file ID passed down */
+    #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+        OTA_StreamWindow_t xStreamWindow;                   /* The block ranges in flight for the active file. */
+    #endif
 } OTA_AgentContext_t;
 
 
@@ -458,7 +600,9 @@ typedef struct ota_agent_context
     .xSetPlatformImageState    = prvPAL_DefaultSetPlatformImageState, \
     .xWriteBlock               = prvPAL_WriteBlock, \
     .xCompleteCallback         = prvDefaultOTACompleteCallback, \
-    .xCustomJobCallback        = prvDefaultCustomJobCallback \
+    .xCustomJobCallback        = prvDefaultCustomJobCallback, \
+    .xSaveCheckpoint           = OTA_PAL_SAVE_CHECKPOINT, \
+    .xLoadCheckpoint           = OTA_PAL_LOAD_CHECKPOINT \
 }
 
 /* This is THE OTA agent context and initialization state. */
@@ -477,7 +621,10 @@ static OTA_AgentContext_t xOTA_Agent =
     .xOTA_MsgQ                     = NULL,
     .xStatistics                   = { 0 },
     .xPALCallbacks                 = OTA_JOB_CALLBACK_DEFAULT_INITIALIZER,
-    .ulServerFileID                = 0
+    .ulServerFileID                = 0,
+    #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+        .xStreamWindow             = { { { 0 } } },
+    #endif
 };
 
 
@@ -695,6 +842,23 @@ OTA_State_t OTA_AgentInit_internal( void * pvClient,
             xOTA_Agent.xPALCallbacks.xCustomJobCallback = prvDefaultCustomJobCallback;
         }
 
+        if( xCallbacks->xSaveCheckpoint != NULL )
+        {
+            xOTA_Agent.xPALCallbacks.xSaveCheckpoint = xCallbacks->xSaveCheckpoint;
+        }
+        else
+        {
+            xOTA_Agent.xPALCallbacks.xSaveCheckpoint = OTA_PAL_SAVE_CHECKPOINT;
+        }
+
+        if( xCallbacks->xLoadCheckpoint != NULL )
+        {
+            xOTA_Agent.xPALCallbacks.xLoadCheckpoint = xCallbacks->xLoadCheckpoint;
+        }
+        else
+        {
+            xOTA_Agent.xPALCallbacks.xLoadCheckpoint = OTA_PAL_LOAD_CHECKPOINT;
+        }
     }
 
     /* Reset our statistics counters. */
@@ -946,6 +1110,15 @@ static void prvAgentShutdownCleanup( void )
     /* Close any open OTA transfers. */
     for( ulIndex = 0; ulIndex < OTA_MAX_FILES; ulIndex++ )
     {
+        #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+            /* Keep what was received so far for when the agent is started again. */
+            if( ( xOTA_Agent.pxOTA_Files[ ulIndex ].pucRxBlockBitmap != NULL ) &&
+                ( xOTA_Agent.pxOTA_Files[ ulIndex ].ulBlocksRemaining > 0U ) )
+            {
+                prvSaveCheckpoint( &xOTA_Agent.pxOTA_Files[ ulIndex ] );
+            }
+        #endif
+
         if( prvOTA_Close( &xOTA_Agent.pxOTA_Files[ ulIndex ] ) == ( bool_t ) pdFALSE )
         {
             OTA_LOG_L1( "[%s] Error! OTA_FileContext_t[%u] pointer is null.\r\n", OTA_METHOD_NAME, ulIndex );
@@ -1065,11 +1238,11 @@ OTA_Err_t OTA_SetImageState( OTA_ImageState_t eState )
             break;
 
         case eOTA_ImageState_Rejected:
-            xErr = prvSetImageStateWithReason( eState, ( uint32_t ) NULL );
+            xErr = prvSetImageStateWithReason( eState, 0U );
             break;
 
         case eOTA_ImageState_Accepted:
-            xErr = prvSetImageStateWithReason( eState, ( uint32_t ) NULL );
+            xErr = prvSetImageStateWithReason( eState, 0U );
 
             if( xErr == kOTA_Err_None )
             {
@@ -1137,7 +1310,7 @@ static OTA_Err_t prvSetImageStateWithReason( OTA_ImageState_t eState,
         {
             if( eState == eOTA_ImageState_Testing )
             { /* We discovered we're ready for test mode, put job status in self_test active. */
-                prvUpdateJobStatus( NULL, eJobStatus_InProgress, ( int32_t ) eJobReason_SelfTestActive, ( int32_t ) NULL );
+                prvUpdateJobStatus( NULL, eJobStatus_InProgress, ( int32_t ) eJobReason_SelfTestActive, 0 );
             }
             else
             {
@@ -1355,83 +1528,28 @@ static void prvUpdateJobStatus( OTA_FileContext_t * C,
 
 static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C )
 {
-    DEFINE_OTA_METHOD_NAME( "prvPublishGetStreamMessage" );
-
-    uint32_t ulMsgSizeToPublish;
-    size_t xMsgSizeFromStream;
-    uint32_t ulNumBlocks, ulBitmapLen, ulTopicLen;
-    IotMqttError_t eResult;
     OTA_Err_t xErr = kOTA_Err_None;
-    char pcMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
-    char pcTopicBuffer[ OTA_MAX_TOPIC_LEN ];
 
     if( C != NULL )
     {
         if( C->ulRequestMomentum < OTA_MAX_STREAM_REQUEST_MOMENTUM )
         {
-            ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
-            ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
-
-            if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
-                    ( uint8_t * ) pcMsg,
-                    sizeof( pcMsg ),
-                    &xMsgSizeFromStream,
-                    OTA_CLIENT_TOKEN,
-                    ( int32_t ) C->ulServerFileID,
-                    ( int32_t ) ( OTA_FILE_BLOCK_SIZE & 0x7fffffffUL ), /* Mask to keep lint happy. It's still a constant. */
-                    0,
-                    C->pucRxBlockBitmap,
-                    ulBitmapLen,
-                    ulNumBlocks ) )
-            {
-                ulMsgSizeToPublish = ( uint32_t ) xMsgSizeFromStream;
-
-                /* Each Get Stream Request increases the momentum until a response
-                 * is received to ANY request. Too much momentum is interpreted as
-                 * a failure to communicate and will cause us to abort the OTA. */
-                C->ulRequestMomentum++;
-
-                /* Try to build the dynamic data REQUEST topic and subscribe to it. */
-                ulTopicLen = ( uint32_t ) snprintf( pcTopicBuffer, /*lint -e586 Intentionally using snprintf. */
-                                                    sizeof( pcTopicBuffer ),
-                                                    pcOTA_GetStream_TopicTemplate,
-                                                    xOTA_Agent.pcThingName,
-                                                    ( const char * ) C->pucStreamName );
-
-                if( ( ulTopicLen > 0U ) && ( ulTopicLen < sizeof( pcTopicBuffer ) ) )
-                {
-                    eResult = prvPublishMessage(
-                        xOTA_Agent.pvPubSubClient,
-                        pcTopicBuffer,
-                        ( uint16_t ) ulTopicLen,
-                        &pcMsg[ 0 ],
-                        ulMsgSizeToPublish,
-                        IOT_MQTT_QOS_0 );
-
-                    if( eResult != IOT_MQTT_SUCCESS )
-                    {
-                        OTA_LOG_L1( "[%s] Failed: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
-                        /* Don't return an error. Let max momentum catch it since this may be intermittent. */
-                    }
-                    else
-                    {
-                        OTA_LOG_L1( "[%s] OK: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
-                        /* Restart the request timer to retry if we don't complete the update. */
-                        prvStartRequestTimer( C );
-                    }
-                }
-                else
-                {
-                    /* 0 should never happen since we supply the format strings. It must be overflow. */
-                    OTA_LOG_L1( "[%s] Failed to build stream topic!\r\n", OTA_METHOD_NAME );
-                    xErr = kOTA_Err_TopicTooLarge;
-                }
-            }
-            else
-            {
-                OTA_LOG_L1( "[%s] CBOR encode failed.\r\n", OTA_METHOD_NAME );
-                xErr = kOTA_Err_FailedToEncodeCBOR;
-            }
+            /* Each Get Stream Request increases the momentum until a response
+             * is received to ANY request. Too much momentum is interpreted as
+             * a failure to communicate and will cause us to abort the OTA. */
+            C->ulRequestMomentum++;
+
+            #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+                /* Nothing arrived for a whole timer period, so request the missing
+                 * blocks again starting with a single range. */
+                prvWindowTimeout( &xOTA_Agent.xStreamWindow );
+                xErr = prvPublishWindowRequests( C );
+            #else
+                uint32_t ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+                uint32_t ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+
+                xErr = prvPublishStreamRequest( C, 0U, C->pucRxBlockBitmap, ulBitmapLen, ulNumBlocks );
+            #endif
         }
         else
         {
@@ -1448,161 +1566,860 @@ static OTA_Err_t prvPublishGetStreamMessage( OTA_FileContext_t * C )
     return xErr;
 }
 
-/* This function is called whenever we receive a MQTT publish message on one of our OTA topics. */
-static void prvOTAPublishCallback( void * pvCallbackContext,
-                                   IotMqttCallbackParam_t * const pxPublishData )
+
+/* Encode one "Get Stream" request for the blocks set in the given bitmap and publish it.
+ * The bitmap starts at block ulBlockOffset of the file. */
+
+static OTA_Err_t prvPublishStreamRequest( OTA_FileContext_t * C,
+                                          uint32_t ulBlockOffset,
+                                          uint8_t * pucBlockBitmap,
+                                          uint32_t ulBitmapLen,
+                                          uint32_t ulNumBlocks )
 {
-    DEFINE_OTA_METHOD_NAME_L2( "prvOTAPublishCallback" );
+    DEFINE_OTA_METHOD_NAME( "prvPublishStreamRequest" );
 
-    BaseType_t xReturn;
-    OTA_PubMsg_t * pxMsg;
+    uint32_t ulMsgSizeToPublish;
+    size_t xMsgSizeFromStream;
+    uint32_t ulTopicLen;
+    IotMqttError_t eResult;
+    OTA_Err_t xErr = kOTA_Err_None;
+    char pcMsg[ OTA_REQUEST_MSG_MAX_SIZE ];
+    char pcTopicBuffer[ OTA_MAX_TOPIC_LEN ];
 
-	if( pxPublishData->u.message.info.payloadLength > OTA_DATA_BLOCK_SIZE)
-    {
-       OTA_LOG_L1( "Error: buffers are too small %d to contains the payload %d.\r\n", OTA_DATA_BLOCK_SIZE ,  pxPublishData->u.message.info.payloadLength   );
-	   return;
-	}
-    /* If we're running the OTA task, send publish messages to it for processing. */
-    if( xOTA_Agent.xOTA_EventFlags != NULL )
+    if( pdTRUE == OTA_CBOR_Encode_GetStreamRequestMessage(
+            ( uint8_t * ) pcMsg,
+            sizeof( pcMsg ),
+            &xMsgSizeFromStream,
+            OTA_CLIENT_TOKEN,
+            ( int32_t ) C->ulServerFileID,
+            ( int32_t ) ( OTA_FILE_BLOCK_SIZE & 0x7fffffffUL ), /* Mask to keep lint happy. It's still a constant. */
+            ( int32_t ) ulBlockOffset,
+            pucBlockBitmap,
+            ulBitmapLen,
+            ( int32_t ) ulNumBlocks ) )
     {
-        xOTA_Agent.xStatistics.ulOTA_PacketsReceived++;
+        ulMsgSizeToPublish = ( uint32_t ) xMsgSizeFromStream;
 
-        /* Lock up a buffer to copy publish data. */
-        pxMsg = prvOTAPubMessageGet();
+        /* Try to build the dynamic data REQUEST topic and subscribe to it. */
+        ulTopicLen = ( uint32_t ) snprintf( pcTopicBuffer, /*lint -e586 Intentionally using snprintf. */
+                                            sizeof( pcTopicBuffer ),
+                                            pcOTA_GetStream_TopicTemplate,
+                                            xOTA_Agent.pcThingName,
+                                            ( const char * ) C->pucStreamName );
 
-        if(pxMsg != NULL)
+        if( ( ulTopicLen > 0U ) && ( ulTopicLen < sizeof( pcTopicBuffer ) ) )
         {
-			pxMsg->lMsgType = ( int32_t ) pvCallbackContext; /*lint !e923 The context variable is actually the message type. */
-			pxMsg->pxPubData.ulDataLength = pxPublishData->u.message.info.payloadLength;
-			if ( ( int32_t ) pvCallbackContext == eOTA_PubMsgType_Stream){
-				OTA_LOG_L2( "[%s] Stream Received.\r\n", OTA_METHOD_NAME );
-				}
-
+            eResult = prvPublishMessage(
+                xOTA_Agent.pvPubSubClient,
+                pcTopicBuffer,
+                ( uint16_t ) ulTopicLen,
+                &pcMsg[ 0 ],
+                ulMsgSizeToPublish,
+                IOT_MQTT_QOS_0 );
 
-			memcpy( pxMsg->pxPubData.vData, pxPublishData->u.message.info.pPayload, pxMsg->pxPubData.ulDataLength );
-			xReturn = xQueueSendToBack( xOTA_Agent.xOTA_MsgQ, &pxMsg, ( TickType_t ) 0 );
-			if( xReturn == pdPASS )
-			{
-				xOTA_Agent.xStatistics.ulOTA_PacketsQueued++;
-				( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_READY );
-				/* Take ownership of the MQTT buffer. */
-			}
-			else
-			{
-				OTA_LOG_L1( "Error: Could not push message to queue.\r\n" );
-				/* Free up locked buffer. */
-				prvOTAPubMessageFree(pxMsg);
-				xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
-			}
-        }else
+            if( eResult != IOT_MQTT_SUCCESS )
+            {
+                OTA_LOG_L1( "[%s] Failed: %s\r\n", OTA_METHOD_NAME, pcTopicBuffer );
+                /* Don't return an error. Let max momentum catch it since this may be intermittent. */
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] OK: %s, blocks %u+%u\r\n", OTA_METHOD_NAME, pcTopicBuffer, ulBlockOffset, ulNumBlocks );
+                /* Restart the request timer to retry if we don't complete the update. */
+                prvStartRequestTimer( C );
+            }
+        }
+        else
         {
-        	xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
-        	OTA_LOG_L1( "Error: Could not get a free buffer to copy callback data.\r\n" );
+            /* 0 should never happen since we supply the format strings. It must be overflow. */
+            OTA_LOG_L1( "[%s] Failed to build stream topic!\r\n", OTA_METHOD_NAME );
+            xErr = kOTA_Err_TopicTooLarge;
         }
     }
     else
     {
-        /* This doesn't normally occur unless we're subscribed to an OTA topic when
-         * the OTA agent is not initialized. Just drop the message by not taking
-         * ownership since we don't know if we'll ever be able to process it. */
-        OTA_LOG_L2( "[%s] Warning: Received MQTT message but agent isn't ready.\r\n", OTA_METHOD_NAME );
-        xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+        OTA_LOG_L1( "[%s] CBOR encode failed.\r\n", OTA_METHOD_NAME );
+        xErr = kOTA_Err_FailedToEncodeCBOR;
     }
+
+    return xErr;
 }
 
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
 
+/* Clear the ranges in flight and start a new windowed download with a window of one range. */
 
-/* NOTE: This implementation only supports 1 OTA context. Concurrent OTA is not supported. */
+    static void prvWindowReset( OTA_StreamWindow_t * pxWindow )
+    {
+        memset( pxWindow, 0, sizeof( OTA_StreamWindow_t ) );
+        pxWindow->ulWindowSize = 1U;
+        prvWindowNewSample( pxWindow, pdTRUE );
+    }
 
-static void prvOTAUpdateTask( void * pvUnused )
-{
-    DEFINE_OTA_METHOD_NAME( "prvOTAUpdateTask" );
 
-    EventBits_t uxBits;
-    OTA_FileContext_t * C = NULL;
-    OTA_Err_t xErr;
-    OTA_PubMsg_t * pxMsgMetaData;
+/* A sample lasts until as many new blocks have arrived as the window it started with covers,
+ * which takes about one round trip at that window. */
 
-    ( void ) pvUnused;
+    static void prvWindowNewSample( OTA_StreamWindow_t * pxWindow,
+                                    bool_t xForget )
+    {
+        if( xForget == pdTRUE )
+        {
+            pxWindow->ulWindowLimit = otaconfigSTREAM_WINDOW_MAX_REQUESTS;
+            pxWindow->ulLastWindow = 0U;
+            pxWindow->ulLastRate = 0U;
+        }
 
+        pxWindow->xSampleStart = xTaskGetTickCount();
+        pxWindow->ulSampleBlocks = 0U;
+        pxWindow->ulSampleWindow = pxWindow->ulWindowSize;
+    }
 
-    /* Subscribe to the OTA job notification topic. */
-    if( prvSubscribeToJobNotificationTopics() == ( bool_t ) pdTRUE )
+
+/* Claim a free slot for the next range of missing blocks that is not already in flight.
+ * The search starts where the previous range ended and wraps around the bitmap, so blocks
+ * of ranges that were given up on are requested again once the rest of the file has been. */
+
+    static bool_t prvWindowNextRange( OTA_StreamWindow_t * pxWindow,
+                                      const uint8_t * pucBlockBitmap,
+                                      uint32_t ulBitmapLen,
+                                      uint32_t * pulFirstByte,
+                                      uint32_t * pulNumBytes,
+                                      uint32_t * pulNumBlocks )
     {
-        xOTA_Agent.xOTA_EventFlags = xEventGroupCreate();
+        bool_t xFound = pdFALSE;
+        uint32_t ulActive = 0U;
+        uint32_t ulFreeSlot = otaconfigSTREAM_WINDOW_MAX_REQUESTS;
+        uint32_t ulStart, ulByte = 0U, ulEnd, ulCount, ulSlot, ulFirstByte;
+        uint8_t ucBits;
 
-        if( xOTA_Agent.xOTA_EventFlags != NULL )
+        for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
         {
-            /* Check if the firmware image is in self test mode. If so, enable the self test timer. */
-            ( void ) OTA_CheckForSelfTest();
-
-            /*Save the self-test mode in a flag. This flag is cleared when self-test is successful.*/
-            xInSelfTest = prvInSelftest();
+            if( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U )
+            {
+                ulActive++;
+            }
+            else if( ulFreeSlot == otaconfigSTREAM_WINDOW_MAX_REQUESTS )
+            {
+                ulFreeSlot = ulSlot;
+            }
+            else
+            {
+                /* Keep the first free slot. */
+            }
+        }
 
-            /* Send a request to the job service for the latest available job. */
-            ( void ) OTA_CheckForUpdate();
+        if( ( ulActive < pxWindow->ulWindowSize ) && ( ulFreeSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS ) && ( ulBitmapLen > 0U ) )
+        {
+            ulStart = pxWindow->ulNextBlock >> LOG2_BITS_PER_BYTE;
 
-            /* Put the OTA agent in the ready state. */
-            xOTA_Agent.eState = eOTA_AgentState_Ready;
+            if( ulStart >= ulBitmapLen )
+            {
+                ulStart = 0U;
+            }
 
-            for( ; ; )
+            /* Find the first byte with a missing block that no range in flight covers. */
+            for( ulCount = 0U; ( ulCount < ulBitmapLen ) && ( xFound == pdFALSE ); ulCount++ )
             {
-                uxBits = xEventGroupWaitBits(
-                    xOTA_Agent.xOTA_EventFlags, /* The event group being tested. */
-                    OTA_EVT_MASK_ALL_EVENTS,    /* The bits within the event group to wait for. */
-                    pdTRUE,                     /* Bits should be cleared before returning. */
-                    pdFALSE,                    /* Any bit set will do. */
-                    ( TickType_t ) ~( 0U ) );   /* Wait forever. */
+                ulByte = ( ulStart + ulCount ) % ulBitmapLen;
 
-                /* Check for the shutdown event. */
-                if( ( ( uint32_t ) uxBits & OTA_EVT_MASK_SHUTDOWN ) != 0U )
+                if( pucBlockBitmap[ ulByte ] != 0U )
                 {
-                    OTA_LOG_L1( "[%s] Received shutdown event.\r\n", OTA_METHOD_NAME );
-                    break; /* Break, so we stop all OTA processing. */
+                    xFound = pdTRUE;
+
+                    for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
+                    {
+                        if( ( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U ) &&
+                            ( ( ulByte << LOG2_BITS_PER_BYTE ) >= pxWindow->xRanges[ ulSlot ].ulFirstBlock ) &&
+                            ( ( ulByte << LOG2_BITS_PER_BYTE ) < pxWindow->xRanges[ ulSlot ].ulEndBlock ) )
+                        {
+                            xFound = pdFALSE;
+                        }
+                    }
                 }
+            }
 
-                /* Check for a user initiated abort. */
-                if( ( ( ( uint32_t ) uxBits & OTA_EVT_MASK_USER_ABORT ) != 0U ) && ( C != NULL ) )
+            if( xFound == pdTRUE )
+            {
+                /* Stop at the end of the bitmap or at the next range in flight. */
+                ulEnd = ulByte + ( otaconfigSTREAM_WINDOW_BLOCKS >> LOG2_BITS_PER_BYTE );
+
+                if( ulEnd > ulBitmapLen )
                 {
-                    OTA_LOG_L1( "[%s] Received user abort event.\r\n", OTA_METHOD_NAME );
-                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
-                    ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                    C = NULL;
+                    ulEnd = ulBitmapLen;
                 }
 
-                /* On OTA request timer timeout, publish the stream request if we have context. */
-                if( ( ( uxBits & OTA_EVT_MASK_REQ_TIMEOUT ) != 0U ) && ( C != NULL ) )
+                for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
                 {
-                    if( C->ulBlocksRemaining > 0U )
-                    {
-                        xErr = prvPublishGetStreamMessage( C );
+                    ulFirstByte = pxWindow->xRanges[ ulSlot ].ulFirstBlock >> LOG2_BITS_PER_BYTE;
 
-                        if( xErr != kOTA_Err_None )
-                        {                               /* Abort the current OTA. */
-                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
-                            ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
-                            C = NULL;
-                        }
-                    }
-                    else
+                    if( ( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U ) && ( ulFirstByte > ulByte ) && ( ulFirstByte < ulEnd ) )
                     {
-                        /* If there are no blocks remaining, this may have been in flight when the
-                         * last block was received. Just ignore it since it will be cleaned up by
-                         * the agent as required. */
+                        ulEnd = ulFirstByte;
                     }
                 }
 
-                /* Check if a MQTT message is ready for us to process. */
-                if( ( uxBits & OTA_EVT_MASK_MSG_READY ) != 0U )
+                /* Only the missing blocks of the range are requested. */
+                *pulNumBlocks = 0U;
+
+                for( ulCount = ulByte; ulCount < ulEnd; ulCount++ )
                 {
-                    if( ( xOTA_Agent.eState == eOTA_AgentState_Ready ) || ( xOTA_Agent.eState == eOTA_AgentState_Active ) )
+                    for( ucBits = pucBlockBitmap[ ulCount ]; ucBits != 0U; ucBits &= ( uint8_t ) ( ucBits - 1U ) )
                     {
-                        while( xQueueReceive( xOTA_Agent.xOTA_MsgQ, &pxMsgMetaData, 0 ) != pdFALSE )
-                        {
-                            /* Check for OTA update job messages. */
-                            if( pxMsgMetaData->eMsgType == eOTA_PubMsgType_Job )
-                            {
-                                if( C != NULL )
+                        ( *pulNumBlocks )++;
+                    }
+                }
+
+                *pulFirstByte = ulByte;
+                *pulNumBytes = ulEnd - ulByte;
+
+                pxWindow->xRanges[ ulFreeSlot ].ulFirstBlock = ulByte << LOG2_BITS_PER_BYTE;
+                pxWindow->xRanges[ ulFreeSlot ].ulEndBlock = ulEnd << LOG2_BITS_PER_BYTE;
+                pxWindow->xRanges[ ulFreeSlot ].ulOutstanding = *pulNumBlocks;
+                pxWindow->xRanges[ ulFreeSlot ].ulSequence = pxWindow->ulSequence;
+                pxWindow->ulSequence++;
+                pxWindow->ulNextBlock = ulEnd << LOG2_BITS_PER_BYTE;
+            }
+        }
+
+        return xFound;
+    }
+
+
+/* Account for a received block. When the last block of a range arrives, free its slot
+ * and adapt the window as described for OTA_StreamWindow_t. New blocks also count towards
+ * the sample of the arrival rate. */
+
+    static void prvWindowBlockReceived( OTA_StreamWindow_t * pxWindow,
+                                        uint32_t ulBlockIndex,
+                                        bool_t xDuplicate )
+    {
+        DEFINE_OTA_METHOD_NAME_L2( "prvWindowBlockReceived" );
+
+        OTA_BlockRange_t * pxRange = NULL;
+        bool_t xLoss = pdFALSE;
+        uint32_t ulSlot, ulRate;
+        TickType_t xElapsed;
+
+        if( xDuplicate == pdTRUE )
+        {
+            pxWindow->ulDuplicates++;
+        }
+        else
+        {
+            for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
+            {
+                if( ( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U ) &&
+                    ( ulBlockIndex >= pxWindow->xRanges[ ulSlot ].ulFirstBlock ) &&
+                    ( ulBlockIndex < pxWindow->xRanges[ ulSlot ].ulEndBlock ) )
+                {
+                    pxRange = &pxWindow->xRanges[ ulSlot ];
+                }
+            }
+
+            pxWindow->ulSampleBlocks++;
+        }
+
+        if( pxRange != NULL )
+        {
+            pxRange->ulOutstanding--;
+
+            if( pxRange->ulOutstanding == 0U )
+            {
+                /* Ranges requested before this one will not receive any more blocks. Give up
+                 * on them so that their missing blocks are requested again. */
+                for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
+                {
+                    if( ( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U ) &&
+                        ( pxWindow->xRanges[ ulSlot ].ulSequence < pxRange->ulSequence ) )
+                    {
+                        pxWindow->xRanges[ ulSlot ].ulOutstanding = 0U;
+                        xLoss = pdTRUE;
+                    }
+                }
+
+                if( ( xLoss == pdTRUE ) || ( pxWindow->ulDuplicates > 0U ) )
+                {
+                    pxWindow->ulWindowSize = ( pxWindow->ulWindowSize > 1U ) ? ( pxWindow->ulWindowSize >> 1U ) : 1U;
+                    pxWindow->ulDuplicates = 0U;
+                    prvWindowNewSample( pxWindow, pdTRUE );
+                }
+                else if( pxWindow->ulWindowSize < pxWindow->ulWindowLimit )
+                {
+                    pxWindow->ulWindowSize++;
+                }
+                else
+                {
+                    /* The window is already at its limit. */
+                }
+
+                OTA_LOG_L2( "[%s] Range at block %u complete, window %u.\r\n", OTA_METHOD_NAME, pxRange->ulFirstBlock, pxWindow->ulWindowSize );
+            }
+        }
+
+        /* Close the rate sample once it is complete. Blocks that all arrive within one tick
+         * cannot be timed, so they are counted into a longer sample. */
+        xElapsed = xTaskGetTickCount() - pxWindow->xSampleStart;
+
+        if( ( pxWindow->ulSampleBlocks >= ( pxWindow->ulSampleWindow * otaconfigSTREAM_WINDOW_BLOCKS ) ) && ( xElapsed > 0U ) )
+        {
+            ulRate = ( pxWindow->ulSampleBlocks * ( uint32_t ) configTICK_RATE_HZ ) / ( uint32_t ) xElapsed;
+
+            if( ( pxWindow->ulLastWindow > 0U ) &&
+                ( pxWindow->ulSampleWindow > pxWindow->ulLastWindow ) &&
+                ( ulRate < ( pxWindow->ulLastRate + ( pxWindow->ulLastRate >> 3U ) ) ) )
+            {
+                /* The larger window did not bring blocks in faster. */
+                pxWindow->ulWindowLimit = pxWindow->ulLastWindow;
+                pxWindow->ulWindowSize = pxWindow->ulLastWindow;
+                OTA_LOG_L2( "[%s] %u blocks/s with window %u, window %u.\r\n", OTA_METHOD_NAME, ulRate, pxWindow->ulSampleWindow, pxWindow->ulWindowSize );
+            }
+            else
+            {
+                pxWindow->ulLastWindow = pxWindow->ulSampleWindow;
+                pxWindow->ulLastRate = ulRate;
+            }
+
+            prvWindowNewSample( pxWindow, pdFALSE );
+        }
+    }
+
+
+/* Forget the ranges in flight after the request timer expired and restart the search
+ * from the first missing block. The very first request of a file is not a loss. */
+
+    static void prvWindowTimeout( OTA_StreamWindow_t * pxWindow )
+    {
+        uint32_t ulSlot;
+
+        for( ulSlot = 0U; ulSlot < otaconfigSTREAM_WINDOW_MAX_REQUESTS; ulSlot++ )
+        {
+            if( pxWindow->xRanges[ ulSlot ].ulOutstanding > 0U )
+            {
+                pxWindow->xRanges[ ulSlot ].ulOutstanding = 0U;
+                pxWindow->ulWindowSize = 1U;
+            }
+        }
+
+        pxWindow->ulNextBlock = 0U;
+        pxWindow->ulDuplicates = 0U;
+        prvWindowNewSample( pxWindow, pdTRUE );
+    }
+
+
+/* Publish requests for new ranges until the window is full. Each request carries the slice
+ * of the Rx block bitmap that covers its range, so the service only sends missing blocks. */
+
+    static OTA_Err_t prvPublishWindowRequests( OTA_FileContext_t * C )
+    {
+        OTA_Err_t xErr = kOTA_Err_None;
+        uint32_t ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        uint32_t ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+        uint32_t ulFirstByte, ulNumBytes, ulRangeBlocks;
+
+        if( C->pucRxBlockBitmap != NULL )
+        {
+            while( ( xErr == kOTA_Err_None ) &&
+                   ( prvWindowNextRange( &xOTA_Agent.xStreamWindow,
+                                         C->pucRxBlockBitmap,
+                                         ulBitmapLen,
+                                         &ulFirstByte,
+                                         &ulNumBytes,
+                                         &ulRangeBlocks ) == pdTRUE ) )
+            {
+                xErr = prvPublishStreamRequest( C,
+                                                ulFirstByte << LOG2_BITS_PER_BYTE,
+                                                &C->pucRxBlockBitmap[ ulFirstByte ],
+                                                ulNumBytes,
+                                                ulRangeBlocks );
+            }
+        }
+
+        return xErr;
+    }
+#endif /* if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 ) */
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+
+/* Start the hash of a new file for its signature check. If the context can't be allocated, the
+ * file is received without it and the PAL verifies it by reading it back. */
+
+    static void prvSigVerifyStart( OTA_FileContext_t * C )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvSigVerifyStart" );
+
+        uint32_t ulIndex;
+
+        for( ulIndex = 0U; ulIndex < otaconfigSIGNATURE_PENDING_BLOCKS; ulIndex++ )
+        {
+            xSigVerify.xPending[ ulIndex ].ulBlockSize = 0U;
+        }
+
+        /* A resumed download continues the hash restored from its checkpoint, if it had one. */
+        if( C->xIsResuming == ( bool_t ) pdFALSE )
+        {
+            prvSigVerifyStop( C );
+
+            xSigVerify.ulNextBlock = 0U;
+
+            if( CRYPTO_SignatureVerificationStart( &C->pvSigVerifyContext,
+                                                   otaconfigSIGNATURE_ASYMMETRIC_ALGORITHM,
+                                                   otaconfigSIGNATURE_HASH_ALGORITHM ) != pdTRUE )
+            {
+                OTA_LOG_L1( "[%s] Warning: Unable to start the file hash. The PAL will read the file back.\r\n", OTA_METHOD_NAME );
+                C->pvSigVerifyContext = NULL;
+            }
+        }
+    }
+
+
+/* Hash a received block if it is the next one in file order, then hash the held blocks that follow
+ * it. A block received ahead of the next one is copied into a free slot until its turn. If no slot
+ * is free, the hash is dropped since the block can't be hashed later without reading it back. */
+
+    static void prvSigVerifyBlock( OTA_FileContext_t * C,
+                                   uint32_t ulBlockIndex,
+                                   const uint8_t * pucData,
+                                   uint32_t ulBlockSize )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvSigVerifyBlock" );
+
+        uint32_t ulIndex;
+        OTA_PendingBlock_t * pxPending;
+
+        if( C->pvSigVerifyContext != NULL )
+        {
+            if( ulBlockIndex == xSigVerify.ulNextBlock )
+            {
+                CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext, pucData, ( size_t ) ulBlockSize );
+                xSigVerify.ulNextBlock++;
+
+                /* Hash the held blocks that are now next. Each one found may make another one next,
+                 * so scan again from the start after each. */
+                ulIndex = 0U;
+
+                while( ulIndex < otaconfigSIGNATURE_PENDING_BLOCKS )
+                {
+                    pxPending = &xSigVerify.xPending[ ulIndex ];
+
+                    if( ( pxPending->ulBlockSize > 0U ) && ( pxPending->ulBlockIndex == xSigVerify.ulNextBlock ) )
+                    {
+                        CRYPTO_SignatureVerificationUpdate( C->pvSigVerifyContext,
+                                                            ( const uint8_t * ) pxPending->ulData,
+                                                            ( size_t ) pxPending->ulBlockSize );
+                        pxPending->ulBlockSize = 0U;
+                        xSigVerify.ulNextBlock++;
+                        ulIndex = 0U;
+                    }
+                    else
+                    {
+                        ulIndex++;
+                    }
+                }
+            }
+            else
+            {
+                for( ulIndex = 0U; ulIndex < otaconfigSIGNATURE_PENDING_BLOCKS; ulIndex++ )
+                {
+                    if( xSigVerify.xPending[ ulIndex ].ulBlockSize == 0U )
+                    {
+                        break;
+                    }
+                }
+
+                if( ulIndex < otaconfigSIGNATURE_PENDING_BLOCKS )
+                {
+                    pxPending = &xSigVerify.xPending[ ulIndex ];
+                    memcpy( pxPending->ulData, pucData, ulBlockSize );
+                    pxPending->ulBlockIndex = ulBlockIndex;
+                    pxPending->ulBlockSize = ulBlockSize;
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] Too many blocks ahead of block %u. The PAL will read the file back.\r\n",
+                                OTA_METHOD_NAME,
+                                xSigVerify.ulNextBlock );
+                    prvSigVerifyStop( C );
+                }
+            }
+        }
+    }
+
+
+/* Drop the hash of the file, if any. CRYPTO_SignatureVerificationFinal() frees the context when
+ * it is given no certificate. */
+
+    static void prvSigVerifyStop( OTA_FileContext_t * C )
+    {
+        if( C->pvSigVerifyContext != NULL )
+        {
+            ( void ) CRYPTO_SignatureVerificationFinal( C->pvSigVerifyContext, NULL, 0, NULL, 0 );
+            C->pvSigVerifyContext = NULL;
+        }
+    }
+#endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+/* Hash a stream name with 32 bit FNV-1a. The checkpoint only needs to tell jobs apart. */
+
+    static uint32_t prvHashStreamName( const uint8_t * pucStreamName )
+    {
+        uint32_t ulHash = 2166136261UL;
+
+        if( pucStreamName != NULL )
+        {
+            while( *pucStreamName != 0U )
+            {
+                ulHash ^= ( uint32_t ) *pucStreamName;
+                ulHash *= 16777619UL;
+                pucStreamName++;
+            }
+        }
+
+        return ulHash;
+    }
+
+
+/* The size of the checkpoint of a file. It only depends on the size of the file, so the
+ * checkpoint of a job can be loaded without knowing its contents. */
+
+    static uint32_t prvCheckpointSize( const OTA_FileContext_t * C )
+    {
+        uint32_t ulNumBlocks = ( C->ulFileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+        uint32_t ulBitmapLen = ( ulNumBlocks + ( BITS_PER_BYTE - 1U ) ) >> LOG2_BITS_PER_BYTE;
+
+        return ( uint32_t ) sizeof( OTA_CheckpointHeader_t ) + ulBitmapLen + OTA_CHECKPOINT_HASH_STATE_BYTES;
+    }
+
+
+/* Save a checkpoint of the download of the file, replacing the previous one. A failure only
+ * means that a reset would resume from an older checkpoint, so it doesn't stop the download. */
+
+    static void prvSaveCheckpoint( OTA_FileContext_t * C )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvSaveCheckpoint" );
+
+        uint32_t ulSize = prvCheckpointSize( C );
+        uint32_t ulBitmapLen = ulSize - ( uint32_t ) sizeof( OTA_CheckpointHeader_t ) - OTA_CHECKPOINT_HASH_STATE_BYTES;
+        OTA_CheckpointHeader_t xHeader;
+        uint8_t * pucCheckpoint;
+        OTA_Err_t xErr;
+
+        if( ( C->pucRxBlockBitmap != NULL ) && ( xOTA_Agent.xPALCallbacks.xSaveCheckpoint != NULL ) )
+        {
+            pucCheckpoint = ( uint8_t * ) pvPortMalloc( ulSize ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+
+            if( pucCheckpoint != NULL )
+            {
+                memset( pucCheckpoint, 0, ulSize );
+                memset( &xHeader, 0, sizeof( xHeader ) );
+                xHeader.ulMagic = OTA_CHECKPOINT_MAGIC;
+                xHeader.ulServerFileID = C->ulServerFileID;
+                xHeader.ulStreamNameHash = prvHashStreamName( C->pucStreamName );
+                xHeader.ulFileSize = C->ulFileSize;
+                xHeader.ulBlocksRemaining = C->ulBlocksRemaining;
+                memcpy( &pucCheckpoint[ sizeof( xHeader ) ], C->pucRxBlockBitmap, ulBitmapLen );
+
+                #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+                    if( C->pvSigVerifyContext != NULL )
+                    {
+                        uint32_t ulIndex;
+                        uint32_t ulBlock;
+                        size_t xStateSize = 0;
+
+                        if( CRYPTO_SignatureVerificationSave( C->pvSigVerifyContext,
+                                                              &pucCheckpoint[ sizeof( xHeader ) + ulBitmapLen ],
+                                                              &xStateSize ) == pdTRUE )
+                        {
+                            xHeader.ulHashedBlocks = xSigVerify.ulNextBlock;
+                            xHeader.ulHashStateSize = ( uint32_t ) xStateSize;
+
+                            /* The held blocks are not in the hash yet and they are lost on a reset,
+                             * so they are requested again after one. */
+                            for( ulIndex = 0U; ulIndex < otaconfigSIGNATURE_PENDING_BLOCKS; ulIndex++ )
+                            {
+                                if( xSigVerify.xPending[ ulIndex ].ulBlockSize > 0U )
+                                {
+                                    ulBlock = xSigVerify.xPending[ ulIndex ].ulBlockIndex;
+                                    pucCheckpoint[ sizeof( xHeader ) + ( ulBlock >> LOG2_BITS_PER_BYTE ) ] |= ( uint8_t ) ( 1U << ( ulBlock % BITS_PER_BYTE ) );
+                                    xHeader.ulBlocksRemaining++;
+                                }
+                            }
+                        }
+                    }
+                #endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+                memcpy( pucCheckpoint, &xHeader, sizeof( xHeader ) );
+                xErr = xOTA_Agent.xPALCallbacks.xSaveCheckpoint( C, pucCheckpoint, ulSize );
+
+                if( xErr != kOTA_Err_None )
+                {
+                    OTA_LOG_L1( "[%s] Warning: Unable to save the checkpoint (0x%08x).\r\n", OTA_METHOD_NAME, xErr );
+                }
+                else
+                {
+                    OTA_LOG_L2( "[%s] Saved the checkpoint with %u blocks remaining.\r\n", OTA_METHOD_NAME, xHeader.ulBlocksRemaining );
+                }
+
+                vPortFree( pucCheckpoint );
+            }
+        }
+    }
+
+
+/* Resume the download of the file from the saved checkpoint. It is used only if it belongs to
+ * the same job, which has the same file ID, stream name and file size, and if its bitmap agrees
+ * with its count of missing blocks. The bitmap of the file must be freshly initialized. */
+
+    static void prvLoadCheckpoint( OTA_FileContext_t * C )
+    {
+        DEFINE_OTA_METHOD_NAME( "prvLoadCheckpoint" );
+
+        uint32_t ulSize = prvCheckpointSize( C );
+        uint32_t ulBitmapLen = ulSize - ( uint32_t ) sizeof( OTA_CheckpointHeader_t ) - OTA_CHECKPOINT_HASH_STATE_BYTES;
+        OTA_CheckpointHeader_t xHeader;
+        uint8_t * pucCheckpoint;
+        uint32_t ulIndex;
+        uint32_t ulMissing = 0U;
+        uint8_t ucByte;
+
+        C->xIsResuming = pdFALSE;
+
+        if( ( C->pucRxBlockBitmap != NULL ) && ( xOTA_Agent.xPALCallbacks.xLoadCheckpoint != NULL ) )
+        {
+            pucCheckpoint = ( uint8_t * ) pvPortMalloc( ulSize ); /*lint !e9079 FreeRTOS malloc port returns void*. */
+
+            if( pucCheckpoint != NULL )
+            {
+                if( xOTA_Agent.xPALCallbacks.xLoadCheckpoint( C, pucCheckpoint, ulSize ) == kOTA_Err_None )
+                {
+                    memcpy( &xHeader, pucCheckpoint, sizeof( xHeader ) );
+
+                    /* Count the missing blocks of the saved bitmap. */
+                    for( ulIndex = 0U; ulIndex < ulBitmapLen; ulIndex++ )
+                    {
+                        for( ucByte = pucCheckpoint[ sizeof( xHeader ) + ulIndex ]; ucByte != 0U; ucByte &= ( uint8_t ) ( ucByte - 1U ) )
+                        {
+                            ulMissing++;
+                        }
+                    }
+
+                    /* The saved bitmap must not mark any out of range block as missing. */
+                    if( ( ulBitmapLen > 0U ) &&
+                        ( xHeader.ulMagic == OTA_CHECKPOINT_MAGIC ) &&
+                        ( xHeader.ulServerFileID == C->ulServerFileID ) &&
+                        ( xHeader.ulStreamNameHash == prvHashStreamName( C->pucStreamName ) ) &&
+                        ( xHeader.ulFileSize == C->ulFileSize ) &&
+                        ( xHeader.ulBlocksRemaining == ulMissing ) &&
+                        ( xHeader.ulHashStateSize <= OTA_CHECKPOINT_HASH_STATE_BYTES ) &&
+                        ( ( C->pucRxBlockBitmap[ ulBitmapLen - 1U ] | pucCheckpoint[ sizeof( xHeader ) + ulBitmapLen - 1U ] ) == C->pucRxBlockBitmap[ ulBitmapLen - 1U ] ) )
+                    {
+                        memcpy( C->pucRxBlockBitmap, &pucCheckpoint[ sizeof( xHeader ) ], ulBitmapLen );
+                        C->ulBlocksRemaining = ulMissing;
+                        C->xIsResuming = pdTRUE;
+
+                        #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+                            prvSigVerifyStop( C );
+
+                            if( ( xHeader.ulHashStateSize > 0U ) &&
+                                ( CRYPTO_SignatureVerificationRestore( &C->pvSigVerifyContext,
+                                                                       &pucCheckpoint[ sizeof( xHeader ) + ulBitmapLen ],
+                                                                       ( size_t ) xHeader.ulHashStateSize ) == pdTRUE ) )
+                            {
+                                xSigVerify.ulNextBlock = xHeader.ulHashedBlocks;
+                            }
+                            else
+                            {
+                                OTA_LOG_L1( "[%s] The checkpoint has no file hash. The PAL will read the file back.\r\n", OTA_METHOD_NAME );
+                                C->pvSigVerifyContext = NULL;
+                            }
+                        #endif
+
+                        OTA_LOG_L1( "[%s] Resuming the download with %u blocks remaining.\r\n", OTA_METHOD_NAME, C->ulBlocksRemaining );
+                    }
+                    else
+                    {
+                        OTA_LOG_L1( "[%s] Ignoring the checkpoint of another download.\r\n", OTA_METHOD_NAME );
+                    }
+                }
+
+                vPortFree( pucCheckpoint );
+            }
+        }
+    }
+
+
+/* Delete the checkpoint once the download is over, so that it isn't offered to a later job. */
+
+    static void prvDeleteCheckpoint( OTA_FileContext_t * C )
+    {
+        if( xOTA_Agent.xPALCallbacks.xSaveCheckpoint != NULL )
+        {
+            ( void ) xOTA_Agent.xPALCallbacks.xSaveCheckpoint( C, NULL, 0U );
+        }
+    }
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
+
+
+/* This function is called whenever we receive a MQTT publish message on one of our OTA topics. */
+static void prvOTAPublishCallback( void * pvCallbackContext,
+                                   IotMqttCallbackParam_t * const pxPublishData )
+{
+    DEFINE_OTA_METHOD_NAME_L2( "prvOTAPublishCallback" );
+
+    BaseType_t xReturn;
+    OTA_PubMsg_t * pxMsg;
+
+	if( pxPublishData->u.message.info.payloadLength > OTA_DATA_BLOCK_SIZE)
+    {
+       OTA_LOG_L1( "Error: buffers are too small %d to contains the payload %d.\r\n", OTA_DATA_BLOCK_SIZE ,  pxPublishData->u.message.info.payloadLength   );
+	   return;
+	}
+    /* If we're running the OTA task, send publish messages to it for processing. */
+    if( xOTA_Agent.xOTA_EventFlags != NULL )
+    {
+        xOTA_Agent.xStatistics.ulOTA_PacketsReceived++;
+
+        /* Lock up a buffer to copy publish data. */
+        pxMsg = prvOTAPubMessageGet();
+
+        if(pxMsg != NULL)
+        {
+			pxMsg->lMsgType = ( int32_t ) ( intptr_t ) pvCallbackContext; /*lint !e923 The context variable is actually the message type. */
+			pxMsg->pxPubData.ulDataLength = pxPublishData->u.message.info.payloadLength;
+			if ( ( int32_t ) ( intptr_t ) pvCallbackContext == eOTA_PubMsgType_Stream){
+				OTA_LOG_L2( "[%s] Stream Received.\r\n", OTA_METHOD_NAME );
+				}
+
+
+			memcpy( pxMsg->pxPubData.vData, pxPublishData->u.message.info.pPayload, pxMsg->pxPubData.ulDataLength );
+			xReturn = xQueueSendToBack( xOTA_Agent.xOTA_MsgQ, &pxMsg, ( TickType_t ) 0 );
+			if( xReturn == pdPASS )
+			{
+				xOTA_Agent.xStatistics.ulOTA_PacketsQueued++;
+				( void ) xEventGroupSetBits( xOTA_Agent.xOTA_EventFlags, OTA_EVT_MASK_MSG_READY );
+				/* Take ownership of the MQTT buffer. */
+			}
+			else
+			{
+				OTA_LOG_L1( "Error: Could not push message to queue.\r\n" );
+				/* Free up locked buffer. */
+				prvOTAPubMessageFree(pxMsg);
+				xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+			}
+        }else
+        {
+        	xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+        	OTA_LOG_L1( "Error: Could not get a free buffer to copy callback data.\r\n" );
+        }
+    }
+    else
+    {
+        /* This doesn't normally occur unless we're subscribed to an OTA topic when
+         * the OTA agent is not initialized. Just drop the message by not taking
+         * ownership since we don't know if we'll ever be able to process it. */
+        OTA_LOG_L2( "[%s] Warning: Received MQTT message but agent isn't ready.\r\n", OTA_METHOD_NAME );
+        xOTA_Agent.xStatistics.ulOTA_PacketsDropped++;
+    }
+}
+
+
+
+/* NOTE: This implementation only supports 1 OTA context. Concurrent OTA is not supported. */
+
+static void prvOTAUpdateTask( void * pvUnused )
+{
+    DEFINE_OTA_METHOD_NAME( "prvOTAUpdateTask" );
+
+    EventBits_t uxBits;
+    OTA_FileContext_t * C = NULL;
+    OTA_Err_t xErr;
+    OTA_PubMsg_t * pxMsgMetaData;
+
+    ( void ) pvUnused;
+
+
+    /* Subscribe to the OTA job notification topic. */
+    if( prvSubscribeToJobNotificationTopics() == ( bool_t ) pdTRUE )
+    {
+        xOTA_Agent.xOTA_EventFlags = xEventGroupCreate();
+
+        if( xOTA_Agent.xOTA_EventFlags != NULL )
+        {
+            /* Check if the firmware image is in self test mode. If so, enable the self test timer. */
+            ( void ) OTA_CheckForSelfTest();
+
+            /*Save the self-test mode in a flag. This flag is cleared when self-test is successful.*/
+            xInSelfTest = prvInSelftest();
+
+            /* Send a request to the job service for the latest available job. */
+            ( void ) OTA_CheckForUpdate();
+
+            /* Put the OTA agent in the ready state. */
+            xOTA_Agent.eState = eOTA_AgentState_Ready;
+
+            for( ; ; )
+            {
+                uxBits = xEventGroupWaitBits(
+                    xOTA_Agent.xOTA_EventFlags, /* The event group being tested. */
+                    OTA_EVT_MASK_ALL_EVENTS,    /* The bits within the event group to wait for. */
+                    pdTRUE,                     /* Bits should be cleared before returning. */
+                    pdFALSE,                    /* Any bit set will do. */
+                    ( TickType_t ) ~( 0U ) );   /* Wait forever. */
+
+                /* Check for the shutdown event. */
+                if( ( ( uint32_t ) uxBits & OTA_EVT_MASK_SHUTDOWN ) != 0U )
+                {
+                    OTA_LOG_L1( "[%s] Received shutdown event.\r\n", OTA_METHOD_NAME );
+                    break; /* Break, so we stop all OTA processing. */
+                }
+
+                /* Check for a user initiated abort. */
+                if( ( ( ( uint32_t ) uxBits & OTA_EVT_MASK_USER_ABORT ) != 0U ) && ( C != NULL ) )
+                {
+                    OTA_LOG_L1( "[%s] Received user abort event.\r\n", OTA_METHOD_NAME );
+                    ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, kOTA_Err_UserAbort );
+                    #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+                        prvDeleteCheckpoint( C );
+                    #endif
+                    ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                    C = NULL;
+                }
+
+                /* On OTA request timer timeout, publish the stream request if we have context. */
+                if( ( ( uxBits & OTA_EVT_MASK_REQ_TIMEOUT ) != 0U ) && ( C != NULL ) )
+                {
+                    if( C->ulBlocksRemaining > 0U )
+                    {
+                        xErr = prvPublishGetStreamMessage( C );
+
+                        if( xErr != kOTA_Err_None )
+                        {                               /* Abort the current OTA. */
+                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
+                            ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                            C = NULL;
+                        }
+                    }
+                    else
+                    {
+                        /* If there are no blocks remaining, this may have been in flight when the
+                         * last block was received. Just ignore it since it will be cleaned up by
+                         * the agent as required. */
+                    }
+                }
+
+                /* Check if a MQTT message is ready for us to process. */
+                if( ( uxBits & OTA_EVT_MASK_MSG_READY ) != 0U )
+                {
+                    if( ( xOTA_Agent.eState == eOTA_AgentState_Ready ) || ( xOTA_Agent.eState == eOTA_AgentState_Active ) )
+                    {
+                        while( xQueueReceive( xOTA_Agent.xOTA_MsgQ, &pxMsgMetaData, 0 ) != pdFALSE )
+                        {
+                            /* Check for OTA update job messages. */
+                            if( pxMsgMetaData->eMsgType == eOTA_PubMsgType_Job )
+                            {
+                                if( C != NULL )
                                 {
                                     ( void ) prvOTA_Close( C ); /* Abort the existing OTA and ignore impossible false result by design. */
                                 }
@@ -1661,7 +2478,7 @@ static void prvOTAUpdateTask( void * pvUnused )
                                         if( xResult == eIngest_Result_FileComplete )
                                         {
                                             /* File receive is complete and authenticated. Update the job status with the self_test ready identifier. */
-                                            prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_SigCheckPassed, ( int32_t ) NULL );
+                                            prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_SigCheckPassed, 0 );
                                         }
                                         else
                                         {
@@ -1699,7 +2516,20 @@ static void prvOTAUpdateTask( void * pvUnused )
                                     { /* We're actively receiving a file so update the job status as needed. */
                                       /* First reset the momentum counter since we received a good block. */
                                         C->ulRequestMomentum = 0;
-                                        prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_Receiving, ( int32_t ) NULL );
+                                        prvUpdateJobStatus( C, eJobStatus_InProgress, ( int32_t ) eJobReason_Receiving, 0 );
+
+                                        #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+                                            /* Request the next ranges as soon as earlier ones complete
+                                             * instead of waiting for the request timer. */
+                                            xErr = prvPublishWindowRequests( C );
+
+                                            if( xErr != kOTA_Err_None )
+                                            {
+                                                ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
+                                                ( void ) prvOTA_Close( C ); /* Ignore false result since we're setting the pointer to null on the next line. */
+                                                C = NULL;
+                                            }
+                                        #endif
                                     }
                                 }
                             }
@@ -1949,6 +2779,10 @@ static bool_t prvOTA_Close( OTA_FileContext_t * const C )
             C->pucCertFilepath = NULL;
         }
 
+        #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+            prvSigVerifyStop( C );
+        #endif
+
         /* Abort any active file access and release the file resource, if needed. */
         ( void ) xOTA_Agent.xPALCallbacks.xAbort( C );
         memset( C, 0, sizeof( OTA_FileContext_t ) ); /* Clear the entire structure now that it is free. */
@@ -1991,80 +2825,462 @@ bool_t JSON_IsCStringEqual( const char * pcJSONString,
 {
     bool_t xResult;
 
-    if( ( ulLen <= OTA_MAX_JSON_STR_LEN ) &&
-        ( strncmp( pcJSONString, pcCString, ulLen ) == 0 ) &&       /*lint !e9007 I see no side effect. Possibly a lint bug. */
-        ( pcCString[ ulLen ] == '\0' ) )
-    {
-        xResult = pdTRUE;
-    }
-    else
-    {
-        xResult = pdFALSE;
-    }
+    if( ( ulLen <= OTA_MAX_JSON_STR_LEN ) &&
+        ( strncmp( pcJSONString, pcCString, ulLen ) == 0 ) &&       /*lint !e9007 I see no side effect. Possibly a lint bug. */
+        ( pcCString[ ulLen ] == '\0' ) )
+    {
+        xResult = pdTRUE;
+    }
+    else
+    {
+        xResult = pdFALSE;
+    }
+
+    return xResult;
+}
+
+
+/* Hash a JSON key with 32 bit FNV-1a. Zero marks an unfilled hash table so it is never returned. */
+
+static uint32_t prvHashJSONKey( const char * pcKey,
+                                uint32_t ulLen )
+{
+    uint32_t ulHash = 2166136261UL;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0U; ulIndex < ulLen; ulIndex++ )
+    {
+        ulHash ^= ( uint32_t ) ( uint8_t ) pcKey[ ulIndex ];
+        ulHash *= 16777619UL;
+    }
+
+    if( ulHash == 0U )
+    {
+        ulHash = 1U;
+    }
+
+    return ulHash;
+}
+
+
+/* Search our document model for a key match with the given token. The key hash is
+ * compared first so that the key string is only compared for a likely match. A
+ * string match parameter also requires the value token to be the expected string. */
+
+static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
+                                                const char * pcJSON,
+                                                const jsmntok_t * pxTokens,
+                                                uint32_t ulKeyIndex,
+                                                uint32_t ulNumTokens,
+                                                uint16_t * pulMatchingIndexResult )
+{
+    DocParseErr_t eErr = eDocParseErr_ParamKeyNotInModel;
+    const JSON_DocParam_t * pxModelParam;
+    const jsmntok_t * pxValTok;
+    const char * pcJSONString = &pcJSON[ pxTokens[ ulKeyIndex ].start ];
+    uint32_t ulStrLen = ( uint32_t ) pxTokens[ ulKeyIndex ].end - ( uint32_t ) pxTokens[ ulKeyIndex ].start;
+    uint32_t ulValLen;
+    uint32_t ulHash = 0U;
+    uint16_t usParamIndex;
+
+    if( pxDocModel->pulKeyHashes != NULL )
+    {
+        ulHash = prvHashJSONKey( pcJSONString, ulStrLen );
+    }
+
+    for( usParamIndex = 0; usParamIndex < pxDocModel->usNumModelParams; usParamIndex++ )
+    {
+        pxModelParam = &pxDocModel->pxBodyDef[ usParamIndex ];
+
+        if( ( pxDocModel->pulKeyHashes != NULL ) && ( pxDocModel->pulKeyHashes[ usParamIndex ] != ulHash ) )
+        {
+            /* Different hash so it can't be the same key. */
+        }
+        else if( JSON_IsCStringEqual( pcJSONString, ulStrLen, pxModelParam->pcSrcKey ) != ( bool_t ) pdTRUE )
+        {
+            /* Hash collision or no hash table. Not this key. */
+        }
+        else
+        {
+            if( pxModelParam->xModelParamType == eModelParamType_StringMatch )
+            {
+                /* The same key may be in the model with other values so keep searching on a mismatch. */
+                if( ( ulKeyIndex + 1U ) >= ulNumTokens )
+                {
+                    continue;
+                }
+
+                pxValTok = &pxTokens[ ulKeyIndex + 1U ];
+                ulValLen = ( uint32_t ) pxValTok->end - ( uint32_t ) pxValTok->start;
+
+                if( ( pxValTok->type != JSMN_STRING ) ||
+                    ( JSON_IsCStringEqual( &pcJSON[ pxValTok->start ], ulValLen, pxModelParam->pcMatchValue ) != ( bool_t ) pdTRUE ) )
+                {
+                    continue;
+                }
+            }
+
+            /* Per Security, don't allow multiple entries of the same parameter. */
+            if( ( pxDocModel->ulParamsReceivedBitmap & ( 1U << usParamIndex ) ) != 0U ) /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
+            {
+                eErr = eDocParseErr_DuplicatesNotAllowed;
+            }
+            else
+            {
+                /* Mark parameter as received in the bitmap. */
+                pxDocModel->ulParamsReceivedBitmap |= ( 1U << usParamIndex ); /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
+                *pulMatchingIndexResult = usParamIndex;                       /* Save result index for caller. */
+                eErr = eDocParseErr_None;                                     /* We found a matching key in the document model. */
+            }
+
+            break; /* We found a key match so stop searching. */
+        }
+    }
+
+    return eErr;
+}
+
+
+/* Tokenize a JSON document into a heap allocated token array. On failure no tokens are
+ * kept and the error is also recorded in the document. */
+
+static DocParseErr_t prvTokenizeJSON( JSON_Document_t * pxDoc,
+                                      const char * pcJSON,
+                                      uint32_t ulMsgLen )
+{
+    DEFINE_OTA_METHOD_NAME( "prvTokenizeJSON" );
+
+    jsmn_parser xParser;
+    uint32_t ulNumTokens;
+    DocParseErr_t eErr = eDocParseErr_Unknown;
+
+    pxDoc->pcJSON = pcJSON;
+    pxDoc->ulMsgLen = ulMsgLen;
+    pxDoc->pxTokens = NULL;
+    pxDoc->ulNumTokens = 0U;
+
+    /* Count the total number of tokens in our JSON document. */
+    jsmn_init( &xParser );
+    ulNumTokens = ( uint32_t ) jsmn_parse( &xParser, pcJSON, ( size_t ) ulMsgLen, NULL, 1UL );
+
+    if( ulNumTokens > 0U )
+    {
+        /* If the JSON document isn't too big for our token array... */
+        if( ulNumTokens <= OTA_MAX_JSON_TOKENS )
+        {
+            /* Allocate space for the document JSON tokens. */
+            void * pvTokenArray = pvPortMalloc( ulNumTokens * sizeof( jsmntok_t ) ); /* Allocate space on heap for temporary token array. */
+            jsmntok_t * pxTokens = ( jsmntok_t * ) pvTokenArray;                     /*lint !e9079 !e9087 heap allocations return void* so we allow casting to a pointer to the actual type. */
+
+            if( pxTokens != NULL )
+            {
+                /* Reset Jasmine again and tokenize the document for real. */
+                jsmn_init( &xParser );
+
+                if( ( uint32_t ) jsmn_parse( &xParser, pcJSON, ulMsgLen, pxTokens, ulNumTokens ) == ulNumTokens )
+                {
+                    pxDoc->pxTokens = pxTokens;
+                    pxDoc->ulNumTokens = ulNumTokens;
+                    eErr = eDocParseErr_None;
+                }
+                else
+                {
+                    OTA_LOG_L1( "[%s] jsmn_parse didn't match token count when parsing.\r\n", OTA_METHOD_NAME );
+                    vPortFree( pxTokens );
+                    eErr = eDocParseErr_JasmineCountMismatch;
+                }
+            }
+            else
+            {
+                OTA_LOG_L1( "[%s] No memory for JSON tokens.\r\n", OTA_METHOD_NAME );
+                eErr = eDocParseErr_OutOfMemory;
+            }
+        }
+        else
+        {
+            OTA_LOG_L1( "[%s] Document has too many keys.\r\n", OTA_METHOD_NAME );
+            eErr = eDocParseErr_TooManyTokens;
+        }
+    }
+    else
+    {
+        OTA_LOG_L1( "[%s] Invalid JSON document. No tokens parsed. \r\n", OTA_METHOD_NAME );
+        eErr = eDocParseErr_NoTokens;
+    }
+
+    pxDoc->eErr = eErr;
+
+    return eErr;
+}
+
+
+/* Free the tokens of a JSON document. */
+
+static void prvFreeJSONTokens( JSON_Document_t * pxDoc )
+{
+    if( pxDoc->pxTokens != NULL )
+    {
+        vPortFree( pxDoc->pxTokens );
+        pxDoc->pxTokens = NULL;
+    }
+
+    pxDoc->pcJSON = NULL;
+    pxDoc->ulMsgLen = 0U;
+    pxDoc->ulNumTokens = 0U;
+    pxDoc->eErr = eDocParseErr_Unknown;
+}
+
+
+/* Extract the desired fields from a tokenized JSON document based on the specified document model. */
+
+static DocParseErr_t prvParseTokensByModel( const JSON_Document_t * pxDoc,
+                                            JSON_DocModel_t * pxDocModel )
+{
+    DEFINE_OTA_METHOD_NAME( "prvParseTokensByModel" );
+
+    const char * pcJSON = pxDoc->pcJSON;
+    const jsmntok_t * pxTokens = pxDoc->pxTokens;
+    uint32_t ulNumTokens = pxDoc->ulNumTokens;
+    const JSON_DocParam_t * pxModelParam = pxDocModel->pxBodyDef;
+    const jsmntok_t * pxValTok;
+    uint32_t ulTokenLen;
+    MultiParmPtr_t xParamAddr; /*lint !e9018 We intentionally use this union to cast the parameter address to the proper type. */
+    uint32_t ulIndex;
+    uint16_t usModelParamIndex;
+    uint32_t ulScanIndex;
+    DocParseErr_t eErr;
+
+    /* Start the parser in an error free state. */
+    eErr = eDocParseErr_None;
+
+    /* Examine each JSON token, searching for job parameters based on our document model. */
+    for( ulIndex = 0U; ( eErr == eDocParseErr_None ) && ( ulIndex < ulNumTokens ); ulIndex++ )
+    {
+        /* All parameter keys are JSON strings. */
+        if( pxTokens[ ulIndex ].type == JSMN_STRING )
+        {
+            /* Search the document model to see if it matches the current key. */
+            eErr = prvSearchModelForTokenKey( pxDocModel, pcJSON, pxTokens, ulIndex, ulNumTokens, &usModelParamIndex );
+
+            /* If we didn't find a match in the model, skip over it and its descendants. */
+            if( eErr == eDocParseErr_ParamKeyNotInModel )
+            {
+                int32_t iRoot = ( int32_t ) ulIndex; /* Create temp root from the unrecognized tokens index. Use signed int since the parent index is signed. */
+                ulIndex++;                           /* Skip the active key since it's the one we don't recognize. */
+
+                /* Skip tokens whose parents are equal to or deeper than the unrecognized temporary root token level. */
+                while( ( ulIndex < ulNumTokens ) && ( pxTokens[ ulIndex ].parent >= iRoot ) )
+                {
+                    ulIndex++; /* Skip over all descendants of the unknown parent. */
+                }
+
+                --ulIndex;                /* Adjust for outer for-loop increment. */
+                eErr = eDocParseErr_None; /* Unknown key structures are simply skipped so clear the error state to continue. */
+            }
+            else if( eErr == eDocParseErr_None )
+            {
+                /* We found the parameter key in the document model. */
+
+                /* Get the value field (i.e. the following token) for the parameter. */
+                pxValTok = &pxTokens[ ulIndex + 1UL ];
+
+                /* Verify the field type is what we expect for this parameter. */
+                if( pxValTok->type != pxModelParam[ usModelParamIndex ].eJasmineType )
+                {
+                    ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                    OTA_LOG_L1( "[%s] parameter type mismatch [ %s : %.*s ] type %u, expected %u\r\n",
+                                OTA_METHOD_NAME, pxModelParam[ usModelParamIndex ].pcSrcKey, ulTokenLen,
+                                &pcJSON[ pxValTok->start ],
+                                pxValTok->type, pxModelParam[ usModelParamIndex ].eJasmineType );
+                    eErr = eDocParseErr_FieldTypeMismatch;
+                    /* break; */
+                }
+                else if( ( eModelParamType_StringMatch == pxModelParam[ usModelParamIndex ].xModelParamType ) ||
+                         ( OTA_DONT_STORE_PARAM == pxModelParam[ usModelParamIndex ].ulDestOffset ) )
+                {
+                    /* Nothing to do with this parameter since we're not storing it. A matched value was already compared. */
+                    continue;
+                }
+                else
+                {
+                    /* Get destination offset to parameter storage location. */
+
+                    /* If it's within the models context structure, add in the context instance base address. */
+                    if( pxModelParam[ usModelParamIndex ].ulDestOffset < pxDocModel->ulContextSize )
+                    {
+                        xParamAddr.ulVal = pxDocModel->ulContextBase + pxModelParam[ usModelParamIndex ].ulDestOffset;
+                    }
+                    else
+                    {
+                        /* It's a raw pointer so keep it as is. */
+                        xParamAddr.ulVal = pxModelParam[ usModelParamIndex ].ulDestOffset;
+                    }
 
-    return xResult;
-}
+                    if( eModelParamType_StringCopy == pxModelParam[ usModelParamIndex ].xModelParamType )
+                    {
+                        /* Malloc memory for a copy of the value string plus a zero terminator. */
+                        ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                        void * pvStringCopy = pvPortMalloc( ulTokenLen + 1U );
 
+                        if( pvStringCopy != NULL )
+                        {
+                            *xParamAddr.ppvPtr = pvStringCopy;
+                            char * pcStringCopy = *xParamAddr.ppcPtr;
+                            /* Copy parameter string into newly allocated memory. */
+                            memcpy( pcStringCopy, &pcJSON[ pxValTok->start ], ulTokenLen );
+                            /* Zero terminate the new string. */
+                            pcStringCopy[ ulTokenLen ] = '\0';
+                            OTA_LOG_L1( "[%s] Extracted parameter [ %s: %s ]\r\n",
+                                        OTA_METHOD_NAME,
+                                        pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                        pcStringCopy );
+                        }
+                        else
+                        { /* Stop processing on error. */
+                            eErr = eDocParseErr_OutOfMemory;
+                            /* break; */
+                        }
+                    }
+                    else if( eModelParamType_StringInDoc == pxModelParam[ usModelParamIndex ].xModelParamType )
+                    {
+                        /* Copy pointer to source string instead of duplicating the string. */
+                        const char * pcStringInDoc = &pcJSON[ pxValTok->start ];
 
-/* Search our document model for a key match with the given token. */
+                        if( pcStringInDoc != NULL ) /*lint !e774 This can result in NULL if offset rolls the address around. */
+                        {
+                            *xParamAddr.ppccPtr = pcStringInDoc;
+                            ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+                            OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.*s ]\r\n",
+                                        OTA_METHOD_NAME,
+                                        pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                        ulTokenLen, pcStringInDoc );
+                        }
+                        else
+                        {
+                            /* This should never happen unless there's a bug or memory is corrupted. */
+                            OTA_LOG_L1( "[%s] Error! JSON token produced a null pointer for parameter [ %s ]\r\n",
+                                        OTA_METHOD_NAME,
+                                        pxModelParam[ usModelParamIndex ].pcSrcKey );
+                            eErr = eDocParseErr_InvalidToken;
+                        }
+                    }
+                    else if( eModelParamType_UInt32 == pxModelParam[ usModelParamIndex ].xModelParamType )
+                    {
+                        char * pEnd;
+                        const char * pStart = &pcJSON[ pxValTok->start ];
+                        *xParamAddr.pulPtr = strtoul( pStart, &pEnd, 0 );
 
-static DocParseErr_t prvSearchModelForTokenKey( JSON_DocModel_t * pxDocModel,
-                                                const char * pcJSONString,
-                                                uint32_t ulStrLen,
-                                                uint16_t * pulMatchingIndexResult )
-{
-    DocParseErr_t eErr = eDocParseErr_ParamKeyNotInModel;
-    uint16_t usParamIndex;
+                        if( pEnd == &pcJSON[ pxValTok->end ] )
+                        {
+                            OTA_LOG_L1( "[%s] Extracted parameter [ %s: %u ]\r\n",
+                                        OTA_METHOD_NAME,
+                                        pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                        *xParamAddr.pulPtr );
+                        }
+                        else
+                        {
+                            eErr = eDocParseErr_InvalidNumChar;
+                        }
+                    }
+                    else if( eModelParamType_SigBase64 == pxModelParam[ usModelParamIndex ].xModelParamType )
+                    {
+                        /* Allocate space for and decode the base64 signature. */
+                        void * pvSignature = pvPortMalloc( sizeof( Sig256_t ) );
 
-    for( usParamIndex = 0; usParamIndex < pxDocModel->usNumModelParams; usParamIndex++ )
-    {
-        if( JSON_IsCStringEqual( pcJSONString, ulStrLen,
-                                 pxDocModel->pxBodyDef[ usParamIndex ].pcSrcKey ) == ( bool_t ) pdTRUE )
-        {
-            /* Per Security, don't allow multiple entries of the same parameter. */
-            if( ( pxDocModel->ulParamsReceivedBitmap & ( 1U << usParamIndex ) ) != 0U ) /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
-            {
-                eErr = eDocParseErr_DuplicatesNotAllowed;
+                        if( pvSignature != NULL )
+                        {
+                            size_t xActualLen;
+                            *xParamAddr.ppvPtr = pvSignature;
+                            Sig256_t * pxSig256 = *xParamAddr.ppxSig256Ptr;
+                            ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
+
+                            if( mbedtls_base64_decode( pxSig256->ucData, sizeof( pxSig256->ucData ), &xActualLen,
+                                                       ( const uint8_t * ) &pcJSON[ pxValTok->start ], ulTokenLen ) != 0 )
+                            { /* Stop processing on error. */
+                                OTA_LOG_L1( "[%s] mbedtls_base64_decode failed.\r\n", OTA_METHOD_NAME );
+                                eErr = eDocParseErr_Base64Decode;
+                                /* break; */
+                            }
+                            else
+                            {
+                                pxSig256->usSize = ( uint16_t ) xActualLen;
+                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.32s... ]\r\n",
+                                            OTA_METHOD_NAME,
+                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
+                                            &pcJSON[ pxValTok->start ] );
+                            }
+                        }
+                        else
+                        {
+                            /* We failed to allocate needed memory. Everything will be freed below upon failure. */
+                            eErr = eDocParseErr_OutOfMemory;
+                        }
+                    }
+                    else if( eModelParamType_Ident == pxModelParam[ usModelParamIndex ].xModelParamType )
+                    {
+                        OTA_LOG_L1( "[%s] Identified parameter [ %s ]\r\n",
+                                    OTA_METHOD_NAME,
+                                    pxModelParam[ usModelParamIndex ].pcSrcKey );
+                        *xParamAddr.pxBoolPtr = pdTRUE;
+                    }
+                    else
+                    {
+                        /* Ignore invalid document model type. */
+                    }
+                }
             }
             else
             {
-                /* Mark parameter as received in the bitmap. */
-                pxDocModel->ulParamsReceivedBitmap |= ( 1U << usParamIndex ); /*lint !e9032 usParamIndex will never be greater than kDocModel_MaxParams, which is the the size of the bitmap. */
-                *pulMatchingIndexResult = usParamIndex;                       /* Save result index for caller. */
-                eErr = eDocParseErr_None;                                     /* We found a matching key in the document model. */
+                /* Nothing special to do. The error will break us out of the loop. */
             }
+        }
+        else
+        {
+            /* Ignore tokens that are not strings and move on to the next. */
+        }
+    } /*lint !e850 ulIndex is intentionally modified within the loop to skip over unknown tags. */
 
-            break; /* We found a key match so stop searching. */
+    if( eErr == eDocParseErr_None )
+    {
+        uint32_t ulMissingParams = ( pxDocModel->ulParamsReceivedBitmap & pxDocModel->ulParamsRequiredBitmap )
+                                   ^ pxDocModel->ulParamsRequiredBitmap;
+
+        if( ulMissingParams != 0U )
+        {
+            /* The job document did not have all required document model parameters. */
+            for( ulScanIndex = 0UL; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
+            {
+                if( ( ulMissingParams & ( 1UL << ulScanIndex ) ) != 0UL )
+                {
+                    OTA_LOG_L1( "[%s] parameter not present: %s\r\n",
+                                OTA_METHOD_NAME,
+                                pxModelParam[ ulScanIndex ].pcSrcKey );
+                }
+            }
+
+            eErr = eDocParseErr_MalformedDoc;
         }
     }
+    else
+    {
+        OTA_LOG_L1( "[%s] Error (%d) parsing JSON document.\r\n", OTA_METHOD_NAME, ( int32_t ) eErr );
+    }
 
     return eErr;
 }
 
 
-
 /* Extract the desired fields from the JSON document based on the specified document model. */
 
-static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
-                                          uint32_t ulMsgLen,
-                                          JSON_DocModel_t * pxDocModel )
+DocParseErr_t JSON_ParseByModel( const char * pcJSON,
+                                 uint32_t ulMsgLen,
+                                 JSON_DocModel_t * pxDocModel )
 {
-    DEFINE_OTA_METHOD_NAME( "prvParseJSONbyModel" );
+    DEFINE_OTA_METHOD_NAME( "JSON_ParseByModel" );
 
-    const JSON_DocParam_t * pxModelParam;
-    jsmn_parser xParser;
-    jsmntok_t * pxTokens, * pxValTok;
-    uint32_t ulNumTokens, ulTokenLen;
-    MultiParmPtr_t xParamAddr; /*lint !e9018 We intentionally use this union to cast the parameter address to the proper type. */
-    uint32_t ulIndex;
-    uint16_t usModelParamIndex;
-    uint32_t ulScanIndex;
+    JSON_Document_t xDoc;
     DocParseErr_t eErr = eDocParseErr_Unknown;
 
-
-    /* Reset the Jasmine tokenizer. */
-    jsmn_init( &xParser );
-
     /* Validate some initial parameters. */
     if( pxDocModel == NULL )
     {
@@ -2086,272 +3302,26 @@ static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
         OTA_LOG_L1( "[%s] JSON document pointer is NULL!\r\n", OTA_METHOD_NAME );
         eErr = eDocParseErr_NullDocPointer;
     }
-    else
+    else if( ( xDispatchedJobDoc.pcJSON == pcJSON ) && ( xDispatchedJobDoc.ulMsgLen == ulMsgLen ) )
     {
-        pxModelParam = pxDocModel->pxBodyDef;
-
-        /* Count the total number of tokens in our JSON document. */
-        ulNumTokens = ( uint32_t ) jsmn_parse( &xParser, pcJSON, ( size_t ) ulMsgLen, NULL, 1UL );
+        /* This is the job document being dispatched. It was already tokenized. */
+        eErr = xDispatchedJobDoc.eErr;
 
-        if( ulNumTokens > 0U )
+        if( eErr == eDocParseErr_None )
         {
-            /* If the JSON document isn't too big for our token array... */
-            if( ulNumTokens <= OTA_MAX_JSON_TOKENS )
-            {
-                /* Allocate space for the document JSON tokens. */
-                void * pvTokenArray = pvPortMalloc( ulNumTokens * sizeof( jsmntok_t ) ); /* Allocate space on heap for temporary token array. */
-                pxTokens = ( jsmntok_t * ) pvTokenArray;                                 /*lint !e9079 !e9087 heap allocations return void* so we allow casting to a pointer to the actual type. */
-
-                if( pxTokens != NULL )
-                {
-                    /* Reset Jasmine again and tokenize the document for real. */
-                    jsmn_init( &xParser );
-                    ulIndex = ( uint32_t ) jsmn_parse( &xParser, pcJSON, ulMsgLen, pxTokens, ulNumTokens );
-
-                    if( ulIndex == ulNumTokens )
-                    {
-                        /* Start the parser in an error free state. */
-                        eErr = eDocParseErr_None;
-
-                        /* Examine each JSON token, searching for job parameters based on our document model. */
-                        for( ulIndex = 0U; ( eErr == eDocParseErr_None ) && ( ulIndex < ulNumTokens ); ulIndex++ )
-                        {
-                            /* All parameter keys are JSON strings. */
-                            if( pxTokens[ ulIndex ].type == JSMN_STRING )
-                            {
-                                /* Search the document model to see if it matches the current key. */
-                                ulTokenLen = ( uint32_t ) pxTokens[ ulIndex ].end - ( uint32_t ) pxTokens[ ulIndex ].start;
-                                eErr = prvSearchModelForTokenKey( pxDocModel, &pcJSON[ pxTokens[ ulIndex ].start ], ulTokenLen, &usModelParamIndex );
-
-                                /* If we didn't find a match in the model, skip over it and its descendants. */
-                                if( eErr == eDocParseErr_ParamKeyNotInModel )
-                                {
-                                    int32_t iRoot = ( int32_t ) ulIndex; /* Create temp root from the unrecognized tokens index. Use signed int since the parent index is signed. */
-                                    ulIndex++;                           /* Skip the active key since it's the one we don't recognize. */
-
-                                    /* Skip tokens whose parents are equal to or deeper than the unrecognized temporary root token level. */
-                                    while( ( ulIndex < ulNumTokens ) && ( pxTokens[ ulIndex ].parent >= iRoot ) )
-                                    {
-                                        ulIndex++; /* Skip over all descendants of the unknown parent. */
-                                    }
-
-                                    --ulIndex;                /* Adjust for outer for-loop increment. */
-                                    eErr = eDocParseErr_None; /* Unknown key structures are simply skipped so clear the error state to continue. */
-                                }
-                                else if( eErr == eDocParseErr_None )
-                                {
-                                    /* We found the parameter key in the document model. */
-
-                                    /* Get the value field (i.e. the following token) for the parameter. */
-                                    pxValTok = &pxTokens[ ulIndex + 1UL ];
-
-                                    /* Verify the field type is what we expect for this parameter. */
-                                    if( pxValTok->type != pxModelParam[ usModelParamIndex ].eJasmineType )
-                                    {
-                                        ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                        OTA_LOG_L1( "[%s] parameter type mismatch [ %s : %.*s ] type %u, expected %u\r\n",
-                                                    OTA_METHOD_NAME, pxModelParam[ usModelParamIndex ].pcSrcKey, ulTokenLen,
-                                                    &pcJSON[ pxValTok->start ],
-                                                    pxValTok->type, pxModelParam[ usModelParamIndex ].eJasmineType );
-                                        eErr = eDocParseErr_FieldTypeMismatch;
-                                        /* break; */
-                                    }
-                                    else if( OTA_DONT_STORE_PARAM == pxModelParam[ usModelParamIndex ].ulDestOffset )
-                                    {
-                                        /* Nothing to do with this parameter since we're not storing it. */
-                                        continue;
-                                    }
-                                    else
-                                    {
-                                        /* Get destination offset to parameter storage location. */
-
-                                        /* If it's within the models context structure, add in the context instance base address. */
-                                        if( pxModelParam[ usModelParamIndex ].ulDestOffset < pxDocModel->ulContextSize )
-                                        {
-                                            xParamAddr.ulVal = pxDocModel->ulContextBase + pxModelParam[ usModelParamIndex ].ulDestOffset;
-                                        }
-                                        else
-                                        {
-                                            /* It's a raw pointer so keep it as is. */
-                                            xParamAddr.ulVal = pxModelParam[ usModelParamIndex ].ulDestOffset;
-                                        }
-
-                                        if( eModelParamType_StringCopy == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Malloc memory for a copy of the value string plus a zero terminator. */
-                                            ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                            void * pvStringCopy = pvPortMalloc( ulTokenLen + 1U );
-
-                                            if( pvStringCopy != NULL )
-                                            {
-                                                *xParamAddr.ppvPtr = pvStringCopy;
-                                                char * pcStringCopy = *xParamAddr.ppcPtr;
-                                                /* Copy parameter string into newly allocated memory. */
-                                                memcpy( pcStringCopy, &pcJSON[ pxValTok->start ], ulTokenLen );
-                                                /* Zero terminate the new string. */
-                                                pcStringCopy[ ulTokenLen ] = '\0';
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            pcStringCopy );
-                                            }
-                                            else
-                                            { /* Stop processing on error. */
-                                                eErr = eDocParseErr_OutOfMemory;
-                                                /* break; */
-                                            }
-                                        }
-                                        else if( eModelParamType_StringInDoc == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Copy pointer to source string instead of duplicating the string. */
-                                            const char * pcStringInDoc = &pcJSON[ pxValTok->start ];
-
-                                            if( pcStringInDoc != NULL ) /*lint !e774 This can result in NULL if offset rolls the address around. */
-                                            {
-                                                *xParamAddr.ppccPtr = pcStringInDoc;
-                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.*s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            ulTokenLen, pcStringInDoc );
-                                            }
-                                            else
-                                            {
-                                                /* This should never happen unless there's a bug or memory is corrupted. */
-                                                OTA_LOG_L1( "[%s] Error! JSON token produced a null pointer for parameter [ %s ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey );
-                                                eErr = eDocParseErr_InvalidToken;
-                                            }
-                                        }
-                                        else if( eModelParamType_UInt32 == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            char * pEnd;
-                                            const char * pStart = &pcJSON[ pxValTok->start ];
-                                            *xParamAddr.pulPtr = strtoul( pStart, &pEnd, 0 );
-
-                                            if( pEnd == &pcJSON[ pxValTok->end ] )
-                                            {
-                                                OTA_LOG_L1( "[%s] Extracted parameter [ %s: %u ]\r\n",
-                                                            OTA_METHOD_NAME,
-                                                            pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                            *xParamAddr.pulPtr );
-                                            }
-                                            else
-                                            {
-                                                eErr = eDocParseErr_InvalidNumChar;
-                                            }
-                                        }
-                                        else if( eModelParamType_SigBase64 == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            /* Allocate space for and decode the base64 signature. */
-                                            void * pvSignature = pvPortMalloc( sizeof( Sig256_t ) );
-
-                                            if( pvSignature != NULL )
-                                            {
-                                                size_t xActualLen;
-                                                *xParamAddr.ppvPtr = pvSignature;
-                                                Sig256_t * pxSig256 = *xParamAddr.ppxSig256Ptr;
-                                                ulTokenLen = ( uint32_t ) ( pxValTok->end ) - ( uint32_t ) ( pxValTok->start );
-
-                                                if( mbedtls_base64_decode( pxSig256->ucData, sizeof( pxSig256->ucData ), &xActualLen,
-                                                                           ( const uint8_t * ) &pcJSON[ pxValTok->start ], ulTokenLen ) != 0 )
-                                                { /* Stop processing on error. */
-                                                    OTA_LOG_L1( "[%s] mbedtls_base64_decode failed.\r\n", OTA_METHOD_NAME );
-                                                    eErr = eDocParseErr_Base64Decode;
-                                                    /* break; */
-                                                }
-                                                else
-                                                {
-                                                    pxSig256->usSize = ( uint16_t ) xActualLen;
-                                                    OTA_LOG_L1( "[%s] Extracted parameter [ %s: %.32s... ]\r\n",
-                                                                OTA_METHOD_NAME,
-                                                                pxModelParam[ usModelParamIndex ].pcSrcKey,
-                                                                &pcJSON[ pxValTok->start ] );
-                                                }
-                                            }
-                                            else
-                                            {
-                                                /* We failed to allocate needed memory. Everything will be freed below upon failure. */
-                                                eErr = eDocParseErr_OutOfMemory;
-                                            }
-                                        }
-                                        else if( eModelParamType_Ident == pxModelParam[ usModelParamIndex ].xModelParamType )
-                                        {
-                                            OTA_LOG_L1( "[%s] Identified parameter [ %s ]\r\n",
-                                                        OTA_METHOD_NAME,
-                                                        pxModelParam[ usModelParamIndex ].pcSrcKey );
-                                            *xParamAddr.pxBoolPtr = pdTRUE;
-                                        }
-                                        else
-                                        {
-                                            /* Ignore invalid document model type. */
-                                        }
-                                    }
-                                }
-                                else
-                                {
-                                    /* Nothing special to do. The error will break us out of the loop. */
-                                }
-                            }
-                            else
-                            {
-                                /* Ignore tokens that are not strings and move on to the next. */
-                            }
-                        }
-
-                        /* Free the token memory. */
-                        vPortFree( pxTokens ); /*lint !e850 ulIndex is intentionally modified within the loop to skip over unknown tags. */
-
-                        if( eErr == eDocParseErr_None )
-                        {
-                            uint32_t ulMissingParams = ( pxDocModel->ulParamsReceivedBitmap & pxDocModel->ulParamsRequiredBitmap )
-                                                       ^ pxDocModel->ulParamsRequiredBitmap;
-
-                            if( ulMissingParams != 0U )
-                            {
-                                /* The job document did not have all required document model parameters. */
-                                for( ulScanIndex = 0UL; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
-                                {
-                                    if( ( ulMissingParams & ( 1UL << ulScanIndex ) ) != 0UL )
-                                    {
-                                        OTA_LOG_L1( "[%s] parameter not present: %s\r\n",
-                                                    OTA_METHOD_NAME,
-                                                    pxModelParam[ ulScanIndex ].pcSrcKey );
-                                    }
-                                }
-
-                                eErr = eDocParseErr_MalformedDoc;
-                            }
-                        }
-                        else
-                        {
-                            OTA_LOG_L1( "[%s] Error (%d) parsing JSON document.\r\n", OTA_METHOD_NAME, ( int32_t ) eErr );
-                        }
-                    }
-                    else
-                    {
-                        OTA_LOG_L1( "[%s] jsmn_parse didn't match token count when parsing.\r\n", OTA_METHOD_NAME );
-                        eErr = eDocParseErr_JasmineCountMismatch;
-                    }
-                }
-                else
-                {
-                    OTA_LOG_L1( "[%s] No memory for JSON tokens.\r\n", OTA_METHOD_NAME );
-                    eErr = eDocParseErr_OutOfMemory;
-                }
-            }
-            else
-            {
-                OTA_LOG_L1( "[%s] Document has too many keys.\r\n", OTA_METHOD_NAME );
-                eErr = eDocParseErr_TooManyTokens;
-            }
+            eErr = prvParseTokensByModel( &xDispatchedJobDoc, pxDocModel );
         }
-        else
+    }
+    else
+    {
+        eErr = prvTokenizeJSON( &xDoc, pcJSON, ulMsgLen );
+
+        if( eErr == eDocParseErr_None )
         {
-            OTA_LOG_L1( "[%s] Invalid JSON document. No tokens parsed. \r\n", OTA_METHOD_NAME );
-            eErr = eDocParseErr_NoTokens;
+            eErr = prvParseTokensByModel( &xDoc, pxDocModel );
         }
+
+        prvFreeJSONTokens( &xDoc );
     }
 
     configASSERT( eErr != eDocParseErr_Unknown );
@@ -2359,16 +3329,18 @@ static DocParseErr_t prvParseJSONbyModel( const char * pcJSON,
 }
 
 
-/* Prepare the document model for use by sanity checking the initialization parameters
- * and detecting all required parameters. */
 
-static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
-                                      const JSON_DocParam_t * pxBodyDef,
-                                      uint32_t ulContextBaseAddr,
-                                      uint32_t ulContextSize,
-                                      uint16_t usNumJobParams )
+/* Prepare the document model for use by sanity checking the initialization parameters
+ * and detecting all required parameters. The key hashes are only computed the first time. */
+
+DocParseErr_t JSON_InitDocModel( JSON_DocModel_t * pxDocModel,
+                                 const JSON_DocParam_t * pxBodyDef,
+                                 uintptr_t ulContextBaseAddr,
+                                 uint32_t ulContextSize,
+                                 uint16_t usNumJobParams,
+                                 uint32_t * pulKeyHashes )
 {
-    DEFINE_OTA_METHOD_NAME( "prvInitDocModel" );
+    DEFINE_OTA_METHOD_NAME( "JSON_InitDocModel" );
 
     DocParseErr_t eErr = eDocParseErr_Unknown;
     uint32_t ulScanIndex;
@@ -2399,6 +3371,17 @@ static DocParseErr_t prvInitDocModel( JSON_DocModel_t * pxDocModel,
         pxDocModel->usNumModelParams = usNumJobParams;
         pxDocModel->ulParamsReceivedBitmap = 0;
         pxDocModel->ulParamsRequiredBitmap = 0;
+        pxDocModel->pulKeyHashes = pulKeyHashes;
+
+        /* A hash is never zero so a zero first entry means the table has not been filled yet. */
+        if( ( pulKeyHashes != NULL ) && ( usNumJobParams > 0U ) && ( pulKeyHashes[ 0 ] == 0U ) )
+        {
+            for( ulScanIndex = 0; ulScanIndex < usNumJobParams; ulScanIndex++ )
+            {
+                pulKeyHashes[ ulScanIndex ] = prvHashJSONKey( pxBodyDef[ ulScanIndex ].pcSrcKey,
+                                                              ( uint32_t ) strlen( pxBodyDef[ ulScanIndex ].pcSrcKey ) );
+            }
+        }
 
         /* Scan the model and detect all required parameters (i.e. not optional). */
         for( ulScanIndex = 0; ulScanIndex < pxDocModel->usNumModelParams; ulScanIndex++ )
@@ -2431,7 +3414,7 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
     /* Namely union initialization and pointers converted to values. */
     static const JSON_DocParam_t xOTA_JobDocModelParamStructure[ OTA_NUM_JOB_PARAMS ] =
     {
-        { pcOTA_JSON_ClientTokenKey,   OTA_JOB_PARAM_OPTIONAL, { ( uint32_t ) &xOTA_Agent.pcClientTokenFromJob }, eModelParamType_StringInDoc, JSMN_STRING    }, /*lint !e9078 !e923 Get address of token as value. */
+        { pcOTA_JSON_ClientTokenKey,   OTA_JOB_PARAM_OPTIONAL, { ( uintptr_t ) &xOTA_Agent.pcClientTokenFromJob }, eModelParamType_StringInDoc, JSMN_STRING    }, /*lint !e9078 !e923 Get address of token as value. */
         { pcOTA_JSON_ExecutionKey,     OTA_JOB_PARAM_REQUIRED, { OTA_DONT_STORE_PARAM                          }, eModelParamType_Object,      JSMN_OBJECT    },
         { pcOTA_JSON_JobIDKey,         OTA_JOB_PARAM_REQUIRED, { OFFSET_OF( OTA_FileContext_t, pucJobName )    }, eModelParamType_StringCopy,  JSMN_STRING    },
         { pcOTA_JSON_StatusDetailsKey, OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM                          }, eModelParamType_Object,      JSMN_OBJECT    },
@@ -2449,6 +3432,9 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
         { pcOTA_JSON_FileAttributeKey, OTA_JOB_PARAM_OPTIONAL, { OFFSET_OF( OTA_FileContext_t, ulFileAttributes )}, eModelParamType_UInt32,      JSMN_PRIMITIVE },
     };
 
+    /* Key hashes of the job document model, filled in by the first JSON_InitDocModel. */
+    static uint32_t ulOTA_JobDocKeyHashes[ OTA_NUM_JOB_PARAMS ];
+
     OTA_JobParseErr_t eErr = eOTA_JobParseErr_Unknown;
     OTA_FileContext_t * C, * pxFinalFile;
 
@@ -2464,15 +3450,22 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
     {
         JSON_DocModel_t xOTA_JobDocModel;
 
-        if( prvInitDocModel( &xOTA_JobDocModel,
-                             xOTA_JobDocModelParamStructure,
-                             ( uint32_t ) C, /*lint !e9078 !e923 Intentionally casting context pointer to a value for prvInitDocModel. */
-                             sizeof( OTA_FileContext_t ),
-                             OTA_NUM_JOB_PARAMS ) != eDocParseErr_None )
+        /* Tokenize the document once. The OTA model and any custom job handler share the tokens. */
+        if( pcJSON != NULL )
+        {
+            ( void ) prvTokenizeJSON( &xDispatchedJobDoc, pcJSON, ulMsgLen );
+        }
+
+        if( JSON_InitDocModel( &xOTA_JobDocModel,
+                               xOTA_JobDocModelParamStructure,
+                               ( uintptr_t ) C, /*lint !e9078 !e923 Intentionally casting context pointer to a value for JSON_InitDocModel. */
+                               sizeof( OTA_FileContext_t ),
+                               OTA_NUM_JOB_PARAMS,
+                               ulOTA_JobDocKeyHashes ) != eDocParseErr_None )
         {
             eErr = eOTA_JobParseErr_BadModelInitParams;
         }
-        else if( prvParseJSONbyModel( pcJSON, ulMsgLen, &xOTA_JobDocModel ) == eDocParseErr_None )
+        else if( JSON_ParseByModel( pcJSON, ulMsgLen, &xOTA_JobDocModel ) == eDocParseErr_None )
         { /* Validate the job document parameters. */
             eErr = eOTA_JobParseErr_None;
 
@@ -2545,7 +3538,7 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
                             *
                             * Set image state accordingly and update job status with self test identifier.
                             */
-                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, ( uint32_t ) NULL );
+                            ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, 0U );
                         }
                         else
                         {
@@ -2584,7 +3577,7 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
                         * Set image state accordingly and update job status with self test identifier.
                         */
                         OTA_LOG_L1( "[%s] Setting image state to Testing for file ID %d\r\n", OTA_METHOD_NAME, xOTA_Agent.ulServerFileID );
-                        ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, ( uint32_t ) NULL );                        
+                        ( void ) prvSetImageStateWithReason( eOTA_ImageState_Testing, 0U );                        
                     }
                 }
                 else
@@ -2621,6 +3614,9 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
                 }
             }
         }
+
+        /* Every handler has seen the document so its tokens are no longer needed. */
+        prvFreeJSONTokens( &xDispatchedJobDoc );
     }
 
     configASSERT( eErr != eOTA_JobParseErr_Unknown );
@@ -2665,6 +3661,39 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
 }
 
 
+/* prvResetRxBlockBitmap
+ *
+ * Mark every block of the file as missing, for a download that starts from scratch.
+ */
+
+static void prvResetRxBlockBitmap( OTA_FileContext_t * C,
+                                   uint32_t ulNumBlocks,
+                                   uint32_t ulBitmapLen )
+{
+    uint32_t ulIndex;
+
+    /* Set all bits in the bitmap to the erased state (we use 1 for erased just like flash memory). */
+    memset( C->pucRxBlockBitmap, ( int ) OTA_ERASED_BLOCKS_VAL, ulBitmapLen );
+
+    /* Mark as used any pages in the bitmap that are out of range, based on the file size.
+     * This keeps us from requesting those pages during retry processing or if using a windowed
+     * block request. It also avoids erroneously accepting an out of range data block should it
+     * get past any safety checks.
+     * Files aren't always a multiple of 8 pages (8 bits/pages per byte) so some bits of the
+     * last byte may be out of range and those are the bits we want to clear. */
+
+    uint8_t ulBit = 1U << ( BITS_PER_BYTE - 1U );
+    uint32_t ulNumOutOfRange = ( ulBitmapLen * BITS_PER_BYTE ) - ulNumBlocks;
+
+    for( ulIndex = 0U; ulIndex < ulNumOutOfRange; ulIndex++ )
+    {
+        C->pucRxBlockBitmap[ ulBitmapLen - 1U ] &= ~ulBit;
+        ulBit >>= 1U;
+    }
+
+    C->ulBlocksRemaining = ulNumBlocks; /* Initialize our blocks remaining counter. */
+}
+
 /* prvProcessOTAJobMsg
  *
  * We received an OTA update job message from the job notification service.
@@ -2674,7 +3703,8 @@ static OTA_FileContext_t * prvParseJobDoc( const char * pcJSON,
 static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
                                                 uint32_t ulMsgLen )
 {
-    uint32_t ulIndex;
+    DEFINE_OTA_METHOD_NAME( "prvProcessOTAJobMsg" );
+
     uint32_t ulNumBlocks;              /* How many data pages are in the expected update image. */
     uint32_t ulBitmapLen;              /* Length of the file block bitmap in bytes. */
     OTA_FileContext_t * pstUpdateFile; /* Pointer to an OTA update context. */
@@ -2703,37 +3733,46 @@ static OTA_FileContext_t * prvProcessOTAJobMsg( const char * pcRawMsg,
         {
             if( ( BaseType_t ) ( prvSubscribeToDataStream( pstUpdateFile ) ) == pdTRUE )
             {
-                /* Set all bits in the bitmap to the erased state (we use 1 for erased just like flash memory). */
-                memset( pstUpdateFile->pucRxBlockBitmap, ( int ) OTA_ERASED_BLOCKS_VAL, ulBitmapLen );
-
-                /* Mark as used any pages in the bitmap that are out of range, based on the file size.
-                 * This keeps us from requesting those pages during retry processing or if using a windowed
-                 * block request. It also avoids erroneously accepting an out of range data block should it
-                 * get past any safety checks.
-                 * Files aren't always a multiple of 8 pages (8 bits/pages per byte) so some bits of the
-                 * last byte may be out of range and those are the bits we want to clear. */
-
-                uint8_t ulBit = 1U << ( BITS_PER_BYTE - 1U );
-                uint32_t ulNumOutOfRange = ( ulBitmapLen * BITS_PER_BYTE ) - ulNumBlocks;
-
-                for( ulIndex = 0U; ulIndex < ulNumOutOfRange; ulIndex++ )
-                {
-                    pstUpdateFile->pucRxBlockBitmap[ ulBitmapLen - 1U ] &= ~ulBit;
-                    ulBit >>= 1U;
-                }
-
-                pstUpdateFile->ulBlocksRemaining = ulNumBlocks; /* Initialize our blocks remaining counter. */
+                prvResetRxBlockBitmap( pstUpdateFile, ulNumBlocks, ulBitmapLen );
+                #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+                    prvLoadCheckpoint( pstUpdateFile );
+                #endif
+                #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+                    prvWindowReset( &xOTA_Agent.xStreamWindow );
+                #endif
                 prvStartRequestTimer( pstUpdateFile );
 
                 /* Create/Open the OTA file on the file system. */
                 xErr = xOTA_Agent.xPALCallbacks.xCreateFileForRx( pstUpdateFile );
 
+                #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+                    /* A resumed download reopens the file of the checkpoint. If that file
+                     * is gone, drop the checkpoint, or every delivery of the job fails the
+                     * same way, and download the file from the start. */
+                    if( ( xErr != kOTA_Err_None ) && ( pstUpdateFile->xIsResuming == ( bool_t ) pdTRUE ) )
+                    {
+                        OTA_LOG_L1( "[%s] Can't reopen the file of the checkpoint (0x%08x). Restarting the download.\r\n", OTA_METHOD_NAME, xErr );
+                        prvDeleteCheckpoint( pstUpdateFile );
+                        pstUpdateFile->xIsResuming = pdFALSE;
+                        prvResetRxBlockBitmap( pstUpdateFile, ulNumBlocks, ulBitmapLen );
+                        xErr = xOTA_Agent.xPALCallbacks.xCreateFileForRx( pstUpdateFile );
+                    }
+                #endif
+
                 if( xErr != kOTA_Err_None )
                 {
                     ( void ) prvSetImageStateWithReason( eOTA_ImageState_Aborted, xErr );
                     ( void ) prvOTA_Close( pstUpdateFile ); /* Ignore false result since we're setting the pointer to null on the next line. */
                     pstUpdateFile = NULL;
                 }
+
+                #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+                    if( pstUpdateFile != NULL )
+                    {
+                        prvSigVerifyStart( pstUpdateFile );
+                    }
+                #endif
             }
             else
             {
@@ -2775,9 +3814,17 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
     int32_t lFileId = 0;
     uint32_t ulBlockSize = 0;
     uint32_t ulBlockIndex = 0;
-    uint8_t * pucPayload = NULL;
+    const uint8_t * pucPayload = NULL;
     size_t xPayloadSize = 0;
 
+    #if ( otaconfigWRITE_BLOCK_IN_PLACE == 0 )
+        uint8_t * pucStagingBuffer = ( uint8_t * ) ulBlockStagingBuffer;
+        size_t xStagingBufferSize = sizeof( ulBlockStagingBuffer );
+    #else
+        uint8_t * pucStagingBuffer = NULL;
+        size_t xStagingBufferSize = 0;
+    #endif
+
     if( C != NULL )
     {
         if( pxCloseResult != NULL )
@@ -2791,14 +3838,17 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                 prvStartRequestTimer( C );
 
                 /* Decode the CBOR content. */
-                if( pdFALSE == OTA_CBOR_Decode_GetStreamResponseMessage(
+                if( ( pdFALSE == OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
                         ( const uint8_t * ) pcRawMsg,
                         ulMsgSize,
                         &lFileId,
                         ( int32_t * ) &ulBlockIndex, /*lint !e9087 CBOR requires pointer to int and our block index's never exceed 31 bits. */
                         ( int32_t * ) &ulBlockSize,  /*lint !e9087 CBOR requires pointer to int and our block sizes never exceed 31 bits. */
-                        &pucPayload,                 /* This payload gets malloc'd by OTA_CBOR_Decode_GetStreamResponseMessage(). We must free it. */
-                        ( size_t * ) &xPayloadSize ) )
+                        pucStagingBuffer,
+                        xStagingBufferSize,
+                        &pucPayload, /* Either the staging buffer or a pointer into the message. Nothing to free. */
+                        ( size_t * ) &xPayloadSize ) ) ||
+                    ( xPayloadSize != ( size_t ) ulBlockSize ) ) /* Never write more than the payload holds. */
                 {
                     eIngestResult = eIngest_Result_BadData;
                 }
@@ -2827,12 +3877,15 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                                         C->ulBlocksRemaining );
                             eIngestResult = eIngest_Result_Duplicate_Continue;
                             *pxCloseResult = kOTA_Err_None; /* This is a success path. */
+                            #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+                                prvWindowBlockReceived( &xOTA_Agent.xStreamWindow, ulBlockIndex, pdTRUE );
+                            #endif
                         }
                         else /* Otherwise, process it normally... */
                         {
                             if( C->pucFile != NULL )
                             {
-                                int32_t iBytesWritten = xOTA_Agent.xPALCallbacks.xWriteBlock( C, ( ulBlockIndex * OTA_FILE_BLOCK_SIZE ), pucPayload, ( uint32_t ) ulBlockSize );
+                                int32_t iBytesWritten = xOTA_Agent.xPALCallbacks.xWriteBlock( C, ( ulBlockIndex * OTA_FILE_BLOCK_SIZE ), ( uint8_t * ) pucPayload, ( uint32_t ) ulBlockSize ); /*lint !e9005 The PAL does not modify the block. */
 
                                 if( iBytesWritten < 0 )
                                 {
@@ -2845,6 +3898,19 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                                     C->ulBlocksRemaining--;
                                     eIngestResult = eIngest_Result_Accepted_Continue;
                                     *pxCloseResult = kOTA_Err_None; /* This is a success path. */
+                                    #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+                                        prvWindowBlockReceived( &xOTA_Agent.xStreamWindow, ulBlockIndex, pdFALSE );
+                                    #endif
+                                    #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+                                        prvSigVerifyBlock( C, ulBlockIndex, pucPayload, ulBlockSize );
+                                    #endif
+                                    #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+                                        if( ( C->ulBlocksRemaining > 0U ) &&
+                                            ( ( ( iLastBlock + 1U - C->ulBlocksRemaining ) % otaconfigCHECKPOINT_BLOCKS ) == 0U ) )
+                                        {
+                                            prvSaveCheckpoint( C );
+                                        }
+                                    #endif
                                 }
                             }
                             else
@@ -2863,6 +3929,12 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
                                 if( C->pucFile != NULL )
                                 {
                                     *pxCloseResult = xOTA_Agent.xPALCallbacks.xCloseFile( C );
+                                    #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+                                        prvSigVerifyStop( C ); /* In case the PAL verified the file without the hash. */
+                                    #endif
+                                    #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+                                        prvDeleteCheckpoint( C ); /* The download is over whatever the result. */
+                                    #endif
 
                                     if( *pxCloseResult == kOTA_Err_None )
                                     {
@@ -2923,11 +3995,6 @@ static IngestResult_t prvIngestDataBlock( OTA_FileContext_t * C,
         eIngestResult = eIngest_Result_NullContext;
     }
 
-    if( NULL != pucPayload )
-    {
-        vPortFree( pucPayload );
-    }
-
     return eIngestResult;
 }
 
@@ -39,6 +39,70 @@
 #define BITS_PER_BYTE          ( 1UL << LOG2_BITS_PER_BYTE )            /* Number of bits in a byte. This is used by the block bitmap implementation. */
 #define OTA_FILE_BLOCK_SIZE    ( 1UL << otaconfigLOG2_FILE_BLOCK_SIZE ) /* Data section size of the file data block message (excludes the header). */
 
+/* The maximum number of block ranges requested from the stream service at a time. If this is 0,
+ * the agent requests every missing block with one bitmap each time the request timer expires.
+ * Otherwise the agent keeps up to this many ranges in flight, requests the next range as soon
+ * as one completes, and adapts the number of ranges in flight to the blocks it receives. */
+#ifndef otaconfigSTREAM_WINDOW_MAX_REQUESTS
+    #define otaconfigSTREAM_WINDOW_MAX_REQUESTS    0U
+#endif
+
+/* The number of blocks covered by each range requested in windowed mode. Ranges start on a
+ * byte of the Rx block bitmap, so this must be a multiple of 8. */
+#ifndef otaconfigSTREAM_WINDOW_BLOCKS
+    #define otaconfigSTREAM_WINDOW_BLOCKS    16U
+#endif
+
+/* Set this to 1 to pass the PAL a pointer into the received MQTT message for each block. By
+ * default, each block is copied into a word aligned staging buffer owned by the agent, since some
+ * flash drivers need aligned source data. Neither way allocates memory for the block. */
+#ifndef otaconfigWRITE_BLOCK_IN_PLACE
+    #define otaconfigWRITE_BLOCK_IN_PLACE    0
+#endif
+
+/* Set this to 1 to hash each block as it is received instead of having the PAL read the whole file
+ * back from storage when it is closed. The agent hashes blocks in order and holds up to
+ * otaconfigSIGNATURE_PENDING_BLOCKS blocks that arrive ahead of the next block to hash. If more
+ * blocks arrive out of order than that, the agent drops the hash and the PAL verifies the file the
+ * usual way. A PAL takes the hash through the pvSigVerifyContext member of the file context. */
+#ifndef otaconfigINCREMENTAL_SIGNATURE_VERIFY
+    #define otaconfigINCREMENTAL_SIGNATURE_VERIFY    0
+#endif
+
+/* The number of out of order blocks held until the in order blocks before them are hashed. Each
+ * one takes a block of RAM. */
+#ifndef otaconfigSIGNATURE_PENDING_BLOCKS
+    #define otaconfigSIGNATURE_PENDING_BLOCKS    4U
+#endif
+
+/* The algorithms of the incremental hash. They must match the file signature key of the PAL
+ * (cOTA_JSON_FileSignatureKey), which is "sig-sha256-ecdsa" on most platforms. */
+#ifndef otaconfigSIGNATURE_ASYMMETRIC_ALGORITHM
+    #define otaconfigSIGNATURE_ASYMMETRIC_ALGORITHM    cryptoASYMMETRIC_ALGORITHM_ECDSA
+#endif
+
+#ifndef otaconfigSIGNATURE_HASH_ALGORITHM
+    #define otaconfigSIGNATURE_HASH_ALGORITHM    cryptoHASH_ALGORITHM_SHA256
+#endif
+
+/* Save a checkpoint of the download every this many received blocks, so that a download
+ * interrupted by a reset resumes from the last checkpoint instead of from the first block. The
+ * checkpoint holds the Rx block bitmap and, with otaconfigINCREMENTAL_SIGNATURE_VERIFY, the hash
+ * of the blocks received so far. 0 disables checkpoints. Otherwise the PAL must implement
+ * prvPAL_SaveCheckpoint() and prvPAL_LoadCheckpoint(). */
+#ifndef otaconfigCHECKPOINT_BLOCKS
+    #define otaconfigCHECKPOINT_BLOCKS    0U
+#endif
+
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+    #if ( ( otaconfigSTREAM_WINDOW_BLOCKS % BITS_PER_BYTE ) != 0 ) || ( otaconfigSTREAM_WINDOW_BLOCKS == 0 )
+        #error "otaconfigSTREAM_WINDOW_BLOCKS must be a non-zero multiple of 8."
+    #endif
+    #if ( otaconfigSTREAM_WINDOW_BLOCKS > otaconfigMAX_NUM_BLOCKS_REQUEST )
+        #error "otaconfigSTREAM_WINDOW_BLOCKS must not exceed otaconfigMAX_NUM_BLOCKS_REQUEST."
+    #endif
+#endif
+
 typedef enum
 {
     eIngest_Result_FileComplete = -1,       /* The file transfer is complete and the signature check passed. */
@@ -90,9 +154,15 @@ typedef enum
     eModelParamType_Array,
     eModelParamType_UInt32,
     eModelParamType_SigBase64,
-    eModelParamType_Ident
+    eModelParamType_Ident,
+    eModelParamType_StringMatch /* The parameter is only received if the value equals pcMatchValue. Nothing is stored. */
 } ModelParamType_t;
 
+#define OTA_DOC_MODEL_MAX_PARAMS    32U                    /* The parameter list is backed by a 32 bit longword bitmap by design. */
+#define OTA_JOB_PARAM_REQUIRED      ( ( bool_t ) pdTRUE )  /* Used to denote a required document model parameter. */
+#define OTA_JOB_PARAM_OPTIONAL      ( ( bool_t ) pdFALSE ) /* Used to denote an optional document model parameter. */
+#define OTA_DONT_STORE_PARAM        0xffffffffUL           /* If ulDestOffset in the model is 0xffffffff, do not store the value. */
+
 /* This is a document parameter structure used by the document model. It determines
  * the type of parameter specified by the key name and where to store the parameter
  * locally when it is extracted from the JSON document. It also contains the
@@ -113,8 +183,9 @@ typedef struct
     const bool_t bRequired; /* If true, this parameter must exist in the document. */
     union
     {
-        const uint32_t ulDestOffset;        /* Pointer or offset to where we'll store the value, if not ~0. */
+        const uintptr_t ulDestOffset;       /* Pointer or offset to where we'll store the value, if not ~0. */
         void * const pvDestOffset;          /* Pointer or offset to where we'll store the value, if not ~0. */
+        const char * const pcMatchValue;    /* The expected value of an eModelParamType_StringMatch parameter. */
     };
     const ModelParamType_t xModelParamType; /* We extract the value, if found, based on this type. */
     const jsmntype_t eJasmineType;          /* The JSON value type must match that specified here. */
@@ -129,15 +200,116 @@ typedef struct
  * document and where to store the parameters, if desired, in a destination context.
  * We currently only store parameters into an OTA_FileContext_t but it could be used
  * for any structure since we don't use a type pointer.
+ *
+ * Keys are looked up by their hash. The hashes live in a table supplied by the owner
+ * of the model definition, normally a static array with one entry per parameter, and
+ * are computed the first time the model is initialized.
  */
 typedef struct
 {
-    uint32_t ulContextBase;            /* The base address of the destination OTA context structure. */
+    uintptr_t ulContextBase;           /* The base address of the destination OTA context structure. */
     uint32_t ulContextSize;            /* The size, in bytes, of the destination context structure. */
     const JSON_DocParam_t * pxBodyDef; /* Pointer to the document model body definition. */
     uint16_t usNumModelParams;         /* The number of entries in the document model (limited to 32). */
     uint32_t ulParamsReceivedBitmap;   /* Bitmap of the parameters received based on the model. */
     uint32_t ulParamsRequiredBitmap;   /* Bitmap of the parameters required from the model. */
+    uint32_t * pulKeyHashes;           /* Key hash of each parameter, or NULL to compare the keys only. */
 } JSON_DocModel_t;
 
+/* Prepare a document model for use. If pulKeyHashes is not NULL and has not been
+ * filled yet, the key hashes of pxBodyDef are computed into it. */
+
+DocParseErr_t JSON_InitDocModel( JSON_DocModel_t * pxDocModel,
+                                 const JSON_DocParam_t * pxBodyDef,
+                                 uintptr_t ulContextBaseAddr,
+                                 uint32_t ulContextSize,
+                                 uint16_t usNumJobParams,
+                                 uint32_t * pulKeyHashes );
+
+/* Extract the parameters of a JSON document according to a document model. While the
+ * OTA agent dispatches a job document, the tokens it already parsed for that document
+ * are reused, so custom job handlers may call this without tokenizing it again. */
+
+DocParseErr_t JSON_ParseByModel( const char * pcJSON,
+                                 uint32_t ulMsgLen,
+                                 JSON_DocModel_t * pxDocModel );
+
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+
+/* A range of blocks requested from the stream service in windowed mode. */
+    typedef struct
+    {
+        uint32_t ulFirstBlock;  /* First block of the range. It is always on a byte of the Rx block bitmap. */
+        uint32_t ulEndBlock;    /* One past the last block of the range. */
+        uint32_t ulOutstanding; /* Requested blocks of the range that have not arrived yet. Zero if the slot is free. */
+        uint32_t ulSequence;    /* The order in which the range was requested. */
+    } OTA_BlockRange_t;
+
+/* The ranges in flight and the adaptive window of a windowed stream download.
+ *
+ * The window grows by one range each time a range completes without duplicates, which doubles
+ * it every round trip while blocks keep arriving. It is halved when duplicates arrive or when a
+ * range completes before an older one, since the stream service answers requests in order and
+ * the older range must have lost blocks. It drops back to one range when the request timer
+ * expires.
+ *
+ * The arrival rate of new blocks is sampled once per window of blocks. When a sample taken with
+ * a larger window than the one before is not at least an eighth faster, more ranges in flight
+ * only queue up at the service. The window then goes back to the size of the earlier sample and
+ * stops growing until a loss or a timeout shrinks it. */
+    typedef struct
+    {
+        OTA_BlockRange_t xRanges[ otaconfigSTREAM_WINDOW_MAX_REQUESTS ]; /* The ranges in flight. */
+        uint32_t ulWindowSize;                                           /* The number of ranges currently allowed in flight. */
+        uint32_t ulWindowLimit;                                          /* The largest window allowed since the arrival rate stopped rising. */
+        uint32_t ulNextBlock;                                            /* The block from which to search for the next range. */
+        uint32_t ulSequence;                                             /* The sequence number of the next range requested. */
+        uint32_t ulDuplicates;                                           /* Duplicate blocks received since the window last changed. */
+        TickType_t xSampleStart;                                         /* The tick at which the current rate sample started. */
+        uint32_t ulSampleBlocks;                                         /* New blocks received in the current rate sample. */
+        uint32_t ulSampleWindow;                                         /* The window size when the current rate sample started. */
+        uint32_t ulLastWindow;                                           /* The window size of the previous rate sample, zero if there is none. */
+        uint32_t ulLastRate;                                             /* New blocks per second in the previous rate sample. */
+    } OTA_StreamWindow_t;
+#endif /* if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 ) */
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+
+/* A block received ahead of the next block to hash. */
+    typedef struct
+    {
+        uint32_t ulBlockSize;                        /* Size of the block data. Zero if the slot is free. */
+        uint32_t ulBlockIndex;                       /* Index of the block in the file. */
+        uint32_t ulData[ OTA_FILE_BLOCK_SIZE / 4U ]; /* Word aligned block data. */
+    } OTA_PendingBlock_t;
+
+/* The state of the incremental hash of the active file. Blocks are hashed in file order. The
+ * hash context itself is the pvSigVerifyContext member of the file context, so that the PAL can
+ * finish the signature check with it. */
+    typedef struct
+    {
+        uint32_t ulNextBlock;                                              /* The next block to hash. */
+        OTA_PendingBlock_t xPending[ otaconfigSIGNATURE_PENDING_BLOCKS ]; /* Blocks received ahead of ulNextBlock. */
+    } OTA_SigVerify_t;
+#endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+/* Identifies a download checkpoint of this layout. */
+    #define OTA_CHECKPOINT_MAGIC    0x4f544331UL /* "OTC1" */
+
+/* The header of a download checkpoint. It is followed by the Rx block bitmap of the file and
+ * then by the saved hash state, if the agent hashes blocks as they are received. */
+    typedef struct
+    {
+        uint32_t ulMagic;           /* OTA_CHECKPOINT_MAGIC. */
+        uint32_t ulServerFileID;    /* The file ID of the job the checkpoint belongs to. */
+        uint32_t ulStreamNameHash;  /* Hash of the stream name of the job the checkpoint belongs to. */
+        uint32_t ulFileSize;        /* The size of the file in bytes. */
+        uint32_t ulBlocksRemaining; /* The number of blocks missing from the bitmap. */
+        uint32_t ulHashedBlocks;    /* The number of blocks covered by the saved hash state. */
+        uint32_t ulHashStateSize;   /* The size of the saved hash state. Zero if there is none. */
+    } OTA_CheckpointHeader_t;
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
+
 #endif /* ifndef _AWS_OTA_AGENT_INTERNAL_H_ */
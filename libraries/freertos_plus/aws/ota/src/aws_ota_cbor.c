@@ -49,25 +49,25 @@ typedef struct OTAMessageDecodeContext
 } OTAMessageDecodeContext_t, * OTAMessageDecodeContextPtr_t;
 
 /**
- * @brief Decode a Get Stream response message from AWS IoT OTA.
+ * @brief Find the fields of a Get Stream response message from AWS IoT OTA.
+ * On success, pxPayload refers to the block payload byte string.
  */
-BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
-                                                     size_t xMessageSize,
-                                                     int32_t * plFileId,
-                                                     int32_t * plBlockId,
-                                                     int32_t * plBlockSize,
-                                                     uint8_t ** ppucPayload,
-                                                     size_t * pxPayloadSize )
+static CborError prvDecodeGetStreamResponseFields( const uint8_t * pucMessageBuffer,
+                                                   size_t xMessageSize,
+                                                   int32_t * plFileId,
+                                                   int32_t * plBlockId,
+                                                   int32_t * plBlockSize,
+                                                   CborParser * pxCborParser,
+                                                   CborValue * pxPayload )
 {
     CborError xCborResult = CborNoError;
-    CborParser xCborParser;
     CborValue xCborValue, xCborMap;
 
     /* Initialize the parser. */
     xCborResult = cbor_parser_init( pucMessageBuffer,
                                     xMessageSize,
                                     0,
-                                    &xCborParser,
+                                    pxCborParser,
                                     &xCborMap );
 
     /* Get the outer element and confirm that it's a "map," i.e., a set of
@@ -151,17 +151,43 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
     {
         xCborResult = cbor_value_map_find_value( &xCborMap,
                                                  OTA_CBOR_BLOCKPAYLOAD_KEY,
-                                                 &xCborValue );
+                                                 pxPayload );
     }
 
     if( CborNoError == xCborResult )
     {
-        if( CborByteStringType != cbor_value_get_type( &xCborValue ) )
+        if( CborByteStringType != cbor_value_get_type( pxPayload ) )
         {
             xCborResult = CborErrorIllegalType;
         }
     }
 
+    return xCborResult;
+}
+
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageBuffer,
+                                                     size_t xMessageSize,
+                                                     int32_t * plFileId,
+                                                     int32_t * plBlockId,
+                                                     int32_t * plBlockSize,
+                                                     uint8_t ** ppucPayload,
+                                                     size_t * pxPayloadSize )
+{
+    CborError xCborResult = CborNoError;
+    CborParser xCborParser;
+    CborValue xCborValue;
+
+    xCborResult = prvDecodeGetStreamResponseFields( pucMessageBuffer,
+                                                    xMessageSize,
+                                                    plFileId,
+                                                    plBlockId,
+                                                    plBlockSize,
+                                                    &xCborParser,
+                                                    &xCborValue );
+
     if( CborNoError == xCborResult )
     {
         xCborResult = cbor_value_calculate_string_length( &xCborValue,
@@ -189,6 +215,75 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
     return CborNoError == xCborResult;
 }
 
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA without
+ * allocating memory for the payload.
+ *
+ * If pucStagingBuffer is NULL, the payload is returned in place, as a pointer
+ * into the message buffer. This requires a definite length byte string, which
+ * is what the service sends. Otherwise the payload is copied into the caller's
+ * staging buffer, which must be large enough to hold it.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc( const uint8_t * pucMessageBuffer,
+                                                            size_t xMessageSize,
+                                                            int32_t * plFileId,
+                                                            int32_t * plBlockId,
+                                                            int32_t * plBlockSize,
+                                                            uint8_t * pucStagingBuffer,
+                                                            size_t xStagingBufferSize,
+                                                            const uint8_t ** ppucPayload,
+                                                            size_t * pxPayloadSize )
+{
+    CborError xCborResult = CborNoError;
+    CborParser xCborParser;
+    CborValue xCborValue, xCborNext;
+
+    xCborResult = prvDecodeGetStreamResponseFields( pucMessageBuffer,
+                                                    xMessageSize,
+                                                    plFileId,
+                                                    plBlockId,
+                                                    plBlockSize,
+                                                    &xCborParser,
+                                                    &xCborValue );
+
+    if( ( CborNoError == xCborResult ) && ( NULL == pucStagingBuffer ) )
+    {
+        xCborResult = cbor_value_get_string_length( &xCborValue,
+                                                    pxPayloadSize );
+
+        /* The payload bytes end where the next item starts. */
+        if( CborNoError == xCborResult )
+        {
+            xCborNext = xCborValue;
+            xCborResult = cbor_value_advance( &xCborNext );
+        }
+
+        if( CborNoError == xCborResult )
+        {
+            *ppucPayload = cbor_value_get_next_byte( &xCborNext ) - *pxPayloadSize;
+        }
+    }
+    else if( CborNoError == xCborResult )
+    {
+        *pxPayloadSize = xStagingBufferSize;
+        xCborResult = cbor_value_copy_byte_string( &xCborValue,
+                                                   pucStagingBuffer,
+                                                   pxPayloadSize,
+                                                   NULL );
+
+        if( CborNoError == xCborResult )
+        {
+            *ppucPayload = pucStagingBuffer;
+        }
+    }
+    else
+    {
+        /* The message could not be decoded. */
+    }
+
+    return CborNoError == xCborResult;
+}
+
 
 
 /**
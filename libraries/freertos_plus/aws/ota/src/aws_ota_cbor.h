@@ -37,6 +37,23 @@ BaseType_t OTA_CBOR_Decode_GetStreamResponseMessage( const uint8_t * pucMessageB
                                                      uint8_t ** ppucPayload,
                                                      size_t * pxPayloadSize );
 
+/**
+ * @brief Decode a Get Stream response message from AWS IoT OTA without
+ * allocating memory for the payload.
+ *
+ * The payload is returned in place if pucStagingBuffer is NULL, or copied
+ * into pucStagingBuffer otherwise.
+ */
+BaseType_t OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc( const uint8_t * pucMessageBuffer,
+                                                            size_t xMessageSize,
+                                                            int32_t * plFileId,
+                                                            int32_t * plBlockId,
+                                                            int32_t * plBlockSize,
+                                                            uint8_t * pucStagingBuffer,
+                                                            size_t xStagingBufferSize,
+                                                            const uint8_t ** ppucPayload,
+                                                            size_t * pxPayloadSize );
+
 /**
  * @brief Create an encoded Get Stream Request message for the AWS IoT OTA
  * service.
@@ -89,6 +89,11 @@ OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C );
  *
  * If the signature verification fails, file close should still be attempted.
  *
+ * If C->pvSigVerifyContext is not NULL, the agent has already hashed the whole file with it
+ * (see otaconfigINCREMENTAL_SIGNATURE_VERIFY). The PAL may then pass it to
+ * CRYPTO_SignatureVerificationFinal() instead of reading the file back, and must set it to NULL
+ * if it does. Otherwise the agent frees it after this function returns.
+ *
  * @param[in] C OTA file context information.
  *
  * @return The OTA PAL layer error code combined with the MCU specific error code. See OTA Agent
@@ -196,4 +201,41 @@ OTA_Err_t prvPAL_SetPlatformImageState( OTA_ImageState_t eState );
  */
 OTA_PAL_ImageState_t prvPAL_GetPlatformImageState( void );
 
+/**
+ * @brief Save the download checkpoint of the file in the specified OTA context.
+ *
+ * Only needed if otaconfigCHECKPOINT_BLOCKS is not 0. The agent calls this every
+ * otaconfigCHECKPOINT_BLOCKS received blocks, so that a download interrupted by a reset
+ * resumes from the last checkpoint instead of from the first block.
+ * The checkpoint replaces any previous one. It must survive a reset, and the blocks written
+ * before it must survive too, including when prvPAL_Abort() is called.
+ *
+ * @param[in] C OTA file context information.
+ * @param[in] pucCheckpoint The checkpoint data, or NULL to delete the checkpoint.
+ * @param[in] ulSize Size of the checkpoint data, or zero to delete the checkpoint.
+ *
+ * @return kOTA_Err_None if the checkpoint was saved or deleted, or another OTA error code.
+ */
+OTA_Err_t prvPAL_SaveCheckpoint( OTA_FileContext_t * const C,
+                                 const uint8_t * pucCheckpoint,
+                                 uint32_t ulSize );
+
+/**
+ * @brief Load the last download checkpoint saved by prvPAL_SaveCheckpoint().
+ *
+ * The agent calls this when it receives a job, before prvPAL_CreateFileForRx(). If the
+ * checkpoint matches the job, the agent sets C->xIsResuming and prvPAL_CreateFileForRx()
+ * must then open the file without erasing it.
+ *
+ * @param[in] C OTA file context information.
+ * @param[out] pucCheckpoint Buffer for the checkpoint data.
+ * @param[in] ulSize Size of the buffer.
+ *
+ * @return kOTA_Err_None if a checkpoint of exactly ulSize bytes was read, or another OTA
+ * error code if there is none.
+ */
+OTA_Err_t prvPAL_LoadCheckpoint( OTA_FileContext_t * const C,
+                                 uint8_t * pucCheckpoint,
+                                 uint32_t ulSize );
+
 #endif /* ifndef _AWS_OTA_PAL_H_ */
@@ -30,18 +30,33 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-/* Set up logging for this demo. */
-#include "iot_demo_logging.h" 
+/* Configure logs for the CDF agent. */
+#ifdef IOT_LOG_LEVEL_CDF
+    #define LIBRARY_LOG_LEVEL        IOT_LOG_LEVEL_CDF
+#else
+    #ifdef IOT_LOG_LEVEL_GLOBAL
+        #define LIBRARY_LOG_LEVEL    IOT_LOG_LEVEL_GLOBAL
+    #else
+        #define LIBRARY_LOG_LEVEL    IOT_LOG_NONE
+    #endif
+#endif
+
+#define LIBRARY_LOG_NAME    ( "CDF" )
+#include "iot_logging_setup.h"
 
 /* Platform layer includes. */
 #include "platform/iot_clock.h"
 #include "platform/iot_threads.h"
 
+/* Task pool include. */
+#include "iot_taskpool.h"
+
 /* Internal header file for shared definitions. */
 #include "aws_clientcredential_keys.h"
 #include "aws_clientcredential.h"
 #include "aws_iot_ota_agent.h"
 #include "iot_cdf_agent.h"
+#include "aws_ota_agent_internal.h"
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"     /*lint !e537 intentional include of all interfaces used by this file. */
@@ -51,6 +66,7 @@
 #include "queue.h"
 #include "semphr.h"
 #include "jsmn.h"
+#include "mbedtls/x509_crt.h"
 
 #define _CR_SUB_TOPIC_COUNT      1
 #define _CR_PUB_TOPIC_COUNT      1
@@ -61,28 +77,51 @@
 #define _CR_TOPIC_LEN            ( sizeof(clientcredentialIOT_THING_NAME) +_CR_TOPIC_SUFFIX_LEN +\
                                    _CR_TOPIC_PREFIX_LEN )
 
-#define _CR_GET_RESPONSE_STR_BEG "\"newCertificatePem\": \""
-#define _CR_GET_RESPONSE_STR_END "-----END CERTIFICATE-----"
-#define _CR_GET_RESPONSE_BEG_OFFSET  ( 22 )
-#define _CR_GET_NEW_CERT_ID_STR_BEG "\"newCertificateId\": \""
-#define _CR_GET_OLD_CERT_ID_STR_BEG "\"oldCertificateId\": \""
+/* Responses to every rotation step arrive on the result topic. */
+#define _CR_RESULT_TOPIC         _CR_TOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME
+#define _CR_RESULT_TOPIC_LENGTH  ( ( uint16_t ) ( sizeof( _CR_RESULT_TOPIC ) - 1 ) )
+#define _CR_ATTACH_TOPIC         _CR_TOPIC_PREFIX "/attach/" clientcredentialIOT_THING_NAME
+#define _CR_ACTIVATE_TOPIC       _CR_TOPIC_PREFIX "/activate/" clientcredentialIOT_THING_NAME
+#define _CR_DETACH_TOPIC         _CR_TOPIC_PREFIX "/detach/" clientcredentialIOT_THING_NAME
+
+/* Keys of the rotation responses published by the lambdas. */
+#define _CR_KEY_NEW_CERT_PEM     "newCertificatePem"
+#define _CR_KEY_NEW_CERT_ID      "newCertificateId"
+#define _CR_KEY_OLD_CERT_ID      "oldCertificateId"
+#define _CR_KEY_ERROR            "error"
+#define _CR_KEY_ACTIVATED        "activated"
+
+/* A response is a flat object of at most five members, or a string. */
+#define _CR_RESPONSE_MAX_TOKENS  ( 12 )
 
 #define _CR_ACK_TIMEOUT          ((TickType_t) 5000)
 #define _SYNC_WAIT_MS            ( 1000 )
 
-#define _CR_ACK_RESPONSE_STR_ERROR     "\"error\": \"}"
-#define _CR_ACK_RESPONSE_LEN     ( 12 )
-
 #define _PUBLISH_PAYLOAD_BUFFER_LENGTH   (_CR_CSR_SIZE + 50)
 #define _MAX_MQTT_PUBLISH_ATTEMPTS       ( 2 ) 
 #define _MAX_MQTT_GET_CERT_ATTEMPTS      ( 2 ) 
-#define _MAX_WAIT_CDF_TASK_ATTEMPTS      ( 4 ) 
-#define _MAX_TOKEN_COUNT                 ( 40 )
-#define _CDF_JOB_JSON_MATCH_COUNT        ( 5 )
-#define _MAX_JSON_VAL_LEN                 ( 200 )
-#define _MAX_JSON_KEY_LEN                 ( 100 )
+#define _CR_MAX_REQUEST_ATTEMPTS         ( _MAX_MQTT_PUBLISH_ATTEMPTS * _MAX_MQTT_GET_CERT_ATTEMPTS )
+#define _CDF_JOB_NUM_PARAMS              ( 9 )
 
 #define _FINGERPRINT_LENGTH                ( 64 )
+
+/* Expiry driven rotation needs a UTC clock from the application. */
+#ifdef cdfconfigGET_UTC_SECONDS
+    #define _CR_HAVE_UTC_CLOCK             1
+#else
+    #define _CR_HAVE_UTC_CLOCK             0
+    #define cdfconfigGET_UTC_SECONDS()     ( 0UL )
+#endif
+
+/* Longest delay of the rotation job. The job re-checks the clock at least
+ * this often, so a time source that becomes valid late is noticed and the
+ * delay never overflows a time in milliseconds. */
+#define _CR_EXPIRY_CHECK_MAX_SECONDS       ( 3600UL )
+
+/* Most characters of a response payload written to the log. The payload is
+ * handled in the MQTT callback, so its log cost must not grow with the
+ * certificate size. */
+#define _CR_LOG_PAYLOAD_LENGTH             ( 64 )
 int debug_something = false;
 
 /**
@@ -101,14 +140,10 @@ int debug_something = false;
 #define _PUBLISH_RETRY_MS                         ( 1000 )
 
 /**
- * @brief Format string of PUBLISH acknowledgement messages in this demo.
- */
-#define _ACKNOWLEDGEMENT_MESSAGE_FORMAT           "Client has received PUBLISH %.*s from server."
-
-/**
- * @brief Size of the buffers that hold acknowledgement messages in this demo.
+ * @brief How long a rotation step waits for its response before the request
+ * is sent again.
  */
-#define _ACKNOWLEDGEMENT_MESSAGE_BUFFER_LENGTH    ( sizeof( _ACKNOWLEDGEMENT_MESSAGE_FORMAT ) + 2 )
+#define _CR_RESPONSE_TIMEOUT_MS                   ( _MQTT_TIMEOUT_MS * 2 )
 
 /**
  * @brief The topic name on which acknowledgement messages for incoming publishes
@@ -120,8 +155,7 @@ int debug_something = false;
  * @brief The length of #_ACKNOWLEDGEMENT_TOPIC_NAME.
  */
 #define _ACKNOWLEDGEMENT_TOPIC_NAME_LENGTH        ( ( uint16_t ) ( sizeof( _ACKNOWLEDGEMENT_TOPIC_NAME ) - 1 ) )
- 
-int strFind(char * buffer, char * match);
+
 
 static int newCertInProgress;
 /* This is the CDF statistics structure to hold useful info. */
@@ -141,127 +175,99 @@ typedef struct cdf_agent_context
     CDF_State_t eState;                                     /* State of the CDF agent. */
     uint8_t pcThingName[ cdfconfigMAX_THINGNAME_LEN + 1U ]; /* Thing name + zero terminator. */
     void * pMqttConnection;                                 /* Publish/subscribe MQTT connection shared with OTA agent. */
-    SemaphoreHandle_t xStartCertRotateSemaphore;            /* Semaphore given by CDF Custom Job callback to start 
-                                                             * cert rotation, taken in CDF task 
-                                                             */
     CDF_AgentStatistics_t xStatistics;                      /* CDF agent statistics block. */
     cdf_Api_t xCdfApi;                                      /* CDF Api calls */
     pxOTACustomJobCallback_t xOTACustomJobCallback;         /* OTA Custom Job Callback, saved at init then called by CDF 
                                                              * custom job callback if job is not a CDF job
                                                              */
+    bool xOTAStarted;                                       /* The OTA agent was started by CDF_AgentInit_internal. */
+    IotMutex_t xStateLock;                                  /* Serializes rotation events from MQTT callbacks and timeout jobs. */
+    CDF_CR_ACTION eAction;                                  /* Rotation step whose request is in flight. */
+    uint32_t ulAttempts;                                    /* Requests sent for the current step. */
+    uint64_t ullResponseDeadlineMs;                         /* Time at which the in flight request times out. */
+    bool xSubscribed;                                       /* The result topic subscription is active. */
+    bool xAwaitingResponse;                                 /* A request was sent and its response is pending. */
+    bool xNewCertActivated;                                 /* The attach response reported the new certificate as active. */
+    uint32_t ulRotationTime;                                /* UTC time at which the expiry driven rotation starts, 0 if none. */
+    IotTaskPoolJob_t xRotationJob;                          /* Deferred job that starts the expiry driven rotation. */
+    IotTaskPoolJobStorage_t xRotationJobStorage;            /* Storage for xRotationJob. */
+    uint32_t ulRetryTokens;                                 /* Retries that may be sent now. */
+    uint64_t ullRetryRefillMs;                              /* Time from which the next retry token accrues. */
+    IotTaskPoolJob_t xStartJob;                             /* Task pool job that starts the rotation. */
+    IotTaskPoolJobStorage_t xStartJobStorage;               /* Storage for xStartJob. */
+    IotTaskPoolJob_t xTimeoutJob;                           /* Deferred job that fires when a response is late. */
+    IotTaskPoolJobStorage_t xTimeoutJobStorage;             /* Storage for xTimeoutJob. */
+    volatile bool xShuttingDown;                            /* Set by CDF_AgentShutdown; callbacks return without touching xStateLock. */
+    volatile uint32_t ulActiveCallbacks;                    /* Jobs and callbacks that passed prvCDF_EnterCallback. */
 } CDF_AgentContext_t;
 
-static void prvCDF_RotateCertTask( void * pvUnused );
-
-int parseJsonCdfJob(char *json_str)
+/* Members of a CDF certificate rotation job. Each string must be present with this value.
+ * The parser skips the members of objects it does not know, so the objects the job
+ * notification wraps the document in, and the per step objects, are listed too. */
+static const JSON_DocParam_t xCDF_JobDocModel[ _CDF_JOB_NUM_PARAMS ] =
 {
-    char value[_MAX_JSON_VAL_LEN];
-    char key[_MAX_JSON_KEY_LEN];
-
-    int i;
-    int r;
-    int match_countdown = _CDF_JOB_JSON_MATCH_COUNT;
-
-    jsmn_parser p;
-    jsmntok_t t[_MAX_TOKEN_COUNT];
-
-    jsmn_init(&p);
-
-    r = jsmn_parse(&p, json_str, strlen(json_str), t, sizeof(t)/(sizeof(t[0])));
+    { "execution",   OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM }, eModelParamType_Object, JSMN_OBJECT },
+    { "jobDocument", OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM }, eModelParamType_Object, JSMN_OBJECT },
+    { "get",         OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM }, eModelParamType_Object, JSMN_OBJECT },
+    { "ack",         OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM }, eModelParamType_Object, JSMN_OBJECT },
+    { "operation", OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "RotateCertificates"                }, eModelParamType_StringMatch, JSMN_STRING },
+    { "subscribe", OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "cdf/certificates/{thingName}/get/+" }, eModelParamType_StringMatch, JSMN_STRING },
+    { "subscribe", OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "cdf/certificates/{thingName}/ack/+" }, eModelParamType_StringMatch, JSMN_STRING },
+    { "publish",   OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "cdf/certificates/{thingName}/get"   }, eModelParamType_StringMatch, JSMN_STRING },
+    { "publish",   OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "cdf/certificates/{thingName}/ack"   }, eModelParamType_StringMatch, JSMN_STRING },
+};
 
-    if (r < 0)
-    {
-        IotLogError("parseJsonCdfAgent: JSON parsing failed. JSON = %s", json_str);
-        return false;
-    }
+static BaseType_t prvCDF_ScheduleRotation( void );
+static void prvCDF_ScheduleExpiryRotation( void );
+static bool prvCDF_EnterCallback( void );
+static void prvCDF_LeaveCallback( void );
+static void prvCDF_CancelJob( IotTaskPoolJob_t xJob,
+                              const char * pcName );
+static void prvCDF_TimeoutJob( IotTaskPool_t pTaskPool,
+                               IotTaskPoolJob_t pJob,
+                               void * pContext );
+static void prvCDF_RotationJob( IotTaskPool_t pTaskPool,
+                                IotTaskPoolJob_t pJob,
+                                void * pContext );
 
-    /* Assume the top-level element is an object */
-    if (r < 1 || t[0].type != JSMN_OBJECT)
-    {
-        IotLogError("parseJsonCdfAgent: JSON parsing expected Object");
-        return false;
-    }
+/*-----------------------------------------------------------*/
 
-    for (i = 1; i < r; i++)
+/**
+ * @brief Decide whether a custom job document is a CDF certificate rotation job.
+ *
+ * The document is matched against a model with the shared OTA job document
+ * parser. When called from the OTA agent's custom job callback, the tokens the
+ * agent already parsed for the document are reused. The members may be at the
+ * top level, in the "execution" and "jobDocument" objects of a job notification,
+ * or in "get" and "ack" objects for each step.
+ *
+ * @return true if every member of the rotation job has its expected value.
+ */
+static bool prvCDF_IsRotationJob( const char * pcJSON,
+                                  uint32_t ulMsgLen )
+{
+    /* Key hashes of xCDF_JobDocModel, filled in by the first JSON_InitDocModel. */
+    static uint32_t ulCDF_JobDocKeyHashes[ _CDF_JOB_NUM_PARAMS ];
+    JSON_DocModel_t xModel;
+    DocParseErr_t eErr;
+
+    eErr = JSON_InitDocModel( &xModel,
+                              xCDF_JobDocModel,
+                              0U,
+                              0U,
+                              _CDF_JOB_NUM_PARAMS,
+                              ulCDF_JobDocKeyHashes );
+
+    if( eErr == eDocParseErr_None )
     {
-        jsmntok_t json_value = t[i+1];
-        jsmntok_t json_key = t[i];
-
-        int val_length = json_value.end - json_value.start;
-        int key_length = json_key.end - json_key.start;
-
-        int idx;
-
-        for (idx = 0; idx < val_length && idx < (_MAX_JSON_VAL_LEN - 1); idx++)
-        {
-            value[idx] = json_str[json_value.start + idx ];
-        }
-
-        for (idx = 0; idx < key_length && idx < (_MAX_JSON_KEY_LEN - 1); idx++)
-        {
-            key[idx] = json_str[json_key.start + idx];
-        }
-
-        key[key_length] = '\0';
-        value[val_length] = '\0';
-
-#ifdef DEBUG_CUSTOM_JOB_JSON
-        IotLogInfo("parseJsonCdfAgent: key %s", key);
-        IotLogInfo("parseJsonCdfAgent: key len %d, max key len %d", key_length, _MAX_JSON_KEY_LEN);
-
-        IotLogInfo("parseJsonCdfAgent: value %s", value);
-        IotLogInfo("parseJsonCdfAgent: value len %d, max value len %d", val_length, _MAX_JSON_VAL_LEN);
-        IotClock_SleepMs( 500 );
-#endif
-        /* 
-         * Make sure the number of compares matches the 
-         * _CDF_JOB_JSON_MATCH_COUNT and a match_countdown--
-         * happends for each.
-         */
-        if (!strcmp(key, "operation"))
-        {   
-            if (!strcmp(value, "RotateCertificates"))
-            {   
-                match_countdown--;
-            }
-        }
-
-        if (!strcmp(key, "subscribe"))
-        {   
-            if (!strcmp(value, "cdf/certificates/{thingName}/get/+"))
-            {   
-                match_countdown--;
-            }
-            if (!strcmp(value, "cdf/certificates/{thingName}/ack/+"))
-            {   
-                match_countdown--;
-            }
-        }
-
-        if (!strcmp(key, "publish"))
-        {
-            if (!strcmp(value, "cdf/certificates/{thingName}/get"))
-            {
-                match_countdown--;
-            }
-            if (!strcmp(value, "cdf/certificates/{thingName}/ack"))
-            {
-                match_countdown--;
-            }
-        }
-        i++;
+        eErr = JSON_ParseByModel( pcJSON, ulMsgLen, &xModel );
     }
 
-    if (!match_countdown)
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    return( eErr == eDocParseErr_None );
 }
 
+/*-----------------------------------------------------------*/
+
 int cleanupJsonStr(char * json_str, int max_length)
 {
     int bracket_cnt = 0;
@@ -437,7 +443,6 @@ static CDF_AgentContext_t xCDF_Agent =
     .eState                             = eCDF_AgentState_NotReady,
     .pcThingName                        = { 0 },
     .pMqttConnection                    = NULL,
-    .xStartCertRotateSemaphore          = NULL,
     .xStatistics                        = { 0 },
     .xCdfApi                            = CDF_JOB_API_DEFAULT_INITIALIZER,
     .xOTACustomJobCallback              = prvCDFDefaultCustomJobCallback
@@ -447,11 +452,12 @@ OTA_JobParseErr_t prvCDF_CertRotateCallback( const char * pcJSON, uint32_t ulMsg
 {
     OTA_JobParseErr_t xReturn = eOTA_JobParseErr_None;
     int cert_rotation = false;
+#ifdef DEBUG_CUSTOM_JOB_JSON
     const uint32_t batchSize=90;
     char tempBuffer[batchSize+1];
     tempBuffer[batchSize] = '\0';
     uint32_t printedLen = 0;
-    int strFindRc;
+#endif
     char *pcJSON_null;
     
     IotLogInfo( "prvCDF_CertRotateCallback called *************. ");
@@ -470,7 +476,6 @@ OTA_JobParseErr_t prvCDF_CertRotateCallback( const char * pcJSON, uint32_t ulMsg
             IotLogInfo("%s", tempBuffer);
             printedLen += batchSize;
         }
-        IotClock_SleepMs( 500 );
 #endif
     }
 
@@ -479,7 +484,7 @@ OTA_JobParseErr_t prvCDF_CertRotateCallback( const char * pcJSON, uint32_t ulMsg
         if ( pcJSON != NULL )
         {
             debug_something = true;
-            if (parseJsonCdfJob((char *) pcJSON))
+            if( prvCDF_IsRotationJob( pcJSON, ulMsgLen ) )
             {
                 IotLogInfo("prvCDF_CertRotateCallback: JSON parsing found CDF custom job");
                 cert_rotation = true;
@@ -495,16 +500,23 @@ OTA_JobParseErr_t prvCDF_CertRotateCallback( const char * pcJSON, uint32_t ulMsg
 
     if (cert_rotation)
     {
-        if (newCertInProgress == false)
+        if( prvCDF_EnterCallback() == true )
         {
-            newCertInProgress = true;
+            IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
 
-            xSemaphoreGive(xCDF_Agent.xStartCertRotateSemaphore);
-            IotLogInfo( "prvCDF_CertRotateCallback give start get cert.");
-        }
-        else
-        {
-            IotLogInfo( "prvCDF_CertRotateCallback: second attempt to gen cert before first completed");
+            if (newCertInProgress == false)
+            {
+                xCDF_Agent.eState = eCDF_AgentState_GetCert;
+                ( void ) prvCDF_ScheduleRotation();
+                IotLogInfo( "prvCDF_CertRotateCallback scheduled get cert.");
+            }
+            else
+            {
+                IotLogInfo( "prvCDF_CertRotateCallback: second attempt to gen cert before first completed");
+            }
+
+            IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+            prvCDF_LeaveCallback();
         }
     }
     else
@@ -520,9 +532,7 @@ void CDF_AgentInit_internal( void * pMqttConnection,
                            cdf_Api_t * xCdfApi,
                            TickType_t xTicksToWait )
 {
-    static TaskHandle_t pxCDF_TaskHandle;
-    int i;
-
+    CDF_STATE eNvmState;
     BaseType_t xReturn = pdTRUE;
 
     if ( xCdfApi != NULL )
@@ -609,61 +619,72 @@ void CDF_AgentInit_internal( void * pMqttConnection,
 
         if( xReturn == pdTRUE)
         {
-            xCDF_Agent.pMqttConnection = pMqttConnection;             
-            xCDF_Agent.xStartCertRotateSemaphore = xSemaphoreCreateBinary();
-            xCDF_Agent.eState = eCDF_AgentState_NotReady;
-
-            if( xCDF_Agent.xStartCertRotateSemaphore == NULL )
+            xCDF_Agent.pMqttConnection = pMqttConnection;
+            xCDF_Agent.xSubscribed = false;
+            xCDF_Agent.xAwaitingResponse = false;
+            xCDF_Agent.xOTAStarted = false;
+            xCDF_Agent.ulRotationTime = 0;
+            xCDF_Agent.ulRetryTokens = cdfconfigRETRY_BURST;
+            xCDF_Agent.ullRetryRefillMs = IotClock_GetTimeMs();
+            xCDF_Agent.xShuttingDown = false;
+            xCDF_Agent.ulActiveCallbacks = 0;
+            newCertInProgress = false;
+
+            if( IotMutex_Create( &( xCDF_Agent.xStateLock ), false ) == false )
             {
-                IotLogError( "Semaphore not created");
+                IotLogError( "Mutex not created");
                 xReturn = pdFALSE;
             }
 
             if (xReturn == pdTRUE)
             {
-                if (xTaskCreate( prvCDF_RotateCertTask, "CDF Rotate Cert Task", cdfconfigSTACK_SIZE, NULL,
-                                 cdfconfigAGENT_PRIORITY, &pxCDF_TaskHandle )  != pdPASS)
+                eNvmState = (xCDF_Agent.xCdfApi.xReadCDFStateNVM)();
+
+                if ( ( otaCallbacks != NULL ) &&
+                     ( eNvmState == CDF_STATE_WAIT_FOR_CERT_ROTATE ||
+                       eNvmState == CDF_STATE_ACK_CERT_ROTATE ||
+                       eNvmState == CDF_STATE_DEACTIVATE_CERT ) )
                 {
-                    IotLogError( "CDF Task Did not start");
-                    xReturn = pdFALSE;
+                    /*
+                    * Save the OTA custom job call back.
+                    * Replace the OTA custom job call back with the CDF custom job callback.
+                    * Then call the OTA custom job callback from witin the CDF custom job callback
+                    */
+                    xCDF_Agent.xOTACustomJobCallback = otaCallbacks->xCustomJobCallback;
+                    otaCallbacks->xCustomJobCallback = prvCDF_CertRotateCallback;
+
+                    /* Setup OTA and give it a second to start. */
+                    OTA_AgentInit_internal( pMqttConnection,  pcThingName,
+                        otaCallbacks,  xTicksToWait );
+                    xCDF_Agent.xOTAStarted = true;
                 }
-                else
+
+                /* Resume the rotation from the persisted state. The rotation
+                 * runs as jobs on the system task pool, so no task is created. */
+                IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+
+                if ( eNvmState == CDF_STATE_WAIT_FOR_CERT_ROTATE )
                 {
-                    IotLogInfo( "CDF Task Started");
+                    xCDF_Agent.eState = eCDF_AgentState_GetCert;
+                    xReturn = prvCDF_ScheduleRotation();
                 }
-
-                 if ( (xCdfApi->xReadCDFStateNVM)() == CDF_STATE_WAIT_FOR_CERT_ROTATE ||
-                         (xCdfApi->xReadCDFStateNVM)() == CDF_STATE_ACK_CERT_ROTATE ||
-                         (xCdfApi->xReadCDFStateNVM)() == CDF_STATE_DEACTIVATE_CERT)
-                 {
-                     /*
-                     * Save the OTA custom job call back.
-                     * Replace the OTA custom job call back with the CDF custom job callback.
-                     * Then call the OTA custom job callback from witin the CDF custom job callback
-                     */
-                     xCDF_Agent.xOTACustomJobCallback = otaCallbacks->xCustomJobCallback;
-                     otaCallbacks->xCustomJobCallback = prvCDF_CertRotateCallback;
-
-                     /* Setup OTA and give it a second to start. */
-                     OTA_AgentInit_internal( pMqttConnection,  pcThingName,
-                         otaCallbacks,  xTicksToWait );
-                 }
-
-            } 
-
-            if( xReturn == pdTRUE )
-            {
-                xReturn = pdFALSE;
-                for (i = 0; i < _MAX_WAIT_CDF_TASK_ATTEMPTS; i++)
+                else if ( eNvmState == CDF_STATE_ACK_CERT_ROTATE )
+                {
+                    xCDF_Agent.eState = eCDF_AgentState_AckCert;
+                    xReturn = prvCDF_ScheduleRotation();
+                }
+                else if ( eNvmState == CDF_STATE_DEACTIVATE_CERT )
+                {
+                    xCDF_Agent.eState = eCDF_AgentState_DeactivateCert;
+                    xReturn = prvCDF_ScheduleRotation();
+                }
+                else
                 {
-                    if ( xCDF_Agent.eState != eCDF_AgentState_NotReady ) 
-                    {
-                        xReturn = pdTRUE;
-                        break;
-                    }
-                    IotLogInfo( "Waiting for CDF Task to Start %d", i);
-                    IotClock_SleepMs( _SYNC_WAIT_MS );
+                    xCDF_Agent.eState = eCDF_AgentState_Ready;
+                    prvCDF_ScheduleExpiryRotation();
                 }
+
+                IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
             }
 
             if (xReturn != pdTRUE)
@@ -679,24 +700,72 @@ void CDF_AgentInit_internal( void * pMqttConnection,
     return ;
 }
 
-extern const char *pcOTAStateStr[];
 /* Public API to shutdown the CDF and OTA Agents. */
 
 void CDF_AgentShutdown( void )
 {
     OTA_State_t eOTAState;
-    IotLogInfo( "CDF_AgentShutdown: task is gone, clean up resources");
-    vSemaphoreDelete(xCDF_Agent.xStartCertRotateSemaphore);
+    IotMqttSubscription_t subscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+
+    IotLogInfo( "CDF_AgentShutdown: clean up resources");
+
+    /* From here on, jobs and MQTT callbacks return without taking
+     * xStateLock. */
+    taskENTER_CRITICAL();
+    xCDF_Agent.xShuttingDown = true;
+    taskEXIT_CRITICAL();
+
+    /* Stop the rotation state machine; late responses and timeouts are ignored. */
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+    xCDF_Agent.xAwaitingResponse = false;
+    newCertInProgress = false;
+    prvCDF_CancelJob( xCDF_Agent.xStartJob, "start" );
+    prvCDF_CancelJob( xCDF_Agent.xTimeoutJob, "timeout" );
+    prvCDF_CancelJob( xCDF_Agent.xRotationJob, "rotation" );
+    xCDF_Agent.ulRotationTime = 0;
+
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+
+    if ( xCDF_Agent.xSubscribed == true )
+    {
+        subscription.pTopicFilter = _CR_RESULT_TOPIC;
+        subscription.topicFilterLength = _CR_RESULT_TOPIC_LENGTH;
+
+        if ( IotMqtt_TimedUnsubscribe( xCDF_Agent.pMqttConnection,
+                                       &subscription,
+                                       _CR_SUB_TOPIC_COUNT,
+                                       0,
+                                       _MQTT_TIMEOUT_MS ) != IOT_MQTT_SUCCESS )
+        {
+            IotLogWarn( "CDF_AgentShutdown: failed to unsubscribe from %s", _CR_RESULT_TOPIC );
+        }
+
+        xCDF_Agent.xSubscribed = false;
+    }
+
+    /* A job that could not be cancelled, or a PUBLISH that was dispatched
+     * before the unsubscribe, may still hold or wait for the lock. */
+    while( xCDF_Agent.ulActiveCallbacks != 0UL )
+    {
+        IotClock_SleepMs( _SYNC_WAIT_MS );
+    }
+
+    IotMutex_Destroy( &( xCDF_Agent.xStateLock ) );
+
+    /* The rotation state in NVM moves on while the agent runs, so use the
+     * flag recorded at init to decide whether OTA needs shutting down. */
     /* Manish what should TickType value be. */
-    if ( (xCDF_Agent.xCdfApi.xReadCDFStateNVM)() == CDF_STATE_WAIT_FOR_CERT_ROTATE ) 
+    if ( xCDF_Agent.xOTAStarted == true ) 
     {
         IotLogInfo( "CDF_AgentShutdown: shut down OTA agent");
         OTA_AgentShutdown( (TickType_t) 20 );
         while (  ( eOTAState = OTA_GetAgentState() ) != eOTA_AgentState_NotReady ) 
         {
             IotClock_SleepMs( _SYNC_WAIT_MS );
-            configPRINTF( ( "Shutting down OTA:  State: %s\r\n", pcOTAStateStr[eOTAState]) );
+            configPRINTF( ( "Shutting down OTA:  State: %d\r\n", ( int ) eOTAState ) );
         }
+
+        xCDF_Agent.xOTAStarted = false;
     }
     return;
 }
@@ -709,6 +778,11 @@ CDF_State_t CDF_GetAgentState( void )
     return xCDF_Agent.eState;
 }
 
+uint32_t CDF_GetRotationTime( void )
+{
+    return xCDF_Agent.ulRotationTime;
+}
+
 uint32_t CDF_GetPacketsDropped( void )
 {
     return xCDF_Agent.xStatistics.ulCDF_PacketsDropped;
@@ -729,691 +803,1115 @@ uint32_t CDF_GetPacketsReceived( void )
     return xCDF_Agent.xStatistics.ulCDF_PacketsReceived;
 }
 
-int strFind(char * buffer, char * match)
+/**
+ * @brief Unescape a JSON string value in place.
+ *
+ * The unescaped string is never longer than the escaped one, so it is written
+ * over the value as the value is read.
+ *
+ * @param[in,out] pcValue The value, without its quotes.
+ * @param[in] xLength The length of the escaped value.
+ *
+ * @return The length of the unescaped value.
+ */
+static size_t prvCDF_UnescapeJsonString( char * pcValue,
+                                         size_t xLength )
 {
-    char *bufBeg, *bufEnd;
-    char *matchBeg, *matchEnd;
-    int char_cnt = -1;
+    const char * pcFrom = pcValue;
+    const char * pcEnd = pcValue + xLength;
+    char * pcTo = pcValue;
 
-    if (buffer && match)
+    while( pcFrom < pcEnd )
     {
-        bufBeg = buffer;
-        bufEnd = buffer + strlen(buffer);
-        matchEnd = match + strlen(match);
-        while (bufBeg < bufEnd)
+        if( ( *pcFrom == '\\' ) && ( pcFrom + 1 < pcEnd ) )
         {
-            matchBeg = match;
-            while (matchBeg < matchEnd)
+            pcFrom++;
+
+            switch( *pcFrom )
             {
-                if (*matchBeg++ != *bufBeg++)
-                {
+                case 'n':
+                    *pcTo++ = '\n';
                     break;
-                }
-            }
-            if (matchBeg == matchEnd)
-            {
-                char_cnt = (int) (bufBeg - buffer);
-                break;
-            }
-        }
-    }
-    return char_cnt;
-}
-
-IotMqttError_t processPayload(
-        char *payload, 
-        CDF_CR_ACTION * cdfCrAction, 
-        cdf_Api_t * cdfApi)
-{
-    int payloadStrLen, certDataLen;
-    IotMqttError_t pubStatus = IOT_MQTT_BAD_PARAMETER;
-    char certificate[1300];
-    char newCertificateId[_CERTIFICATE_ID_LENGTH];
-    char oldCertificateId[_CERTIFICATE_ID_LENGTH];
-
 
-    IotLogInfo( "Process Payload ");
-    IotClock_SleepMs( 1000 );
-
-    if (payload)
-    {
-        payloadStrLen = strlen(payload);
-
-        switch (*cdfCrAction)
-        {
-            case CDF_CR_GET_CERT:
-                IotLogInfo( "processPayload CDF_CR_GET_CERT");
-                IotLogInfo( "Sub Beg Payload: %1612s\r\n", payload );
-                IotClock_SleepMs( 1000 );
-#ifdef SAVE
-                IotLogInfo( "Sub End 1 Payload: %100s\r\n", (payload + payloadStrLen - 300));
-                IotLogInfo( "Sub End 2 Payload: %100s\r\n", (payload + payloadStrLen - 200));
-                IotLogInfo( "Sub End 3 Payload: %100s\r\n", (payload + payloadStrLen - 100));
-#endif
-                /* Get the new certificate PEM from payload*/
-                char * certStr = strstr(payload, _CR_GET_RESPONSE_STR_BEG);
-                char * newCertIdStr = strstr(payload, _CR_GET_NEW_CERT_ID_STR_BEG);
-                char * oldCertIdStr = strstr(payload, _CR_GET_OLD_CERT_ID_STR_BEG);
-
-
-                if(certStr != NULL && certStr[0] == _CR_GET_RESPONSE_STR_BEG[0]){
-                    certStr = (certStr + _CR_GET_RESPONSE_BEG_OFFSET);
-                    certDataLen = strFind(certStr, _CR_GET_RESPONSE_STR_END);
-                    if (certDataLen >= 0)
-                   {
-                       /* Null terminate and bypass charaters1 before the actual cert */
-                       *(certStr + certDataLen + 1) = '\0';
-
-                       strncpy(certificate, certStr, certDataLen + 1);
-
-                       /* store the cert */
-                       if (cdfApi->xPutTempDeviceCert(certificate) == EXIT_SUCCESS)
-                       {
-                           IotLogError( "IOT_MQTT_SUCCESS Have a temp cert %50s", certificate);
-                       }
-                       else
-                       {
-                           IotLogError( "New Cert was not stored properly");
-                           break;
-                       }
-                   }
-                    else{
-                        IotLogError( "New Cert wasn't found");
-                        break;
-                    }
-
-                }
-                else{
-                    IotLogError("couldn't find new cert pem");
+                case 'r':
+                    *pcTo++ = '\r';
                     break;
-                }
 
-                /* Get the new certificate Id from payload */
-                if(newCertIdStr != NULL){
-                    newCertIdStr = (newCertIdStr + strlen(_CR_GET_NEW_CERT_ID_STR_BEG));
-                    newCertIdStr[_CERTIFICATE_ID_LENGTH - 1] = '\0';
-                    strncpy(newCertificateId, newCertIdStr, _CERTIFICATE_ID_LENGTH);
-                    if(cdfApi->xPutNewCertificateId(newCertificateId) == EXIT_SUCCESS){
-                        IotLogError( "IOT_MQTT_SUCCESS Have a new cert id %50s", cdfApi->xGetNewCertificateId());
-                    } 
-                    else{
-                        IotLogError( "IOT_MQTT_ERROR Couldn't put new certificate ID");
-                    }
-                    
-                }
-                else{
-                    IotLogError( "New Cert Id was not found");
+                case 't':
+                    *pcTo++ = '\t';
                     break;
-                }
-                /* Get the old certificate Id. Since we reuse the cdfAPI context we don't need
-                to worry about losing this when we switch certificates */
-                if(oldCertIdStr != NULL){
-                    oldCertIdStr = (oldCertIdStr + strlen(_CR_GET_OLD_CERT_ID_STR_BEG));
-                    oldCertIdStr[_CERTIFICATE_ID_LENGTH - 1] = '\0';
-                    strncpy(oldCertificateId, oldCertIdStr, _CERTIFICATE_ID_LENGTH);
-                    if(cdfApi->xPutOldCertificateId(oldCertificateId) == EXIT_SUCCESS){
-                        IotLogError( "IOT_MQTT_SUCCESS Have an old cert id %50s", cdfApi->xGetOldCertificateId());
-                        pubStatus = IOT_MQTT_SUCCESS;
-                    }
-                    else{
-                        IotLogError( "IOT_MQTT_ERROR Couldn't put old certificate ID");
-                    }
-                   
-                }
-                else{
-                    IotLogError( "Old Cert Id was not found");
-                }
-                break;
-            case CDF_CR_ACK_CERT:
-                IotLogInfo( "processPayload CDF_CR_ACK_CERT");
-                IotLogInfo( "Sub Payload: %s", payload );
-                IotClock_SleepMs( 1000 );
-                /* match payload */
-                /* check that payload is success */
-                if (strncmp(payload, _CR_ACK_RESPONSE_STR_ERROR, _CR_ACK_RESPONSE_LEN)  != 0)
-                {
-                    pubStatus = IOT_MQTT_SUCCESS;
-                }
-                else
-                {
-                    IotLogError( "Ack response is not correct. Expected = %s, Actual = %s",
-                        _CR_ACK_RESPONSE_STR_ERROR,
-                        payload);
-                }
-                break;
-            case CDF_CR_DEACTIVATE_CERT:
-                IotLogInfo("processPayload CDF_CR_DEACTIVATE_CERT");
-                IotLogInfo( "Sub Payload: %s", payload );
-                IotClock_SleepMs( 1000 );
-                if (strncmp(payload, _CR_ACK_RESPONSE_STR_ERROR, _CR_ACK_RESPONSE_LEN)  != 0)
-                {
-                    pubStatus = IOT_MQTT_SUCCESS;
-                }
-                else
-                {
-                    IotLogError( "Deactivate response is not correct. Expected = %s, Actual = %s",
-                        _CR_ACK_RESPONSE_STR_ERROR,
-                        payload);
-                }
-                break;
-        }
-    }
-    return (pubStatus); 
-} /*-----------------------------------------------------------*/ 
-/**
- * @brief Called by the MQTT library when an incoming PUBLISH message is received.
- *
- * The demo uses this callback to handle incoming PUBLISH messages. This callback
- * prints the contents of an incoming message and publishes an acknowledgement
- * to the MQTT server.
- * @param[in] param1 Counts the total number of received PUBLISH messages. This
- * callback will increment this counter.
- * @param[in] pPublish Information about the incoming PUBLISH message passed by
- * the MQTT library.
- */
-static void _mqttSubscriptionCallback( void * param1,
-                                       IotMqttCallbackParam_t * const pPublish )
-{
-    int acknowledgementLength = 0;
-    int payload_len = pPublish->u.message.info.payloadLength;    
-    cdf_subCallbackParams_t * subCallbackParams;
-    CDF_CR_ACTION * cdfCrAction;
-    cdf_Api_t * cdfApi;
-    IotSemaphore_t * pPublishesReceived;
-    char * pPayload = (char *) pPublish->u.message.info.pPayload;
-    char pAcknowledgementMessage[ _ACKNOWLEDGEMENT_MESSAGE_BUFFER_LENGTH ] = { 0 };
-    IotMqttPublishInfo_t acknowledgementInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
-    IotMqttError_t pubStatus;
-
-    subCallbackParams = (cdf_subCallbackParams_t *) param1;
-    pPublishesReceived = subCallbackParams->pPublishesReceived;
-    cdfCrAction = subCallbackParams->cdfCrAction;
-    cdfApi = subCallbackParams->cdfApi;
-
-    /* Print information about the incoming PUBLISH message. */
-    IotLogInfo( "Incoming PUBLISH received:\n"
-                "Subscription topic filter: %s\n"
-                "Publish topic name: %s\n",
-                pPublish->u.message.pTopicFilter,
-                pPublish->u.message.info.pTopicName);
-
-    IotLogInfo( "Sub Payload Len: %d", payload_len);
-    IotLogInfo( "Mqtt Step: %d", *cdfCrAction );
 
-    /* Set the members of the publish info for the acknowledgement message. */
-    acknowledgementInfo.qos = IOT_MQTT_QOS_1;
-    acknowledgementInfo.pTopicName = _ACKNOWLEDGEMENT_TOPIC_NAME;
-    acknowledgementInfo.topicNameLength = _ACKNOWLEDGEMENT_TOPIC_NAME_LENGTH;
-    acknowledgementInfo.pPayload = pAcknowledgementMessage;
-    acknowledgementInfo.payloadLength = ( size_t ) acknowledgementLength;
-    acknowledgementInfo.retryMs = _PUBLISH_RETRY_MS;
-    acknowledgementInfo.retryLimit = _PUBLISH_RETRY_LIMIT;
+                case '"':
+                case '\\':
+                case '/':
+                    *pcTo++ = *pcFrom;
+                    break;
 
-    pubStatus = IotMqtt_TimedPublish( pPublish->mqttConnection,
-                         &acknowledgementInfo,
-                         0,
-                         _MQTT_TIMEOUT_MS);
+                default:
+                    /* Not expected in a PEM; keep the escape as it was sent. */
+                    *pcTo++ = '\\';
+                    *pcTo++ = *pcFrom;
+                    break;
+            }
 
-    if ( pubStatus == IOT_MQTT_SUCCESS )
-    {
-        *(pPayload + payload_len) = '\0';
-        pubStatus = processPayload(pPayload, cdfCrAction, cdfApi);
-        /* IotLogInfo( "Acknowledgment message for PUBLISH sent."); */
-        if ( pubStatus == IOT_MQTT_SUCCESS )
+            pcFrom++;
+        }
+        else
         {
-            /* Increment the number of PUBLISH messages received. */
-            IotSemaphore_Post( pPublishesReceived );
+            *pcTo++ = *pcFrom++;
         }
     }
-    else
-    {
-        IotLogWarn( "Acknowledgment message for PUBLISH %s will NOT be sent.",
-                         IotMqtt_strerror( pubStatus ) );
-    }
+
+    return ( size_t ) ( pcTo - pcValue );
 }
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Add or remove subscriptions by either subscribing or unsubscribing.
+ * @brief Find the value of a top level member of a tokenized response object.
  *
- * @param[in] mqttConnection The MQTT connection to use for subscriptions.
- * @param[in] operation Either #IOT_MQTT_SUBSCRIBE or #IOT_MQTT_UNSUBSCRIBE.
- * @param[in] pTopicFilters Array of topic filters for subscriptions.
- * @param[in] pCallbackParameter The parameter to pass to the subscription
- * callback.
- *
- * @return `EXIT_SUCCESS` if the subscription operation succeeded; `EXIT_FAILURE`
- * otherwise.
+ * @return The index of the value token, or -1 if the key is not present.
  */
-static int _modifySubscriptions( IotMqttConnection_t mqttConnection,
-                                 IotMqttOperationType_t operation,
-                                 const char ** pTopicFilters,
-                                 void * pCallbackParameter)
+static int prvCDF_FindResponseValue( const char * pcPayload,
+                                     const jsmntok_t * pxTokens,
+                                     int lTokenCount,
+                                     const char * pcKey )
 {
-    int status = EXIT_SUCCESS;
-    int32_t i = 0;
-    IotMqttError_t subscriptionStatus = IOT_MQTT_STATUS_PENDING;
-    IotMqttSubscription_t pSubscriptions[ _CR_SUB_TOPIC_COUNT ] = { IOT_MQTT_SUBSCRIPTION_INITIALIZER };
-
-    /* Set the members of the subscription list. */
-    for( i = 0; i < _CR_SUB_TOPIC_COUNT; i++ )
-    {
-        pSubscriptions[ i ].qos = IOT_MQTT_QOS_1;
-        pSubscriptions[ i ].pTopicFilter = pTopicFilters[ i ];
-        /* TBD: question why original code had a len - 1, look for this if there is a problem */
-        pSubscriptions[ i ].topicFilterLength = strlen( pSubscriptions[ i ].pTopicFilter );
-        pSubscriptions[ i ].callback.pCallbackContext = pCallbackParameter;
-        pSubscriptions[ i ].callback.function = _mqttSubscriptionCallback;
-        IotLogInfo( "Subscribe filter %s.", pSubscriptions[ i ].pTopicFilter ); 
-    }
-
-    /* Modify subscriptions by either subscribing or unsubscribing. */
-    if( operation == IOT_MQTT_SUBSCRIBE )
-    {
-        IotLogInfo( "before IotMqtt_TimedSubscribe() %d %d", _MQTT_TIMEOUT_MS, IOT_DEMO_MQTT_PUBLISH_BURST_SIZE);
-        subscriptionStatus = IotMqtt_TimedSubscribe( mqttConnection,
-                                                     pSubscriptions,
-                                                     _CR_SUB_TOPIC_COUNT,
-                                                     0,
-                                                     _MQTT_TIMEOUT_MS );
-
-        IotLogInfo( "after IotMqtt_TimedSubscribe() ");
-        /* Check the status of SUBSCRIBE. */
-        switch( subscriptionStatus )
-        {
-            case IOT_MQTT_SUCCESS:
-                IotLogInfo( "All demo topic filter subscriptions accepted." ); 
-                break;
-
-            case IOT_MQTT_SERVER_REFUSED:
-
-                /* Check which subscriptions were rejected before exiting the demo. */
-                for( i = 0; i < _CR_SUB_TOPIC_COUNT; i++ )
-                {
-                    if( IotMqtt_IsSubscribed( mqttConnection,
-                                              pSubscriptions[ i ].pTopicFilter,
-                                              pSubscriptions[ i ].topicFilterLength,
-                                              NULL ) == true )
-                    {
-                        /* IotLogInfo( "Topic filter %.*s was accepted.",
-                         *           pSubscriptions[ i ].topicFilterLength,
-                         *           pSubscriptions[ i ].pTopicFilter );
-                         */
-                    }
-                    else
-                    {
-                        IotLogError( "Topic filter %.*s was rejected.",
-                                     pSubscriptions[ i ].topicFilterLength,
-                                     pSubscriptions[ i ].pTopicFilter );
-                    }
-                }
-
-                status = EXIT_FAILURE;
-                break;
-
-            default:
+    int i;
+    size_t xKeyLength = strlen( pcKey );
 
-                status = EXIT_FAILURE;
-                break;
-        }
-    }
-    else if( operation == IOT_MQTT_UNSUBSCRIBE )
+    if( ( lTokenCount < 1 ) || ( pxTokens[ 0 ].type != JSMN_OBJECT ) )
     {
-        subscriptionStatus = IotMqtt_TimedUnsubscribe( mqttConnection,
-                                                       pSubscriptions,
-                                                       _CR_SUB_TOPIC_COUNT,
-                                                       0,
-                                                       _MQTT_TIMEOUT_MS );
+        return -1;
+    }
 
-        /* Check the status of UNSUBSCRIBE. */
-        if( subscriptionStatus != IOT_MQTT_SUCCESS )
+    for( i = 1; i + 1 < lTokenCount; i++ )
+    {
+        if( ( pxTokens[ i ].parent == 0 ) &&
+            ( pxTokens[ i ].type == JSMN_STRING ) &&
+            ( ( size_t ) ( pxTokens[ i ].end - pxTokens[ i ].start ) == xKeyLength ) &&
+            ( strncmp( pcPayload + pxTokens[ i ].start, pcKey, xKeyLength ) == 0 ) )
         {
-            status = EXIT_FAILURE;
+            return i + 1;
         }
     }
-    else
-    {
-        /* Only SUBSCRIBE and UNSUBSCRIBE are valid for modifying subscriptions. */
-        IotLogError( "MQTT operation %s is not valid for modifying subscriptions.",
-                     IotMqtt_OperationType( operation ) );
-
-        status = EXIT_FAILURE;
-    }
 
-    return status;
+    return -1;
 }
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Transmit all messages and wait for them to be received on topic filters.
+ * @brief Zero terminate a string value token in place and return it.
  *
- * @param[in] mqttConnection The MQTT connection to use for publishing.
- * @param[in] pTopicNames Array of topic names for publishing. These were previously
- * subscribed to as topic filters.
- * @param[in] pPublishReceivedCounter Counts the number of messages received on
- * topic filters.
+ * The terminator overwrites the closing quote, which is always inside the payload.
  *
- * @return `EXIT_SUCCESS` if all messages are published and received; `EXIT_FAILURE`
- * otherwise.
+ * @return The value, or NULL if the token is not a string.
  */
-static int _publishAllMessages( IotMqttConnection_t mqttConnection,
-                                cdf_subCallbackParams_t * subCallbackParams,
-                                const char ** pubTopics)
+static char * prvCDF_TerminateString( char * pcPayload,
+                                      const jsmntok_t * pxToken )
 {
-    int status = EXIT_SUCCESS;
-    int pubTopicLen = 0, pubPayloadLen = 0;
-    CDF_CR_ACTION *cdfCrAction;
-    cdf_Api_t *cdfApi;
-    IotSemaphore_t * pPublishesReceived;
-    IotMqttError_t publishStatus = IOT_MQTT_STATUS_PENDING;
-    IotMqttPublishInfo_t publishInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
-    char pPublishPayload[ _PUBLISH_PAYLOAD_BUFFER_LENGTH ] = { 0 };
-    int i, str_len;
-
-    cdfCrAction = subCallbackParams->cdfCrAction;
-    pPublishesReceived = subCallbackParams->pPublishesReceived;
-    cdfApi = subCallbackParams->cdfApi;
-
-    /* Set the common members of the publish info. */
-    publishInfo.qos = IOT_MQTT_QOS_1;
-    publishInfo.retryMs = _PUBLISH_RETRY_MS;
-    publishInfo.pTopicName = (*pubTopics);
-    publishInfo.pPayload = pPublishPayload;
-    publishInfo.retryLimit = _PUBLISH_RETRY_LIMIT;
-
-    /* Generate an publish topic */
-    pubTopicLen = strlen ((*pubTopics)) ;
-    publishInfo.topicNameLength = pubTopicLen;
-
-    /* Generate the payload for the PUBLISH. */
-    if (*cdfCrAction == CDF_CR_GET_CERT)
-    {
-        IotLogInfo( "CR ACTION GET CERT");
-        pubPayloadLen = snprintf( pPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
-                           "{\"csr\": \"%s\"}",
-                           cdfApi->xGetCSR());
-    }
-    else if (*cdfCrAction == CDF_CR_DEACTIVATE_CERT){
-        pubPayloadLen = snprintf( pPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
-                           "{\"oldCertificateId\": \"%s\"}",
-            cdfApi->xGetOldCertificateId());
-    }
-    else if (*cdfCrAction == CDF_CR_ACK_CERT){
-        IotLogInfo( "CR ACTION ACK CERT");
-        pubPayloadLen = snprintf( pPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
-                           "{\"newCertificateId\": \"%s\"}",
-            cdfApi->xGetNewCertificateId());
-    }
-    else
-    {
-        IotLogError( "_publishAllMessages: MQTT Step ERROR");
-    }
-
-    /* Check for errors in loading the payload */
-    if( pubPayloadLen <= 0 )
+    if( pxToken->type != JSMN_STRING )
     {
-        IotLogError( "_publishAllMessages: Failed to generate MQTT PUBLISH payload for PUBLISH ");
-        status = EXIT_FAILURE;
+        return NULL;
     }
-    else
-    {
-        publishInfo.payloadLength = ( size_t ) pubPayloadLen;
-        
-        IotLogInfo( "before IoTMqtt_TimedPublish");
-        /* PUBLISH a message. This is an asynchronous function that notifies of
-         * completion through a callback. */
-        publishStatus = IotMqtt_TimedPublish( mqttConnection,
-                                         &publishInfo,
-                                         0,
-                                         _MQTT_TIMEOUT_MS);
 
-        if( publishStatus != IOT_MQTT_SUCCESS )
-        {
-            IotLogError( "_publishAllMessages: MQTT PUBLISH returned error %s.",
-                         IotMqtt_strerror( publishStatus ) );
-            status = EXIT_FAILURE;
-        }
-        /* Wait on the semaphonre twice as long as the pub timeout */
-        else if( IotSemaphore_TimedWait( pPublishesReceived,
-                                    (_MQTT_TIMEOUT_MS * 2) ) == false )
-        {
-            IotLogError( "_publishAllMessages: Timed out waiting for incoming PUBLISH messages." );
+    pcPayload[ pxToken->end ] = '\0';
 
-            status = EXIT_FAILURE;
-        }
-    }
-    return status;
+    return pcPayload + pxToken->start;
 }
 
+/*-----------------------------------------------------------*/
 
-int cdf_CertRotateAction(
-    IotMqttConnection_t mqttConnection,
-    const char ** subTopics,
-    const char ** pubTopics,
-    cdf_Api_t * cdfApi,
-    CDF_CR_ACTION * cdfCrAction)
+/**
+ * @brief Handle the response to a rotation step.
+ *
+ * The payload is tokenized in a single pass and the values are then used in
+ * place: strings are zero terminated over their closing quotes and the
+ * certificate PEM is unescaped over itself, so the only copy made is the one
+ * into the storage behind the CDF API.
+ *
+ * @param[in,out] pcPayload The response payload. It is modified.
+ * @param[in] xPayloadLength The length of the payload; it need not be zero terminated.
+ * @param[in] eAction The rotation step the response belongs to.
+ * @param[in] cdfApi The CDF storage callbacks.
+ * @param[out] pxActivated Set to true if an attach response reports that the
+ * new certificate was activated with it.
+ *
+ * @return IOT_MQTT_SUCCESS if the step succeeded.
+ */
+static IotMqttError_t processPayload( char * pcPayload,
+                                      size_t xPayloadLength,
+                                      CDF_CR_ACTION eAction,
+                                      cdf_Api_t * cdfApi,
+                                      bool * pxActivated )
 {
-    int status;
-    int mqtt_publish_attempts;
-    cdf_subCallbackParams_t subCallbackParams; 
-
-    /* Counts the number of incoming PUBLISHES received (and allows the demo
-     * application to wait on incoming PUBLISH messages). */
-    IotSemaphore_t publishesReceived; 
+    IotMqttError_t pubStatus = IOT_MQTT_BAD_PARAMETER;
+    jsmn_parser xParser;
+    jsmntok_t xTokens[ _CR_RESPONSE_MAX_TOKENS ];
+    int lTokenCount;
+    int lPem, lNewId, lOldId, lActivated;
+    char * pcPem;
+    char * pcNewId;
+    char * pcOldId;
+    size_t xPemLength;
+
+#ifdef DEBUG_CERT_ROTATE_JSON
+    IotLogDebug( "processPayload step %d, %d bytes: %.*s",
+                 eAction,
+                 ( int ) xPayloadLength,
+                 _CR_LOG_PAYLOAD_LENGTH,
+                 pcPayload );
+#endif
 
-    /* Store data in struct used in subscritption callback */
-    subCallbackParams.pPublishesReceived = &publishesReceived;
-    subCallbackParams.cdfCrAction = cdfCrAction;
-    subCallbackParams.cdfApi = cdfApi;
+    *pxActivated = false;
 
-    IotLogError( "cdf_CertRotateAction: enter");
+    jsmn_init( &xParser );
+    lTokenCount = jsmn_parse( &xParser, pcPayload, xPayloadLength, xTokens, _CR_RESPONSE_MAX_TOKENS );
 
-    /* Add the topic filter subscriptions used in this demo. */
-    status = _modifySubscriptions( mqttConnection,
-                                   IOT_MQTT_SUBSCRIBE,
-                                   subTopics,
-                                   &subCallbackParams);
-    if (status != EXIT_SUCCESS )
+    if( lTokenCount < 1 )
     {
-        IotLogError( "cdf_CertRotateAction: Failed to subscribe topics");
+        IotLogError( "CDF rotation step %d: response is not JSON (%d): %.*s",
+                     eAction,
+                     lTokenCount,
+                     _CR_LOG_PAYLOAD_LENGTH,
+                     pcPayload );
+        return pubStatus;
     }
-    else
+
+    if( prvCDF_FindResponseValue( pcPayload, xTokens, lTokenCount, _CR_KEY_ERROR ) >= 0 )
     {
+        IotLogError( "CDF rotation step %d: error response: %.*s",
+                     eAction,
+                     _CR_LOG_PAYLOAD_LENGTH,
+                     pcPayload );
+        return pubStatus;
+    }
 
-        IotLogError( "create semaphore");
-        /* Create the semaphore to count incoming PUBLISH messages. */
-        if( IotSemaphore_Create( &publishesReceived,
-                                 0,
-                                 IOT_DEMO_MQTT_PUBLISH_BURST_SIZE ) == true )
-        {
-            status = EXIT_FAILURE;
+    switch( eAction )
+    {
+        case CDF_CR_GET_CERT:
+            lPem = prvCDF_FindResponseValue( pcPayload, xTokens, lTokenCount, _CR_KEY_NEW_CERT_PEM );
+            lNewId = prvCDF_FindResponseValue( pcPayload, xTokens, lTokenCount, _CR_KEY_NEW_CERT_ID );
+            lOldId = prvCDF_FindResponseValue( pcPayload, xTokens, lTokenCount, _CR_KEY_OLD_CERT_ID );
 
-            for (mqtt_publish_attempts = 0; 
-                 mqtt_publish_attempts < _MAX_MQTT_PUBLISH_ATTEMPTS &&
-                 status != EXIT_SUCCESS; 
-                 mqtt_publish_attempts++)
+            if( ( lPem < 0 ) || ( lNewId < 0 ) || ( lOldId < 0 ) )
             {
-                IotLogError( "publishAllMessage: attempt = %d", mqtt_publish_attempts);
+                IotLogError( "CDF rotation step %d: response is missing a member.", eAction );
+                break;
+            }
 
-                /* PUBLISH (and wait) for all messages. */
-                status = _publishAllMessages( mqttConnection,
-                                              &subCallbackParams,
-                                              pubTopics);
+            pcPem = prvCDF_TerminateString( pcPayload, &xTokens[ lPem ] );
+            pcNewId = prvCDF_TerminateString( pcPayload, &xTokens[ lNewId ] );
+            pcOldId = prvCDF_TerminateString( pcPayload, &xTokens[ lOldId ] );
 
+            if( ( pcPem == NULL ) || ( pcNewId == NULL ) || ( pcOldId == NULL ) ||
+                ( strlen( pcNewId ) >= _CERTIFICATE_ID_LENGTH ) ||
+                ( strlen( pcOldId ) >= _CERTIFICATE_ID_LENGTH ) )
+            {
+                IotLogError( "CDF rotation step %d: malformed response member.", eAction );
+                break;
             }
-            /* Destroy the incoming PUBLISH counter. */
-            IotSemaphore_Destroy( &publishesReceived );
-        }
-        else
-        {
-            /* Failed to create incoming PUBLISH counter. */
-            status = EXIT_FAILURE;
-        }
 
-        /* Remove the topic subscription filters used in this demo. */
-        if (_modifySubscriptions( mqttConnection,
-                                       IOT_MQTT_UNSUBSCRIBE,
-                                       subTopics,
-                                       NULL) != EXIT_SUCCESS)
-        {
-            status = EXIT_FAILURE;
-        }
+            xPemLength = prvCDF_UnescapeJsonString( pcPem,
+                                                    ( size_t ) ( xTokens[ lPem ].end - xTokens[ lPem ].start ) );
+            pcPem[ xPemLength ] = '\0';
 
-    }
-    return (status);
-}
+            if( cdfApi->xPutTempDeviceCert( pcPem ) != EXIT_SUCCESS )
+            {
+                IotLogError( "New Cert was not stored properly" );
+            }
+            else if( cdfApi->xPutNewCertificateId( pcNewId ) != EXIT_SUCCESS )
+            {
+                IotLogError( "IOT_MQTT_ERROR Couldn't put new certificate ID" );
+            }
+            else if( cdfApi->xPutOldCertificateId( pcOldId ) != EXIT_SUCCESS )
+            {
+                IotLogError( "IOT_MQTT_ERROR Couldn't put old certificate ID" );
+            }
+            else
+            {
+                IotLogDebug( "Stored new certificate %s, replacing %s.", pcNewId, pcOldId );
+                pubStatus = IOT_MQTT_SUCCESS;
 
-int cdf_GetNewCert( IotMqttConnection_t mqttConnection )
-{
-    int status = EXIT_FAILURE;
-    int mqtt_get_cert_attempts;
-    CDF_CR_ACTION cdfCrAction; 
-    cdf_Api_t *cdfApi;
+                /* Only a lambda that honoured autoActivate sends a true "activated";
+                 * otherwise the certificate is activated by the ACK step. */
+                lActivated = prvCDF_FindResponseValue( pcPayload, xTokens, lTokenCount, _CR_KEY_ACTIVATED );
+
+                if( ( lActivated >= 0 ) &&
+                    ( xTokens[ lActivated ].type == JSMN_PRIMITIVE ) &&
+                    ( pcPayload[ xTokens[ lActivated ].start ] == 't' ) )
+                {
+                    *pxActivated = true;
+                }
+            }
 
-    cdfApi = &(xCDF_Agent.xCdfApi);
+            break;
 
-    /* Subscribe Topics to Get a Certificate */
-    const char * subGetTopics[ _CR_SUB_TOPIC_COUNT ] =
+        case CDF_CR_ACK_CERT:
+        case CDF_CR_DEACTIVATE_CERT:
+            /* Anything but an error object acknowledges the step. */
+            pubStatus = IOT_MQTT_SUCCESS;
+            break;
+
+        default:
+            break;
+    }
+
+    return pubStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Return the topic on which the request for a rotation step is published.
+ *
+ * All steps share the single result topic subscription for their responses.
+ */
+static const char * prvCDF_RequestTopic( CDF_CR_ACTION eAction )
+{
+    const char * pcTopic;
+
+    switch( eAction )
     {
-       _CR_TOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME,
-    };
-    const char * pubGetTopics[ _CR_PUB_TOPIC_COUNT ] =
+        case CDF_CR_GET_CERT:
+            pcTopic = _CR_ATTACH_TOPIC;
+            break;
+
+        case CDF_CR_ACK_CERT:
+            pcTopic = _CR_ACTIVATE_TOPIC;
+            break;
+
+        default:
+            pcTopic = _CR_DETACH_TOPIC;
+            break;
+    }
+
+    return pcTopic;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Register a job or MQTT callback that is about to take
+ * xStateLock.
+ *
+ * @return false once CDF_AgentShutdown has started; the caller must then
+ * return without touching the agent.
+ */
+static bool prvCDF_EnterCallback( void )
+{
+    bool xEntered = false;
+
+    taskENTER_CRITICAL();
+
+    if( xCDF_Agent.xShuttingDown == false )
     {
-       _CR_TOPIC_PREFIX "/attach/" clientcredentialIOT_THING_NAME,
-    };
+        xCDF_Agent.ulActiveCallbacks++;
+        xEntered = true;
+    }
+
+    taskEXIT_CRITICAL();
 
-    /* Subscribe Topics to Acknowledge a Certificate */
-    const char * subAckTopics[ _CR_SUB_TOPIC_COUNT ] =
+    return xEntered;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unregister a callback that returned true from prvCDF_EnterCallback.
+ */
+static void prvCDF_LeaveCallback( void )
+{
+    taskENTER_CRITICAL();
+    xCDF_Agent.ulActiveCallbacks--;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Cancel a job that is still waiting in the task pool.
+ *
+ * A job that has started running reports COMPLETED; the task pool no longer
+ * uses its storage, and CDF_AgentShutdown waits for it through
+ * prvCDF_EnterCallback.
+ *
+ * @param[in] xJob The job, NULL if it was never created.
+ * @param[in] pcName Name of the job for the log.
+ */
+static void prvCDF_CancelJob( IotTaskPoolJob_t xJob,
+                              const char * pcName )
+{
+    IotTaskPoolError_t taskPoolStatus;
+    IotTaskPoolJobStatus_t xJobStatus = IOT_TASKPOOL_STATUS_UNDEFINED;
+
+    if( xJob != NULL )
     {
-       _CR_TOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME,
-    };
-    const char * pubAckTopics[ _CR_PUB_TOPIC_COUNT ] =
+        taskPoolStatus = IotTaskPool_TryCancel( IOT_SYSTEM_TASKPOOL, xJob, &xJobStatus );
+
+        if( ( taskPoolStatus != IOT_TASKPOOL_SUCCESS ) &&
+            ( xJobStatus != IOT_TASKPOOL_STATUS_COMPLETED ) &&
+            ( xJobStatus != IOT_TASKPOOL_STATUS_CANCELED ) )
+        {
+            IotLogWarn( "Failed to cancel CDF %s job, error %s, status %d.",
+                        pcName,
+                        IotTaskPool_strerror( taskPoolStatus ),
+                        xJobStatus );
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stop the rotation after an unrecoverable error.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ */
+static void prvCDF_FailRotation( void )
+{
+    IotLogError( "CDF rotation step %d failed after %u attempts.",
+                 xCDF_Agent.eAction,
+                 ( unsigned ) xCDF_Agent.ulAttempts );
+
+    xCDF_Agent.xAwaitingResponse = false;
+    xCDF_Agent.eState = eCDF_AgentState_NotReady;
+    newCertInProgress = false;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Arm the deferred job that fires if no response arrives for the
+ * request in flight.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ *
+ * @param[in] ulTimeoutMs Time from now at which the job fires.
+ */
+static void prvCDF_ArmTimeout( uint32_t ulTimeoutMs )
+{
+    IotTaskPoolError_t taskPoolStatus;
+
+    xCDF_Agent.ullResponseDeadlineMs = IotClock_GetTimeMs() + ulTimeoutMs;
+
+    /* The job storage is reused, so an earlier timeout must not still be
+     * waiting in the task pool. */
+    prvCDF_CancelJob( xCDF_Agent.xTimeoutJob, "timeout" );
+
+    taskPoolStatus = IotTaskPool_CreateJob( prvCDF_TimeoutJob,
+                                            NULL,
+                                            &( xCDF_Agent.xTimeoutJobStorage ),
+                                            &( xCDF_Agent.xTimeoutJob ) );
+
+    if( taskPoolStatus == IOT_TASKPOOL_SUCCESS )
     {
-       _CR_TOPIC_PREFIX "/activate/" clientcredentialIOT_THING_NAME,
-    };
+        taskPoolStatus = IotTaskPool_ScheduleDeferred( IOT_SYSTEM_TASKPOOL,
+                                                       xCDF_Agent.xTimeoutJob,
+                                                       ulTimeoutMs );
+    }
 
-     /* Subscribe Topics to Deactivate a Certificate */
-    const char * subDeactivateTopics[ _CR_SUB_TOPIC_COUNT ] =
+    if( taskPoolStatus != IOT_TASKPOOL_SUCCESS )
     {
-       _CR_TOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME,
-    };
-    const char * pubDeactivateTopics[ _CR_PUB_TOPIC_COUNT ] =
+        IotLogError( "Failed to schedule CDF response timeout, error %s.",
+                     IotTaskPool_strerror( taskPoolStatus ) );
+        prvCDF_FailRotation();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Publish the request for the current rotation step.
+ *
+ * The request is published without waiting; its response is delivered on the
+ * result topic and the retry is driven by the timeout job.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ */
+static void prvCDF_SendRequest( void )
+{
+    int pubPayloadLen = 0;
+    char * pcPublishPayload;
+    IotMqttError_t publishStatus;
+    IotMqttPublishInfo_t publishInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
+    cdf_Api_t * cdfApi = &( xCDF_Agent.xCdfApi );
+
+    if( xCDF_Agent.ulAttempts >= _CR_MAX_REQUEST_ATTEMPTS )
     {
-       _CR_TOPIC_PREFIX "/detach/" clientcredentialIOT_THING_NAME,
-    };
+        prvCDF_FailRotation();
+        return;
+    }
 
+    xCDF_Agent.ulAttempts++;
+    IotLogInfo( "CDF rotation step %d: attempt = %u",
+                xCDF_Agent.eAction,
+                ( unsigned ) xCDF_Agent.ulAttempts );
 
-    for (mqtt_get_cert_attempts = 0; 
-         mqtt_get_cert_attempts < _MAX_MQTT_GET_CERT_ATTEMPTS &&
-         status != EXIT_SUCCESS; 
-         mqtt_get_cert_attempts++)
+    /* The payload only lives until IotMqtt_Publish has serialized it, so it is
+     * allocated here rather than held on a stack or in the agent context. */
+    pcPublishPayload = pvPortMalloc( _PUBLISH_PAYLOAD_BUFFER_LENGTH );
+
+    if( pcPublishPayload == NULL )
+    {
+        IotLogError( "prvCDF_SendRequest: no memory for PUBLISH payload." );
+    }
+    else if( xCDF_Agent.eAction == CDF_CR_GET_CERT )
     {
+        pubPayloadLen = snprintf( pcPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
+                                  "{\"csr\": \"%s\", \"autoActivate\": %s}",
+                                  cdfApi->xGetCSR(),
+                                  ( cdfconfigPIPELINED_ROTATION != 0 ) ? "true" : "false" );
+    }
+    else if( xCDF_Agent.eAction == CDF_CR_ACK_CERT )
+    {
+        pubPayloadLen = snprintf( pcPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
+                                  "{\"newCertificateId\": \"%s\"}",
+                                  cdfApi->xGetNewCertificateId() );
+    }
+    else
+    {
+        pubPayloadLen = snprintf( pcPublishPayload, _PUBLISH_PAYLOAD_BUFFER_LENGTH,
+                                  "{\"oldCertificateId\": \"%s\"}",
+                                  cdfApi->xGetOldCertificateId() );
+    }
 
-        /* Mark the MQTT connection as established. */
-        if (xCDF_Agent.eState == eCDF_AgentState_GetCert)
-        {
-            IotLogInfo( "cdf_GetNewCert: CDF_CR_GET_CERT: attempt = %d", mqtt_get_cert_attempts);
-            cdfCrAction = CDF_CR_GET_CERT;
-
-            /* Get the new cert */
-            status =  cdf_CertRotateAction(
-                        mqttConnection,
-                        subGetTopics,
-                        pubGetTopics,
-                        cdfApi,
-                        &cdfCrAction);
-        }
-        else if (xCDF_Agent.eState == eCDF_AgentState_AckCert)
+    if( ( pubPayloadLen <= 0 ) || ( pubPayloadLen >= _PUBLISH_PAYLOAD_BUFFER_LENGTH ) )
+    {
+        IotLogError( "prvCDF_SendRequest: Failed to generate MQTT PUBLISH payload." );
+    }
+    else
+    {
+        publishInfo.qos = IOT_MQTT_QOS_1;
+        publishInfo.retryMs = _PUBLISH_RETRY_MS;
+        publishInfo.retryLimit = _PUBLISH_RETRY_LIMIT;
+        publishInfo.pTopicName = prvCDF_RequestTopic( xCDF_Agent.eAction );
+        publishInfo.topicNameLength = ( uint16_t ) strlen( publishInfo.pTopicName );
+        publishInfo.pPayload = pcPublishPayload;
+        publishInfo.payloadLength = ( size_t ) pubPayloadLen;
+
+        publishStatus = IotMqtt_Publish( xCDF_Agent.pMqttConnection,
+                                         &publishInfo,
+                                         0,
+                                         NULL,
+                                         NULL );
+
+        if( ( publishStatus != IOT_MQTT_STATUS_PENDING ) && ( publishStatus != IOT_MQTT_SUCCESS ) )
         {
-            IotLogInfo( "cdf_GetNewCert: CDF_CR_ACK_CERT: attempt = %d", mqtt_get_cert_attempts);
-            /* Acknowledge the new cert */
-            cdfCrAction = CDF_CR_ACK_CERT;
-            status =  cdf_CertRotateAction(
-                        mqttConnection,
-                        subAckTopics,
-                        pubAckTopics,
-                        cdfApi,
-                        &cdfCrAction);
+            IotLogError( "prvCDF_SendRequest: MQTT PUBLISH returned error %s.",
+                         IotMqtt_strerror( publishStatus ) );
+            xCDF_Agent.xStatistics.ulCDF_PublishFailures++;
         }
-        else if (xCDF_Agent.eState == eCDF_AgentState_DeactivateCert)
+    }
+
+    vPortFree( pcPublishPayload );
+
+    /* A failed publish is retried through the same timeout as a lost response. */
+    xCDF_Agent.xAwaitingResponse = true;
+    prvCDF_ArmTimeout( _CR_RESPONSE_TIMEOUT_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Record a completed rotation step and move on to the next one.
+ *
+ * Progress is persisted through xWriteCDFStateNVM so a reboot resumes from the
+ * step after the last acknowledged one.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ */
+static void prvCDF_CompleteStep( void )
+{
+    cdf_Api_t * cdfApi = &( xCDF_Agent.xCdfApi );
+
+    xCDF_Agent.xAwaitingResponse = false;
+    xCDF_Agent.ulAttempts = 0;
+    xCDF_Agent.xStatistics.ulCDF_PacketsProcessed++;
+
+    switch( xCDF_Agent.eAction )
+    {
+        case CDF_CR_GET_CERT:
+
+            if( xCDF_Agent.xNewCertActivated == false )
+            {
+                ( void ) cdfApi->xWriteCDFStateNVM( CDF_STATE_ACK_CERT_ROTATE );
+                xCDF_Agent.eState = eCDF_AgentState_AckCert;
+                xCDF_Agent.eAction = CDF_CR_ACK_CERT;
+                prvCDF_SendRequest();
+                break;
+            }
+
+            /* The certificate was activated with the attach; there is no ACK. */
+            /* Falls through. */
+
+        case CDF_CR_ACK_CERT:
+
+            /* Deactivating the old certificate has to wait until the device
+             * has reconnected with the new one. */
+            ( void ) cdfApi->xWriteCDFStateNVM( CDF_STATE_DEACTIVATE_CERT );
+            xCDF_Agent.eState = eCDF_AgentState_DeactivateCert;
+            newCertInProgress = false;
+            break;
+
+        default:
+            ( void ) cdfApi->xWriteCDFStateNVM( CDF_STATE_FINISHED );
+            xCDF_Agent.eState = eCDF_AgentState_ShuttingDown;
+            newCertInProgress = false;
+            break;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a token from the retry bucket.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ *
+ * @param[out] pulWaitMs Time until the next token accrues, if none is left.
+ *
+ * @return true if a retry may be sent now.
+ */
+static bool prvCDF_TakeRetryToken( uint32_t * pulWaitMs )
+{
+    uint64_t ullNow = IotClock_GetTimeMs();
+    uint64_t ullAccrued = ( ullNow - xCDF_Agent.ullRetryRefillMs ) / cdfconfigRETRY_INTERVAL_MS;
+
+    if( xCDF_Agent.ulRetryTokens + ullAccrued >= cdfconfigRETRY_BURST )
+    {
+        /* A full bucket does not bank time. */
+        xCDF_Agent.ulRetryTokens = cdfconfigRETRY_BURST;
+        xCDF_Agent.ullRetryRefillMs = ullNow;
+    }
+    else
+    {
+        xCDF_Agent.ulRetryTokens += ( uint32_t ) ullAccrued;
+        xCDF_Agent.ullRetryRefillMs += ullAccrued * cdfconfigRETRY_INTERVAL_MS;
+    }
+
+    if( xCDF_Agent.ulRetryTokens == 0 )
+    {
+        *pulWaitMs = ( uint32_t ) ( xCDF_Agent.ullRetryRefillMs + cdfconfigRETRY_INTERVAL_MS - ullNow );
+
+        return false;
+    }
+
+    xCDF_Agent.ulRetryTokens--;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Deferred job run when a rotation request has not been answered in time.
+ */
+static void prvCDF_TimeoutJob( IotTaskPool_t pTaskPool,
+                               IotTaskPoolJob_t pJob,
+                               void * pContext )
+{
+    uint32_t ulWaitMs = 0;
+
+    ( void ) pTaskPool;
+    ( void ) pJob;
+    ( void ) pContext;
+
+    if( prvCDF_EnterCallback() == false )
+    {
+        return;
+    }
+
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+
+    /* A response may have raced with this job; the deadline tells a stale
+     * timeout apart from the one armed for the request now in flight. */
+    if( ( xCDF_Agent.xAwaitingResponse == true ) &&
+        ( IotClock_GetTimeMs() >= xCDF_Agent.ullResponseDeadlineMs ) )
+    {
+        IotLogWarn( "CDF rotation step %d: timed out waiting for response.", xCDF_Agent.eAction );
+
+        /* The last attempt fails the rotation without a token. A response
+         * that arrives while the retry is held back still completes the step. */
+        if( ( xCDF_Agent.ulAttempts < _CR_MAX_REQUEST_ATTEMPTS ) &&
+            ( prvCDF_TakeRetryToken( &ulWaitMs ) == false ) )
         {
-            IotLogInfo( "cdf_GetNewCert: CDF_CR_DEACTIVATE_CERT: attempt = %d", mqtt_get_cert_attempts);
-            /* Deactivate the old cert */
-            cdfCrAction = CDF_CR_DEACTIVATE_CERT;
-            status = cdf_CertRotateAction(
-                        mqttConnection,
-                        subDeactivateTopics,
-                        pubDeactivateTopics,
-                        cdfApi,
-                        &cdfCrAction);
+            IotLogWarn( "CDF rotation step %d: retry held back for %u ms.",
+                        xCDF_Agent.eAction,
+                        ( unsigned ) ulWaitMs );
+            prvCDF_ArmTimeout( ulWaitMs );
         }
         else
         {
-            IotLogInfo( "cdf_CertRotateAction in agent state %d Failed", xCDF_Agent.eState);
+            prvCDF_SendRequest();
         }
     }
-    return status;
+
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+    prvCDF_LeaveCallback();
 }
 
+/*-----------------------------------------------------------*/
 
-/* NOTE: Task to process CDF Rotate Cert requests. */
+/**
+ * @brief Called by the MQTT library when the result topic SUBSCRIBE completes.
+ */
+static void _subscribeCompleteCallback( void * pCallbackContext,
+                                        IotMqttCallbackParam_t * pOperation )
+{
+    ( void ) pCallbackContext;
 
-static void prvCDF_RotateCertTask( void * pvUnused )
+    if( prvCDF_EnterCallback() == false )
+    {
+        return;
+    }
+
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+
+    if( pOperation->u.operation.result == IOT_MQTT_SUCCESS )
+    {
+        IotLogInfo( "Subscribed to %s.", _CR_RESULT_TOPIC );
+        xCDF_Agent.xSubscribed = true;
+        prvCDF_SendRequest();
+    }
+    else
+    {
+        IotLogError( "Subscription to %s failed, error %s.",
+                     _CR_RESULT_TOPIC,
+                     IotMqtt_strerror( pOperation->u.operation.result ) );
+        prvCDF_FailRotation();
+    }
+
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+    prvCDF_LeaveCallback();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Called by the MQTT library when an incoming PUBLISH message is received.
+ *
+ * Acknowledges the message to the server, then hands the payload to the rotation
+ * step that is waiting for it.
+ *
+ * @param[in] pCallbackContext Unused.
+ * @param[in] pPublish Information about the incoming PUBLISH message passed by
+ * the MQTT library.
+ */
+static void _mqttSubscriptionCallback( void * pCallbackContext,
+                                       IotMqttCallbackParam_t * const pPublish )
 {
-    static TaskHandle_t handle;
-    BaseType_t taskRet;
+    int payload_len = pPublish->u.message.info.payloadLength;
+    char * pPayload = ( char * ) pPublish->u.message.info.pPayload;
+    IotMqttPublishInfo_t acknowledgementInfo = IOT_MQTT_PUBLISH_INFO_INITIALIZER;
+    IotMqttError_t pubStatus;
 
-    IotLogInfo( "prvCDF_RotateCertTask Started");
-    newCertInProgress = false;
+    ( void ) pCallbackContext;
+
+    if( prvCDF_EnterCallback() == false )
+    {
+        return;
+    }
+
+    IotLogInfo( "Incoming PUBLISH received on %.*s, payload length %d.",
+                pPublish->u.message.info.topicNameLength,
+                pPublish->u.message.info.pTopicName,
+                payload_len );
+
+    /* Set the members of the publish info for the acknowledgement message. */
+    acknowledgementInfo.qos = IOT_MQTT_QOS_1;
+    acknowledgementInfo.pTopicName = _ACKNOWLEDGEMENT_TOPIC_NAME;
+    acknowledgementInfo.topicNameLength = _ACKNOWLEDGEMENT_TOPIC_NAME_LENGTH;
+    acknowledgementInfo.pPayload = "";
+    acknowledgementInfo.payloadLength = 0;
+    acknowledgementInfo.retryMs = _PUBLISH_RETRY_MS;
+    acknowledgementInfo.retryLimit = _PUBLISH_RETRY_LIMIT;
+
+    /* Do not wait for the PUBACK; this callback runs on a shared task pool thread. */
+    pubStatus = IotMqtt_Publish( pPublish->mqttConnection,
+                                 &acknowledgementInfo,
+                                 0,
+                                 NULL,
+                                 NULL );
 
-    /* Put the CDF agent in the ready state. */
-    xCDF_Agent.eState = eCDF_AgentState_Ready;
-    if ( (xCDF_Agent.xCdfApi.xReadCDFStateNVM)() == CDF_STATE_WAIT_FOR_CERT_ROTATE ) 
+    if( ( pubStatus != IOT_MQTT_STATUS_PENDING ) && ( pubStatus != IOT_MQTT_SUCCESS ) )
     {
-        // xSemaphoreTake(xCDF_Agent.xStartCertRotateSemaphore, portMAX_DELAY); 
+        IotLogWarn( "Acknowledgment message for PUBLISH will NOT be sent: %s.",
+                    IotMqtt_strerror( pubStatus ) );
+    }
+
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
 
-        xCDF_Agent.eState = eCDF_AgentState_GetCert;
-        IotLogInfo( "CDF Get Cert GET");
+    xCDF_Agent.xStatistics.ulCDF_PacketsReceived++;
 
-        if (cdf_GetNewCert( xCDF_Agent.pMqttConnection ) == EXIT_SUCCESS)
+    if( xCDF_Agent.xAwaitingResponse == true )
+    {
+        if( processPayload( pPayload,
+                            ( size_t ) payload_len,
+                            xCDF_Agent.eAction,
+                            &( xCDF_Agent.xCdfApi ),
+                            &( xCDF_Agent.xNewCertActivated ) ) == IOT_MQTT_SUCCESS )
         {
-            xCDF_Agent.eState = eCDF_AgentState_AckCert;
+            prvCDF_CancelJob( xCDF_Agent.xTimeoutJob, "timeout" );
+            prvCDF_CompleteStep();
         }
         else
         {
-            xCDF_Agent.eState = eCDF_AgentState_NotReady;
+            /* Leave the step in flight; the timeout job re-sends the request. */
+            IotLogWarn( "CDF rotation step %d: unusable response.", xCDF_Agent.eAction );
         }
     }
-    else if (( (xCDF_Agent.xCdfApi.xReadCDFStateNVM)() == CDF_STATE_ACK_CERT_ROTATE ))
+    else
     {
-        xCDF_Agent.eState = eCDF_AgentState_AckCert;
-        IotLogInfo( "CDF Get Cert ACK");
+        xCDF_Agent.xStatistics.ulCDF_PacketsDropped++;
+    }
 
-        if (cdf_GetNewCert( xCDF_Agent.pMqttConnection ) == EXIT_SUCCESS)
-        {
-            xCDF_Agent.eState = eCDF_AgentState_DeactivateCert;
-        }
-        else
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+    prvCDF_LeaveCallback();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Task pool job that begins (or resumes) the rotation.
+ *
+ * Subscribes once to the result topic; the subscription is kept for every
+ * rotation step until CDF_AgentShutdown.
+ */
+static void prvCDF_StartJob( IotTaskPool_t pTaskPool,
+                             IotTaskPoolJob_t pJob,
+                             void * pContext )
+{
+    IotMqttError_t subscriptionStatus;
+    IotMqttSubscription_t subscription = IOT_MQTT_SUBSCRIPTION_INITIALIZER;
+    IotMqttCallbackInfo_t subscribeComplete = IOT_MQTT_CALLBACK_INFO_INITIALIZER;
+
+    ( void ) pTaskPool;
+    ( void ) pJob;
+    ( void ) pContext;
+
+    if( prvCDF_EnterCallback() == false )
+    {
+        return;
+    }
+
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+
+    if( xCDF_Agent.xSubscribed == true )
+    {
+        prvCDF_SendRequest();
+    }
+    else
+    {
+        subscription.qos = IOT_MQTT_QOS_1;
+        subscription.pTopicFilter = _CR_RESULT_TOPIC;
+        subscription.topicFilterLength = _CR_RESULT_TOPIC_LENGTH;
+        subscription.callback.pCallbackContext = NULL;
+        subscription.callback.function = _mqttSubscriptionCallback;
+
+        subscribeComplete.function = _subscribeCompleteCallback;
+
+        subscriptionStatus = IotMqtt_Subscribe( xCDF_Agent.pMqttConnection,
+                                                &subscription,
+                                                _CR_SUB_TOPIC_COUNT,
+                                                0,
+                                                &subscribeComplete,
+                                                NULL );
+
+        if( subscriptionStatus != IOT_MQTT_STATUS_PENDING )
         {
-            xCDF_Agent.eState = eCDF_AgentState_NotReady;
+            IotLogError( "Failed to subscribe to %s, error %s.",
+                         _CR_RESULT_TOPIC,
+                         IotMqtt_strerror( subscriptionStatus ) );
+            prvCDF_FailRotation();
         }
     }
+
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+    prvCDF_LeaveCallback();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Schedule the rotation to start from the current agent state.
+ *
+ * @return pdTRUE if the start job was scheduled.
+ */
+static BaseType_t prvCDF_ScheduleRotation( void )
+{
+    BaseType_t xReturn = pdFALSE;
+    IotTaskPoolError_t taskPoolStatus;
+
+    switch( xCDF_Agent.eState )
+    {
+        case eCDF_AgentState_GetCert:
+            xCDF_Agent.eAction = CDF_CR_GET_CERT;
+            break;
+
+        case eCDF_AgentState_AckCert:
+            xCDF_Agent.eAction = CDF_CR_ACK_CERT;
+            break;
+
+        default:
+            xCDF_Agent.eAction = CDF_CR_DEACTIVATE_CERT;
+            break;
+    }
+
+    xCDF_Agent.ulAttempts = 0;
+    newCertInProgress = true;
+
+    taskPoolStatus = IotTaskPool_CreateJob( prvCDF_StartJob,
+                                            NULL,
+                                            &( xCDF_Agent.xStartJobStorage ),
+                                            &( xCDF_Agent.xStartJob ) );
+
+    if( taskPoolStatus == IOT_TASKPOOL_SUCCESS )
+    {
+        taskPoolStatus = IotTaskPool_Schedule( IOT_SYSTEM_TASKPOOL, xCDF_Agent.xStartJob, 0 );
+    }
+
+    if( taskPoolStatus == IOT_TASKPOOL_SUCCESS )
+    {
+        xReturn = pdTRUE;
+    }
     else
     {
-        xCDF_Agent.eState = eCDF_AgentState_DeactivateCert;
-        IotLogInfo( "CDF Get Cert DEACTIVATE");
+        IotLogError( "Failed to schedule CDF rotation, error %s.",
+                     IotTaskPool_strerror( taskPoolStatus ) );
+        xCDF_Agent.eState = eCDF_AgentState_NotReady;
+        newCertInProgress = false;
+    }
+
+    return xReturn;
+}
 
-        if (cdf_GetNewCert( xCDF_Agent.pMqttConnection ) == EXIT_SUCCESS)
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Convert an X.509 time to seconds since the epoch.
+ *
+ * @return The time, or 0 if it does not fit in 32 bits.
+ */
+static uint32_t prvCDF_X509TimeToUtc( const mbedtls_x509_time * pxTime )
+{
+    /* Days from civil date, with March as the first month of the year. */
+    int64_t llYear = ( int64_t ) pxTime->year - ( ( pxTime->mon <= 2 ) ? 1 : 0 );
+    int64_t llEra = llYear / 400;
+    int64_t llYearOfEra = llYear - llEra * 400;
+    int64_t llDayOfYear = ( 153 * ( pxTime->mon + ( ( pxTime->mon > 2 ) ? -3 : 9 ) ) + 2 ) / 5 + pxTime->day - 1;
+    int64_t llDayOfEra = llYearOfEra * 365 + llYearOfEra / 4 - llYearOfEra / 100 + llDayOfYear;
+    int64_t llDays = llEra * 146097 + llDayOfEra - 719468;
+    int64_t llSeconds = llDays * 86400 + pxTime->hour * 3600 + pxTime->min * 60 + pxTime->sec;
+
+    if( ( llSeconds <= 0 ) || ( llSeconds > ( int64_t ) UINT32_MAX ) )
+    {
+        return 0;
+    }
+
+    return ( uint32_t ) llSeconds;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Work out when this Thing rotates its certificate.
+ *
+ * The offset inside the rotation window is a hash of the Thing name, so it is
+ * spread across the fleet and stays the same across reboots.
+ *
+ * @return The rotation time in seconds since the epoch, or 0 if the device
+ * certificate has no usable notAfter.
+ */
+static uint32_t prvCDF_ComputeRotationTime( void )
+{
+    mbedtls_x509_crt xCertificate;
+    const char * pcCertificate = NULL;
+    uint32_t ulNotAfter = 0;
+    uint32_t ulHash = 2166136261UL;
+    const uint8_t * pucName;
+    int64_t llRotationTime;
+
+    if( xCDF_Agent.xCdfApi.xGetDeviceCert != NULL )
+    {
+        pcCertificate = xCDF_Agent.xCdfApi.xGetDeviceCert();
+    }
+
+    if( pcCertificate == NULL )
+    {
+        return 0;
+    }
+
+    mbedtls_x509_crt_init( &xCertificate );
+
+    /* PEM input is parsed with its zero terminator. */
+    if( mbedtls_x509_crt_parse( &xCertificate,
+                                ( const unsigned char * ) pcCertificate,
+                                strlen( pcCertificate ) + 1 ) == 0 )
+    {
+        ulNotAfter = prvCDF_X509TimeToUtc( &( xCertificate.valid_to ) );
+    }
+
+    mbedtls_x509_crt_free( &xCertificate );
+
+    if( ulNotAfter == 0 )
+    {
+        IotLogWarn( "CDF: no expiry in the device certificate, rotation is not scheduled." );
+        return 0;
+    }
+
+    /* FNV-1a of the Thing name. */
+    for( pucName = xCDF_Agent.pcThingName; *pucName != '\0'; pucName++ )
+    {
+        ulHash = ( ulHash ^ *pucName ) * 16777619UL;
+    }
+
+    llRotationTime = ( int64_t ) ulNotAfter -
+                     ( int64_t ) cdfconfigROTATE_BEFORE_EXPIRY_SECONDS -
+                     ( int64_t ) cdfconfigROTATION_WINDOW_SECONDS;
+
+    if( cdfconfigROTATION_WINDOW_SECONDS > 0UL )
+    {
+        llRotationTime += ulHash % cdfconfigROTATION_WINDOW_SECONDS;
+    }
+
+    /* A certificate already inside its window rotates as soon as the time is known. */
+    if( llRotationTime < 1 )
+    {
+        llRotationTime = 1;
+    }
+
+    return ( uint32_t ) llRotationTime;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Schedule the rotation job at the rotation time, or at the next clock
+ * check if that is sooner.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ */
+static void prvCDF_ArmRotationJob( void )
+{
+    uint32_t ulNow = cdfconfigGET_UTC_SECONDS();
+    uint32_t ulDelaySeconds = _CR_EXPIRY_CHECK_MAX_SECONDS;
+    IotTaskPoolError_t taskPoolStatus;
+
+    if( ulNow == 0UL )
+    {
+        /* Time unknown; check again later. */
+    }
+    else if( ulNow >= xCDF_Agent.ulRotationTime )
+    {
+        ulDelaySeconds = 0;
+    }
+    else if( xCDF_Agent.ulRotationTime - ulNow < _CR_EXPIRY_CHECK_MAX_SECONDS )
+    {
+        ulDelaySeconds = xCDF_Agent.ulRotationTime - ulNow;
+    }
+
+    /* The job storage is reused, so an earlier check must not still be
+     * waiting in the task pool. */
+    prvCDF_CancelJob( xCDF_Agent.xRotationJob, "rotation" );
+
+    taskPoolStatus = IotTaskPool_CreateJob( prvCDF_RotationJob,
+                                            NULL,
+                                            &( xCDF_Agent.xRotationJobStorage ),
+                                            &( xCDF_Agent.xRotationJob ) );
+
+    if( taskPoolStatus == IOT_TASKPOOL_SUCCESS )
+    {
+        taskPoolStatus = IotTaskPool_ScheduleDeferred( IOT_SYSTEM_TASKPOOL,
+                                                       xCDF_Agent.xRotationJob,
+                                                       ulDelaySeconds * 1000UL );
+    }
+
+    if( taskPoolStatus != IOT_TASKPOOL_SUCCESS )
+    {
+        IotLogError( "CDF: failed to schedule the rotation job, error %s.",
+                     IotTaskPool_strerror( taskPoolStatus ) );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Rotation job; starts the rotation once its time has come.
+ *
+ * It runs in the task pool rather than the timer daemon because it takes the
+ * state lock and writes the NVM.
+ */
+static void prvCDF_RotationJob( IotTaskPool_t pTaskPool,
+                                IotTaskPoolJob_t pJob,
+                                void * pContext )
+{
+    uint32_t ulNow = cdfconfigGET_UTC_SECONDS();
+
+    ( void ) pTaskPool;
+    ( void ) pJob;
+    ( void ) pContext;
+
+    if( prvCDF_EnterCallback() == false )
+    {
+        return;
+    }
+
+    IotMutex_Lock( &( xCDF_Agent.xStateLock ) );
+
+    if( xCDF_Agent.ulRotationTime != 0UL )
+    {
+        if( ( ulNow == 0UL ) || ( ulNow < xCDF_Agent.ulRotationTime ) )
         {
-            xCDF_Agent.eState = eCDF_AgentState_ShuttingDown;
+            prvCDF_ArmRotationJob();
+        }
+        else if( ( xCDF_Agent.eState == eCDF_AgentState_Ready ) && ( newCertInProgress == false ) )
+        {
+            IotLogInfo( "CDF: device certificate is due for rotation." );
+            xCDF_Agent.ulRotationTime = 0;
+
+            /* Persisted first, so a reboot resumes the rotation. */
+            ( void ) xCDF_Agent.xCdfApi.xWriteCDFStateNVM( CDF_STATE_WAIT_FOR_CERT_ROTATE );
+            xCDF_Agent.eState = eCDF_AgentState_GetCert;
+            ( void ) prvCDF_ScheduleRotation();
         }
         else
         {
-            xCDF_Agent.eState = eCDF_AgentState_NotReady;
+            /* A rotation started by a job is running; it replaces the certificate. */
+            xCDF_Agent.ulRotationTime = 0;
         }
     }
 
-    vTaskDelete( NULL );
+    IotMutex_Unlock( &( xCDF_Agent.xStateLock ) );
+    prvCDF_LeaveCallback();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Schedule the rotation from the expiry of the device certificate.
+ *
+ * The rotation time is always computed, but the rotation job is only started
+ * when the application configured a UTC clock with cdfconfigGET_UTC_SECONDS.
+ *
+ * Must be called with xCDF_Agent.xStateLock held.
+ */
+static void prvCDF_ScheduleExpiryRotation( void )
+{
+    xCDF_Agent.ulRotationTime = prvCDF_ComputeRotationTime();
+
+    if( xCDF_Agent.ulRotationTime == 0UL )
+    {
+        return;
+    }
+
+    #if ( _CR_HAVE_UTC_CLOCK == 0 )
+        IotLogWarn( "CDF: cdfconfigGET_UTC_SECONDS is not configured; "
+                    "rotation at %u (UTC seconds) is not started.",
+                    ( unsigned ) xCDF_Agent.ulRotationTime );
+    #else
+        IotLogInfo( "CDF: rotation scheduled at %u (UTC seconds).", ( unsigned ) xCDF_Agent.ulRotationTime );
+        prvCDF_ArmRotationJob();
+    #endif
 }
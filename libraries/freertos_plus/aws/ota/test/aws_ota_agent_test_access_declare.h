@@ -51,4 +51,40 @@ DocParseErr_t TEST_OTA_prvParseJSONbyModel( const char * pcJSON,
                                             uint32_t ulMsgLen,
                                             JSON_DocModel_t * pxDocModel );
 
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+    void TEST_OTA_prvWindowReset( OTA_StreamWindow_t * pxWindow );
+
+    bool_t TEST_OTA_prvWindowNextRange( OTA_StreamWindow_t * pxWindow,
+                                        const uint8_t * pucBlockBitmap,
+                                        uint32_t ulBitmapLen,
+                                        uint32_t * pulFirstByte,
+                                        uint32_t * pulNumBytes,
+                                        uint32_t * pulNumBlocks );
+
+    void TEST_OTA_prvWindowBlockReceived( OTA_StreamWindow_t * pxWindow,
+                                          uint32_t ulBlockIndex,
+                                          bool_t xDuplicate );
+
+    void TEST_OTA_prvWindowTimeout( OTA_StreamWindow_t * pxWindow );
+#endif
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+    void TEST_OTA_prvSigVerifyStart( OTA_FileContext_t * C );
+
+    void TEST_OTA_prvSigVerifyBlock( OTA_FileContext_t * C,
+                                     uint32_t ulBlockIndex,
+                                     const uint8_t * pucData,
+                                     uint32_t ulBlockSize );
+
+    void TEST_OTA_prvSigVerifyStop( OTA_FileContext_t * C );
+#endif
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+    void TEST_OTA_prvSaveCheckpoint( OTA_FileContext_t * C );
+
+    void TEST_OTA_prvLoadCheckpoint( OTA_FileContext_t * C );
+
+    void TEST_OTA_prvDeleteCheckpoint( OTA_FileContext_t * C );
+#endif
+
 #endif /* ifndef _AWS_OTA_AGENT_TEST_ACCESS_DECLARE_H_ */
@@ -65,7 +65,93 @@ DocParseErr_t TEST_OTA_prvParseJSONbyModel( const char * pcJSON,
                                             uint32_t ulMsgLen,
                                             JSON_DocModel_t * pxDocModel )
 {
-    return prvParseJSONbyModel( pcJSON, ulMsgLen, pxDocModel );
+    return JSON_ParseByModel( pcJSON, ulMsgLen, pxDocModel );
 }
 
+/*-----------------------------------------------------------*/
+
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+    void TEST_OTA_prvWindowReset( OTA_StreamWindow_t * pxWindow )
+    {
+        prvWindowReset( pxWindow );
+    }
+
+/*-----------------------------------------------------------*/
+
+    bool_t TEST_OTA_prvWindowNextRange( OTA_StreamWindow_t * pxWindow,
+                                        const uint8_t * pucBlockBitmap,
+                                        uint32_t ulBitmapLen,
+                                        uint32_t * pulFirstByte,
+                                        uint32_t * pulNumBytes,
+                                        uint32_t * pulNumBlocks )
+    {
+        return prvWindowNextRange( pxWindow, pucBlockBitmap, ulBitmapLen, pulFirstByte, pulNumBytes, pulNumBlocks );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvWindowBlockReceived( OTA_StreamWindow_t * pxWindow,
+                                          uint32_t ulBlockIndex,
+                                          bool_t xDuplicate )
+    {
+        prvWindowBlockReceived( pxWindow, ulBlockIndex, xDuplicate );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvWindowTimeout( OTA_StreamWindow_t * pxWindow )
+    {
+        prvWindowTimeout( pxWindow );
+    }
+#endif /* if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+    void TEST_OTA_prvSigVerifyStart( OTA_FileContext_t * C )
+    {
+        prvSigVerifyStart( C );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvSigVerifyBlock( OTA_FileContext_t * C,
+                                     uint32_t ulBlockIndex,
+                                     const uint8_t * pucData,
+                                     uint32_t ulBlockSize )
+    {
+        prvSigVerifyBlock( C, ulBlockIndex, pucData, ulBlockSize );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvSigVerifyStop( OTA_FileContext_t * C )
+    {
+        prvSigVerifyStop( C );
+    }
+#endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+/*-----------------------------------------------------------*/
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+    void TEST_OTA_prvSaveCheckpoint( OTA_FileContext_t * C )
+    {
+        prvSaveCheckpoint( C );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvLoadCheckpoint( OTA_FileContext_t * C )
+    {
+        prvLoadCheckpoint( C );
+    }
+
+/*-----------------------------------------------------------*/
+
+    void TEST_OTA_prvDeleteCheckpoint( OTA_FileContext_t * C )
+    {
+        prvDeleteCheckpoint( C );
+    }
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
+
 #endif /* _AWS_OTA_AGENT_TEST_ACCESS_DEFINE_H_ */
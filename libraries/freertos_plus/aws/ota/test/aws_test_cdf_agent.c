@@ -0,0 +1,887 @@
+/*
+ * Amazon FreeRTOS CDF V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_test_cdf_agent.c
+ * @brief Tests for the CDF certificate rotation agent.
+ *
+ * The agent runs against a broker stand-in: a fake network interface that
+ * answers every request the way the certificate rotation lambda does, so the
+ * measured latency is the device-side cost of a rotation.
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+/* Standard includes. */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* SDK initialization include. */
+#include "iot_init.h"
+
+/* MQTT internal include. */
+#include "private/iot_mqtt_internal.h"
+
+/* Platform layer includes. */
+#include "platform/iot_clock.h"
+#include "platform/iot_threads.h"
+
+/* CDF agent includes. */
+#include "aws_iot_ota_agent.h"
+#include "iot_cdf_agent.h"
+#include "aws_clientcredential.h"
+
+/* Test framework includes. */
+#include "unity_fixture.h"
+
+/* MQTT test access include. */
+#include "iot_test_access_mqtt.h"
+
+/**
+ * @brief Configuration for this test group.
+ */
+#define cdftestROTATION_COUNT          ( 5 )
+#define cdftestMAX_ROTATION_MS         ( 500 )
+#define cdftestSTATE_WAIT_MS           ( 5000 )
+#define cdftestPOLL_MS                 ( 1 )
+#define cdftestRX_BUFFER_SIZE          ( 4096 )
+#define cdftestRESPONSE_BUFFER_SIZE    ( 2048 )
+
+/*
+ * Topics the agent publishes its requests to and receives responses on.
+ */
+#define cdftestTOPIC_PREFIX            "certificate/rotation"
+#define cdftestRESULT_TOPIC            cdftestTOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME
+#define cdftestATTACH_TOPIC            cdftestTOPIC_PREFIX "/attach/" clientcredentialIOT_THING_NAME
+#define cdftestACTIVATE_TOPIC          cdftestTOPIC_PREFIX "/activate/" clientcredentialIOT_THING_NAME
+#define cdftestDETACH_TOPIC            cdftestTOPIC_PREFIX "/detach/" clientcredentialIOT_THING_NAME
+
+/*
+ * Certificate IDs returned by the broker stand-in. Real IDs are 64 hex digits.
+ */
+#define cdftestNEW_CERT_ID             "1111111111111111111111111111111111111111111111111111111111111111"
+#define cdftestOLD_CERT_ID             "2222222222222222222222222222222222222222222222222222222222222222"
+
+/**
+ * @brief The attach response, in the format published by the rotation lambda.
+ */
+#define cdftestATTACH_RESPONSE                                                           \
+    "{\"newCertificateArn\": \"arn:aws:iot:us-east-1:123456789012:cert/" cdftestNEW_CERT_ID "\", " \
+    "\"newCertificateId\": \"" cdftestNEW_CERT_ID "\", "                                 \
+    "\"newCertificatePem\": \"-----BEGIN CERTIFICATE-----\\n"                            \
+    "MIIBszCCAVmgAwIBAgIUYmVuY2htYXJrIGNlcnRpZmljYXRlMAoGCCqGSM49BAMC\\n"                \
+    "-----END CERTIFICATE-----\\n\", "                                                   \
+    "\"oldCertificateId\": \"" cdftestOLD_CERT_ID "\"}"
+
+/**
+ * @brief The attach response of a lambda that activated the new certificate.
+ */
+#define cdftestATTACH_ACTIVATED_RESPONSE                                                 \
+    "{\"newCertificateId\": \"" cdftestNEW_CERT_ID "\", "                                 \
+    "\"newCertificatePem\": \"-----BEGIN CERTIFICATE-----\\n"                            \
+    "MIIBszCCAVmgAwIBAgIUYmVuY2htYXJrIGNlcnRpZmljYXRlMAoGCCqGSM49BAMC\\n"                \
+    "-----END CERTIFICATE-----\\n\", "                                                   \
+    "\"oldCertificateId\": \"" cdftestOLD_CERT_ID "\", "                                 \
+    "\"activated\": true}"
+
+/**
+ * @brief The certificate in the attach response, as the agent should store it.
+ */
+#define cdftestNEW_CERT_PEM                                                  \
+    "-----BEGIN CERTIFICATE-----\n"                                          \
+    "MIIBszCCAVmgAwIBAgIUYmVuY2htYXJrIGNlcnRpZmljYXRlMAoGCCqGSM49BAMC\n"     \
+    "-----END CERTIFICATE-----\n"
+
+/**
+ * @brief A device certificate that expires on 2030-01-01 00:00:00 UTC.
+ */
+#define cdftestDEVICE_CERT_PEM                                               \
+    "-----BEGIN CERTIFICATE-----\n"                                          \
+    "MIIBDTCBtAIBATAKBggqhkjOPQQDAjATMREwDwYDVQQDDAhjZGYtdGVzdDAeFw0y\n"     \
+    "MDAxMDEwMDAwMDBaFw0zMDAxMDEwMDAwMDBaMBMxETAPBgNVBAMMCGNkZi10ZXN0\n"     \
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAEqk7sfmKToZQUGKatf+Yy8smIAW4s\n"     \
+    "Ta/fhDJKpepo5d8eTCCrlVEP0BdijNWFq48434zyZLgt91Pr0e6WQhtmBzAKBggq\n"     \
+    "hkjOPQQDAgNIADBFAiEAlxwxCtUtdLL/87AgEQWeAVPvMOavxnDbPn8knaYOXrkC\n"     \
+    "IAS5mwEOAUMOwVna9bAgMmiZa7lzaUtEB96pY1RMbVuV\n"                         \
+    "-----END CERTIFICATE-----\n"
+#define cdftestDEVICE_CERT_NOT_AFTER    ( 1893456000UL )
+
+/**
+ * @brief The activate and detach responses.
+ */
+#define cdftestACTIVATE_RESPONSE    "\"certificate " cdftestNEW_CERT_ID " was set as active\""
+#define cdftestDETACH_RESPONSE      "\"certificate " cdftestOLD_CERT_ID " was deactivated\""
+
+/**
+ * @brief A rotation job as the jobs service notifies it, with the rotation
+ * members in the job document and each step in its own object.
+ */
+#define cdftestROTATION_JOB_NOTIFICATION                                      \
+    "{\"clientToken\":\"cdf-test\",\"timestamp\":1577836800,"                 \
+    "\"execution\":{\"jobId\":\"cdf-rotate-1\",\"status\":\"QUEUED\","           \
+    "\"queuedAt\":1577836800,\"versionNumber\":1,\"executionNumber\":1,"       \
+    "\"jobDocument\":{\"operation\":\"RotateCertificates\","                    \
+    "\"get\":{\"subscribe\":\"cdf/certificates/{thingName}/get/+\","            \
+    "\"publish\":\"cdf/certificates/{thingName}/get\"},"                        \
+    "\"ack\":{\"subscribe\":\"cdf/certificates/{thingName}/ack/+\","            \
+    "\"publish\":\"cdf/certificates/{thingName}/ack\"}}}}"
+
+/**
+ * @brief A custom job that is not a rotation job.
+ */
+#define cdftestOTHER_JOB_NOTIFICATION                                         \
+    "{\"clientToken\":\"cdf-test\",\"timestamp\":1577836800,"                 \
+    "\"execution\":{\"jobId\":\"reboot-1\",\"status\":\"QUEUED\","              \
+    "\"jobDocument\":{\"operation\":\"Reboot\","                                \
+    "\"get\":{\"subscribe\":\"cdf/certificates/{thingName}/get/+\","            \
+    "\"publish\":\"cdf/certificates/{thingName}/get\"}}}}"
+
+/*
+ * MQTT control packet types seen by the broker stand-in.
+ */
+#define cdftestMQTT_PUBLISH         ( 0x30 )
+#define cdftestMQTT_PUBACK          ( 0x40 )
+#define cdftestMQTT_SUBSCRIBE       ( 0x82 )
+#define cdftestMQTT_SUBACK          ( 0x90 )
+#define cdftestMQTT_UNSUBSCRIBE     ( 0xa2 )
+#define cdftestMQTT_UNSUBACK        ( 0xb0 )
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The custom job callback the agent gives the OTA agent.
+ */
+extern OTA_JobParseErr_t prvCDF_CertRotateCallback( const char * pcJSON,
+                                                    uint32_t ulMsgLen );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Network info and interface of the broker stand-in.
+ */
+static IotMqttNetworkInfo_t _networkInfo = IOT_MQTT_NETWORK_INFO_INITIALIZER;
+static IotNetworkInterface_t _networkInterface = { 0 };
+
+/**
+ * @brief The MQTT connection the agent runs on.
+ */
+static _mqttConnection_t * _pMqttConnection = NULL;
+
+/**
+ * @brief Bytes queued by the broker stand-in for the MQTT library to receive.
+ */
+static uint8_t _rxBuffer[ cdftestRX_BUFFER_SIZE ];
+static size_t _rxHead = 0;
+static size_t _rxTail = 0;
+static IotMutex_t _rxLock;
+
+/**
+ * @brief Counts the packets waiting to be received; posted once per packet.
+ */
+static IotSemaphore_t _rxPackets;
+
+/**
+ * @brief Signals the receive thread to exit and waits for it to do so.
+ */
+static volatile bool _rxThreadStop = false;
+static IotSemaphore_t _rxThreadDone;
+
+/**
+ * @brief In-memory storage behind the stub CDF API.
+ */
+static CDF_STATE _nvmState = CDF_STATE_FINISHED;
+static char _tempCertificate[ 1300 ];
+static char _newCertificateId[ _CERTIFICATE_ID_LENGTH ];
+static char _oldCertificateId[ _CERTIFICATE_ID_LENGTH ];
+static char _csr[] = "-----BEGIN CERTIFICATE REQUEST-----\\n-----END CERTIFICATE REQUEST-----\\n";
+
+/**
+ * @brief Whether the broker stand-in activates the certificate with the
+ * attach, and how many activate requests it received.
+ */
+static volatile bool _autoActivate = false;
+static volatile uint32_t _activateRequests = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint8_t _writeState( CDF_STATE val )
+{
+    _nvmState = val;
+
+    return EXIT_SUCCESS;
+}
+
+static CDF_STATE _readState( void )
+{
+    return _nvmState;
+}
+
+static uint8_t _putTempCertificate( char * pcCert )
+{
+    ( void ) strncpy( _tempCertificate, pcCert, sizeof( _tempCertificate ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * _getTempCertificate( void )
+{
+    return _tempCertificate;
+}
+
+static char * _getDeviceCertificate( void )
+{
+    return cdftestDEVICE_CERT_PEM;
+}
+
+static char * _getCSR( void )
+{
+    return _csr;
+}
+
+static uint8_t _putNewCertificateId( char * pcId )
+{
+    ( void ) strncpy( _newCertificateId, pcId, sizeof( _newCertificateId ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * _getNewCertificateId( void )
+{
+    return _newCertificateId;
+}
+
+static uint8_t _putOldCertificateId( char * pcId )
+{
+    ( void ) strncpy( _oldCertificateId, pcId, sizeof( _oldCertificateId ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * _getOldCertificateId( void )
+{
+    return _oldCertificateId;
+}
+
+/**
+ * @brief The stub CDF API handed to the agent.
+ */
+static cdf_Api_t _cdfApi =
+{
+    .xWriteCDFStateNVM    = _writeState,
+    .xReadCDFStateNVM     = _readState,
+    .xPutTempDeviceCert   = _putTempCertificate,
+    .xGetTempDeviceCert   = _getTempCertificate,
+    .xGetDeviceCert       = _getDeviceCertificate,
+    .xGetCSR              = _getCSR,
+    .xPutNewCertificateId = _putNewCertificateId,
+    .xGetNewCertificateId = _getNewCertificateId,
+    .xPutOldCertificateId = _putOldCertificateId,
+    .xGetOldCertificateId = _getOldCertificateId,
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue one packet for the MQTT library to receive.
+ */
+static void _queuePacket( const uint8_t * pHeader,
+                          size_t headerLength,
+                          const uint8_t * pBody,
+                          size_t bodyLength )
+{
+    IotMutex_Lock( &_rxLock );
+
+    /* Restart at the front of the buffer once it has drained. */
+    if( _rxHead == _rxTail )
+    {
+        _rxHead = 0;
+        _rxTail = 0;
+    }
+
+    /* This runs on MQTT library threads, where a failed assertion cannot
+     * unwind the test; an overflow drops the packet and the agent's own
+     * timeout fails the test instead. */
+    if( _rxTail + headerLength + bodyLength > cdftestRX_BUFFER_SIZE )
+    {
+        IotMutex_Unlock( &_rxLock );
+
+        return;
+    }
+
+    ( void ) memcpy( _rxBuffer + _rxTail, pHeader, headerLength );
+    _rxTail += headerLength;
+
+    if( bodyLength > 0 )
+    {
+        ( void ) memcpy( _rxBuffer + _rxTail, pBody, bodyLength );
+        _rxTail += bodyLength;
+    }
+
+    IotMutex_Unlock( &_rxLock );
+
+    IotSemaphore_Post( &_rxPackets );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue an acknowledgement carrying a packet identifier.
+ */
+static void _queueAck( uint8_t packetType,
+                       uint16_t packetIdentifier,
+                       bool withReturnCode )
+{
+    uint8_t ack[ 5 ] = { 0 };
+
+    ack[ 0 ] = packetType;
+    ack[ 1 ] = withReturnCode ? 3 : 2;
+    ack[ 2 ] = ( uint8_t ) ( packetIdentifier >> 8 );
+    ack[ 3 ] = ( uint8_t ) ( packetIdentifier & 0xff );
+    ack[ 4 ] = 0x01; /* SUBACK: granted QoS 1. */
+
+    _queuePacket( ack, withReturnCode ? 5 : 4, NULL, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Queue a QoS 0 PUBLISH of a rotation response on the result topic.
+ */
+static void _queueResult( const char * pcResponse )
+{
+    static uint8_t body[ cdftestRESPONSE_BUFFER_SIZE ];
+    uint8_t header[ 5 ] = { 0 };
+    size_t headerLength = 1;
+    size_t topicLength = sizeof( cdftestRESULT_TOPIC ) - 1;
+    size_t responseLength = strlen( pcResponse );
+    size_t remainingLength = 2 + topicLength + responseLength;
+
+    if( remainingLength > sizeof( body ) )
+    {
+        return;
+    }
+
+    body[ 0 ] = ( uint8_t ) ( topicLength >> 8 );
+    body[ 1 ] = ( uint8_t ) ( topicLength & 0xff );
+    ( void ) memcpy( body + 2, cdftestRESULT_TOPIC, topicLength );
+    ( void ) memcpy( body + 2 + topicLength, pcResponse, responseLength );
+
+    header[ 0 ] = cdftestMQTT_PUBLISH;
+
+    do
+    {
+        header[ headerLength ] = ( uint8_t ) ( remainingLength & 0x7f );
+        remainingLength >>= 7;
+
+        if( remainingLength > 0 )
+        {
+            header[ headerLength ] |= 0x80;
+        }
+
+        headerLength++;
+    } while( remainingLength > 0 );
+
+    _queuePacket( header, headerLength, body, 2 + topicLength + responseLength );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Answer a PUBLISH sent by the agent: PUBACK it, then reply on the
+ * result topic if it is a rotation request.
+ */
+static void _handlePublish( const uint8_t * pPacket,
+                            size_t length )
+{
+    uint8_t qos = ( pPacket[ 0 ] >> 1 ) & 0x03;
+    size_t index = 1;
+    size_t topicLength = 0;
+    const char * pcTopic = NULL;
+    uint16_t packetIdentifier = 0;
+
+    /* Skip the remaining length. */
+    while( ( index < length ) && ( ( pPacket[ index ] & 0x80 ) != 0 ) )
+    {
+        index++;
+    }
+
+    index++;
+
+    topicLength = ( ( size_t ) pPacket[ index ] << 8 ) | pPacket[ index + 1 ];
+    pcTopic = ( const char * ) ( pPacket + index + 2 );
+    index += 2 + topicLength;
+
+    if( qos > 0 )
+    {
+        packetIdentifier = ( uint16_t ) ( ( pPacket[ index ] << 8 ) | pPacket[ index + 1 ] );
+        _queueAck( cdftestMQTT_PUBACK, packetIdentifier, false );
+    }
+
+    if( ( topicLength == sizeof( cdftestATTACH_TOPIC ) - 1 ) &&
+        ( strncmp( pcTopic, cdftestATTACH_TOPIC, topicLength ) == 0 ) )
+    {
+        _queueResult( _autoActivate ? cdftestATTACH_ACTIVATED_RESPONSE : cdftestATTACH_RESPONSE );
+    }
+    else if( ( topicLength == sizeof( cdftestACTIVATE_TOPIC ) - 1 ) &&
+             ( strncmp( pcTopic, cdftestACTIVATE_TOPIC, topicLength ) == 0 ) )
+    {
+        _activateRequests++;
+        _queueResult( cdftestACTIVATE_RESPONSE );
+    }
+    else if( ( topicLength == sizeof( cdftestDETACH_TOPIC ) - 1 ) &&
+             ( strncmp( pcTopic, cdftestDETACH_TOPIC, topicLength ) == 0 ) )
+    {
+        _queueResult( cdftestDETACH_RESPONSE );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Network send function of the broker stand-in.
+ *
+ * The MQTT library sends each packet with a single call.
+ */
+static size_t _brokerSend( void * pConnection,
+                           const uint8_t * pMessage,
+                           size_t messageLength )
+{
+    size_t index = 1;
+    uint16_t packetIdentifier = 0;
+
+    ( void ) pConnection;
+
+    /* SUBSCRIBE and UNSUBSCRIBE start their variable header with the packet
+     * identifier; find it past the remaining length. */
+    while( ( index < messageLength ) && ( ( pMessage[ index ] & 0x80 ) != 0 ) )
+    {
+        index++;
+    }
+
+    index++;
+
+    if( index + 1 < messageLength )
+    {
+        packetIdentifier = ( uint16_t ) ( ( pMessage[ index ] << 8 ) | pMessage[ index + 1 ] );
+    }
+
+    switch( pMessage[ 0 ] & 0xf0 )
+    {
+        case cdftestMQTT_PUBLISH:
+            _handlePublish( pMessage, messageLength );
+            break;
+
+        case ( cdftestMQTT_SUBSCRIBE & 0xf0 ):
+            _queueAck( cdftestMQTT_SUBACK, packetIdentifier, true );
+            break;
+
+        case ( cdftestMQTT_UNSUBSCRIBE & 0xf0 ):
+            _queueAck( cdftestMQTT_UNSUBACK, packetIdentifier, false );
+            break;
+
+        default:
+            break;
+    }
+
+    return messageLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Network receive function of the broker stand-in.
+ */
+static size_t _brokerReceive( void * pConnection,
+                              uint8_t * pBuffer,
+                              size_t bytesRequested )
+{
+    size_t bytesReceived = 0;
+
+    ( void ) pConnection;
+
+    IotMutex_Lock( &_rxLock );
+
+    bytesReceived = _rxTail - _rxHead;
+
+    if( bytesReceived > bytesRequested )
+    {
+        bytesReceived = bytesRequested;
+    }
+
+    ( void ) memcpy( pBuffer, _rxBuffer + _rxHead, bytesReceived );
+    _rxHead += bytesReceived;
+
+    IotMutex_Unlock( &_rxLock );
+
+    return bytesReceived;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A function for setting the receive callback that just returns success.
+ */
+static IotNetworkError_t _setReceiveCallback( void * pConnection,
+                                              IotNetworkReceiveCallback_t receiveCallback,
+                                              void * pReceiveContext )
+{
+    ( void ) pConnection;
+    ( void ) receiveCallback;
+    ( void ) pReceiveContext;
+
+    return IOT_NETWORK_SUCCESS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Delivers queued packets to the MQTT library, one per receive callback,
+ * as the network receive task would.
+ */
+static void _receiveThread( void * pArgument )
+{
+    ( void ) pArgument;
+
+    for( ; ; )
+    {
+        IotSemaphore_Wait( &_rxPackets );
+
+        if( _rxThreadStop == true )
+        {
+            break;
+        }
+
+        IotMqtt_ReceiveCallback( NULL, _pMqttConnection );
+    }
+
+    IotSemaphore_Post( &_rxThreadDone );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Wait for the agent to reach a state.
+ *
+ * @return true if the state was reached before the timeout.
+ */
+static bool _waitForAgentState( CDF_State_t eState )
+{
+    uint64_t ullDeadline = IotClock_GetTimeMs() + cdftestSTATE_WAIT_MS;
+
+    while( CDF_GetAgentState() != eState )
+    {
+        if( IotClock_GetTimeMs() > ullDeadline )
+        {
+            return false;
+        }
+
+        IotClock_SleepMs( cdftestPOLL_MS );
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test group for CDF agent tests.
+ */
+TEST_GROUP( Full_CDF_AGENT );
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test setup for CDF agent tests.
+ */
+TEST_SETUP( Full_CDF_AGENT )
+{
+    _rxHead = 0;
+    _rxTail = 0;
+    _rxThreadStop = false;
+    _nvmState = CDF_STATE_FINISHED;
+    _autoActivate = false;
+    _activateRequests = 0;
+
+    ( void ) memset( &_networkInfo, 0x00, sizeof( IotMqttNetworkInfo_t ) );
+    ( void ) memset( &_networkInterface, 0x00, sizeof( IotNetworkInterface_t ) );
+    _networkInterface.send = _brokerSend;
+    _networkInterface.receive = _brokerReceive;
+    _networkInterface.setReceiveCallback = _setReceiveCallback;
+    _networkInfo.pNetworkInterface = &_networkInterface;
+
+    TEST_ASSERT_EQUAL_INT( true, IotSdk_Init() );
+    TEST_ASSERT_EQUAL( IOT_MQTT_SUCCESS, IotMqtt_Init() );
+
+    TEST_ASSERT_EQUAL_INT( true, IotMutex_Create( &_rxLock, false ) );
+    TEST_ASSERT_EQUAL_INT( true, IotSemaphore_Create( &_rxPackets, 0, cdftestRX_BUFFER_SIZE ) );
+    TEST_ASSERT_EQUAL_INT( true, IotSemaphore_Create( &_rxThreadDone, 0, 1 ) );
+
+    _pMqttConnection = IotTestMqtt_createMqttConnection( true, &_networkInfo, 0 );
+    TEST_ASSERT_NOT_NULL( _pMqttConnection );
+
+    TEST_ASSERT_EQUAL_INT( true, Iot_CreateDetachedThread( _receiveThread,
+                                                           NULL,
+                                                           IOT_THREAD_DEFAULT_PRIORITY,
+                                                           IOT_THREAD_DEFAULT_STACK_SIZE ) );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test tear down for CDF agent tests.
+ */
+TEST_TEAR_DOWN( Full_CDF_AGENT )
+{
+    _rxThreadStop = true;
+    IotSemaphore_Post( &_rxPackets );
+    IotSemaphore_Wait( &_rxThreadDone );
+
+    IotMqtt_Disconnect( _pMqttConnection, IOT_MQTT_FLAG_CLEANUP_ONLY );
+    _pMqttConnection = NULL;
+
+    IotSemaphore_Destroy( &_rxThreadDone );
+    IotSemaphore_Destroy( &_rxPackets );
+    IotMutex_Destroy( &_rxLock );
+
+    IotMqtt_Cleanup();
+    IotSdk_Cleanup();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Test group runner for CDF agent tests.
+ */
+TEST_GROUP_RUNNER( Full_CDF_AGENT )
+{
+    RUN_TEST_CASE( Full_CDF_AGENT, RotationLatency );
+    RUN_TEST_CASE( Full_CDF_AGENT, ActivatedAttachSkipsAck );
+    RUN_TEST_CASE( Full_CDF_AGENT, RotationScheduledFromExpiry );
+    RUN_TEST_CASE( Full_CDF_AGENT, RotationJobNotificationStartsRotation );
+    RUN_TEST_CASE( Full_CDF_AGENT, OtherJobNotificationIsPassedOn );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measure end-to-end certificate rotation latency.
+ *
+ * Each rotation runs the agent through attach and activate on one connection,
+ * then through detach after a restart, as a device does after reconnecting
+ * with its new certificate. The broker stand-in answers immediately, so the
+ * latency is all spent on the device.
+ */
+TEST( Full_CDF_AGENT, RotationLatency )
+{
+    uint32_t i = 0;
+    uint64_t ullStart = 0;
+    uint32_t ulLatencyMs = 0;
+    uint32_t ulTotalMs = 0;
+    uint32_t ulMaxMs = 0;
+
+    for( i = 0; i < cdftestROTATION_COUNT; i++ )
+    {
+        _nvmState = CDF_STATE_WAIT_FOR_CERT_ROTATE;
+        ( void ) memset( _newCertificateId, 0x00, sizeof( _newCertificateId ) );
+        ( void ) memset( _oldCertificateId, 0x00, sizeof( _oldCertificateId ) );
+        ( void ) memset( _tempCertificate, 0x00, sizeof( _tempCertificate ) );
+
+        ullStart = IotClock_GetTimeMs();
+
+        CDF_AgentInit_internal( _pMqttConnection,
+                                ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                                NULL,
+                                &_cdfApi,
+                                0 );
+        TEST_ASSERT_TRUE( _waitForAgentState( eCDF_AgentState_DeactivateCert ) );
+        CDF_AgentShutdown();
+
+        TEST_ASSERT_EQUAL( CDF_STATE_DEACTIVATE_CERT, _nvmState );
+
+        CDF_AgentInit_internal( _pMqttConnection,
+                                ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                                NULL,
+                                &_cdfApi,
+                                0 );
+        TEST_ASSERT_TRUE( _waitForAgentState( eCDF_AgentState_ShuttingDown ) );
+
+        ulLatencyMs = ( uint32_t ) ( IotClock_GetTimeMs() - ullStart );
+        CDF_AgentShutdown();
+
+        TEST_ASSERT_EQUAL( CDF_STATE_FINISHED, _nvmState );
+        TEST_ASSERT_EQUAL_STRING( cdftestNEW_CERT_ID, _newCertificateId );
+        TEST_ASSERT_EQUAL_STRING( cdftestOLD_CERT_ID, _oldCertificateId );
+        TEST_ASSERT_EQUAL_STRING( cdftestNEW_CERT_PEM, _tempCertificate );
+
+        ulTotalMs += ulLatencyMs;
+
+        if( ulLatencyMs > ulMaxMs )
+        {
+            ulMaxMs = ulLatencyMs;
+        }
+    }
+
+    UnityPrint( "CDF rotation latency over " );
+    UnityPrintNumber( ( UNITY_INT ) cdftestROTATION_COUNT );
+    UnityPrint( " rotations: average " );
+    UnityPrintNumber( ( UNITY_INT ) ( ulTotalMs / cdftestROTATION_COUNT ) );
+    UnityPrint( " ms, max " );
+    UnityPrintNumber( ( UNITY_INT ) ulMaxMs );
+    UnityPrint( " ms." );
+    UNITY_PRINT_EOL();
+
+    TEST_ASSERT_LESS_THAN_UINT32( cdftestMAX_ROTATION_MS, ulMaxMs );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief An attach response that reports the new certificate as activated
+ * takes the rotation straight to deactivating the old certificate.
+ */
+TEST( Full_CDF_AGENT, ActivatedAttachSkipsAck )
+{
+    _autoActivate = true;
+    _nvmState = CDF_STATE_WAIT_FOR_CERT_ROTATE;
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+    TEST_ASSERT_TRUE( _waitForAgentState( eCDF_AgentState_DeactivateCert ) );
+    CDF_AgentShutdown();
+
+    TEST_ASSERT_EQUAL( CDF_STATE_DEACTIVATE_CERT, _nvmState );
+    TEST_ASSERT_EQUAL_UINT32( 0, _activateRequests );
+    TEST_ASSERT_EQUAL_STRING( cdftestNEW_CERT_ID, _newCertificateId );
+    TEST_ASSERT_EQUAL_STRING( cdftestNEW_CERT_PEM, _tempCertificate );
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+    TEST_ASSERT_TRUE( _waitForAgentState( eCDF_AgentState_ShuttingDown ) );
+    CDF_AgentShutdown();
+
+    TEST_ASSERT_EQUAL( CDF_STATE_FINISHED, _nvmState );
+    TEST_ASSERT_EQUAL_UINT32( 0, _activateRequests );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief An idle agent schedules the rotation inside the window before the
+ * device certificate expires, at the same time on every start.
+ */
+TEST( Full_CDF_AGENT, RotationScheduledFromExpiry )
+{
+    uint32_t ulRotationTime = 0;
+    const uint32_t ulWindowEnd = cdftestDEVICE_CERT_NOT_AFTER - cdfconfigROTATE_BEFORE_EXPIRY_SECONDS;
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+    TEST_ASSERT_EQUAL( eCDF_AgentState_Ready, CDF_GetAgentState() );
+    ulRotationTime = CDF_GetRotationTime();
+    CDF_AgentShutdown();
+
+    TEST_ASSERT_EQUAL_UINT32( 0, CDF_GetRotationTime() );
+    TEST_ASSERT_TRUE( ulRotationTime >= ulWindowEnd - cdfconfigROTATION_WINDOW_SECONDS );
+    TEST_ASSERT_LESS_THAN_UINT32( ulWindowEnd, ulRotationTime );
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+    TEST_ASSERT_EQUAL_UINT32( ulRotationTime, CDF_GetRotationTime() );
+    CDF_AgentShutdown();
+
+    /* The default clock reports the time as unknown, so nothing started. */
+    TEST_ASSERT_EQUAL( CDF_STATE_FINISHED, _nvmState );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A rotation job nested in a job notification starts the rotation.
+ */
+TEST( Full_CDF_AGENT, RotationJobNotificationStartsRotation )
+{
+    /* The callback terminates the document, so it gets a writable copy with room for that. */
+    char cJob[ sizeof( cdftestROTATION_JOB_NOTIFICATION ) ] = cdftestROTATION_JOB_NOTIFICATION;
+
+    ( void ) memset( _newCertificateId, 0x00, sizeof( _newCertificateId ) );
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+    TEST_ASSERT_EQUAL( eCDF_AgentState_Ready, CDF_GetAgentState() );
+
+    TEST_ASSERT_EQUAL( eOTA_JobParseErr_None,
+                       prvCDF_CertRotateCallback( cJob, ( uint32_t ) strlen( cJob ) ) );
+    TEST_ASSERT_TRUE( _waitForAgentState( eCDF_AgentState_DeactivateCert ) );
+    CDF_AgentShutdown();
+
+    TEST_ASSERT_EQUAL( CDF_STATE_DEACTIVATE_CERT, _nvmState );
+    TEST_ASSERT_EQUAL_STRING( cdftestNEW_CERT_ID, _newCertificateId );
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief A custom job that is not a rotation job goes to the application's
+ * callback and leaves the agent idle.
+ */
+TEST( Full_CDF_AGENT, OtherJobNotificationIsPassedOn )
+{
+    char cJob[ sizeof( cdftestOTHER_JOB_NOTIFICATION ) ] = cdftestOTHER_JOB_NOTIFICATION;
+
+    CDF_AgentInit_internal( _pMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &_cdfApi,
+                            0 );
+
+    TEST_ASSERT_EQUAL( eOTA_JobParseErr_NonConformingJobDoc,
+                       prvCDF_CertRotateCallback( cJob, ( uint32_t ) strlen( cJob ) ) );
+    TEST_ASSERT_EQUAL( eCDF_AgentState_Ready, CDF_GetAgentState() );
+    CDF_AgentShutdown();
+
+    TEST_ASSERT_EQUAL( CDF_STATE_FINISHED, _nvmState );
+}
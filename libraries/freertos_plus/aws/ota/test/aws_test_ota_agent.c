@@ -34,6 +34,7 @@
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "task.h"
 
 #include "unity_fixture.h"
 #include "unity.h"
@@ -184,6 +185,17 @@ TEST_GROUP_RUNNER( Full_OTA_AGENT )
     RUN_TEST_CASE( Full_OTA_AGENT, OTA_SetImageState_InvalidParams );
     RUN_TEST_CASE( Full_OTA_AGENT, prvParseJobDocFromJSONandPrvOTA_Close );
     RUN_TEST_CASE( Full_OTA_AGENT, prvParseJSONbyModel_Errors );
+    RUN_TEST_CASE( Full_OTA_AGENT, JSON_ParseByModel_MatchesValues );
+    #if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+        RUN_TEST_CASE( Full_OTA_AGENT, prvWindowNextRange_AdaptsToArrivals );
+        RUN_TEST_CASE( Full_OTA_AGENT, prvWindowBlockReceived_StopsGrowingAtArrivalRate );
+    #endif
+    #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+        RUN_TEST_CASE( Full_OTA_AGENT, prvSigVerifyBlock_HoldsOutOfOrderBlocks );
+    #endif
+    #if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+        RUN_TEST_CASE( Full_OTA_AGENT, prvLoadCheckpoint_ResumesSameJobOnly );
+    #endif
 }
 
 TEST( Full_OTA_AGENT, OTA_SetImageState_InvalidParams )
@@ -379,3 +391,271 @@ TEST( Full_OTA_AGENT, prvParseJSONbyModel_Errors )
     /* Shut down the OTA Agent. */
     ( void ) OTA_AgentShutdown( pdMS_TO_TICKS( otatestSHUTDOWN_WAIT ) );
 }
+
+TEST( Full_OTA_AGENT, JSON_ParseByModel_MatchesValues )
+{
+    static const JSON_DocParam_t xDocParams[ 3 ] =
+    {
+        { "op",    OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "rotate" }, eModelParamType_StringMatch, JSMN_STRING },
+        { "topic", OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "a"      }, eModelParamType_StringMatch, JSMN_STRING },
+        { "topic", OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "b"      }, eModelParamType_StringMatch, JSMN_STRING },
+    };
+    static const JSON_DocParam_t xNestedParams[ 2 ] =
+    {
+        { "step", OTA_JOB_PARAM_OPTIONAL, { OTA_DONT_STORE_PARAM     }, eModelParamType_Object,      JSMN_OBJECT },
+        { "op",   OTA_JOB_PARAM_REQUIRED, { .pcMatchValue = "rotate" }, eModelParamType_StringMatch, JSMN_STRING },
+    };
+    static uint32_t ulKeyHashes[ 3 ];
+    static uint32_t ulNestedKeyHashes[ 2 ];
+    static const char cNestedDoc[] = "{\"other\":{\"op\":\"x\"},\"step\":{\"id\":1,\"op\":\"rotate\"}}";
+    static const char cMatchingDoc[] = "{\"topic\":\"b\",\"other\":{\"op\":\"x\"},\"op\":\"rotate\",\"topic\":\"a\"}";
+    static const char cWrongValueDoc[] = "{\"op\":\"rotate\",\"topic\":\"a\",\"topic\":\"c\"}";
+    static const char cRepeatedValueDoc[] = "{\"op\":\"rotate\",\"topic\":\"a\",\"topic\":\"a\",\"topic\":\"b\"}";
+    JSON_DocModel_t xDocModel;
+
+    /* The key hashes are computed by the first initialization only. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_InitDocModel( &xDocModel, xDocParams, 0U, 0U, 3U, ulKeyHashes ) );
+    TEST_ASSERT_NOT_EQUAL( 0U, ulKeyHashes[ 0 ] );
+    TEST_ASSERT_EQUAL_UINT32( ulKeyHashes[ 1 ], ulKeyHashes[ 2 ] );
+
+    /* Members may come in any order and unknown members are skipped with their contents. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_ParseByModel( cMatchingDoc, sizeof( cMatchingDoc ) - 1U, &xDocModel ) );
+
+    /* A member with an unexpected value does not count. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_InitDocModel( &xDocModel, xDocParams, 0U, 0U, 3U, ulKeyHashes ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_MalformedDoc, JSON_ParseByModel( cWrongValueDoc, sizeof( cWrongValueDoc ) - 1U, &xDocModel ) );
+
+    /* The same member and value twice is a duplicate. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_InitDocModel( &xDocModel, xDocParams, 0U, 0U, 3U, ulKeyHashes ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_DuplicatesNotAllowed, JSON_ParseByModel( cRepeatedValueDoc, sizeof( cRepeatedValueDoc ) - 1U, &xDocModel ) );
+
+    /* Members of an object in the model are matched, while those of other objects are still skipped. */
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_InitDocModel( &xDocModel, xNestedParams, 0U, 0U, 2U, ulNestedKeyHashes ) );
+    TEST_ASSERT_EQUAL( eDocParseErr_None, JSON_ParseByModel( cNestedDoc, sizeof( cNestedDoc ) - 1U, &xDocModel ) );
+}
+
+#if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 )
+
+/* Number of bitmap bytes covered by one requested range. */
+    #define otatestWINDOW_RANGE_BYTES    ( otaconfigSTREAM_WINDOW_BLOCKS / BITS_PER_BYTE )
+
+/* Receive every missing block of a range, as the agent would when the service answers it.
+ * Each block arrives xBlockTicks after the one before. */
+    static void prvReceiveRange( OTA_StreamWindow_t * pxWindow,
+                                 uint8_t * pucBitmap,
+                                 uint32_t ulFirstByte,
+                                 uint32_t ulNumBytes,
+                                 TickType_t xBlockTicks )
+    {
+        uint32_t ulBlock;
+        uint8_t ucBitMask;
+
+        for( ulBlock = ulFirstByte * BITS_PER_BYTE; ulBlock < ( ulFirstByte + ulNumBytes ) * BITS_PER_BYTE; ulBlock++ )
+        {
+            ucBitMask = ( uint8_t ) ( 1U << ( ulBlock % BITS_PER_BYTE ) );
+
+            if( ( pucBitmap[ ulBlock / BITS_PER_BYTE ] & ucBitMask ) != 0U )
+            {
+                pucBitmap[ ulBlock / BITS_PER_BYTE ] &= ( uint8_t ) ~ucBitMask;
+
+                if( xBlockTicks > 0U )
+                {
+                    vTaskDelay( xBlockTicks );
+                }
+
+                TEST_OTA_prvWindowBlockReceived( pxWindow, ulBlock, pdFALSE );
+            }
+        }
+    }
+
+    TEST( Full_OTA_AGENT, prvWindowNextRange_AdaptsToArrivals )
+    {
+        OTA_StreamWindow_t xWindow;
+        uint8_t pucBitmap[ 4 * otatestWINDOW_RANGE_BYTES ];
+        uint32_t ulFirstByte[ 2 ], ulNumBytes[ 2 ], ulNumBlocks;
+
+        memset( pucBitmap, 0xff, sizeof( pucBitmap ) );
+        TEST_OTA_prvWindowReset( &xWindow );
+
+        /* A new download requests one range that carries only its part of the bitmap. */
+        TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+        TEST_ASSERT_EQUAL_UINT32( 0, ulFirstByte[ 0 ] );
+        TEST_ASSERT_EQUAL_UINT32( otatestWINDOW_RANGE_BYTES, ulNumBytes[ 0 ] );
+        TEST_ASSERT_EQUAL_UINT32( otaconfigSTREAM_WINDOW_BLOCKS, ulNumBlocks );
+        TEST_ASSERT_FALSE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 1 ], &ulNumBytes[ 1 ], &ulNumBlocks ) );
+
+        /* Blocks already received are not counted in the next range. */
+        pucBitmap[ otatestWINDOW_RANGE_BYTES ] = 0x0f;
+
+        /* A range that completes cleanly grows the window. */
+        prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 0 );
+
+        if( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 1 )
+        {
+            TEST_ASSERT_EQUAL_UINT32( 2, xWindow.ulWindowSize );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+            TEST_ASSERT_EQUAL_UINT32( otatestWINDOW_RANGE_BYTES, ulFirstByte[ 0 ] );
+            TEST_ASSERT_EQUAL_UINT32( otaconfigSTREAM_WINDOW_BLOCKS - 4, ulNumBlocks );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 1 ], &ulNumBytes[ 1 ], &ulNumBlocks ) );
+            TEST_ASSERT_EQUAL_UINT32( 2 * otatestWINDOW_RANGE_BYTES, ulFirstByte[ 1 ] );
+
+            /* The newer range completes first, so the older one lost blocks. The window
+             * shrinks and the older range is requested again. */
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 1 ], ulNumBytes[ 1 ], 0 );
+            TEST_ASSERT_EQUAL_UINT32( 1, xWindow.ulWindowSize );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 1 ], &ulNumBytes[ 1 ], &ulNumBlocks ) );
+            TEST_ASSERT_EQUAL_UINT32( 3 * otatestWINDOW_RANGE_BYTES, ulFirstByte[ 1 ] );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 1 ], ulNumBytes[ 1 ], 0 );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 1 ], &ulNumBytes[ 1 ], &ulNumBlocks ) );
+            TEST_ASSERT_EQUAL_UINT32( ulFirstByte[ 0 ], ulFirstByte[ 1 ] );
+        }
+
+        /* A duplicate block halves the window when the next range completes. */
+        TEST_OTA_prvWindowTimeout( &xWindow );
+        xWindow.ulWindowSize = otaconfigSTREAM_WINDOW_MAX_REQUESTS;
+        TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+        TEST_OTA_prvWindowBlockReceived( &xWindow, 0, pdTRUE );
+        prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 0 );
+        TEST_ASSERT_EQUAL_UINT32( ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 1 ) ? ( otaconfigSTREAM_WINDOW_MAX_REQUESTS / 2 ) : 1, xWindow.ulWindowSize );
+
+        /* Nothing is left to request once every block has arrived. */
+        prvReceiveRange( &xWindow, pucBitmap, 0, sizeof( pucBitmap ), 0 );
+        TEST_ASSERT_FALSE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+    }
+
+    TEST( Full_OTA_AGENT, prvWindowBlockReceived_StopsGrowingAtArrivalRate )
+    {
+        OTA_StreamWindow_t xWindow;
+        uint8_t pucBitmap[ 8 * otatestWINDOW_RANGE_BYTES ];
+        uint32_t ulFirstByte[ 2 ], ulNumBytes[ 2 ], ulNumBlocks;
+
+        if( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 1 )
+        {
+            memset( pucBitmap, 0xff, sizeof( pucBitmap ) );
+            TEST_OTA_prvWindowReset( &xWindow );
+
+            /* The first range sets the arrival rate of a window of one range. */
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 2 );
+            TEST_ASSERT_EQUAL_UINT32( 2, xWindow.ulWindowSize );
+
+            /* Blocks arrive no faster with two ranges in flight, so the window goes back to one
+             * range and stays there. */
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 1 ], &ulNumBytes[ 1 ], &ulNumBlocks ) );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 2 );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 1 ], ulNumBytes[ 1 ], 2 );
+            TEST_ASSERT_EQUAL_UINT32( 1, xWindow.ulWindowSize );
+            TEST_ASSERT_EQUAL_UINT32( 1, xWindow.ulWindowLimit );
+
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 0 );
+            TEST_ASSERT_EQUAL_UINT32( 1, xWindow.ulWindowSize );
+
+            /* A timeout lets the window grow again. */
+            TEST_OTA_prvWindowTimeout( &xWindow );
+            TEST_ASSERT_EQUAL_UINT32( otaconfigSTREAM_WINDOW_MAX_REQUESTS, xWindow.ulWindowLimit );
+            TEST_ASSERT_TRUE( TEST_OTA_prvWindowNextRange( &xWindow, pucBitmap, sizeof( pucBitmap ), &ulFirstByte[ 0 ], &ulNumBytes[ 0 ], &ulNumBlocks ) );
+            prvReceiveRange( &xWindow, pucBitmap, ulFirstByte[ 0 ], ulNumBytes[ 0 ], 0 );
+            TEST_ASSERT_EQUAL_UINT32( 2, xWindow.ulWindowSize );
+        }
+    }
+#endif /* if ( otaconfigSTREAM_WINDOW_MAX_REQUESTS > 0 ) */
+
+#if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+    TEST( Full_OTA_AGENT, prvSigVerifyBlock_HoldsOutOfOrderBlocks )
+    {
+        OTA_FileContext_t xContext;
+        static uint8_t ucBlock[ OTA_FILE_BLOCK_SIZE ];
+        uint32_t ulBlock;
+
+        memset( &xContext, 0, sizeof( xContext ) );
+        memset( ucBlock, 0xa5, sizeof( ucBlock ) );
+        TEST_OTA_prvSigVerifyStart( &xContext );
+        TEST_ASSERT_NOT_NULL( xContext.pvSigVerifyContext );
+
+        /* Every held block is hashed once the block before them arrives, which frees the slots. */
+        for( ulBlock = otaconfigSIGNATURE_PENDING_BLOCKS; ulBlock > 0U; ulBlock-- )
+        {
+            TEST_OTA_prvSigVerifyBlock( &xContext, ulBlock, ucBlock, sizeof( ucBlock ) );
+        }
+
+        TEST_OTA_prvSigVerifyBlock( &xContext, 0, ucBlock, sizeof( ucBlock ) );
+        TEST_ASSERT_NOT_NULL( xContext.pvSigVerifyContext );
+
+        /* One block more ahead than there are slots drops the hash. */
+        ulBlock = otaconfigSIGNATURE_PENDING_BLOCKS + 1U;
+
+        for( ulBlock++; ulBlock <= ( 2U * otaconfigSIGNATURE_PENDING_BLOCKS ) + 1U; ulBlock++ )
+        {
+            TEST_OTA_prvSigVerifyBlock( &xContext, ulBlock, ucBlock, sizeof( ucBlock ) );
+            TEST_ASSERT_NOT_NULL( xContext.pvSigVerifyContext );
+        }
+
+        TEST_OTA_prvSigVerifyBlock( &xContext, ulBlock, ucBlock, sizeof( ucBlock ) );
+        TEST_ASSERT_NULL( xContext.pvSigVerifyContext );
+
+        /* Later blocks are ignored and stopping again is harmless. */
+        TEST_OTA_prvSigVerifyBlock( &xContext, otaconfigSIGNATURE_PENDING_BLOCKS + 1U, ucBlock, sizeof( ucBlock ) );
+        TEST_OTA_prvSigVerifyStop( &xContext );
+        TEST_ASSERT_NULL( xContext.pvSigVerifyContext );
+    }
+#endif /* if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 ) */
+
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+/* Set up a file context as the agent does for a new job of 20 blocks. */
+    static void prvInitCheckpointContext( OTA_FileContext_t * C,
+                                          uint8_t * pucBitmap,
+                                          char * pcStreamName )
+    {
+        memset( C, 0, sizeof( *C ) );
+        C->pucFilePath = ( uint8_t * ) "ota_checkpoint_test.bin";
+        C->pucStreamName = ( uint8_t * ) pcStreamName;
+        C->ulServerFileID = 0;
+        C->ulFileSize = ( 20 * OTA_FILE_BLOCK_SIZE ) - 1;
+        C->ulBlocksRemaining = 20;
+        C->pucRxBlockBitmap = pucBitmap;
+        pucBitmap[ 0 ] = 0xff;
+        pucBitmap[ 1 ] = 0xff;
+        pucBitmap[ 2 ] = 0x0f;
+    }
+
+    TEST( Full_OTA_AGENT, prvLoadCheckpoint_ResumesSameJobOnly )
+    {
+        OTA_FileContext_t xContext;
+        uint8_t ucBitmap[ 3 ];
+
+        /* Blocks 0 to 9 were received before the checkpoint. */
+        prvInitCheckpointContext( &xContext, ucBitmap, "AFR_OTA-stream" );
+        ucBitmap[ 0 ] = 0x00;
+        ucBitmap[ 1 ] = 0xfc;
+        xContext.ulBlocksRemaining = 10;
+        TEST_OTA_prvSaveCheckpoint( &xContext );
+
+        /* Another job ignores the checkpoint. */
+        prvInitCheckpointContext( &xContext, ucBitmap, "AFR_OTA-other" );
+        TEST_OTA_prvLoadCheckpoint( &xContext );
+        TEST_ASSERT_FALSE( xContext.xIsResuming );
+        TEST_ASSERT_EQUAL_UINT32( 20, xContext.ulBlocksRemaining );
+
+        /* The same job only needs the missing blocks. */
+        prvInitCheckpointContext( &xContext, ucBitmap, "AFR_OTA-stream" );
+        TEST_OTA_prvLoadCheckpoint( &xContext );
+        TEST_ASSERT_TRUE( xContext.xIsResuming );
+        TEST_ASSERT_EQUAL_UINT32( 10, xContext.ulBlocksRemaining );
+        TEST_ASSERT_EQUAL_HEX8( 0x00, ucBitmap[ 0 ] );
+        TEST_ASSERT_EQUAL_HEX8( 0xfc, ucBitmap[ 1 ] );
+        TEST_ASSERT_EQUAL_HEX8( 0x0f, ucBitmap[ 2 ] );
+
+        /* A deleted checkpoint is not resumed. */
+        TEST_OTA_prvDeleteCheckpoint( &xContext );
+        prvInitCheckpointContext( &xContext, ucBitmap, "AFR_OTA-stream" );
+        TEST_OTA_prvLoadCheckpoint( &xContext );
+        TEST_ASSERT_FALSE( xContext.xIsResuming );
+
+        #if ( otaconfigINCREMENTAL_SIGNATURE_VERIFY != 0 )
+            TEST_OTA_prvSigVerifyStop( &xContext );
+        #endif
+    }
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
@@ -232,6 +232,7 @@ TEST_GROUP_RUNNER( Full_OTA_CBOR )
 {
     RUN_TEST_CASE( Full_OTA_CBOR, CborOtaApi );
     RUN_TEST_CASE( Full_OTA_CBOR, CborOtaAgentIngest );
+    RUN_TEST_CASE( Full_OTA_CBOR, CborOtaDownloadBenchmark );
 }
 
 TEST_GROUP_RUNNER( Quarantine_OTA_CBOR )
@@ -250,6 +251,7 @@ TEST_GROUP_RUNNER( Quarantine_OTA_CBOR )
 #define CBOR_TEST_BLOCKIDENTITY_VALUE                     0
 #define CBOR_TEST_STREAMFILES_COUNT                       3
 #define CBOR_TEST_STREAMFILE_FIELD_COUNT                  2
+#define CBOR_TEST_BENCHMARK_ROUNDS                        1000
 
 /*-----------------------------------------------------------*/
 
@@ -516,6 +518,8 @@ TEST( Full_OTA_CBOR, CborOtaApi )
     int lBlockIndex = 0;
     int lBlockSize = 0;
     uint8_t * pucPayload = NULL;
+    const uint8_t * pucConstPayload = NULL;
+    uint8_t ucStaging[ OTA_FILE_BLOCK_SIZE ];
     size_t xPayloadSize = 0;
 
     /* Test OTA_CBOR_Encode_GetStreamRequestMessage( ). */
@@ -567,6 +571,52 @@ TEST( Full_OTA_CBOR, CborOtaApi )
         vPortFree( pucPayload );
         pucPayload = NULL;
     }
+
+    /* Test OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc( ) in place. */
+    xResult = OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
+        ucCborWork,
+        xEncodedSize,
+        &lFileId,
+        &lBlockIndex,
+        &lBlockSize,
+        NULL,
+        0,
+        &pucConstPayload,
+        &xPayloadSize );
+    TEST_ASSERT_TRUE( xResult );
+    TEST_ASSERT_TRUE( ( pucConstPayload > ucCborWork ) && ( pucConstPayload + xPayloadSize <= ucCborWork + xEncodedSize ) );
+    TEST_ASSERT_EQUAL( sizeof( ucBlockPayload ), xPayloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlockPayload, pucConstPayload, xPayloadSize );
+
+    /* Test OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc( ) into a staging buffer. */
+    memset( ucStaging, 0, sizeof( ucStaging ) );
+    xResult = OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
+        ucCborWork,
+        xEncodedSize,
+        &lFileId,
+        &lBlockIndex,
+        &lBlockSize,
+        ucStaging,
+        sizeof( ucStaging ),
+        &pucConstPayload,
+        &xPayloadSize );
+    TEST_ASSERT_TRUE( xResult );
+    TEST_ASSERT_EQUAL_PTR( ucStaging, pucConstPayload );
+    TEST_ASSERT_EQUAL( sizeof( ucBlockPayload ), xPayloadSize );
+    TEST_ASSERT_EQUAL_MEMORY( ucBlockPayload, ucStaging, xPayloadSize );
+
+    /* A staging buffer that is too small is rejected. */
+    xResult = OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
+        ucCborWork,
+        xEncodedSize,
+        &lFileId,
+        &lBlockIndex,
+        &lBlockSize,
+        ucStaging,
+        sizeof( ucStaging ) - 1,
+        &pucConstPayload,
+        &xPayloadSize );
+    TEST_ASSERT_FALSE( xResult );
 }
 
 TEST( Full_OTA_CBOR, CborOtaAgentIngest )
@@ -682,6 +732,166 @@ TEST( Full_OTA_CBOR, CborOtaAgentIngest )
     }
 }
 
+TEST( Full_OTA_CBOR, CborOtaDownloadBenchmark )
+{
+    BaseType_t xResultBool = pdFALSE;
+    IngestResult_t xResultIngest = 0;
+    uint8_t ucBlockPayload[ OTA_FILE_BLOCK_SIZE ] = { 0 };
+    uint8_t ucCborWork[ CBOR_TEST_MESSAGE_BUFFER_SIZE ];
+    uint32_t ulStaging[ OTA_FILE_BLOCK_SIZE / sizeof( uint32_t ) ];
+    size_t xEncodedSize = 0;
+    size_t xChunkSize = 0;
+    int lFileId = 0;
+    int lBlockIndex = 0;
+    int lBlockSize = 0;
+    uint8_t * pucPayload = NULL;
+    const uint8_t * pucConstPayload = NULL;
+    size_t xPayloadSize = 0;
+    size_t xFreeHeap, xMinFreeHeap;
+    TickType_t xStart, xElapsed;
+    uint32_t ulRound, ulBlocks = 0;
+    OTA_FileContext_t xOTAFileContext = { 0 };
+    Sig256_t xSig = { 0 };
+    uint8_t * pucInFile = NULL;
+    size_t xBlockBitmapSize = 0;
+
+    xResultBool = prvCreateSampleGetStreamResponseMessage(
+        ucCborWork,
+        sizeof( ucCborWork ),
+        CBOR_TEST_BLOCKIDENTITY_VALUE,
+        ucBlockPayload,
+        sizeof( ucBlockPayload ),
+        &xEncodedSize );
+    TEST_ASSERT_TRUE( xResultBool );
+
+    /* Decode the same block with each decoder. The lowest free heap seen while
+     * a payload is held shows how much heap each block costs. */
+    xFreeHeap = xPortGetFreeHeapSize();
+    xMinFreeHeap = xFreeHeap;
+    xStart = xTaskGetTickCount();
+
+    for( ulRound = 0; ulRound < CBOR_TEST_BENCHMARK_ROUNDS; ulRound++ )
+    {
+        xResultBool = OTA_CBOR_Decode_GetStreamResponseMessage(
+            ucCborWork, xEncodedSize, &lFileId, &lBlockIndex, &lBlockSize, &pucPayload, &xPayloadSize );
+        TEST_ASSERT_TRUE( xResultBool );
+        xMinFreeHeap = min( xMinFreeHeap, xPortGetFreeHeapSize() );
+        vPortFree( pucPayload );
+        pucPayload = NULL;
+    }
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    configPRINTF( ( "Decode with allocation: %u blocks in %u ms, %u bytes of heap per block.\r\n",
+                    CBOR_TEST_BENCHMARK_ROUNDS, ( uint32_t ) ( xElapsed * portTICK_PERIOD_MS ), ( uint32_t ) ( xFreeHeap - xMinFreeHeap ) ) );
+
+    xMinFreeHeap = xFreeHeap;
+    xStart = xTaskGetTickCount();
+
+    for( ulRound = 0; ulRound < CBOR_TEST_BENCHMARK_ROUNDS; ulRound++ )
+    {
+        xResultBool = OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
+            ucCborWork, xEncodedSize, &lFileId, &lBlockIndex, &lBlockSize,
+            ( uint8_t * ) ulStaging, sizeof( ulStaging ), &pucConstPayload, &xPayloadSize );
+        TEST_ASSERT_TRUE( xResultBool );
+        xMinFreeHeap = min( xMinFreeHeap, xPortGetFreeHeapSize() );
+    }
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    configPRINTF( ( "Decode into staging buffer: %u blocks in %u ms, %u bytes of heap per block.\r\n",
+                    CBOR_TEST_BENCHMARK_ROUNDS, ( uint32_t ) ( xElapsed * portTICK_PERIOD_MS ), ( uint32_t ) ( xFreeHeap - xMinFreeHeap ) ) );
+    TEST_ASSERT_EQUAL( xFreeHeap, xMinFreeHeap );
+
+    xMinFreeHeap = xFreeHeap;
+    xStart = xTaskGetTickCount();
+
+    for( ulRound = 0; ulRound < CBOR_TEST_BENCHMARK_ROUNDS; ulRound++ )
+    {
+        xResultBool = OTA_CBOR_Decode_GetStreamResponseMessageNoAlloc(
+            ucCborWork, xEncodedSize, &lFileId, &lBlockIndex, &lBlockSize,
+            NULL, 0, &pucConstPayload, &xPayloadSize );
+        TEST_ASSERT_TRUE( xResultBool );
+        xMinFreeHeap = min( xMinFreeHeap, xPortGetFreeHeapSize() );
+    }
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    configPRINTF( ( "Decode in place: %u blocks in %u ms, %u bytes of heap per block.\r\n",
+                    CBOR_TEST_BENCHMARK_ROUNDS, ( uint32_t ) ( xElapsed * portTICK_PERIOD_MS ), ( uint32_t ) ( xFreeHeap - xMinFreeHeap ) ) );
+    TEST_ASSERT_EQUAL( xFreeHeap, xMinFreeHeap );
+
+    /* Download the signed test file through the agent's ingest path and report
+     * the throughput and the heap low-water mark. */
+    xResultBool = prvReadCborTestFile(
+        "payload.bin",
+        &pucInFile,
+        &xOTAFileContext.ulFileSize );
+    TEST_ASSERT_TRUE( xResultBool );
+
+    xOTAFileContext.pxFile = fopen( "testOtaFile.bin", "w+b" );
+    TEST_ASSERT_NOT_NULL( xOTAFileContext.pxFile );
+    xOTAFileContext.ulBlocksRemaining =
+        ( xOTAFileContext.ulFileSize + OTA_FILE_BLOCK_SIZE - 1 ) / OTA_FILE_BLOCK_SIZE;
+
+    xBlockBitmapSize = 1 + ( xOTAFileContext.ulFileSize / BITS_PER_BYTE );
+    xOTAFileContext.pucRxBlockBitmap = pvPortMalloc( xBlockBitmapSize );
+    TEST_ASSERT_NOT_NULL( xOTAFileContext.pucRxBlockBitmap );
+    memset( xOTAFileContext.pucRxBlockBitmap, 0xFF, xBlockBitmapSize );
+
+    /* The signature is not checked here. Only the block path is measured. */
+    xOTAFileContext.pucCertFilepath = "rsasigner.crt";
+    xOTAFileContext.pxSignature = &xSig;
+
+    xStart = xTaskGetTickCount();
+
+    for( size_t xBlock = 0;
+         ( xBlock * OTA_FILE_BLOCK_SIZE ) < xOTAFileContext.ulFileSize;
+         xBlock++ )
+    {
+        xChunkSize = min(
+            OTA_FILE_BLOCK_SIZE,
+            xOTAFileContext.ulFileSize - ( xBlock * OTA_FILE_BLOCK_SIZE ) );
+        xResultBool = prvCreateSampleGetStreamResponseMessage(
+            ucCborWork,
+            sizeof( ucCborWork ),
+            xBlock,
+            pucInFile + ( xBlock * OTA_FILE_BLOCK_SIZE ),
+            xChunkSize,
+            &xEncodedSize );
+        TEST_ASSERT_TRUE( xResultBool );
+
+        OTA_Err_t xCloseResult = kOTA_Err_None;
+        xResultIngest = TEST_OTA_prvIngestDataBlock(
+            &xOTAFileContext,
+            ucCborWork,
+            xEncodedSize,
+            &xCloseResult );
+        TEST_ASSERT_TRUE( xResultIngest != eIngest_Result_BadData );
+        ulBlocks++;
+    }
+
+    xElapsed = xTaskGetTickCount() - xStart;
+    configPRINTF( ( "Ingest: %u blocks in %u ms (%u blocks/s), minimum ever free heap %u bytes.\r\n",
+                    ulBlocks,
+                    ( uint32_t ) ( xElapsed * portTICK_PERIOD_MS ),
+                    ( uint32_t ) ( ( ulBlocks * 1000UL ) / max( 1UL, ( uint32_t ) ( xElapsed * portTICK_PERIOD_MS ) ) ),
+                    ( uint32_t ) xPortGetMinimumEverFreeHeapSize() ) );
+
+    /* Clean-up. */
+    if( NULL != xOTAFileContext.pxFile )
+    {
+        fclose( xOTAFileContext.pxFile );
+    }
+
+    if( NULL != xOTAFileContext.pucRxBlockBitmap )
+    {
+        vPortFree( xOTAFileContext.pucRxBlockBitmap );
+    }
+
+    if( NULL != pucInFile )
+    {
+        vPortFree( pucInFile );
+    }
+}
+
 TEST( Quarantine_OTA_CBOR, CborOtaServerFiles )
 {
     BaseType_t xResultBool = pdFALSE;
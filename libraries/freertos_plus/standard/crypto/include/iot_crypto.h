@@ -107,4 +107,42 @@ BaseType_t CRYPTO_SignatureVerificationFinal( void * pvContext,
                                               uint8_t * pucSignature,
                                               size_t xSignatureLength );
 
+/**
+ * @brief The largest hash state written by CRYPTO_SignatureVerificationSave().
+ */
+#define cryptoSIGNATURE_VERIFICATION_STATE_BYTES    256
+
+/**
+ * @brief Saves the state of an unfinished signature verification hash.
+ *
+ * CRYPTO_SignatureVerificationRestore() continues the hash from the saved state,
+ * for example after a reset. The state is only valid for the same build of this
+ * library. The context is not changed.
+ *
+ * @param[in] pvContext Opaque context structure.
+ * @param[out] pucState Buffer of at least cryptoSIGNATURE_VERIFICATION_STATE_BYTES
+ * bytes for the state.
+ * @param[out] pxStateLength Length in bytes of the saved state.
+ *
+ * @return pdTRUE if the state was saved, or pdFALSE if the hash state can't be
+ * saved, such as when the hash is computed by hardware.
+ */
+BaseType_t CRYPTO_SignatureVerificationSave( void * pvContext,
+                                             uint8_t * pucState,
+                                             size_t * pxStateLength );
+
+/**
+ * @brief Creates a signature verification context from a state saved by
+ * CRYPTO_SignatureVerificationSave().
+ *
+ * @param[out] ppvContext Opaque context structure.
+ * @param[in] pucState The saved state.
+ * @param[in] xStateLength Length in bytes of the saved state.
+ *
+ * @return pdTRUE if the context was restored, or pdFALSE otherwise.
+ */
+BaseType_t CRYPTO_SignatureVerificationRestore( void ** ppvContext,
+                                                const uint8_t * pucState,
+                                                size_t xStateLength );
+
 #endif /* ifndef __AWS_CRYPTO__H__ */
@@ -396,3 +396,66 @@ BaseType_t CRYPTO_SignatureVerificationFinal( void * pvContext,
 
     return xResult;
 }
+
+/**
+ * @brief Saves the state of an in-progress hash. The context holds no pointers,
+ * so it is saved as is unless a hardware hash keeps part of the state elsewhere.
+ */
+BaseType_t CRYPTO_SignatureVerificationSave( void * pvContext,
+                                             uint8_t * pucState,
+                                             size_t * pxStateLength )
+{
+    BaseType_t xResult = pdFALSE;
+
+    #if !defined( MBEDTLS_SHA1_ALT ) && !defined( MBEDTLS_SHA256_ALT )
+        if( ( pvContext != NULL ) &&
+            ( pucState != NULL ) &&
+            ( pxStateLength != NULL ) &&
+            ( sizeof( SignatureVerificationState_t ) <= ( size_t ) cryptoSIGNATURE_VERIFICATION_STATE_BYTES ) )
+        {
+            memcpy( pucState, pvContext, sizeof( SignatureVerificationState_t ) );
+            *pxStateLength = sizeof( SignatureVerificationState_t );
+            xResult = pdTRUE;
+        }
+    #else
+        ( void ) pvContext;
+        ( void ) pucState;
+        ( void ) pxStateLength;
+    #endif
+
+    return xResult;
+}
+
+/**
+ * @brief Continues an in-progress hash from a saved state.
+ */
+BaseType_t CRYPTO_SignatureVerificationRestore( void ** ppvContext,
+                                                const uint8_t * pucState,
+                                                size_t xStateLength )
+{
+    BaseType_t xResult = pdFALSE;
+    SignatureVerificationState_t * pxCtx = NULL;
+
+    #if !defined( MBEDTLS_SHA1_ALT ) && !defined( MBEDTLS_SHA256_ALT )
+        if( ( ppvContext != NULL ) &&
+            ( pucState != NULL ) &&
+            ( xStateLength == sizeof( SignatureVerificationState_t ) ) )
+        {
+            pxCtx = ( SignatureVerificationStatePtr_t ) pvPortMalloc( sizeof( *pxCtx ) ); /*lint !e9087 Allow casting void* to other types. */
+
+            if( pxCtx != NULL )
+            {
+                memcpy( pxCtx, pucState, sizeof( *pxCtx ) );
+                *ppvContext = pxCtx;
+                xResult = pdTRUE;
+            }
+        }
+    #else
+        ( void ) ppvContext;
+        ( void ) pucState;
+        ( void ) xStateLength;
+        ( void ) pxCtx;
+    #endif
+
+    return xResult;
+}
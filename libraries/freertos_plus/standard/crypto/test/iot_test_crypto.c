@@ -280,4 +280,67 @@ TEST( Full_CRYPTO, VerifySignatureTestVectors )
         sizeof( ucECDSA_SHA256Signature ) );
     TEST_ASSERT_FALSE( xResult );
     /** @}*/
+
+    /** \brief Verify an ECDSA signature with a hash saved and restored halfway.
+     *  @{
+     */
+    {
+        uint8_t ucState[ cryptoSIGNATURE_VERIFICATION_STATE_BYTES ];
+        size_t xStateLength = 0;
+
+        /* Undo the bit flip of the previous test. */
+        ucECDSA_SHA256Signature[ 0 ] = ~ucECDSA_SHA256Signature[ 0 ];
+
+        xResult = CRYPTO_SignatureVerificationStart(
+            &pvSignatureVerificationContext,
+            cryptoASYMMETRIC_ALGORITHM_ECDSA,
+            cryptoHASH_ALGORITHM_SHA256 );
+        TEST_ASSERT_TRUE( xResult );
+
+        CRYPTO_SignatureVerificationUpdate(
+            pvSignatureVerificationContext,
+            ucDataToSign,
+            sizeof( ucDataToSign ) / 2 );
+
+        xResult = CRYPTO_SignatureVerificationSave(
+            pvSignatureVerificationContext,
+            ucState,
+            &xStateLength );
+
+        /* Free the original context, as a reset would. */
+        ( void ) CRYPTO_SignatureVerificationFinal( pvSignatureVerificationContext, NULL, 0, NULL, 0 );
+        pvSignatureVerificationContext = NULL;
+
+        if( xResult == pdFALSE )
+        {
+            TEST_IGNORE_MESSAGE( "The hash state can't be saved on this platform." );
+        }
+
+        xResult = CRYPTO_SignatureVerificationRestore(
+            &pvSignatureVerificationContext,
+            ucState,
+            xStateLength );
+        TEST_ASSERT_TRUE( xResult );
+
+        CRYPTO_SignatureVerificationUpdate(
+            pvSignatureVerificationContext,
+            &ucDataToSign[ sizeof( ucDataToSign ) / 2 ],
+            sizeof( ucDataToSign ) - ( sizeof( ucDataToSign ) / 2 ) );
+
+        xResult = CRYPTO_SignatureVerificationFinal(
+            pvSignatureVerificationContext,
+            cSignerCertificateECDSA,
+            sizeof( cSignerCertificateECDSA ),
+            ucECDSA_SHA256Signature,
+            sizeof( ucECDSA_SHA256Signature ) );
+        TEST_ASSERT_TRUE( xResult );
+
+        /* A state of the wrong size is rejected. */
+        xResult = CRYPTO_SignatureVerificationRestore(
+            &pvSignatureVerificationContext,
+            ucState,
+            xStateLength - 1 );
+        TEST_ASSERT_FALSE( xResult );
+    }
+    /** @}*/
 }
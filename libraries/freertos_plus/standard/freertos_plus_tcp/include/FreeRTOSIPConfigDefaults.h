@@ -557,4 +557,62 @@ connections, hang protection can help reduce the impact of SYN floods. */
 	#define ipconfigPACKET_FILLER_SIZE 2
 #endif
 
+/* When not 0, bound sockets are also kept in this many hash buckets, so that
+a received packet finds its socket without walking the lists of bound sockets.
+A TCP socket is hashed on its local port and the remote IP address and port, a
+UDP socket on its local port only.  Each bucket costs one List_t per protocol,
+and each socket one ListItem_t. */
+#ifndef ipconfigSOCKET_HASH_BUCKETS
+	#define ipconfigSOCKET_HASH_BUCKETS 0
+#endif
+
+#if( ( ipconfigSOCKET_HASH_BUCKETS & ( ipconfigSOCKET_HASH_BUCKETS - 1 ) ) != 0 )
+	#error ipconfigSOCKET_HASH_BUCKETS must be 0 or a power of 2.
+#endif
+
+/* When 1, the TCP sockets that wait for a time-out are kept in a heap that is
+ordered on the moment their time-out expires.  xTCPTimerCheck() then only
+visits the sockets whose time-out has expired, and the sockets that have events
+for their owner, in stead of every bound TCP socket.  The heap is an array of
+pointers which grows while TCP sockets are created, so FreeRTOS_socket() fails
+when the array can not grow.  Each TCP socket costs two ListItem_t and a
+UBaseType_t. */
+#ifndef ipconfigUSE_TCP_TIMER_HEAP
+	#define ipconfigUSE_TCP_TIMER_HEAP 0
+#endif
+
+/* The congestion control of the TCP sliding window (ipconfigUSE_TCP_WIN == 1).
+0 only limits the data in flight to the peer's window and to the Tx window of
+the socket.  1 adds a congestion window that is managed by NewReno (RFC 5681
+and RFC 6582), 2 uses TCP Vegas, which also keeps the congestion window small
+when the round-trip time grows because a queue is filling up.  With 1 or 2, a
+retransmission time-out lets all outstanding data be resent in slow start, in
+stead of every segment on its own timer. */
+#ifndef ipconfigTCP_CONGESTION_CONTROL
+	#define ipconfigTCP_CONGESTION_CONTROL 0
+#endif
+
+/* The limits of the retransmission time-out (RTO), which is calculated from
+the measured round-trip time as in RFC 6298.  The RTO doubles with every
+retransmission of a segment, up to ipconfigTCP_RTO_MAX_MS. */
+#ifndef ipconfigTCP_RTO_MIN_MS
+	#define ipconfigTCP_RTO_MIN_MS 200
+#endif
+
+#ifndef ipconfigTCP_RTO_MAX_MS
+	#define ipconfigTCP_RTO_MAX_MS 60000
+#endif
+
+/* The number of blocks in the Selective ACK (SACK) option that is sent when
+data arrives out of order, from 1 to 4.  Each extra block makes the TCP header
+of every network buffer 8 bytes longer.  RFC 2018 advises 3 blocks, so that a
+sender still learns about a block when one or two ACKs get lost. */
+#ifndef ipconfigTCP_SACK_BLOCKS
+	#define ipconfigTCP_SACK_BLOCKS 3
+#endif
+
+#if( ( ipconfigTCP_SACK_BLOCKS < 1 ) || ( ipconfigTCP_SACK_BLOCKS > 4 ) )
+	#error ipconfigTCP_SACK_BLOCKS must be between 1 and 4.
+#endif
+
 #endif /* FREERTOS_DEFAULT_IP_CONFIG_H */
@@ -149,7 +149,7 @@ struct xTCP_HEADER
 	uint16_t usUrgent;			/* +  2 = 20 */
 #if ipconfigUSE_TCP == 1
 	/* the option data is not a part of the TCP header */
-	uint8_t  ucOptdata[ipSIZE_TCP_OPTIONS];		/* + 12 = 32 */
+	uint8_t  ucOptdata[ipSIZE_TCP_OPTIONS];		/* + 12 = 32, or with ipconfigUSE_TCP_WIN + 8 + 8 per SACK block = 52 by default */
 #endif
 }
 #include "pack_struct_end.h"
@@ -552,6 +552,11 @@ BaseType_t xIPIsNetworkTaskReady( void );
 		#if( ipconfigTCP_HANG_PROTECTION == 1 )
 			TickType_t xLastActTime;
 		#endif /* ipconfigTCP_HANG_PROTECTION */
+		#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+			UBaseType_t uxTimerIndex;	/* Position in the timer heap plus one, 0 while usTimeout is 0 */
+			ListItem_t xTimerListItem;	/* Its value is the tick count at which usTimeout expires */
+			ListItem_t xWakeUpListItem;	/* Used while xEventBits wait to be passed to the owner */
+		#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 		size_t uxLittleSpace;
 		size_t uxEnoughSpace;
 		size_t uxRxStreamSize;
@@ -617,6 +622,9 @@ typedef struct XSOCKET
 	EventGroupHandle_t xEventGroup;
 
 	ListItem_t xBoundSocketListItem; /* Used to reference the socket from a bound sockets list. */
+	#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+		ListItem_t xHashListItem; /* Used to reference the socket from a hash bucket, its value is the hash. */
+	#endif
 	TickType_t xReceiveBlockTime; /* if recv[to] is called while no data is available, wait this amount of time. Unit in clock-ticks */
 	TickType_t xSendBlockTime; /* if send[to] is called while there is not enough space to send, wait this amount of time. Unit in clock-ticks */
 
@@ -663,6 +671,15 @@ typedef struct XSOCKET
 
 #endif /* ipconfigUSE_TCP */
 
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigSOCKET_HASH_BUCKETS != 0 ) )
+	/*
+	 * Move a bound TCP socket to the hash bucket of its current address.
+	 * Called after the state or the remote address of the socket has changed.
+	 */
+	void vSocketRehash( FreeRTOS_Socket_t *pxSocket );
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigSOCKET_HASH_BUCKETS != 0 ) */
+
 /*
  * Look up a local socket by finding a match with the local port.
  */
@@ -710,6 +727,31 @@ int32_t lTCPAddRxdata(FreeRTOS_Socket_t *pxSocket, size_t uxOffset, const uint8_
  */
 void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket );
 
+#if( ipconfigUSE_TCP == 1 )
+
+	#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+
+		/*
+		 * Set the number of ticks after which the socket needs attention, or 0
+		 * when it needs no attention.  This also moves the socket in the timer
+		 * heap.
+		 */
+		void vSocketSetTCPTimeout( FreeRTOS_Socket_t *pxSocket, uint16_t usTimeout );
+
+		/*
+		 * Let xTCPTimerCheck() pass the socket's xEventBits to its owner.
+		 */
+		void vSocketWakeUpLater( FreeRTOS_Socket_t *pxSocket );
+
+	#else
+
+		#define vSocketSetTCPTimeout( pxSocket, usTimeoutTicks ) \
+			( ( pxSocket )->u.xTCP.usTimeout = ( usTimeoutTicks ) )
+
+	#endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
+#endif /* ipconfigUSE_TCP */
+
 /*
  * Some helping function, their meaning should be clear
  */
@@ -93,7 +93,9 @@ standard.  See the documentation of FreeRTOS_socket() for more information. */
 /* A bit value that can be passed into the FreeRTOS_sendto() function as part of
 the flags parameter.  Setting the FREERTOS_ZERO_COPY in the flags parameter
 indicates that the zero copy interface is being used.  See the documentation for
-FreeRTOS_sockets() for more information. */
+FreeRTOS_sockets() for more information.  FreeRTOS_send() and FreeRTOS_sendv()
+accept the same flag: the data has then been written at the position returned
+by FreeRTOS_get_tx_head(). */
 #define FREERTOS_ZERO_COPY		( 1 )
 
 /* Values that can be passed in the option name parameter of calls to
@@ -162,6 +164,13 @@ typedef struct xLOW_HIGH_WATER {
 	size_t uxEnoughSpace;	/* Send a GO when buffer space grows above X bytes */
 } LowHighWater_t;
 
+/* One element of the vector that is passed to FreeRTOS_sendv(). */
+struct freertos_iovec
+{
+	const void *iov_base;	/* Start of the data. */
+	size_t iov_len;			/* Number of bytes. */
+};
+
 /* For compatibility with the expected Berkeley sockets naming. */
 #define socklen_t uint32_t
 
@@ -241,6 +250,7 @@ BaseType_t FreeRTOS_connect( Socket_t xClientSocket, struct freertos_sockaddr *p
 BaseType_t FreeRTOS_listen( Socket_t xSocket, BaseType_t xBacklog );
 BaseType_t FreeRTOS_recv( Socket_t xSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags );
 BaseType_t FreeRTOS_send( Socket_t xSocket, const void *pvBuffer, size_t uxDataLength, BaseType_t xFlags );
+BaseType_t FreeRTOS_sendv( Socket_t xSocket, const struct freertos_iovec *pxVector, size_t uxVectorLength, BaseType_t xFlags );
 Socket_t FreeRTOS_accept( Socket_t xServerSocket, struct freertos_sockaddr *pxAddress, socklen_t *pxAddressLength );
 BaseType_t FreeRTOS_shutdown (Socket_t xSocket, BaseType_t xHow);
 
@@ -291,6 +301,8 @@ FreeRTOS_rx_size(). */
  * For advanced applications only:
  * Get a direct pointer to the circular transmit buffer.
  * '*pxLength' will contain the number of bytes that may be written.
+ * After writing, pass the number of bytes to FreeRTOS_send() with the flag
+ * FREERTOS_ZERO_COPY.
  */
 uint8_t *FreeRTOS_get_tx_head( Socket_t xSocket, BaseType_t *pxLength );
 
@@ -58,7 +58,8 @@ typedef struct xTCP_SEGMENT
 				ucDupAckCount : 8,	/* Counts the number of times that a higher segment was ACK'd. After 3 times a Fast Retransmission takes place */
 				bOutstanding : 1,	/* It the peer's turn, we're just waiting for an ACK */
 				bAcked : 1,			/* This segment has been acknowledged */
-				bIsForRx : 1;		/* pdTRUE if segment is used for reception */
+				bIsForRx : 1,		/* pdTRUE if segment is used for reception */
+				bInFlight : 1;		/* Counted in ulBytesInFlight: sent, but not yet acknowledged or considered lost */
 		} bits;
 		uint32_t ulFlags;
 	} u;
@@ -78,13 +79,41 @@ typedef struct xTCP_WINSIZE
  * If TCP time-stamps are being used, they will occupy 12 bytes in
  * each packet, and thus the message space will become smaller
  */
-/* Keep this as a multiple of 4 */
+/* Keep this as a multiple of 4.  With ipconfigUSE_TCP_WIN, it must also hold
+the SACK option: 2 NOP's, kind, length and 8 bytes per block. */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	#define ipSIZE_TCP_OPTIONS	16u
+	#define ipSIZE_TCP_OPTIONS	( 8u + ( 8u * ipconfigTCP_SACK_BLOCKS ) )
 #else
 	#define ipSIZE_TCP_OPTIONS   12u
 #endif
 
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+	/*
+	 * A congestion control algorithm.  The sliding window counts the bytes in
+	 * flight, detects losses and runs the loss recovery.  The algorithm decides
+	 * how the congestion window opens, and how far it closes after a loss.
+	 */
+	struct xTCP_WINDOW;
+
+	typedef struct xTCP_CONGESTION_CONTROL
+	{
+		/* The window has been initialised, ulCongestionWindow and
+		ulSlowStartThreshold have their initial values. */
+		void ( *vInit )( struct xTCP_WINDOW *pxWindow );
+		/* A round-trip time of ulRTT ms has been measured.  May be NULL. */
+		void ( *vRTTSample )( struct xTCP_WINDOW *pxWindow, uint32_t ulRTT );
+		/* ulAcked bytes of new data have been acknowledged, outside a loss
+		recovery. */
+		void ( *vAcked )( struct xTCP_WINDOW *pxWindow, uint32_t ulAcked );
+		/* A loss has been detected, either by SACK's or by a retransmission
+		time-out.  Returns the new slow start threshold. */
+		uint32_t ( *ulLoss )( struct xTCP_WINDOW *pxWindow, BaseType_t xTimeout );
+	} TCPCongestionControl_t;
+
+	extern const TCPCongestionControl_t xTCPCongestionNewReno;
+	extern const TCPCongestionControl_t xTCPCongestionVegas;
+#endif
+
 /*
  *	Every TCP connection owns a TCP window for the administration of all packets
  *	It owns two sets of segment descriptors, incoming and outgoing
@@ -98,8 +127,12 @@ typedef struct xTCP_WINDOW
 			uint32_t
 				bHasInit : 1,		/* The window structure has been initialised */
 				bSendFullSize : 1,	/* May only send packets with a size equal to MSS (for optimisation) */
-				bTimeStamps : 1;	/* Socket is supposed to use TCP time-stamps. This depends on the */
-		} bits;						/* party which opens the connection */
+				bTimeStamps : 1,	/* Socket is supposed to use TCP time-stamps. This depends on the */
+									/* party which opens the connection */
+				bHasRTT : 1,		/* lSRTT and lRTTVar have been set by a first RTT measurement */
+				bInRecovery : 1,	/* A loss was detected by SACK's, until ulRecoverSequenceNumber is ACK'd */
+				bRetransmitNow : 1;	/* The first retransmission of a loss recovery may exceed the congestion window */
+		} bits;
 		uint32_t ulFlags;
 	} u;
 	TCPWinSize_t xSize;
@@ -116,7 +149,9 @@ typedef struct xTCP_WINDOW
 	uint32_t ulOurSequenceNumber;		/* The SEQ number we're sending out */
 	uint32_t ulUserDataLength;			/* Number of bytes in Rx buffer which may be passed to the user, after having received a 'missing packet' */
 	uint32_t ulNextTxSequenceNumber;	/* The sequence number given to the next byte to be added for transmission */
-	int32_t lSRTT;						/* Smoothed Round Trip Time, it may increment quickly and it decrements slower */
+	int32_t lSRTT;						/* Smoothed Round Trip Time in ms, see RFC 6298 */
+	int32_t lRTTVar;					/* Variation of the Round Trip Time in ms */
+	int32_t lRTO;						/* Retransmission time-out in ms, before backing off */
 	uint8_t ucOptionLength;				/* Number of valid bytes in ulOptionsData[] */
 #if( ipconfigUSE_TCP_WIN == 1 )
 	List_t xPriorityQueue;				/* Priority queue: segments which must be sent immediately */
@@ -126,6 +161,19 @@ typedef struct xTCP_WINDOW
 	uint32_t ulOptionsData[ipSIZE_TCP_OPTIONS/sizeof(uint32_t)];	/* Contains the options we send out */
 	List_t xTxSegments;					/* A linked list of all transmission segments, sorted on sequence number */
 	List_t xRxSegments;					/* A linked list of reception segments, order depends on sequence of arrival */
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		const TCPCongestionControl_t *pxCongestion;	/* The algorithm that manages ulCongestionWindow */
+		uint32_t ulCongestionWindow;		/* cwnd: the maximum number of bytes in flight */
+		uint32_t ulSlowStartThreshold;		/* ssthresh: below it, cwnd grows by one MSS per MSS acknowledged */
+		uint32_t ulBytesInFlight;			/* pipe: the bytes sent, not yet acknowledged and not considered lost */
+		uint32_t ulRecoverSequenceNumber;	/* recover: the highest sequence number sent when a loss was detected */
+		struct
+		{
+			uint32_t ulBaseRTT;				/* The lowest RTT of the connection, in ms */
+			uint32_t ulMinRTT;				/* The lowest RTT of the current round trip, in ms */
+			uint32_t ulRoundEnd;			/* The round trip ends when this sequence number is ACK'd */
+		} xVegas;
+	#endif
 #else
 	/* For tiny TCP, there is only 1 outstanding TX segment */
 	TCPSegment_t xTxSegment;			/* Priority queue */
@@ -110,6 +110,63 @@ static uint16_t prvGetPrivatePortNumber( BaseType_t xProtocol );
  */
 static const ListItem_t * pxListFindListItemWithValue( const List_t *pxList, TickType_t xWantedItemValue );
 
+#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+
+	/*
+	 * Hash a local port and a remote address.  The hash is the item value of
+	 * the socket's xHashListItem, its low bits select the bucket.
+	 */
+	static TickType_t prvSocketHash( uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort );
+
+	/*
+	 * Return the hash of the current address of a bound socket.
+	 */
+	static TickType_t prvSocketHashOf( const FreeRTOS_Socket_t *pxSocket );
+
+	/*
+	 * Add a bound socket to the hash bucket of its current address.
+	 */
+	static void prvSocketHashInsert( FreeRTOS_Socket_t *pxSocket );
+
+#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigSOCKET_HASH_BUCKETS != 0 ) )
+
+	/*
+	 * Search a TCP hash bucket: for a listening socket on usLocalPort when
+	 * xListening is true, otherwise for a connection with the remote address.
+	 */
+	static FreeRTOS_Socket_t *prvTCPHashFind( TickType_t xHash, uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort, BaseType_t xListening );
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigSOCKET_HASH_BUCKETS != 0 ) */
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) )
+
+	/*
+	 * Make sure that the timer heap has a place for one more TCP socket, and
+	 * count that socket.  Returns pdFAIL when the heap could not grow.
+	 */
+	static BaseType_t prvTCPTimerReserve( void );
+
+	/*
+	 * Return pdTRUE when the tick count xA comes before xB, also when the tick
+	 * count has wrapped in between.
+	 */
+	static BaseType_t prvTCPTimerBefore( TickType_t xA, TickType_t xB );
+
+	/*
+	 * Move the socket at position uxIndex (1 is the top) up or down the timer
+	 * heap, until the heap is ordered again.
+	 */
+	static void prvTCPTimerSift( UBaseType_t uxIndex );
+
+	/*
+	 * Take a socket out of the timer heap, if it is in the heap.
+	 */
+	static void prvTCPTimerRemove( FreeRTOS_Socket_t *pxSocket );
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) */
+
 /*
  * Return pdTRUE only if pxSocket is valid and bound, as far as can be
  * determined.
@@ -137,6 +194,17 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain, BaseType_t xType,
 	static int32_t prvTCPSendCheck( FreeRTOS_Socket_t *pxSocket, size_t xDataLength );
 #endif /* ipconfigUSE_TCP */
 
+#if( ipconfigUSE_TCP == 1 )
+	/*
+	 * Called from FreeRTOS_sendv(): add up to 'uxCount' bytes of a vector to
+	 * txStream, starting at the element and offset that '*puxIndex' and
+	 * '*puxOffset' point to.  When 'xZeroCopy' is true, the bytes are already in
+	 * txStream, and only uxHead is advanced.
+	 */
+	static size_t prvTCPAddVector( StreamBuffer_t *pxStream, const struct freertos_iovec *pxVector, size_t uxVectorLength,
+		size_t *puxIndex, size_t *puxOffset, size_t uxCount, BaseType_t xZeroCopy );
+#endif /* ipconfigUSE_TCP */
+
 #if( ipconfigUSE_TCP == 1 )
 	/*
 	 * When a child socket gets closed, make sure to update the child-count of the parent
@@ -168,6 +236,36 @@ List_t xBoundUDPSocketsList;
 	List_t xBoundTCPSocketsList;
 #endif /* ipconfigUSE_TCP == 1 */
 
+#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+	/* The bound sockets again, spread over buckets by prvSocketHash().  The
+	buckets are changed under the same protection as the lists above.  A TCP
+	socket also moves to another bucket when a task connects it or makes it
+	listen, so the IP-task suspends the scheduler while it walks a TCP
+	bucket. */
+	static List_t xUDPSocketHashBuckets[ ipconfigSOCKET_HASH_BUCKETS ];
+
+	#if ipconfigUSE_TCP == 1
+		static List_t xTCPSocketHashBuckets[ ipconfigSOCKET_HASH_BUCKETS ];
+	#endif /* ipconfigUSE_TCP == 1 */
+#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) )
+	/* The TCP sockets with a time-out, as a binary heap: a socket never expires
+	before its parent, so the first socket expires first.  The array has a place
+	for every TCP socket, so adding a socket to the heap never allocates.  All
+	tasks, the IP-task included, suspend the scheduler while they use the heap
+	or the list below: a task that owns a socket may have a priority at or above
+	the priority of the IP-task. */
+	static FreeRTOS_Socket_t **ppxTCPTimerHeap = NULL;
+	static UBaseType_t uxTCPTimerCount = 0u;	/* The number of sockets in the heap. */
+	static UBaseType_t uxTCPTimerSize = 0u;		/* The number of places in ppxTCPTimerHeap. */
+	static UBaseType_t uxTCPSocketCount = 0u;	/* The number of TCP sockets that exist. */
+
+	/* The TCP sockets whose xEventBits will be passed to their owner when the
+	IP-task goes to sleep. */
+	static List_t xTCPWakeUpList;
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) */
+
 /*-----------------------------------------------------------*/
 
 static BaseType_t prvValidSocket( FreeRTOS_Socket_t *pxSocket, BaseType_t xProtocol, BaseType_t xIsBound )
@@ -200,9 +298,32 @@ BaseType_t vNetworkSocketsInit( void )
 	#if( ipconfigUSE_TCP == 1 )
 	{
 		vListInitialise( &xBoundTCPSocketsList );
+
+		#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+		{
+			vListInitialise( &xTCPWakeUpList );
+		}
+		#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 	}
 	#endif  /* ipconfigUSE_TCP == 1 */
 
+	#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+	{
+	UBaseType_t uxBucket;
+
+		for( uxBucket = 0u; uxBucket < ( UBaseType_t ) ipconfigSOCKET_HASH_BUCKETS; uxBucket++ )
+		{
+			vListInitialise( &( xUDPSocketHashBuckets[ uxBucket ] ) );
+
+			#if( ipconfigUSE_TCP == 1 )
+			{
+				vListInitialise( &( xTCPSocketHashBuckets[ uxBucket ] ) );
+			}
+			#endif  /* ipconfigUSE_TCP == 1 */
+		}
+	}
+	#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 	return pdTRUE;
 }
 /*-----------------------------------------------------------*/
@@ -297,6 +418,16 @@ Socket_t xReturn;
 			pxSocket = ( FreeRTOS_Socket_t * ) FREERTOS_INVALID_SOCKET;
 			iptraceFAILED_TO_CREATE_EVENT_GROUP();
 		}
+		#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) )
+		else if( ( xProtocol == FREERTOS_IPPROTO_TCP ) && ( prvTCPTimerReserve() == pdFAIL ) )
+		{
+			/* The timer heap has no place for the socket. */
+			vEventGroupDelete( xEventGroup );
+			vPortFreeSocket( pxSocket );
+			pxSocket = ( FreeRTOS_Socket_t * ) FREERTOS_INVALID_SOCKET;
+			iptraceFAILED_TO_CREATE_SOCKET();
+		}
+		#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) */
 		else
 		{
 			/* Clear the entire space to avoid nulling individual entries */
@@ -321,6 +452,13 @@ Socket_t xReturn;
 			vListInitialiseItem( &( pxSocket->xBoundSocketListItem ) );
 			listSET_LIST_ITEM_OWNER( &( pxSocket->xBoundSocketListItem ), ( void * ) pxSocket );
 
+			#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+			{
+				vListInitialiseItem( &( pxSocket->xHashListItem ) );
+				listSET_LIST_ITEM_OWNER( &( pxSocket->xHashListItem ), ( void * ) pxSocket );
+			}
+			#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 			pxSocket->xReceiveBlockTime = ipconfigSOCK_DEFAULT_RECEIVE_BLOCK_TIME;
 			pxSocket->xSendBlockTime	= ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
 			pxSocket->ucSocketOptions   = ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT;
@@ -350,6 +488,15 @@ Socket_t xReturn;
 					/* The above values are just defaults, and can be overridden by
 					calling FreeRTOS_setsockopt().  No buffers will be allocated until a
 					socket is connected and data is exchanged. */
+
+					#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+					{
+						vListInitialiseItem( &( pxSocket->u.xTCP.xTimerListItem ) );
+						listSET_LIST_ITEM_OWNER( &( pxSocket->u.xTCP.xTimerListItem ), ( void * ) pxSocket );
+						vListInitialiseItem( &( pxSocket->u.xTCP.xWakeUpListItem ) );
+						listSET_LIST_ITEM_OWNER( &( pxSocket->u.xTCP.xWakeUpListItem ), ( void * ) pxSocket );
+					}
+					#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 				}
 			}
 			#endif  /* ipconfigUSE_TCP == 1 */
@@ -1059,6 +1206,12 @@ List_t *pxSocketList;
 				/* Add the socket to 'xBoundUDPSocketsList' or 'xBoundTCPSocketsList' */
 				vListInsertEnd( pxSocketList, &( pxSocket->xBoundSocketListItem ) );
 
+				#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+				{
+					prvSocketHashInsert( pxSocket );
+				}
+				#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 				#if( ipconfigETHERNET_DRIVER_FILTERS_PACKETS == 1 )
 				{
 					xTaskResumeAll();
@@ -1173,6 +1326,29 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 			/* In case this is a child socket, make sure the child-count of the
 			parent socket is decreased. */
 			prvTCPSetSocketCount( pxSocket );
+
+			#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+			{
+				/* Give up the socket's place in the timer heap. */
+				vTaskSuspendAll();
+				{
+					prvTCPTimerRemove( pxSocket );
+
+					if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xTimerListItem ) ) != NULL )
+					{
+						( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerListItem ) );
+					}
+
+					if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xWakeUpListItem ) ) != NULL )
+					{
+						( void ) uxListRemove( &( pxSocket->u.xTCP.xWakeUpListItem ) );
+					}
+
+					uxTCPSocketCount--;
+				}
+				( void ) xTaskResumeAll();
+			}
+			#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 		}
 	}
 	#endif  /* ipconfigUSE_TCP == 1 */
@@ -1192,6 +1368,12 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 
 		uxListRemove( &( pxSocket->xBoundSocketListItem ) );
 
+		#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+		{
+			uxListRemove( &( pxSocket->xHashListItem ) );
+		}
+		#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 		#if( ipconfigETHERNET_DRIVER_FILTERS_PACKETS == 1 )
 		{
 			xTaskResumeAll();
@@ -1603,7 +1785,7 @@ FreeRTOS_Socket_t *pxSocket;
 						( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
 						( FreeRTOS_outstanding( pxSocket ) != 0 ) )
 					{
-						pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bSendFullSize */
+						vSocketSetTCPTimeout( pxSocket, 1u ); /* to set/clear bSendFullSize */
 						xSendEventToIPTask( eTCPTimerEvent );
 					}
 				}
@@ -1627,7 +1809,7 @@ FreeRTOS_Socket_t *pxSocket;
 					}
 
 					pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
-					pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bRxStopped */
+					vSocketSetTCPTimeout( pxSocket, 1u ); /* to set/clear bRxStopped */
 					xSendEventToIPTask( eTCPTimerEvent );
 				}
 				xReturn = 0;
@@ -1746,23 +1928,123 @@ const ListItem_t * pxResult = NULL;
 
 /*-----------------------------------------------------------*/
 
+#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+
+	static TickType_t prvSocketHash( uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort )
+	{
+	uint32_t ulHash;
+
+		ulHash = ulRemoteIP ^ ( ( ( uint32_t ) usRemotePort ) << 16 ) ^ ( uint32_t ) usLocalPort;
+
+		/* Multiplicative hashing mixes every input bit into the high bits.
+		Fold them down, as the bucket is selected with the low bits. */
+		ulHash *= 0x9E3779B1ul;
+		ulHash ^= ulHash >> 16;
+
+		return ( TickType_t ) ulHash;
+	}
+	/*-----------------------------------------------------------*/
+
+	static TickType_t prvSocketHashOf( const FreeRTOS_Socket_t *pxSocket )
+	{
+	TickType_t xHash;
+
+		#if( ipconfigUSE_TCP == 1 )
+		if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+		{
+			/* The lookup finds a listening socket through its port only,
+			whatever remote address is left from an earlier connection. */
+			if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+			{
+				xHash = prvSocketHash( pxSocket->usLocalPort, 0ul, 0u );
+			}
+			else
+			{
+				xHash = prvSocketHash( pxSocket->usLocalPort, pxSocket->u.xTCP.ulRemoteIP, pxSocket->u.xTCP.usRemotePort );
+			}
+		}
+		else
+		#endif /* ipconfigUSE_TCP */
+		{
+			/* UDP sockets are looked up with the port in network byte order,
+			as it is stored in xBoundSocketListItem. */
+			xHash = prvSocketHash( ( uint16_t ) socketGET_SOCKET_PORT( pxSocket ), 0ul, 0u );
+		}
+
+		return xHash;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvSocketHashInsert( FreeRTOS_Socket_t *pxSocket )
+	{
+	TickType_t xHash = prvSocketHashOf( pxSocket );
+	List_t *pxBuckets = xUDPSocketHashBuckets;
+
+		#if( ipconfigUSE_TCP == 1 )
+		if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+		{
+			pxBuckets = xTCPSocketHashBuckets;
+		}
+		#endif /* ipconfigUSE_TCP */
+
+		listSET_LIST_ITEM_VALUE( &( pxSocket->xHashListItem ), xHash );
+		vListInsertEnd( &( pxBuckets[ xHash & ( ( TickType_t ) ipconfigSOCKET_HASH_BUCKETS - 1u ) ] ), &( pxSocket->xHashListItem ) );
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 FreeRTOS_Socket_t *pxUDPSocketLookup( UBaseType_t uxLocalPort )
 {
-const ListItem_t *pxListItem;
 FreeRTOS_Socket_t *pxSocket = NULL;
 
-	/* Looking up a socket is quite simple, find a match with the local port.
+	#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+	{
+	TickType_t xHash = prvSocketHash( ( uint16_t ) uxLocalPort, 0ul, 0u );
+	const List_t *pxBucket = &( xUDPSocketHashBuckets[ xHash & ( ( TickType_t ) ipconfigSOCKET_HASH_BUCKETS - 1u ) ] );
+	const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( pxBucket );
+	const ListItem_t *pxIterator;
 
-	See if there is a list item associated with the port number on the
-	list of bound sockets. */
-	pxListItem = pxListFindListItemWithValue( &xBoundUDPSocketsList, ( TickType_t ) uxLocalPort );
+		/* Only the sockets of which the port has the same hash need to be
+		compared. */
+		if( xIPIsNetworkTaskReady() != pdFALSE )
+		{
+			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
+				 pxIterator != ( const ListItem_t * ) pxEnd;
+				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+			{
+				if( listGET_LIST_ITEM_VALUE( pxIterator ) == xHash )
+				{
+					FreeRTOS_Socket_t *pxCandidate = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
 
-	if( pxListItem != NULL )
+					if( socketGET_SOCKET_PORT( pxCandidate ) == ( TickType_t ) uxLocalPort )
+					{
+						pxSocket = pxCandidate;
+						break;
+					}
+				}
+			}
+		}
+	}
+	#else
 	{
-		/* The owner of the list item is the socket itself. */
-		pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxListItem );
-		configASSERT( pxSocket != NULL );
+	const ListItem_t *pxListItem;
+
+		/* Looking up a socket is quite simple, find a match with the local port.
+
+		See if there is a list item associated with the port number on the
+		list of bound sockets. */
+		pxListItem = pxListFindListItemWithValue( &xBoundUDPSocketsList, ( TickType_t ) uxLocalPort );
+
+		if( pxListItem != NULL )
+		{
+			/* The owner of the list item is the socket itself. */
+			pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxListItem );
+			configASSERT( pxSocket != NULL );
+		}
 	}
+	#endif /* ipconfigSOCKET_HASH_BUCKETS != 0 */
+
 	return pxSocket;
 }
 
@@ -1936,7 +2218,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 		vTaskSuspendAll();
 		{
-			if( ( pxListFindListItemWithValue( &xBoundUDPSocketsList, ( TickType_t ) usPortNr ) != NULL ) )
+			if( pxUDPSocketLookup( ( UBaseType_t ) usPortNr ) != NULL )
 			{
 				xFound = pdTRUE;
 			}
@@ -2015,7 +2297,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 				vTCPStateChange( pxSocket, eCONNECT_SYN );
 
 				/* To start an active connect. */
-				pxSocket->u.xTCP.usTimeout = 1u;
+				vSocketSetTCPTimeout( pxSocket, 1u );
 
 				if( xSendEventToIPTask( eTCPTimerEvent ) != pdPASS )
 				{
@@ -2378,7 +2660,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 						{
 							pxSocket->u.xTCP.bits.bLowWater = pdFALSE_UNSIGNED;
 							pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
-							pxSocket->u.xTCP.usTimeout = 1u; /* because bLowWater is cleared. */
+							vSocketSetTCPTimeout( pxSocket, 1u ); /* because bLowWater is cleared. */
 							xSendEventToIPTask( eTCPTimerEvent );
 						}
 					}
@@ -2463,6 +2745,17 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
         member pointers. */
         if( prvValidSocket( pxSocket, FREERTOS_IPPROTO_TCP, pdFALSE ) == pdTRUE )
         {
+            if( ( pxSocket->u.xTCP.txStream == NULL ) && ( pxSocket->u.xTCP.ucTCPState != eTCP_LISTEN ) )
+            {
+                /* Create the outgoing stream, so that a zero-copy send can
+                write into it before the first call to FreeRTOS_send().
+                prvTCPSendCheck() only creates it in the states in which
+                FreeRTOS_send() may add data, and a listening socket never
+                sends.  Until then, the buffer sizes can still be changed
+                with FreeRTOS_setsockopt(). */
+                ( void ) prvTCPSendCheck( pxSocket, 1u );
+            }
+
             pxBuffer = pxSocket->u.xTCP.txStream;
             if( pxBuffer != NULL )
             {
@@ -2479,13 +2772,62 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP == 1 )
+
+	static size_t prvTCPAddVector( StreamBuffer_t *pxStream, const struct freertos_iovec *pxVector, size_t uxVectorLength,
+		size_t *puxIndex, size_t *puxOffset, size_t uxCount, BaseType_t xZeroCopy )
+	{
+	size_t uxAdded = 0u;
+	size_t uxLength;
+	const uint8_t *pucSource;
+
+		while( ( uxAdded < uxCount ) && ( *puxIndex < uxVectorLength ) )
+		{
+			uxLength = pxVector[ *puxIndex ].iov_len - *puxOffset;
+
+			if( uxLength > ( uxCount - uxAdded ) )
+			{
+				uxLength = uxCount - uxAdded;
+			}
+
+			if( xZeroCopy != pdFALSE )
+			{
+				pucSource = NULL;
+			}
+			else
+			{
+				pucSource = ( ( const uint8_t * ) pxVector[ *puxIndex ].iov_base ) + *puxOffset;
+			}
+
+			uxLength = uxStreamBufferAdd( pxStream, 0u, pucSource, uxLength );
+			uxAdded += uxLength;
+			*puxOffset += uxLength;
+
+			if( *puxOffset >= pxVector[ *puxIndex ].iov_len )
+			{
+				( *puxIndex )++;
+				*puxOffset = 0u;
+			}
+			else if( uxLength == 0u )
+			{
+				/* txStream is full. */
+				break;
+			}
+		}
+
+		return uxAdded;
+	}
+
+#endif /* ipconfigUSE_TCP */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP == 1 )
 	/*
-	 * Send data using a TCP socket.  It is not necessary to have the socket
-	 * connected already.  Outgoing data will be stored and delivered as soon as
-	 * the socket gets connected.
+	 * Send the elements of a vector as one stream of data, using a TCP socket.
+	 * The elements are copied to txStream one after the other, without first
+	 * being joined in a contiguous buffer.
 	 */
-	BaseType_t FreeRTOS_send( Socket_t xSocket, const void *pvBuffer, size_t uxDataLength, BaseType_t xFlags )
+	BaseType_t FreeRTOS_sendv( Socket_t xSocket, const struct freertos_iovec *pxVector, size_t uxVectorLength, BaseType_t xFlags )
 	{
 	BaseType_t xByteCount;
 	BaseType_t xBytesLeft;
@@ -2494,10 +2836,20 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 	BaseType_t xTimed = pdFALSE;
 	TimeOut_t xTimeOut;
 	BaseType_t xCloseAfterSend;
+	BaseType_t xZeroCopy = ( ( xFlags & FREERTOS_ZERO_COPY ) != 0 ) ? pdTRUE : pdFALSE;
+	size_t uxDataLength = 0u;
+	size_t uxIndex;
+	size_t uxOffset = 0u;
 
-		/* Prevent compiler warnings about unused parameters.  The parameter
-		may be used in future versions. */
-		( void ) xFlags;
+		if( pxVector != NULL )
+		{
+			for( uxIndex = 0u; uxIndex < uxVectorLength; uxIndex++ )
+			{
+				uxDataLength += pxVector[ uxIndex ].iov_len;
+			}
+		}
+
+		uxIndex = 0u;
 
 		xByteCount = ( BaseType_t ) prvTCPSendCheck( pxSocket, uxDataLength );
 
@@ -2509,6 +2861,15 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 			/* xByteCount is number of bytes that can be sent now. */
 			xByteCount = ( BaseType_t ) uxStreamBufferGetSpace( pxSocket->u.xTCP.txStream );
 
+			if( ( xZeroCopy != pdFALSE ) && ( xBytesLeft > xByteCount ) )
+			{
+				/* The data has been written at the position returned by
+				FreeRTOS_get_tx_head(), so it can not be more than the free
+				space.  Never wait for more space. */
+				xBytesLeft = xByteCount;
+				uxDataLength = ( size_t ) xByteCount;
+			}
+
 			/* While there are still bytes to be sent. */
 			while( xBytesLeft > 0 )
 			{
@@ -2548,7 +2909,8 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 						pxSocket->u.xTCP.bits.bCloseRequested = pdTRUE_UNSIGNED;
 					}
 
-					xByteCount = ( BaseType_t ) uxStreamBufferAdd( pxSocket->u.xTCP.txStream, 0ul, ( const uint8_t * ) pvBuffer, ( size_t ) xByteCount );
+					xByteCount = ( BaseType_t ) prvTCPAddVector( pxSocket->u.xTCP.txStream, pxVector, uxVectorLength,
+						&uxIndex, &uxOffset, ( size_t ) xByteCount, xZeroCopy );
 
 					if( xCloseAfterSend != pdFALSE )
 					{
@@ -2560,7 +2922,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 					/* Send a message to the IP-task so it can work on this
 					socket.  Data is sent, let the IP-task work on it. */
-					pxSocket->u.xTCP.usTimeout = 1u;
+					vSocketSetTCPTimeout( pxSocket, 1u );
 
 					if( xIsCallingFromIPTask() == pdFALSE )
 					{
@@ -2575,10 +2937,6 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 					{
 						break;
 					}
-
-					/* As there are still bytes left to be sent, increase the
-					data pointer. */
-					pvBuffer = ( void * ) ( ( ( const uint8_t * ) pvBuffer) + xByteCount );
 				}
 
 				/* Not all bytes have been sent. In case the socket is marked as
@@ -2646,7 +3004,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 				{
 					if( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) != pdFALSE )
 					{
-						FreeRTOS_debug_printf( ( "FreeRTOS_send: %u -> %lxip:%d: no space\n",
+						FreeRTOS_debug_printf( ( "FreeRTOS_sendv: %u -> %lxip:%d: no space\n",
 							pxSocket->usLocalPort,
 							pxSocket->u.xTCP.ulRemoteIP,
 							pxSocket->u.xTCP.usRemotePort ) );
@@ -2663,6 +3021,27 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP == 1 )
+	/*
+	 * Send data using a TCP socket.  It is not necessary to have the socket
+	 * connected already.  Outgoing data will be stored and delivered as soon as
+	 * the socket gets connected.  When FREERTOS_ZERO_COPY is set in 'xFlags',
+	 * the data has already been written at the position returned by
+	 * FreeRTOS_get_tx_head(), and 'pvBuffer' is ignored.
+	 */
+	BaseType_t FreeRTOS_send( Socket_t xSocket, const void *pvBuffer, size_t uxDataLength, BaseType_t xFlags )
+	{
+	struct freertos_iovec xVector;
+
+		xVector.iov_base = pvBuffer;
+		xVector.iov_len = uxDataLength;
+
+		return FreeRTOS_sendv( xSocket, &xVector, 1u, xFlags );
+	}
+
+#endif /* ipconfigUSE_TCP */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP == 1 )
 
 	/*
@@ -2749,7 +3128,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 			pxSocket->u.xTCP.bits.bUserShutdown = pdTRUE_UNSIGNED;
 
 			/* Let the IP-task perform the shutdown of the connection. */
-			pxSocket->u.xTCP.usTimeout = 1u;
+			vSocketSetTCPTimeout( pxSocket, 1u );
 			xSendEventToIPTask( eTCPTimerEvent );
 			xResult = 0;
 		}
@@ -2761,7 +3140,307 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_TCP == 1 )
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_TCP_TIMER_HEAP != 0 ) )
+
+	/*
+	 * A TCP timer has expired, now check the TCP sockets whose time-out has
+	 * expired for:
+	 * - Active connect
+	 * - Send a delayed ACK
+	 * - Send new data
+	 * - Send a keep-alive packet
+	 * - Check for timeout (in non-connected states only)
+	 */
+	TickType_t xTCPTimerCheck( BaseType_t xWillSleep )
+	{
+	FreeRTOS_Socket_t *pxSocket;
+	TickType_t xShortest = pdMS_TO_TICKS( ( TickType_t ) ipTCP_TIMER_PERIOD_MS );
+	TickType_t xNow = xTaskGetTickCount();
+	TickType_t xExpiry;
+	List_t xExpiredList;
+
+		vListInitialise( &xExpiredList );
+
+		/* First take the expired sockets from the heap.  The list walk
+		subtracts at least one tick in every check, so a time-out of one tick
+		also expires here, e.g. after FreeRTOS_send().  A socket that gets a
+		new time-out while it is being checked, will not be checked again
+		during this call.  The sockets are checked after the scheduler is
+		resumed. */
+		vTaskSuspendAll();
+		{
+			while( ( uxTCPTimerCount != 0u ) &&
+				   ( prvTCPTimerBefore( xNow + 1u, listGET_LIST_ITEM_VALUE( &( ppxTCPTimerHeap[ 0 ]->u.xTCP.xTimerListItem ) ) ) == pdFALSE ) )
+			{
+				pxSocket = ppxTCPTimerHeap[ 0 ];
+				prvTCPTimerRemove( pxSocket );
+				pxSocket->u.xTCP.usTimeout = 0u;
+				vListInsertEnd( &xExpiredList, &( pxSocket->u.xTCP.xTimerListItem ) );
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		while( listCURRENT_LIST_LENGTH( &xExpiredList ) > 0u )
+		{
+			pxSocket = ( FreeRTOS_Socket_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xExpiredList );
+			( void ) uxListRemove( &( pxSocket->u.xTCP.xTimerListItem ) );
+
+			/* Within this function, the socket might want to send a delayed
+			ack or send out data or whatever it needs to do.  A negative
+			result means that the socket was deleted. */
+			if( ( xTCPSocketCheck( pxSocket ) >= 0 ) && ( pxSocket->xEventBits != 0u ) )
+			{
+				vSocketWakeUpLater( pxSocket );
+			}
+		}
+
+		/* In xEventBits the driver may indicate that the socket has
+		important events for the user.  These are only done just before the
+		IP-task goes to sleep.  A socket is taken from the list while the
+		scheduler is suspended, its owner is woken up while it runs. */
+		for( ;; )
+		{
+			pxSocket = NULL;
+
+			vTaskSuspendAll();
+			{
+				if( listCURRENT_LIST_LENGTH( &xTCPWakeUpList ) > 0u )
+				{
+					if( xWillSleep != pdFALSE )
+					{
+						/* The IP-task is about to go to sleep, so messages
+						can be sent to the socket owners. */
+						pxSocket = ( FreeRTOS_Socket_t * ) listGET_OWNER_OF_HEAD_ENTRY( &xTCPWakeUpList );
+						( void ) uxListRemove( &( pxSocket->u.xTCP.xWakeUpListItem ) );
+					}
+					else
+					{
+						/* Or else make sure this will be called again to
+						wake-up the sockets' owner. */
+						xShortest = ( TickType_t ) 0;
+					}
+				}
+
+				if( ( pxSocket == NULL ) && ( uxTCPTimerCount != 0u ) )
+				{
+					xExpiry = listGET_LIST_ITEM_VALUE( &( ppxTCPTimerHeap[ 0 ]->u.xTCP.xTimerListItem ) );
+
+					if( prvTCPTimerBefore( xExpiry, xNow ) != pdFALSE )
+					{
+						xShortest = ( TickType_t ) 0;
+					}
+					else if( xShortest > ( TickType_t ) ( xExpiry - xNow ) )
+					{
+						xShortest = ( TickType_t ) ( xExpiry - xNow );
+					}
+				}
+			}
+			( void ) xTaskResumeAll();
+
+			if( pxSocket == NULL )
+			{
+				break;
+			}
+
+			if( pxSocket->xEventBits != 0u )
+			{
+				vSocketWakeUpUser( pxSocket );
+			}
+		}
+
+		return xShortest;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vSocketSetTCPTimeout( FreeRTOS_Socket_t *pxSocket, uint16_t usTimeout )
+	{
+		/* FreeRTOS_send() and other API's set a time-out from the task that
+		owns the socket, the IP-task sets it while it handles a packet.
+		Neither may run while the other changes the heap. */
+		vTaskSuspendAll();
+		{
+			pxSocket->u.xTCP.usTimeout = usTimeout;
+
+			if( usTimeout == 0u )
+			{
+				prvTCPTimerRemove( pxSocket );
+			}
+			else
+			{
+				listSET_LIST_ITEM_VALUE( &( pxSocket->u.xTCP.xTimerListItem ), xTaskGetTickCount() + ( TickType_t ) usTimeout );
+
+				if( pxSocket->u.xTCP.uxTimerIndex == 0u )
+				{
+					/* prvTCPTimerReserve() made a place for every TCP socket. */
+					configASSERT( uxTCPTimerCount < uxTCPTimerSize );
+					uxTCPTimerCount++;
+					ppxTCPTimerHeap[ uxTCPTimerCount - 1u ] = pxSocket;
+					pxSocket->u.xTCP.uxTimerIndex = uxTCPTimerCount;
+				}
+
+				prvTCPTimerSift( pxSocket->u.xTCP.uxTimerIndex );
+			}
+		}
+		( void ) xTaskResumeAll();
+	}
+	/*-----------------------------------------------------------*/
+
+	void vSocketWakeUpLater( FreeRTOS_Socket_t *pxSocket )
+	{
+		/* FreeRTOS_listen() changes the state from the task that owns the
+		socket, the IP-task from a received packet or a time-out. */
+		vTaskSuspendAll();
+		{
+			if( listLIST_ITEM_CONTAINER( &( pxSocket->u.xTCP.xWakeUpListItem ) ) == NULL )
+			{
+				vListInsertEnd( &xTCPWakeUpList, &( pxSocket->u.xTCP.xWakeUpListItem ) );
+			}
+		}
+		( void ) xTaskResumeAll();
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvTCPTimerReserve( void )
+	{
+	FreeRTOS_Socket_t **ppxNewHeap;
+	UBaseType_t uxNewSize;
+	BaseType_t xResult = pdPASS;
+
+		vTaskSuspendAll();
+		{
+			if( uxTCPSocketCount >= uxTCPTimerSize )
+			{
+				/* Double the size of the array.  The sockets keep their
+				position in the heap. */
+				uxNewSize = ( uxTCPTimerSize != 0u ) ? ( 2u * uxTCPTimerSize ) : 8u;
+				ppxNewHeap = ( FreeRTOS_Socket_t ** ) pvPortMalloc( uxNewSize * sizeof( *ppxNewHeap ) );
+
+				if( ppxNewHeap == NULL )
+				{
+					xResult = pdFAIL;
+				}
+				else
+				{
+					if( ppxTCPTimerHeap != NULL )
+					{
+						memcpy( ppxNewHeap, ppxTCPTimerHeap, uxTCPTimerCount * sizeof( *ppxNewHeap ) );
+						vPortFree( ppxTCPTimerHeap );
+					}
+
+					ppxTCPTimerHeap = ppxNewHeap;
+					uxTCPTimerSize = uxNewSize;
+				}
+			}
+
+			if( xResult == pdPASS )
+			{
+				uxTCPSocketCount++;
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		return xResult;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvTCPTimerBefore( TickType_t xA, TickType_t xB )
+	{
+	BaseType_t xResult;
+
+		/* Time-outs are much shorter than half the range of TickType_t. */
+		if( ( TickType_t ) ( xA - xB ) > ( portMAX_DELAY >> 1 ) )
+		{
+			xResult = pdTRUE;
+		}
+		else
+		{
+			xResult = pdFALSE;
+		}
+
+		return xResult;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPTimerSift( UBaseType_t uxIndex )
+	{
+	FreeRTOS_Socket_t *pxSocket = ppxTCPTimerHeap[ uxIndex - 1u ];
+	TickType_t xExpiry = listGET_LIST_ITEM_VALUE( &( pxSocket->u.xTCP.xTimerListItem ) );
+	FreeRTOS_Socket_t *pxOther;
+	UBaseType_t uxChild;
+
+		/* Move up while the parent expires later. */
+		while( uxIndex > 1u )
+		{
+			pxOther = ppxTCPTimerHeap[ ( uxIndex / 2u ) - 1u ];
+
+			if( prvTCPTimerBefore( xExpiry, listGET_LIST_ITEM_VALUE( &( pxOther->u.xTCP.xTimerListItem ) ) ) == pdFALSE )
+			{
+				break;
+			}
+
+			ppxTCPTimerHeap[ uxIndex - 1u ] = pxOther;
+			pxOther->u.xTCP.uxTimerIndex = uxIndex;
+			uxIndex /= 2u;
+		}
+
+		/* Move down while a child expires earlier. */
+		for( ;; )
+		{
+			uxChild = 2u * uxIndex;
+
+			if( uxChild > uxTCPTimerCount )
+			{
+				break;
+			}
+
+			pxOther = ppxTCPTimerHeap[ uxChild - 1u ];
+
+			if( ( uxChild < uxTCPTimerCount ) &&
+				( prvTCPTimerBefore( listGET_LIST_ITEM_VALUE( &( ppxTCPTimerHeap[ uxChild ]->u.xTCP.xTimerListItem ) ),
+									 listGET_LIST_ITEM_VALUE( &( pxOther->u.xTCP.xTimerListItem ) ) ) != pdFALSE ) )
+			{
+				/* The right child expires first. */
+				uxChild++;
+				pxOther = ppxTCPTimerHeap[ uxChild - 1u ];
+			}
+
+			if( prvTCPTimerBefore( listGET_LIST_ITEM_VALUE( &( pxOther->u.xTCP.xTimerListItem ) ), xExpiry ) == pdFALSE )
+			{
+				break;
+			}
+
+			ppxTCPTimerHeap[ uxIndex - 1u ] = pxOther;
+			pxOther->u.xTCP.uxTimerIndex = uxIndex;
+			uxIndex = uxChild;
+		}
+
+		ppxTCPTimerHeap[ uxIndex - 1u ] = pxSocket;
+		pxSocket->u.xTCP.uxTimerIndex = uxIndex;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPTimerRemove( FreeRTOS_Socket_t *pxSocket )
+	{
+	UBaseType_t uxIndex = pxSocket->u.xTCP.uxTimerIndex;
+	FreeRTOS_Socket_t *pxLast;
+
+		if( uxIndex != 0u )
+		{
+			/* The last socket of the heap takes the empty place. */
+			pxLast = ppxTCPTimerHeap[ uxTCPTimerCount - 1u ];
+			uxTCPTimerCount--;
+			pxSocket->u.xTCP.uxTimerIndex = 0u;
+
+			if( pxLast != pxSocket )
+			{
+				ppxTCPTimerHeap[ uxIndex - 1u ] = pxLast;
+				pxLast->u.xTCP.uxTimerIndex = uxIndex;
+				prvTCPTimerSift( uxIndex );
+			}
+		}
+	}
+
+#elif( ipconfigUSE_TCP == 1 )
 
 	/*
 	 * A TCP timer has expired, now check all TCP sockets for:
@@ -2849,7 +3528,100 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_TCP == 1 )
+#if( ( ipconfigUSE_TCP == 1 ) && ( ipconfigSOCKET_HASH_BUCKETS != 0 ) )
+
+	void vSocketRehash( FreeRTOS_Socket_t *pxSocket )
+	{
+		/* Only bound sockets are hashed, and only a changed hash moves the
+		socket to another place. */
+		if( ( listLIST_ITEM_CONTAINER( &( pxSocket->xHashListItem ) ) != NULL ) &&
+			( prvSocketHashOf( pxSocket ) != listGET_LIST_ITEM_VALUE( &( pxSocket->xHashListItem ) ) ) )
+		{
+			/* FreeRTOS_connect() and FreeRTOS_listen() change the state from
+			the task that owns the socket.  pxTCPSocketLookup() may not walk
+			the buckets while the socket is between two of them. */
+			vTaskSuspendAll();
+			{
+				uxListRemove( &( pxSocket->xHashListItem ) );
+				prvSocketHashInsert( pxSocket );
+			}
+			( void ) xTaskResumeAll();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static FreeRTOS_Socket_t *prvTCPHashFind( TickType_t xHash, uint16_t usLocalPort, uint32_t ulRemoteIP, uint16_t usRemotePort, BaseType_t xListening )
+	{
+	const List_t *pxBucket = &( xTCPSocketHashBuckets[ xHash & ( ( TickType_t ) ipconfigSOCKET_HASH_BUCKETS - 1u ) ] );
+	const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( pxBucket );
+	const ListItem_t *pxIterator;
+	FreeRTOS_Socket_t *pxResult = NULL;
+
+		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
+			 pxIterator != ( const ListItem_t * ) pxEnd;
+			 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+		{
+			FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+			/* Other addresses may share the bucket, and even the hash. */
+			if( ( listGET_LIST_ITEM_VALUE( pxIterator ) == xHash ) && ( pxSocket->usLocalPort == usLocalPort ) )
+			{
+				if( xListening != pdFALSE )
+				{
+					if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+					{
+						pxResult = pxSocket;
+						break;
+					}
+				}
+				else if( ( pxSocket->u.xTCP.ucTCPState != eTCP_LISTEN ) &&
+						 ( pxSocket->u.xTCP.usRemotePort == usRemotePort ) &&
+						 ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
+				{
+					pxResult = pxSocket;
+					break;
+				}
+			}
+		}
+
+		return pxResult;
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * The same lookup as below, through the hash buckets.  A connected socket
+	 * is searched in the bucket of the complete address, a listening socket in
+	 * the bucket of the local port.
+	 */
+	FreeRTOS_Socket_t *pxTCPSocketLookup( uint32_t ulLocalIP, UBaseType_t uxLocalPort, uint32_t ulRemoteIP, UBaseType_t uxRemotePort )
+	{
+	FreeRTOS_Socket_t *pxResult;
+	TickType_t xHash;
+
+		/* Parameter not yet supported. */
+		( void ) ulLocalIP;
+
+		/* vSocketRehash() may move a socket to another bucket from the task
+		that owns it, which may have a higher priority than the IP-task. */
+		vTaskSuspendAll();
+		{
+			xHash = prvSocketHash( ( uint16_t ) uxLocalPort, ulRemoteIP, ( uint16_t ) uxRemotePort );
+			pxResult = prvTCPHashFind( xHash, ( uint16_t ) uxLocalPort, ulRemoteIP, ( uint16_t ) uxRemotePort, pdFALSE );
+
+			if( pxResult == NULL )
+			{
+				/* An exact match was not found, maybe there is a socket
+				listening to uxLocalPort. */
+				xHash = prvSocketHash( ( uint16_t ) uxLocalPort, 0ul, 0u );
+				pxResult = prvTCPHashFind( xHash, ( uint16_t ) uxLocalPort, 0ul, 0u, pdTRUE );
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		return pxResult;
+	}
+
+#elif( ipconfigUSE_TCP == 1 )
 
 	/*
 	 * TCP: as multiple sockets may be bound to the same local port number
@@ -3097,7 +3869,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 						pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
 
 						/* bLowWater was reached, send the changed window size. */
-						pxSocket->u.xTCP.usTimeout = 1u;
+						vSocketSetTCPTimeout( pxSocket, 1u );
 						xSendEventToIPTask( eTCPTimerEvent );
 					}
 				}
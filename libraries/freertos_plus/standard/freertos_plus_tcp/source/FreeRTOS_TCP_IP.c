@@ -1555,7 +1555,7 @@ BaseType_t bAfter  = ( BaseType_t ) NOW_CONNECTED( eTCPState );						/* Is it co
 			won't need further attention of the IP-task.
 			Setting time-out to zero means that the socket won't get checked during
 			timer events. */
-			pxSocket->u.xTCP.usTimeout = 0u;
+			vSocketSetTCPTimeout( pxSocket, 0u );
 		}
 	}
 	else
@@ -1579,6 +1579,14 @@ BaseType_t bAfter  = ( BaseType_t ) NOW_CONNECTED( eTCPState );						/* Is it co
 	/* Fill in the new state. */
 	pxSocket->u.xTCP.ucTCPState = ( uint8_t ) eTCPState;
 
+	#if( ipconfigSOCKET_HASH_BUCKETS != 0 )
+	{
+		/* A listening socket is hashed on its port only, and a socket that
+		connects has just been given a remote address. */
+		vSocketRehash( pxSocket );
+	}
+	#endif /* ipconfigSOCKET_HASH_BUCKETS */
+
 	/* touch the alive timers because moving to another state. */
 	prvTCPTouchSocket( pxSocket );
 
@@ -1607,6 +1615,17 @@ BaseType_t bAfter  = ( BaseType_t ) NOW_CONNECTED( eTCPState );						/* Is it co
 	{
 		vSocketWakeUpUser( xParent );
 	}
+
+	#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+	{
+		/* FreeRTOS_listen() and the timer also change the state, not only
+		received packets. */
+		if( pxSocket->xEventBits != 0u )
+		{
+			vSocketWakeUpLater( pxSocket );
+		}
+	}
+	#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 }
 /*-----------------------------------------------------------*/
 
@@ -1833,7 +1852,7 @@ int32_t lStreamPos;
 							pxSocket->u.xTCP.usRemotePort,
 							pxSocket->u.xTCP.ucKeepRepCount ) );
 					pxSocket->u.xTCP.bits.bSendKeepAlive = pdTRUE_UNSIGNED;
-					pxSocket->u.xTCP.usTimeout = ( ( uint16_t ) pdMS_TO_TICKS( 2500 ) );
+					vSocketSetTCPTimeout( pxSocket, ( ( uint16_t ) pdMS_TO_TICKS( 2500 ) ) );
 					pxSocket->u.xTCP.ucKeepRepCount++;
 				}
 			}
@@ -1896,7 +1915,7 @@ TickType_t ulDelayMs = ( TickType_t ) tcpMAXIMUM_TCP_WAKEUP_TIME_MS;
 		FreeRTOS_debug_printf( ( "Connect[%lxip:%u]: next timeout %u: %lu ms\n",
 			pxSocket->u.xTCP.ulRemoteIP, pxSocket->u.xTCP.usRemotePort,
 			pxSocket->u.xTCP.ucRepCount, ulDelayMs ) );
-		pxSocket->u.xTCP.usTimeout = ( uint16_t )pdMS_TO_MIN_TICKS( ulDelayMs );
+		vSocketSetTCPTimeout( pxSocket, ( uint16_t )pdMS_TO_MIN_TICKS( ulDelayMs ) );
 	}
 	else if( pxSocket->u.xTCP.usTimeout == 0u )
 	{
@@ -1917,7 +1936,7 @@ TickType_t ulDelayMs = ( TickType_t ) tcpMAXIMUM_TCP_WAKEUP_TIME_MS;
 		{
 			/* ulDelayMs contains the time to wait before a re-transmission. */
 		}
-		pxSocket->u.xTCP.usTimeout = ( uint16_t )pdMS_TO_MIN_TICKS( ulDelayMs );
+		vSocketSetTCPTimeout( pxSocket, ( uint16_t )pdMS_TO_MIN_TICKS( ulDelayMs ) );
 	}
 	else
 	{
@@ -2539,6 +2558,7 @@ int32_t lRxSpace;
 	#else
 		int32_t lMinLength;
 	#endif
+	BaseType_t xMayPostpone = pdTRUE;
 #endif
 
 	/* Set the time-out field, so that we'll be called by the IP-task in case no
@@ -2553,6 +2573,21 @@ int32_t lRxSpace;
 		}
 		#endif /* ipconfigTCP_ACK_EARLIER_PACKET */
 
+		#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		{
+			/* A peer that clocks its congestion window on the returning ACKs
+			needs an ACK for at least every second full-size segment (RFC 5681
+			section 4.2).  Do not postpone again while an ACK is already being
+			delayed. */
+			if( ( pxSocket->u.xTCP.pxAckMessage != NULL ) &&
+				( pxSocket->u.xTCP.pxAckMessage != *ppxNetworkBuffer ) &&
+				( ulReceiveLength >= ( uint32_t ) pxSocket->u.xTCP.usCurMSS ) )
+			{
+				xMayPostpone = pdFALSE;
+			}
+		}
+		#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
 		/* In case we're receiving data continuously, we might postpone sending
 		an ACK to gain performance. */
 		if( ( ulReceiveLength > 0 ) &&							/* Data was sent to this socket. */
@@ -2560,7 +2595,8 @@ int32_t lRxSpace;
 			( pxSocket->u.xTCP.bits.bFinSent == pdFALSE_UNSIGNED ) &&	/* Not in a closure phase. */
 			( xSendLength == ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) ) && /* No Tx data or options to be sent. */
 			( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) &&	/* Connection established. */
-			( pxTCPHeader->ucTCPFlags == ipTCP_FLAG_ACK ) )		/* There are no other flags than an ACK. */
+			( pxTCPHeader->ucTCPFlags == ipTCP_FLAG_ACK ) &&	/* There are no other flags than an ACK. */
+			( xMayPostpone != pdFALSE ) )
 		{
 			if( pxSocket->u.xTCP.pxAckMessage != *ppxNetworkBuffer )
 			{
@@ -2575,14 +2611,14 @@ int32_t lRxSpace;
 			if( ( ulReceiveLength < ( uint32_t ) pxSocket->u.xTCP.usCurMSS ) ||	/* Received a small message. */
 				( lRxSpace < ( int32_t ) ( 2U * pxSocket->u.xTCP.usCurMSS ) ) )	/* There are less than 2 x MSS space in the Rx buffer. */
 			{
-				pxSocket->u.xTCP.usTimeout = ( uint16_t ) pdMS_TO_MIN_TICKS( DELAYED_ACK_SHORT_DELAY_MS );
+				vSocketSetTCPTimeout( pxSocket, ( uint16_t ) pdMS_TO_MIN_TICKS( DELAYED_ACK_SHORT_DELAY_MS ) );
 			}
 			else
 			{
 				/* Normally a delayed ACK should wait 200 ms for a next incoming
 				packet.  Only wait 20 ms here to gain performance.  A slow ACK
 				for full-size message. */
-				pxSocket->u.xTCP.usTimeout = ( uint16_t ) pdMS_TO_MIN_TICKS( DELAYED_ACK_LONGER_DELAY_MS );
+				vSocketSetTCPTimeout( pxSocket, ( uint16_t ) pdMS_TO_MIN_TICKS( DELAYED_ACK_LONGER_DELAY_MS ) );
 			}
 
 			if( ( xTCPWindowLoggingLevel > 1 ) && ( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) != pdFALSE ) )
@@ -3109,6 +3145,17 @@ configASSERT(pxNetworkBuffer->pucEthernetBuffer);
 		prvTCPNextTimeout ( pxSocket );
 		/* Return pdPASS to tell that the network buffer is 'consumed'. */
 		xResult = pdPASS;
+
+		#if( ipconfigUSE_TCP_TIMER_HEAP != 0 )
+		{
+			/* xTCPTimerCheck() does not visit every socket to look for
+			events. */
+			if( pxSocket->xEventBits != 0u )
+			{
+				vSocketWakeUpLater( pxSocket );
+			}
+		}
+		#endif /* ipconfigUSE_TCP_TIMER_HEAP */
 	}
 
 	/* pdPASS being returned means the buffer has been consumed. */
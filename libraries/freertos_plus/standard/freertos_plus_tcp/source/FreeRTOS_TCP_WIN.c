@@ -50,12 +50,9 @@
 #include "NetworkBufferManagement.h"
 #include "FreeRTOS_TCP_WIN.h"
 
-/* Constants used for Smoothed Round Trip Time (SRTT). */
-#define	winSRTT_INCREMENT_NEW 		2
-#define winSRTT_INCREMENT_CURRENT 	6
-#define	winSRTT_DECREMENT_NEW 		1
-#define winSRTT_DECREMENT_CURRENT 	7
-#define winSRTT_CAP_mS				50
+/* The retransmission time-out (RTO) before the first RTT has been measured,
+see RFC 6298. */
+#define winRTO_INITIAL_mS			1000
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
@@ -63,15 +60,12 @@
 
 	#define xTCPWindowTxNew( pxWindow, ulSequenceNumber, lCount ) xTCPWindowNew( pxWindow, ulSequenceNumber, lCount, pdFALSE )
 
-	/* The code to send a single Selective ACK (SACK):
-	 * NOP (0x01), NOP (0x01), SACK (0x05), LEN (0x0a),
-	 * followed by a lower and a higher sequence number,
-	 * where LEN is 2 + 2*4 = 10 bytes. */
-	#if( ipconfigBYTE_ORDER == pdFREERTOS_BIG_ENDIAN )
-		#define OPTION_CODE_SINGLE_SACK		( 0x0101050aUL )
-	#else
-		#define OPTION_CODE_SINGLE_SACK		( 0x0a050101UL )
-	#endif
+	/* The Selective ACK (SACK) option starts with:
+	 * NOP (0x01), NOP (0x01), SACK (0x05), LEN,
+	 * followed by a lower and a higher sequence number for each block,
+	 * where LEN is 2 + 8 bytes per block. */
+	#define OPTION_CODE_NOOP			( 0x01u )
+	#define OPTION_CODE_SACK			( 0x05u )
 
 	/* Normal retransmission:
 	 * A packet will be retransmitted after a Retransmit Time-Out (RTO).
@@ -87,6 +81,18 @@
 	 */
 	#define MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW		( 4u )
 
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		/* TCP Vegas compares the congestion window with the bytes that would
+		be in flight if the RTT was as low as the lowest RTT measured.  The
+		difference is the data waiting in queues, expressed in segments.  The
+		window grows when fewer than ALPHA segments are queued, and shrinks
+		when more than BETA are queued.  Slow start ends when more than GAMMA
+		are queued. */
+		#define VEGAS_ALPHA					( 2u )
+		#define VEGAS_BETA					( 4u )
+		#define VEGAS_GAMMA					( 1u )
+	#endif
+
 #endif /* configUSE_TCP_WIN */
 /*-----------------------------------------------------------*/
 
@@ -183,10 +189,11 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 
 /*
  * An acknowledge was received.  See if some outstanding data may be removed
- * from the transmission queue(s).
+ * from the transmission queue(s).  '*pulNewlyAcked' is set to the number of
+ * bytes that had not been acknowledged before.
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast );
+	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast, uint32_t *pulNewlyAcked );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /*
@@ -197,6 +204,48 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 	static uint32_t prvTCPWindowFastRetransmit( TCPWindow_t *pxWindow, uint32_t ulFirst );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
+/*
+ * Find a received segment that ends where a block of segments starts, so the
+ * block can be extended to the left.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static TCPSegment_t *xTCPWindowRxFindEnd( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
+/*
+ * Prepare the SACK option for the blocks of data that have been received out
+ * of order.  The first block contains pxRecent, when not NULL.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static void prvTCPWindowRxSetSack( TCPWindow_t *pxWindow, const TCPSegment_t *pxRecent );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
+/*
+ * Update the smoothed RTT and the retransmission time-out with a new
+ * measurement, as in RFC 6298.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static void prvTCPWindowRTTSample( TCPWindow_t *pxWindow, int32_t lRTT );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
+/*
+ * The time after which a segment must be retransmitted, in ms.  It doubles
+ * with every transmission of the segment.
+ */
+static uint32_t prvTCPWindowRTO( const TCPWindow_t *pxWindow, const TCPSegment_t *pxSegment );
+
+/*
+ * Congestion control: the bytes in flight, the reaction to acknowledgements
+ * and to losses, and the check whether a segment may be sent now.
+ */
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+	static void prvTCPWindowLeaveFlight( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
+	static void prvTCPWindowCongestionAck( TCPWindow_t *pxWindow, uint32_t ulAcked );
+	static void prvTCPWindowCongestionLoss( TCPWindow_t *pxWindow );
+	static void prvTCPWindowCongestionTimeout( TCPWindow_t *pxWindow );
+	static BaseType_t prvTCPWindowTxMaySend( TCPWindow_t *pxWindow, const TCPSegment_t *pxSegment );
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* TCP segment pool. */
@@ -276,6 +325,28 @@ static portINLINE uint32_t ulTimerGetAge( TCPTimer_t *pxTimer )
 }
 /*-----------------------------------------------------------*/
 
+static uint32_t prvTCPWindowRTO( const TCPWindow_t *pxWindow, const TCPSegment_t *pxSegment )
+{
+uint32_t ulRTO = ( uint32_t ) pxWindow->lRTO;
+uint32_t ulCount;
+
+	/* After a packet has been sent for the first time, it will wait one RTO
+	for an ACK.  A second time it will wait two RTO's, each time doubling the
+	time-out until the maximum is reached. */
+	for( ulCount = pxSegment->u.bits.ucTransmitCount; ulCount > 1u; ulCount-- )
+	{
+		if( ulRTO >= ( uint32_t ) ipconfigTCP_RTO_MAX_MS )
+		{
+			break;
+		}
+
+		ulRTO <<= 1;
+	}
+
+	return FreeRTOS_min_uint32( ulRTO, ( uint32_t ) ipconfigTCP_RTO_MAX_MS );
+}
+/*-----------------------------------------------------------*/
+
 /* _HT_ GCC (using the settings that I'm using) checks for every public function if it is
 preceded by a prototype. Later this prototype will be located in list.h? */
 
@@ -373,6 +444,38 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static TCPSegment_t *xTCPWindowRxFindEnd( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
+	{
+	const ListItem_t *pxIterator;
+	const MiniListItem_t* pxEnd;
+	TCPSegment_t *pxSegment, *pxReturn = NULL;
+
+		/* Find a received segment that ends at 'ulSequenceNumber', i.e. the
+		segment just before the one that starts at 'ulSequenceNumber'. */
+
+		pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xRxSegments );
+
+		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
+			 pxIterator != ( const ListItem_t * ) pxEnd;
+			 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+		{
+			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+			if( ( pxSegment->ulSequenceNumber + ( uint32_t ) pxSegment->lDataLength ) == ulSequenceNumber )
+			{
+				pxReturn = pxSegment;
+				break;
+			}
+		}
+
+		return pxReturn;
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount, BaseType_t xIsForRx )
@@ -603,6 +706,18 @@ void vTCPWindowCreate( TCPWindow_t *pxWindow, uint32_t ulRxWindowLength,
 		vListInitialise( &pxWindow->xPriorityQueue );			/* Priority queue: segments which must be sent immediately */
 		vListInitialise( &pxWindow->xTxQueue   );			/* Transmit queue: segments queued for transmission */
 		vListInitialise( &pxWindow->xWaitQueue );			/* Waiting queue:  outstanding segments */
+
+		#if( ipconfigTCP_CONGESTION_CONTROL == 1 )
+		{
+			pxWindow->pxCongestion = &xTCPCongestionNewReno;
+		}
+		#elif( ipconfigTCP_CONGESTION_CONTROL == 2 )
+		{
+			pxWindow->pxCongestion = &xTCPCongestionVegas;
+		}
+		#elif( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			#error ipconfigTCP_CONGESTION_CONTROL must be 0, 1 or 2.
+		#endif
 	}
 	#endif /* ipconfigUSE_TCP_WIN == 1 */
 
@@ -621,8 +736,6 @@ void vTCPWindowCreate( TCPWindow_t *pxWindow, uint32_t ulRxWindowLength,
 
 void vTCPWindowInit( TCPWindow_t *pxWindow, uint32_t ulAckNumber, uint32_t ulSequenceNumber, uint32_t ulMSS )
 {
-const int32_t l500ms = 500;
-
 	pxWindow->u.ulFlags = 0ul;
 	pxWindow->u.bits.bHasInit = pdTRUE_UNSIGNED;
 
@@ -646,8 +759,10 @@ const int32_t l500ms = 500;
 	}
 	#endif /* ipconfigUSE_TCP_WIN == 1 */
 
-	/*Start with a timeout of 2 * 500 ms (1 sec). */
-	pxWindow->lSRTT = l500ms;
+	/* Start with a time-out of 1 second, until the RTT has been measured. */
+	pxWindow->lSRTT = 0;
+	pxWindow->lRTTVar = 0;
+	pxWindow->lRTO = winRTO_INITIAL_mS;
 
 	/* Just for logging, to print relative sequence numbers. */
 	pxWindow->rx.ulFirstSequenceNumber = ulAckNumber;
@@ -670,6 +785,31 @@ const int32_t l500ms = 500;
 	/* The right-hand side of the transmit window. */
 	pxWindow->tx.ulHighestSequenceNumber = ulSequenceNumber;
 	pxWindow->ulOurSequenceNumber = ulSequenceNumber;
+
+	#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+	{
+		/* The initial window of RFC 5681: between 2 and 4 segments, at most
+		4380 bytes. */
+		if( pxWindow->usMSS > 2190u )
+		{
+			pxWindow->ulCongestionWindow = 2UL * pxWindow->usMSS;
+		}
+		else if( pxWindow->usMSS > 1095u )
+		{
+			pxWindow->ulCongestionWindow = 3UL * pxWindow->usMSS;
+		}
+		else
+		{
+			pxWindow->ulCongestionWindow = 4UL * pxWindow->usMSS;
+		}
+
+		/* Slow start until the first loss. */
+		pxWindow->ulSlowStartThreshold = ( uint32_t ) ~0UL;
+		pxWindow->ulBytesInFlight = 0UL;
+		pxWindow->ulRecoverSequenceNumber = ulSequenceNumber;
+		pxWindow->pxCongestion->vInit( pxWindow );
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -763,6 +903,96 @@ const int32_t l500ms = 500;
 #endif /* ipconfgiUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static void prvTCPWindowRxSetSack( TCPWindow_t *pxWindow, const TCPSegment_t *pxRecent )
+	{
+	uint32_t ulFirst[ ipconfigTCP_SACK_BLOCKS ], ulLast[ ipconfigTCP_SACK_BLOCKS ];
+	BaseType_t xCount = 0, xIndex;
+	const MiniListItem_t *pxEnd = ( const MiniListItem_t * ) listGET_END_MARKER( &pxWindow->xRxSegments );
+	const ListItem_t *pxIterator = ( const ListItem_t * ) pxEnd->pxPrevious;
+	const TCPSegment_t *pxSegment = pxRecent;
+	TCPSegment_t *pxFound;
+	uint8_t *pucOption;
+
+		/* As RFC 2018 asks, the first block contains the segment that was
+		received most recently.  The next blocks contain the other stored
+		segments, the most recently received first.  xRxSegments is in order
+		of arrival, so it is walked from its tail. */
+		while( xCount < ( BaseType_t ) ipconfigTCP_SACK_BLOCKS )
+		{
+			if( pxSegment == NULL )
+			{
+				if( pxIterator == ( const ListItem_t * ) pxEnd )
+				{
+					break;
+				}
+
+				pxSegment = ( const TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+				pxIterator = ( const ListItem_t * ) pxIterator->pxPrevious;
+			}
+
+			/* Skip the segment if it lies in a block that is reported already. */
+			for( xIndex = 0; xIndex < xCount; xIndex++ )
+			{
+				if( ( xSequenceGreaterThanOrEqual( pxSegment->ulSequenceNumber, ulFirst[ xIndex ] ) != pdFALSE ) &&
+					( xSequenceLessThan( pxSegment->ulSequenceNumber, ulLast[ xIndex ] ) != pdFALSE ) )
+				{
+					break;
+				}
+			}
+
+			if( xIndex == xCount )
+			{
+				/* Extend the block with the contiguous segments on both
+				sides. */
+				ulFirst[ xCount ] = pxSegment->ulSequenceNumber;
+				ulLast[ xCount ] = pxSegment->ulSequenceNumber + ( uint32_t ) pxSegment->lDataLength;
+
+				while( ( pxFound = xTCPWindowRxFind( pxWindow, ulLast[ xCount ] ) ) != NULL )
+				{
+					ulLast[ xCount ] += ( uint32_t ) pxFound->lDataLength;
+				}
+
+				while( ( pxFound = xTCPWindowRxFindEnd( pxWindow, ulFirst[ xCount ] ) ) != NULL )
+				{
+					ulFirst[ xCount ] = pxFound->ulSequenceNumber;
+				}
+
+				xCount++;
+			}
+
+			pxSegment = NULL;
+		}
+
+		if( xCount == 0 )
+		{
+			pxWindow->ucOptionLength = 0u;
+		}
+		else
+		{
+			/* Now prepare the SACK message, in network byte order. */
+			pucOption = ( uint8_t * ) pxWindow->ulOptionsData;
+			pucOption[ 0 ] = OPTION_CODE_NOOP;
+			pucOption[ 1 ] = OPTION_CODE_NOOP;
+			pucOption[ 2 ] = OPTION_CODE_SACK;
+			pucOption[ 3 ] = ( uint8_t ) ( 2u + ( 8u * ( uint32_t ) xCount ) );
+
+			for( xIndex = 0; xIndex < xCount; xIndex++ )
+			{
+				/* First sequence number of the block, and last + 1. */
+				pxWindow->ulOptionsData[ 1 + ( 2 * xIndex ) ] = FreeRTOS_htonl( ulFirst[ xIndex ] );
+				pxWindow->ulOptionsData[ 2 + ( 2 * xIndex ) ] = FreeRTOS_htonl( ulLast[ xIndex ] );
+			}
+
+			/* 4 bytes, followed by 8 bytes per block. */
+			pxWindow->ucOptionLength = ( uint8_t ) ( sizeof( pxWindow->ulOptionsData[ 0 ] ) * ( 1u + ( 2u * ( uint32_t ) xCount ) ) );
+		}
+	}
+
+#endif /* ipconfgiUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	int32_t lTCPWindowRxCheck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength, uint32_t ulSpace )
@@ -851,6 +1081,13 @@ const int32_t l500ms = 500;
 
 				pxWindow->rx.ulCurrentSequenceNumber = ulCurrentSequenceNumber;
 
+				if( listCURRENT_LIST_LENGTH( &( pxWindow->xRxSegments ) ) != 0 )
+				{
+					/* A hole was filled but more data is missing.  Keep on
+					sending SACK's for the data that is stored. */
+					prvTCPWindowRxSetSack( pxWindow, NULL );
+				}
+
 				/* Packet was expected, may be passed directly to the socket
 				buffer or application.  Store the packet at offset 0. */
 				lReturn = 0;
@@ -888,41 +1125,6 @@ const int32_t l500ms = 500;
 			}
 			else
 			{
-				/* See if there is more data in a contiguous block to make the
-				SACK describe a longer range of data. */
-
-				/* TODO: SACK's may also be delayed for a short period
-				 * This is useful because subsequent packets will be SACK'd with
-				 * single one message
-				 */
-				while( ( pxFound = xTCPWindowRxFind( pxWindow, ulLast ) ) != NULL )
-				{
-					ulLast += ( uint32_t ) pxFound->lDataLength;
-				}
-
-				if( xTCPWindowLoggingLevel >= 1 )
-				{
-					FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: seqnr %lu exp %lu (dist %ld) SACK to %lu\n",
-						pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
-						ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-						ulCurrentSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-						( BaseType_t ) ( ulSequenceNumber - ulCurrentSequenceNumber ),	/* want this signed */
-						ulLast - pxWindow->rx.ulFirstSequenceNumber ) );
-				}
-
-				/* Now prepare the SACK message.
-				Code OPTION_CODE_SINGLE_SACK already in network byte order. */
-				pxWindow->ulOptionsData[0] = OPTION_CODE_SINGLE_SACK;
-
-				/* First sequence number that we received. */
-				pxWindow->ulOptionsData[1] = FreeRTOS_htonl( ulSequenceNumber );
-
-				/* Last + 1 */
-				pxWindow->ulOptionsData[2] = FreeRTOS_htonl( ulLast );
-
-				/* Which make 12 (3*4) option bytes. */
-				pxWindow->ucOptionLength = 3 * sizeof( pxWindow->ulOptionsData[ 0 ] );
-
 				pxFound = xTCPWindowRxFind( pxWindow, ulSequenceNumber );
 
 				if( pxFound != NULL )
@@ -939,10 +1141,7 @@ const int32_t l500ms = 500;
 					if( pxFound == NULL )
 					{
 						/* Can not send a SACK, because the segment cannot be
-						stored. */
-						pxWindow->ucOptionLength = 0u;
-
-						/* Needs to be stored but there is no segment
+						stored.  Needs to be stored but there is no segment
 						available. */
 						lReturn = -1;
 					}
@@ -961,6 +1160,26 @@ const int32_t l500ms = 500;
 						lReturn = ( int32_t ) ( ulSequenceNumber - ulCurrentSequenceNumber );
 					}
 				}
+
+				if( pxFound != NULL )
+				{
+					/* TODO: SACK's may also be delayed for a short period
+					 * This is useful because subsequent packets will be SACK'd with
+					 * single one message
+					 */
+					prvTCPWindowRxSetSack( pxWindow, pxFound );
+
+					if( xTCPWindowLoggingLevel >= 1 )
+					{
+						FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: seqnr %lu exp %lu (dist %ld) SACK %lu - %lu\n",
+							pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+							ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+							ulCurrentSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+							( BaseType_t ) ( ulSequenceNumber - ulCurrentSequenceNumber ),	/* want this signed */
+							FreeRTOS_ntohl( pxWindow->ulOptionsData[ 1 ] ) - pxWindow->rx.ulFirstSequenceNumber,
+							FreeRTOS_ntohl( pxWindow->ulOptionsData[ 2 ] ) - pxWindow->rx.ulFirstSequenceNumber ) );
+					}
+				}
 			}
 		}
 
@@ -1187,6 +1406,16 @@ const int32_t l500ms = 500;
 			{
 				xHasSpace = pdFALSE;
 			}
+
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				/* The bytes in flight may not exceed the congestion window. */
+				if( prvTCPWindowTxMaySend( pxWindow, pxSegment ) == pdFALSE )
+				{
+					xHasSpace = pdFALSE;
+				}
+			}
+			#endif
 		}
 
 		return xHasSpace;
@@ -1210,6 +1439,27 @@ const int32_t l500ms = 500;
 			/* No need to look at retransmissions or new transmission as long as
 			there are priority segments.  *pulDelay equals zero, meaning it must
 			be sent out immediately. */
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				if( prvTCPWindowTxMaySend( pxWindow, xTCPWindowPeekHead( &( pxWindow->xPriorityQueue ) ) ) == pdFALSE )
+				{
+					/* Unless the congestion window is full.  Wait for an ACK,
+					or for the time-out of the oldest outstanding segment. */
+					pxSegment = xTCPWindowPeekHead( &( pxWindow->xWaitQueue ) );
+
+					if( pxSegment != NULL )
+					{
+						ulAge = ulTimerGetAge( &pxSegment->xTransmitTimer );
+						ulMaxAge = prvTCPWindowRTO( pxWindow, pxSegment );
+
+						if( ulMaxAge > ulAge )
+						{
+							*pulDelay = ulMaxAge - ulAge;
+						}
+					}
+				}
+			}
+			#endif
 			xReturn = pdTRUE;
 		}
 		else
@@ -1222,10 +1472,8 @@ const int32_t l500ms = 500;
 				it. */
 				ulAge = ulTimerGetAge( &pxSegment->xTransmitTimer );
 
-				/* After a packet has been sent for the first time, it will wait
-				'1 * lSRTT' ms for an ACK. A second time it will wait '2 * lSRTT' ms,
-				each time doubling the time-out */
-				ulMaxAge = ( 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
+				/* The retransmission time-out doubles with every transmission. */
+				ulMaxAge = prvTCPWindowRTO( pxWindow, pxSegment );
 
 				if( ulMaxAge > ulAge )
 				{
@@ -1276,7 +1524,6 @@ const int32_t l500ms = 500;
 	uint32_t ulTCPWindowTxGet( TCPWindow_t *pxWindow, uint32_t ulWindowSize, int32_t *plPosition )
 	{
 	TCPSegment_t *pxSegment;
-	uint32_t ulMaxTime;
 	uint32_t ulReturn  = ~0UL;
 
 
@@ -1284,11 +1531,46 @@ const int32_t l500ms = 500;
 
 		Priority messages: segments with a resend need no check current sliding
 		window size. */
-		pxSegment = xTCPWindowGetHead( &( pxWindow->xPriorityQueue ) );
 		pxWindow->ulOurSequenceNumber = pxWindow->tx.ulHighestSequenceNumber;
 
-		if( pxSegment == NULL )
+		#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		{
+			/* A retransmission time-out closes the congestion window, and
+			moves all outstanding segments to the priority queue. */
+			pxSegment = xTCPWindowPeekHead( &( pxWindow->xWaitQueue ) );
+
+			if( ( pxSegment != NULL ) && ( ulTimerGetAge( &pxSegment->xTransmitTimer ) > prvTCPWindowRTO( pxWindow, pxSegment ) ) )
+			{
+				prvTCPWindowCongestionTimeout( pxWindow );
+			}
+
+			/* Retransmissions are limited by the congestion window as well. */
+			pxSegment = xTCPWindowPeekHead( &( pxWindow->xPriorityQueue ) );
+
+			if( pxSegment != NULL )
+			{
+				if( prvTCPWindowTxMaySend( pxWindow, pxSegment ) != pdFALSE )
+				{
+					pxSegment = xTCPWindowGetHead( &( pxWindow->xPriorityQueue ) );
+					pxWindow->u.bits.bRetransmitNow = pdFALSE_UNSIGNED;
+				}
+				else
+				{
+					/* Wait for an ACK, no new data may be sent either. */
+					pxSegment = NULL;
+					ulReturn = 0UL;
+				}
+			}
+		}
+		#else
 		{
+			pxSegment = xTCPWindowGetHead( &( pxWindow->xPriorityQueue ) );
+		}
+		#endif
+
+		if( ( pxSegment == NULL ) && ( ulReturn != 0UL ) )
+		{
+			#if( ipconfigTCP_CONGESTION_CONTROL == 0 )
 			/* Waiting messages: outstanding messages with a running timer
 			neither check peer's reception window size because these packets
 			have been sent earlier. */
@@ -1297,9 +1579,7 @@ const int32_t l500ms = 500;
 			if( pxSegment != NULL )
 			{
 				/* Do check the timing. */
-				ulMaxTime = ( 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
-
-				if( ulTimerGetAge( &pxSegment->xTransmitTimer ) > ulMaxTime )
+				if( ulTimerGetAge( &pxSegment->xTransmitTimer ) > prvTCPWindowRTO( pxWindow, pxSegment ) )
 				{
 					/* A normal (non-fast) retransmission.  Move it from the
 					head of the waiting queue. */
@@ -1323,6 +1603,7 @@ const int32_t l500ms = 500;
 					pxSegment = NULL;
 				}
 			}
+			#endif /* ipconfigTCP_CONGESTION_CONTROL == 0 */
 
 			if( pxSegment == NULL )
 			{
@@ -1376,7 +1657,7 @@ const int32_t l500ms = 500;
 				}
 			}
 		}
-		else
+		else if( pxSegment != NULL )
 		{
 			/* There is a priority segment. It doesn't need any checking for
 			space or timeouts. */
@@ -1408,18 +1689,32 @@ const int32_t l500ms = 500;
 			retransmissions. */
 			( pxSegment->u.bits.ucTransmitCount )++;
 
-			/* If there have been several retransmissions (4), decrease the
-			size of the transmission window to at most 2 times MSS. */
-			if( pxSegment->u.bits.ucTransmitCount == MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW )
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				/* The segment is in flight until it is ACK'd or considered
+				lost.  Repeated losses are handled by the congestion window. */
+				if( pxSegment->u.bits.bInFlight == pdFALSE_UNSIGNED )
+				{
+					pxSegment->u.bits.bInFlight = pdTRUE_UNSIGNED;
+					pxWindow->ulBytesInFlight += ( uint32_t ) pxSegment->lDataLength;
+				}
+			}
+			#else
 			{
-				if( pxWindow->xSize.ulTxWindowLength > ( 2U * pxWindow->usMSS ) )
+				/* If there have been several retransmissions (4), decrease the
+				size of the transmission window to at most 2 times MSS. */
+				if( pxSegment->u.bits.ucTransmitCount == MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW )
 				{
-					FreeRTOS_debug_printf( ( "ulTCPWindowTxGet[%u - %d]: Change Tx window: %lu -> %u\n",
-						pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
-						pxWindow->xSize.ulTxWindowLength, 2 * pxWindow->usMSS ) );
-					pxWindow->xSize.ulTxWindowLength = ( 2UL * pxWindow->usMSS );
+					if( pxWindow->xSize.ulTxWindowLength > ( 2U * pxWindow->usMSS ) )
+					{
+						FreeRTOS_debug_printf( ( "ulTCPWindowTxGet[%u - %d]: Change Tx window: %lu -> %u\n",
+							pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+							pxWindow->xSize.ulTxWindowLength, 2 * pxWindow->usMSS ) );
+						pxWindow->xSize.ulTxWindowLength = ( 2UL * pxWindow->usMSS );
+					}
 				}
 			}
+			#endif
 
 			/* Clear the transmit timer. */
 			vTCPTimerSet( &( pxSegment->xTransmitTimer ) );
@@ -1441,9 +1736,9 @@ const int32_t l500ms = 500;
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast )
+	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast, uint32_t *pulNewlyAcked )
 	{
-	uint32_t ulBytesConfirmed = 0u;
+	uint32_t ulBytesConfirmed = 0u, ulNewlyAcked = 0u;
 	uint32_t ulSequenceNumber = ulFirst, ulDataLength;
 	const ListItem_t *pxIterator;
 	const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xTxSegments );
@@ -1456,20 +1751,6 @@ const int32_t l500ms = 500;
 		contiguous block.  Note that the segments are stored in xTxSegments in a
 		strict sequential order. */
 
-		/* SRTT[i] = (1-a) * SRTT[i-1] + a * RTT
-
-		0 < a < 1; usually a = 1/8
-
-		RTO = 2 * SRTT
-
-		where:
-		  RTT is Round Trip Time
-		  SRTT is Smoothed RTT
-		  RTO is Retransmit timeout
-
-		 A Smoothed RTT will increase quickly, but it is conservative when
-		 becoming smaller. */
-
 		for(
 				pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
 				( pxIterator != ( const ListItem_t * ) pxEnd ) && ( xSequenceLessThan( ulSequenceNumber, ulLast ) != 0 );
@@ -1521,29 +1802,19 @@ const int32_t l500ms = 500;
 
 				/* This segment is fully ACK'd, set the flag. */
 				pxSegment->u.bits.bAcked = pdTRUE_UNSIGNED;
+				ulNewlyAcked += ulDataLength;
+
+				#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+				{
+					prvTCPWindowLeaveFlight( pxWindow, pxSegment );
+				}
+				#endif
 
 				/* Calculate the RTT only if the segment was sent-out for the
 				first time and if this is the last ACK'd segment in a range. */
 				if( ( pxSegment->u.bits.ucTransmitCount == 1 ) && ( ( pxSegment->ulSequenceNumber + ulDataLength ) == ulLast ) )
 				{
-					int32_t mS = ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) );
-
-					if( pxWindow->lSRTT >= mS )
-					{
-						/* RTT becomes smaller: adapt slowly. */
-						pxWindow->lSRTT = ( ( winSRTT_DECREMENT_NEW * mS ) + ( winSRTT_DECREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_DECREMENT_NEW + winSRTT_DECREMENT_CURRENT );
-					}
-					else
-					{
-						/* RTT becomes larger: adapt quicker */
-						pxWindow->lSRTT = ( ( winSRTT_INCREMENT_NEW * mS ) + ( winSRTT_INCREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_INCREMENT_NEW + winSRTT_INCREMENT_CURRENT );
-					}
-
-					/* Cap to the minimum of 50ms. */
-					if( pxWindow->lSRTT < winSRTT_CAP_mS )
-					{
-						pxWindow->lSRTT = winSRTT_CAP_mS;
-					}
+					prvTCPWindowRTTSample( pxWindow, ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) ) );
 				}
 
 				/* Unlink it from the 3 queues, but do not destroy it (yet). */
@@ -1585,6 +1856,17 @@ const int32_t l500ms = 500;
 			ulSequenceNumber += ulDataLength;
 		}
 
+		#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		{
+			if( ulBytesConfirmed != 0u )
+			{
+				prvTCPWindowCongestionAck( pxWindow, ulBytesConfirmed );
+			}
+		}
+		#endif
+
+		*pulNewlyAcked = ulNewlyAcked;
+
 		return ulBytesConfirmed;
 	}
 #endif /* ipconfigUSE_TCP_WIN == 1 */
@@ -1636,6 +1918,12 @@ const int32_t l500ms = 500;
 				/* Remove it from xWaitQueue. */
 				uxListRemove( &pxSegment->xQueueItem );
 
+				#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+				{
+					prvTCPWindowLeaveFlight( pxWindow, pxSegment );
+				}
+				#endif
+
 				/* Add this segment to the priority queue so it gets
 				retransmitted immediately. */
 				vListInsertFifo( &( pxWindow->xPriorityQueue ), &( pxSegment->xQueueItem ) );
@@ -1652,7 +1940,7 @@ const int32_t l500ms = 500;
 
 	uint32_t ulTCPWindowTxAck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
 	{
-	uint32_t ulFirstSequence, ulReturn;
+	uint32_t ulFirstSequence, ulReturn, ulNewlyAcked;
 
 		/* Receive a normal ACK. */
 
@@ -1664,7 +1952,7 @@ const int32_t l500ms = 500;
 		}
 		else
 		{
-			ulReturn = prvTCPWindowTxCheckAck( pxWindow, ulFirstSequence, ulSequenceNumber );
+			ulReturn = prvTCPWindowTxCheckAck( pxWindow, ulFirstSequence, ulSequenceNumber, &ulNewlyAcked );
 		}
 
 		return ulReturn;
@@ -1677,12 +1965,30 @@ const int32_t l500ms = 500;
 
 	uint32_t ulTCPWindowTxSack( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast )
 	{
-	uint32_t ulAckCount = 0UL;
+	uint32_t ulAckCount = 0UL, ulNewlyAcked;
 	uint32_t ulCurrentSequenceNumber = pxWindow->tx.ulCurrentSequenceNumber;
 
 		/* Receive a SACK option. */
-		ulAckCount = prvTCPWindowTxCheckAck( pxWindow, ulFirst, ulLast );
-		prvTCPWindowFastRetransmit( pxWindow, ulFirst );
+		ulAckCount = prvTCPWindowTxCheckAck( pxWindow, ulFirst, ulLast, &ulNewlyAcked );
+
+		/* The peer repeats its older SACK blocks in every SACK option.  Only
+		a block that acknowledges new data counts as a duplicate ACK, also
+		without congestion control. */
+		if( ulNewlyAcked != 0UL )
+		{
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				if( prvTCPWindowFastRetransmit( pxWindow, ulFirst ) != 0UL )
+				{
+					prvTCPWindowCongestionLoss( pxWindow );
+				}
+			}
+			#else
+			{
+				prvTCPWindowFastRetransmit( pxWindow, ulFirst );
+			}
+			#endif
+		}
 
 		if( ( xTCPWindowLoggingLevel >= 1 ) && ( xSequenceGreaterThan( ulFirst, ulCurrentSequenceNumber ) != pdFALSE ) )
 		{
@@ -1701,6 +2007,391 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static void prvTCPWindowRTTSample( TCPWindow_t *pxWindow, int32_t lRTT )
+	{
+	int32_t lDelta, lRTO;
+
+		/* RFC 6298:
+		first measurement:  SRTT = R, RTTVAR = R / 2
+		next measurements:  RTTVAR = 3/4 * RTTVAR + 1/4 * | SRTT - R |
+		                    SRTT = 7/8 * SRTT + 1/8 * R
+		RTO = SRTT + max( G, 4 * RTTVAR ), where G is the clock granularity. */
+		if( pxWindow->u.bits.bHasRTT == pdFALSE_UNSIGNED )
+		{
+			pxWindow->lSRTT = lRTT;
+			pxWindow->lRTTVar = lRTT / 2;
+			pxWindow->u.bits.bHasRTT = pdTRUE_UNSIGNED;
+		}
+		else
+		{
+			lDelta = pxWindow->lSRTT - lRTT;
+
+			if( lDelta < 0 )
+			{
+				lDelta = -lDelta;
+			}
+
+			pxWindow->lRTTVar += ( lDelta - pxWindow->lRTTVar ) / 4;
+			pxWindow->lSRTT = ( ( 7 * pxWindow->lSRTT ) + lRTT + 4 ) / 8;
+		}
+
+		lRTO = pxWindow->lSRTT + FreeRTOS_max_int32( ( int32_t ) portTICK_PERIOD_MS, 4 * pxWindow->lRTTVar );
+		lRTO = FreeRTOS_max_int32( lRTO, ( int32_t ) ipconfigTCP_RTO_MIN_MS );
+		pxWindow->lRTO = FreeRTOS_min_int32( lRTO, ( int32_t ) ipconfigTCP_RTO_MAX_MS );
+
+		#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		{
+			if( pxWindow->pxCongestion->vRTTSample != NULL )
+			{
+				pxWindow->pxCongestion->vRTTSample( pxWindow, ( uint32_t ) lRTT );
+			}
+		}
+		#endif
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	static void prvTCPWindowLeaveFlight( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
+	{
+		/* The segment has been ACK'd, or it is considered lost. */
+		if( pxSegment->u.bits.bInFlight != pdFALSE_UNSIGNED )
+		{
+			pxSegment->u.bits.bInFlight = pdFALSE_UNSIGNED;
+			pxWindow->ulBytesInFlight -= FreeRTOS_min_uint32( pxWindow->ulBytesInFlight, ( uint32_t ) pxSegment->lDataLength );
+		}
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	static void prvTCPWindowCongestionAck( TCPWindow_t *pxWindow, uint32_t ulAcked )
+	{
+	TCPSegment_t *pxSegment;
+	uint32_t ulLimit;
+
+		if( pxWindow->u.bits.bInRecovery != pdFALSE_UNSIGNED )
+		{
+			if( xSequenceGreaterThanOrEqual( pxWindow->tx.ulCurrentSequenceNumber, pxWindow->ulRecoverSequenceNumber ) != pdFALSE )
+			{
+				/* A full ACK: all data that was outstanding when the loss was
+				detected has been ACK'd.  The recovery is over. */
+				pxWindow->u.bits.bInRecovery = pdFALSE_UNSIGNED;
+				pxWindow->ulCongestionWindow = pxWindow->ulSlowStartThreshold;
+			}
+			else
+			{
+				/* A partial ACK, RFC 6582: the first unacknowledged segment
+				was lost as well.  Retransmit it now, unless that was done
+				already in this recovery. */
+				pxSegment = xTCPWindowPeekHead( &( pxWindow->xTxSegments ) );
+
+				if( ( pxSegment != NULL ) &&
+					( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED ) &&
+					( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) == ( void * ) &( pxWindow->xWaitQueue ) ) &&
+					( pxSegment->u.bits.ucDupAckCount < DUPLICATE_ACKS_BEFORE_FAST_RETRANSMIT ) )
+				{
+					uxListRemove( &( pxSegment->xQueueItem ) );
+					vListInsertFifo( &( pxWindow->xPriorityQueue ), &( pxSegment->xQueueItem ) );
+					prvTCPWindowLeaveFlight( pxWindow, pxSegment );
+					pxSegment->u.bits.ucTransmitCount = pdFALSE_UNSIGNED;
+					pxSegment->u.bits.ucDupAckCount = DUPLICATE_ACKS_BEFORE_FAST_RETRANSMIT;
+					pxWindow->u.bits.bRetransmitNow = pdTRUE_UNSIGNED;
+				}
+			}
+		}
+		else
+		{
+			pxWindow->pxCongestion->vAcked( pxWindow, ulAcked );
+
+			/* The window does not need to grow beyond what may be sent. */
+			ulLimit = FreeRTOS_max_uint32( pxWindow->xSize.ulTxWindowLength, 2UL * pxWindow->usMSS );
+			pxWindow->ulCongestionWindow = FreeRTOS_min_uint32( pxWindow->ulCongestionWindow, ulLimit );
+		}
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	static void prvTCPWindowCongestionLoss( TCPWindow_t *pxWindow )
+	{
+	uint32_t ulThreshold;
+
+		/* A fast retransmission has been queued.  Only reduce the window once
+		for the losses in one window of data. */
+		if( ( pxWindow->u.bits.bInRecovery == pdFALSE_UNSIGNED ) &&
+			( xSequenceGreaterThanOrEqual( pxWindow->tx.ulCurrentSequenceNumber, pxWindow->ulRecoverSequenceNumber ) != pdFALSE ) )
+		{
+			ulThreshold = pxWindow->pxCongestion->ulLoss( pxWindow, pdFALSE );
+			pxWindow->ulSlowStartThreshold = FreeRTOS_max_uint32( ulThreshold, 2UL * pxWindow->usMSS );
+			pxWindow->ulCongestionWindow = pxWindow->ulSlowStartThreshold;
+			pxWindow->ulRecoverSequenceNumber = pxWindow->tx.ulHighestSequenceNumber;
+			pxWindow->u.bits.bInRecovery = pdTRUE_UNSIGNED;
+			pxWindow->u.bits.bRetransmitNow = pdTRUE_UNSIGNED;
+
+			if( ( xTCPWindowLoggingLevel >= 0 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+			{
+				FreeRTOS_debug_printf( ( "prvTCPWindowCongestionLoss[%u,%u]: cwnd %lu, in flight %lu\n",
+					pxWindow->usPeerPortNumber,
+					pxWindow->usOurPortNumber,
+					pxWindow->ulCongestionWindow,
+					pxWindow->ulBytesInFlight ) );
+			}
+		}
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	static void prvTCPWindowCongestionTimeout( TCPWindow_t *pxWindow )
+	{
+	TCPSegment_t *pxSegment = xTCPWindowPeekHead( &( pxWindow->xWaitQueue ) );
+
+		/* RFC 5681: only the first time-out of a segment lowers the slow start
+		threshold.  The window restarts from one segment. */
+		if( pxSegment->u.bits.ucTransmitCount == 1u )
+		{
+			pxWindow->ulSlowStartThreshold = FreeRTOS_max_uint32( pxWindow->pxCongestion->ulLoss( pxWindow, pdTRUE ), 2UL * pxWindow->usMSS );
+		}
+
+		pxWindow->ulCongestionWindow = pxWindow->usMSS;
+		pxWindow->ulRecoverSequenceNumber = pxWindow->tx.ulHighestSequenceNumber;
+		pxWindow->u.bits.bInRecovery = pdFALSE_UNSIGNED;
+		pxWindow->u.bits.bRetransmitNow = pdFALSE_UNSIGNED;
+
+		/* All outstanding segments are considered lost, they will be
+		retransmitted in the order in which they were sent. */
+		while( ( pxSegment = xTCPWindowGetHead( &( pxWindow->xWaitQueue ) ) ) != NULL )
+		{
+			prvTCPWindowLeaveFlight( pxWindow, pxSegment );
+			pxSegment->u.bits.ucDupAckCount = pdFALSE_UNSIGNED;
+			vListInsertFifo( &( pxWindow->xPriorityQueue ), &( pxSegment->xQueueItem ) );
+		}
+
+		if( ( xTCPWindowLoggingLevel >= 0 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+		{
+			FreeRTOS_debug_printf( ( "prvTCPWindowCongestionTimeout[%u,%u]: ssthresh %lu, RTO %ld\n",
+				pxWindow->usPeerPortNumber,
+				pxWindow->usOurPortNumber,
+				pxWindow->ulSlowStartThreshold,
+				pxWindow->lRTO ) );
+		}
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	static BaseType_t prvTCPWindowTxMaySend( TCPWindow_t *pxWindow, const TCPSegment_t *pxSegment )
+	{
+	BaseType_t xReturn;
+
+		if( pxWindow->ulBytesInFlight == 0UL )
+		{
+			/* Always allow one segment, even if it is larger than the window. */
+			xReturn = pdTRUE;
+		}
+		else if( pxWindow->u.bits.bRetransmitNow != pdFALSE_UNSIGNED )
+		{
+			/* The fast retransmission that starts a recovery. */
+			xReturn = pdTRUE;
+		}
+		else if( ( pxWindow->ulBytesInFlight + ( uint32_t ) pxSegment->lDataLength ) <= pxWindow->ulCongestionWindow )
+		{
+			xReturn = pdTRUE;
+		}
+		else
+		{
+			xReturn = pdFALSE;
+		}
+
+		return xReturn;
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	/*
+	 * TCP NewReno, RFC 5681 and RFC 6582.
+	 */
+	static void prvNewRenoInit( TCPWindow_t *pxWindow );
+	static void prvNewRenoAcked( TCPWindow_t *pxWindow, uint32_t ulAcked );
+	static uint32_t ulNewRenoLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout );
+
+	const TCPCongestionControl_t xTCPCongestionNewReno =
+	{
+		prvNewRenoInit,
+		NULL,
+		prvNewRenoAcked,
+		ulNewRenoLoss
+	};
+
+	static void prvNewRenoInit( TCPWindow_t *pxWindow )
+	{
+		/* The initial values set by vTCPWindowInit() are used. */
+		( void ) pxWindow;
+	}
+
+	static void prvNewRenoAcked( TCPWindow_t *pxWindow, uint32_t ulAcked )
+	{
+	uint32_t ulMSS = ( uint32_t ) pxWindow->usMSS;
+	uint32_t ulGrowth;
+
+		/* The growth depends on the number of bytes ACK'd (RFC 3465), not on
+		the number of ACK's: a receiver may acknowledge many segments at once,
+		as FreeRTOS+TCP does when its delayed ACK keeps being postponed. */
+		if( pxWindow->ulCongestionWindow < pxWindow->ulSlowStartThreshold )
+		{
+			/* Slow start: the window doubles every round trip, up to the
+			threshold. */
+			ulGrowth = FreeRTOS_min_uint32( ulAcked, pxWindow->ulSlowStartThreshold - pxWindow->ulCongestionWindow );
+			pxWindow->ulCongestionWindow += ulGrowth;
+			ulAcked -= ulGrowth;
+		}
+
+		if( ulAcked != 0UL )
+		{
+			/* Congestion avoidance: grow by one MSS per window ACK'd. */
+			pxWindow->ulCongestionWindow += FreeRTOS_max_uint32( 1UL, ( ulMSS * ulAcked ) / pxWindow->ulCongestionWindow );
+		}
+	}
+
+	static uint32_t ulNewRenoLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout )
+	{
+	uint32_t ulFlightSize = pxWindow->tx.ulHighestSequenceNumber - pxWindow->tx.ulCurrentSequenceNumber;
+
+		/* Half of the data that was outstanding, for both kinds of loss. */
+		( void ) xTimeout;
+
+		return FreeRTOS_max_uint32( ulFlightSize / 2UL, 2UL * pxWindow->usMSS );
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) )
+
+	/*
+	 * TCP Vegas: a delay based algorithm.  Once per round trip, it estimates
+	 * how many segments are waiting in the queues of the path, and keeps that
+	 * number between VEGAS_ALPHA and VEGAS_BETA.  Losses are handled as in
+	 * NewReno, but a fast retransmission only closes the window by 1/4.
+	 */
+	static void prvVegasInit( TCPWindow_t *pxWindow );
+	static void prvVegasRTTSample( TCPWindow_t *pxWindow, uint32_t ulRTT );
+	static void prvVegasAcked( TCPWindow_t *pxWindow, uint32_t ulAcked );
+	static uint32_t ulVegasLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout );
+
+	const TCPCongestionControl_t xTCPCongestionVegas =
+	{
+		prvVegasInit,
+		prvVegasRTTSample,
+		prvVegasAcked,
+		ulVegasLoss
+	};
+
+	static void prvVegasInit( TCPWindow_t *pxWindow )
+	{
+		pxWindow->xVegas.ulBaseRTT = ( uint32_t ) ~0UL;
+		pxWindow->xVegas.ulMinRTT = ( uint32_t ) ~0UL;
+		pxWindow->xVegas.ulRoundEnd = pxWindow->tx.ulHighestSequenceNumber;
+	}
+
+	static void prvVegasRTTSample( TCPWindow_t *pxWindow, uint32_t ulRTT )
+	{
+		pxWindow->xVegas.ulBaseRTT = FreeRTOS_min_uint32( pxWindow->xVegas.ulBaseRTT, ulRTT );
+		pxWindow->xVegas.ulMinRTT = FreeRTOS_min_uint32( pxWindow->xVegas.ulMinRTT, ulRTT );
+	}
+
+	static void prvVegasAcked( TCPWindow_t *pxWindow, uint32_t ulAcked )
+	{
+	uint32_t ulMSS = ( uint32_t ) pxWindow->usMSS;
+	uint32_t ulBaseRTT = pxWindow->xVegas.ulBaseRTT, ulMinRTT = pxWindow->xVegas.ulMinRTT;
+	uint32_t ulQueued;
+
+		if( ( ulMinRTT != ( uint32_t ) ~0UL ) &&
+			( xSequenceGreaterThanOrEqual( pxWindow->tx.ulCurrentSequenceNumber, pxWindow->xVegas.ulRoundEnd ) != pdFALSE ) )
+		{
+			/* A round trip has passed.  The segments queued in the path are
+			cwnd * ( 1 - BaseRTT / RTT ). */
+			if( ulMinRTT > ulBaseRTT )
+			{
+				ulQueued = ( ( pxWindow->ulCongestionWindow / ulMSS ) * ( ulMinRTT - ulBaseRTT ) ) / ulMinRTT;
+			}
+			else
+			{
+				ulQueued = 0UL;
+			}
+
+			if( pxWindow->ulCongestionWindow < pxWindow->ulSlowStartThreshold )
+			{
+				if( ulQueued > VEGAS_GAMMA )
+				{
+					/* Leave slow start as soon as a queue builds up. */
+					pxWindow->ulSlowStartThreshold = pxWindow->ulCongestionWindow;
+				}
+			}
+			else if( ulQueued < VEGAS_ALPHA )
+			{
+				pxWindow->ulCongestionWindow += ulMSS;
+			}
+			else if( ( ulQueued > VEGAS_BETA ) && ( pxWindow->ulCongestionWindow >= 3UL * ulMSS ) )
+			{
+				pxWindow->ulCongestionWindow -= ulMSS;
+				pxWindow->ulSlowStartThreshold = pxWindow->ulCongestionWindow;
+			}
+			else
+			{
+				/* The number of queued segments is right. */
+			}
+
+			pxWindow->xVegas.ulMinRTT = ( uint32_t ) ~0UL;
+			pxWindow->xVegas.ulRoundEnd = pxWindow->tx.ulHighestSequenceNumber;
+		}
+
+		if( pxWindow->ulCongestionWindow < pxWindow->ulSlowStartThreshold )
+		{
+			/* Slow start, as in NewReno. */
+			pxWindow->ulCongestionWindow += FreeRTOS_min_uint32( ulAcked, pxWindow->ulSlowStartThreshold - pxWindow->ulCongestionWindow );
+		}
+	}
+
+	static uint32_t ulVegasLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout )
+	{
+	uint32_t ulReturn;
+
+		if( xTimeout != pdFALSE )
+		{
+			ulReturn = ulNewRenoLoss( pxWindow, xTimeout );
+		}
+		else
+		{
+			ulReturn = ( pxWindow->ulCongestionWindow / 4UL ) * 3UL;
+		}
+
+		/* Start a new round trip after the recovery. */
+		pxWindow->xVegas.ulMinRTT = ( uint32_t ) ~0UL;
+		pxWindow->xVegas.ulRoundEnd = pxWindow->tx.ulHighestSequenceNumber;
+
+		return ulReturn;
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 ) */
+/*-----------------------------------------------------------*/
+
 /*
 #####   #                      #####   ####  ######
 # # #   #                      # # #  #    #  #    #
@@ -1800,7 +2491,6 @@ const int32_t l500ms = 500;
 	{
 	TCPSegment_t *pxSegment = &( pxWindow->xTxSegment );
 	uint32_t ulLength = ( uint32_t ) pxSegment->lDataLength;
-	uint32_t ulMaxTime;
 
 		if( ulLength != 0UL )
 		{
@@ -1809,10 +2499,8 @@ const int32_t l500ms = 500;
 
 			if( pxSegment->u.bits.bOutstanding != pdFALSE_UNSIGNED )
 			{
-				/* As 'ucTransmitCount' has a minimum of 1, take 2 * RTT */
-				ulMaxTime = ( ( uint32_t ) 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
-
-				if( ulTimerGetAge( &( pxSegment->xTransmitTimer ) ) < ulMaxTime )
+				/* The retransmission time-out doubles with every transmission. */
+				if( ulTimerGetAge( &( pxSegment->xTransmitTimer ) ) < prvTCPWindowRTO( pxWindow, pxSegment ) )
 				{
 					ulLength = 0ul;
 				}
@@ -1898,7 +2586,7 @@ const int32_t l500ms = 500;
 			if( pxSegment->u.bits.bOutstanding != pdFALSE_UNSIGNED )
 			{
 				ulAge = ulTimerGetAge ( &pxSegment->xTransmitTimer );
-				ulMaxAge = ( ( TickType_t ) 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
+				ulMaxAge = prvTCPWindowRTO( pxWindow, pxSegment );
 
 				if( ulMaxAge > ulAge )
 				{
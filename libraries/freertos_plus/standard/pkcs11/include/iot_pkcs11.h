@@ -112,6 +112,41 @@
     #define pkcs11configIMPORT_PRIVATE_KEYS_SUPPORTED    1
 #endif
 
+/**
+ * @brief Maximum number of parsed private keys that are kept for signing.
+ *
+ * A cached key does not have to be read from storage and parsed on every
+ * C_SignInit, which saves a flash read and an ASN.1 parse per TLS handshake.
+ * Each cached key stays on the heap until an object with its label is created
+ * or destroyed, or the module is finalized.
+ *
+ * A cached key is shared by all sessions, so C_Sign holds a mutex for the
+ * whole module while it signs. C_Sign looks the key up again by handle, and a
+ * key that was evicted or replaced since C_SignInit is read from storage and
+ * parsed with that mutex held, which then also blocks signing in every other
+ * session.
+ *
+ * Set to 0 to read and parse the key on every C_SignInit.
+ */
+#ifndef pkcs11configMAX_CACHED_KEYS
+    #define pkcs11configMAX_CACHED_KEYS    1
+#endif
+
+/**
+ * @brief The PKCS #11 labels of a device key pair that is not in use yet.
+ *
+ * A certificate rotation generates its new key pair under these labels, and
+ * copies the private key to pkcs11configLABEL_DEVICE_PRIVATE_KEY_FOR_TLS once
+ * the certificate issued for it is installed. The port's PAL must store
+ * objects with these labels for the rotation to work.
+ */
+#ifndef pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS
+    #define pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS    "Pending Priv TLS Key"
+#endif
+#ifndef pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS
+    #define pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS     "Pending Pub TLS Key"
+#endif
+
 /**
  * @brief RSA signature padding for interoperability between providing hashed messages
  * and providing hashed messages encoded with the digest information.
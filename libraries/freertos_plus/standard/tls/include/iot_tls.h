@@ -30,6 +30,22 @@
     #error "include FreeRTOS.h must appear in source files before include iot_tls.h"
 #endif
 
+/**
+ * @brief Number of TLS sessions kept for resumption.
+ *
+ * After a successful handshake, the session is saved under the server name and
+ * the client certificate. The next TLS_Connect with the same server name and
+ * certificate offers it to the server, which replaces the key exchange and the
+ * certificate verification of a full handshake. A session ticket is used when
+ * MBEDTLS_SSL_SESSION_TICKETS is enabled in the mbedTLS configuration, and the
+ * session ID otherwise.
+ *
+ * The cache is shared by all TLS contexts. Set to 0 to disable it.
+ */
+#ifndef tlsconfigSESSION_CACHE_SIZE
+    #define tlsconfigSESSION_CACHE_SIZE    ( 0 )
+#endif
+
 /**
  * @defgroup TlsErrors TLS Error Codes
  * @brief Error codes returned by the TLS API.
@@ -118,7 +134,10 @@ BaseType_t TLS_Init( void ** ppvContext,
 BaseType_t TLS_Connect( void * pvContext );
 
 /**
- * @brief Reads the requested number of bytes from the secure connection
+ * @brief Reads up to the requested number of bytes from the secure connection
+ *
+ * Waits for the first record, then returns the data of the records already
+ * received, like recv(). Fewer bytes than requested may be returned.
  *
  * @param pvContext Opaque context handle for TLS library.
  * @param pucReadBuffer Byte array for storing (decrypted) data read from the
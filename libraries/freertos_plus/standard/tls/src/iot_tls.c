@@ -31,6 +31,7 @@
 #include "iot_pkcs11.h"
 #include "iot_pkcs11_config.h"
 #include "task.h"
+#include "semphr.h"
 #include "aws_clientcredential_keys.h"
 #include "iot_default_root_certificates.h"
 #include "iot_pki_utils.h"
@@ -53,6 +54,10 @@
 #include <time.h>
 #include <stdio.h>
 
+#if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+    #define tlsSESSION_CACHE_KEY_LENGTH    32
+#endif
+
 /**
  * @brief Internal context structure.
  *
@@ -71,6 +76,9 @@
  * @param[out] pxP11FunctionList PKCS#11 function list structure.
  * @param[out] xP11Session PKCS#11 session context.
  * @param[out] xP11PrivateKey PKCS#11 private key context.
+ * @param[out] ucSessionCacheKey Key of this connection's entry in the session cache.
+ * @param[out] xSessionCacheKeyValid Indicates whether ucSessionCacheKey was computed.
+ * @param[out] xSessionOffered Indicates whether a cached session was offered to the server.
  */
 typedef struct TLSContext
 {
@@ -98,8 +106,41 @@ typedef struct TLSContext
     CK_SESSION_HANDLE xP11Session;
     CK_OBJECT_HANDLE xP11PrivateKey;
     CK_KEY_TYPE xKeyType;
+
+    /* Session cache. */
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        uint8_t ucSessionCacheKey[ tlsSESSION_CACHE_KEY_LENGTH ];
+        BaseType_t xSessionCacheKeyValid;
+        BaseType_t xSessionOffered;
+    #endif
 } TLSContext_t;
 
+#if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+
+/**
+ * @brief A TLS session saved for resumption.
+ *
+ * @param[out] ucKey SHA-256 of the server name and the client certificate.
+ * @param[out] ulLastUsed Value of ulSessionCacheUseCounter when the entry was last used.
+ * @param[out] xValid Indicates whether xSession holds a session.
+ * @param[out] xSession Saved mbedTLS session, without the server certificate.
+ */
+    typedef struct TLSSessionCacheEntry
+    {
+        uint8_t ucKey[ tlsSESSION_CACHE_KEY_LENGTH ];
+        uint32_t ulLastUsed;
+        BaseType_t xValid;
+        mbedtls_ssl_session xSession;
+    } TLSSessionCacheEntry_t;
+
+/**
+ * @brief Sessions shared by all TLS contexts, guarded by xSessionCacheMutex.
+ */
+    static TLSSessionCacheEntry_t xSessionCache[ tlsconfigSESSION_CACHE_SIZE ];
+    static uint32_t ulSessionCacheUseCounter = 0;
+    static SemaphoreHandle_t xSessionCacheMutex = NULL;
+#endif /* if ( tlsconfigSESSION_CACHE_SIZE > 0 ) */
+
 #define TLS_PRINT( X )    vLoggingPrintf X
 
 /*-----------------------------------------------------------*/
@@ -607,6 +648,264 @@ static int prvInitializeClientCredential( TLSContext_t * pxCtx )
 
 /*-----------------------------------------------------------*/
 
+#if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+
+/**
+ * @brief Takes the session cache mutex, creating it on first use.
+ *
+ * @return pdTRUE if the mutex was taken.
+ */
+    static BaseType_t prvSessionCacheLock( void )
+    {
+        BaseType_t xResult = pdFALSE;
+        SemaphoreHandle_t xMutex = NULL;
+
+        if( NULL == xSessionCacheMutex )
+        {
+            xMutex = xSemaphoreCreateMutex();
+
+            if( NULL != xMutex )
+            {
+                /* Another task may have created the mutex in the meantime. */
+                taskENTER_CRITICAL();
+
+                if( NULL == xSessionCacheMutex )
+                {
+                    xSessionCacheMutex = xMutex;
+                    xMutex = NULL;
+                }
+
+                taskEXIT_CRITICAL();
+
+                if( NULL != xMutex )
+                {
+                    vSemaphoreDelete( xMutex );
+                }
+            }
+        }
+
+        if( NULL != xSessionCacheMutex )
+        {
+            xResult = xSemaphoreTake( xSessionCacheMutex, portMAX_DELAY );
+        }
+
+        return xResult;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Finds the cache entry of a TLS context.
+ *
+ * The session cache mutex must be held.
+ *
+ * @param[in] pxCtx Caller context.
+ *
+ * @return The entry, or NULL if no session is cached for the context.
+ */
+    static TLSSessionCacheEntry_t * prvSessionCacheFind( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        uint32_t ulIndex = 0;
+
+        for( ulIndex = 0; ulIndex < tlsconfigSESSION_CACHE_SIZE; ulIndex++ )
+        {
+            if( ( pdTRUE == xSessionCache[ ulIndex ].xValid ) &&
+                ( 0 == memcmp( xSessionCache[ ulIndex ].ucKey,
+                               pxCtx->ucSessionCacheKey,
+                               tlsSESSION_CACHE_KEY_LENGTH ) ) )
+            {
+                pxEntry = &xSessionCache[ ulIndex ];
+                break;
+            }
+        }
+
+        return pxEntry;
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Computes the session cache key of a TLS context.
+ *
+ * The key covers the server name and the client certificate, so a session is
+ * only resumed with the server and the certificate it was established with.
+ * Rotating the device certificate therefore starts a new session.
+ *
+ * @param[in] pxCtx Caller context. The client certificate must be loaded.
+ */
+    static void prvSessionCacheComputeKey( TLSContext_t * pxCtx )
+    {
+        int lResult = 0;
+        mbedtls_sha256_context xSha256;
+
+        mbedtls_sha256_init( &xSha256 );
+
+        lResult = mbedtls_sha256_starts_ret( &xSha256, 0 );
+
+        /* Hash the terminating null as well to separate the two fields. */
+        if( ( 0 == lResult ) && ( NULL != pxCtx->pcDestination ) )
+        {
+            lResult = mbedtls_sha256_update_ret( &xSha256,
+                                                 ( const unsigned char * ) pxCtx->pcDestination,
+                                                 strlen( pxCtx->pcDestination ) + 1 );
+        }
+
+        if( 0 == lResult )
+        {
+            lResult = mbedtls_sha256_update_ret( &xSha256,
+                                                 pxCtx->xMbedX509Cli.raw.p,
+                                                 pxCtx->xMbedX509Cli.raw.len );
+        }
+
+        if( 0 == lResult )
+        {
+            lResult = mbedtls_sha256_finish_ret( &xSha256, pxCtx->ucSessionCacheKey );
+        }
+
+        pxCtx->xSessionCacheKeyValid = ( 0 == lResult ) ? pdTRUE : pdFALSE;
+
+        mbedtls_sha256_free( &xSha256 );
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Offers the cached session of a TLS context to the server.
+ *
+ * Must be called after mbedtls_ssl_setup and before the handshake. If the
+ * server does not accept the session, mbedTLS runs a full handshake.
+ *
+ * @param[in] pxCtx Caller context.
+ */
+    static void prvSessionCacheRestore( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+
+        if( ( pdTRUE == pxCtx->xSessionCacheKeyValid ) &&
+            ( pdTRUE == prvSessionCacheLock() ) )
+        {
+            pxEntry = prvSessionCacheFind( pxCtx );
+
+            if( ( NULL != pxEntry ) &&
+                ( 0 == mbedtls_ssl_set_session( &pxCtx->xMbedSslCtx, &pxEntry->xSession ) ) )
+            {
+                pxEntry->ulLastUsed = ++ulSessionCacheUseCounter;
+                pxCtx->xSessionOffered = pdTRUE;
+            }
+
+            ( void ) xSemaphoreGive( xSessionCacheMutex );
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Saves the session of a connected TLS context.
+ *
+ * The server certificate is dropped from the saved copy. It is not needed
+ * to resume and would otherwise be parsed again on every restore.
+ *
+ * @param[in] pxCtx Caller context.
+ */
+    static void prvSessionCacheSave( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+        mbedtls_ssl_session xSession;
+        uint32_t ulIndex = 0;
+
+        if( pdTRUE == pxCtx->xSessionCacheKeyValid )
+        {
+            mbedtls_ssl_session_init( &xSession );
+
+            if( 0 == mbedtls_ssl_get_session( &pxCtx->xMbedSslCtx, &xSession ) )
+            {
+                #if defined( MBEDTLS_X509_CRT_PARSE_C )
+                    if( NULL != xSession.peer_cert )
+                    {
+                        mbedtls_x509_crt_free( xSession.peer_cert );
+                        mbedtls_free( xSession.peer_cert );
+                        xSession.peer_cert = NULL;
+                    }
+                #endif
+
+                if( pdTRUE == prvSessionCacheLock() )
+                {
+                    pxEntry = prvSessionCacheFind( pxCtx );
+
+                    /* Otherwise replace an empty or the least recently used entry. */
+                    if( NULL == pxEntry )
+                    {
+                        pxEntry = &xSessionCache[ 0 ];
+
+                        for( ulIndex = 1; ( pdTRUE == pxEntry->xValid ) && ( ulIndex < tlsconfigSESSION_CACHE_SIZE ); ulIndex++ )
+                        {
+                            if( ( pdFALSE == xSessionCache[ ulIndex ].xValid ) ||
+                                ( ( ulSessionCacheUseCounter - xSessionCache[ ulIndex ].ulLastUsed ) >
+                                  ( ulSessionCacheUseCounter - pxEntry->ulLastUsed ) ) )
+                            {
+                                pxEntry = &xSessionCache[ ulIndex ];
+                            }
+                        }
+                    }
+
+                    if( pdTRUE == pxEntry->xValid )
+                    {
+                        mbedtls_ssl_session_free( &pxEntry->xSession );
+                    }
+
+                    /* The entry takes ownership of the session ticket. */
+                    memcpy( pxEntry->ucKey, pxCtx->ucSessionCacheKey, tlsSESSION_CACHE_KEY_LENGTH );
+                    memcpy( &pxEntry->xSession, &xSession, sizeof( mbedtls_ssl_session ) );
+                    pxEntry->ulLastUsed = ++ulSessionCacheUseCounter;
+                    pxEntry->xValid = pdTRUE;
+
+                    ( void ) xSemaphoreGive( xSessionCacheMutex );
+                }
+                else
+                {
+                    mbedtls_ssl_session_free( &xSession );
+                }
+            }
+            else
+            {
+                mbedtls_ssl_session_free( &xSession );
+            }
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Drops the cached session of a TLS context.
+ *
+ * Called when a handshake that offered the cached session fails, so that the
+ * next connection does not offer it again.
+ *
+ * @param[in] pxCtx Caller context.
+ */
+    static void prvSessionCacheRemove( TLSContext_t * pxCtx )
+    {
+        TLSSessionCacheEntry_t * pxEntry = NULL;
+
+        if( pdTRUE == prvSessionCacheLock() )
+        {
+            pxEntry = prvSessionCacheFind( pxCtx );
+
+            if( NULL != pxEntry )
+            {
+                mbedtls_ssl_session_free( &pxEntry->xSession );
+                pxEntry->xValid = pdFALSE;
+            }
+
+            ( void ) xSemaphoreGive( xSessionCacheMutex );
+        }
+    }
+
+#endif /* if ( tlsconfigSESSION_CACHE_SIZE > 0 ) */
+
+/*-----------------------------------------------------------*/
+
 /*
  * Interface routines.
  */
@@ -689,6 +988,11 @@ BaseType_t TLS_Connect( void * pvContext )
     /* Ensure that the FreeRTOS heap is used. */
     CRYPTO_ConfigureHeap();
 
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        pxCtx->xSessionCacheKeyValid = pdFALSE;
+        pxCtx->xSessionOffered = pdFALSE;
+    #endif
+
     /* Initialize mbedTLS structures. */
     mbedtls_ssl_init( &pxCtx->xMbedSslCtx );
     mbedtls_ssl_config_init( &pxCtx->xMbedSslConfig );
@@ -767,6 +1071,13 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = prvInitializeClientCredential( pxCtx );
     }
 
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        if( 0 == xResult )
+        {
+            prvSessionCacheComputeKey( pxCtx );
+        }
+    #endif
+
     if( ( 0 == xResult ) && ( NULL != pxCtx->ppcAlpnProtocols ) )
     {
         /* Include an application protocol list in the TLS ClientHello
@@ -796,6 +1107,14 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = mbedtls_ssl_set_hostname( &pxCtx->xMbedSslCtx, pxCtx->pcDestination );
     }
 
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        /* Offer the session of the previous connection, if there is one. */
+        if( 0 == xResult )
+        {
+            prvSessionCacheRestore( pxCtx );
+        }
+    #endif
+
     /* Set the socket callbacks. */
     if( 0 == xResult )
     {
@@ -825,6 +1144,10 @@ BaseType_t TLS_Connect( void * pvContext )
     if( 0 == xResult )
     {
         pxCtx->xTLSHandshakeSuccessful = pdTRUE;
+
+        #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+            prvSessionCacheSave( pxCtx );
+        #endif
     }
     else if( xResult > 0 )
     {
@@ -833,6 +1156,13 @@ BaseType_t TLS_Connect( void * pvContext )
         xResult = TLS_ERROR_HANDSHAKE_FAILED;
     }
 
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        if( ( 0 != xResult ) && ( pdTRUE == pxCtx->xSessionOffered ) )
+        {
+            prvSessionCacheRemove( pxCtx );
+        }
+    #endif
+
     /* Free up allocated memory. */
     mbedtls_x509_crt_free( &pxCtx->xMbedX509CA );
     mbedtls_x509_crt_free( &pxCtx->xMbedX509Cli );
@@ -860,8 +1190,15 @@ BaseType_t TLS_Recv( void * pvContext,
 
             if( 0 < xResult )
             {
-                /* Got data, so update the tally and keep looping. */
+                /* Got data, so update the tally. Keep looping only while
+                 * mbedTLS holds data that was already received, so that the
+                 * data available is returned without waiting for more. */
                 xRead += ( size_t ) xResult;
+
+                if( 0 == mbedtls_ssl_check_pending( &pxCtx->xMbedSslCtx ) )
+                {
+                    break;
+                }
             }
             else if( 0 == xResult )
             {
@@ -33,6 +33,10 @@
 /* Secure sockets includes */
 #include "iot_secure_sockets.h"
 
+/* TLS includes. */
+#include "FreeRTOS.h"
+#include "iot_tls.h"
+
 /* Credential includes. */
 #include "aws_clientcredential.h"
 #include "aws_clientcredential_keys.h"
@@ -66,6 +70,28 @@ static const uint32_t tlstestCLIENT_UNTRUSTED_PRIVATE_KEY_PEM_LENGTH = sizeof( t
 static const uint32_t tlstestCLIENT_BYOC_CERTIFICATE_PEM_LENGTH = sizeof( tlstestCLIENT_BYOC_CERTIFICATE_PEM );
 static const uint32_t tlstestCLIENT_BYOC_PRIVATE_KEY_PEM_LENGTH = sizeof( tlstestCLIENT_BYOC_PRIVATE_KEY_PEM );
 
+#if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+
+/*
+ * Bytes of a connection that the session resumption test keeps. The server's
+ * certificate, if it sends one, is in the first record after the ServerHello.
+ */
+    #define tlstestRESUMPTION_BUFFER_SIZE    ( 16384 )
+
+/*
+ * A TLS connection of the session resumption test.
+ */
+    typedef struct TLSTestConnection
+    {
+        Socket_t xSocket;
+        BaseType_t xFailSend;
+        size_t xReceivedLength;
+        uint8_t ucReceived[ tlstestRESUMPTION_BUFFER_SIZE ];
+    } TLSTestConnection_t;
+
+    static TLSTestConnection_t xResumptionConnection;
+#endif /* if ( tlsconfigSESSION_CACHE_SIZE > 0 ) */
+
 /*-----------------------------------------------------------*/
 
 TEST_GROUP( Full_TLS );
@@ -86,6 +112,10 @@ TEST_GROUP_RUNNER( Full_TLS )
     RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectMalformedCert );
     RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectUntrustedCert );
     RUN_TEST_CASE( Full_TLS, AFQP_TLS_ConnectBYOCCredentials );
+
+    #if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+        RUN_TEST_CASE( Full_TLS, AFQP_TLS_SessionResumption );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
@@ -367,3 +397,271 @@ TEST( Full_TLS, AFQP_TLS_ConnectBYOCCredentials )
                                 );
 }
 /*-----------------------------------------------------------*/
+
+#if ( tlsconfigSESSION_CACHE_SIZE > 0 )
+
+/*
+ * Network receive callback of the session resumption test. Keeps a copy of
+ * what the server sent.
+ */
+    static BaseType_t prvResumptionRecv( void * pvCallerContext,
+                                         unsigned char * pucReceiveBuffer,
+                                         size_t xReceiveLength )
+    {
+        TLSTestConnection_t * pxConnection = ( TLSTestConnection_t * ) pvCallerContext;
+        BaseType_t xResult;
+        size_t xCopyLength;
+
+        xResult = SOCKETS_Recv( pxConnection->xSocket, pucReceiveBuffer, xReceiveLength, 0 );
+
+        if( xResult > 0 )
+        {
+            xCopyLength = tlstestRESUMPTION_BUFFER_SIZE - pxConnection->xReceivedLength;
+
+            if( xCopyLength > ( size_t ) xResult )
+            {
+                xCopyLength = ( size_t ) xResult;
+            }
+
+            memcpy( &pxConnection->ucReceived[ pxConnection->xReceivedLength ], pucReceiveBuffer, xCopyLength );
+            pxConnection->xReceivedLength += xCopyLength;
+        }
+
+        return xResult;
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Network send callback of the session resumption test. Fails when asked to,
+ * so that the handshake fails.
+ */
+    static BaseType_t prvResumptionSend( void * pvCallerContext,
+                                         const unsigned char * pucData,
+                                         size_t xDataLength )
+    {
+        TLSTestConnection_t * pxConnection = ( TLSTestConnection_t * ) pvCallerContext;
+        BaseType_t xResult = SOCKETS_SOCKET_ERROR;
+
+        if( pxConnection->xFailSend == pdFALSE )
+        {
+            xResult = SOCKETS_Send( pxConnection->xSocket, pucData, xDataLength, 0 );
+        }
+
+        return xResult;
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Returns pdTRUE if the server sent its certificate, that is, if the last
+ * handshake was a full one. A server that resumes a session goes from the
+ * ServerHello to the ChangeCipherSpec without a Certificate message.
+ *
+ * The received bytes are rewritten in place.
+ */
+    static BaseType_t prvServerSentCertificate( TLSTestConnection_t * pxConnection )
+    {
+        uint8_t * pucData = pxConnection->ucReceived;
+        size_t xOffset = 0;
+        size_t xMessagesLength = 0;
+        size_t xLength = 0;
+        BaseType_t xSentCertificate = pdFALSE;
+
+        /* Join the plaintext handshake records at the start of the buffer. They
+         * end with the server's ChangeCipherSpec record. */
+        while( ( xOffset + 5u <= pxConnection->xReceivedLength ) && ( pucData[ xOffset ] == 22u ) )
+        {
+            xLength = ( ( size_t ) pucData[ xOffset + 3u ] << 8 ) | pucData[ xOffset + 4u ];
+
+            if( xLength > pxConnection->xReceivedLength - xOffset - 5u )
+            {
+                xLength = pxConnection->xReceivedLength - xOffset - 5u;
+            }
+
+            memmove( &pucData[ xMessagesLength ], &pucData[ xOffset + 5u ], xLength );
+            xMessagesLength += xLength;
+            xOffset += 5u + xLength;
+        }
+
+        /* Look for the Certificate message. */
+        xOffset = 0;
+
+        while( ( xOffset + 4u <= xMessagesLength ) && ( xSentCertificate == pdFALSE ) )
+        {
+            if( pucData[ xOffset ] == 11u )
+            {
+                xSentCertificate = pdTRUE;
+            }
+
+            xOffset += 4u + ( ( ( size_t ) pucData[ xOffset + 1u ] << 16 ) |
+                              ( ( size_t ) pucData[ xOffset + 2u ] << 8 ) |
+                              pucData[ xOffset + 3u ] );
+        }
+
+        return xSentCertificate;
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Connects to the MQTT broker with TLS over a plain socket, so that the test
+ * sees the handshake, then disconnects. If xFailSend is pdTRUE, sending fails
+ * and so does the handshake.
+ *
+ * Returns the result of TLS_Connect, or of the step that failed before it.
+ */
+    static BaseType_t prvResumptionConnect( BaseType_t xFailSend )
+    {
+        const char * pcAWSIoTAddress = clientcredentialMQTT_BROKER_ENDPOINT;
+        SocketsSockaddr_t xMQTTServerAddress = { 0 };
+        TLSTestConnection_t * pxConnection = &xResumptionConnection;
+        TLSParams_t xTLSParams = { 0 };
+        void * pvTLSContext = NULL;
+        BaseType_t xResult = SOCKETS_SOCKET_ERROR;
+
+        pxConnection->xFailSend = xFailSend;
+        pxConnection->xReceivedLength = 0;
+
+        pxConnection->xSocket = SOCKETS_Socket( SOCKETS_AF_INET, SOCKETS_SOCK_STREAM, SOCKETS_IPPROTO_TCP );
+
+        if( pxConnection->xSocket != SOCKETS_INVALID_SOCKET )
+        {
+            xMQTTServerAddress.ulAddress = SOCKETS_GetHostByName( pcAWSIoTAddress );
+            xMQTTServerAddress.usPort = SOCKETS_htons( clientcredentialMQTT_BROKER_PORT );
+            xMQTTServerAddress.ucSocketDomain = SOCKETS_AF_INET;
+            xResult = SOCKETS_Connect( pxConnection->xSocket, &xMQTTServerAddress, sizeof( xMQTTServerAddress ) );
+
+            if( xResult == SOCKETS_ERROR_NONE )
+            {
+                xTLSParams.ulSize = sizeof( xTLSParams );
+                xTLSParams.pcDestination = pcAWSIoTAddress;
+                xTLSParams.pvCallerContext = pxConnection;
+                xTLSParams.pxNetworkRecv = prvResumptionRecv;
+                xTLSParams.pxNetworkSend = prvResumptionSend;
+                xResult = TLS_Init( &pvTLSContext, &xTLSParams );
+            }
+
+            if( xResult == 0 )
+            {
+                xResult = TLS_Connect( pvTLSContext );
+            }
+
+            if( pvTLSContext != NULL )
+            {
+                TLS_Cleanup( pvTLSContext );
+            }
+
+            ( void ) SOCKETS_Shutdown( pxConnection->xSocket, SOCKETS_SHUT_RDWR );
+            ( void ) SOCKETS_Close( pxConnection->xSocket );
+        }
+
+        return xResult;
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Connects, and checks that the handshake was a full one if xExpectFullHandshake
+ * is pdTRUE, or a resumption otherwise.
+ */
+    static void prvResumptionExpectHandshake( BaseType_t xExpectFullHandshake )
+    {
+        BaseType_t xResult;
+
+        xResult = prvResumptionConnect( pdFALSE );
+        TEST_ASSERT_EQUAL_INT32_MESSAGE( 0, xResult, "TLS connect failed" );
+
+        if( xExpectFullHandshake == pdTRUE )
+        {
+            TEST_ASSERT_TRUE_MESSAGE( prvServerSentCertificate( &xResumptionConnection ),
+                                      "The session was resumed instead of a full handshake" );
+        }
+        else
+        {
+            TEST_ASSERT_FALSE_MESSAGE( prvServerSentCertificate( &xResumptionConnection ),
+                                       "A full handshake was made instead of resuming the session" );
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Connects with a handshake that fails after offering the cached session, if
+ * there is one.
+ */
+    static void prvResumptionExpectFailure( void )
+    {
+        BaseType_t xResult;
+
+        xResult = prvResumptionConnect( pdTRUE );
+        TEST_ASSERT_NOT_EQUAL_MESSAGE( 0, xResult, "TLS connect succeeded while sending failed" );
+    }
+/*-----------------------------------------------------------*/
+
+/*
+ * Requires a server that resumes sessions, by session ID or ticket.
+ */
+TEST( Full_TLS, AFQP_TLS_SessionResumption )
+{
+    ProvisioningParams_t xECParams;
+    ProvisioningParams_t xBYOCParams;
+
+    xECParams.pucClientPrivateKey = ( uint8_t * ) tlstestCLIENT_PRIVATE_KEY_PEM_EC;
+    xECParams.ulClientPrivateKeyLength = tlstestCLIENT_PRIVATE_KEY_LENGTH_EC;
+    xECParams.pucClientCertificate = ( uint8_t * ) tlstestCLIENT_CERTIFICATE_PEM_EC;
+    xECParams.ulClientCertificateLength = tlstestCLIENT_CERTIFICATE_LENGTH_EC;
+    xECParams.ulJITPCertifiateLength = 0; /* Do not provision JITP certificate. */
+    xECParams.pucJITPCertificate = NULL;
+
+    xBYOCParams.pucClientPrivateKey = ( uint8_t * ) tlstestCLIENT_BYOC_PRIVATE_KEY_PEM;
+    xBYOCParams.ulClientPrivateKeyLength = tlstestCLIENT_BYOC_PRIVATE_KEY_PEM_LENGTH;
+    xBYOCParams.pucClientCertificate = ( uint8_t * ) tlstestCLIENT_BYOC_CERTIFICATE_PEM;
+    xBYOCParams.ulClientCertificateLength = tlstestCLIENT_BYOC_CERTIFICATE_PEM_LENGTH;
+    xBYOCParams.ulJITPCertifiateLength = 0; /* Do not provision JITP certificate. */
+    xBYOCParams.pucJITPCertificate = NULL;
+
+    if( TEST_PROTECT() )
+    {
+        /* Earlier tests connected with these credentials. A failed handshake
+         * that offered a cached session drops it, so this empties the cache
+         * of them. */
+        vAlternateKeyProvisioning( &xBYOCParams );
+        prvResumptionExpectFailure();
+        vAlternateKeyProvisioning( &xECParams );
+        prvResumptionExpectFailure();
+        vDevModeKeyProvisioning();
+        prvResumptionExpectFailure();
+
+        /* The second connection resumes the session of the first one. */
+        prvResumptionExpectHandshake( pdTRUE );
+        prvResumptionExpectHandshake( pdFALSE );
+
+        /* A new client certificate, as after a rotation, starts a new session. */
+        vAlternateKeyProvisioning( &xECParams );
+        prvResumptionExpectHandshake( pdTRUE );
+
+        /* The session of the first certificate is still cached. */
+        vDevModeKeyProvisioning();
+        prvResumptionExpectHandshake( pdFALSE );
+
+        #if ( tlsconfigSESSION_CACHE_SIZE == 2 )
+            /* A third certificate replaces the least recently used session,
+             * the one of the EC certificate. */
+            vAlternateKeyProvisioning( &xBYOCParams );
+            prvResumptionExpectHandshake( pdTRUE );
+            vDevModeKeyProvisioning();
+            prvResumptionExpectHandshake( pdFALSE );
+            vAlternateKeyProvisioning( &xECParams );
+            prvResumptionExpectHandshake( pdTRUE );
+            vDevModeKeyProvisioning();
+        #endif
+
+        /* A failed handshake drops the session it offered. */
+        prvResumptionExpectFailure();
+        prvResumptionExpectHandshake( pdTRUE );
+        prvResumptionExpectHandshake( pdFALSE );
+    }
+
+    /* Re-provision the device with the default credentials so that
+     * subsequent tests are not changed. */
+    vDevModeKeyProvisioning();
+}
+/*-----------------------------------------------------------*/
+
+#endif /* if ( tlsconfigSESSION_CACHE_SIZE > 0 ) */
@@ -134,6 +134,10 @@ static void RunTests( void )
         RUN_TEST_GROUP( Full_OTA_PAL );
     #endif
 
+    #if ( testrunnerFULL_CDF_AGENT_ENABLED == 1 )
+        RUN_TEST_GROUP( Full_CDF_AGENT );
+    #endif
+
     #if ( testrunnerFULL_PKCS11_ENABLED == 1 )
         RUN_TEST_GROUP( Full_PKCS11_StartFinish );
         RUN_TEST_GROUP( Full_PKCS11_NoObject );
@@ -202,6 +206,7 @@ static void RunTests( void )
         RUN_TEST_GROUP( Full_Serializer_CBOR );
         RUN_TEST_GROUP( Full_Serializer_JSON );
         RUN_TEST_GROUP( Full_Serializer_JSON_deserialize );
+        RUN_TEST_GROUP( Full_Serializer_JSON_arena_deserialize );
     #endif
 }
 /*-----------------------------------------------------------*/
@@ -0,0 +1,732 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/*
+ * One device of cdf_load_test.py that runs the rotation of iot_cdf_agent.c.
+ *
+ * The agent and the MQTT library run unmodified on the POSIX port of the Linux
+ * simulator.  The network under the MQTT library is a broker stand-in that
+ * acknowledges every packet itself and passes the application messages to the
+ * load test as lines:
+ *
+ * - "PUBLISH <topic> <payload>" on stdout for each PUBLISH of the device;
+ * - "RECONNECT" on stdout when the device must reconnect with its new
+ *   certificate, and "CONNECTED" on stdin when it has;
+ * - "RESULT <payload>" on stdin for each message on the result topic;
+ * - "FINISHED" or "FAILED" on stdout when the rotation ends.
+ *
+ * The payloads are JSON without line breaks.  The logs go to stderr.
+ */
+
+/* The config header is always included first. */
+#include "iot_config.h"
+
+/* C runtime includes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "iot_logging_task.h"
+
+/* SDK and MQTT includes. */
+#include "iot_init.h"
+#include "iot_mqtt.h"
+#include "platform/iot_clock.h"
+#include "platform/iot_threads.h"
+
+/* Agent includes. */
+#include "iot_appversion32.h"
+#include "aws_iot_ota_agent.h"
+#include "iot_cdf_agent.h"
+#include "aws_clientcredential.h"
+
+#define deviceTOPIC_PREFIX          "certificate/rotation"
+#define deviceRESULT_TOPIC          deviceTOPIC_PREFIX "/result/" clientcredentialIOT_THING_NAME
+#define deviceRX_BUFFER_SIZE        ( 8192 )
+#define deviceLINE_SIZE             ( 4096 )
+#define deviceMQTT_TIMEOUT_MS       ( 5000 )
+#define devicePOLL_MS               ( 1 )
+#define deviceTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define deviceTASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+#define deviceLOGGING_STACK_SIZE    ( configMINIMAL_STACK_SIZE * 4 )
+#define deviceLOGGING_PRIORITY      ( configMAX_PRIORITIES - 1 )
+#define deviceLOGGING_QUEUE_LENGTH  ( 32 )
+
+#define deviceMQTT_CONNECT          ( 0x10 )
+#define deviceMQTT_CONNACK          ( 0x20 )
+#define deviceMQTT_PUBLISH          ( 0x30 )
+#define deviceMQTT_PUBACK           ( 0x40 )
+#define deviceMQTT_SUBSCRIBE        ( 0x80 )
+#define deviceMQTT_SUBACK           ( 0x90 )
+#define deviceMQTT_UNSUBSCRIBE      ( 0xa0 )
+#define deviceMQTT_UNSUBACK         ( 0xb0 )
+
+/* Where the device is in the rotation. */
+typedef enum
+{
+    ePhaseRotating,     /* Attach and activate on the old certificate. */
+    ePhaseReconnecting, /* Waiting for the load test to reconnect the device. */
+    ePhaseDetaching     /* Detach on the new certificate. */
+} DevicePhase_t;
+
+/* The version the OTA agent reports.  OTA is not started. */
+const AppVersion32_t xAppFirmwareVersion =
+{
+    .u.x.ucMajor = 0,
+    .u.x.ucMinor = 0,
+    .u.x.usBuild = 0,
+};
+
+static IotMqttNetworkInfo_t xNetworkInfo = IOT_MQTT_NETWORK_INFO_INITIALIZER;
+static IotNetworkInterface_t xNetworkInterface = { 0 };
+static IotMqttConnection_t xMqttConnection = IOT_MQTT_CONNECTION_INITIALIZER;
+
+/* The MQTT library's receive callback, which the receive thread calls once for
+ * each queued packet. */
+static IotNetworkReceiveCallback_t xReceiveCallback = NULL;
+static void * pvReceiveContext = NULL;
+
+/* Bytes queued by the broker stand-in for the MQTT library to receive. */
+static uint8_t ucRxBuffer[ deviceRX_BUFFER_SIZE ];
+static size_t xRxHead = 0;
+static size_t xRxTail = 0;
+static IotMutex_t xRxLock;
+static IotSemaphore_t xRxPackets;
+
+/* In-memory storage behind the CDF API. */
+static CDF_STATE eNvmState = CDF_STATE_WAIT_FOR_CERT_ROTATE;
+static char cTempCertificate[ 1300 ];
+static char cNewCertificateId[ _CERTIFICATE_ID_LENGTH ];
+static char cOldCertificateId[ _CERTIFICATE_ID_LENGTH ];
+static char cCSR[] = "-----BEGIN CERTIFICATE REQUEST-----\\n" clientcredentialIOT_THING_NAME "\\n-----END CERTIFICATE REQUEST-----\\n";
+
+/* A line read from stdin so far. */
+static char cLine[ deviceLINE_SIZE ];
+static size_t xLineLength = 0;
+
+/*-----------------------------------------------------------*/
+
+static uint8_t prvWriteState( CDF_STATE val )
+{
+    eNvmState = val;
+
+    return EXIT_SUCCESS;
+}
+
+static CDF_STATE prvReadState( void )
+{
+    return eNvmState;
+}
+
+static uint8_t prvPutTempCertificate( char * pcCert )
+{
+    ( void ) strncpy( cTempCertificate, pcCert, sizeof( cTempCertificate ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * prvGetTempCertificate( void )
+{
+    return cTempCertificate;
+}
+
+static char * prvGetDeviceCertificate( void )
+{
+    /* The rotation is started from the NVM state, not from the expiry. */
+    return NULL;
+}
+
+static char * prvGetCSR( void )
+{
+    return cCSR;
+}
+
+static uint8_t prvPutNewCertificateId( char * pcId )
+{
+    ( void ) strncpy( cNewCertificateId, pcId, sizeof( cNewCertificateId ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * prvGetNewCertificateId( void )
+{
+    return cNewCertificateId;
+}
+
+static uint8_t prvPutOldCertificateId( char * pcId )
+{
+    ( void ) strncpy( cOldCertificateId, pcId, sizeof( cOldCertificateId ) - 1 );
+
+    return EXIT_SUCCESS;
+}
+
+static char * prvGetOldCertificateId( void )
+{
+    return cOldCertificateId;
+}
+
+static cdf_Api_t xCdfApi =
+{
+    .xWriteCDFStateNVM    = prvWriteState,
+    .xReadCDFStateNVM     = prvReadState,
+    .xPutTempDeviceCert   = prvPutTempCertificate,
+    .xGetTempDeviceCert   = prvGetTempCertificate,
+    .xGetDeviceCert       = prvGetDeviceCertificate,
+    .xGetCSR              = prvGetCSR,
+    .xPutNewCertificateId = prvPutNewCertificateId,
+    .xGetNewCertificateId = prvGetNewCertificateId,
+    .xPutOldCertificateId = prvPutOldCertificateId,
+    .xGetOldCertificateId = prvGetOldCertificateId,
+};
+
+/*-----------------------------------------------------------*/
+
+/* Tasks must not use stdio: a task switched out in the middle of a stdio call
+ * would keep the stdio lock of the host until it runs again. */
+static void prvWrite( int iFile,
+                      const char * pcData,
+                      size_t xLength )
+{
+    ssize_t xWritten;
+
+    while( xLength > 0 )
+    {
+        xWritten = write( iFile, pcData, xLength );
+
+        if( xWritten < 0 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+
+            /* The load test has gone. */
+            _exit( EXIT_FAILURE );
+        }
+
+        pcData += xWritten;
+        xLength -= ( size_t ) xWritten;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLine( const char * pcLine )
+{
+    prvWrite( STDOUT_FILENO, pcLine, strlen( pcLine ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvQueuePacket( const uint8_t * pucHeader,
+                            size_t xHeaderLength,
+                            const uint8_t * pucBody,
+                            size_t xBodyLength )
+{
+    IotMutex_Lock( &xRxLock );
+
+    /* Restart at the front of the buffer once it has drained. */
+    if( xRxHead == xRxTail )
+    {
+        xRxHead = 0;
+        xRxTail = 0;
+    }
+
+    /* A packet that does not fit is lost, like a message the broker drops. */
+    if( xRxTail + xHeaderLength + xBodyLength > deviceRX_BUFFER_SIZE )
+    {
+        IotMutex_Unlock( &xRxLock );
+
+        return;
+    }
+
+    ( void ) memcpy( ucRxBuffer + xRxTail, pucHeader, xHeaderLength );
+    xRxTail += xHeaderLength;
+
+    if( xBodyLength > 0 )
+    {
+        ( void ) memcpy( ucRxBuffer + xRxTail, pucBody, xBodyLength );
+        xRxTail += xBodyLength;
+    }
+
+    IotMutex_Unlock( &xRxLock );
+
+    IotSemaphore_Post( &xRxPackets );
+}
+/*-----------------------------------------------------------*/
+
+static void prvQueueAck( uint8_t ucPacketType,
+                         uint16_t usPacketIdentifier,
+                         bool xWithReturnCode )
+{
+    uint8_t ucAck[ 5 ] = { 0 };
+
+    ucAck[ 0 ] = ucPacketType;
+    ucAck[ 1 ] = xWithReturnCode ? 3 : 2;
+    ucAck[ 2 ] = ( uint8_t ) ( usPacketIdentifier >> 8 );
+    ucAck[ 3 ] = ( uint8_t ) ( usPacketIdentifier & 0xff );
+    ucAck[ 4 ] = 0x01; /* SUBACK: granted QoS 1. */
+
+    prvQueuePacket( ucAck, xWithReturnCode ? 5 : 4, NULL, 0 );
+}
+/*-----------------------------------------------------------*/
+
+/* Queue a QoS 0 PUBLISH on the result topic. */
+static void prvQueueResult( const char * pcPayload )
+{
+    static uint8_t ucBody[ deviceLINE_SIZE + sizeof( deviceRESULT_TOPIC ) + 2 ];
+    uint8_t ucHeader[ 5 ] = { 0 };
+    size_t xHeaderLength = 1;
+    size_t xTopicLength = sizeof( deviceRESULT_TOPIC ) - 1;
+    size_t xPayloadLength = strlen( pcPayload );
+    size_t xBodyLength = 2 + xTopicLength + xPayloadLength;
+    size_t xRemainingLength = xBodyLength;
+
+    if( xBodyLength > sizeof( ucBody ) )
+    {
+        return;
+    }
+
+    ucBody[ 0 ] = ( uint8_t ) ( xTopicLength >> 8 );
+    ucBody[ 1 ] = ( uint8_t ) ( xTopicLength & 0xff );
+    ( void ) memcpy( ucBody + 2, deviceRESULT_TOPIC, xTopicLength );
+    ( void ) memcpy( ucBody + 2 + xTopicLength, pcPayload, xPayloadLength );
+
+    ucHeader[ 0 ] = deviceMQTT_PUBLISH;
+
+    do
+    {
+        ucHeader[ xHeaderLength ] = ( uint8_t ) ( xRemainingLength & 0x7f );
+        xRemainingLength >>= 7;
+
+        if( xRemainingLength > 0 )
+        {
+            ucHeader[ xHeaderLength ] |= 0x80;
+        }
+
+        xHeaderLength++;
+    } while( xRemainingLength > 0 );
+
+    prvQueuePacket( ucHeader, xHeaderLength, ucBody, xBodyLength );
+}
+/*-----------------------------------------------------------*/
+
+/* PUBACK a PUBLISH of the device and pass it to the load test. */
+static void prvHandlePublish( const uint8_t * pucPacket,
+                              size_t xLength,
+                              size_t xIndex )
+{
+    uint8_t ucQoS = ( pucPacket[ 0 ] >> 1 ) & 0x03;
+    size_t xTopicLength;
+    const char * pcTopic;
+    static char cPublishLine[ deviceLINE_SIZE + 16 ];
+    int iLineLength;
+
+    xTopicLength = ( ( size_t ) pucPacket[ xIndex ] << 8 ) | pucPacket[ xIndex + 1 ];
+    pcTopic = ( const char * ) ( pucPacket + xIndex + 2 );
+    xIndex += 2 + xTopicLength;
+
+    if( ucQoS > 0 )
+    {
+        prvQueueAck( deviceMQTT_PUBACK,
+                     ( uint16_t ) ( ( pucPacket[ xIndex ] << 8 ) | pucPacket[ xIndex + 1 ] ),
+                     false );
+        xIndex += 2;
+    }
+
+    /* A retransmission of a PUBLISH that was acknowledged is not a new message. */
+    if( ( pucPacket[ 0 ] & 0x08 ) != 0 )
+    {
+        return;
+    }
+
+    iLineLength = snprintf( cPublishLine, sizeof( cPublishLine ), "PUBLISH %.*s %.*s\n",
+                            ( int ) xTopicLength, pcTopic,
+                            ( int ) ( xLength - xIndex ), ( const char * ) ( pucPacket + xIndex ) );
+
+    if( ( iLineLength > 0 ) && ( ( size_t ) iLineLength < sizeof( cPublishLine ) ) )
+    {
+        prvWriteLine( cPublishLine );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* The MQTT library sends each packet with a single call. */
+static size_t prvBrokerSend( void * pvConnection,
+                             const uint8_t * pucMessage,
+                             size_t xMessageLength )
+{
+    static const uint8_t ucConnack[ 4 ] = { deviceMQTT_CONNACK, 0x02, 0x00, 0x00 };
+    size_t xIndex = 1;
+    uint16_t usPacketIdentifier = 0;
+
+    ( void ) pvConnection;
+
+    /* Skip the remaining length. */
+    while( ( xIndex < xMessageLength ) && ( ( pucMessage[ xIndex ] & 0x80 ) != 0 ) )
+    {
+        xIndex++;
+    }
+
+    xIndex++;
+
+    /* SUBSCRIBE and UNSUBSCRIBE start their variable header with the packet
+     * identifier. */
+    if( xIndex + 1 < xMessageLength )
+    {
+        usPacketIdentifier = ( uint16_t ) ( ( pucMessage[ xIndex ] << 8 ) | pucMessage[ xIndex + 1 ] );
+    }
+
+    switch( pucMessage[ 0 ] & 0xf0 )
+    {
+        case deviceMQTT_CONNECT:
+            prvQueuePacket( ucConnack, sizeof( ucConnack ), NULL, 0 );
+            break;
+
+        case deviceMQTT_PUBLISH:
+            prvHandlePublish( pucMessage, xMessageLength, xIndex );
+            break;
+
+        case deviceMQTT_SUBSCRIBE:
+            prvQueueAck( deviceMQTT_SUBACK, usPacketIdentifier, true );
+            break;
+
+        case deviceMQTT_UNSUBSCRIBE:
+            prvQueueAck( deviceMQTT_UNSUBACK, usPacketIdentifier, false );
+            break;
+
+        default:
+            break;
+    }
+
+    return xMessageLength;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvBrokerReceive( void * pvConnection,
+                                uint8_t * pucBuffer,
+                                size_t xBytesRequested )
+{
+    size_t xBytesReceived;
+
+    ( void ) pvConnection;
+
+    IotMutex_Lock( &xRxLock );
+
+    xBytesReceived = xRxTail - xRxHead;
+
+    if( xBytesReceived > xBytesRequested )
+    {
+        xBytesReceived = xBytesRequested;
+    }
+
+    ( void ) memcpy( pucBuffer, ucRxBuffer + xRxHead, xBytesReceived );
+    xRxHead += xBytesReceived;
+
+    IotMutex_Unlock( &xRxLock );
+
+    return xBytesReceived;
+}
+/*-----------------------------------------------------------*/
+
+static IotNetworkError_t prvSetReceiveCallback( void * pvConnection,
+                                                IotNetworkReceiveCallback_t xCallback,
+                                                void * pvContext )
+{
+    ( void ) pvConnection;
+
+    xReceiveCallback = xCallback;
+    pvReceiveContext = pvContext;
+
+    return IOT_NETWORK_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+static IotNetworkError_t prvBrokerClose( void * pvConnection )
+{
+    ( void ) pvConnection;
+
+    return IOT_NETWORK_SUCCESS;
+}
+/*-----------------------------------------------------------*/
+
+/* Delivers the queued packets one per receive callback, as the network receive
+ * task would. */
+static void prvReceiveThread( void * pvArgument )
+{
+    ( void ) pvArgument;
+
+    for( ; ; )
+    {
+        IotSemaphore_Wait( &xRxPackets );
+        xReceiveCallback( xNetworkInfo.u.pNetworkConnection, pvReceiveContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Read a line from stdin without blocking.
+ *
+ * @return The line without its line break, or NULL if no whole line has
+ * arrived yet. */
+static const char * prvReadLine( void )
+{
+    ssize_t xRead;
+    char * pcEnd;
+
+    for( ; ; )
+    {
+        pcEnd = memchr( cLine, '\n', xLineLength );
+
+        if( pcEnd != NULL )
+        {
+            break;
+        }
+
+        if( xLineLength == sizeof( cLine ) )
+        {
+            /* An overlong line is dropped. */
+            xLineLength = 0;
+        }
+
+        xRead = read( STDIN_FILENO, cLine + xLineLength, sizeof( cLine ) - xLineLength );
+
+        if( ( xRead < 0 ) && ( errno == EINTR ) )
+        {
+            continue;
+        }
+
+        if( ( xRead < 0 ) && ( errno == EAGAIN ) )
+        {
+            return NULL;
+        }
+
+        if( xRead <= 0 )
+        {
+            /* The load test has gone. */
+            _exit( EXIT_FAILURE );
+        }
+
+        xLineLength += ( size_t ) xRead;
+    }
+
+    *pcEnd = '\0';
+
+    return cLine;
+}
+/*-----------------------------------------------------------*/
+
+/* Drop the line returned by prvReadLine(). */
+static void prvConsumeLine( void )
+{
+    size_t xUsed = strlen( cLine ) + 1;
+
+    xLineLength -= xUsed;
+    ( void ) memmove( cLine, cLine + xUsed, xLineLength );
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartAgent( void )
+{
+    CDF_AgentInit_internal( xMqttConnection,
+                            ( const uint8_t * ) clientcredentialIOT_THING_NAME,
+                            NULL,
+                            &xCdfApi,
+                            0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeviceTask( void * pvParameters )
+{
+    IotMqttConnectInfo_t xConnectInfo = IOT_MQTT_CONNECT_INFO_INITIALIZER;
+    const char * pcLine;
+    CDF_State_t eState;
+    DevicePhase_t ePhase = ePhaseRotating;
+
+    ( void ) pvParameters;
+
+    configASSERT( IotSdk_Init() == true );
+    configASSERT( IotMqtt_Init() == IOT_MQTT_SUCCESS );
+    configASSERT( IotMutex_Create( &xRxLock, false ) == true );
+    configASSERT( IotSemaphore_Create( &xRxPackets, 0, deviceRX_BUFFER_SIZE ) == true );
+
+    xNetworkInterface.send = prvBrokerSend;
+    xNetworkInterface.receive = prvBrokerReceive;
+    xNetworkInterface.setReceiveCallback = prvSetReceiveCallback;
+    xNetworkInterface.close = prvBrokerClose;
+    xNetworkInterface.destroy = prvBrokerClose;
+    xNetworkInfo.createNetworkConnection = false;
+    xNetworkInfo.u.pNetworkConnection = &xNetworkInterface;
+    xNetworkInfo.pNetworkInterface = &xNetworkInterface;
+
+    configASSERT( Iot_CreateDetachedThread( prvReceiveThread,
+                                            NULL,
+                                            IOT_THREAD_DEFAULT_PRIORITY,
+                                            IOT_THREAD_DEFAULT_STACK_SIZE ) == true );
+
+    xConnectInfo.cleanSession = true;
+    xConnectInfo.keepAliveSeconds = 0;
+    xConnectInfo.pClientIdentifier = clientcredentialIOT_THING_NAME;
+    xConnectInfo.clientIdentifierLength = ( uint16_t ) strlen( clientcredentialIOT_THING_NAME );
+
+    configASSERT( IotMqtt_Connect( &xNetworkInfo,
+                                   &xConnectInfo,
+                                   deviceMQTT_TIMEOUT_MS,
+                                   &xMqttConnection ) == IOT_MQTT_SUCCESS );
+
+    prvStartAgent();
+
+    for( ; ; )
+    {
+        while( ( pcLine = prvReadLine() ) != NULL )
+        {
+            if( strncmp( pcLine, "RESULT ", 7 ) == 0 )
+            {
+                prvQueueResult( pcLine + 7 );
+            }
+            else if( ( strcmp( pcLine, "CONNECTED" ) == 0 ) && ( ePhase == ePhaseReconnecting ) )
+            {
+                /* The MQTT connection is kept; the agent restarts from the
+                 * NVM state, as after a reconnect with the new certificate. */
+                ePhase = ePhaseDetaching;
+                prvStartAgent();
+            }
+
+            prvConsumeLine();
+        }
+
+        eState = CDF_GetAgentState();
+
+        if( ePhase == ePhaseReconnecting )
+        {
+            /* The agent is shut down until the device has reconnected. */
+        }
+        else if( eState == eCDF_AgentState_NotReady )
+        {
+            prvWriteLine( "FAILED\n" );
+            _exit( EXIT_FAILURE );
+        }
+        else if( eState == eCDF_AgentState_ShuttingDown )
+        {
+            CDF_AgentShutdown();
+            prvWriteLine( "FINISHED\n" );
+            _exit( EXIT_SUCCESS );
+        }
+        else if( ( eState == eCDF_AgentState_DeactivateCert ) && ( ePhase == ePhaseRotating ) )
+        {
+            /* The old certificate is deactivated on the new connection. */
+            CDF_AgentShutdown();
+            ePhase = ePhaseReconnecting;
+            prvWriteLine( "RECONNECT\n" );
+        }
+
+        IotClock_SleepMs( devicePOLL_MS );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* The device task polls stdin. */
+    ( void ) fcntl( STDIN_FILENO, F_SETFL, fcntl( STDIN_FILENO, F_GETFL ) | O_NONBLOCK );
+
+    xLoggingTaskInitialize( deviceLOGGING_STACK_SIZE,
+                            deviceLOGGING_PRIORITY,
+                            deviceLOGGING_QUEUE_LENGTH );
+
+    /* The device task is started in the RTOS daemon task startup hook. */
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+    xTaskCreate( prvDeviceTask, "Device", deviceTASK_STACK_SIZE, NULL, deviceTASK_PRIORITY, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vMainPrintString( const char * pcString )
+{
+    prvWrite( STDERR_FILENO, pcString, strlen( pcString ) );
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIdleHook( void )
+{
+    /* Sleep to lower the CPU usage of the host.  The sleep ends early when the
+     * tick signal arrives. */
+    ( void ) usleep( 1000 );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    char cMessage[ 256 ];
+
+    ( void ) snprintf( cMessage, sizeof( cMessage ), "vAssertCalled %s, %ld\n", pcFile, ( long ) ulLine );
+    vMainPrintString( cMessage );
+
+    abort();
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationMallocFailedHook( void )
+{
+    vMainPrintString( "Malloc failed\n" );
+
+    abort();
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
@@ -0,0 +1,731 @@
+"""
+Amazon FreeRTOS
+Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+http://aws.amazon.com/freertos
+http://www.FreeRTOS.org
+
+"""
+"""
+Fleet scale load generator for CDF certificate rotation.
+
+Runs the handlers in lambda/ unmodified against an in-memory AWS IoT and a
+local broker that applies the topic rules from cloudformation.json. The
+devices are a multiplexed model of the state machine in iot_cdf_agent.c:
+GET (attach), ACK (activate), reconnect with the new certificate, then
+DEACTIVATE (detach), with the agent's response timeout and attempt limit.
+With --pipelined the devices ask for the new certificate to be activated with
+the attach, as with cdfconfigPIPELINED_ROTATION, and skip ACK if the lambda
+reports it active. The attach lambda in lambda/ creates every certificate
+inactive, so the devices still send ACK.
+
+The model reads its constants and step order from iot_cdf_agent.c and
+iot_cdf_agent.h at start up and stops if they no longer match. With --agent,
+the first --agent-devices devices run the agent itself, each in a
+cdf_agent_device process of the Linux simulator.
+"""
+import argparse
+import hashlib
+import heapq
+import importlib.util
+import itertools
+import json
+import logging
+import os
+import random
+import re
+import subprocess
+import sys
+import threading
+import time
+import types
+from concurrent.futures import ThreadPoolExecutor
+
+ROOT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..')
+LAMBDA_DIR = os.path.join(ROOT_DIR, 'lambda')
+AGENT_DIR = os.path.join(ROOT_DIR, 'libraries', 'freertos_plus', 'aws', 'ota')
+AGENT_SOURCES = [os.path.join(AGENT_DIR, 'src', 'iot_cdf_agent.c'),
+                 os.path.join(AGENT_DIR, 'include', 'iot_cdf_agent.h')]
+
+# Mirrors of the iot_cdf_agent.c settings, checked by check_agent_mirror().
+# The retry settings are the defaults of iot_cdf_agent.h.
+TOPIC_PREFIX = 'certificate/rotation'
+RESPONSE_TIMEOUT_MS = 10000
+MAX_REQUEST_ATTEMPTS = 4
+RETRY_BURST = 3
+RETRY_INTERVAL_MS = 60000
+
+STEP_GET = 'attach'
+STEP_ACK = 'activate'
+STEP_DEACTIVATE = 'detach'
+
+# The steps in the order the agent runs them, with the request topic macro
+# and the NVM state the agent is in while it runs the step.
+AGENT_STEPS = [
+    (STEP_GET, '_CR_ATTACH_TOPIC', 'CDF_STATE_WAIT_FOR_CERT_ROTATE'),
+    (STEP_ACK, '_CR_ACTIVATE_TOPIC', 'CDF_STATE_ACK_CERT_ROTATE'),
+    (STEP_DEACTIVATE, '_CR_DETACH_TOPIC', 'CDF_STATE_DEACTIVATE_CERT'),
+]
+
+
+def check_agent_mirror():
+    """
+    Compare the mirrored settings with iot_cdf_agent.c and iot_cdf_agent.h.
+
+    Returns the list of differences; it is empty when the model still follows
+    the agent.
+    """
+    source = ''
+    for path in AGENT_SOURCES:
+        with open(path) as f:
+            source += f.read()
+    defines = dict(re.findall(r'^\s*#\s*define\s+(\w+)[ \t]+(.*?)\s*$', source, re.MULTILINE))
+
+    def value(name):
+        # Expand the macros of an integer expression and drop the suffixes.
+        expression = re.sub(r'\b(\d+)[uUlL]+\b', r'\1', defines[name])
+        expression = re.sub(r'\b[A-Za-z_]\w*\b',
+                            lambda m: '({})'.format(value(m.group(0))), expression)
+        return eval(expression, {'__builtins__': {}})
+
+    differences = []
+    for name, mirror in [('_CR_TOPIC_PREFIX', TOPIC_PREFIX),
+                         ('_CR_RESPONSE_TIMEOUT_MS', RESPONSE_TIMEOUT_MS),
+                         ('_CR_MAX_REQUEST_ATTEMPTS', MAX_REQUEST_ATTEMPTS),
+                         ('cdfconfigRETRY_BURST', RETRY_BURST),
+                         ('cdfconfigRETRY_INTERVAL_MS', RETRY_INTERVAL_MS)]:
+        try:
+            actual = defines[name].strip('"') if isinstance(mirror, str) else value(name)
+        except (KeyError, NameError, SyntaxError):
+            actual = None
+        if actual != mirror:
+            differences.append('{} is {}, the model uses {}'.format(name, actual, mirror))
+
+    states = re.search(r'typedef\s+enum\s*\{([^}]*)\}\s*CDF_STATE\s*;', source)
+    states = re.findall(r'\b(CDF_STATE_\w+)', states.group(1)) if states else []
+    order = [state for _, _, state in AGENT_STEPS] + ['CDF_STATE_FINISHED']
+    if [state for state in states if state in order] != order:
+        differences.append('CDF_STATE does not list {} in this order'.format(', '.join(order)))
+
+    for step, topic, _ in AGENT_STEPS:
+        if '"/{}/"'.format(step) not in defines.get(topic, ''):
+            differences.append('{} is not the {} topic'.format(topic, step))
+
+    return differences
+
+
+class Scheduler(object):
+    """
+    Single thread that runs every device callback, in deadline order.
+
+    The devices are only touched from this thread, as the agent's state is only
+    touched with its state lock held.
+    """
+
+    def __init__(self):
+        self._heap = []
+        self._seq = itertools.count()
+        self._cond = threading.Condition()
+        self._stopped = False
+        self._thread = threading.Thread(target=self._run, name='scheduler', daemon=True)
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        with self._cond:
+            self._stopped = True
+            self._cond.notify()
+        self._thread.join()
+
+    def call_later(self, delay_s, fn, *args):
+        with self._cond:
+            heapq.heappush(self._heap, (time.monotonic() + delay_s, next(self._seq), fn, args))
+            self._cond.notify()
+
+    def _run(self):
+        while True:
+            with self._cond:
+                while not self._stopped:
+                    if self._heap:
+                        wait = self._heap[0][0] - time.monotonic()
+                        if wait <= 0:
+                            break
+                        self._cond.wait(wait)
+                    else:
+                        self._cond.wait()
+                if self._stopped:
+                    return
+                _, _, fn, args = heapq.heappop(self._heap)
+            fn(*args)
+
+
+class FakeIot(object):
+    """In-memory stand in for the 'iot' client calls the lambdas make."""
+
+    def __init__(self, api_latency_s):
+        self._lock = threading.Lock()
+        self._api_latency_s = api_latency_s
+        self._serial = itertools.count()
+        self.certificates = {}
+        self.created_from_csr = set()
+        self.calls = 0
+
+    def _call(self):
+        with self._lock:
+            self.calls += 1
+        if self._api_latency_s:
+            time.sleep(self._api_latency_s)
+
+    def add_certificate(self, status, things, policies):
+        certificate_id = hashlib.sha256(str(next(self._serial)).encode()).hexdigest()
+        with self._lock:
+            self.certificates[certificate_id] = {
+                'status': status,
+                'things': list(things),
+                'policies': list(policies),
+            }
+        return certificate_id
+
+    @staticmethod
+    def _arn(certificate_id):
+        return 'arn:aws:iot:local:000000000000:cert/' + certificate_id
+
+    @staticmethod
+    def _id(arn):
+        return arn.rsplit('/', 1)[-1]
+
+    def _certificate(self, certificate_id):
+        certificate = self.certificates.get(certificate_id)
+        if certificate is None:
+            raise Exception('ResourceNotFoundException: certificate {}'.format(certificate_id))
+        return certificate
+
+    def create_certificate_from_csr(self, certificateSigningRequest, setAsActive):
+        self._call()
+        certificate_id = self.add_certificate('ACTIVE' if setAsActive else 'INACTIVE', [], [])
+        with self._lock:
+            self.created_from_csr.add(certificate_id)
+        return {
+            'certificateArn': self._arn(certificate_id),
+            'certificateId': certificate_id,
+            'certificatePem': '-----BEGIN CERTIFICATE-----\n' + certificate_id + '\n-----END CERTIFICATE-----\n',
+        }
+
+    def describe_certificate(self, certificateId):
+        self._call()
+        with self._lock:
+            certificate = self._certificate(certificateId)
+            return {'certificateDescription': {'certificateArn': self._arn(certificateId),
+                                               'status': certificate['status']}}
+
+    def list_attached_policies(self, target, marker=None):
+        self._call()
+        with self._lock:
+            policies = self._certificate(self._id(target))['policies']
+            return {'policies': [{'policyName': name} for name in policies]}
+
+    def list_principal_things(self, principal, nextToken=None):
+        self._call()
+        with self._lock:
+            return {'things': list(self._certificate(self._id(principal))['things'])}
+
+    def attach_policy(self, policyName, target):
+        self._call()
+        with self._lock:
+            self._certificate(self._id(target))['policies'].append(policyName)
+
+    def attach_thing_principal(self, thingName, principal):
+        self._call()
+        with self._lock:
+            self._certificate(self._id(principal))['things'].append(thingName)
+
+    def update_certificate(self, certificateId, newStatus):
+        self._call()
+        with self._lock:
+            self._certificate(certificateId)['status'] = newStatus
+
+
+class FakeIotData(object):
+    """Stand in for the 'iot-data' client; publishes go to the local broker."""
+
+    def __init__(self, broker):
+        self._broker = broker
+
+    def publish(self, topic, qos, payload):
+        self._broker.publish_to_device(topic, payload)
+
+
+def load_lambdas(iot, iot_data):
+    """Import the lambda handlers with boto3 and botocore replaced by the fakes."""
+    # Keep the lambda directory free of bytecode caches.
+    sys.dont_write_bytecode = True
+    boto3 = types.ModuleType('boto3')
+    boto3.client = lambda name, config=None: iot if name == 'iot' else iot_data
+    botocore = types.ModuleType('botocore')
+    botocore_config = types.ModuleType('botocore.config')
+    botocore_config.Config = lambda **kwargs: kwargs
+    botocore.config = botocore_config
+    sys.modules['boto3'] = boto3
+    sys.modules['botocore'] = botocore
+    sys.modules['botocore.config'] = botocore_config
+
+    def load(name):
+        spec = importlib.util.spec_from_file_location(name, os.path.join(LAMBDA_DIR, name + '.py'))
+        module = importlib.util.module_from_spec(spec)
+        spec.loader.exec_module(module)
+        return module
+
+    return {
+        STEP_GET: load('attach_function_csr').create_and_attach,
+        STEP_ACK: load('activate_function').activate,
+        STEP_DEACTIVATE: load('detach_function').deactivate_certificate,
+    }
+
+
+class Broker(object):
+    """
+    Local broker with the three rotation topic rules.
+
+    Each direction drops a message with the configured probability and delivers
+    the rest after the configured latency. Rule actions run on a pool sized like
+    the lambda concurrency limit.
+    """
+
+    def __init__(self, scheduler, args):
+        self._scheduler = scheduler
+        self._latency_s = args.broker_latency_ms / 1000.0
+        self._loss = args.loss
+        self._random = random.Random(args.seed)
+        self._random_lock = threading.Lock()
+        self._pool = ThreadPoolExecutor(max_workers=args.lambda_concurrency)
+        self._devices = {}
+        self.lambdas = None
+        self.invocations = 0
+        self.dropped = 0
+
+    def shutdown(self):
+        self._pool.shutdown(wait=True)
+
+    def attach_device(self, device):
+        self._devices[device.client_id] = device
+
+    def _drop(self):
+        with self._random_lock:
+            drop = self._random.random() < self._loss
+            if drop:
+                self.dropped += 1
+            return drop
+
+    def publish_from_device(self, device, step, payload):
+        """Device publish to certificate/rotation/<step>/<thing>."""
+        if self._drop():
+            return
+        event = {
+            'response': json.loads(payload),
+            'principal': device.certificate_id,
+            'clientId': device.client_id,
+        }
+        if step == STEP_ACK:
+            # The activate rule does not select principal().
+            del event['principal']
+        self._scheduler.call_later(self._latency_s, self._invoke, step, event)
+
+    def _invoke(self, step, event):
+        self.invocations += 1
+        self._pool.submit(self._run_lambda, step, event)
+
+    def _run_lambda(self, step, event):
+        try:
+            self.lambdas[step](event, None)
+        except Exception as e:
+            logging.error('lambda {} raised {}'.format(step, e))
+
+    def publish_to_device(self, topic, payload):
+        """Rule action publish to certificate/rotation/result/<thing>."""
+        if self._drop():
+            return
+        client_id = topic[len(TOPIC_PREFIX + '/result/'):]
+        device = self._devices.get(client_id)
+        if device is not None:
+            self._scheduler.call_later(self._latency_s, device.on_result, payload)
+
+
+class Device(object):
+    """One device running the rotation steps of iot_cdf_agent.c."""
+
+    def __init__(self, client_id, certificate_id, scheduler, broker, stats, args):
+        self.client_id = client_id
+        self.certificate_id = certificate_id
+        self._scheduler = scheduler
+        self._broker = broker
+        self._stats = stats
+        self._timeout_s = args.response_timeout_ms / 1000.0
+        self._reconnect_s = args.reconnect_ms / 1000.0
+        self._pipelined = args.pipelined
+        self._step = None
+        self._attempts = 0
+        self._awaiting = False
+        self._deadline = 0.0
+        self._started = 0.0
+        self._new_certificate_id = None
+        self._old_certificate_id = None
+        self._activated = False
+        self._retry_tokens = RETRY_BURST
+        self._retry_refill = 0.0
+
+    def start(self):
+        self._started = time.monotonic()
+        self._step = STEP_GET
+        self._reset_retry_tokens()
+        self._send_request()
+
+    def _reset_retry_tokens(self):
+        # The agent fills its bucket when it is initialised.
+        self._retry_tokens = RETRY_BURST
+        self._retry_refill = time.monotonic()
+
+    def _take_retry_token(self):
+        """Mirrors prvCDF_TakeRetryToken: returns 0 or the wait for the next token."""
+        interval_s = RETRY_INTERVAL_MS / 1000.0
+        now = time.monotonic()
+        accrued = int((now - self._retry_refill) / interval_s)
+        if self._retry_tokens + accrued >= RETRY_BURST:
+            self._retry_tokens = RETRY_BURST
+            self._retry_refill = now
+        else:
+            self._retry_tokens += accrued
+            self._retry_refill += accrued * interval_s
+        if self._retry_tokens == 0:
+            return self._retry_refill + interval_s - now
+        self._retry_tokens -= 1
+        return 0.0
+
+    def _payload(self):
+        if self._step == STEP_GET:
+            return json.dumps({'csr': '-----BEGIN CERTIFICATE REQUEST-----\n' + self.client_id +
+                               '\n-----END CERTIFICATE REQUEST-----\n',
+                               'autoActivate': self._pipelined})
+        if self._step == STEP_ACK:
+            return json.dumps({'newCertificateId': self._new_certificate_id})
+        return json.dumps({'oldCertificateId': self._old_certificate_id})
+
+    def _send_request(self):
+        if self._attempts >= MAX_REQUEST_ATTEMPTS:
+            self._awaiting = False
+            self._stats.failed(self._step)
+            return
+        self._attempts += 1
+        if self._attempts > 1:
+            self._stats.retried(self._step)
+        self._broker.publish_from_device(self, self._step, self._payload())
+        self._awaiting = True
+        self._arm_timeout(self._timeout_s)
+
+    def _arm_timeout(self, timeout_s):
+        self._deadline = time.monotonic() + timeout_s
+        self._scheduler.call_later(timeout_s, self._on_timeout)
+
+    def _on_timeout(self):
+        # The deadline tells a stale timeout apart from the one for the request in flight.
+        if not self._awaiting or time.monotonic() < self._deadline:
+            return
+        # The last attempt fails the step without a token.
+        if self._attempts < MAX_REQUEST_ATTEMPTS:
+            wait_s = self._take_retry_token()
+            if wait_s > 0:
+                self._stats.held_retry(self._step)
+                self._arm_timeout(wait_s)
+                return
+        self._send_request()
+
+    def on_result(self, payload):
+        if not self._awaiting:
+            self._stats.dropped_response()
+            return
+        try:
+            response = json.loads(payload)
+        except ValueError:
+            return
+        if isinstance(response, dict) and 'error' in response:
+            # Unusable response: the step stays in flight until its timeout.
+            return
+        if self._step == STEP_GET:
+            try:
+                self._new_certificate_id = response['newCertificateId']
+                self._old_certificate_id = response['oldCertificateId']
+                response['newCertificatePem']
+            except (KeyError, TypeError):
+                return
+            self._activated = response.get('activated') is True
+        self._complete_step()
+
+    def _complete_step(self):
+        self._awaiting = False
+        self._attempts = 0
+        if self._step == STEP_GET and not self._activated:
+            self._step = STEP_ACK
+            self._send_request()
+        elif self._step in (STEP_GET, STEP_ACK):
+            self._step = STEP_DEACTIVATE
+            self._scheduler.call_later(self._reconnect_s, self._reconnect)
+        else:
+            self._stats.finished(time.monotonic() - self._started)
+
+    def _reconnect(self):
+        self.certificate_id = self._new_certificate_id
+        self._reset_retry_tokens()
+        self._send_request()
+
+
+class AgentDevice(object):
+    """
+    One device running iot_cdf_agent.c in a cdf_agent_device process.
+
+    The process speaks the line protocol described in cdf_agent_device.c. The
+    agent's own response timeout, attempt limit and retry bucket apply.
+    """
+
+    def __init__(self, client_id, certificate_id, scheduler, broker, stats, args):
+        self.client_id = client_id
+        self.certificate_id = certificate_id
+        self.finished = False
+        self._scheduler = scheduler
+        self._broker = broker
+        self._stats = stats
+        self._path = args.agent
+        self._verbose = args.verbose
+        self._reconnect_s = args.reconnect_ms / 1000.0
+        self._process = None
+        self._step = STEP_GET
+        self._published = set()
+        self._settled = False
+        self._started = 0.0
+        self._new_certificate_id = None
+
+    def start(self):
+        self._started = time.monotonic()
+        self._process = subprocess.Popen([self._path], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                         stderr=None if self._verbose else subprocess.DEVNULL,
+                                         universal_newlines=True, bufsize=1)
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def stop(self):
+        if self._process is not None:
+            self._process.kill()
+            self._process.wait()
+
+    def _read(self):
+        for line in self._process.stdout:
+            command, _, argument = line.rstrip('\n').partition(' ')
+            self._scheduler.call_later(0, self._on_line, command, argument)
+        self._scheduler.call_later(0, self._settle, False)
+
+    def _write(self, line):
+        try:
+            self._process.stdin.write(line + '\n')
+            self._process.stdin.flush()
+        except (BrokenPipeError, ValueError):
+            pass
+
+    def _on_line(self, command, argument):
+        if command == 'PUBLISH':
+            topic, _, payload = argument.partition(' ')
+            step = topic[len(TOPIC_PREFIX) + 1:].split('/')[0]
+            if step not in (STEP_GET, STEP_ACK, STEP_DEACTIVATE):
+                return
+            if step in self._published:
+                self._stats.retried(step)
+            self._published.add(step)
+            self._step = step
+            self._broker.publish_from_device(self, step, payload)
+        elif command == 'RECONNECT':
+            self._scheduler.call_later(self._reconnect_s, self._reconnect)
+        elif command in ('FINISHED', 'FAILED'):
+            self._settle(command == 'FINISHED')
+
+    def _settle(self, finished):
+        if self._settled:
+            return
+        self._settled = True
+        self.finished = finished
+        if finished:
+            self._stats.finished(time.monotonic() - self._started)
+        else:
+            self._stats.failed(self._step)
+
+    def on_result(self, payload):
+        if self._step == STEP_GET:
+            try:
+                self._new_certificate_id = json.loads(payload)['newCertificateId']
+            except (ValueError, KeyError, TypeError):
+                pass
+        self._write('RESULT ' + payload)
+
+    def _reconnect(self):
+        self.certificate_id = self._new_certificate_id
+        self._write('CONNECTED')
+
+
+class Stats(object):
+    """Counters updated from the scheduler thread."""
+
+    def __init__(self, devices):
+        self.pending = devices
+        self.latencies = []
+        self.failures = {STEP_GET: 0, STEP_ACK: 0, STEP_DEACTIVATE: 0}
+        self.retries = {STEP_GET: 0, STEP_ACK: 0, STEP_DEACTIVATE: 0}
+        self.held_retries = {STEP_GET: 0, STEP_ACK: 0, STEP_DEACTIVATE: 0}
+        self.dropped_responses = 0
+        self.done = threading.Event()
+        if devices == 0:
+            self.done.set()
+
+    def _settle(self):
+        self.pending -= 1
+        if self.pending == 0:
+            self.done.set()
+
+    def finished(self, latency_s):
+        self.latencies.append(latency_s)
+        self._settle()
+
+    def failed(self, step):
+        self.failures[step] += 1
+        self._settle()
+
+    def retried(self, step):
+        self.retries[step] += 1
+
+    def held_retry(self, step):
+        self.held_retries[step] += 1
+
+    def dropped_response(self):
+        self.dropped_responses += 1
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='Load test CDF certificate rotation against local lambdas.')
+    parser.add_argument('--devices', type=int, default=1000, help='Number of devices to rotate.')
+    parser.add_argument('--wave-size', type=int, default=250, help='Devices that start rotating together.')
+    parser.add_argument('--wave-interval-ms', type=int, default=1000, help='Time between the start of two waves.')
+    parser.add_argument('--loss', type=float, default=0.0, help='Probability that a message is dropped, per direction.')
+    parser.add_argument('--broker-latency-ms', type=float, default=5.0, help='One way broker delivery latency.')
+    parser.add_argument('--iot-api-latency-ms', type=float, default=2.0, help='Latency of each AWS IoT API call.')
+    parser.add_argument('--lambda-concurrency', type=int, default=64, help='Concurrent lambda invocations.')
+    parser.add_argument('--response-timeout-ms', type=int, default=RESPONSE_TIMEOUT_MS,
+                        help='Device wait for a response before it re-sends the request.')
+    parser.add_argument('--reconnect-ms', type=int, default=100,
+                        help='Time the device takes to reconnect with the new certificate.')
+    parser.add_argument('--pipelined', action='store_true',
+                        help='Ask for the new certificate to be activated with the attach.')
+    parser.add_argument('--seed', type=int, default=1, help='Seed for the loss injection.')
+    parser.add_argument('--json', action='store_true', help='Print the report as JSON.')
+    parser.add_argument('--agent', metavar='PATH',
+                        help='cdf_agent_device program that runs iot_cdf_agent.c for the first devices.')
+    parser.add_argument('--agent-devices', type=int, default=8,
+                        help='Devices that run the agent when --agent is given.')
+    parser.add_argument('--verbose', action='store_true', help='Show the lambda and agent logs.')
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    logging.basicConfig(level=logging.INFO if args.verbose else logging.CRITICAL)
+
+    differences = check_agent_mirror()
+    if differences:
+        for difference in differences:
+            print('iot_cdf_agent.c changed: {}'.format(difference), file=sys.stderr)
+        print('Update the mirrored settings in {}.'.format(os.path.basename(__file__)), file=sys.stderr)
+        return 2
+    agent_devices = min(args.agent_devices, args.devices) if args.agent else 0
+
+    scheduler = Scheduler()
+    broker = Broker(scheduler, args)
+    iot = FakeIot(args.iot_api_latency_ms / 1000.0)
+    broker.lambdas = load_lambdas(iot, FakeIotData(broker))
+    if not args.verbose:
+        # The handlers set the root logger level when they are imported.
+        logging.getLogger().setLevel(logging.CRITICAL)
+
+    stats = Stats(args.devices)
+    devices = []
+    for index in range(args.devices):
+        client_id = 'cdf-load-{:06d}'.format(index)
+        certificate_id = iot.add_certificate('ACTIVE', [client_id], ['cdf-load-policy'])
+        device_class = AgentDevice if index < agent_devices else Device
+        device = device_class(client_id, certificate_id, scheduler, broker, stats, args)
+        broker.attach_device(device)
+        devices.append(device)
+
+    scheduler.start()
+    start = time.monotonic()
+    for first in range(0, args.devices, args.wave_size):
+        delay_s = (first // args.wave_size) * args.wave_interval_ms / 1000.0
+        for device in devices[first:first + args.wave_size]:
+            scheduler.call_later(delay_s, device.start)
+
+    stats.done.wait()
+    elapsed = time.monotonic() - start
+    scheduler.stop()
+    broker.shutdown()
+    for device in devices[:agent_devices]:
+        device.stop()
+
+    completed = len(stats.latencies)
+    report = {
+        'devices': args.devices,
+        'completed': completed,
+        'failed': stats.failures,
+        'agent_devices': agent_devices,
+        'agent_completed': sum(1 for device in devices[:agent_devices] if device.finished),
+        'elapsed_s': round(elapsed, 3),
+        'rotations_per_s': round(completed / elapsed, 2) if elapsed > 0 else 0.0,
+        'latency_p50_ms': round(percentile(stats.latencies, 0.50) * 1000.0, 1),
+        'latency_p99_ms': round(percentile(stats.latencies, 0.99) * 1000.0, 1),
+        'latency_max_ms': round(max(stats.latencies) * 1000.0, 1) if stats.latencies else 0.0,
+        'retries': stats.retries,
+        'retries_held': stats.held_retries,
+        'messages_dropped': broker.dropped,
+        'late_responses': stats.dropped_responses,
+        'lambda_invocations': broker.invocations,
+        'iot_api_calls': iot.calls,
+        'orphaned_certificates': len(iot.created_from_csr - set(device.certificate_id for device in devices)),
+    }
+
+    if args.json:
+        print(json.dumps(report, indent=2))
+    else:
+        for key, value in report.items():
+            print('{:<24}{}'.format(key, value))
+
+    return 0 if completed == args.devices else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
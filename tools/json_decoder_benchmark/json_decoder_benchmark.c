@@ -0,0 +1,420 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Compares the two JSON decoders of the serializer on Shadow delta documents.
+ *
+ * The documents are built with _IotSerializerJsonEncoder. Each decoder then
+ * reads every field of every document through the decode interface: the
+ * top-level fields with find, and the state and metadata maps by iterating
+ * over them. The allocator counts the calls the decoders make.
+ */
+
+/* Serializer includes. */
+#include "iot_serializer.h"
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define benchDEFAULT_ITERATIONS    ( 2000 )
+#define benchDOCUMENT_COUNT        ( 16 )
+#define benchDOCUMENT_SIZE         ( 1024 )
+#define benchARENA_TOKENS          ( 128 )
+
+/**
+ * @brief Totals of one series.
+ */
+typedef struct SeriesResult
+{
+    double dDecodeMs;
+    uint32_t ulAllocations;
+    uint32_t ulPeakBytes;
+    uint32_t ulScalars;
+} SeriesResult_t;
+
+static uint8_t ucDocuments[ benchDOCUMENT_COUNT ][ benchDOCUMENT_SIZE ];
+static size_t xDocumentLengths[ benchDOCUMENT_COUNT ];
+
+static uint32_t ulAllocations = 0;
+static uint32_t ulLiveBytes = 0;
+static uint32_t ulPeakBytes = 0;
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    size_t * pxBlock = malloc( sizeof( size_t ) + xSize );
+
+    if( pxBlock != NULL )
+    {
+        *pxBlock = xSize;
+        ulAllocations++;
+        ulLiveBytes += ( uint32_t ) xSize;
+        ulPeakBytes = ( ulLiveBytes > ulPeakBytes ) ? ulLiveBytes : ulPeakBytes;
+        pxBlock++;
+    }
+
+    return pxBlock;
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    size_t * pxBlock = pv;
+
+    if( pxBlock != NULL )
+    {
+        pxBlock--;
+        ulLiveBytes -= ( uint32_t ) *pxBlock;
+        free( pxBlock );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static double prvNowMs( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1000.0 ) + ( ( double ) xNow.tv_nsec / 1000000.0 );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Encode a delta document like the one the Shadow service publishes on
+ * update/delta, together with the metadata of every reported field.
+ */
+static IotSerializerError_t prvEncodeDelta( uint32_t ulIndex,
+                                            uint8_t * pucBuffer,
+                                            size_t xBufferSize,
+                                            size_t * pxLength )
+{
+    const char * const pcColors[] = { "red", "green", "blue" };
+    const int64_t llTimestamp = 1560000000 + ( int64_t ) ulIndex;
+    char cClientToken[ 32 ];
+    uint32_t i;
+    IotSerializerEncoderObject_t xStream = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_STREAM;
+    IotSerializerEncoderObject_t xRoot = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerEncoderObject_t xState = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerEncoderObject_t xColor = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerEncoderObject_t xMetadata = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerEncoderObject_t xField = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerEncoderObject_t xEntry = IOT_SERIALIZER_ENCODER_CONTAINER_INITIALIZER_MAP;
+    IotSerializerError_t xError;
+
+    ( void ) snprintf( cClientToken, sizeof( cClientToken ), "device-%08u", ( unsigned int ) ulIndex );
+
+    xError = _IotSerializerJsonEncoder.init( &xStream, pucBuffer, xBufferSize );
+    xError |= _IotSerializerJsonEncoder.openContainer( &xStream, &xRoot, 5 );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xRoot, "version", IotSerializer_ScalarSignedInt( 100 + ulIndex ) );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xRoot, "timestamp", IotSerializer_ScalarSignedInt( llTimestamp ) );
+
+    /* Desired state that differs from the reported state. */
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xRoot, "state", &xState, 4 );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xState, "powerOn", IotSerializer_ScalarSignedInt( ulIndex % 2 ) );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xState, "brightness", IotSerializer_ScalarSignedInt( ulIndex * 7 % 100 ) );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xState, "mode", IotSerializer_ScalarTextString( "scene" ) );
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xState, "color", &xColor, 3 );
+
+    for( i = 0; i < 3; i++ )
+    {
+        xError |= _IotSerializerJsonEncoder.appendKeyValue( &xColor, pcColors[ i ], IotSerializer_ScalarSignedInt( ( ulIndex * ( i + 3 ) ) % 256 ) );
+    }
+
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xState, &xColor );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xRoot, &xState );
+
+    /* A timestamp for every field of the state. */
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xRoot, "metadata", &xMetadata, 4 );
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xMetadata, "powerOn", &xField, 1 );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xField, "timestamp", IotSerializer_ScalarSignedInt( llTimestamp ) );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xMetadata, &xField );
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xMetadata, "brightness", &xField, 1 );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xField, "timestamp", IotSerializer_ScalarSignedInt( llTimestamp ) );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xMetadata, &xField );
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xMetadata, "mode", &xField, 1 );
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xField, "timestamp", IotSerializer_ScalarSignedInt( llTimestamp ) );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xMetadata, &xField );
+    xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xMetadata, "color", &xField, 3 );
+
+    for( i = 0; i < 3; i++ )
+    {
+        xError |= _IotSerializerJsonEncoder.openContainerWithKey( &xField, pcColors[ i ], &xEntry, 1 );
+        xError |= _IotSerializerJsonEncoder.appendKeyValue( &xEntry, "timestamp", IotSerializer_ScalarSignedInt( llTimestamp ) );
+        xError |= _IotSerializerJsonEncoder.closeContainer( &xField, &xEntry );
+    }
+
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xMetadata, &xField );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xRoot, &xMetadata );
+
+    xError |= _IotSerializerJsonEncoder.appendKeyValue( &xRoot, "clientToken", IotSerializer_ScalarTextString( cClientToken ) );
+    xError |= _IotSerializerJsonEncoder.closeContainer( &xStream, &xRoot );
+
+    *pxLength = _IotSerializerJsonEncoder.getEncodedSize( &xStream, pucBuffer );
+    _IotSerializerJsonEncoder.destroy( &xStream );
+
+    /* The decoders expect a terminated string. */
+    if( ( xError == IOT_SERIALIZER_SUCCESS ) && ( *pxLength >= xBufferSize ) )
+    {
+        xError = IOT_SERIALIZER_BUFFER_TOO_SMALL;
+    }
+    else
+    {
+        pucBuffer[ *pxLength ] = '\0';
+    }
+
+    return xError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Read every element of a container and, recursively, of the containers in
+ * it. Returns the number of scalars read, or 0 if the decoder failed.
+ */
+static uint32_t prvWalkContainer( const IotSerializerDecodeInterface_t * pxDecoder,
+                                  IotSerializerDecoderObject_t * pxContainer )
+{
+    IotSerializerDecoderIterator_t xIterator = IOT_SERIALIZER_DECODER_ITERATOR_INITIALIZER;
+    IotSerializerDecoderObject_t xValue;
+    uint32_t ulScalars = 0, ulNested;
+    IotSerializerError_t xError;
+
+    xError = pxDecoder->stepIn( pxContainer, &xIterator );
+
+    while( ( xError == IOT_SERIALIZER_SUCCESS ) && !pxDecoder->isEndOfContainer( xIterator ) )
+    {
+        xValue.type = IOT_SERIALIZER_UNDEFINED;
+        xError = pxDecoder->get( xIterator, &xValue );
+
+        if( xError != IOT_SERIALIZER_SUCCESS )
+        {
+            break;
+        }
+
+        if( ( xValue.type == IOT_SERIALIZER_CONTAINER_MAP ) || ( xValue.type == IOT_SERIALIZER_CONTAINER_ARRAY ) )
+        {
+            ulNested = prvWalkContainer( pxDecoder, &xValue );
+            pxDecoder->destroy( &xValue );
+
+            if( ulNested == 0 )
+            {
+                xError = IOT_SERIALIZER_INTERNAL_FAILURE;
+                break;
+            }
+
+            ulScalars += ulNested;
+        }
+        else
+        {
+            ulScalars++;
+        }
+
+        xError = pxDecoder->next( xIterator );
+    }
+
+    if( xError == IOT_SERIALIZER_SUCCESS )
+    {
+        xError = pxDecoder->stepOut( xIterator, pxContainer );
+    }
+
+    return ( xError == IOT_SERIALIZER_SUCCESS ) ? ulScalars : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Read a delta document the way an application does: the top-level fields
+ * by key, then every desired field and its metadata.
+ */
+static uint32_t prvReadDelta( const IotSerializerDecodeInterface_t * pxDecoder,
+                              IotSerializerDecoderObject_t * pxRoot )
+{
+    const char * const pcScalarKeys[] = { "version", "timestamp", "clientToken" };
+    const char * const pcMapKeys[] = { "state", "metadata" };
+    IotSerializerDecoderObject_t xValue;
+    uint32_t ulScalars = 0, ulNested, i;
+
+    for( i = 0; i < sizeof( pcScalarKeys ) / sizeof( pcScalarKeys[ 0 ] ); i++ )
+    {
+        xValue.type = IOT_SERIALIZER_UNDEFINED;
+
+        if( pxDecoder->find( pxRoot, pcScalarKeys[ i ], &xValue ) != IOT_SERIALIZER_SUCCESS )
+        {
+            return 0;
+        }
+
+        ulScalars++;
+    }
+
+    for( i = 0; i < sizeof( pcMapKeys ) / sizeof( pcMapKeys[ 0 ] ); i++ )
+    {
+        xValue.type = IOT_SERIALIZER_UNDEFINED;
+
+        if( pxDecoder->find( pxRoot, pcMapKeys[ i ], &xValue ) != IOT_SERIALIZER_SUCCESS )
+        {
+            return 0;
+        }
+
+        ulNested = prvWalkContainer( pxDecoder, &xValue );
+        pxDecoder->destroy( &xValue );
+
+        if( ulNested == 0 )
+        {
+            return 0;
+        }
+
+        ulScalars += ulNested;
+    }
+
+    return ulScalars;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvRunSeries( const char * pcName,
+                         const IotSerializerDecodeInterface_t * pxDecoder,
+                         IotSerializerJsonArena_t * pxArena,
+                         uint32_t ulIterations )
+{
+    SeriesResult_t xResult = { 0 };
+    IotSerializerDecoderObject_t xRoot;
+    uint32_t i, ulDocument, ulScalars;
+    double dStart;
+    int lResult = 0;
+
+    ulAllocations = 0;
+    ulPeakBytes = 0;
+    dStart = prvNowMs();
+
+    for( i = 0; ( i < ulIterations ) && ( lResult == 0 ); i++ )
+    {
+        for( ulDocument = 0; ulDocument < benchDOCUMENT_COUNT; ulDocument++ )
+        {
+            /* The arena decoder finds its token arena in the handle. */
+            xRoot.type = IOT_SERIALIZER_UNDEFINED;
+            xRoot.u.pHandle = pxArena;
+
+            if( pxDecoder->init( &xRoot, ucDocuments[ ulDocument ], xDocumentLengths[ ulDocument ] + 1 ) != IOT_SERIALIZER_SUCCESS )
+            {
+                lResult = -1;
+                break;
+            }
+
+            ulScalars = prvReadDelta( pxDecoder, &xRoot );
+            pxDecoder->destroy( &xRoot );
+
+            if( ulScalars == 0 )
+            {
+                lResult = -1;
+                break;
+            }
+
+            xResult.ulScalars += ulScalars;
+        }
+    }
+
+    xResult.dDecodeMs = prvNowMs() - dStart;
+    xResult.ulAllocations = ulAllocations;
+    xResult.ulPeakBytes = ulPeakBytes;
+
+    if( lResult == 0 )
+    {
+        printf( "%-8s %10.3f %8.1f %8u %8.1f\n",
+                pcName,
+                ( xResult.dDecodeMs * 1000.0 ) / ( ulIterations * benchDOCUMENT_COUNT ),
+                ( double ) xResult.ulAllocations / ( ulIterations * benchDOCUMENT_COUNT ),
+                xResult.ulPeakBytes,
+                ( double ) xResult.ulScalars / ( ulIterations * benchDOCUMENT_COUNT ) );
+    }
+    else
+    {
+        printf( "%-8s failed to decode document %u\n", pcName, ( unsigned int ) ulDocument );
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    static IotSerializerJsonToken_t xTokens[ benchARENA_TOKENS ];
+    IotSerializerJsonArena_t xArena = IOT_SERIALIZER_JSON_ARENA_INITIALIZER( xTokens, benchARENA_TOKENS );
+    uint32_t ulIterations = benchDEFAULT_ITERATIONS, ulDocument;
+    size_t xTotalLength = 0;
+    double dStart, dEncodeMs;
+    int lResult = 0;
+
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+
+        if( ulIterations == 0 )
+        {
+            fprintf( stderr, "usage: %s [iterations]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+
+    dStart = prvNowMs();
+
+    for( ulDocument = 0; ulDocument < benchDOCUMENT_COUNT; ulDocument++ )
+    {
+        if( prvEncodeDelta( ulDocument, ucDocuments[ ulDocument ], benchDOCUMENT_SIZE, &xDocumentLengths[ ulDocument ] ) != IOT_SERIALIZER_SUCCESS )
+        {
+            fprintf( stderr, "failed to encode document %u\n", ( unsigned int ) ulDocument );
+            return 1;
+        }
+
+        xTotalLength += xDocumentLengths[ ulDocument ];
+    }
+
+    dEncodeMs = prvNowMs() - dStart;
+
+    printf( "%u documents, %zu bytes on average, encoded in %.3f us each\n",
+            benchDOCUMENT_COUNT,
+            xTotalLength / benchDOCUMENT_COUNT,
+            ( dEncodeMs * 1000.0 ) / benchDOCUMENT_COUNT );
+    printf( "%-8s %10s %8s %8s %8s\n", "decoder", "us", "allocs", "peak", "scalars" );
+
+    lResult = prvRunSeries( "legacy", &_IotSerializerJsonDecoder, NULL, ulIterations );
+
+    if( lResult == 0 )
+    {
+        lResult = prvRunSeries( "arena", &_IotSerializerJsonArenaDecoder, &xArena, ulIterations );
+    }
+
+    return ( lResult == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,714 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/*
+ * Measures the goodput of a FreeRTOS+TCP connection over a slow link with
+ * latency and packet loss.
+ *
+ * The kernel runs on the POSIX port.  The network interface is a simulated
+ * link that returns every packet to the stack, with the source and the
+ * destination address swapped.  A client connects to 192.168.1.3, and its
+ * packets arrive at a server socket of the same stack.  In each direction,
+ * the link has a bit rate, a drop-tail queue, a one-way delay and a random
+ * loss.
+ *
+ * The client sends with FreeRTOS_send(), FreeRTOS_sendv() or a zero-copy
+ * FreeRTOS_send().  The data is a pattern that repeats every
+ * benchPATTERN_PERIOD bytes, and the server counts the bytes that differ from
+ * it.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
+#include "NetworkInterface.h"
+#include "NetworkBufferManagement.h"
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define benchDEFAULT_KBYTES        ( 512UL )
+#define benchDEFAULT_RTT_MS        ( 100UL )
+#define benchDEFAULT_RATE_KBPS     ( 2000UL )
+#define benchDEFAULT_QUEUE         ( 20UL )
+#define benchMAX_LOSS_RATES        ( 8 )
+#define benchRING_SIZE             ( 256 )
+#define benchSERVER_PORT           ( 502 )
+#define benchWINDOW_SEGMENTS       ( 64 )
+#define benchBUFFER_SIZE           ( 128 * 1024 )
+#define benchCHUNK_SIZE            ( 4096 )
+#define benchPATTERN_PERIOD        ( 251 )
+#define benchTIMEOUT_MS            ( 60000 )
+#define benchTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define benchTASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+#define benchLINK_TASK_PRIORITY    ( configMAX_PRIORITIES - 1 )
+
+static const uint8_t ucIPAddress[ 4 ] = { 192, 168, 1, 2 };
+static const uint8_t ucNetMask[ 4 ] = { 255, 255, 255, 0 };
+static const uint8_t ucGatewayAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucMACAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+/* The address of the server, as seen by the client.  The link turns it into
+ * the address of the stack. */
+static const MACAddress_t xPeerMACAddress = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+#define benchPEER_IP_ADDRESS       FreeRTOS_inet_addr_quick( 192, 168, 1, 3 )
+
+/* One direction of the link.  Frames leave the queue one after the other at
+ * the bit rate, and arrive after the one-way delay. */
+typedef struct xLINK
+{
+    NetworkBufferDescriptor_t * pxFrames[ benchRING_SIZE ];
+    uint64_t ullDepartUs[ benchRING_SIZE ];
+    uint64_t ullArriveUs[ benchRING_SIZE ];
+    size_t uxHead;
+    size_t uxTail;
+    uint64_t ullBusyUntilUs;
+    uint32_t ulPayloadBytes;
+    uint32_t ulLost;
+    uint32_t ulDropped;
+} Link_t;
+
+/* xLinks[ 0 ] carries the data from the client, xLinks[ 1 ] carries the
+ * ACK's from the server. */
+static Link_t xLinks[ 2 ];
+
+static uint32_t ulKBytes = benchDEFAULT_KBYTES;
+static uint32_t ulRTTms = benchDEFAULT_RTT_MS;
+static uint32_t ulRateKbps = benchDEFAULT_RATE_KBPS;
+static uint32_t ulQueueLimit = benchDEFAULT_QUEUE;
+static double dLossRates[ benchMAX_LOSS_RATES ] = { 0.0, 1.0, 2.0, 5.0 };
+static size_t uxLossRateCount = 4;
+
+/* The current loss threshold, compared with a 32-bit random number. */
+static uint32_t ulLossThreshold;
+static uint32_t ulRandomState = 0x2545F491UL;
+
+/* How the client adds data to the transmit stream. */
+typedef enum
+{
+    eSendCopy,     /* FreeRTOS_send(). */
+    eSendVector,   /* FreeRTOS_sendv() with several elements. */
+    eSendZeroCopy  /* FreeRTOS_get_tx_head() and FREERTOS_ZERO_COPY. */
+} SendMode_t;
+
+static const char * const pcSendModes[] = { "copy", "sendv", "zerocopy" };
+static SendMode_t eSendMode = eSendCopy;
+
+/* The data pattern, long enough to start a chunk at any position of the
+ * period. */
+static uint8_t ucPattern[ benchCHUNK_SIZE + benchPATTERN_PERIOD ];
+
+static TaskHandle_t xBenchmarkTask;
+static volatile TickType_t xServerDoneTime;
+static volatile uint32_t ulServerReceived;
+static volatile uint32_t ulServerErrors;
+
+/*-----------------------------------------------------------*/
+
+static uint64_t prvNowUs( void )
+{
+    return ( uint64_t ) xTaskGetTickCount() * portTICK_PERIOD_MS * 1000ULL;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    ulRandomState ^= ulRandomState << 13;
+    ulRandomState ^= ulRandomState >> 17;
+    ulRandomState ^= ulRandomState << 5;
+
+    return ulRandomState;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLinkSend( NetworkBufferDescriptor_t * pxFrame )
+{
+    TCPPacket_t * pxPacket = ( TCPPacket_t * ) pxFrame->pucEthernetBuffer;
+    Link_t * pxLink;
+    uint32_t ulAddress, ulPayload;
+    uint64_t ullNow, ullDepart;
+    size_t uxIndex, uxQueued = 0;
+    BaseType_t xDrop = pdFALSE;
+
+    if( ( pxFrame->xDataLength < ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) ||
+        ( pxPacket->xEthernetHeader.usFrameType != ipIPv4_FRAME_TYPE ) ||
+        ( pxPacket->xIPHeader.ucProtocol != ( uint8_t ) ipPROTOCOL_TCP ) )
+    {
+        /* Only TCP travels over the link, the ARP cache is filled in
+         * advance. */
+        vReleaseNetworkBufferAndDescriptor( pxFrame );
+        return;
+    }
+
+    if( pxPacket->xTCPHeader.usDestinationPort == FreeRTOS_htons( benchSERVER_PORT ) )
+    {
+        pxLink = &( xLinks[ 0 ] );
+    }
+    else
+    {
+        pxLink = &( xLinks[ 1 ] );
+    }
+
+    ulPayload = ( uint32_t ) FreeRTOS_ntohs( pxPacket->xIPHeader.usLength ) - ipSIZE_OF_IPv4_HEADER -
+                ( ( uint32_t ) ( pxPacket->xTCPHeader.ucTCPOffset >> 4 ) * 4UL );
+
+    /* Return the packet to the stack, as if it came from the other side.
+     * Swapping the addresses does not change the checksums. */
+    ulAddress = pxPacket->xIPHeader.ulSourceIPAddress;
+    pxPacket->xIPHeader.ulSourceIPAddress = pxPacket->xIPHeader.ulDestinationIPAddress;
+    pxPacket->xIPHeader.ulDestinationIPAddress = ulAddress;
+    memcpy( pxPacket->xEthernetHeader.xDestinationAddress.ucBytes, ucMACAddress, sizeof( ucMACAddress ) );
+    memcpy( pxPacket->xEthernetHeader.xSourceAddress.ucBytes, xPeerMACAddress.ucBytes, sizeof( xPeerMACAddress ) );
+
+    taskENTER_CRITICAL();
+    {
+        pxLink->ulPayloadBytes += ulPayload;
+        ullNow = prvNowUs();
+
+        for( uxIndex = pxLink->uxTail; uxIndex != pxLink->uxHead; uxIndex = ( uxIndex + 1 ) % benchRING_SIZE )
+        {
+            if( pxLink->ullDepartUs[ uxIndex ] > ullNow )
+            {
+                uxQueued++;
+            }
+        }
+
+        if( prvRandom() < ulLossThreshold )
+        {
+            pxLink->ulLost++;
+            xDrop = pdTRUE;
+        }
+        else if( ( uxQueued >= ulQueueLimit ) || ( ( ( pxLink->uxHead + 1 ) % benchRING_SIZE ) == pxLink->uxTail ) )
+        {
+            pxLink->ulDropped++;
+            xDrop = pdTRUE;
+        }
+        else
+        {
+            ullDepart = ( ullNow > pxLink->ullBusyUntilUs ) ? ullNow : pxLink->ullBusyUntilUs;
+            ullDepart += ( ( uint64_t ) pxFrame->xDataLength * 8000ULL ) / ulRateKbps;
+            pxLink->ullBusyUntilUs = ullDepart;
+
+            pxLink->pxFrames[ pxLink->uxHead ] = pxFrame;
+            pxLink->ullDepartUs[ pxLink->uxHead ] = ullDepart;
+            pxLink->ullArriveUs[ pxLink->uxHead ] = ullDepart + ( ( uint64_t ) ulRTTms * 500ULL );
+            pxLink->uxHead = ( pxLink->uxHead + 1 ) % benchRING_SIZE;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if( xDrop != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxFrame );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvLinkTask( void * pvParameters )
+{
+    IPStackEvent_t xEvent = { eNetworkRxEvent, NULL };
+    NetworkBufferDescriptor_t * pxFrame;
+    size_t uxLink;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        vTaskDelay( 1 );
+
+        for( uxLink = 0; uxLink < 2; uxLink++ )
+        {
+            for( ; ; )
+            {
+                pxFrame = NULL;
+
+                taskENTER_CRITICAL();
+                {
+                    Link_t * pxLink = &( xLinks[ uxLink ] );
+
+                    if( ( pxLink->uxTail != pxLink->uxHead ) && ( pxLink->ullArriveUs[ pxLink->uxTail ] <= prvNowUs() ) )
+                    {
+                        pxFrame = pxLink->pxFrames[ pxLink->uxTail ];
+                        pxLink->uxTail = ( pxLink->uxTail + 1 ) % benchRING_SIZE;
+                    }
+                }
+                taskEXIT_CRITICAL();
+
+                if( pxFrame == NULL )
+                {
+                    break;
+                }
+
+                xEvent.pvData = ( void * ) pxFrame;
+
+                if( xSendEventStructToIPTask( &xEvent, 0 ) == pdFAIL )
+                {
+                    xLinks[ uxLink ].ulDropped++;
+                    vReleaseNetworkBufferAndDescriptor( pxFrame );
+                }
+            }
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetWindow( Socket_t xSocket,
+                          BaseType_t xSender )
+{
+    WinProperties_t xProperties;
+    BaseType_t xResult;
+
+    /* The sender's window is much larger than the path can hold.  Without
+     * congestion control, it fills the queue of the link. */
+    xProperties.lTxBufSize = xSender ? benchBUFFER_SIZE : 4 * ipconfigTCP_MSS;
+    xProperties.lTxWinSize = xSender ? benchWINDOW_SEGMENTS : 2;
+    xProperties.lRxBufSize = xSender ? 4 * ipconfigTCP_MSS : benchBUFFER_SIZE;
+    xProperties.lRxWinSize = xSender ? 2 : benchWINDOW_SEGMENTS;
+
+    /* This fails when the socket already has its streams. */
+    xResult = FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_WIN_PROPERTIES, &xProperties, sizeof( xProperties ) );
+    configASSERT( xResult == 0 );
+    ( void ) xResult;
+}
+/*-----------------------------------------------------------*/
+
+static void prvServerTask( void * pvParameters )
+{
+    static uint8_t ucBuffer[ benchCHUNK_SIZE ];
+    Socket_t xListener, xSocket;
+    struct freertos_sockaddr xAddress;
+    TickType_t xTimeout = pdMS_TO_TICKS( benchTIMEOUT_MS );
+    BaseType_t xResult, x;
+    uint32_t ulTotal = ulKBytes * 1024UL;
+
+    ( void ) pvParameters;
+
+    xListener = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( xListener != FREERTOS_INVALID_SOCKET );
+    prvSetWindow( xListener, pdFALSE );
+    ( void ) FreeRTOS_setsockopt( xListener, 0, FREERTOS_SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+
+    xAddress.sin_port = FreeRTOS_htons( benchSERVER_PORT );
+    ( void ) FreeRTOS_bind( xListener, &xAddress, sizeof( xAddress ) );
+    ( void ) FreeRTOS_listen( xListener, 2 );
+
+    for( ; ; )
+    {
+        xSocket = FreeRTOS_accept( xListener, NULL, NULL );
+
+        if( ( xSocket == NULL ) || ( xSocket == FREERTOS_INVALID_SOCKET ) )
+        {
+            continue;
+        }
+
+        ( void ) FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+        ulServerReceived = 0;
+        ulServerErrors = 0;
+
+        while( ulServerReceived < ulTotal )
+        {
+            xResult = FreeRTOS_recv( xSocket, ucBuffer, sizeof( ucBuffer ), 0 );
+
+            if( xResult <= 0 )
+            {
+                /* A time-out, or the client gave up. */
+                break;
+            }
+
+            for( x = 0; x < xResult; x++ )
+            {
+                if( ucBuffer[ x ] != ucPattern[ ( ulServerReceived + ( uint32_t ) x ) % benchPATTERN_PERIOD ] )
+                {
+                    ulServerErrors++;
+                }
+            }
+
+            ulServerReceived += ( uint32_t ) xResult;
+        }
+
+        if( ulServerReceived >= ulTotal )
+        {
+            xServerDoneTime = xTaskGetTickCount();
+            xTaskNotifyGive( xBenchmarkTask );
+        }
+
+        /* Do not wait for the connection to close, the next client may
+         * already be waiting. */
+        ( void ) FreeRTOS_closesocket( xSocket );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendVector( Socket_t xSocket,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength )
+{
+    struct freertos_iovec xVector[ 4 ];
+    size_t uxFirst = ( ulLength < 1UL ) ? ulLength : 1UL;
+    size_t uxSecond = ( ( ulLength - uxFirst ) < 700UL ) ? ( ulLength - uxFirst ) : 700UL;
+
+    /* Elements of 1 byte, of 0 bytes, of 700 bytes, and the rest.  They end
+     * at odd positions in txStream, so some of them wrap around its end. */
+    xVector[ 0 ].iov_base = pucData;
+    xVector[ 0 ].iov_len = uxFirst;
+    xVector[ 1 ].iov_base = NULL;
+    xVector[ 1 ].iov_len = 0;
+    xVector[ 2 ].iov_base = pucData + uxFirst;
+    xVector[ 2 ].iov_len = uxSecond;
+    xVector[ 3 ].iov_base = pucData + uxFirst + uxSecond;
+    xVector[ 3 ].iov_len = ulLength - uxFirst - uxSecond;
+
+    return FreeRTOS_sendv( xSocket, xVector, 4, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendZeroCopy( Socket_t xSocket,
+                                   const uint8_t * pucData,
+                                   uint32_t ulLength )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    BaseType_t xSpace = 0;
+    uint8_t * pucHead;
+
+    /* A zero-copy send does not block, so wait for the IP-task to make space
+     * in txStream.  The space ends at the end of txStream, where the data
+     * wraps around.  The rest of the chunk is sent in the next call. */
+    for( ; ; )
+    {
+        pucHead = FreeRTOS_get_tx_head( xSocket, &xSpace );
+
+        if( ( pucHead == NULL ) || ( xSpace > 0 ) ||
+            ( ( xTaskGetTickCount() - xStart ) > pdMS_TO_TICKS( benchTIMEOUT_MS ) ) )
+        {
+            break;
+        }
+
+        vTaskDelay( 1 );
+    }
+
+    if( xSpace <= 0 )
+    {
+        return 0;
+    }
+
+    if( ( uint32_t ) xSpace > ulLength )
+    {
+        xSpace = ( BaseType_t ) ulLength;
+    }
+
+    memcpy( pucHead, pucData, ( size_t ) xSpace );
+
+    return FreeRTOS_send( xSocket, NULL, ( size_t ) xSpace, FREERTOS_ZERO_COPY );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunTransfer( double dLossRate )
+{
+    static uint8_t ucBuffer[ benchCHUNK_SIZE ];
+    Socket_t xSocket;
+    struct freertos_sockaddr xAddress;
+    TickType_t xTimeout = pdMS_TO_TICKS( benchTIMEOUT_MS ), xStart;
+    uint32_t ulTotal = ulKBytes * 1024UL, ulSent = 0, ulLength, ulMs;
+    BaseType_t xResult, xCompleted = pdFALSE;
+    const uint8_t * pucData;
+
+    taskENTER_CRITICAL();
+    {
+        memset( xLinks, 0, sizeof( xLinks ) );
+        ulLossThreshold = ( uint32_t ) ( ( dLossRate / 100.0 ) * 4294967295.0 );
+    }
+    taskEXIT_CRITICAL();
+
+    xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( xSocket != FREERTOS_INVALID_SOCKET );
+
+    /* The socket is not connected, so it gets no txStream yet, and
+     * prvSetWindow() can still set its size. */
+    pucData = FreeRTOS_get_tx_head( xSocket, &xResult );
+    configASSERT( pucData == NULL );
+    prvSetWindow( xSocket, pdTRUE );
+    ( void ) FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_SNDTIMEO, &xTimeout, sizeof( xTimeout ) );
+    ( void ) FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_RCVTIMEO, &xTimeout, sizeof( xTimeout ) );
+
+    xAddress.sin_addr = benchPEER_IP_ADDRESS;
+    xAddress.sin_port = FreeRTOS_htons( benchSERVER_PORT );
+
+    ( void ) ulTaskNotifyTake( pdTRUE, 0 );
+    xStart = xTaskGetTickCount();
+
+    if( FreeRTOS_connect( xSocket, &xAddress, sizeof( xAddress ) ) == 0 )
+    {
+        while( ulSent < ulTotal )
+        {
+            ulLength = ulTotal - ulSent;
+
+            if( ulLength > benchCHUNK_SIZE )
+            {
+                ulLength = benchCHUNK_SIZE;
+            }
+
+            pucData = &( ucPattern[ ulSent % benchPATTERN_PERIOD ] );
+
+            switch( eSendMode )
+            {
+                case eSendVector:
+                    xResult = prvSendVector( xSocket, pucData, ulLength );
+                    break;
+
+                case eSendZeroCopy:
+                    xResult = prvSendZeroCopy( xSocket, pucData, ulLength );
+                    break;
+
+                default:
+                    xResult = FreeRTOS_send( xSocket, pucData, ulLength, 0 );
+                    break;
+            }
+
+            if( xResult <= 0 )
+            {
+                break;
+            }
+
+            ulSent += ( uint32_t ) xResult;
+        }
+
+        if( ( ulSent == ulTotal ) && ( ulTaskNotifyTake( pdTRUE, xTimeout ) != 0 ) )
+        {
+            xCompleted = pdTRUE;
+        }
+
+        /* Close gracefully, so that the server sees the end of the data. */
+        ( void ) FreeRTOS_shutdown( xSocket, FREERTOS_SHUT_RDWR );
+
+        while( FreeRTOS_recv( xSocket, ucBuffer, sizeof( ucBuffer ), 0 ) >= 0 )
+        {
+            vTaskDelay( pdMS_TO_TICKS( 10 ) );
+        }
+    }
+
+    ( void ) FreeRTOS_closesocket( xSocket );
+
+    if( xCompleted != pdFALSE )
+    {
+        ulMs = ( uint32_t ) ( ( xServerDoneTime - xStart ) * portTICK_PERIOD_MS );
+        printf( "%6.1f %12.1f %11.1f %6u %6u %9.2f %6u\n",
+                dLossRate,
+                ( ( double ) ulTotal * 8.0 ) / ( double ) ulMs,
+                ( ( double ) xLinks[ 0 ].ulPayloadBytes * 100.0 ) / ( double ) ulTotal - 100.0,
+                ( unsigned ) ( xLinks[ 0 ].ulLost + xLinks[ 1 ].ulLost ),
+                ( unsigned ) ( xLinks[ 0 ].ulDropped + xLinks[ 1 ].ulDropped ),
+                ( double ) ulMs / 1000.0,
+                ( unsigned ) ulServerErrors );
+    }
+    else
+    {
+        printf( "%6.1f %12s %11s %6u %6u %9s %6s\n",
+                dLossRate, "-", "-",
+                ( unsigned ) ( xLinks[ 0 ].ulLost + xLinks[ 1 ].ulLost ),
+                ( unsigned ) ( xLinks[ 0 ].ulDropped + xLinks[ 1 ].ulDropped ),
+                "timeout", "-" );
+    }
+
+    fflush( stdout );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchmarkTask( void * pvParameters )
+{
+    size_t x;
+
+    ( void ) pvParameters;
+
+    printf( "ipconfigTCP_CONGESTION_CONTROL %u, %lu KB, RTT %lu ms, %lu kbit/s, queue %lu frames, %s\n",
+            ( unsigned ) ipconfigTCP_CONGESTION_CONTROL, ( unsigned long ) ulKBytes,
+            ( unsigned long ) ulRTTms, ( unsigned long ) ulRateKbps, ( unsigned long ) ulQueueLimit,
+            pcSendModes[ eSendMode ] );
+    printf( "%6s %12s %11s %6s %6s %9s %6s\n", "loss", "goodput_kbps", "retransmit%", "lost", "drops", "seconds", "errors" );
+
+    for( x = 0; x < uxLossRateCount; x++ )
+    {
+        prvRunTransfer( dLossRates[ x ] );
+    }
+
+    vTaskEndScheduler();
+}
+/*-----------------------------------------------------------*/
+
+static void prvParseLossRates( char * pcList )
+{
+    char * pcToken;
+
+    uxLossRateCount = 0;
+
+    for( pcToken = strtok( pcList, "," ); ( pcToken != NULL ) && ( uxLossRateCount < benchMAX_LOSS_RATES ); pcToken = strtok( NULL, "," ) )
+    {
+        dLossRates[ uxLossRateCount++ ] = strtod( pcToken, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int iOption;
+    size_t x;
+
+    while( ( iOption = getopt( argc, argv, "b:d:r:q:l:m:" ) ) != -1 )
+    {
+        switch( iOption )
+        {
+            case 'b':
+                ulKBytes = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'd':
+                ulRTTms = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'r':
+                ulRateKbps = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'q':
+                ulQueueLimit = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'l':
+                prvParseLossRates( optarg );
+                break;
+
+            case 'm':
+
+                for( x = 0; x < sizeof( pcSendModes ) / sizeof( pcSendModes[ 0 ] ); x++ )
+                {
+                    if( strcmp( optarg, pcSendModes[ x ] ) == 0 )
+                    {
+                        break;
+                    }
+                }
+
+                if( x < sizeof( pcSendModes ) / sizeof( pcSendModes[ 0 ] ) )
+                {
+                    eSendMode = ( SendMode_t ) x;
+                }
+                else
+                {
+                    ulKBytes = 0;
+                }
+
+                break;
+
+            default:
+                ulKBytes = 0;
+                break;
+        }
+    }
+
+    if( ( ulKBytes == 0 ) || ( ulRateKbps == 0 ) || ( ulQueueLimit == 0 ) || ( uxLossRateCount == 0 ) )
+    {
+        fprintf( stderr, "usage: %s [-b kbytes] [-d rtt_ms] [-r rate_kbps] [-q queue_frames] [-l loss%%,...] [-m copy|sendv|zerocopy]\n", argv[ 0 ] );
+        return 2;
+    }
+
+    for( x = 0; x < sizeof( ucPattern ); x++ )
+    {
+        ucPattern[ x ] = ( uint8_t ) ( x % benchPATTERN_PERIOD );
+    }
+
+    FreeRTOS_IPInit( ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+    vTaskStartScheduler();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+    static BaseType_t xTaskCreated = pdFALSE;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTaskCreated == pdFALSE ) )
+    {
+        xTaskCreated = pdTRUE;
+
+        /* The peer is reached through the link, without ARP. */
+        vARPRefreshCacheEntry( &xPeerMACAddress, benchPEER_IP_ADDRESS );
+
+        xTaskCreate( prvLinkTask, "Link", benchTASK_STACK_SIZE, NULL, benchLINK_TASK_PRIORITY, NULL );
+        xTaskCreate( prvServerTask, "Server", benchTASK_STACK_SIZE, NULL, benchTASK_PRIORITY, NULL );
+        xTaskCreate( prvBenchmarkTask, "Benchmark", benchTASK_STACK_SIZE, NULL, benchTASK_PRIORITY, &xBenchmarkTask );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                             uint16_t usSourcePort,
+                                             uint32_t ulDestinationAddress,
+                                             uint16_t usDestinationPort )
+{
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    return ( uint32_t ) rand();
+}
+/*-----------------------------------------------------------*/
+
+/* The network interface: every packet goes onto the simulated link. */
+
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t xReleaseAfterSend )
+{
+    NetworkBufferDescriptor_t * pxFrame = pxNetworkBuffer;
+
+    if( xReleaseAfterSend == pdFALSE )
+    {
+        /* The stack keeps this buffer, the link needs a copy. */
+        pxFrame = pxDuplicateNetworkBufferWithDescriptor( pxNetworkBuffer, pxNetworkBuffer->xDataLength );
+    }
+
+    if( pxFrame != NULL )
+    {
+        prvLinkSend( pxFrame );
+    }
+
+    return pdTRUE;
+}
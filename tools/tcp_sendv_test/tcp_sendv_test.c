@@ -0,0 +1,390 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/*
+ * Checks of the edge cases of FreeRTOS_sendv(), of zero-copy sends, and of
+ * FreeRTOS_get_tx_head().
+ *
+ * The test includes FreeRTOS_Sockets.c, so that it can look at txStream.  A
+ * task with a priority above the IP-task makes connections the way the IP-task
+ * adds accepted connections, so the IP-task never runs while the data is in
+ * txStream.  It checks that:
+ * - FreeRTOS_get_tx_head() does not create txStream for a socket that can not
+ *   send yet, nor for a listening socket, and that the size of the stream can
+ *   then still be set;
+ * - a vector without bytes, or with elements of zero bytes, adds nothing;
+ * - when txStream is nearly full, FreeRTOS_sendv() adds the first bytes of the
+ *   vector that fit, in order, also where the free space wraps around the end
+ *   of the stream, and a zero-copy send adds no more than the free space.
+ */
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The module under test, with its private data. */
+#include "FreeRTOS_Sockets.c"
+
+/* FreeRTOS+TCP includes. */
+#include "NetworkInterface.h"
+
+#define testLOCAL_PORT            ( 5000 )
+#define testFIRST_REMOTE_PORT     ( 40000 )
+#define testREMOTE_IP             ( 0xC0A8010AUL )
+#define testFREE_SPACE            ( 10u )
+#define testPATTERN_SIZE          ( 2048u )
+#define testTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define testTASK_PRIORITY         ( configMAX_PRIORITIES - 1 )
+
+static const uint8_t ucIPAddress[ 4 ] = { 192, 168, 1, 2 };
+static const uint8_t ucNetMask[ 4 ] = { 255, 255, 255, 0 };
+static const uint8_t ucGatewayAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucMACAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static uint8_t ucPattern[ testPATTERN_SIZE ];
+static uint16_t usNextRemotePort = testFIRST_REMOTE_PORT;
+
+/*-----------------------------------------------------------*/
+
+static FreeRTOS_Socket_t * prvNewSocket( void )
+{
+    FreeRTOS_Socket_t * pxSocket;
+    uint32_t ulSize = 1u;
+
+    pxSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( pxSocket != FREERTOS_INVALID_SOCKET );
+
+    /* One MSS: the smallest transmit stream. */
+    configASSERT( FreeRTOS_setsockopt( pxSocket, 0, FREERTOS_SO_SNDBUF, &ulSize, sizeof( ulSize ) ) == 0 );
+
+    return pxSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvBind( FreeRTOS_Socket_t * pxSocket,
+                     BaseType_t xConnect )
+{
+    struct freertos_sockaddr xAddress;
+
+    xAddress.sin_addr = FreeRTOS_GetIPAddress();
+    xAddress.sin_port = FreeRTOS_htons( testLOCAL_PORT );
+
+    /* The IP-task binds and connects child sockets, so it may not run in
+     * between. */
+    vTaskSuspendAll();
+    {
+        configASSERT( vSocketBind( pxSocket, &xAddress, sizeof( xAddress ), pdTRUE ) == 0 );
+
+        if( xConnect != pdFALSE )
+        {
+            pxSocket->u.xTCP.ulRemoteIP = testREMOTE_IP;
+            pxSocket->u.xTCP.usRemotePort = usNextRemotePort++;
+            vTCPStateChange( pxSocket, eESTABLISHED );
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static FreeRTOS_Socket_t * prvConnectedSocket( void )
+{
+    FreeRTOS_Socket_t * pxSocket = prvNewSocket();
+
+    prvBind( pxSocket, pdTRUE );
+
+    return pxSocket;
+}
+/*-----------------------------------------------------------*/
+
+/* Check that the last 'uxCount' bytes in txStream are 'pucExpected'. */
+static void prvCheckStreamEnd( FreeRTOS_Socket_t * pxSocket,
+                               const uint8_t * pucExpected,
+                               size_t uxCount )
+{
+    StreamBuffer_t * pxStream = pxSocket->u.xTCP.txStream;
+    uint8_t ucData[ testPATTERN_SIZE ];
+    size_t uxSize = uxStreamBufferGetSize( pxStream );
+
+    configASSERT( uxSize >= uxCount );
+    configASSERT( uxStreamBufferGet( pxStream, uxSize - uxCount, ucData, uxCount, pdTRUE ) == uxCount );
+    configASSERT( memcmp( ucData, pucExpected, uxCount ) == 0 );
+}
+/*-----------------------------------------------------------*/
+
+/* Fill txStream until 'uxFree' bytes are free. */
+static void prvFillStream( FreeRTOS_Socket_t * pxSocket,
+                           size_t uxFree )
+{
+    size_t uxSpace = uxStreamBufferGetSpace( pxSocket->u.xTCP.txStream );
+
+    configASSERT( uxSpace >= uxFree );
+    configASSERT( FreeRTOS_send( pxSocket, ucPattern, uxSpace - uxFree, FREERTOS_MSG_DONTWAIT ) == ( BaseType_t ) ( uxSpace - uxFree ) );
+    configASSERT( uxStreamBufferGetSpace( pxSocket->u.xTCP.txStream ) == uxFree );
+}
+/*-----------------------------------------------------------*/
+
+/* A non-blocking connection whose txStream has testFREE_SPACE bytes free: 6 at
+ * the end of the stream and 4 at its start.  The first bytes are taken from
+ * the stream as if the peer acknowledged them. */
+static FreeRTOS_Socket_t * prvWrappedSocket( void )
+{
+    FreeRTOS_Socket_t * pxSocket = prvConnectedSocket();
+    TickType_t xNoWait = 0;
+    StreamBuffer_t * pxStream;
+    BaseType_t xLength;
+
+    configASSERT( FreeRTOS_setsockopt( pxSocket, 0, FREERTOS_SO_SNDTIMEO, &xNoWait, sizeof( xNoWait ) ) == 0 );
+    ( void ) FreeRTOS_get_tx_head( pxSocket, &xLength );
+    pxStream = pxSocket->u.xTCP.txStream;
+    prvFillStream( pxSocket, 5u );
+    configASSERT( pxStream->uxHead == pxStream->LENGTH - 6u );
+    configASSERT( uxStreamBufferGet( pxStream, 0u, NULL, 5u, pdFALSE ) == 5u );
+    configASSERT( uxStreamBufferGetSpace( pxStream ) == testFREE_SPACE );
+
+    return pxSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckTxHeadWithoutStream( void )
+{
+    FreeRTOS_Socket_t * pxSocket;
+    BaseType_t xLength;
+    uint8_t * pucHead;
+    uint32_t ulSize = 2u * ipconfigTCP_MSS;
+
+    /* Not bound. */
+    pxSocket = prvNewSocket();
+    xLength = -1;
+    configASSERT( FreeRTOS_get_tx_head( pxSocket, &xLength ) == NULL );
+    configASSERT( xLength == 0 );
+    configASSERT( pxSocket->u.xTCP.txStream == NULL );
+
+    /* Bound, but not connected. */
+    prvBind( pxSocket, pdFALSE );
+    configASSERT( FreeRTOS_get_tx_head( pxSocket, &xLength ) == NULL );
+    configASSERT( xLength == 0 );
+    configASSERT( pxSocket->u.xTCP.txStream == NULL );
+    configASSERT( FreeRTOS_setsockopt( pxSocket, 0, FREERTOS_SO_SNDBUF, &ulSize, sizeof( ulSize ) ) == 0 );
+
+    /* Listening. */
+    configASSERT( FreeRTOS_listen( pxSocket, 1 ) == 0 );
+    configASSERT( FreeRTOS_get_tx_head( pxSocket, &xLength ) == NULL );
+    configASSERT( xLength == 0 );
+    configASSERT( pxSocket->u.xTCP.txStream == NULL );
+    ( void ) vSocketClose( pxSocket );
+
+    /* Connected: the stream is created with the size that was set, and all
+     * of it can be written from its start. */
+    pxSocket = prvNewSocket();
+    prvBind( pxSocket, pdTRUE );
+    configASSERT( pxSocket->u.xTCP.txStream == NULL );
+    pucHead = FreeRTOS_get_tx_head( pxSocket, &xLength );
+    configASSERT( pucHead != NULL );
+    configASSERT( pucHead == pxSocket->u.xTCP.txStream->ucArray );
+    configASSERT( ( size_t ) xLength == pxSocket->u.xTCP.txStream->LENGTH - 1u );
+    configASSERT( ( size_t ) xLength >= ipconfigTCP_MSS );
+    configASSERT( FreeRTOS_setsockopt( pxSocket, 0, FREERTOS_SO_SNDBUF, &ulSize, sizeof( ulSize ) ) == -pdFREERTOS_ERRNO_EINVAL );
+    ( void ) vSocketClose( pxSocket );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckZeroLength( void )
+{
+    FreeRTOS_Socket_t * pxSocket = prvConnectedSocket();
+    struct freertos_iovec xEmpty[ 2 ] = { { NULL, 0u }, { ucPattern, 0u } };
+    struct freertos_iovec xVector[ 3 ] =
+    {
+        { ucPattern,       3u },
+        { ucPattern + 100, 0u },
+        { ucPattern + 3,   5u }
+    };
+    size_t uxHead;
+
+    /* Nothing to send does not create txStream. */
+    configASSERT( FreeRTOS_sendv( pxSocket, NULL, 0u, 0 ) == 0 );
+    configASSERT( FreeRTOS_sendv( pxSocket, xEmpty, 0u, 0 ) == 0 );
+    configASSERT( FreeRTOS_sendv( pxSocket, xEmpty, 2u, 0 ) == 0 );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 0u, 0 ) == 0 );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 0u, FREERTOS_ZERO_COPY ) == 0 );
+    configASSERT( pxSocket->u.xTCP.txStream == NULL );
+
+    /* An element of zero bytes between two others is skipped. */
+    configASSERT( FreeRTOS_sendv( pxSocket, xVector, 3u, FREERTOS_MSG_DONTWAIT ) == 8 );
+    configASSERT( uxStreamBufferGetSize( pxSocket->u.xTCP.txStream ) == 8u );
+    prvCheckStreamEnd( pxSocket, ucPattern, 8u );
+
+    uxHead = pxSocket->u.xTCP.txStream->uxHead;
+    configASSERT( FreeRTOS_sendv( pxSocket, xEmpty, 2u, 0 ) == 0 );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 0u, FREERTOS_ZERO_COPY ) == 0 );
+    configASSERT( pxSocket->u.xTCP.txStream->uxHead == uxHead );
+
+    /* A zero-length element after the last byte that fits. */
+    prvFillStream( pxSocket, 4u );
+    xVector[ 0 ].iov_len = 4u;
+    xVector[ 2 ].iov_len = 0u;
+    configASSERT( FreeRTOS_sendv( pxSocket, xVector, 3u, FREERTOS_MSG_DONTWAIT ) == 4 );
+    configASSERT( uxStreamBufferGetSpace( pxSocket->u.xTCP.txStream ) == 0u );
+    prvCheckStreamEnd( pxSocket, ucPattern, 4u );
+
+    ( void ) vSocketClose( pxSocket );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckNearlyFull( void )
+{
+    FreeRTOS_Socket_t * pxSocket = prvConnectedSocket();
+    StreamBuffer_t * pxStream;
+    BaseType_t xLength;
+    uint8_t * pucHead;
+    uint8_t ucExpected[ 16 ];
+    struct freertos_iovec xVector[ 4 ] =
+    {
+        { ucPattern + 200, 4u },
+        { ucPattern + 300, 0u },
+        { ucPattern + 400, 4u },
+        { ucPattern + 500, 8u }
+    };
+
+    /* A blocking socket: FREERTOS_MSG_DONTWAIT returns what fits. */
+    ( void ) FreeRTOS_get_tx_head( pxSocket, &xLength );
+    prvFillStream( pxSocket, testFREE_SPACE );
+    configASSERT( FreeRTOS_sendv( pxSocket, xVector, 4u, FREERTOS_MSG_DONTWAIT ) == ( BaseType_t ) testFREE_SPACE );
+    memcpy( ucExpected, ucPattern + 200, 4u );
+    memcpy( ucExpected + 4, ucPattern + 400, 4u );
+    memcpy( ucExpected + 8, ucPattern + 500, 2u );
+    prvCheckStreamEnd( pxSocket, ucExpected, testFREE_SPACE );
+    configASSERT( FreeRTOS_sendv( pxSocket, xVector, 4u, FREERTOS_MSG_DONTWAIT ) == -pdFREERTOS_ERRNO_ENOSPC );
+    ( void ) vSocketClose( pxSocket );
+
+    /* A non-blocking socket, with the free space on both sides of the end of
+     * txStream. */
+    pxSocket = prvWrappedSocket();
+    pxStream = pxSocket->u.xTCP.txStream;
+    xVector[ 0 ].iov_len = 3u;
+    xVector[ 2 ].iov_len = 0u;
+    xVector[ 3 ].iov_len = 9u;
+    configASSERT( FreeRTOS_sendv( pxSocket, xVector, 4u, 0 ) == ( BaseType_t ) testFREE_SPACE );
+    configASSERT( pxStream->uxHead == 4u );
+    memcpy( ucExpected, ucPattern + 200, 3u );
+    memcpy( ucExpected + 3, ucPattern + 500, 7u );
+    prvCheckStreamEnd( pxSocket, ucExpected, testFREE_SPACE );
+    ( void ) vSocketClose( pxSocket );
+
+    /* Zero-copy, with the same free space: the head offers the 6 bytes up to
+     * the end, then the 4 at the start.  A send of more than the free space
+     * adds only the free space. */
+    pxSocket = prvWrappedSocket();
+    pxStream = pxSocket->u.xTCP.txStream;
+    pucHead = FreeRTOS_get_tx_head( pxSocket, &xLength );
+    configASSERT( ( pucHead != NULL ) && ( xLength == 6 ) );
+    memcpy( pucHead, ucPattern + 600, 6u );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 6u, FREERTOS_ZERO_COPY ) == 6 );
+    pucHead = FreeRTOS_get_tx_head( pxSocket, &xLength );
+    configASSERT( ( pucHead == pxStream->ucArray ) && ( xLength == 4 ) );
+    memcpy( pucHead, ucPattern + 606, 4u );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 16u, FREERTOS_ZERO_COPY ) == 4 );
+    configASSERT( uxStreamBufferGetSpace( pxStream ) == 0u );
+    prvCheckStreamEnd( pxSocket, ucPattern + 600, testFREE_SPACE );
+    configASSERT( FreeRTOS_send( pxSocket, NULL, 1u, FREERTOS_ZERO_COPY ) == -pdFREERTOS_ERRNO_ENOSPC );
+
+    ( void ) vSocketClose( pxSocket );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTask( void * pvParameters )
+{
+    size_t uxIndex;
+
+    ( void ) pvParameters;
+
+    /* 251 does not divide the size of txStream. */
+    for( uxIndex = 0u; uxIndex < testPATTERN_SIZE; uxIndex++ )
+    {
+        ucPattern[ uxIndex ] = ( uint8_t ) ( uxIndex % 251u );
+    }
+
+    prvCheckTxHeadWithoutStream();
+    prvCheckZeroLength();
+    prvCheckNearlyFull();
+
+    printf( "FreeRTOS_sendv checks passed\n" );
+
+    vTaskEndScheduler();
+}
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    FreeRTOS_IPInit( ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+    vTaskStartScheduler();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+    static BaseType_t xTaskCreated = pdFALSE;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTaskCreated == pdFALSE ) )
+    {
+        xTaskCreated = pdTRUE;
+        xTaskCreate( prvTestTask, "SendvTest", testTASK_STACK_SIZE, NULL, testTASK_PRIORITY, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                             uint16_t usSourcePort,
+                                             uint32_t ulDestinationAddress,
+                                             uint16_t usDestinationPort )
+{
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    return ( uint32_t ) rand();
+}
+/*-----------------------------------------------------------*/
+
+/* The network interface: the test sends and receives no packets. */
+
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t xReleaseAfterSend )
+{
+    if( xReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return pdTRUE;
+}
@@ -0,0 +1,334 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Measures how long FreeRTOS+TCP takes to find the socket of a received
+ * packet, as the number of sockets grows.
+ *
+ * The kernel runs on the POSIX port and the stack runs without a network.
+ * A server socket listens on one port and connections to that port are added
+ * the way prvHandleListen() adds them: each one is a socket bound to the same
+ * local port, with a remote address, in the established state. The same
+ * number of UDP sockets is bound to consecutive ports. The lookups are the
+ * calls that the IP-task makes for every received packet.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+#include "NetworkInterface.h"
+#include "NetworkBufferManagement.h"
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define benchDEFAULT_ITERATIONS    ( 1000000UL )
+#define benchMAX_SOCKETS           ( 256 )
+#define benchSERVER_PORT           ( 502 )
+#define benchFIRST_UDP_PORT        ( 10000 )
+#define benchFIRST_REMOTE_PORT     ( 49152 )
+#define benchREMOTE_HOSTS          ( 4 )
+#define benchSEQUENCE_LENGTH       ( 4096 )
+#define benchTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define benchTASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+
+static const uint8_t ucIPAddress[ 4 ] = { 192, 168, 1, 2 };
+static const uint8_t ucNetMask[ 4 ] = { 255, 255, 255, 0 };
+static const uint8_t ucGatewayAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucMACAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static const UBaseType_t uxSocketCounts[] = { 8, 64, benchMAX_SOCKETS };
+
+static uint32_t ulIterations = benchDEFAULT_ITERATIONS;
+
+static FreeRTOS_Socket_t * pxServerSocket;
+static FreeRTOS_Socket_t * pxConnections[ benchMAX_SOCKETS ];
+static FreeRTOS_Socket_t * pxUDPSockets[ benchMAX_SOCKETS ];
+static UBaseType_t uxSocketCount = 0;
+
+/* The order in which the sockets are looked up. */
+static uint16_t usSequence[ benchSEQUENCE_LENGTH ];
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRemoteIP( UBaseType_t uxIndex )
+{
+    /* Host byte order, as pxTCPSocketLookup() expects it. */
+    return 0xC0A8010AUL + ( uint32_t ) ( uxIndex % benchREMOTE_HOSTS );
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvRemotePort( UBaseType_t uxIndex )
+{
+    return ( uint16_t ) ( benchFIRST_REMOTE_PORT + uxIndex );
+}
+/*-----------------------------------------------------------*/
+
+static double prvElapsedNs( const struct timespec * pxStart )
+{
+    struct timespec xEnd;
+
+    clock_gettime( CLOCK_MONOTONIC, &xEnd );
+
+    return ( ( double ) ( xEnd.tv_sec - pxStart->tv_sec ) * 1e9 ) +
+           ( double ) ( xEnd.tv_nsec - pxStart->tv_nsec );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddConnection( void )
+{
+    FreeRTOS_Socket_t * pxSocket;
+    struct freertos_sockaddr xAddress;
+    BaseType_t xResult;
+
+    pxSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( pxSocket != FREERTOS_INVALID_SOCKET );
+
+    xAddress.sin_addr = FreeRTOS_GetIPAddress();
+    xAddress.sin_port = FreeRTOS_htons( benchSERVER_PORT );
+
+    /* The IP-task binds and connects child sockets, so it may not run in
+     * between. */
+    vTaskSuspendAll();
+    {
+        xResult = vSocketBind( pxSocket, &xAddress, sizeof( xAddress ), pdTRUE );
+        configASSERT( xResult == 0 );
+
+        pxSocket->u.xTCP.ulRemoteIP = prvRemoteIP( uxSocketCount );
+        pxSocket->u.xTCP.usRemotePort = prvRemotePort( uxSocketCount );
+        vTCPStateChange( pxSocket, eESTABLISHED );
+    }
+    ( void ) xTaskResumeAll();
+
+    pxConnections[ uxSocketCount ] = pxSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddUDPSocket( void )
+{
+    Socket_t xSocket;
+    struct freertos_sockaddr xAddress;
+    BaseType_t xResult;
+
+    xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP );
+    configASSERT( xSocket != FREERTOS_INVALID_SOCKET );
+
+    xAddress.sin_addr = FreeRTOS_GetIPAddress();
+    xAddress.sin_port = FreeRTOS_htons( ( uint16_t ) ( benchFIRST_UDP_PORT + uxSocketCount ) );
+    xResult = FreeRTOS_bind( xSocket, &xAddress, sizeof( xAddress ) );
+    configASSERT( xResult == 0 );
+
+    pxUDPSockets[ uxSocketCount ] = ( FreeRTOS_Socket_t * ) xSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvShuffle( void )
+{
+    uint32_t ulState = 0x2545F491UL;
+    size_t x;
+
+    /* A fixed pseudo-random order, so that successive lookups do not find
+     * neighbouring sockets. */
+    for( x = 0; x < benchSEQUENCE_LENGTH; x++ )
+    {
+        ulState ^= ulState << 13;
+        ulState ^= ulState >> 17;
+        ulState ^= ulState << 5;
+        usSequence[ x ] = ( uint16_t ) ( ulState % uxSocketCount );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunSeries( void )
+{
+    struct timespec xStart;
+    uint32_t ulLookup, ulMisses = 0;
+    UBaseType_t uxIndex;
+    double dEstablishedNs, dNewNs, dUDPNs;
+
+    prvShuffle();
+
+    /* A segment of an established connection. */
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( ulLookup = 0; ulLookup < ulIterations; ulLookup++ )
+    {
+        uxIndex = usSequence[ ulLookup % benchSEQUENCE_LENGTH ];
+
+        if( pxTCPSocketLookup( 0, benchSERVER_PORT, prvRemoteIP( uxIndex ), prvRemotePort( uxIndex ) ) != pxConnections[ uxIndex ] )
+        {
+            ulMisses++;
+        }
+    }
+
+    dEstablishedNs = prvElapsedNs( &xStart ) / ( double ) ulIterations;
+
+    /* A SYN from a port without a connection, which finds the server socket. */
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( ulLookup = 0; ulLookup < ulIterations; ulLookup++ )
+    {
+        uxIndex = usSequence[ ulLookup % benchSEQUENCE_LENGTH ];
+
+        if( pxTCPSocketLookup( 0, benchSERVER_PORT, prvRemoteIP( uxIndex ), 1024u + ( uint16_t ) uxIndex ) != pxServerSocket )
+        {
+            ulMisses++;
+        }
+    }
+
+    dNewNs = prvElapsedNs( &xStart ) / ( double ) ulIterations;
+
+    /* A datagram to one of the UDP sockets. */
+    clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+    for( ulLookup = 0; ulLookup < ulIterations; ulLookup++ )
+    {
+        uxIndex = usSequence[ ulLookup % benchSEQUENCE_LENGTH ];
+
+        if( pxUDPSocketLookup( FreeRTOS_htons( ( uint16_t ) ( benchFIRST_UDP_PORT + uxIndex ) ) ) != pxUDPSockets[ uxIndex ] )
+        {
+            ulMisses++;
+        }
+    }
+
+    dUDPNs = prvElapsedNs( &xStart ) / ( double ) ulIterations;
+
+    printf( "%8u %14.1f %10.1f %10.1f %8u\n",
+            ( unsigned ) uxSocketCount, dEstablishedNs, dNewNs, dUDPNs, ( unsigned ) ulMisses );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchmarkTask( void * pvParameters )
+{
+    struct freertos_sockaddr xAddress;
+    BaseType_t xResult;
+    size_t x;
+
+    ( void ) pvParameters;
+
+    pxServerSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( pxServerSocket != FREERTOS_INVALID_SOCKET );
+
+    xAddress.sin_addr = FreeRTOS_GetIPAddress();
+    xAddress.sin_port = FreeRTOS_htons( benchSERVER_PORT );
+    xResult = FreeRTOS_bind( pxServerSocket, &xAddress, sizeof( xAddress ) );
+    configASSERT( xResult == 0 );
+    xResult = FreeRTOS_listen( pxServerSocket, benchMAX_SOCKETS );
+    configASSERT( xResult == 0 );
+
+    printf( "ipconfigSOCKET_HASH_BUCKETS %u, %lu lookups per series\n",
+            ( unsigned ) ipconfigSOCKET_HASH_BUCKETS, ( unsigned long ) ulIterations );
+    printf( "%8s %14s %10s %10s %8s\n", "sockets", "established_ns", "new_ns", "udp_ns", "misses" );
+
+    for( x = 0; x < sizeof( uxSocketCounts ) / sizeof( uxSocketCounts[ 0 ] ); x++ )
+    {
+        while( uxSocketCount < uxSocketCounts[ x ] )
+        {
+            prvAddConnection();
+            prvAddUDPSocket();
+            uxSocketCount++;
+        }
+
+        prvRunSeries();
+    }
+
+    vTaskEndScheduler();
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+
+        if( ulIterations == 0 )
+        {
+            fprintf( stderr, "usage: %s [iterations]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+
+    FreeRTOS_IPInit( ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+    vTaskStartScheduler();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+    static BaseType_t xTaskCreated = pdFALSE;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTaskCreated == pdFALSE ) )
+    {
+        xTaskCreated = pdTRUE;
+        xTaskCreate( prvBenchmarkTask, "Benchmark", benchTASK_STACK_SIZE, NULL, benchTASK_PRIORITY, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                             uint16_t usSourcePort,
+                                             uint32_t ulDestinationAddress,
+                                             uint16_t usDestinationPort )
+{
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    return ( uint32_t ) rand();
+}
+/*-----------------------------------------------------------*/
+
+/* The network interface: the benchmark sends and receives no packets. */
+
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t xReleaseAfterSend )
+{
+    if( xReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return pdTRUE;
+}
@@ -0,0 +1,63 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * FreeRTOS+TCP configuration of the TCP timer benchmark.  There is no network:
+ * the connections are made by the benchmark, and never send or receive.
+ */
+
+#ifndef FREERTOS_IP_CONFIG_H
+#define FREERTOS_IP_CONFIG_H
+
+#define ipconfigHAS_DEBUG_PRINTF                 0
+#define ipconfigHAS_PRINTF                       0
+
+#define ipconfigBYTE_ORDER                       pdFREERTOS_LITTLE_ENDIAN
+#define ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM   1
+#define ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM   1
+
+#define ipconfigIP_TASK_PRIORITY                 ( configMAX_PRIORITIES - 2 )
+#define ipconfigIP_TASK_STACK_SIZE_WORDS         ( configMINIMAL_STACK_SIZE * 5 )
+#define ipconfigUSE_NETWORK_EVENT_HOOK           1
+
+/* A static address, so the network is up as soon as the interface is. */
+#define ipconfigUSE_DHCP                         0
+#define ipconfigUSE_DNS                          0
+#define ipconfigUSE_LLMNR                        0
+#define ipconfigUSE_NBNS                         0
+
+#define ipconfigUSE_TCP                          1
+#define ipconfigUSE_TCP_WIN                      1
+#define ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS   16
+#define ipconfigEVENT_QUEUE_LENGTH               ( ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS + 5 )
+#define ipconfigNETWORK_MTU                      1500
+#define ipconfigALLOW_SOCKET_SEND_WITHOUT_BIND   1
+
+/* Build with -DipconfigUSE_TCP_TIMER_HEAP=0 to measure the list walk. */
+#ifndef ipconfigUSE_TCP_TIMER_HEAP
+    #define ipconfigUSE_TCP_TIMER_HEAP           1
+#endif
+
+#endif /* FREERTOS_IP_CONFIG_H */
@@ -0,0 +1,318 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/*
+ * Measures how much work the IP-task does for the TCP timers, as the number
+ * of idle connections grows.
+ *
+ * The kernel runs on the POSIX port and the stack runs without a network.
+ * The connections are sockets bound to one local port, with a remote address,
+ * in the established state.  Like an idle connection, each one waits for the
+ * maximum time-out of 20 seconds.  The benchmark measures a check in which no
+ * time-out expires, and an event in which one connection has a time-out of one
+ * tick, the way FreeRTOS_send() asks the IP-task to send new data.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+TCP includes. */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+#include "FreeRTOS_IP_Private.h"
+#include "NetworkInterface.h"
+#include "NetworkBufferManagement.h"
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#define benchDEFAULT_ITERATIONS    ( 100000UL )
+#define benchMAX_SOCKETS           ( 1024 )
+#define benchCHECKS_PER_ROUND      ( 1000UL )
+#define benchIDLE_TIMEOUT          ( ( uint16_t ) pdMS_TO_TICKS( 20000 ) )
+#define benchLOCAL_PORT            ( 502 )
+#define benchFIRST_REMOTE_PORT     ( 49152 )
+#define benchSEQUENCE_LENGTH       ( 4096 )
+#define benchTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define benchTASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+
+static const uint8_t ucIPAddress[ 4 ] = { 192, 168, 1, 2 };
+static const uint8_t ucNetMask[ 4 ] = { 255, 255, 255, 0 };
+static const uint8_t ucGatewayAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucMACAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static const UBaseType_t uxSocketCounts[] = { 16, 128, benchMAX_SOCKETS };
+
+static uint32_t ulIterations = benchDEFAULT_ITERATIONS;
+
+static FreeRTOS_Socket_t * pxConnections[ benchMAX_SOCKETS ];
+static UBaseType_t uxSocketCount = 0;
+
+/* The order in which the connections get new data to send. */
+static uint16_t usSequence[ benchSEQUENCE_LENGTH ];
+
+/*-----------------------------------------------------------*/
+
+static double prvElapsedNs( clockid_t xClock,
+                           const struct timespec * pxStart )
+{
+    struct timespec xEnd;
+
+    clock_gettime( xClock, &xEnd );
+
+    return ( ( double ) ( xEnd.tv_sec - pxStart->tv_sec ) * 1e9 ) +
+           ( double ) ( xEnd.tv_nsec - pxStart->tv_nsec );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddConnection( void )
+{
+    FreeRTOS_Socket_t * pxSocket;
+    struct freertos_sockaddr xAddress;
+    BaseType_t xResult;
+
+    pxSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+    configASSERT( pxSocket != FREERTOS_INVALID_SOCKET );
+
+    xAddress.sin_addr = FreeRTOS_GetIPAddress();
+    xAddress.sin_port = FreeRTOS_htons( benchLOCAL_PORT );
+
+    /* The IP-task binds and connects child sockets, so it may not run in
+     * between. */
+    vTaskSuspendAll();
+    {
+        xResult = vSocketBind( pxSocket, &xAddress, sizeof( xAddress ), pdTRUE );
+        configASSERT( xResult == 0 );
+
+        pxSocket->u.xTCP.ulRemoteIP = 0xC0A8010AUL;
+        pxSocket->u.xTCP.usRemotePort = ( uint16_t ) ( benchFIRST_REMOTE_PORT + uxSocketCount );
+        vTCPStateChange( pxSocket, eESTABLISHED );
+    }
+    ( void ) xTaskResumeAll();
+
+    pxConnections[ uxSocketCount ] = pxSocket;
+}
+/*-----------------------------------------------------------*/
+
+static void prvShuffle( void )
+{
+    uint32_t ulState = 0x2545F491UL;
+    size_t x;
+
+    /* A fixed pseudo-random order of the connections that send. */
+    for( x = 0; x < benchSEQUENCE_LENGTH; x++ )
+    {
+        ulState ^= ulState << 13;
+        ulState ^= ulState >> 17;
+        ulState ^= ulState << 5;
+        usSequence[ x ] = ( uint16_t ) ( ulState % uxSocketCount );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetIdleTimeouts( void )
+{
+    UBaseType_t uxIndex;
+
+    /* The list walk subtracts at least one tick in every check, also when
+     * the tick count did not change.  Restart the time-outs, so that no idle
+     * connection expires during the measurement. */
+    for( uxIndex = 0; uxIndex < uxSocketCount; uxIndex++ )
+    {
+        vSocketSetTCPTimeout( pxConnections[ uxIndex ], benchIDLE_TIMEOUT );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static double prvRunChecks( void )
+{
+    struct timespec xStart;
+    uint32_t ulCheck, ulRound;
+    double dNs = 0.0;
+
+    /* The benchmark task calls xTCPTimerCheck() in place of the IP-task, so
+     * the IP-task may not run.  The scheduler is resumed between rounds to
+     * let the tick count advance.  No time-out expires, like in the checks
+     * that follow the received packets of idle connections. */
+    for( ulRound = 0; ulRound < ulIterations; ulRound += benchCHECKS_PER_ROUND )
+    {
+        vTaskSuspendAll();
+        {
+            prvSetIdleTimeouts();
+            clock_gettime( CLOCK_MONOTONIC, &xStart );
+
+            for( ulCheck = ulRound; ( ulCheck < ulRound + benchCHECKS_PER_ROUND ) && ( ulCheck < ulIterations ); ulCheck++ )
+            {
+                ( void ) xTCPTimerCheck( pdTRUE );
+            }
+
+            dNs += prvElapsedNs( CLOCK_MONOTONIC, &xStart );
+        }
+        ( void ) xTaskResumeAll();
+    }
+
+    return dNs / ( double ) ulIterations;
+}
+/*-----------------------------------------------------------*/
+
+static double prvRunEvents( uint32_t * pulMisses )
+{
+    struct timespec xStart;
+    uint32_t ulEvent;
+    FreeRTOS_Socket_t * pxSocket;
+    IPStackEvent_t xEvent = { eTCPTimerEvent, NULL };
+
+    /* The process time leaves out the time in which the POSIX port hands the
+     * processor from one thread to the other. */
+    prvSetIdleTimeouts();
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &xStart );
+
+    for( ulEvent = 0; ulEvent < ulIterations; ulEvent++ )
+    {
+        /* What FreeRTOS_send() does after adding data to the stream.  The
+         * IP-task has a higher priority, so it handles the event before
+         * xSendEventStructToIPTask() returns. */
+        pxSocket = pxConnections[ usSequence[ ulEvent % benchSEQUENCE_LENGTH ] ];
+        vSocketSetTCPTimeout( pxSocket, 1u );
+        ( void ) xSendEventStructToIPTask( &xEvent, portMAX_DELAY );
+
+        if( pxSocket->u.xTCP.usTimeout == 1u )
+        {
+            ( *pulMisses )++;
+        }
+    }
+
+    return prvElapsedNs( CLOCK_PROCESS_CPUTIME_ID, &xStart ) / ( double ) ulIterations;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunSeries( void )
+{
+    uint32_t ulMisses = 0;
+    double dCheckNs, dEventNs;
+
+    prvShuffle();
+
+    dCheckNs = prvRunChecks();
+    dEventNs = prvRunEvents( &ulMisses );
+
+    printf( "%8u %10.1f %10.1f %8u\n",
+            ( unsigned ) uxSocketCount, dCheckNs, dEventNs, ( unsigned ) ulMisses );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchmarkTask( void * pvParameters )
+{
+    size_t x;
+
+    ( void ) pvParameters;
+
+    printf( "ipconfigUSE_TCP_TIMER_HEAP %u, %lu checks and events per series\n",
+            ( unsigned ) ipconfigUSE_TCP_TIMER_HEAP, ( unsigned long ) ulIterations );
+    printf( "%8s %10s %10s %8s\n", "sockets", "check_ns", "event_ns", "misses" );
+
+    for( x = 0; x < sizeof( uxSocketCounts ) / sizeof( uxSocketCounts[ 0 ] ); x++ )
+    {
+        while( uxSocketCount < uxSocketCounts[ x ] )
+        {
+            prvAddConnection();
+            uxSocketCount++;
+        }
+
+        prvRunSeries();
+    }
+
+    vTaskEndScheduler();
+}
+/*-----------------------------------------------------------*/
+int main( int argc,
+          char ** argv )
+{
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+
+        if( ulIterations == 0 )
+        {
+            fprintf( stderr, "usage: %s [iterations]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+
+    FreeRTOS_IPInit( ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+    vTaskStartScheduler();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+    static BaseType_t xTaskCreated = pdFALSE;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTaskCreated == pdFALSE ) )
+    {
+        xTaskCreated = pdTRUE;
+        xTaskCreate( prvBenchmarkTask, "Benchmark", benchTASK_STACK_SIZE, NULL, benchTASK_PRIORITY, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                             uint16_t usSourcePort,
+                                             uint32_t ulDestinationAddress,
+                                             uint16_t usDestinationPort )
+{
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    return ( uint32_t ) rand();
+}
+/*-----------------------------------------------------------*/
+
+/* The network interface: the benchmark sends and receives no packets. */
+
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t xReleaseAfterSend )
+{
+    if( xReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return pdTRUE;
+}
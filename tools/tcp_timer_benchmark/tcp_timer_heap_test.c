@@ -0,0 +1,256 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+/*
+ * A randomized test of the heap of TCP time-outs that ipconfigUSE_TCP_TIMER_HEAP
+ * enables.
+ *
+ * The test includes FreeRTOS_Sockets.c, so that it can look at the heap.  A
+ * task with a priority above the IP-task creates and closes sockets, and gives
+ * them new time-outs or clears them, in a random order.  Now and then it takes
+ * the expired sockets from the heap the way xTCPTimerCheck() does.  After every
+ * batch of operations it checks that:
+ * - every socket in the heap knows its own place;
+ * - no socket expires before its parent;
+ * - the heap holds exactly the sockets that have a time-out.
+ */
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The module under test, with its private data. */
+#include "FreeRTOS_Sockets.c"
+
+/* FreeRTOS+TCP includes. */
+#include "NetworkInterface.h"
+
+#if ( ipconfigUSE_TCP_TIMER_HEAP == 0 )
+    #error The test needs ipconfigUSE_TCP_TIMER_HEAP
+#endif
+
+#define testDEFAULT_OPERATIONS    ( 2000000UL )
+#define testSOCKETS               ( 300 )
+#define testMAX_TIMEOUT           ( 3000 )
+#define testPOP_INTERVAL          ( 7UL )
+#define testCHECK_INTERVAL        ( 97UL )
+#define testTASK_STACK_SIZE       ( configMINIMAL_STACK_SIZE * 8 )
+#define testTASK_PRIORITY         ( configMAX_PRIORITIES - 1 )
+
+static const uint8_t ucIPAddress[ 4 ] = { 192, 168, 1, 2 };
+static const uint8_t ucNetMask[ 4 ] = { 255, 255, 255, 0 };
+static const uint8_t ucGatewayAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucDNSServerAddress[ 4 ] = { 192, 168, 1, 1 };
+static const uint8_t ucMACAddress[ 6 ] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static uint32_t ulOperations = testDEFAULT_OPERATIONS;
+
+static FreeRTOS_Socket_t * pxSockets[ testSOCKETS ];
+
+/*-----------------------------------------------------------*/
+
+static void prvCheckHeap( void )
+{
+    UBaseType_t uxIndex, uxWithTimeout = 0u;
+    FreeRTOS_Socket_t * pxSocket, * pxParent;
+
+    vTaskSuspendAll();
+    {
+        for( uxIndex = 1u; uxIndex <= uxTCPTimerCount; uxIndex++ )
+        {
+            pxSocket = ppxTCPTimerHeap[ uxIndex - 1u ];
+            configASSERT( pxSocket->u.xTCP.uxTimerIndex == uxIndex );
+            configASSERT( pxSocket->u.xTCP.usTimeout != 0u );
+
+            if( uxIndex > 1u )
+            {
+                pxParent = ppxTCPTimerHeap[ ( uxIndex / 2u ) - 1u ];
+                configASSERT( prvTCPTimerBefore( listGET_LIST_ITEM_VALUE( &( pxSocket->u.xTCP.xTimerListItem ) ),
+                                                 listGET_LIST_ITEM_VALUE( &( pxParent->u.xTCP.xTimerListItem ) ) ) == pdFALSE );
+            }
+        }
+
+        for( uxIndex = 0u; uxIndex < testSOCKETS; uxIndex++ )
+        {
+            pxSocket = pxSockets[ uxIndex ];
+
+            if( pxSocket == NULL )
+            {
+                continue;
+            }
+
+            if( pxSocket->u.xTCP.usTimeout != 0u )
+            {
+                uxWithTimeout++;
+            }
+            else
+            {
+                configASSERT( pxSocket->u.xTCP.uxTimerIndex == 0u );
+            }
+        }
+
+        configASSERT( uxWithTimeout == uxTCPTimerCount );
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static void prvPopExpired( void )
+{
+    FreeRTOS_Socket_t * pxSocket;
+    TickType_t xNow = xTaskGetTickCount() + ( TickType_t ) ( rand() % testMAX_TIMEOUT );
+
+    /* What xTCPTimerCheck() does, without checking the sockets. */
+    vTaskSuspendAll();
+    {
+        while( ( uxTCPTimerCount != 0u ) &&
+               ( prvTCPTimerBefore( xNow + 1u, listGET_LIST_ITEM_VALUE( &( ppxTCPTimerHeap[ 0 ]->u.xTCP.xTimerListItem ) ) ) == pdFALSE ) )
+        {
+            pxSocket = ppxTCPTimerHeap[ 0 ];
+            prvTCPTimerRemove( pxSocket );
+            pxSocket->u.xTCP.usTimeout = 0u;
+        }
+    }
+    ( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTask( void * pvParameters )
+{
+    uint32_t ulOperation;
+    int iIndex, iChoice;
+
+    ( void ) pvParameters;
+
+    srand( 1 );
+
+    for( ulOperation = 0; ulOperation < ulOperations; ulOperation++ )
+    {
+        iIndex = rand() % testSOCKETS;
+        iChoice = rand() % 10;
+
+        if( pxSockets[ iIndex ] == NULL )
+        {
+            pxSockets[ iIndex ] = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+            configASSERT( pxSockets[ iIndex ] != FREERTOS_INVALID_SOCKET );
+        }
+        else if( iChoice == 0 )
+        {
+            ( void ) vSocketClose( pxSockets[ iIndex ] );
+            pxSockets[ iIndex ] = NULL;
+        }
+        else if( iChoice < 3 )
+        {
+            vSocketSetTCPTimeout( pxSockets[ iIndex ], 0u );
+        }
+        else
+        {
+            vSocketSetTCPTimeout( pxSockets[ iIndex ], ( uint16_t ) ( 1 + ( rand() % testMAX_TIMEOUT ) ) );
+        }
+
+        if( ( ulOperation % testPOP_INTERVAL ) == 0u )
+        {
+            prvPopExpired();
+        }
+
+        if( ( ulOperation % testCHECK_INTERVAL ) == 0u )
+        {
+            prvCheckHeap();
+        }
+    }
+
+    prvCheckHeap();
+    printf( "%lu operations: %u sockets, %u in the heap, %u places\n",
+            ( unsigned long ) ulOperations, ( unsigned ) uxTCPSocketCount,
+            ( unsigned ) uxTCPTimerCount, ( unsigned ) uxTCPTimerSize );
+
+    vTaskEndScheduler();
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    if( argc > 1 )
+    {
+        ulOperations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+
+        if( ulOperations == 0 )
+        {
+            fprintf( stderr, "usage: %s [operations]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+
+    FreeRTOS_IPInit( ucIPAddress, ucNetMask, ucGatewayAddress, ucDNSServerAddress, ucMACAddress );
+    vTaskStartScheduler();
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+    static BaseType_t xTaskCreated = pdFALSE;
+
+    if( ( eNetworkEvent == eNetworkUp ) && ( xTaskCreated == pdFALSE ) )
+    {
+        xTaskCreated = pdTRUE;
+        xTaskCreate( prvTestTask, "HeapTest", testTASK_STACK_SIZE, NULL, testTASK_PRIORITY, NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+                                             uint16_t usSourcePort,
+                                             uint32_t ulDestinationAddress,
+                                             uint16_t usDestinationPort )
+{
+    ( void ) ulSourceAddress;
+    ( void ) usSourcePort;
+    ( void ) ulDestinationAddress;
+    ( void ) usDestinationPort;
+
+    return ( uint32_t ) rand();
+}
+/*-----------------------------------------------------------*/
+
+/* The network interface: the test sends and receives no packets. */
+
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t xReleaseAfterSend )
+{
+    if( xReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return pdTRUE;
+}
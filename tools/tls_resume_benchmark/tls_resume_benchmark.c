@@ -0,0 +1,656 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Measures the cost of a full TLS handshake against a resumed one.
+ *
+ * A client and a server run in one process and exchange records through
+ * memory, so only the handshake computation is measured. The client uses
+ * mutual authentication with ECDSA P-256 credentials, like a device
+ * connecting to AWS IoT. After each handshake it saves its session the same
+ * way as iot_tls.c when tlsconfigSESSION_CACHE_SIZE is enabled, and offers
+ * the saved session on the next handshake.
+ */
+
+/* mbedTLS includes. */
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/platform.h"
+
+/* C runtime includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define benchSERVER_NAME            "benchmark.iot.local"
+#define benchPIPE_SIZE              ( 16 * 1024 )
+#define benchCERTIFICATE_SIZE       ( 1024 )
+#define benchDEFAULT_ITERATIONS     ( 50 )
+#define benchMAX_HANDSHAKE_STEPS    ( 1000 )
+
+/**
+ * @brief One direction of the in-memory connection.
+ */
+typedef struct Pipe
+{
+    unsigned char ucData[ benchPIPE_SIZE ];
+    size_t xStart;
+    size_t xEnd;
+    size_t xTotal;
+} Pipe_t;
+
+/**
+ * @brief The pipes of one endpoint.
+ */
+typedef struct Endpoint
+{
+    Pipe_t * pxIn;
+    Pipe_t * pxOut;
+} Endpoint_t;
+
+/**
+ * @brief Measurements of one handshake.
+ *
+ * @param[out] dClientMs Time spent in the client, in milliseconds.
+ * @param[out] dServerMs Time spent in the server, in milliseconds.
+ * @param[out] xBytes Bytes sent in both directions.
+ * @param[out] ulFlights Number of times the client sent data and then waited for the server.
+ * @param[out] xResumed Whether the server accepted the offered session.
+ */
+typedef struct Result
+{
+    double dClientMs;
+    double dServerMs;
+    size_t xBytes;
+    uint32_t ulFlights;
+    int xResumed;
+} Result_t;
+
+/**
+ * @brief The client and server state shared by all handshakes.
+ */
+typedef struct Benchmark
+{
+    mbedtls_entropy_context xEntropy;
+    mbedtls_ctr_drbg_context xDrbg;
+    mbedtls_pk_context xCaKey;
+    mbedtls_pk_context xServerKey;
+    mbedtls_pk_context xClientKey;
+    mbedtls_x509_crt xCaCertificate;
+    mbedtls_x509_crt xServerCertificate;
+    mbedtls_x509_crt xClientCertificate;
+    mbedtls_ssl_cache_context xServerCache;
+    mbedtls_ssl_ticket_context xServerTickets;
+    mbedtls_ssl_config xClientConfig;
+    mbedtls_ssl_config xClientTicketConfig;
+    mbedtls_ssl_config xServerConfig;
+    mbedtls_ssl_config xServerTicketConfig;
+} Benchmark_t;
+
+static Benchmark_t xBench;
+
+/*-----------------------------------------------------------*/
+
+static double prvNowMs( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( double ) xNow.tv_sec * 1000.0 ) + ( ( double ) xNow.tv_nsec / 1000000.0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvPipeSend( void * pvContext,
+                        const unsigned char * pucData,
+                        size_t xDataLength )
+{
+    Pipe_t * pxPipe = ( ( Endpoint_t * ) pvContext )->pxOut;
+    size_t xFree = 0;
+
+    /* Move unread data to the front. */
+    memmove( pxPipe->ucData, pxPipe->ucData + pxPipe->xStart, pxPipe->xEnd - pxPipe->xStart );
+    pxPipe->xEnd -= pxPipe->xStart;
+    pxPipe->xStart = 0;
+
+    xFree = benchPIPE_SIZE - pxPipe->xEnd;
+
+    if( xFree == 0 )
+    {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+
+    if( xDataLength > xFree )
+    {
+        xDataLength = xFree;
+    }
+
+    memcpy( pxPipe->ucData + pxPipe->xEnd, pucData, xDataLength );
+    pxPipe->xEnd += xDataLength;
+    pxPipe->xTotal += xDataLength;
+
+    return ( int ) xDataLength;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvPipeRecv( void * pvContext,
+                        unsigned char * pucData,
+                        size_t xDataLength )
+{
+    Pipe_t * pxPipe = ( ( Endpoint_t * ) pvContext )->pxIn;
+    size_t xAvailable = pxPipe->xEnd - pxPipe->xStart;
+
+    if( xAvailable == 0 )
+    {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+
+    if( xDataLength > xAvailable )
+    {
+        xDataLength = xAvailable;
+    }
+
+    memcpy( pucData, pxPipe->ucData + pxPipe->xStart, xDataLength );
+    pxPipe->xStart += xDataLength;
+
+    return ( int ) xDataLength;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Generates a P-256 key and a certificate for it.
+ *
+ * The certificate is self-signed when pxIssuerKey is NULL.
+ */
+static int prvMakeCredential( mbedtls_pk_context * pxKey,
+                              mbedtls_x509_crt * pxCertificate,
+                              const char * pcSubject,
+                              mbedtls_pk_context * pxIssuerKey,
+                              const char * pcIssuer,
+                              int lSerial )
+{
+    int lResult = 0;
+    mbedtls_x509write_cert xWriter;
+    mbedtls_mpi xSerial;
+    unsigned char ucDer[ benchCERTIFICATE_SIZE ];
+
+    mbedtls_x509write_crt_init( &xWriter );
+    mbedtls_mpi_init( &xSerial );
+
+    lResult = mbedtls_pk_setup( pxKey, mbedtls_pk_info_from_type( MBEDTLS_PK_ECKEY ) );
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_ecp_gen_key( MBEDTLS_ECP_DP_SECP256R1,
+                                       mbedtls_pk_ec( *pxKey ),
+                                       mbedtls_ctr_drbg_random,
+                                       &xBench.xDrbg );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_mpi_lset( &xSerial, lSerial );
+    }
+
+    if( lResult == 0 )
+    {
+        mbedtls_x509write_crt_set_version( &xWriter, MBEDTLS_X509_CRT_VERSION_3 );
+        mbedtls_x509write_crt_set_md_alg( &xWriter, MBEDTLS_MD_SHA256 );
+        mbedtls_x509write_crt_set_subject_key( &xWriter, pxKey );
+        mbedtls_x509write_crt_set_issuer_key( &xWriter, ( pxIssuerKey != NULL ) ? pxIssuerKey : pxKey );
+        lResult = mbedtls_x509write_crt_set_serial( &xWriter, &xSerial );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_x509write_crt_set_subject_name( &xWriter, pcSubject );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_x509write_crt_set_issuer_name( &xWriter, ( pcIssuer != NULL ) ? pcIssuer : pcSubject );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_x509write_crt_set_validity( &xWriter, "20200101000000", "20491231235959" );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_x509write_crt_set_basic_constraints( &xWriter, ( pxIssuerKey == NULL ) ? 1 : 0, -1 );
+    }
+
+    if( lResult == 0 )
+    {
+        /* The certificate is written at the end of the buffer. */
+        lResult = mbedtls_x509write_crt_der( &xWriter, ucDer, sizeof( ucDer ), mbedtls_ctr_drbg_random, &xBench.xDrbg );
+    }
+
+    if( lResult > 0 )
+    {
+        lResult = mbedtls_x509_crt_parse_der( pxCertificate, ucDer + sizeof( ucDer ) - lResult, ( size_t ) lResult );
+    }
+
+    mbedtls_mpi_free( &xSerial );
+    mbedtls_x509write_crt_free( &xWriter );
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvSetupConfig( mbedtls_ssl_config * pxConfig,
+                           int lEndpoint,
+                           mbedtls_x509_crt * pxCertificate,
+                           mbedtls_pk_context * pxKey )
+{
+    int lResult = 0;
+
+    mbedtls_ssl_config_init( pxConfig );
+
+    lResult = mbedtls_ssl_config_defaults( pxConfig,
+                                           lEndpoint,
+                                           MBEDTLS_SSL_TRANSPORT_STREAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT );
+
+    if( lResult == 0 )
+    {
+        /* Both sides authenticate, as with AWS IoT. */
+        mbedtls_ssl_conf_authmode( pxConfig, MBEDTLS_SSL_VERIFY_REQUIRED );
+        mbedtls_ssl_conf_rng( pxConfig, mbedtls_ctr_drbg_random, &xBench.xDrbg );
+        mbedtls_ssl_conf_ca_chain( pxConfig, &xBench.xCaCertificate, NULL );
+        lResult = mbedtls_ssl_conf_own_cert( pxConfig, pxCertificate, pxKey );
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvSetup( void )
+{
+    int lResult = 0;
+    const char cPersonalization[] = "tls_resume_benchmark";
+
+    mbedtls_entropy_init( &xBench.xEntropy );
+    mbedtls_ctr_drbg_init( &xBench.xDrbg );
+    mbedtls_pk_init( &xBench.xCaKey );
+    mbedtls_pk_init( &xBench.xServerKey );
+    mbedtls_pk_init( &xBench.xClientKey );
+    mbedtls_x509_crt_init( &xBench.xCaCertificate );
+    mbedtls_x509_crt_init( &xBench.xServerCertificate );
+    mbedtls_x509_crt_init( &xBench.xClientCertificate );
+    mbedtls_ssl_cache_init( &xBench.xServerCache );
+    mbedtls_ssl_ticket_init( &xBench.xServerTickets );
+
+    lResult = mbedtls_ctr_drbg_seed( &xBench.xDrbg,
+                                     mbedtls_entropy_func,
+                                     &xBench.xEntropy,
+                                     ( const unsigned char * ) cPersonalization,
+                                     sizeof( cPersonalization ) - 1 );
+
+    if( lResult == 0 )
+    {
+        lResult = prvMakeCredential( &xBench.xCaKey, &xBench.xCaCertificate,
+                                     "CN=Benchmark CA", NULL, NULL, 1 );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = prvMakeCredential( &xBench.xServerKey, &xBench.xServerCertificate,
+                                     "CN=" benchSERVER_NAME, &xBench.xCaKey, "CN=Benchmark CA", 2 );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = prvMakeCredential( &xBench.xClientKey, &xBench.xClientCertificate,
+                                     "CN=Benchmark Device", &xBench.xCaKey, "CN=Benchmark CA", 3 );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_ssl_ticket_setup( &xBench.xServerTickets,
+                                            mbedtls_ctr_drbg_random,
+                                            &xBench.xDrbg,
+                                            MBEDTLS_CIPHER_AES_256_GCM,
+                                            86400 );
+    }
+
+    /* Session ID resumption: the client sends no ticket extension and the
+     * server keeps the sessions. */
+    if( lResult == 0 )
+    {
+        lResult = prvSetupConfig( &xBench.xClientConfig, MBEDTLS_SSL_IS_CLIENT,
+                                  &xBench.xClientCertificate, &xBench.xClientKey );
+    }
+
+    if( lResult == 0 )
+    {
+        mbedtls_ssl_conf_session_tickets( &xBench.xClientConfig, MBEDTLS_SSL_SESSION_TICKETS_DISABLED );
+        lResult = prvSetupConfig( &xBench.xServerConfig, MBEDTLS_SSL_IS_SERVER,
+                                  &xBench.xServerCertificate, &xBench.xServerKey );
+    }
+
+    if( lResult == 0 )
+    {
+        mbedtls_ssl_conf_session_cache( &xBench.xServerConfig,
+                                        &xBench.xServerCache,
+                                        mbedtls_ssl_cache_get,
+                                        mbedtls_ssl_cache_set );
+    }
+
+    /* Ticket resumption: the server keeps no state. */
+    if( lResult == 0 )
+    {
+        lResult = prvSetupConfig( &xBench.xClientTicketConfig, MBEDTLS_SSL_IS_CLIENT,
+                                  &xBench.xClientCertificate, &xBench.xClientKey );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = prvSetupConfig( &xBench.xServerTicketConfig, MBEDTLS_SSL_IS_SERVER,
+                                  &xBench.xServerCertificate, &xBench.xServerKey );
+    }
+
+    if( lResult == 0 )
+    {
+        mbedtls_ssl_conf_session_tickets_cb( &xBench.xServerTicketConfig,
+                                             mbedtls_ssl_ticket_write,
+                                             mbedtls_ssl_ticket_parse,
+                                             &xBench.xServerTickets );
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Saves a session for the next handshake, as iot_tls.c does.
+ */
+static void prvSaveSession( mbedtls_ssl_context * pxClient,
+                            mbedtls_ssl_session * pxSession )
+{
+    mbedtls_ssl_session_free( pxSession );
+    mbedtls_ssl_session_init( pxSession );
+
+    if( mbedtls_ssl_get_session( pxClient, pxSession ) == 0 )
+    {
+        /* The server certificate is not needed to resume. */
+        if( pxSession->peer_cert != NULL )
+        {
+            mbedtls_x509_crt_free( pxSession->peer_cert );
+            mbedtls_free( pxSession->peer_cert );
+            pxSession->peer_cert = NULL;
+        }
+    }
+    else
+    {
+        mbedtls_ssl_session_free( pxSession );
+        mbedtls_ssl_session_init( pxSession );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Runs one handshake.
+ *
+ * @param[in] pxClientConfig Client configuration.
+ * @param[in] pxServerConfig Server configuration.
+ * @param[in,out] pxSession Session to offer, if its ID or ticket is set.
+ * Replaced by the new session on success.
+ * @param[out] pxResult Measurements.
+ *
+ * @return Zero on success.
+ */
+static int prvHandshake( mbedtls_ssl_config * pxClientConfig,
+                         mbedtls_ssl_config * pxServerConfig,
+                         mbedtls_ssl_session * pxSession,
+                         Result_t * pxResult )
+{
+    static Pipe_t xToServer, xToClient;
+    Endpoint_t xClientEndpoint = { &xToClient, &xToServer };
+    Endpoint_t xServerEndpoint = { &xToServer, &xToClient };
+    mbedtls_ssl_context xClient, xServer;
+    int lClientResult = MBEDTLS_ERR_SSL_WANT_READ;
+    int lServerResult = MBEDTLS_ERR_SSL_WANT_READ;
+    int lResult = 0;
+    int lOffered = 0;
+    uint32_t ulStep = 0;
+    size_t xSent = 0;
+    double dStart = 0;
+
+    memset( pxResult, 0, sizeof( Result_t ) );
+    memset( &xToServer, 0, sizeof( xToServer ) );
+    memset( &xToClient, 0, sizeof( xToClient ) );
+
+    mbedtls_ssl_init( &xClient );
+    mbedtls_ssl_init( &xServer );
+
+    lResult = mbedtls_ssl_setup( &xClient, pxClientConfig );
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_ssl_setup( &xServer, pxServerConfig );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = mbedtls_ssl_set_hostname( &xClient, benchSERVER_NAME );
+    }
+
+    if( lResult == 0 )
+    {
+        mbedtls_ssl_set_bio( &xClient, &xClientEndpoint, prvPipeSend, prvPipeRecv, NULL );
+        mbedtls_ssl_set_bio( &xServer, &xServerEndpoint, prvPipeSend, prvPipeRecv, NULL );
+
+        if( ( pxSession->id_len != 0 ) || ( pxSession->ticket != NULL ) )
+        {
+            lResult = mbedtls_ssl_set_session( &xClient, pxSession );
+            lOffered = 1;
+        }
+    }
+
+    /* Alternate between the two sides until both have finished. */
+    while( ( lResult == 0 ) && ( ( lClientResult != 0 ) || ( lServerResult != 0 ) ) )
+    {
+        if( ++ulStep > benchMAX_HANDSHAKE_STEPS )
+        {
+            lResult = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+            break;
+        }
+
+        if( lClientResult != 0 )
+        {
+            xSent = xToServer.xTotal;
+            dStart = prvNowMs();
+            lClientResult = mbedtls_ssl_handshake( &xClient );
+            pxResult->dClientMs += prvNowMs() - dStart;
+
+            if( xToServer.xTotal != xSent )
+            {
+                pxResult->ulFlights++;
+            }
+        }
+
+        if( lServerResult != 0 )
+        {
+            dStart = prvNowMs();
+            lServerResult = mbedtls_ssl_handshake( &xServer );
+            pxResult->dServerMs += prvNowMs() - dStart;
+        }
+
+        if( ( lClientResult != 0 ) &&
+            ( lClientResult != MBEDTLS_ERR_SSL_WANT_READ ) &&
+            ( lClientResult != MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            lResult = lClientResult;
+        }
+        else if( ( lServerResult != 0 ) &&
+                 ( lServerResult != MBEDTLS_ERR_SSL_WANT_READ ) &&
+                 ( lServerResult != MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            lResult = lServerResult;
+        }
+    }
+
+    if( lResult == 0 )
+    {
+        pxResult->xBytes = xToServer.xTotal + xToClient.xTotal;
+
+        /* The offered session carries no server certificate, so the client
+         * only has one if the server ran a full handshake. */
+        pxResult->xResumed = ( lOffered != 0 ) && ( mbedtls_ssl_get_peer_cert( &xClient ) == NULL );
+
+        prvSaveSession( &xClient, pxSession );
+    }
+
+    mbedtls_ssl_free( &xClient );
+    mbedtls_ssl_free( &xServer );
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Runs a series of handshakes and prints their averages.
+ *
+ * @param[in] pcName Name of the series.
+ * @param[in] xResume Whether each handshake offers the previous session.
+ */
+static int prvRunSeries( const char * pcName,
+                         mbedtls_ssl_config * pxClientConfig,
+                         mbedtls_ssl_config * pxServerConfig,
+                         int xResume,
+                         uint32_t ulIterations )
+{
+    int lResult = 0;
+    uint32_t ulIteration = 0;
+    uint32_t ulResumed = 0;
+    mbedtls_ssl_session xSession;
+    Result_t xResult;
+    Result_t xTotal;
+
+    memset( &xTotal, 0, sizeof( xTotal ) );
+    mbedtls_ssl_session_init( &xSession );
+
+    /* An untimed handshake establishes the first session. */
+    lResult = prvHandshake( pxClientConfig, pxServerConfig, &xSession, &xResult );
+
+    for( ulIteration = 0; ( lResult == 0 ) && ( ulIteration < ulIterations ); ulIteration++ )
+    {
+        if( xResume == 0 )
+        {
+            mbedtls_ssl_session_free( &xSession );
+            mbedtls_ssl_session_init( &xSession );
+        }
+
+        lResult = prvHandshake( pxClientConfig, pxServerConfig, &xSession, &xResult );
+
+        xTotal.dClientMs += xResult.dClientMs;
+        xTotal.dServerMs += xResult.dServerMs;
+        xTotal.xBytes += xResult.xBytes;
+        xTotal.ulFlights += xResult.ulFlights;
+        ulResumed += ( xResult.xResumed != 0 ) ? 1 : 0;
+    }
+
+    if( lResult == 0 )
+    {
+        printf( "%-12s %10.3f %10.3f %8zu %8.1f %6u/%u\n",
+                pcName,
+                xTotal.dClientMs / ulIterations,
+                xTotal.dServerMs / ulIterations,
+                xTotal.xBytes / ulIterations,
+                ( double ) xTotal.ulFlights / ulIterations,
+                ulResumed,
+                ulIterations );
+    }
+    else
+    {
+        printf( "%-12s handshake failed with error -0x%04x\n", pcName, ( unsigned int ) -lResult );
+    }
+
+    mbedtls_ssl_session_free( &xSession );
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    int lResult = 0;
+    uint32_t ulIterations = benchDEFAULT_ITERATIONS;
+
+    if( argc > 1 )
+    {
+        ulIterations = ( uint32_t ) strtoul( argv[ 1 ], NULL, 10 );
+
+        if( ulIterations == 0 )
+        {
+            fprintf( stderr, "usage: %s [iterations]\n", argv[ 0 ] );
+            return 2;
+        }
+    }
+
+    lResult = prvSetup();
+
+    if( lResult != 0 )
+    {
+        fprintf( stderr, "setup failed with error -0x%04x\n", ( unsigned int ) -lResult );
+        return 1;
+    }
+
+    printf( "%-12s %10s %10s %8s %8s %8s\n", "handshake", "client_ms", "server_ms", "bytes", "flights", "resumed" );
+
+    lResult = prvRunSeries( "full", &xBench.xClientConfig, &xBench.xServerConfig, 0, ulIterations );
+
+    if( lResult == 0 )
+    {
+        lResult = prvRunSeries( "session-id", &xBench.xClientConfig, &xBench.xServerConfig, 1, ulIterations );
+    }
+
+    if( lResult == 0 )
+    {
+        lResult = prvRunSeries( "ticket", &xBench.xClientTicketConfig, &xBench.xServerTicketConfig, 1, ulIterations );
+    }
+
+    return ( lResult == 0 ) ? 0 : 1;
+}
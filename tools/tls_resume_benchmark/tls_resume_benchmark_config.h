@@ -0,0 +1,53 @@
+/*
+ * Amazon FreeRTOS
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Host overrides of the Amazon FreeRTOS mbedTLS configuration, applied through
+ * MBEDTLS_USER_CONFIG_FILE. The client side keeps the device configuration.
+ * The server side, the certificate writer, and the host entropy and threading
+ * are only needed by the benchmark.
+ */
+
+#ifndef TLS_RESUME_BENCHMARK_CONFIG_H
+#define TLS_RESUME_BENCHMARK_CONFIG_H
+
+/* Use the host entropy source instead of the board's. */
+#undef MBEDTLS_ENTROPY_HARDWARE_ALT
+#undef MBEDTLS_NO_PLATFORM_ENTROPY
+
+/* The benchmark is single threaded. */
+#undef MBEDTLS_THREADING_ALT
+#undef MBEDTLS_THREADING_C
+
+/* In-process server with a session ID cache and session tickets. */
+#define MBEDTLS_SSL_SRV_C
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+/* Test certificates are generated at start-up. */
+#define MBEDTLS_X509_CRT_WRITE_C
+
+#endif /* ifndef TLS_RESUME_BENCHMARK_CONFIG_H */
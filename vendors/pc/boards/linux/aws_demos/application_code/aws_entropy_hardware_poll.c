@@ -0,0 +1,74 @@
+/*
+ * Amazon FreeRTOS V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/* Standard includes. */
+#include <errno.h>
+#include <sys/random.h>
+
+#include "mbedtls/entropy.h"
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_hardware_poll( void * data,
+                           unsigned char * output,
+                           size_t len,
+                           size_t * olen )
+{
+    int lStatus = 0;
+    size_t xReceived = 0;
+    ssize_t xResult;
+
+    /* Unferenced parameter. */
+    ( void ) data;
+
+    /*
+     * This is port-specific for the Linux simulator, so just use the kernel
+     * random number generator.
+     */
+    while( ( lStatus == 0 ) && ( xReceived < len ) )
+    {
+        xResult = getrandom( output + xReceived, len - xReceived, 0 );
+
+        if( xResult > 0 )
+        {
+            xReceived += ( size_t ) xResult;
+        }
+        else if( ( xResult < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted by the tick signal, try again. */
+        }
+        else
+        {
+            lStatus = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+        }
+    }
+
+    if( lStatus == 0 )
+    {
+        *olen = len;
+    }
+
+    return lStatus;
+}
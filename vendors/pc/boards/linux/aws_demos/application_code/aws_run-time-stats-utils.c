@@ -0,0 +1,83 @@
+/*
+ * Amazon FreeRTOS V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+
+/*
+ * Utility functions required to gather run time statistics.  See:
+ * http://www.freertos.org/rtos-run-time-stats.html
+ *
+ * The time base is the monotonic clock of the host, scaled to 1/100ths of a
+ * millisecond.  Tasks are threads of the host, so the counter includes the
+ * time the host spends on other processes while a task is running.
+ *
+ * Also note that it is assumed this demo is going to be used for short periods
+ * of time only, and therefore timer overflows are not handled.
+ */
+
+/* Standard includes. */
+#include <time.h>
+
+/* FreeRTOS includes. */
+#include <FreeRTOS.h>
+
+/* The monotonic clock reading taken when the scheduler starts.  Run time stats
+ * record how much time each task spends in the Running state. */
+static struct timespec xInitialRunTimeValue = { 0 };
+static BaseType_t xRunTimeCounterConfigured = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+void vConfigureTimerForRunTimeStats( void )
+{
+    /* What is the clock value now, this will be subtracted from readings taken
+     * at run time. */
+    if( clock_gettime( CLOCK_MONOTONIC, &xInitialRunTimeValue ) == 0 )
+    {
+        xRunTimeCounterConfigured = pdTRUE;
+    }
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulGetRunTimeCounterValue( void )
+{
+    struct timespec xCurrentCount;
+    long long llElapsedNs;
+    unsigned long ulReturn = 0;
+
+    /* The trace macros can call this function before the kernel has been
+     * started, in which case the time base has not been initialised. */
+    if( ( xRunTimeCounterConfigured == pdTRUE ) &&
+        ( clock_gettime( CLOCK_MONOTONIC, &xCurrentCount ) == 0 ) )
+    {
+        llElapsedNs = ( ( long long ) ( xCurrentCount.tv_sec - xInitialRunTimeValue.tv_sec ) * 1000000000LL ) +
+                      ( long long ) ( xCurrentCount.tv_nsec - xInitialRunTimeValue.tv_nsec );
+
+        /* Scale to 1/100ths of a millisecond. */
+        ulReturn = ( unsigned long ) ( llElapsedNs / 10000LL );
+    }
+
+    return ulReturn;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,142 @@
+/*
+ * Amazon FreeRTOS V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Entry point of the demos on the Linux simulator.
+ *
+ * The demos use the network of the host through the BSD sockets based Secure
+ * Sockets port, so no network setup is needed.  The PKCS #11 objects are stored
+ * in files in the working directory.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Demo application includes. */
+#include "iot_logging_task.h"
+#include "iot_system_init.h"
+#include "aws_demo.h"
+#include "aws_dev_mode_key_provisioning.h"
+
+/* Logging task definitions. */
+#define mainLOGGING_TASK_PRIORITY           ( configMAX_PRIORITIES - 1 )
+#define mainLOGGING_TASK_STACK_SIZE         ( configMINIMAL_STACK_SIZE * 4 )
+#define mainLOGGING_MESSAGE_QUEUE_LENGTH    ( 32 )
+
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void );
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* Create tasks that are not dependent on the network. */
+    xLoggingTaskInitialize( mainLOGGING_TASK_STACK_SIZE,
+                            mainLOGGING_TASK_PRIORITY,
+                            mainLOGGING_MESSAGE_QUEUE_LENGTH );
+
+    /* Start the scheduler.  Initialization that requires the OS to be running
+     * is performed in the RTOS daemon task startup hook. */
+    vTaskStartScheduler();
+
+    /* If all is well, the scheduler will now be running, and the following
+     * line will never be reached.  If the following line does execute, then
+     * there was insufficient FreeRTOS heap memory available for the idle and/or
+     * timer tasks to be created. */
+    return EXIT_FAILURE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+    /* A simple example to demonstrate key and certificate provisioning in
+     * the file system using PKCS#11 interface. This should be replaced
+     * by production ready key provisioning mechanism. */
+    vDevModeKeyProvisioning();
+
+    /* Initialize AWS system libraries. */
+    if( SYSTEM_Init() == pdPASS )
+    {
+        /* Start the demo tasks. */
+        DEMO_RUNNER_RunDemos();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vMainPrintString( const char * pcString )
+{
+    size_t xLength = strlen( pcString );
+    ssize_t xWritten;
+
+    /* The logging task calls this function, so it must not use stdio.  A task
+     * switched out in the middle of a stdio call would keep the stdio lock of
+     * the host until it runs again. */
+    while( xLength > 0 )
+    {
+        xWritten = write( STDOUT_FILENO, pcString, xLength );
+
+        if( xWritten <= 0 )
+        {
+            break;
+        }
+
+        pcString += xWritten;
+        xLength -= ( size_t ) xWritten;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIdleHook( void )
+{
+    /* This is just a trivial example of an idle hook.  It is called on each
+     * cycle of the idle task if configUSE_IDLE_HOOK is set to 1 in
+     * FreeRTOSConfig.h.  It must *NOT* attempt to block.  In this case the
+     * idle task just sleeps to lower the CPU usage of the host.  The sleep
+     * ends early when the tick signal arrives. */
+    ( void ) usleep( 1000 );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    char cMessage[ 256 ];
+
+    ( void ) snprintf( cMessage, sizeof( cMessage ), "vAssertCalled %s, %ld\n", pcFile, ( long ) ulLine );
+    vMainPrintString( cMessage );
+
+    /* Stop the process so the assert can be examined in a debugger or a core
+     * dump. */
+    abort();
+}
+/*-----------------------------------------------------------*/
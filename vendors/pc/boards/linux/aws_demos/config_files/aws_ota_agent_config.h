@@ -0,0 +1,140 @@
+/*
+ * Amazon FreeRTOS V1.4.8
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file aws_ota_agent_config.h
+ * @brief OTA user configurable settings.
+ */
+
+#ifndef _AWS_OTA_AGENT_CONFIG_H_
+#define _AWS_OTA_AGENT_CONFIG_H_
+
+/**
+ * @brief The number of words allocated to the stack for the OTA agent.
+ */
+#define otaconfigSTACK_SIZE                     630U
+
+/**
+ * @brief Log base 2 of the size of the file data block message (excluding the header).
+ *
+ * 10 bits yields a data block size of 1KB.
+ */
+#define otaconfigLOG2_FILE_BLOCK_SIZE           10UL
+
+/**
+ * @brief Milliseconds to wait for the self test phase to succeed before we force reset.
+ */
+#define otaconfigSELF_TEST_RESPONSE_WAIT_MS     16000U
+
+/**
+ * @brief Milliseconds to wait before requesting data blocks from the OTA service if nothing is happening.
+ *
+ * The wait timer is reset whenever a data block is received from the OTA service so we will only send
+ * the request message after being idle for this amount of time.
+ */
+#define otaconfigFILE_REQUEST_WAIT_MS           2500U
+
+/**
+ * @brief The OTA agents task priority. Normally it runs at a low priority.
+ */
+#define otaconfigAGENT_PRIORITY                 tskIDLE_PRIORITY
+
+/**
+ * @brief The maximum allowed length of the thing name used by the OTA agent.
+ *
+ * AWS IoT requires Thing names to be unique for each device that connects to the broker.
+ * Likewise, the OTA agent requires the developer to construct and pass in the Thing name when
+ * initializing the OTA agent. The agent uses this size to allocate static storage for the
+ * Thing name used in all OTA base topics. Namely $aws/things/<thingName>
+ */
+#define otaconfigMAX_THINGNAME_LEN              64U
+
+/**
+ * @brief The maximum number of data blocks requested from OTA streaming service.
+ * 
+ *  This configuration parameter is sent with data requests and represents the maximum number of 
+ *  data blocks the service will send in response. The maximum limit for this must be calculated 
+ *  from the maximum data response limit (128 KB from service) divided by the block size. 
+ *  For example if block size is set as 1 KB then the maximum number of data blocks that we can
+ *  request is 128/1 = 128 blocks. Configure this parameter to this maximum limit or lower based on 
+ *  how many data blocks response is expected for each data requests. 
+ *  Please note that this must be set larger than zero.
+ *  
+ */
+ #define otaconfigMAX_NUM_BLOCKS_REQUEST        128U
+
+/**
+ * @brief The maximum number of block ranges requested from the OTA streaming service at a time.
+ *
+ * When this is larger than zero, the agent keeps up to this many requests for ranges of
+ * otaconfigSTREAM_WINDOW_BLOCKS blocks in flight and requests the next range as soon as one
+ * completes, instead of requesting every missing block once per otaconfigFILE_REQUEST_WAIT_MS.
+ * The number of ranges in flight grows while blocks arrive faster, stops growing when they do not,
+ * and shrinks on duplicates and losses.
+ */
+#define otaconfigSTREAM_WINDOW_MAX_REQUESTS     8U
+
+/**
+ * @brief The number of blocks covered by each range requested in windowed mode.
+ *
+ * This must be a multiple of 8 and must not exceed otaconfigMAX_NUM_BLOCKS_REQUEST.
+ */
+#define otaconfigSTREAM_WINDOW_BLOCKS           16U
+
+/**
+ * @brief Set to 1 to hash each block for the signature check as it is received.
+ *
+ * The PAL then only checks the signature when the file is closed, instead of reading the whole
+ * file back. Blocks that arrive ahead of the next block to hash are held in RAM, up to
+ * otaconfigSIGNATURE_PENDING_BLOCKS of them.
+ */
+#define otaconfigINCREMENTAL_SIGNATURE_VERIFY   1
+
+/**
+ * @brief The number of out of order blocks held for the incremental hash.
+ *
+ * With windowed requests, a lost block is requested again after the ranges already in flight,
+ * so this covers a few ranges.
+ */
+#define otaconfigSIGNATURE_PENDING_BLOCKS       32U
+
+/**
+ * @brief Save a download checkpoint every this many received blocks.
+ *
+ * A download interrupted by a reset or a shutdown of the agent resumes from the last checkpoint
+ * when the same job is received again, and only the missing blocks are requested. The checkpoint
+ * is kept next to the receive file. Set to 0 to disable checkpoints.
+ */
+#define otaconfigCHECKPOINT_BLOCKS              32U
+
+/**
+ * @brief UTC time in seconds for the expiry driven certificate rotation.
+ *
+ * The simulator takes it from the host clock.
+ */
+#include <time.h>
+#define cdfconfigGET_UTC_SECONDS()              ( ( uint32_t ) time( NULL ) )
+
+#endif /* _AWS_OTA_AGENT_CONFIG_H_ */
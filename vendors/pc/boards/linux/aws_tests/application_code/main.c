@@ -0,0 +1,139 @@
+/*
+ * Amazon FreeRTOS V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file main.c
+ * @brief Implements the main function.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* FreeRTOS include. */
+#include <FreeRTOS.h>
+#include "task.h"
+
+/* Test runner includes. */
+#include "aws_test_runner.h"
+
+/* AWS System application includes. */
+#include "iot_logging_task.h"
+#include "iot_system_init.h"
+#include "aws_dev_mode_key_provisioning.h"
+
+/* Unity includes. */
+#include "unity.h"
+
+/* Logging task definitions. */
+#define mainLOGGING_TASK_PRIORITY           ( configMAX_PRIORITIES - 1 )
+#define mainLOGGING_TASK_STACK_SIZE         ( configMINIMAL_STACK_SIZE * 4 )
+#define mainLOGGING_MESSAGE_QUEUE_LENGTH    ( 32 )
+
+#define mainTEST_RUNNER_TASK_STACK_SIZE     ( configMINIMAL_STACK_SIZE * 16 )
+
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void );
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    /* Create tasks that are not dependent on the network. */
+    xLoggingTaskInitialize( mainLOGGING_TASK_STACK_SIZE,
+                            mainLOGGING_TASK_PRIORITY,
+                            mainLOGGING_MESSAGE_QUEUE_LENGTH );
+
+    /* Start the scheduler.  The tests are started in the RTOS daemon task
+     * startup hook. */
+    vTaskStartScheduler();
+
+    return EXIT_FAILURE;
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+    /* Initialize AWS system libraries. */
+    if( SYSTEM_Init() == pdPASS )
+    {
+        vDevModeKeyProvisioning();
+
+        /* Create the task to run tests. */
+        xTaskCreate( TEST_RUNNER_RunTests_task,
+                     "TestRunner",
+                     mainTEST_RUNNER_TASK_STACK_SIZE,
+                     NULL,
+                     tskIDLE_PRIORITY,
+                     NULL );
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vMainPrintString( const char * pcString )
+{
+    size_t xLength = strlen( pcString );
+    ssize_t xWritten;
+
+    /* The logging task calls this function, so it must not use stdio.  A task
+     * switched out in the middle of a stdio call would keep the stdio lock of
+     * the host until it runs again. */
+    while( xLength > 0 )
+    {
+        xWritten = write( STDOUT_FILENO, pcString, xLength );
+
+        if( xWritten <= 0 )
+        {
+            break;
+        }
+
+        pcString += xWritten;
+        xLength -= ( size_t ) xWritten;
+    }
+}
+/*-----------------------------------------------------------*/
+
+void vApplicationIdleHook( void )
+{
+    /* Sleep to lower the CPU usage of the host.  The sleep ends early when the
+     * tick signal arrives. */
+    ( void ) usleep( 1000 );
+}
+/*-----------------------------------------------------------*/
+
+void vAssertCalled( const char * pcFile,
+                    uint32_t ulLine )
+{
+    char cMessage[ 256 ];
+
+    ( void ) snprintf( cMessage, sizeof( cMessage ), "vAssertCalled %s, %ld\n", pcFile, ( long ) ulLine );
+    vMainPrintString( cMessage );
+
+    abort();
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,782 @@
+/*
+ * Amazon FreeRTOS Secure Sockets for Linux V1.0.0
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/**
+ * @file iot_secure_sockets.c
+ * @brief Secure Sockets implementation on the BSD sockets of the Linux host.
+ *
+ * The host sockets are non-blocking.  A call that has to wait polls the socket
+ * once per tick and delays the calling task in between, so other tasks run
+ * while it waits, as they would with a network stack on the device.
+ */
+
+/* Define _SECURE_SOCKETS_WRAPPER_NOT_REDEFINE to prevent secure sockets functions
+ * from redefining in iot_secure_sockets_wrapper_metrics.h */
+#define _SECURE_SOCKETS_WRAPPER_NOT_REDEFINE
+
+/* Standard includes. */
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "iot_secure_sockets.h"
+#include "iot_tls.h"
+
+#undef _SECURE_SOCKETS_WRAPPER_NOT_REDEFINE
+
+/* Internal context structure. */
+typedef struct SSOCKETContext
+{
+    int iSocket;
+    char * pcDestination;
+    void * pvTLSContext;
+    BaseType_t xRequireTLS;
+    char * pcServerCertificate;
+    uint32_t ulServerCertificateLength;
+    char ** ppcAlpnProtocols;
+    uint32_t ulAlpnProtocolsCount;
+    BaseType_t xConnectAttempted;
+    TickType_t xSendTimeout;
+    TickType_t xRecvTimeout;
+} SSOCKETContext_t, * SSOCKETContextPtr_t;
+
+/*
+ * Helper routines.
+ */
+
+/*
+ * @brief Translate the errno of a failed host socket call.
+ */
+static int32_t prvErrnoToStatus( int iError )
+{
+    int32_t lStatus;
+
+    switch( iError )
+    {
+        case EPIPE:
+        case ECONNRESET:
+        case ENOTCONN:
+            lStatus = SOCKETS_ECLOSED;
+            break;
+
+        case ENOMEM:
+        case ENOBUFS:
+            lStatus = SOCKETS_ENOMEM;
+            break;
+
+        default:
+            lStatus = SOCKETS_SOCKET_ERROR;
+            break;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Wait until the host socket is ready for the given poll events.
+ *
+ * @return pdTRUE if the socket is ready, pdFALSE if the timeout expired.
+ */
+static BaseType_t prvWaitForSocket( int iSocket,
+                                    short sEvents,
+                                    TickType_t xTimeout )
+{
+    struct pollfd xPollFd;
+    TimeOut_t xTimeOut;
+    TickType_t xTicksToWait = xTimeout;
+    BaseType_t xReady = pdFALSE;
+
+    xPollFd.fd = iSocket;
+    xPollFd.events = sEvents;
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    for( ; ; )
+    {
+        xPollFd.revents = 0;
+
+        /* Errors and hang-ups are reported as ready, so the following call
+         * reports them. */
+        if( poll( &xPollFd, 1, 0 ) != 0 )
+        {
+            xReady = pdTRUE;
+            break;
+        }
+
+        if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+        {
+            break;
+        }
+
+        vTaskDelay( 1 );
+    }
+
+    return xReady;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Network send callback.
+ */
+static BaseType_t prvNetworkSend( void * pvContext,
+                                  const unsigned char * pucData,
+                                  size_t xDataLength )
+{
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) pvContext; /*lint !e9087 cast used for portability. */
+    size_t xSent = 0;
+    ssize_t xResult;
+    BaseType_t xStatus = 0;
+
+    /* Like FreeRTOS_send(), wait until all of the data is queued or the send
+     * timeout expires, and return the number of bytes queued. */
+    while( xSent < xDataLength )
+    {
+        xResult = send( pxContext->iSocket, pucData + xSent, xDataLength - xSent, MSG_NOSIGNAL );
+
+        if( xResult > 0 )
+        {
+            xSent += ( size_t ) xResult;
+        }
+        else if( ( xResult < 0 ) && ( errno == EINTR ) )
+        {
+            /* Interrupted by the tick signal, try again. */
+        }
+        else if( ( xResult < 0 ) && ( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) ) )
+        {
+            if( prvWaitForSocket( pxContext->iSocket, POLLOUT, pxContext->xSendTimeout ) == pdFALSE )
+            {
+                break;
+            }
+        }
+        else
+        {
+            xStatus = prvErrnoToStatus( errno );
+            break;
+        }
+    }
+
+    if( xSent > 0 )
+    {
+        xStatus = ( BaseType_t ) xSent;
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Network receive callback.
+ */
+static BaseType_t prvNetworkRecv( void * pvContext,
+                                  unsigned char * pucReceiveBuffer,
+                                  size_t xReceiveLength )
+{
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) pvContext; /*lint !e9087 cast used for portability. */
+    ssize_t xResult;
+    BaseType_t xStatus = 0;
+
+    /* Like FreeRTOS_recv(), return the data that is available as soon as there
+     * is some, or 0 when the receive timeout expires. */
+    for( ; ; )
+    {
+        xResult = recv( pxContext->iSocket, pucReceiveBuffer, xReceiveLength, 0 );
+
+        if( xResult > 0 )
+        {
+            xStatus = ( BaseType_t ) xResult;
+            break;
+        }
+        else if( xResult == 0 )
+        {
+            /* The peer closed the connection. */
+            xStatus = SOCKETS_ECLOSED;
+            break;
+        }
+        else if( errno == EINTR )
+        {
+            /* Interrupted by the tick signal, try again. */
+        }
+        else if( ( errno == EAGAIN ) || ( errno == EWOULDBLOCK ) )
+        {
+            if( prvWaitForSocket( pxContext->iSocket, POLLIN, pxContext->xRecvTimeout ) == pdFALSE )
+            {
+                break;
+            }
+        }
+        else
+        {
+            xStatus = prvErrnoToStatus( errno );
+            break;
+        }
+    }
+
+    return xStatus;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * @brief Connect the host socket, waiting at most the send timeout.
+ */
+static int32_t prvConnect( SSOCKETContextPtr_t pxContext,
+                           const struct sockaddr_in * pxAddress )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    int iResult;
+    int iError = 0;
+    socklen_t xErrorLength = sizeof( iError );
+
+    do
+    {
+        iResult = connect( pxContext->iSocket, ( const struct sockaddr * ) pxAddress, sizeof( *pxAddress ) );
+    } while( ( iResult != 0 ) && ( errno == EINTR ) );
+
+    if( iResult != 0 )
+    {
+        if( errno != EINPROGRESS )
+        {
+            lStatus = SOCKETS_SOCKET_ERROR;
+        }
+        else if( prvWaitForSocket( pxContext->iSocket, POLLOUT, pxContext->xSendTimeout ) == pdFALSE )
+        {
+            lStatus = SOCKETS_SOCKET_ERROR;
+        }
+        else if( ( getsockopt( pxContext->iSocket, SOL_SOCKET, SO_ERROR, &iError, &xErrorLength ) != 0 ) ||
+                 ( iError != 0 ) )
+        {
+            lStatus = SOCKETS_SOCKET_ERROR;
+        }
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Interface routines.
+ */
+
+int32_t SOCKETS_Close( Socket_t xSocket )
+{
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+    uint32_t ulProtocol;
+    int32_t lReturn;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) && ( NULL != pxContext ) )
+    {
+        /* Clean-up destination string. */
+        if( NULL != pxContext->pcDestination )
+        {
+            vPortFree( pxContext->pcDestination );
+        }
+
+        /* Clean-up server certificate. */
+        if( NULL != pxContext->pcServerCertificate )
+        {
+            vPortFree( pxContext->pcServerCertificate );
+        }
+
+        /* Clean-up application protocol array. */
+        if( NULL != pxContext->ppcAlpnProtocols )
+        {
+            for( ulProtocol = 0;
+                 ulProtocol < pxContext->ulAlpnProtocolsCount;
+                 ulProtocol++ )
+            {
+                if( NULL != pxContext->ppcAlpnProtocols[ ulProtocol ] )
+                {
+                    vPortFree( pxContext->ppcAlpnProtocols[ ulProtocol ] );
+                }
+            }
+
+            vPortFree( pxContext->ppcAlpnProtocols );
+        }
+
+        /* Clean-up TLS context. */
+        if( pdTRUE == pxContext->xRequireTLS )
+        {
+            TLS_Cleanup( pxContext->pvTLSContext );
+        }
+
+        /* Close the underlying socket handle. */
+        ( void ) close( pxContext->iSocket );
+
+        /* Free the context. */
+        vPortFree( pxContext );
+        lReturn = SOCKETS_ERROR_NONE;
+    }
+    else
+    {
+        lReturn = SOCKETS_EINVAL;
+    }
+
+    return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Connect( Socket_t xSocket,
+                         SocketsSockaddr_t * pxAddress,
+                         Socklen_t xAddressLength )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+    TLSParams_t xTLSParams = { 0 };
+    struct sockaddr_in xTempAddress = { 0 };
+
+    ( void ) xAddressLength;
+
+    if( ( pxContext != SOCKETS_INVALID_SOCKET ) && ( pxAddress != NULL ) )
+    {
+        /* A connection was attempted. If this function fails, then the socket is invalid and the user
+         * must call SOCKETS_Close(), on this socket, and SOCKETS_Socket() to get a new socket. */
+        pxContext->xConnectAttempted = pdTRUE;
+
+        /* Connect the wrapped socket.  The address and port are already in
+         * network byte order. */
+        xTempAddress.sin_family = AF_INET;
+        xTempAddress.sin_addr.s_addr = pxAddress->ulAddress;
+        xTempAddress.sin_port = pxAddress->usPort;
+        lStatus = prvConnect( pxContext, &xTempAddress );
+
+        /* Negotiate TLS if requested. */
+        if( ( SOCKETS_ERROR_NONE == lStatus ) && ( pdTRUE == pxContext->xRequireTLS ) )
+        {
+            xTLSParams.ulSize = sizeof( xTLSParams );
+            xTLSParams.pcDestination = pxContext->pcDestination;
+            xTLSParams.pcServerCertificate = pxContext->pcServerCertificate;
+            xTLSParams.ulServerCertificateLength = pxContext->ulServerCertificateLength;
+            xTLSParams.ppcAlpnProtocols = ( const char ** ) pxContext->ppcAlpnProtocols;
+            xTLSParams.ulAlpnProtocolsCount = pxContext->ulAlpnProtocolsCount;
+            xTLSParams.pvCallerContext = pxContext;
+            xTLSParams.pxNetworkRecv = prvNetworkRecv;
+            xTLSParams.pxNetworkSend = prvNetworkSend;
+            lStatus = TLS_Init( &pxContext->pvTLSContext, &xTLSParams );
+
+            if( SOCKETS_ERROR_NONE == lStatus )
+            {
+                lStatus = TLS_Connect( pxContext->pvTLSContext );
+
+                if( lStatus < 0 )
+                {
+                    lStatus = SOCKETS_TLS_HANDSHAKE_ERROR;
+                }
+            }
+        }
+    }
+    else
+    {
+        lStatus = SOCKETS_SOCKET_ERROR;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t SOCKETS_GetHostByName( const char * pcHostName )
+{
+    uint32_t ulAddress = 0;
+    struct addrinfo xHints = { 0 };
+    struct addrinfo * pxResult = NULL;
+
+    if( strlen( pcHostName ) <= ( size_t ) securesocketsMAX_DNS_NAME_LENGTH )
+    {
+        xHints.ai_family = AF_INET;
+        xHints.ai_socktype = SOCK_STREAM;
+
+        /* The lookup blocks the calling task until the host resolver
+         * answers. */
+        if( ( getaddrinfo( pcHostName, NULL, &xHints, &pxResult ) == 0 ) && ( pxResult != NULL ) )
+        {
+            ulAddress = ( ( struct sockaddr_in * ) pxResult->ai_addr )->sin_addr.s_addr;
+        }
+
+        if( pxResult != NULL )
+        {
+            freeaddrinfo( pxResult );
+        }
+    }
+
+    return ulAddress;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Recv( Socket_t xSocket,
+                      void * pvBuffer,
+                      size_t xBufferLength,
+                      uint32_t ulFlags )
+{
+    int32_t lStatus = SOCKETS_SOCKET_ERROR;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+
+    ( void ) ulFlags;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) &&
+        ( pvBuffer != NULL ) )
+    {
+        if( pdTRUE == pxContext->xRequireTLS )
+        {
+            /* Receive through TLS pipe, if negotiated. */
+            lStatus = TLS_Recv( pxContext->pvTLSContext, pvBuffer, xBufferLength );
+        }
+        else
+        {
+            /* Receive unencrypted. */
+            lStatus = prvNetworkRecv( pxContext, pvBuffer, xBufferLength );
+        }
+    }
+    else
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Send( Socket_t xSocket,
+                      const void * pvBuffer,
+                      size_t xDataLength,
+                      uint32_t ulFlags )
+{
+    int32_t lStatus = SOCKETS_SOCKET_ERROR;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+
+    ( void ) ulFlags;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) &&
+        ( pvBuffer != NULL ) )
+    {
+        if( pdTRUE == pxContext->xRequireTLS )
+        {
+            /* Send through TLS pipe, if negotiated. */
+            lStatus = TLS_Send( pxContext->pvTLSContext, pvBuffer, xDataLength );
+        }
+        else
+        {
+            /* Send unencrypted. */
+            lStatus = prvNetworkSend( pxContext, pvBuffer, xDataLength );
+        }
+    }
+    else
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_SetSockOpt( Socket_t xSocket,
+                            int32_t lLevel,
+                            int32_t lOptionName,
+                            const void * pvOptionValue,
+                            size_t xOptionLength )
+{
+    int32_t lStatus = SOCKETS_ERROR_NONE;
+    TickType_t xTimeout;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+    char ** ppcAlpnIn = ( char ** ) pvOptionValue;
+    size_t xLength = 0;
+    uint32_t ulProtocol;
+
+    ( void ) lLevel;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) && ( xSocket != NULL ) )
+    {
+        switch( lOptionName )
+        {
+            case SOCKETS_SO_SERVER_NAME_INDICATION:
+
+                /* Do not set the SNI options if the socket is possibly already connected. */
+                if( pxContext->xConnectAttempted == pdTRUE )
+                {
+                    lStatus = SOCKETS_EISCONN;
+                }
+
+                /* Non-NULL destination string indicates that SNI extension should
+                 * be used during TLS negotiation. */
+                else if( NULL == ( pxContext->pcDestination =
+                                       ( char * ) pvPortMalloc( 1U + xOptionLength ) ) )
+                {
+                    lStatus = SOCKETS_ENOMEM;
+                }
+                else
+                {
+                    memcpy( pxContext->pcDestination, pvOptionValue, xOptionLength );
+                    pxContext->pcDestination[ xOptionLength ] = '\0';
+                }
+
+                break;
+
+            case SOCKETS_SO_TRUSTED_SERVER_CERTIFICATE:
+
+                /* Do not set the trusted server certificate if the socket is possibly already connected. */
+                if( pxContext->xConnectAttempted == pdTRUE )
+                {
+                    lStatus = SOCKETS_EISCONN;
+                }
+
+                /* Non-NULL server certificate field indicates that the default trust
+                 * list should not be used. */
+                else if( NULL == ( pxContext->pcServerCertificate =
+                                       ( char * ) pvPortMalloc( xOptionLength ) ) )
+                {
+                    lStatus = SOCKETS_ENOMEM;
+                }
+                else
+                {
+                    memcpy( pxContext->pcServerCertificate, pvOptionValue, xOptionLength );
+                    pxContext->ulServerCertificateLength = xOptionLength;
+                }
+
+                break;
+
+            case SOCKETS_SO_REQUIRE_TLS:
+
+                /* Do not set the TLS option if the socket is possibly already connected. */
+                if( pxContext->xConnectAttempted == pdTRUE )
+                {
+                    lStatus = SOCKETS_EISCONN;
+                }
+                else
+                {
+                    pxContext->xRequireTLS = pdTRUE;
+                }
+
+                break;
+
+            case SOCKETS_SO_ALPN_PROTOCOLS:
+
+                /* Do not set the ALPN option if the socket is already connected. */
+                if( pxContext->xConnectAttempted == pdTRUE )
+                {
+                    lStatus = SOCKETS_EISCONN;
+                    break;
+                }
+
+                /* Allocate a sufficiently long array of pointers. */
+                pxContext->ulAlpnProtocolsCount = 1 + xOptionLength;
+
+                if( NULL == ( pxContext->ppcAlpnProtocols =
+                                  ( char ** ) pvPortMalloc( pxContext->ulAlpnProtocolsCount * sizeof( char * ) ) ) )
+                {
+                    lStatus = SOCKETS_ENOMEM;
+                }
+                else
+                {
+                    /* Zero out the pointers. */
+                    memset( pxContext->ppcAlpnProtocols,
+                            0,
+                            pxContext->ulAlpnProtocolsCount * sizeof( char * ) );
+                }
+
+                /* Copy each protocol string. */
+                for( ulProtocol = 0;
+                     ( ulProtocol < pxContext->ulAlpnProtocolsCount - 1 ) &&
+                     ( SOCKETS_ERROR_NONE == lStatus );
+                     ulProtocol++ )
+                {
+                    xLength = strlen( ppcAlpnIn[ ulProtocol ] );
+
+                    if( NULL == ( pxContext->ppcAlpnProtocols[ ulProtocol ] =
+                                      ( char * ) pvPortMalloc( 1 + xLength ) ) )
+                    {
+                        lStatus = SOCKETS_ENOMEM;
+                    }
+                    else
+                    {
+                        memcpy( pxContext->ppcAlpnProtocols[ ulProtocol ],
+                                ppcAlpnIn[ ulProtocol ],
+                                xLength );
+                        pxContext->ppcAlpnProtocols[ ulProtocol ][ xLength ] = '\0';
+                    }
+                }
+
+                break;
+
+            case SOCKETS_SO_NONBLOCK:
+
+                /* Non-blocking connect is not supported.  Socket may be set to nonblocking
+                 * only after a connection is made. */
+                if( pdTRUE == pxContext->xConnectAttempted )
+                {
+                    pxContext->xRecvTimeout = 0;
+                    pxContext->xSendTimeout = 0;
+                }
+                else
+                {
+                    lStatus = SOCKETS_EISCONN;
+                }
+
+                break;
+
+            case SOCKETS_SO_RCVTIMEO:
+            case SOCKETS_SO_SNDTIMEO:
+                /* Comply with Berkeley standard - a 0 timeout is wait forever. */
+                xTimeout = *( ( const TickType_t * ) pvOptionValue ); /*lint !e9087 pvOptionValue passed should be of TickType_t */
+
+                if( xTimeout == 0U )
+                {
+                    xTimeout = portMAX_DELAY;
+                }
+
+                if( lOptionName == SOCKETS_SO_RCVTIMEO )
+                {
+                    pxContext->xRecvTimeout = xTimeout;
+                }
+                else
+                {
+                    pxContext->xSendTimeout = xTimeout;
+                }
+
+                break;
+
+            default:
+                lStatus = SOCKETS_ENOPROTOOPT;
+                break;
+        }
+    }
+    else
+    {
+        lStatus = SOCKETS_EINVAL;
+    }
+
+    return lStatus;
+}
+/*-----------------------------------------------------------*/
+
+int32_t SOCKETS_Shutdown( Socket_t xSocket,
+                          uint32_t ulHow )
+{
+    int32_t lReturn = SOCKETS_ERROR_NONE;
+    SSOCKETContextPtr_t pxContext = ( SSOCKETContextPtr_t ) xSocket; /*lint !e9087 cast used for portability. */
+    int iHow;
+
+    if( ( xSocket != SOCKETS_INVALID_SOCKET ) && ( xSocket != NULL ) )
+    {
+        switch( ulHow )
+        {
+            case SOCKETS_SHUT_RD:
+                iHow = SHUT_RD;
+                break;
+
+            case SOCKETS_SHUT_WR:
+                iHow = SHUT_WR;
+                break;
+
+            case SOCKETS_SHUT_RDWR:
+                iHow = SHUT_RDWR;
+                break;
+
+            default:
+                lReturn = SOCKETS_EINVAL;
+                break;
+        }
+
+        if( ( lReturn == SOCKETS_ERROR_NONE ) &&
+            ( shutdown( pxContext->iSocket, iHow ) != 0 ) )
+        {
+            lReturn = prvErrnoToStatus( errno );
+        }
+    }
+    else
+    {
+        lReturn = SOCKETS_EINVAL;
+    }
+
+    return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+Socket_t SOCKETS_Socket( int32_t lDomain,
+                         int32_t lType,
+                         int32_t lProtocol )
+{
+    SSOCKETContextPtr_t pxContext = NULL;
+    int iSocket;
+    int iFlags;
+
+    /* Ensure that only supported values are supplied. */
+    configASSERT( lDomain == SOCKETS_AF_INET );
+    configASSERT( lType == SOCKETS_SOCK_STREAM );
+    configASSERT( lProtocol == SOCKETS_IPPROTO_TCP );
+
+    /* Create the wrapped socket.  It never blocks the host thread, see
+     * prvWaitForSocket(). */
+    iSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+    if( iSocket >= 0 )
+    {
+        iFlags = fcntl( iSocket, F_GETFL, 0 );
+
+        if( ( iFlags < 0 ) || ( fcntl( iSocket, F_SETFL, iFlags | O_NONBLOCK ) != 0 ) )
+        {
+            ( void ) close( iSocket );
+            iSocket = -1;
+        }
+    }
+
+    if( iSocket >= 0 )
+    {
+        /* Allocate the internal context structure. */
+        if( NULL == ( pxContext = pvPortMalloc( sizeof( SSOCKETContext_t ) ) ) )
+        {
+            /* Need to close socket. */
+            ( void ) close( iSocket );
+            pxContext = SOCKETS_INVALID_SOCKET;
+        }
+        else
+        {
+            memset( pxContext, 0, sizeof( SSOCKETContext_t ) );
+            pxContext->iSocket = iSocket;
+            pxContext->xSendTimeout = pdMS_TO_TICKS( socketsconfigDEFAULT_SEND_TIMEOUT );
+            pxContext->xRecvTimeout = pdMS_TO_TICKS( socketsconfigDEFAULT_RECV_TIMEOUT );
+        }
+    }
+    else
+    {
+        pxContext = SOCKETS_INVALID_SOCKET;
+    }
+
+    return pxContext;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t SOCKETS_Init( void )
+{
+    /* Empty initialization for this port. */
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
@@ -85,4 +85,56 @@
  */
  #define otaconfigMAX_NUM_BLOCKS_REQUEST        128U
 
+/**
+ * @brief The maximum number of block ranges requested from the OTA streaming service at a time.
+ *
+ * When this is larger than zero, the agent keeps up to this many requests for ranges of
+ * otaconfigSTREAM_WINDOW_BLOCKS blocks in flight and requests the next range as soon as one
+ * completes, instead of requesting every missing block once per otaconfigFILE_REQUEST_WAIT_MS.
+ * The number of ranges in flight grows while blocks arrive faster, stops growing when they do not,
+ * and shrinks on duplicates and losses.
+ */
+#define otaconfigSTREAM_WINDOW_MAX_REQUESTS     8U
+
+/**
+ * @brief The number of blocks covered by each range requested in windowed mode.
+ *
+ * This must be a multiple of 8 and must not exceed otaconfigMAX_NUM_BLOCKS_REQUEST.
+ */
+#define otaconfigSTREAM_WINDOW_BLOCKS           16U
+
+/**
+ * @brief Set to 1 to hash each block for the signature check as it is received.
+ *
+ * The PAL then only checks the signature when the file is closed, instead of reading the whole
+ * file back. Blocks that arrive ahead of the next block to hash are held in RAM, up to
+ * otaconfigSIGNATURE_PENDING_BLOCKS of them.
+ */
+#define otaconfigINCREMENTAL_SIGNATURE_VERIFY   1
+
+/**
+ * @brief The number of out of order blocks held for the incremental hash.
+ *
+ * With windowed requests, a lost block is requested again after the ranges already in flight,
+ * so this covers a few ranges.
+ */
+#define otaconfigSIGNATURE_PENDING_BLOCKS       32U
+
+/**
+ * @brief Save a download checkpoint every this many received blocks.
+ *
+ * A download interrupted by a reset or a shutdown of the agent resumes from the last checkpoint
+ * when the same job is received again, and only the missing blocks are requested. The checkpoint
+ * is kept next to the receive file. Set to 0 to disable checkpoints.
+ */
+#define otaconfigCHECKPOINT_BLOCKS              32U
+
+/**
+ * @brief UTC time in seconds for the expiry driven certificate rotation.
+ *
+ * The simulator takes it from the host clock.
+ */
+#include <time.h>
+#define cdfconfigGET_UTC_SECONDS()              ( ( uint32_t ) time( NULL ) )
+
 #endif /* _AWS_OTA_AGENT_CONFIG_H_ */
@@ -58,6 +58,7 @@
 #define testrunnerFULL_OTA_CBOR_ENABLED               0
 #define testrunnerFULL_OTA_AGENT_ENABLED              0
 #define testrunnerFULL_OTA_PAL_ENABLED                0
+#define testrunnerFULL_CDF_AGENT_ENABLED              0
 #define testrunnerFULL_SERIALIZER_ENABLED             0
 #define testrunnerUTIL_PLATFORM_CLOCK_ENABLED         0
 #define testrunnerUTIL_PLATFORM_THREADS_ENABLED       0
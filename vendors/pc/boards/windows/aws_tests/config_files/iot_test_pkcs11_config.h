@@ -85,6 +85,11 @@
  */
 #define pkcs11testGENERATE_KEYPAIR_SUPPORT    ( 1 )
 
+/*
+ * @brief Set to 1 if C_CreateObject accepts a certificate value in PEM and stores it as DER.  0 if not.
+ */
+#define pkcs11testPEM_CERTIFICATE_IMPORT_SUPPORT    ( 1 )
+
 /**
  * @brief The PKCS #11 label for device private key for test.
  *
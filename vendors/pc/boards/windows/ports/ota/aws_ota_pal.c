@@ -39,6 +39,12 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C );
 static uint8_t * prvPAL_ReadAndAssumeCertificate( const uint8_t * const pucCertName,
                                                   uint32_t * const ulSignerCertSize );
 
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+    static BaseType_t prvPAL_CheckpointPath( OTA_FileContext_t * const C,
+                                             char * pcPath,
+                                             size_t xPathSize );
+#endif
+
 /*-----------------------------------------------------------*/
 
 static inline BaseType_t prvContextValidate( OTA_FileContext_t * C )
@@ -65,8 +71,9 @@ OTA_Err_t prvPAL_CreateFileForRx( OTA_FileContext_t * const C )
     {
         if ( C->pucFilePath != NULL )
         {
-            C->pxFile = fopen( ( const char * )C->pucFilePath, "w+b" ); /*lint !e586
-                                                                           * C standard library call is being used for portability. */
+            /* Keep the blocks already received when resuming from a checkpoint. */
+            C->pxFile = fopen( ( const char * )C->pucFilePath, ( C->xIsResuming == pdTRUE ) ? "r+b" : "w+b" ); /*lint !e586
+                                                                                                                   * C standard library call is being used for portability. */
 
             if ( C->pxFile != NULL )
             {
@@ -252,6 +259,127 @@ OTA_Err_t prvPAL_CloseFile( OTA_FileContext_t * const C )
 }
 
 
+#if ( otaconfigCHECKPOINT_BLOCKS > 0 )
+
+/* The download checkpoint is kept next to the receive file, in a file with this suffix. */
+#define OTA_PAL_WIN_CHECKPOINT_SUFFIX    ".ckpt"
+
+/* Size of the buffer for the path of the checkpoint file (MAX_PATH of the Windows API). */
+#define OTA_PAL_WIN_CHECKPOINT_PATH_SIZE    260U
+
+/* Build the path of the checkpoint file of the specified context. */
+
+static BaseType_t prvPAL_CheckpointPath( OTA_FileContext_t * const C,
+                                         char * pcPath,
+                                         size_t xPathSize )
+{
+    int lLength = -1;
+
+    if( ( C != NULL ) && ( C->pucFilePath != NULL ) )
+    {
+        lLength = snprintf( pcPath, xPathSize, "%s" OTA_PAL_WIN_CHECKPOINT_SUFFIX, ( const char * ) C->pucFilePath );
+    }
+
+    return ( ( lLength > 0 ) && ( ( size_t ) lLength < xPathSize ) ) ? pdTRUE : pdFALSE;
+}
+
+
+/* Save the download checkpoint to its file, or delete the file if there is no checkpoint. */
+
+OTA_Err_t prvPAL_SaveCheckpoint( OTA_FileContext_t * const C,
+                                 const uint8_t * pucCheckpoint,
+                                 uint32_t ulSize )
+{
+    DEFINE_OTA_METHOD_NAME( "prvPAL_SaveCheckpoint" );
+
+    OTA_Err_t eResult = kOTA_Err_None;
+    char cPath[ OTA_PAL_WIN_CHECKPOINT_PATH_SIZE ];
+    FILE * pxFile;
+
+    if( prvPAL_CheckpointPath( C, cPath, sizeof( cPath ) ) != pdTRUE )
+    {
+        eResult = kOTA_Err_FileClose;
+    }
+    else if( ( pucCheckpoint == NULL ) || ( ulSize == 0U ) )
+    {
+        ( void ) remove( cPath ); /* There is nothing to delete if the download had no checkpoint yet. */
+    }
+    else
+    {
+        /* The blocks the checkpoint covers must be written before the checkpoint is. */
+        if( ( C->pxFile != NULL ) && ( fflush( C->pxFile ) != 0 ) ) /*lint !e586
+                                                                   * C standard library call is being used for portability. */
+        {
+            eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) );
+        }
+        else
+        {
+            pxFile = fopen( cPath, "wb" ); /*lint !e586
+                                            * C standard library call is being used for portability. */
+
+            if( pxFile == NULL )
+            {
+                eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) );
+            }
+            else
+            {
+                if( fwrite( pucCheckpoint, 1, ulSize, pxFile ) != ulSize ) /*lint !e586
+                                                                            * C standard library call is being used for portability. */
+                {
+                    eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) );
+                }
+
+                if( fclose( pxFile ) != 0 ) /*lint !e586
+                                             * C standard library call is being used for portability. */
+                {
+                    eResult = ( kOTA_Err_FileClose | ( errno & kOTA_PAL_ErrMask ) );
+                }
+            }
+        }
+
+        if( eResult != kOTA_Err_None )
+        {
+            OTA_LOG_L1( "[%s] ERROR - Failed to save the checkpoint.\r\n", OTA_METHOD_NAME );
+        }
+    }
+
+    return eResult;
+}
+
+
+/* Read the download checkpoint from its file. It must have exactly the expected size. */
+
+OTA_Err_t prvPAL_LoadCheckpoint( OTA_FileContext_t * const C,
+                                 uint8_t * pucCheckpoint,
+                                 uint32_t ulSize )
+{
+    OTA_Err_t eResult = kOTA_Err_RxFileCreateFailed;
+    char cPath[ OTA_PAL_WIN_CHECKPOINT_PATH_SIZE ];
+    FILE * pxFile;
+    uint8_t ucExtra;
+
+    if( prvPAL_CheckpointPath( C, cPath, sizeof( cPath ) ) == pdTRUE )
+    {
+        pxFile = fopen( cPath, "rb" ); /*lint !e586
+                                        * C standard library call is being used for portability. */
+
+        if( pxFile != NULL )
+        {
+            if( ( fread( pucCheckpoint, 1, ulSize, pxFile ) == ulSize ) &&
+                ( fread( &ucExtra, 1, 1, pxFile ) == 0U ) )
+            {
+                eResult = kOTA_Err_None;
+            }
+
+            ( void ) fclose( pxFile );
+        }
+    }
+
+    return eResult;
+}
+#endif /* if ( otaconfigCHECKPOINT_BLOCKS > 0 ) */
+
+
 /* Verify the signature of the specified file. */
 
 static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
@@ -262,16 +390,29 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
     uint32_t ulBytesRead;
     uint32_t ulSignerCertSize;
     uint8_t * pucBuf, * pucSignerCert;
-    void * pvSigVerifyContext;
+    void * pvSigVerifyContext = NULL;
+    BaseType_t xFileHashed = pdFALSE;
 
     if( prvContextValidate( C ) == pdTRUE )
     {
+        if( C->pvSigVerifyContext != NULL )
+        {
+            /* The agent hashed the file as it was received, so only the final check is left. */
+            pvSigVerifyContext = C->pvSigVerifyContext;
+            C->pvSigVerifyContext = NULL; /* The context is ours to free now. */
+            xFileHashed = pdTRUE;
+        }
         /* Verify an ECDSA-SHA256 signature. */
-        if( pdFALSE == CRYPTO_SignatureVerificationStart( &pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
+        else if( pdFALSE == CRYPTO_SignatureVerificationStart( &pvSigVerifyContext, cryptoASYMMETRIC_ALGORITHM_ECDSA, cryptoHASH_ALGORITHM_SHA256 ) )
         {
             eResult = kOTA_Err_SignatureCheckFailed;
         }
         else
+        {
+            /* The file is hashed below. */
+        }
+
+        if( eResult == kOTA_Err_None )
         {
             OTA_LOG_L1( "[%s] Started %s signature verification, file: %s\r\n", OTA_METHOD_NAME,
                         cOTA_JSON_FileSignatureKey, ( const char * ) C->pucCertFilepath );
@@ -279,51 +420,64 @@ static OTA_Err_t prvPAL_CheckFileSignature( OTA_FileContext_t * const C )
 
             if( pucSignerCert != NULL )
             {
-                pucBuf = pvPortMalloc( OTA_PAL_WIN_BUF_SIZE ); /*lint !e9079 Allow conversion. */
-
-                if( pucBuf != NULL )
+                if( xFileHashed == pdFALSE )
                 {
-                    /* Rewind the received file to the beginning. */
-                    if( fseek( C->pxFile, 0L, SEEK_SET ) == 0 ) /*lint !e586
-                                                                  * C standard library call is being used for portability. */
+                    pucBuf = pvPortMalloc( OTA_PAL_WIN_BUF_SIZE ); /*lint !e9079 Allow conversion. */
+
+                    if( pucBuf != NULL )
                     {
-                        do
+                        /* Rewind the received file to the beginning. */
+                        if( fseek( C->pxFile, 0L, SEEK_SET ) == 0 ) /*lint !e586
+                                                                      * C standard library call is being used for portability. */
                         {
-                            ulBytesRead = fread( pucBuf, 1, OTA_PAL_WIN_BUF_SIZE, C->pxFile ); /*lint !e586
-                                                                                               * C standard library call is being used for portability. */
-                            /* Include the file chunk in the signature validation. Zero size is OK. */
-                            CRYPTO_SignatureVerificationUpdate( pvSigVerifyContext, pucBuf, ulBytesRead );
-                        } while( ulBytesRead > 0UL );
-
-                        if( pdFALSE == CRYPTO_SignatureVerificationFinal( pvSigVerifyContext,
-                                                                          ( char * ) pucSignerCert,
-                                                                          ( size_t ) ulSignerCertSize,
-                                                                          C->pxSignature->ucData,
-                                                                          C->pxSignature->usSize ) ) /*lint !e732 !e9034 Allow comparison in this context. */
+                            do
+                            {
+                                ulBytesRead = fread( pucBuf, 1, OTA_PAL_WIN_BUF_SIZE, C->pxFile ); /*lint !e586
+                                                                                                   * C standard library call is being used for portability. */
+                                /* Include the file chunk in the signature validation. Zero size is OK. */
+                                CRYPTO_SignatureVerificationUpdate( pvSigVerifyContext, pucBuf, ulBytesRead );
+                            } while( ulBytesRead > 0UL );
+                        }
+                        else
                         {
-                            eResult = kOTA_Err_SignatureCheckFailed;
+                            /* Nothing special to do. */
                         }
-						pvSigVerifyContext = NULL;	/* The context has been freed by CRYPTO_SignatureVerificationFinal(). */
+
+                        /* Free the temporary file page buffer. */
+                        vPortFree( pucBuf );
                     }
                     else
                     {
-                        /* Nothing special to do. */
+                        OTA_LOG_L1( "[%s] ERROR - Failed to allocate buffer memory.\r\n", OTA_METHOD_NAME );
+                        eResult = kOTA_Err_OutOfMemory;
                     }
+                }
 
-                    /* Free the temporary file page buffer. */
-                    vPortFree( pucBuf );
+                if( eResult == kOTA_Err_None )
+                {
+                    if( pdFALSE == CRYPTO_SignatureVerificationFinal( pvSigVerifyContext,
+                                                                      ( char * ) pucSignerCert,
+                                                                      ( size_t ) ulSignerCertSize,
+                                                                      C->pxSignature->ucData,
+                                                                      C->pxSignature->usSize ) ) /*lint !e732 !e9034 Allow comparison in this context. */
+                    {
+                        eResult = kOTA_Err_SignatureCheckFailed;
+                    }
                 }
                 else
                 {
-                    OTA_LOG_L1( "[%s] ERROR - Failed to allocate buffer memory.\r\n", OTA_METHOD_NAME );
-                    eResult = kOTA_Err_OutOfMemory;
+                    /* Only free the context. */
+                    ( void ) CRYPTO_SignatureVerificationFinal( pvSigVerifyContext, NULL, 0, NULL, 0 );
                 }
 
+                pvSigVerifyContext = NULL; /* The context has been freed by CRYPTO_SignatureVerificationFinal(). */
+
                 /* Free the signer certificate that we now own after prvReadAndAssumeCertificate(). */
                 vPortFree( pucSignerCert );
             }
             else
             {
+                ( void ) CRYPTO_SignatureVerificationFinal( pvSigVerifyContext, NULL, 0, NULL, 0 );
                 eResult = kOTA_Err_BadSignerCert;
             }
         }
@@ -48,6 +48,7 @@
 #define pkcs11palFILE_NAME_CLIENT_CERTIFICATE    "FreeRTOS_P11_Certificate.dat"
 #define pkcs11palFILE_NAME_KEY                   "FreeRTOS_P11_Key.dat"
 #define pkcs11palFILE_CODE_SIGN_PUBLIC_KEY       "FreeRTOS_P11_CodeSignKey.dat"
+#define pkcs11palFILE_NAME_PENDING_KEY           "FreeRTOS_P11_PendingKey.dat"
 
 #define PKCS11_PAL_PRINT( X )    vLoggingPrintf X
 
@@ -58,7 +59,9 @@ enum eObjectHandles
     eAwsDevicePrivateKey = 1,
     eAwsDevicePublicKey,
     eAwsDeviceCertificate,
-    eAwsCodeSigningKey
+    eAwsCodeSigningKey,
+    eAwsPendingPrivateKey,
+    eAwsPendingPublicKey
 };
 
 /*-----------------------------------------------------------*/
@@ -116,6 +119,20 @@ void prvLabelToFilenameHandle( uint8_t * pcLabel,
             *pcFileName = pkcs11palFILE_CODE_SIGN_PUBLIC_KEY;
             *pHandle = eAwsCodeSigningKey;
         }
+        else if( 0 == memcmp( pcLabel,
+                              &pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS,
+                              sizeof( pkcs11configLABEL_PENDING_PRIVATE_KEY_FOR_TLS ) ) )
+        {
+            *pcFileName = pkcs11palFILE_NAME_PENDING_KEY;
+            *pHandle = eAwsPendingPrivateKey;
+        }
+        else if( 0 == memcmp( pcLabel,
+                              &pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS,
+                              sizeof( pkcs11configLABEL_PENDING_PUBLIC_KEY_FOR_TLS ) ) )
+        {
+            *pcFileName = pkcs11palFILE_NAME_PENDING_KEY;
+            *pHandle = eAwsPendingPublicKey;
+        }
         else
         {
             *pcFileName = NULL;
@@ -290,6 +307,17 @@ CK_RV PKCS11_PAL_GetObjectValue( CK_OBJECT_HANDLE xHandle,
         pcFileName = pkcs11palFILE_CODE_SIGN_PUBLIC_KEY;
         *pIsPrivate = CK_FALSE;
     }
+    else if( xHandle == eAwsPendingPrivateKey )
+    {
+        pcFileName = pkcs11palFILE_NAME_PENDING_KEY;
+        *pIsPrivate = CK_TRUE;
+    }
+    else if( xHandle == eAwsPendingPublicKey )
+    {
+        /* Like the device key pair, both keys are in one file. */
+        pcFileName = pkcs11palFILE_NAME_PENDING_KEY;
+        *pIsPrivate = CK_FALSE;
+    }
     else
     {
         ulReturn = CKR_KEY_HANDLE_INVALID;
@@ -1,6 +1,7 @@
 set(
     AFR_MANIFEST_SUPPORTED_BOARDS
     windows
+    linux
     CACHE INTERNAL "Supported boards list."
 )
 